@@ -202,6 +202,13 @@ def stratum_deps():
             branch = "3525e3984282c827c7207245b1d4a47f4eaf3c91",
         )
 
+    if "com_github_google_benchmark" not in native.existing_rules():
+        remote_workspace(
+            name = "com_github_google_benchmark",
+            remote = "https://github.com/google/benchmark",
+            tag = "v1.5.0",
+        )
+
     if "com_googlesource_code_re2" not in native.existing_rules():
         remote_workspace(
             name = "com_googlesource_code_re2",
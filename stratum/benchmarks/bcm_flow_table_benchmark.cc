@@ -0,0 +1,141 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks measuring the TableEntry hashing and comparison used to key the
+// flows of BcmFlowTable, and the lookups and updates of tables of various
+// sizes.
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/bcm/bcm_flow_table.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+namespace {
+
+constexpr uint32 kTableId = 33554433;
+
+// Returns a big-endian encoding of 'value' in 'width' bytes.
+std::string Bytes(uint64 value, int width) {
+  std::string bytes(width, '\0');
+  for (int i = width - 1; i >= 0 && value != 0; --i, value >>= 8) {
+    bytes[i] = static_cast<char>(value & 0xff);
+  }
+  return bytes;
+}
+
+// Returns an ACL like entry, with a ternary and two exact match fields.
+::p4::v1::TableEntry AclEntry(int i) {
+  ::p4::v1::TableEntry entry;
+  entry.set_table_id(kTableId);
+  entry.set_priority(10);
+  auto* match = entry.add_match();
+  match->set_field_id(1);
+  match->mutable_ternary()->set_value(Bytes(0x0a000000 + i, 4));
+  match->mutable_ternary()->set_mask(Bytes(0xffffff00, 4));
+  match = entry.add_match();
+  match->set_field_id(2);
+  match->mutable_exact()->set_value(Bytes(0x0800, 2));
+  match = entry.add_match();
+  match->set_field_id(3);
+  match->mutable_exact()->set_value(Bytes(i % 64, 2));
+  auto* action = entry.mutable_action()->mutable_action();
+  action->set_action_id(16777217);
+  auto* param = action->add_params();
+  param->set_param_id(1);
+  param->set_value(Bytes(i, 4));
+  return entry;
+}
+
+std::vector<::p4::v1::TableEntry> AclEntries(int num_entries) {
+  std::vector<::p4::v1::TableEntry> entries;
+  for (int i = 0; i < num_entries; ++i) entries.push_back(AclEntry(i));
+  return entries;
+}
+
+void BM_TableEntryHash(benchmark::State& state) {
+  const auto entries = AclEntries(1024);
+  TableEntryHash hash;
+  size_t i = 0;
+  for (auto _ : state) {
+    size_t h = hash(entries[i]);
+    benchmark::DoNotOptimize(h);
+    if (++i == entries.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TableEntryHash);
+
+// Compares entries which only differ by their action, i.e. the worst case
+// where every match field has to be compared.
+void BM_TableEntryEqual(benchmark::State& state) {
+  const auto entries = AclEntries(1024);
+  std::vector<::p4::v1::TableEntry> modified_entries = entries;
+  for (auto& entry : modified_entries) {
+    entry.mutable_action()->mutable_action()->mutable_params(0)->set_value(
+        Bytes(0, 4));
+  }
+  TableEntryEqual equal;
+  size_t i = 0;
+  for (auto _ : state) {
+    bool eq = equal(entries[i], modified_entries[i]);
+    benchmark::DoNotOptimize(eq);
+    if (++i == entries.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TableEntryEqual);
+
+// Looks up entries of a table with state.range(0) entries.
+void BM_BcmFlowTableLookup(benchmark::State& state) {
+  const auto entries = AclEntries(state.range(0));
+  BcmFlowTable table(kTableId);
+  for (const auto& entry : entries) CHECK_OK(table.InsertEntry(entry));
+  size_t i = 0;
+  for (auto _ : state) {
+    auto ret = table.Lookup(entries[i]);
+    benchmark::DoNotOptimize(ret);
+    if (++i == entries.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BcmFlowTableLookup)->Range(16, 16 << 10);
+
+// Inserts and deletes an entry in a table with state.range(0) entries.
+void BM_BcmFlowTableInsertDelete(benchmark::State& state) {
+  const auto entries = AclEntries(state.range(0) + 1);
+  BcmFlowTable table(kTableId);
+  for (size_t i = 1; i < entries.size(); ++i) {
+    CHECK_OK(table.InsertEntry(entries[i]));
+  }
+  for (auto _ : state) {
+    CHECK_OK(table.InsertEntry(entries[0]));
+    CHECK_OK(table.DeleteEntry(entries[0]).status());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BcmFlowTableInsertDelete)->Range(16, 16 << 10);
+
+}  // namespace
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
+
+BENCHMARK_MAIN();
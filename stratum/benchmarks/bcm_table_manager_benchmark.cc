@@ -0,0 +1,170 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks measuring the BcmTableManager work done for each flow of a
+// P4Runtime Write (FillBcmFlowEntry, AddTableEntry) and Read
+// (ReadTableEntries). The P4TableMapper and the chassis manager are mocked,
+// so FillBcmFlowEntry only measures the CommonFlowEntry to BcmFlowEntry
+// translation (plus the mock returning a canned CommonFlowEntry). See
+// //stratum/hal/lib/p4:p4_table_mapper_benchmark for the P4TableMapper part.
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/bcm/bcm.pb.h"
+#include "stratum/hal/lib/bcm/bcm_chassis_ro_mock.h"
+#include "stratum/hal/lib/bcm/bcm_table_manager.h"
+#include "stratum/hal/lib/p4/common_flow_entry.pb.h"
+#include "stratum/hal/lib/p4/p4_table_mapper_mock.h"
+#include "stratum/lib/utils.h"
+#include "absl/memory/memory.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+namespace {
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+
+constexpr int kUnit = 0;
+constexpr uint32 kTableId = 33554433;
+constexpr uint32 kActionId = 16777217;
+
+// Returns a big-endian encoding of 'value' in 'width' bytes.
+std::string Bytes(uint64 value, int width) {
+  std::string bytes(width, '\0');
+  for (int i = width - 1; i >= 0 && value != 0; --i, value >>= 8) {
+    bytes[i] = static_cast<char>(value & 0xff);
+  }
+  return bytes;
+}
+
+// Returns an IPv4 route like entry.
+::p4::v1::TableEntry RouteEntry(int i) {
+  ::p4::v1::TableEntry entry;
+  entry.set_table_id(kTableId);
+  auto* match = entry.add_match();
+  match->set_field_id(1);
+  match->mutable_exact()->set_value(Bytes(10, 2));
+  match = entry.add_match();
+  match->set_field_id(2);
+  match->mutable_lpm()->set_value(Bytes(0x0a000000 + (i << 8), 4));
+  match->mutable_lpm()->set_prefix_len(24);
+  auto* action = entry.mutable_action()->mutable_action();
+  action->set_action_id(kActionId);
+  auto* param = action->add_params();
+  param->set_param_id(1);
+  param->set_value(Bytes(i, 4));
+  return entry;
+}
+
+// Holds a BcmTableManager using mocks, with the given number of entries.
+class BcmTableManagerFixture {
+ public:
+  explicit BcmTableManagerFixture(int num_entries)
+      : bcm_chassis_ro_mock_(absl::make_unique<NiceMock<BcmChassisRoMock>>()),
+        p4_table_mapper_mock_(
+            absl::make_unique<NiceMock<P4TableMapperMock>>()),
+        bcm_table_manager_(BcmTableManager::CreateInstance(
+            bcm_chassis_ro_mock_.get(), p4_table_mapper_mock_.get(), kUnit)) {
+    // The IPv4 LPM flow the P4TableMapper would return for RouteEntry().
+    CommonFlowEntry common_flow_entry;
+    CHECK_OK(ParseProtoFromString(R"PROTO(
+      table_info { id: 33554433 type: P4_TABLE_L3_IP pipeline_stage: L3_LPM }
+      fields { type: P4_FIELD_TYPE_VRF value { u32: 10 } }
+      fields {
+        type: P4_FIELD_TYPE_IPV4_DST
+        value { u32: 167772160 }
+        mask { u32: 4294967040 }
+      }
+      action { type: P4_ACTION_TYPE_FUNCTION }
+    )PROTO", &common_flow_entry));
+    ON_CALL(*p4_table_mapper_mock_, MapFlowEntry(_, _, _))
+        .WillByDefault(DoAll(SetArgPointee<2>(common_flow_entry),
+                             Return(::util::OkStatus())));
+    ON_CALL(*p4_table_mapper_mock_, LookupTable(kTableId, _))
+        .WillByDefault(Return(::util::OkStatus()));
+    for (int i = 0; i < num_entries; ++i) {
+      CHECK_OK(bcm_table_manager_->AddTableEntry(RouteEntry(i)));
+    }
+  }
+
+  BcmTableManager* bcm_table_manager() { return bcm_table_manager_.get(); }
+
+ private:
+  std::unique_ptr<BcmChassisRoMock> bcm_chassis_ro_mock_;
+  std::unique_ptr<P4TableMapperMock> p4_table_mapper_mock_;
+  std::unique_ptr<BcmTableManager> bcm_table_manager_;
+};
+
+void BM_FillBcmFlowEntry(benchmark::State& state) {
+  BcmTableManagerFixture fixture(0);
+  const ::p4::v1::TableEntry entry = RouteEntry(1);
+  BcmFlowEntry bcm_flow_entry;
+  CHECK_OK(fixture.bcm_table_manager()->FillBcmFlowEntry(
+      entry, ::p4::v1::Update::INSERT, &bcm_flow_entry));
+  for (auto _ : state) {
+    bcm_flow_entry.Clear();
+    ::util::Status status = fixture.bcm_table_manager()->FillBcmFlowEntry(
+        entry, ::p4::v1::Update::INSERT, &bcm_flow_entry);
+    benchmark::DoNotOptimize(status);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FillBcmFlowEntry);
+
+// Adds and deletes an entry in a table with state.range(0) entries.
+void BM_AddDeleteTableEntry(benchmark::State& state) {
+  BcmTableManagerFixture fixture(state.range(0));
+  const ::p4::v1::TableEntry entry = RouteEntry(state.range(0));
+  for (auto _ : state) {
+    CHECK_OK(fixture.bcm_table_manager()->AddTableEntry(entry));
+    CHECK_OK(fixture.bcm_table_manager()->DeleteTableEntry(entry));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AddDeleteTableEntry)->Range(16, 16 << 10);
+
+// Reads all the entries of a table with state.range(0) entries.
+void BM_ReadTableEntries(benchmark::State& state) {
+  BcmTableManagerFixture fixture(state.range(0));
+  const std::set<uint32> table_ids = {kTableId};
+  for (auto _ : state) {
+    ::p4::v1::ReadResponse resp;
+    std::vector<::p4::v1::TableEntry*> acl_flows;
+    CHECK_OK(fixture.bcm_table_manager()->ReadTableEntries(table_ids, &resp,
+                                                           &acl_flows));
+    benchmark::DoNotOptimize(resp);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReadTableEntries)->Range(16, 16 << 10);
+
+}  // namespace
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
+
+BENCHMARK_MAIN();
@@ -0,0 +1,86 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks measuring Channel<T> throughput, for the small messages used for
+// events (e.g. linkscan) and the packet sized ones used for packet I/O.
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "benchmark/benchmark.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/lib/channel/channel.h"
+#include "absl/time/time.h"
+
+namespace stratum {
+namespace {
+
+// Size of the packet like messages.
+constexpr int kPacketSize = 256;
+
+// Writes and then reads back a message in the same thread, i.e. the cost of a
+// message going through an uncontended Channel.
+template <typename T>
+void ChannelWriteRead(benchmark::State& state, const T& message) {
+  std::shared_ptr<Channel<T>> channel = Channel<T>::Create(state.range(0));
+  auto writer = ChannelWriter<T>::Create(channel);
+  auto reader = ChannelReader<T>::Create(channel);
+  T read_message;
+  for (auto _ : state) {
+    CHECK_OK(writer->TryWrite(message));
+    CHECK_OK(reader->Read(&read_message, absl::InfiniteDuration()));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ChannelWriteReadInt(benchmark::State& state) {
+  ChannelWriteRead<int>(state, 42);
+}
+BENCHMARK(BM_ChannelWriteReadInt)->Arg(1)->Arg(128);
+
+void BM_ChannelWriteReadPacket(benchmark::State& state) {
+  ChannelWriteRead<std::string>(state, std::string(kPacketSize, 'x'));
+}
+BENCHMARK(BM_ChannelWriteReadPacket)->Arg(1)->Arg(128);
+
+// A writer thread keeps the Channel full while the benchmark thread reads from
+// it, i.e. the cost of a message going through a contended Channel.
+void BM_ChannelProducerConsumer(benchmark::State& state) {
+  std::shared_ptr<Channel<std::string>> channel =
+      Channel<std::string>::Create(state.range(0));
+  auto reader = ChannelReader<std::string>::Create(channel);
+  std::thread producer([channel]() {
+    auto writer = ChannelWriter<std::string>::Create(channel);
+    const std::string packet(kPacketSize, 'x');
+    // Write() fails once the Channel is closed.
+    while (writer->Write(packet, absl::InfiniteDuration()).ok()) {
+    }
+  });
+  std::string packet;
+  for (auto _ : state) {
+    CHECK_OK(reader->Read(&packet, absl::InfiniteDuration()));
+  }
+  channel->Close();
+  producer.join();
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * kPacketSize);
+}
+BENCHMARK(BM_ChannelProducerConsumer)->Arg(1)->Arg(128)->UseRealTime();
+
+}  // namespace
+}  // namespace stratum
+
+BENCHMARK_MAIN();
@@ -0,0 +1,144 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks measuring the DummyTableStore, i.e. the P4Runtime Write and Read
+// work done by stratum_dummy, with tables holding up to millions of entries.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "p4/config/v1/p4info.pb.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/dummy/dummy_table_store.h"
+#include "stratum/lib/utils.h"
+
+namespace stratum {
+namespace hal {
+namespace dummy_switch {
+namespace {
+
+constexpr uint32 kTableId = 33554433;
+constexpr uint32 kActionId = 16777217;
+
+constexpr char kP4Info[] = R"PROTO(
+  tables {
+    preamble { id: 33554433 name: "routes" }
+    match_fields { id: 1 name: "vrf" bitwidth: 16 match_type: EXACT }
+    match_fields { id: 2 name: "ipv4_dst" bitwidth: 32 match_type: LPM }
+    action_refs { id: 16777217 }
+  }
+  actions {
+    preamble { id: 16777217 name: "set_nexthop" }
+    params { id: 1 name: "nexthop" bitwidth: 32 }
+  }
+)PROTO";
+
+// Returns a big-endian encoding of 'value' in 'width' bytes.
+std::string Bytes(uint64 value, int width) {
+  std::string bytes(width, '\0');
+  for (int i = width - 1; i >= 0 && value != 0; --i, value >>= 8) {
+    bytes[i] = static_cast<char>(value & 0xff);
+  }
+  return bytes;
+}
+
+// Returns an IPv4 route like entry.
+::p4::v1::TableEntry RouteEntry(int i) {
+  ::p4::v1::TableEntry entry;
+  entry.set_table_id(kTableId);
+  auto* match = entry.add_match();
+  match->set_field_id(1);
+  match->mutable_exact()->set_value(Bytes(10, 2));
+  match = entry.add_match();
+  match->set_field_id(2);
+  match->mutable_lpm()->set_value(Bytes(0x0a000000 + (i << 8), 4));
+  match->mutable_lpm()->set_prefix_len(24);
+  auto* action = entry.mutable_action()->mutable_action();
+  action->set_action_id(kActionId);
+  auto* param = action->add_params();
+  param->set_param_id(1);
+  param->set_value(Bytes(i, 4));
+  return entry;
+}
+
+// Returns a DummyTableStore with the given number of route entries.
+std::unique_ptr<DummyTableStore> CreateTableStore(int num_entries) {
+  auto table_store = DummyTableStore::CreateInstance();
+  ::p4::config::v1::P4Info p4_info;
+  CHECK_OK(ParseProtoFromString(kP4Info, &p4_info));
+  CHECK_OK(table_store->PushP4Info(p4_info));
+  // Write the entries in batches, as a controller would.
+  constexpr int kBatchSize = 1000;
+  for (int i = 0; i < num_entries; i += kBatchSize) {
+    ::p4::v1::WriteRequest req;
+    for (int j = i; j < std::min(i + kBatchSize, num_entries); ++j) {
+      auto* update = req.add_updates();
+      update->set_type(::p4::v1::Update::INSERT);
+      *update->mutable_entity()->mutable_table_entry() = RouteEntry(j);
+    }
+    std::vector<::util::Status> results;
+    CHECK_OK(table_store->Write(req, &results));
+  }
+  return table_store;
+}
+
+// Looks up entries in a table with state.range(0) entries.
+void BM_LookupTableEntry(benchmark::State& state) {
+  const int num_entries = state.range(0);
+  auto table_store = CreateTableStore(num_entries);
+  std::vector<::p4::v1::TableEntry> keys;
+  for (int i = 0; i < 1024; ++i) {
+    keys.push_back(RouteEntry((i * 7919) % num_entries));
+    keys.back().clear_action();
+  }
+  int i = 0;
+  for (auto _ : state) {
+    auto entry = table_store->LookupTableEntry(keys[i++ % keys.size()]);
+    benchmark::DoNotOptimize(entry);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LookupTableEntry)->Range(1 << 10, 1 << 20);
+
+// Inserts and deletes an entry in a table with state.range(0) entries.
+void BM_InsertDeleteTableEntry(benchmark::State& state) {
+  auto table_store = CreateTableStore(state.range(0));
+  ::p4::v1::WriteRequest insert;
+  auto* update = insert.add_updates();
+  update->set_type(::p4::v1::Update::INSERT);
+  *update->mutable_entity()->mutable_table_entry() =
+      RouteEntry(state.range(0));
+  ::p4::v1::WriteRequest del = insert;
+  del.mutable_updates(0)->set_type(::p4::v1::Update::DELETE);
+  std::vector<::util::Status> results;
+  for (auto _ : state) {
+    results.clear();
+    CHECK_OK(table_store->Write(insert, &results));
+    CHECK_OK(table_store->Write(del, &results));
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_InsertDeleteTableEntry)->Range(1 << 10, 1 << 20);
+
+}  // namespace
+}  // namespace dummy_switch
+}  // namespace hal
+}  // namespace stratum
+
+BENCHMARK_MAIN();
@@ -0,0 +1,214 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks measuring IPAddress and IPRange parsing, printing and subnet
+// matching, as done when handling routes and gNMI interface addresses, and the
+// IPRangeTrie route lookups and updates.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/net_util/ip_range_trie.h"
+#include "stratum/glue/net_util/ipaddress.h"
+#include "absl/strings/str_cat.h"
+
+namespace stratum {
+namespace {
+
+// Number of distinct addresses each benchmark cycles through.
+constexpr int kNumAddresses = 1024;
+
+std::vector<std::string> Ipv4Strings() {
+  std::vector<std::string> strings;
+  for (int i = 0; i < kNumAddresses; ++i) {
+    strings.push_back(absl::StrCat("10.", i / 256, ".", i % 256, ".1"));
+  }
+  return strings;
+}
+
+std::vector<std::string> Ipv6Strings() {
+  std::vector<std::string> strings;
+  for (int i = 0; i < kNumAddresses; ++i) {
+    strings.push_back(absl::StrCat("2001:db8:", absl::Hex(i), "::1"));
+  }
+  return strings;
+}
+
+// Parses the given strings as addresses in a loop.
+void ParseAddresses(benchmark::State& state,
+                    const std::vector<std::string>& strings) {
+  IPAddress ip;
+  size_t i = 0;
+  for (auto _ : state) {
+    bool ok = StringToIPAddress(strings[i], &ip);
+    benchmark::DoNotOptimize(ok);
+    if (++i == strings.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_StringToIPAddressV4(benchmark::State& state) {
+  ParseAddresses(state, Ipv4Strings());
+}
+BENCHMARK(BM_StringToIPAddressV4);
+
+void BM_StringToIPAddressV6(benchmark::State& state) {
+  ParseAddresses(state, Ipv6Strings());
+}
+BENCHMARK(BM_StringToIPAddressV6);
+
+void BM_StringToIPRangeV4(benchmark::State& state) {
+  std::vector<std::string> strings;
+  for (int i = 0; i < kNumAddresses; ++i) {
+    strings.push_back(absl::StrCat("10.", i / 256, ".", i % 256, ".0/24"));
+  }
+  IPRange range;
+  size_t i = 0;
+  for (auto _ : state) {
+    bool ok = StringToIPRange(strings[i], &range);
+    benchmark::DoNotOptimize(ok);
+    if (++i == strings.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StringToIPRangeV4);
+
+void BM_StringToIPRangeV6(benchmark::State& state) {
+  std::vector<std::string> strings;
+  for (int i = 0; i < kNumAddresses; ++i) {
+    strings.push_back(absl::StrCat("2001:db8:", absl::Hex(i), "::/48"));
+  }
+  IPRange range;
+  size_t i = 0;
+  for (auto _ : state) {
+    bool ok = StringToIPRange(strings[i], &range);
+    benchmark::DoNotOptimize(ok);
+    if (++i == strings.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StringToIPRangeV6);
+
+void BM_IPAddressToString(benchmark::State& state) {
+  std::vector<IPAddress> addresses;
+  for (const auto& s : Ipv6Strings()) {
+    addresses.push_back(StringToIPAddressOrDie(s));
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    std::string s = addresses[i].ToString();
+    benchmark::DoNotOptimize(s);
+    if (++i == addresses.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IPAddressToString);
+
+void BM_IsWithinSubnet(benchmark::State& state) {
+  const IPRange range = StringToIPRangeOrDie("10.0.0.0/14");
+  std::vector<IPAddress> addresses;
+  for (const auto& s : Ipv4Strings()) {
+    addresses.push_back(StringToIPAddressOrDie(s));
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    bool within = IsWithinSubnet(range, addresses[i]);
+    benchmark::DoNotOptimize(within);
+    if (++i == addresses.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IsWithinSubnet);
+
+// Returns random IPv4 routes, with the /16 to /24 prefixes most common in
+// routing tables (and a few shorter and host ones).
+std::vector<IPRange> RandomIpv4Routes(int num_routes, int seed) {
+  std::mt19937 rng(seed);
+  std::vector<IPRange> routes;
+  for (int i = 0; i < num_routes; ++i) {
+    int length = i % 16 == 0 ? 8 + rng() % 25 : 16 + rng() % 9;
+    routes.push_back(IPRange(HostUInt32ToIPAddress(rng()), length));
+  }
+  return routes;
+}
+
+// Returns random IPv6 routes, mostly /32 to /64 prefixes in 2000::/3.
+std::vector<IPRange> RandomIpv6Routes(int num_routes, int seed) {
+  std::mt19937_64 rng(seed);
+  std::vector<IPRange> routes;
+  for (int i = 0; i < num_routes; ++i) {
+    int length = i % 16 == 0 ? 128 : 32 + rng() % 33;
+    absl::uint128 bits =
+        absl::MakeUint128((rng() >> 3) | (uint64{1} << 61), rng());
+    routes.push_back(IPRange(UInt128ToIPAddress(bits), length));
+  }
+  return routes;
+}
+
+// Looks up addresses in a trie with the given routes. Half of the addresses
+// are in a route, half are taken from the other_routes (i.e. random).
+void LongestMatch(benchmark::State& state, const std::vector<IPRange>& routes,
+                  const std::vector<IPRange>& other_routes) {
+  IPRangeTrie<int> trie;
+  for (size_t i = 0; i < routes.size(); ++i) trie.Insert(routes[i], i);
+  std::vector<IPAddress> addresses;
+  for (int i = 0; i < kNumAddresses; ++i) {
+    addresses.push_back(i % 2 == 0 ? routes[i % routes.size()].host()
+                                   : other_routes[i].host());
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    const int* route = trie.LongestMatch(addresses[i]);
+    benchmark::DoNotOptimize(route);
+    if (++i == addresses.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["bytes_per_route"] =
+      static_cast<double>(trie.MemoryUsage()) / routes.size();
+}
+
+void BM_IPRangeTrieLongestMatchV4(benchmark::State& state) {
+  LongestMatch(state, RandomIpv4Routes(state.range(0), 42),
+               RandomIpv4Routes(kNumAddresses, 7));
+}
+BENCHMARK(BM_IPRangeTrieLongestMatchV4)->Range(1 << 10, 1 << 20);
+
+void BM_IPRangeTrieLongestMatchV6(benchmark::State& state) {
+  LongestMatch(state, RandomIpv6Routes(state.range(0), 42),
+               RandomIpv6Routes(kNumAddresses, 7));
+}
+BENCHMARK(BM_IPRangeTrieLongestMatchV6)->Range(1 << 10, 1 << 18);
+
+// Inserts and removes a route in a trie with state.range(0) routes, as done
+// for every L3 flow write.
+void BM_IPRangeTrieInsertRemove(benchmark::State& state) {
+  const std::vector<IPRange> routes = RandomIpv4Routes(state.range(0) + 1, 42);
+  IPRangeTrie<int> trie;
+  for (size_t i = 1; i < routes.size(); ++i) trie.Insert(routes[i], i);
+  for (auto _ : state) {
+    trie.Insert(routes[0], 0);
+    trie.Remove(routes[0]);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IPRangeTrieInsertRemove)->Range(1 << 10, 1 << 20);
+
+}  // namespace
+}  // namespace stratum
+
+BENCHMARK_MAIN();
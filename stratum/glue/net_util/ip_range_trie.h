@@ -0,0 +1,495 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// IPRangeTrie<T> maps IPRanges (prefixes) to values of type T and answers the
+// routing style queries on them:
+//
+//  * LongestMatch(address): the most specific prefix containing an address.
+//  * ForEachCoveredBy(range): every prefix equal to or more specific than a
+//    range, e.g. the routes shadowed by a less specific one.
+//  * ForEachCovering(range): every prefix equal to or less specific than a
+//    range, e.g. the routes a more specific one shadows.
+//
+// IPv4 and IPv6 prefixes are kept in two separate path compressed binary
+// (PATRICIA) tries. Each node stores the prefix bits as a native integer
+// (uint32 for IPv4, uint128 for IPv6) and the children as indices into a
+// node pool, so a trie with N prefixes holds at most 2N - 1 nodes of
+// 16 (IPv4) or 32 (IPv6) bytes plus sizeof(T), and a lookup visits at most
+// 33 (resp. 129) nodes but typically a lot less. Unlike multibit tries
+// (DIR-24-8, poptrie), inserts and removes are incremental and O(W), so the
+// trie can be kept in sync with the flows programmed on a switch.
+//
+// Example:
+//
+//   IPRangeTrie<int> routes;
+//   routes.Insert(StringToIPRangeOrDie("10.0.0.0/8"), 1);
+//   routes.Insert(StringToIPRangeOrDie("10.1.0.0/16"), 2);
+//   IPRange match;
+//   routes.LongestMatch(StringToIPAddressOrDie("10.1.2.3"), &match);  // 2
+//   // match is 10.1.0.0/16.
+//
+// T must be default constructible and copyable. IPRangeTrie is not
+// thread-safe, but concurrent const calls are safe.
+
+#ifndef STRATUM_GLUE_NET_UTIL_IP_RANGE_TRIE_H_
+#define STRATUM_GLUE_NET_UTIL_IP_RANGE_TRIE_H_
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/net_util/bits.h"
+#include "stratum/glue/net_util/ipaddress.h"
+
+namespace stratum {
+
+namespace ip_range_trie_internal {
+
+// Bit helpers for the key types of the tries. Bit 0 is the most significant
+// bit of the key, i.e. the first bit of the address.
+template <typename Key>
+struct KeyTraits;
+
+template <>
+struct KeyTraits<uint32> {
+  static constexpr int kBits = 32;
+  static uint32 Mask(int length) {
+    return length == 0 ? 0 : ~static_cast<uint32>(0) << (kBits - length);
+  }
+  static int Bit(uint32 key, int index) {
+    return (key >> (kBits - 1 - index)) & 1;
+  }
+  static int CountLeadingZeros(uint32 key) {
+    return key == 0 ? kBits : Bits::CountLeadingZeros32(key);
+  }
+};
+
+template <>
+struct KeyTraits<absl::uint128> {
+  static constexpr int kBits = 128;
+  static absl::uint128 Mask(int length) {
+    return length == 0 ? 0 : ~absl::uint128(0) << (kBits - length);
+  }
+  static int Bit(absl::uint128 key, int index) {
+    return absl::Uint128Low64(key >> (kBits - 1 - index)) & 1;
+  }
+  static int CountLeadingZeros(absl::uint128 key) {
+    return key == 0 ? kBits : Bits::CountLeadingZeros128(key);
+  }
+};
+
+// The path compressed binary trie for one key type. Prefixes are given as
+// (key, length) pairs, where the bits of key past length are zero.
+template <typename Key, typename T>
+class PrefixTrie {
+ public:
+  PrefixTrie() : root_(kNullNode), size_(0) {}
+
+  // Adds or replaces the value for the prefix. Returns true if the prefix was
+  // not in the trie before.
+  bool Insert(Key key, int length, const T& value) {
+    uint32 parent = kNullNode;
+    int side = 0;
+    uint32 index = root_;
+    while (index != kNullNode) {
+      const Node& node = nodes_[index];
+      int common =
+          CommonLength(node.key, key, std::min<int>(node.length, length));
+      if (common == node.length && common == length) {
+        // The prefix already has a node, possibly a glue one.
+        bool inserted = !node.has_value;
+        Node& mutable_node = nodes_[index];
+        mutable_node.value = value;
+        mutable_node.has_value = true;
+        if (inserted) ++size_;
+        return inserted;
+      }
+      if (common < node.length) {
+        // The node needs to be moved under a new node for either the new
+        // prefix (if it is a prefix of node) or the common part of both.
+        Key node_key = node.key;
+        uint32 split;
+        if (common == length) {
+          split = NewNode(key, length, &value);
+        } else {
+          split = NewNode(key & Traits::Mask(common), common, nullptr);
+          uint32 leaf = NewNode(key, length, &value);
+          nodes_[split].children[Traits::Bit(key, common)] = leaf;
+        }
+        nodes_[split].children[Traits::Bit(node_key, common)] = index;
+        Link(parent, side) = split;
+        ++size_;
+        return true;
+      }
+      // node is a prefix of the new prefix, keep going down.
+      parent = index;
+      side = Traits::Bit(key, node.length);
+      index = node.children[side];
+    }
+    Link(parent, side) = NewNode(key, length, &value);
+    ++size_;
+    return true;
+  }
+
+  // Removes the prefix. Returns false if the prefix was not in the trie.
+  bool Remove(Key key, int length) {
+    uint32 grand_parent = kNullNode, parent = kNullNode;
+    int parent_side = 0, side = 0;
+    uint32 index = root_;
+    while (index != kNullNode && nodes_[index].length < length) {
+      const Node& node = nodes_[index];
+      if ((key & Traits::Mask(node.length)) != node.key) return false;
+      grand_parent = parent;
+      parent_side = side;
+      parent = index;
+      side = Traits::Bit(key, node.length);
+      index = node.children[side];
+    }
+    if (index == kNullNode || nodes_[index].length != length ||
+        nodes_[index].key != key || !nodes_[index].has_value) {
+      return false;
+    }
+    Node& node = nodes_[index];
+    node.has_value = false;
+    node.value = T();
+    --size_;
+    if (node.children[0] != kNullNode && node.children[1] != kNullNode) {
+      return true;  // Still needed as a glue node.
+    }
+    uint32 child = node.children[0] != kNullNode ? node.children[0]
+                                                 : node.children[1];
+    Link(parent, side) = child;
+    FreeNode(index);
+    // A glue parent left with a single child is not needed anymore.
+    if (child == kNullNode && parent != kNullNode &&
+        !nodes_[parent].has_value) {
+      Link(grand_parent, parent_side) = nodes_[parent].children[1 - side];
+      FreeNode(parent);
+    }
+    return true;
+  }
+
+  // Returns the value of the exact prefix, or nullptr if not in the trie.
+  const T* Find(Key key, int length) const {
+    uint32 index = root_;
+    while (index != kNullNode) {
+      const Node& node = nodes_[index];
+      if (node.length >= length) {
+        return node.length == length && node.key == key && node.has_value
+                   ? &node.value
+                   : nullptr;
+      }
+      if ((key & Traits::Mask(node.length)) != node.key) return nullptr;
+      index = node.children[Traits::Bit(key, node.length)];
+    }
+    return nullptr;
+  }
+
+  // Returns the value of the longest prefix containing the full length key
+  // and sets match_length to its length, or returns nullptr if there is none.
+  const T* LongestMatch(Key key, int* match_length) const {
+    const Node* best = nullptr;
+    uint32 index = root_;
+    while (index != kNullNode) {
+      const Node& node = nodes_[index];
+      if ((key & Traits::Mask(node.length)) != node.key) break;
+      if (node.has_value) best = &node;
+      if (node.length == Traits::kBits) break;
+      index = node.children[Traits::Bit(key, node.length)];
+    }
+    if (best == nullptr) return nullptr;
+    if (match_length != nullptr) *match_length = best->length;
+    return &best->value;
+  }
+
+  // Calls fn(key, length, value) for the prefixes equal to or more specific
+  // than the given one, in address order (a prefix comes before the more
+  // specific ones).
+  template <typename Fn>
+  void ForEachCoveredBy(Key key, int length, Fn fn) const {
+    uint32 index = root_;
+    while (index != kNullNode) {
+      const Node& node = nodes_[index];
+      if (node.length >= length) {
+        if ((node.key & Traits::Mask(length)) == key) {
+          ForEachInSubtree(index, fn);
+        }
+        return;
+      }
+      if ((key & Traits::Mask(node.length)) != node.key) return;
+      index = node.children[Traits::Bit(key, node.length)];
+    }
+  }
+
+  // Calls fn(key, length, value) for the prefixes equal to or less specific
+  // than the given one, from the least to the most specific.
+  template <typename Fn>
+  void ForEachCovering(Key key, int length, Fn fn) const {
+    uint32 index = root_;
+    while (index != kNullNode) {
+      const Node& node = nodes_[index];
+      if (node.length > length ||
+          (key & Traits::Mask(node.length)) != node.key) {
+        return;
+      }
+      if (node.has_value) fn(node.key, node.length, node.value);
+      if (node.length == length) return;
+      index = node.children[Traits::Bit(key, node.length)];
+    }
+  }
+
+  void Clear() {
+    nodes_.clear();
+    free_nodes_.clear();
+    root_ = kNullNode;
+    size_ = 0;
+  }
+
+  size_t size() const { return size_; }
+
+  size_t MemoryUsage() const {
+    return nodes_.capacity() * sizeof(Node) +
+           free_nodes_.capacity() * sizeof(uint32);
+  }
+
+ private:
+  using Traits = KeyTraits<Key>;
+  static constexpr uint32 kNullNode = ~static_cast<uint32>(0);
+
+  struct Node {
+    Key key;
+    uint8 length;
+    bool has_value;
+    uint32 children[2];
+    T value;
+  };
+
+  // Returns the length of the common prefix of a and b, capped to max_length.
+  static int CommonLength(Key a, Key b, int max_length) {
+    return std::min(Traits::CountLeadingZeros(a ^ b), max_length);
+  }
+
+  // Returns the child link of parent on the given side, or the root link if
+  // parent is kNullNode.
+  uint32& Link(uint32 parent, int side) {
+    return parent == kNullNode ? root_ : nodes_[parent].children[side];
+  }
+
+  // Returns a new node for the prefix, holding value if given (glue node
+  // otherwise). May invalidate the references to the other nodes.
+  uint32 NewNode(Key key, int length, const T* value) {
+    uint32 index;
+    if (!free_nodes_.empty()) {
+      index = free_nodes_.back();
+      free_nodes_.pop_back();
+    } else {
+      index = nodes_.size();
+      nodes_.emplace_back();
+    }
+    Node& node = nodes_[index];
+    node.key = key;
+    node.length = length;
+    node.has_value = value != nullptr;
+    node.children[0] = node.children[1] = kNullNode;
+    node.value = value != nullptr ? *value : T();
+    return index;
+  }
+
+  void FreeNode(uint32 index) {
+    nodes_[index].value = T();
+    free_nodes_.push_back(index);
+  }
+
+  template <typename Fn>
+  void ForEachInSubtree(uint32 index, Fn& fn) const {
+    std::vector<uint32> stack = {index};
+    while (!stack.empty()) {
+      const Node& node = nodes_[stack.back()];
+      stack.pop_back();
+      if (node.has_value) fn(node.key, node.length, node.value);
+      if (node.children[1] != kNullNode) stack.push_back(node.children[1]);
+      if (node.children[0] != kNullNode) stack.push_back(node.children[0]);
+    }
+  }
+
+  // The node pool. Removed nodes are recycled through free_nodes_.
+  std::vector<Node> nodes_;
+  std::vector<uint32> free_nodes_;
+  uint32 root_;
+  // Number of prefixes (i.e. non glue nodes) in the trie.
+  size_t size_;
+};
+
+}  // namespace ip_range_trie_internal
+
+template <typename T>
+class IPRangeTrie {
+ public:
+  IPRangeTrie() {}
+
+  // Adds the range with the given value, or replaces the value if the range
+  // is already in the trie. Returns true if the range was not in the trie.
+  bool Insert(const IPRange& range, const T& value) {
+    switch (range.host().address_family()) {
+      case AF_INET:
+        return ipv4_.Insert(IPAddressToHostUInt32(range.host()),
+                            range.length(), value);
+      case AF_INET6:
+        return ipv6_.Insert(IPAddressToUInt128(range.host()), range.length(),
+                            value);
+      default:
+        LOG(DFATAL) << "Uninitialized IPRange given to IPRangeTrie::Insert.";
+        return false;
+    }
+  }
+
+  // Removes the range. Returns false if the range was not in the trie.
+  bool Remove(const IPRange& range) {
+    switch (range.host().address_family()) {
+      case AF_INET:
+        return ipv4_.Remove(IPAddressToHostUInt32(range.host()),
+                            range.length());
+      case AF_INET6:
+        return ipv6_.Remove(IPAddressToUInt128(range.host()), range.length());
+      default:
+        return false;
+    }
+  }
+
+  // Returns the value of the exact range, or nullptr if it is not in the
+  // trie. The pointer is invalidated by the next Insert or Remove.
+  const T* Find(const IPRange& range) const {
+    switch (range.host().address_family()) {
+      case AF_INET:
+        return ipv4_.Find(IPAddressToHostUInt32(range.host()), range.length());
+      case AF_INET6:
+        return ipv6_.Find(IPAddressToUInt128(range.host()), range.length());
+      default:
+        return nullptr;
+    }
+  }
+
+  // Returns the value of the most specific range containing the address, or
+  // nullptr if there is none. If 'match' is given, it is set to that range.
+  // The pointer is invalidated by the next Insert or Remove.
+  const T* LongestMatch(const IPAddress& address,
+                        IPRange* match = nullptr) const {
+    int length = 0;
+    const T* value = nullptr;
+    switch (address.address_family()) {
+      case AF_INET:
+        value = ipv4_.LongestMatch(IPAddressToHostUInt32(address), &length);
+        break;
+      case AF_INET6:
+        value = ipv6_.LongestMatch(IPAddressToUInt128(address), &length);
+        break;
+      default:
+        return nullptr;
+    }
+    if (value != nullptr && match != nullptr) *match = IPRange(address, length);
+    return value;
+  }
+
+  // Calls fn(const IPRange&, const T&) for each range equal to or more
+  // specific than the given one (i.e. covered by it), in address order.
+  template <typename Fn>
+  void ForEachCoveredBy(const IPRange& range, Fn fn) const {
+    switch (range.host().address_family()) {
+      case AF_INET:
+        ipv4_.ForEachCoveredBy(IPAddressToHostUInt32(range.host()),
+                               range.length(), Ipv4Visitor<Fn>{&fn});
+        break;
+      case AF_INET6:
+        ipv6_.ForEachCoveredBy(IPAddressToUInt128(range.host()),
+                               range.length(), Ipv6Visitor<Fn>{&fn});
+        break;
+      default:
+        break;
+    }
+  }
+
+  // Calls fn(const IPRange&, const T&) for each range equal to or less
+  // specific than the given one (i.e. covering it), from the least to the
+  // most specific.
+  template <typename Fn>
+  void ForEachCovering(const IPRange& range, Fn fn) const {
+    switch (range.host().address_family()) {
+      case AF_INET:
+        ipv4_.ForEachCovering(IPAddressToHostUInt32(range.host()),
+                              range.length(), Ipv4Visitor<Fn>{&fn});
+        break;
+      case AF_INET6:
+        ipv6_.ForEachCovering(IPAddressToUInt128(range.host()),
+                              range.length(), Ipv6Visitor<Fn>{&fn});
+        break;
+      default:
+        break;
+    }
+  }
+
+  // Calls fn(const IPRange&, const T&) for all the ranges, IPv4 first, in
+  // address order.
+  template <typename Fn>
+  void ForEach(Fn fn) const {
+    ipv4_.ForEachCoveredBy(0, 0, Ipv4Visitor<Fn>{&fn});
+    ipv6_.ForEachCoveredBy(0, 0, Ipv6Visitor<Fn>{&fn});
+  }
+
+  void Clear() {
+    ipv4_.Clear();
+    ipv6_.Clear();
+  }
+
+  size_t size() const { return ipv4_.size() + ipv6_.size(); }
+  bool empty() const { return size() == 0; }
+
+  // Returns the approximate number of bytes allocated by the trie.
+  size_t MemoryUsage() const {
+    return ipv4_.MemoryUsage() + ipv6_.MemoryUsage();
+  }
+
+ private:
+  // Adapters turning the (key, length, value) callbacks of the internal
+  // tries into the (IPRange, value) ones of the public API.
+  template <typename Fn>
+  struct Ipv4Visitor {
+    Fn* fn;
+    void operator()(uint32 key, int length, const T& value) const {
+      (*fn)(IPRange::UnsafeConstruct(HostUInt32ToIPAddress(key), length),
+            value);
+    }
+  };
+  template <typename Fn>
+  struct Ipv6Visitor {
+    Fn* fn;
+    void operator()(absl::uint128 key, int length, const T& value) const {
+      (*fn)(IPRange::UnsafeConstruct(UInt128ToIPAddress(key), length), value);
+    }
+  };
+
+  ip_range_trie_internal::PrefixTrie<uint32, T> ipv4_;
+  ip_range_trie_internal::PrefixTrie<absl::uint128, T> ipv6_;
+};
+
+}  // namespace stratum
+
+#endif  // STRATUM_GLUE_NET_UTIL_IP_RANGE_TRIE_H_
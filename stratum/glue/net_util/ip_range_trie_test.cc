@@ -0,0 +1,241 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "stratum/glue/net_util/ip_range_trie.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/net_util/ipaddress.h"
+
+namespace stratum {
+namespace {
+
+using RangeList = std::vector<std::pair<std::string, int>>;
+
+IPRange Range(const std::string& str) { return StringToIPRangeOrDie(str); }
+
+IPAddress Address(const std::string& str) {
+  return StringToIPAddressOrDie(str);
+}
+
+template <typename Fn>
+RangeList Collect(Fn for_each) {
+  RangeList ranges;
+  for_each([&ranges](const IPRange& range, int value) {
+    ranges.emplace_back(range.ToString(), value);
+  });
+  return ranges;
+}
+
+TEST(IPRangeTrieTest, Empty) {
+  IPRangeTrie<int> trie;
+  EXPECT_TRUE(trie.empty());
+  EXPECT_EQ(0, trie.size());
+  EXPECT_EQ(nullptr, trie.LongestMatch(Address("10.0.0.1")));
+  EXPECT_EQ(nullptr, trie.LongestMatch(Address("2001:db8::1")));
+  EXPECT_EQ(nullptr, trie.Find(Range("0.0.0.0/0")));
+  EXPECT_FALSE(trie.Remove(Range("10.0.0.0/8")));
+}
+
+TEST(IPRangeTrieTest, InsertFindRemove) {
+  IPRangeTrie<int> trie;
+  EXPECT_TRUE(trie.Insert(Range("10.0.0.0/8"), 1));
+  EXPECT_TRUE(trie.Insert(Range("10.1.0.0/16"), 2));
+  EXPECT_TRUE(trie.Insert(Range("2001:db8::/32"), 3));
+  EXPECT_FALSE(trie.Insert(Range("10.1.0.0/16"), 4));
+  EXPECT_EQ(3, trie.size());
+
+  ASSERT_NE(nullptr, trie.Find(Range("10.1.0.0/16")));
+  EXPECT_EQ(4, *trie.Find(Range("10.1.0.0/16")));
+  EXPECT_EQ(nullptr, trie.Find(Range("10.0.0.0/9")));
+  EXPECT_EQ(nullptr, trie.Find(Range("10.1.0.0/24")));
+  // Same bits, different family.
+  EXPECT_EQ(nullptr, trie.Find(Range("a00::/8")));
+
+  EXPECT_TRUE(trie.Remove(Range("10.0.0.0/8")));
+  EXPECT_FALSE(trie.Remove(Range("10.0.0.0/8")));
+  EXPECT_EQ(nullptr, trie.Find(Range("10.0.0.0/8")));
+  EXPECT_EQ(2, trie.size());
+
+  trie.Clear();
+  EXPECT_TRUE(trie.empty());
+  EXPECT_EQ(nullptr, trie.Find(Range("2001:db8::/32")));
+}
+
+TEST(IPRangeTrieTest, LongestMatch) {
+  IPRangeTrie<int> trie;
+  trie.Insert(Range("0.0.0.0/0"), 0);
+  trie.Insert(Range("10.0.0.0/8"), 8);
+  trie.Insert(Range("10.1.0.0/16"), 16);
+  trie.Insert(Range("10.1.2.3/32"), 32);
+  trie.Insert(Range("2001:db8::/32"), 132);
+  trie.Insert(Range("2001:db8::1/128"), 228);
+
+  IPRange match;
+  ASSERT_NE(nullptr, trie.LongestMatch(Address("10.1.2.3"), &match));
+  EXPECT_EQ(32, *trie.LongestMatch(Address("10.1.2.3")));
+  EXPECT_EQ(Range("10.1.2.3/32"), match);
+  EXPECT_EQ(16, *trie.LongestMatch(Address("10.1.2.4"), &match));
+  EXPECT_EQ(Range("10.1.0.0/16"), match);
+  EXPECT_EQ(8, *trie.LongestMatch(Address("10.2.0.0")));
+  EXPECT_EQ(0, *trie.LongestMatch(Address("192.168.0.1"), &match));
+  EXPECT_EQ(Range("0.0.0.0/0"), match);
+
+  EXPECT_EQ(228, *trie.LongestMatch(Address("2001:db8::1")));
+  EXPECT_EQ(132, *trie.LongestMatch(Address("2001:db8::2")));
+  // No IPv6 default route.
+  EXPECT_EQ(nullptr, trie.LongestMatch(Address("2001:db9::1")));
+
+  trie.Remove(Range("10.1.0.0/16"));
+  EXPECT_EQ(8, *trie.LongestMatch(Address("10.1.2.4")));
+  EXPECT_EQ(32, *trie.LongestMatch(Address("10.1.2.3")));
+}
+
+TEST(IPRangeTrieTest, ForEachCoveredBy) {
+  IPRangeTrie<int> trie;
+  trie.Insert(Range("10.1.2.0/24"), 3);
+  trie.Insert(Range("10.0.0.0/8"), 1);
+  trie.Insert(Range("10.1.0.0/16"), 2);
+  trie.Insert(Range("10.128.0.0/9"), 4);
+  trie.Insert(Range("11.0.0.0/8"), 5);
+  trie.Insert(Range("2001:db8::/32"), 6);
+
+  RangeList expected = {{"10.0.0.0/8", 1},
+                        {"10.1.0.0/16", 2},
+                        {"10.1.2.0/24", 3},
+                        {"10.128.0.0/9", 4}};
+  EXPECT_EQ(expected, Collect([&trie](auto fn) {
+              trie.ForEachCoveredBy(Range("10.0.0.0/8"), fn);
+            }));
+  expected = {{"10.1.0.0/16", 2}, {"10.1.2.0/24", 3}};
+  EXPECT_EQ(expected, Collect([&trie](auto fn) {
+              trie.ForEachCoveredBy(Range("10.0.0.0/12"), fn);
+            }));
+  expected = {};
+  EXPECT_EQ(expected, Collect([&trie](auto fn) {
+              trie.ForEachCoveredBy(Range("12.0.0.0/8"), fn);
+            }));
+  expected = {{"10.0.0.0/8", 1},   {"10.1.0.0/16", 2}, {"10.1.2.0/24", 3},
+              {"10.128.0.0/9", 4}, {"11.0.0.0/8", 5},  {"2001:db8::/32", 6}};
+  EXPECT_EQ(expected, Collect([&trie](auto fn) { trie.ForEach(fn); }));
+}
+
+TEST(IPRangeTrieTest, ForEachCovering) {
+  IPRangeTrie<int> trie;
+  trie.Insert(Range("10.0.0.0/8"), 1);
+  trie.Insert(Range("10.1.0.0/16"), 2);
+  trie.Insert(Range("10.1.2.0/24"), 3);
+  trie.Insert(Range("10.2.0.0/16"), 4);
+
+  RangeList expected = {{"10.0.0.0/8", 1}, {"10.1.0.0/16", 2}};
+  EXPECT_EQ(expected, Collect([&trie](auto fn) {
+              trie.ForEachCovering(Range("10.1.128.0/17"), fn);
+            }));
+  expected = {{"10.0.0.0/8", 1}, {"10.1.0.0/16", 2}, {"10.1.2.0/24", 3}};
+  EXPECT_EQ(expected, Collect([&trie](auto fn) {
+              trie.ForEachCovering(Range("10.1.2.0/24"), fn);
+            }));
+  expected = {};
+  EXPECT_EQ(expected, Collect([&trie](auto fn) {
+              trie.ForEachCovering(Range("2001:db8::/32"), fn);
+            }));
+}
+
+// Compares the trie to a brute force search over random prefixes, while
+// inserting and removing them.
+TEST(IPRangeTrieTest, MatchesBruteForce) {
+  std::mt19937 rng(42);
+  auto random_range = [&rng](bool ipv6) {
+    // Use few distinct high bits so that the prefixes overlap a lot.
+    if (ipv6) {
+      absl::uint128 bits =
+          absl::MakeUint128(uint64{rng() % 16} << 60 | rng(), rng());
+      return IPRange(UInt128ToIPAddress(bits), rng() % 129);
+    }
+    uint32 bits = (rng() % 16) << 28 | (rng() & 0x00ffffff);
+    return IPRange(HostUInt32ToIPAddress(bits), rng() % 33);
+  };
+  IPRangeTrie<int> trie;
+  std::vector<std::pair<IPRange, int>> reference;
+  auto find = [&reference](const IPRange& range) {
+    return std::find_if(reference.begin(), reference.end(),
+                        [&range](const std::pair<IPRange, int>& e) {
+                          return e.first == range;
+                        });
+  };
+  for (int i = 0; i < 4000; ++i) {
+    IPRange range = random_range(i % 2);
+    if (rng() % 3 == 0 && !reference.empty()) {
+      // Remove an existing range.
+      auto it = reference.begin() + rng() % reference.size();
+      ASSERT_TRUE(trie.Remove(it->first)) << it->first;
+      reference.erase(it);
+    } else {
+      auto it = find(range);
+      ASSERT_EQ(it == reference.end(), trie.Insert(range, i)) << range;
+      if (it == reference.end()) {
+        reference.emplace_back(range, i);
+      } else {
+        it->second = i;
+      }
+    }
+    ASSERT_EQ(reference.size(), trie.size());
+
+    IPAddress address = random_range(i % 2).host();
+    const std::pair<IPRange, int>* best = nullptr;
+    for (const auto& e : reference) {
+      if (IsWithinSubnet(e.first, address) &&
+          (best == nullptr || e.first.length() > best->first.length())) {
+        best = &e;
+      }
+    }
+    IPRange match;
+    const int* value = trie.LongestMatch(address, &match);
+    if (best == nullptr) {
+      ASSERT_EQ(nullptr, value) << address;
+    } else {
+      ASSERT_NE(nullptr, value) << address;
+      EXPECT_EQ(best->second, *value) << address;
+      EXPECT_EQ(best->first, match) << address;
+    }
+
+    int num_covered = 0;
+    trie.ForEachCoveredBy(range, [&](const IPRange& r, int value) {
+      auto it = find(r);
+      ASSERT_NE(reference.end(), it) << r;
+      EXPECT_TRUE(IsProperSubRange(range, r) || range == r) << r;
+      EXPECT_EQ(it->second, value);
+      ++num_covered;
+    });
+    int expected_covered = 0;
+    for (const auto& e : reference) {
+      if (IsProperSubRange(range, e.first) || range == e.first) {
+        ++expected_covered;
+      }
+    }
+    EXPECT_EQ(expected_covered, num_covered) << range;
+  }
+  for (const auto& e : reference) ASSERT_TRUE(trie.Remove(e.first));
+  EXPECT_TRUE(trie.empty());
+}
+
+}  // namespace
+}  // namespace stratum
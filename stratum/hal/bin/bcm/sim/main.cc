@@ -27,11 +27,13 @@
 #include "stratum/hal/lib/bcm/bcm_node.h"
 #include "stratum/hal/lib/bcm/bcm_packetio_manager.h"
 #include "stratum/hal/lib/bcm/bcm_sdk_sim.h"
+#include "stratum/hal/lib/bcm/bcm_sdk_tracer.h"
 #include "stratum/hal/lib/bcm/bcm_serdes_db_manager.h"
 #include "stratum/hal/lib/bcm/bcm_switch.h"
 #include "stratum/hal/lib/common/hal.h"
 #include "stratum/hal/lib/p4/p4_table_mapper.h"
 #include "stratum/hal/lib/phal/phal_sim.h"
+#include "stratum/lib/call_tracer.h"
 #include "stratum/lib/security/auth_policy_checker.h"
 #include "stratum/lib/security/credentials_manager.h"
 #include "absl/memory/memory.h"
@@ -43,6 +45,12 @@ DEFINE_string(
     "Path to look for BCMSIM or PCID binary.");
 DEFINE_int32(max_units, 1,
              "Maximum number of units supported on the switch platform.");
+DEFINE_bool(enable_bcm_sdk_tracing, false,
+            "Record all the BCM SDK calls from startup, to be dumped in the "
+            "Chrome trace-event JSON format through the gNMI "
+            "/debug/call-trace/chrome-trace leaf. Recording can be turned on "
+            "and off at runtime through the gNMI /debug/call-trace/enabled "
+            "leaf.");
 
 namespace stratum {
 namespace hal {
@@ -77,8 +85,11 @@ struct PerNodeInstances {
     bcm_packetio_manager = BcmPacketioManager::CreateInstance(
         OPERATION_MODE_SIM, bcm_chassis_manager, p4_table_mapper.get(),
         bcm_sdk_interface, unit);
+    // No BcmIdleTimeoutManager: the SDK cannot read the hit bits of the
+    // flows yet, so idle timeouts are not aged.
     bcm_node = BcmNode::CreateInstance(
-        bcm_acl_manager.get(), bcm_l2_manager.get(), bcm_l3_manager.get(),
+        bcm_acl_manager.get(), /*bcm_idle_timeout_manager=*/nullptr,
+        bcm_l2_manager.get(), bcm_l3_manager.get(),
         bcm_packetio_manager.get(), bcm_table_manager.get(),
         bcm_tunnel_manager.get(), p4_table_mapper.get(), unit);
   }
@@ -92,16 +103,22 @@ int Main(int argc, char** argv) {
 
   // Create chassis-wide and per-node class instances.
   auto* bcm_sdk_sim = BcmSdkSim::CreateSingleton(FLAGS_bcm_sdk_sim_bin);
+  // All the SDK calls made by the managers go through the tracer, which only
+  // records them while tracing is enabled.
+  CallTracer::Global()->Enable(FLAGS_enable_bcm_sdk_tracing);
+  auto bcm_sdk_tracer = BcmSdkTracer::CreateInstance(bcm_sdk_sim);
+  BcmSdkInterface* bcm_sdk_interface = bcm_sdk_tracer.get();
   auto* phal_sim = PhalSim::CreateSingleton();
   auto bcm_serdes_db_manager = BcmSerdesDbManager::CreateInstance();
   auto bcm_chassis_manager = BcmChassisManager::CreateInstance(
-      OPERATION_MODE_SIM, phal_sim, bcm_sdk_sim, bcm_serdes_db_manager.get());
+      OPERATION_MODE_SIM, phal_sim, bcm_sdk_interface,
+      bcm_serdes_db_manager.get());
   std::vector<PerNodeInstances> per_node_instances;
   std::map<int, BcmNode*> unit_to_bcm_node;
   // We assume BCM ASICs have unit numbers {0,...,FLAGS_max_units-1}.
   for (int unit = 0; unit < FLAGS_max_units; ++unit) {
-    per_node_instances.emplace_back(bcm_sdk_sim, bcm_chassis_manager.get(),
-                                    unit);
+    per_node_instances.emplace_back(bcm_sdk_interface,
+                                    bcm_chassis_manager.get(), unit);
     unit_to_bcm_node[unit] = per_node_instances[unit].bcm_node.get();
   }
   // Give BcmChassisManager the node map. This is needed to enable
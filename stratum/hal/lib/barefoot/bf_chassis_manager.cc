@@ -18,7 +18,9 @@
 #include <map>
 #include <memory>
 #include <utility>
+#include <vector>
 
+#include "gflags/gflags.h"
 #include "stratum/lib/constants.h"
 #include "stratum/lib/macros.h"
 #include "stratum/lib/utils.h"
@@ -36,6 +38,16 @@
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
 
+DEFINE_int32(bf_port_stats_refresh_interval_ms, 1000,
+             "Interval at which the counters of all the ports are read from "
+             "the SDE into a per-unit snapshot, which serves the port counters "
+             "requests. 0 disables the snapshots: every request then reads "
+             "the counters from the SDE.");
+DEFINE_int32(bf_port_stats_max_staleness_ms, 5000,
+             "Max age of a port counters snapshot. The counters are read from "
+             "the SDE when the snapshot of the unit is older, e.g. if a "
+             "refresh sweep is late.");
+
 namespace stratum {
 namespace hal {
 namespace barefoot {
@@ -59,7 +71,10 @@ BFChassisManager::BFChassisManager(PhalInterface* phal_interface,
       bf_pal_interface_(bf_pal_interface),
       unit_to_node_id_(),
       node_id_to_unit_(),
-      node_id_to_port_id_to_port_state_() {}
+      node_id_to_port_id_to_port_state_(),
+      port_stats_shutdown_(false),
+      unit_to_port_stats_(),
+      port_stats_cache_stats_() {}
 
 BFChassisManager::~BFChassisManager() = default;
 
@@ -316,6 +331,8 @@ BFChassisManager::~BFChassisManager() = default;
     }
   }
 
+  // Ports may have been deleted or re-added, and units renumbered.
+  InvalidatePortStats();
   unit_to_node_id_ = unit_to_node_id;
   node_id_to_unit_ = node_id_to_unit;
   node_id_to_port_id_to_port_state_ = node_id_to_port_id_to_port_state;
@@ -465,8 +482,90 @@ BFChassisManager::GetPortConfig(uint64 node_id, uint32 port_id) const {
     return MAKE_ERROR(ERR_NOT_INITIALIZED) << "Not initialized!";
   }
   ASSIGN_OR_RETURN(auto unit, GetUnitFromNodeId(node_id));
+  // gNMI requests every counter leaf separately, so the counters are served
+  // from the latest snapshot of the unit instead of reading the full stats of
+  // the port from the SDE for each leaf.
+  if (FLAGS_bf_port_stats_refresh_interval_ms > 0) {
+    absl::MutexLock l(&port_stats_lock_);
+    const auto* snapshot = gtl::FindOrNull(unit_to_port_stats_, unit);
+    if (snapshot != nullptr &&
+        absl::Now() - snapshot->timestamp <=
+            absl::Milliseconds(FLAGS_bf_port_stats_max_staleness_ms)) {
+      const auto* port_counters =
+          gtl::FindOrNull(snapshot->port_id_to_counters, port_id);
+      if (port_counters != nullptr) {
+        *counters = *port_counters;
+        port_stats_cache_stats_.hits++;
+        return ::util::OkStatus();
+      }
+    }
+    port_stats_cache_stats_.misses++;
+  }
   return bf_pal_interface_->PortAllStatsGet(unit, port_id, counters);
-  return ::util::OkStatus();
+}
+
+BFChassisManager::PortStatsCacheStats
+BFChassisManager::GetPortStatsCacheStats() const {
+  absl::MutexLock l(&port_stats_lock_);
+  return port_stats_cache_stats_;
+}
+
+void BFChassisManager::InvalidatePortStats() {
+  absl::MutexLock l(&port_stats_lock_);
+  unit_to_port_stats_.clear();
+}
+
+void BFChassisManager::RefreshPortStats() {
+  const absl::Duration interval =
+      absl::Milliseconds(FLAGS_bf_port_stats_refresh_interval_ms);
+  while (true) {
+    RefreshPortStatsOnce();
+    absl::MutexLock l(&port_stats_lock_);
+    if (port_stats_lock_.AwaitWithTimeout(
+            absl::Condition(&port_stats_shutdown_), interval)) {
+      break;
+    }
+  }
+}
+
+void BFChassisManager::RefreshPortStatsOnce() {
+  // The reader lock keeps the ports from being added or deleted during the
+  // sweep, as for the counters requests.
+  absl::ReaderMutexLock l(&chassis_lock);
+  if (!initialized_) return;
+  const absl::Time start = absl::Now();
+  std::map<int, PortStatsSnapshot> unit_to_port_stats;
+  uint64 errors = 0;
+  for (const auto& node_ports : node_id_to_port_id_to_port_config_) {
+    const int* unit = gtl::FindOrNull(node_id_to_unit_, node_ports.first);
+    if (unit == nullptr) continue;
+    auto& snapshot = unit_to_port_stats[*unit];
+    for (const auto& port : node_ports.second) {
+      // The port was not added successfully.
+      if (port.second.admin_state == ADMIN_STATE_UNKNOWN) continue;
+      PortCounters counters;
+      ::util::Status status =
+          bf_pal_interface_->PortAllStatsGet(*unit, port.first, &counters);
+      if (!status.ok()) {
+        VLOG(1) << "Failed to read the counters of port " << port.first
+                << " in node " << node_ports.first << ": " << status;
+        errors++;
+        continue;
+      }
+      snapshot.port_id_to_counters[port.first] = counters;
+    }
+    // All the ports of the unit share the time of the end of their sweep, so
+    // that the staleness bound holds for each of them.
+    snapshot.timestamp = absl::Now();
+  }
+  const absl::Time end = absl::Now();
+
+  absl::MutexLock l2(&port_stats_lock_);
+  unit_to_port_stats_ = std::move(unit_to_port_stats);
+  port_stats_cache_stats_.refreshes++;
+  port_stats_cache_stats_.refresh_errors += errors;
+  port_stats_cache_stats_.last_refresh_time = end;
+  port_stats_cache_stats_.last_refresh_duration = end - start;
 }
 
 ::util::StatusOr<std::map<uint64, int>> BFChassisManager::GetNodeIdToUnitMap()
@@ -485,6 +584,7 @@ BFChassisManager::GetPortConfig(uint64 node_id, uint32 port_id) const {
 
   for (auto& p : node_id_to_port_id_to_port_state_[node_id])
     p.second = PORT_STATE_UNKNOWN;
+  InvalidatePortStats();
 
   LOG(INFO) << "Replaying ports for node " << node_id << ".";
 
@@ -564,6 +664,7 @@ BFChassisManager::GetPortConfig(uint64 node_id, uint32 port_id) const {
     p.second = PortConfig();
   for (auto& p : *port_id_to_state)
     p.second = PORT_STATE_UNKNOWN;
+  InvalidatePortStats();
   return ::util::OkStatus();
 }
 
@@ -771,6 +872,16 @@ void BFChassisManager::TransceiverEventHandler(int slot, int port,
         << "Transceiver event handler already registered.";
   }
 
+  if (FLAGS_bf_port_stats_refresh_interval_ms > 0) {
+    {
+      absl::MutexLock l(&port_stats_lock_);
+      port_stats_shutdown_ = false;
+    }
+    // The first sweep waits for the chassis lock, i.e. for the end of the
+    // config push.
+    port_stats_thread_ = std::thread([this]() { this->RefreshPortStats(); });
+  }
+
   return ::util::OkStatus();
 }
 
@@ -804,6 +915,14 @@ void BFChassisManager::TransceiverEventHandler(int slot, int port,
   xcvr_event_thread_.join();
   xcvr_event_reader_ = nullptr;
   xcvr_event_channel_ = nullptr;
+
+  if (port_stats_thread_.joinable()) {
+    {
+      absl::MutexLock l(&port_stats_lock_);
+      port_stats_shutdown_ = true;
+    }
+    port_stats_thread_.join();
+  }
   return status;
 }
 
@@ -826,6 +945,7 @@ void BFChassisManager::CleanupInternalState() {
   node_id_to_port_id_to_port_config_.clear();
   node_id_to_port_id_to_singleton_port_key_.clear();
   xcvr_port_key_to_xcvr_state_.clear();
+  InvalidatePortStats();
 }
 
 ::util::Status BFChassisManager::Shutdown() {
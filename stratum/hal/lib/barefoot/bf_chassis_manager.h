@@ -31,6 +31,7 @@
 #include "absl/memory/memory.h"
 #include "absl/types/optional.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 
 namespace stratum {
 namespace hal {
@@ -83,6 +84,27 @@ class BFChassisManager {
   ::util::StatusOr<std::map<uint64, int>> GetNodeIdToUnitMap() const
       SHARED_LOCKS_REQUIRED(chassis_lock);
 
+  // Statistics of the port counters snapshots, see GetPortCounters().
+  struct PortStatsCacheStats {
+    uint64 refreshes;       // number of completed refresh sweeps
+    uint64 refresh_errors;  // number of ports which could not be read
+    uint64 hits;            // counters requests served from a snapshot
+    uint64 misses;          // counters requests served from the SDE
+    absl::Time last_refresh_time;
+    absl::Duration last_refresh_duration;
+
+    PortStatsCacheStats()
+        : refreshes(0),
+          refresh_errors(0),
+          hits(0),
+          misses(0),
+          last_refresh_time(absl::InfinitePast()),
+          last_refresh_duration(absl::ZeroDuration()) {}
+  };
+
+  PortStatsCacheStats GetPortStatsCacheStats() const
+      LOCKS_EXCLUDED(port_stats_lock_);
+
   // Factory function for creating the instance of the class.
   static std::unique_ptr<BFChassisManager> CreateInstance(
       PhalInterface* phal_interface,
@@ -104,6 +126,12 @@ class BFChassisManager {
   static constexpr int kMaxPortStatusChangeEventDepth = 1024;
   static constexpr int kMaxXcvrEventDepth = 1024;
 
+  // The counters of all the ports of a unit, read in a single sweep.
+  struct PortStatsSnapshot {
+    absl::Time timestamp;
+    std::map<uint32, PortCounters> port_id_to_counters;
+  };
+
   struct PortConfig {
     // ADMIN_STATE_UNKNOWN indicate that something went wrong during the port
     // configuration, and the port add wasn't event attempted or failed.
@@ -144,6 +172,18 @@ class BFChassisManager {
   // Thread function for reading and processing transceiver events.
   void ReadTransceiverEvents() LOCKS_EXCLUDED(chassis_lock);
 
+  // Thread function refreshing the port counters snapshots every
+  // bf_port_stats_refresh_interval_ms, until Shutdown() is called.
+  void RefreshPortStats() LOCKS_EXCLUDED(chassis_lock, port_stats_lock_);
+
+  // Reads the counters of all the configured ports and replaces the snapshot
+  // of each unit.
+  void RefreshPortStatsOnce() LOCKS_EXCLUDED(chassis_lock, port_stats_lock_);
+
+  // Drops all the port counters snapshots. Called whenever ports may be added,
+  // deleted or re-added, since their counters are reset by the SDE.
+  void InvalidatePortStats() LOCKS_EXCLUDED(port_stats_lock_);
+
   // Transceiver module insert/removal event handler. This method is executed by
   // ReadTransceiverEvents in the xcvr_event_thread_ thread which processes
   // transceiver module insert/removal events. Port is the 1-based frontpanel
@@ -185,6 +225,23 @@ class BFChassisManager {
 
   std::thread xcvr_event_thread_;
 
+  // Thread refreshing the port counters snapshots. Not started if
+  // bf_port_stats_refresh_interval_ms is 0.
+  std::thread port_stats_thread_;
+
+  // Lock protecting the port counters snapshots and their statistics. Acquired
+  // after chassis_lock when both are needed.
+  mutable absl::Mutex port_stats_lock_;
+
+  // Set to stop port_stats_thread_.
+  bool port_stats_shutdown_ GUARDED_BY(port_stats_lock_);
+
+  // Map from unit number to the latest snapshot of its port counters.
+  std::map<int, PortStatsSnapshot> unit_to_port_stats_
+      GUARDED_BY(port_stats_lock_);
+
+  PortStatsCacheStats port_stats_cache_stats_ GUARDED_BY(port_stats_lock_);
+
   // WriterInterface<GnmiEventPtr> object for sending event notifications.
   mutable absl::Mutex gnmi_event_lock_;
   std::shared_ptr<WriterInterface<GnmiEventPtr>> gnmi_event_writer_
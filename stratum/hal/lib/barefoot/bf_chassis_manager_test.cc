@@ -15,6 +15,7 @@
 
 #include "stratum/hal/lib/barefoot/bf_chassis_manager.h"
 
+#include "gflags/gflags.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "stratum/glue/integral_types.h"
@@ -25,13 +26,20 @@
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/phal_mock.h"
 #include "stratum/lib/constants.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
 
+DECLARE_int32(bf_port_stats_refresh_interval_ms);
+DECLARE_int32(bf_port_stats_max_staleness_ms);
+
+using ::gflags::FlagSaver;
 using ::testing::_;
 using ::testing::AtMost;
+using ::testing::DoAll;
 using ::testing::Matcher;
 using ::testing::Mock;
 using ::testing::Return;
+using ::testing::SetArgPointee;
 
 namespace stratum {
 namespace hal {
@@ -111,6 +119,8 @@ class BFChassisManagerTest : public ::testing::Test {
     bf_chassis_manager_ = BFChassisManager::CreateInstance(
         phal_mock_.get(), bf_pal_mock_.get());
     ON_CALL(*bf_pal_mock_, PortIsValid(_, _)).WillByDefault(Return(true));
+    ON_CALL(*bf_pal_mock_, PortAllStatsGet(_, _, _))
+        .WillByDefault(Return(::util::OkStatus()));
   }
 
   ::util::Status CheckCleanInternalState() {
@@ -188,6 +198,26 @@ class BFChassisManagerTest : public ::testing::Test {
     return bf_chassis_manager_->GetUnitFromNodeId(node_id);
   }
 
+  ::util::Status GetPortCounters(uint64 node_id, uint32 port_id,
+                                 PortCounters* counters) {
+    absl::ReaderMutexLock l(&chassis_lock);
+    return bf_chassis_manager_->GetPortCounters(node_id, port_id, counters);
+  }
+
+  BFChassisManager::PortStatsCacheStats GetPortStatsCacheStats() {
+    return bf_chassis_manager_->GetPortStatsCacheStats();
+  }
+
+  // Waits for the port counters snapshots to be refreshed at least once.
+  bool WaitForPortStatsRefresh() {
+    const absl::Time deadline = absl::Now() + absl::Seconds(10);
+    while (GetPortStatsCacheStats().refreshes == 0) {
+      if (absl::Now() > deadline) return false;
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+    return true;
+  }
+
   ::util::Status Shutdown() {
     return bf_chassis_manager_->Shutdown();
   }
@@ -209,6 +239,7 @@ class BFChassisManagerTest : public ::testing::Test {
         bf_chassis_manager_->xcvr_event_channel_);
   }
 
+  FlagSaver flag_saver_;
   std::unique_ptr<PhalMock> phal_mock_;
   std::unique_ptr<BFPalMock> bf_pal_mock_;
   std::unique_ptr<BFChassisManager> bf_chassis_manager_;
@@ -289,6 +320,91 @@ TEST_F(BFChassisManagerTest, TransceiverEvent) {
   ASSERT_OK(ShutdownAndTestCleanState());
 }
 
+TEST_F(BFChassisManagerTest, PortCountersFromSnapshot) {
+  FLAGS_bf_port_stats_refresh_interval_ms = 60000;
+  PortCounters sde_counters;
+  sde_counters.set_in_octets(1234);
+  sde_counters.set_out_unicast_pkts(56);
+  // Only the refresh sweep reads the counters from the SDE.
+  EXPECT_CALL(*bf_pal_mock_, PortAllStatsGet(kUnit, kPortId, _))
+      .WillOnce(DoAll(SetArgPointee<2>(sde_counters),
+                      Return(::util::OkStatus())));
+  ASSERT_OK(PushBaseChassisConfig());
+  ASSERT_TRUE(WaitForPortStatsRefresh());
+
+  for (int i = 0; i < 3; ++i) {
+    PortCounters counters;
+    ASSERT_OK(GetPortCounters(kNodeId, kPortId, &counters));
+    EXPECT_EQ(1234, counters.in_octets());
+    EXPECT_EQ(56, counters.out_unicast_pkts());
+  }
+  auto stats = GetPortStatsCacheStats();
+  EXPECT_EQ(1, stats.refreshes);
+  EXPECT_EQ(0, stats.refresh_errors);
+  EXPECT_EQ(3, stats.hits);
+  EXPECT_EQ(0, stats.misses);
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
+TEST_F(BFChassisManagerTest, StalePortCountersReadFromSde) {
+  FLAGS_bf_port_stats_refresh_interval_ms = 60000;
+  FLAGS_bf_port_stats_max_staleness_ms = 1;
+  PortCounters sde_counters;
+  sde_counters.set_in_octets(1234);
+  EXPECT_CALL(*bf_pal_mock_, PortAllStatsGet(kUnit, kPortId, _))
+      .Times(2)
+      .WillRepeatedly(DoAll(SetArgPointee<2>(sde_counters),
+                            Return(::util::OkStatus())));
+  ASSERT_OK(PushBaseChassisConfig());
+  ASSERT_TRUE(WaitForPortStatsRefresh());
+  absl::SleepFor(absl::Milliseconds(5));
+
+  PortCounters counters;
+  ASSERT_OK(GetPortCounters(kNodeId, kPortId, &counters));
+  EXPECT_EQ(1234, counters.in_octets());
+  auto stats = GetPortStatsCacheStats();
+  EXPECT_EQ(0, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
+TEST_F(BFChassisManagerTest, PortStatsRefreshErrors) {
+  FLAGS_bf_port_stats_refresh_interval_ms = 60000;
+  EXPECT_CALL(*bf_pal_mock_, PortAllStatsGet(kUnit, kPortId, _))
+      .WillOnce(Return(::util::Status(StratumErrorSpace(), ERR_INTERNAL,
+                                      "Stats error")))
+      .WillOnce(Return(::util::OkStatus()));
+  ASSERT_OK(PushBaseChassisConfig());
+  ASSERT_TRUE(WaitForPortStatsRefresh());
+
+  // The port is missing from the snapshot, so its counters are read from the
+  // SDE.
+  PortCounters counters;
+  ASSERT_OK(GetPortCounters(kNodeId, kPortId, &counters));
+  auto stats = GetPortStatsCacheStats();
+  EXPECT_EQ(1, stats.refresh_errors);
+  EXPECT_EQ(1, stats.misses);
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
+TEST_F(BFChassisManagerTest, PortStatsSnapshotsDisabled) {
+  FLAGS_bf_port_stats_refresh_interval_ms = 0;
+  EXPECT_CALL(*bf_pal_mock_, PortAllStatsGet(kUnit, kPortId, _)).Times(2);
+  ASSERT_OK(PushBaseChassisConfig());
+
+  PortCounters counters;
+  ASSERT_OK(GetPortCounters(kNodeId, kPortId, &counters));
+  ASSERT_OK(GetPortCounters(kNodeId, kPortId, &counters));
+  auto stats = GetPortStatsCacheStats();
+  EXPECT_EQ(0, stats.refreshes);
+  EXPECT_EQ(0, stats.hits);
+
+  ASSERT_OK(ShutdownAndTestCleanState());
+}
+
 }  // namespace barefoot
 }  // namespace hal
 }  // namespace stratum
@@ -168,6 +168,32 @@ BFSwitch::~BFSwitch() {}
   return pi_node->UnregisterPacketReceiveWriter();
 }
 
+::util::Status BFSwitch::RegisterDigestReceiveWriter(
+    uint64 node_id,
+    std::shared_ptr<WriterInterface<::p4::v1::DigestList>> writer) {
+  ASSIGN_OR_RETURN(auto* pi_node, GetPINodeFromNodeId(node_id));
+  return pi_node->RegisterDigestReceiveWriter(writer);
+}
+
+::util::Status BFSwitch::UnregisterDigestReceiveWriter(uint64 node_id) {
+  ASSIGN_OR_RETURN(auto* pi_node, GetPINodeFromNodeId(node_id));
+  return pi_node->UnregisterDigestReceiveWriter();
+}
+
+::util::Status BFSwitch::RegisterIdleTimeoutNotificationWriter(
+    uint64 node_id,
+    std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>
+        writer) {
+  ASSIGN_OR_RETURN(auto* pi_node, GetPINodeFromNodeId(node_id));
+  return pi_node->RegisterIdleTimeoutNotificationWriter(writer);
+}
+
+::util::Status BFSwitch::UnregisterIdleTimeoutNotificationWriter(
+    uint64 node_id) {
+  ASSIGN_OR_RETURN(auto* pi_node, GetPINodeFromNodeId(node_id));
+  return pi_node->UnregisterIdleTimeoutNotificationWriter();
+}
+
 ::util::Status BFSwitch::TransmitPacket(uint64 node_id,
                                         const ::p4::v1::PacketOut& packet) {
   ASSIGN_OR_RETURN(auto* pi_node, GetPINodeFromNodeId(node_id));
@@ -62,6 +62,16 @@ class BFSwitch : public SwitchInterface {
       uint64 node_id,
       std::shared_ptr<WriterInterface<::p4::v1::PacketIn>> writer) override;
   ::util::Status UnregisterPacketReceiveWriter(uint64 node_id) override;
+  ::util::Status RegisterDigestReceiveWriter(
+      uint64 node_id,
+      std::shared_ptr<WriterInterface<::p4::v1::DigestList>> writer) override;
+  ::util::Status UnregisterDigestReceiveWriter(uint64 node_id) override;
+  ::util::Status RegisterIdleTimeoutNotificationWriter(
+      uint64 node_id,
+      std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>
+          writer) override;
+  ::util::Status UnregisterIdleTimeoutNotificationWriter(
+      uint64 node_id) override;
   ::util::Status TransmitPacket(uint64 node_id,
                                 const ::p4::v1::PacketOut& packet) override;
   ::util::Status RegisterEventNotifyWriter(
@@ -82,13 +82,13 @@ BcmAclStage AclTable::P4PipelineToBcmAclStage(
 
 ::util::Status AclTable::DryRunInsertEntry(
     const ::p4::v1::TableEntry& entry) const {
-  const auto result = entries_.find(entry);
+  ::p4::v1::TableEntry existing;
   // Duplicate entry check.
-  if (result != entries_.end()) {
+  if (entries_.Find(entry, &existing)) {
     return MAKE_ERROR(ERR_ENTRY_EXISTS)
            << TableStr()
            << " contains duplicate of TableEntry: " << entry.ShortDebugString()
-           << ". Matching TableEntry: " << result->ShortDebugString() << ".";
+           << ". Matching TableEntry: " << existing.ShortDebugString() << ".";
   }
   // Table capacity check.
   if (EntryCount() == max_entries_) {
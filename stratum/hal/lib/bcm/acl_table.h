@@ -165,7 +165,7 @@ class AclTable : public BcmFlowTable {
     // Remove the entry, but don't remove the record in bcm_acl_id_map_.
     ASSIGN_OR_RETURN(p4::v1::TableEntry old_entry,
                      BcmFlowTable::DeleteEntry(entry));
-    entries_.insert(entry);
+    entries_.Insert(entry);
     return old_entry;
   }
 
@@ -16,12 +16,14 @@
 
 #include "stratum/hal/lib/bcm/bcm_acl_manager.h"
 
+#include <algorithm>
 #include <iterator>
 #include <utility>
 #include <set>
 
 #include "gflags/gflags.h"
 #include "stratum/hal/lib/bcm/acl_table.h"
+#include "stratum/lib/request_arena.h"
 #include "stratum/lib/utils.h"
 #include "stratum/public/proto/p4_annotation.pb.h"
 #include "absl/container/flat_hash_set.h"
@@ -32,6 +34,10 @@
 DEFINE_string(bcm_hardware_specs_file,
               "/opt/watchtower/share/bcm_hardware_specs.pb.txt",
               "Path to the file containing the Broadcom hardware map proto.");
+DEFINE_bool(bcm_acl_pack_physical_tables, true,
+            "Merge adjacent physical ACL tables whose logical tables are "
+            "mutually exclusive into a single physical table when this does "
+            "not increase the predicted TCAM slice usage.");
 
 namespace stratum {
 namespace hal {
@@ -91,6 +97,69 @@ bool GetStatementTableReference(const P4ControlStatement& statement,
   return false;
 }
 
+using FieldProcessor = BcmHardwareSpecs::ChipModelSpec::AclSpec::FieldProcessor;
+
+// Return the field processor that implements an ACL stage.
+FieldProcessor::FieldProcessorStage AclStageToFieldProcessorStage(
+    BcmAclStage stage) {
+  switch (stage) {
+    case BCM_ACL_STAGE_VFP:
+      return FieldProcessor::VLAN;
+    case BCM_ACL_STAGE_IFP:
+      return FieldProcessor::INGRESS;
+    case BCM_ACL_STAGE_EFP:
+      return FieldProcessor::EGRESS;
+    default:
+      return FieldProcessor::FP_UNKNOWN;
+  }
+}
+
+// Return the description of the field processor that implements an ACL stage
+// in a chip or nullptr if the chip does not describe that field processor.
+const FieldProcessor* FindFieldProcessor(
+    const BcmHardwareSpecs::ChipModelSpec& chip_spec, BcmAclStage stage) {
+  FieldProcessor::FieldProcessorStage fp_stage =
+      AclStageToFieldProcessorStage(stage);
+  for (const FieldProcessor& field_processor :
+       chip_spec.acl().field_processors()) {
+    if (field_processor.stage() == fp_stage) return &field_processor;
+  }
+  return nullptr;
+}
+
+// Return the key width in bits of a qualifier generated from the constant
+// (header validity) conditions of a table.
+int ConstConditionKeyWidth(BcmField::Type type) {
+  switch (type) {
+    case BcmField::IP_TYPE:
+      return 16;
+    case BcmField::IP_PROTO_NEXT_HDR:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+// Return true if no packet can match both tables. This is the case when both
+// tables qualify on the same constant field with different values, e.g. one
+// table is applied to IPv4 packets and the other one to IPv6 packets.
+::util::StatusOr<bool> AclTablesAreExclusive(const AclTable& a,
+                                             const AclTable& b) {
+  ASSIGN_OR_RETURN(auto a_fields,
+                   BcmTableManager::ConstConditionsToBcmFields(a));
+  ASSIGN_OR_RETURN(auto b_fields,
+                   BcmTableManager::ConstConditionsToBcmFields(b));
+  for (const BcmField& a_field : a_fields) {
+    for (const BcmField& b_field : b_fields) {
+      if (a_field.type() == b_field.type() &&
+          a_field.value().u32() != b_field.value().u32()) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 }  // namespace
 
 BcmAclManager::BcmAclManager(BcmChassisRoInterface* bcm_chassis_ro_interface,
@@ -199,6 +268,10 @@ BcmAclManager::~BcmAclManager() {}
                                make_move_iterator(result.ValueOrDie().end()));
   }
 
+  // Report the predicted TCAM usage before touching the hardware, so running
+  // out of slices can be told apart from other installation failures.
+  RETURN_IF_ERROR(ReportSliceUtilization(physical_acl_tables));
+
   // Install and update the ACL tables.
   for (PhysicalAclTable& physical_acl_table : physical_acl_tables) {
     ASSIGN_OR_RETURN(int physical_table_id,
@@ -252,7 +325,8 @@ BcmAclManager::~BcmAclManager() {}
   RETURN_IF_ERROR(table->DryRunInsertEntry(entry));
 
   // Convert the entry to a BcmFlowEntry.
-  BcmFlowEntry bcm_flow_entry;
+  RequestArena arena;
+  BcmFlowEntry& bcm_flow_entry = *arena.Create<BcmFlowEntry>();
   RETURN_IF_ERROR_WITH_APPEND(bcm_table_manager_->FillBcmFlowEntry(
       entry, ::p4::v1::Update::INSERT, &bcm_flow_entry))
       << " Failed to insert table entry: " << entry.ShortDebugString() << ".";
@@ -281,7 +355,8 @@ BcmAclManager::~BcmAclManager() {}
   ASSIGN_OR_RETURN(int bcm_acl_id, table->BcmAclId(entry));
 
   // Convert: P4 TableEntry --> CommonFlowEntry --> BcmFlowEntry.
-  BcmFlowEntry bcm_flow_entry;
+  RequestArena arena;
+  BcmFlowEntry& bcm_flow_entry = *arena.Create<BcmFlowEntry>();
   RETURN_IF_ERROR_WITH_APPEND(bcm_table_manager_->FillBcmFlowEntry(
       entry, ::p4::v1::Update::MODIFY, &bcm_flow_entry))
       << " Failed to modify table entry: " << entry.ShortDebugString() << ".";
@@ -428,6 +503,9 @@ BcmAclManager::PhysicalAclTablesFromPipeline(
     physical_acl_tables.emplace_back(
         std::move(generate_physical_acl_tables.ValueOrDie()));
   }
+  if (FLAGS_bcm_acl_pack_physical_tables) {
+    return PackPhysicalAclTables(std::move(physical_acl_tables));
+  }
   return physical_acl_tables;
 }
 
@@ -511,6 +589,177 @@ BcmAclManager::GetTableMatchTypes(const AclTable& table) const {
   return bcm_fields;
 }
 
+::util::StatusOr<std::vector<BcmAclManager::PhysicalAclTable>>
+BcmAclManager::PackPhysicalAclTables(
+    std::vector<PhysicalAclTable> physical_acl_tables) const {
+  // Visit the physical tables of each stage in decreasing priority order. A
+  // table is only merged into the table right before it, so the merged table
+  // never skips over another table of the same stage.
+  std::vector<size_t> order;
+  for (size_t i = 0; i < physical_acl_tables.size(); ++i) order.push_back(i);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    const PhysicalAclTable& table_a = physical_acl_tables[a];
+    const PhysicalAclTable& table_b = physical_acl_tables[b];
+    if (table_a.stage != table_b.stage) return table_a.stage < table_b.stage;
+    return table_a.logical_tables.front().Priority() >
+           table_b.logical_tables.front().Priority();
+  });
+
+  std::vector<bool> merged(physical_acl_tables.size(), false);
+  PhysicalAclTable* head = nullptr;
+  for (size_t index : order) {
+    PhysicalAclTable& physical_acl_table = physical_acl_tables[index];
+    if (head != nullptr && head->stage == physical_acl_table.stage) {
+      // Only merge tables that can never match the same packet, so the
+      // relative priority of their entries does not matter.
+      bool exclusive = true;
+      for (const AclTable& a : head->logical_tables) {
+        for (const AclTable& b : physical_acl_table.logical_tables) {
+          ASSIGN_OR_RETURN(exclusive, AclTablesAreExclusive(a, b));
+          if (!exclusive) break;
+        }
+        if (!exclusive) break;
+      }
+      if (exclusive) {
+        // The head has the higher priority, so its first logical table stays
+        // first in the merged table.
+        PhysicalAclTable candidate = *head;
+        auto& logical_tables = physical_acl_table.logical_tables;
+        candidate.logical_tables.insert(candidate.logical_tables.end(),
+                                        logical_tables.begin(),
+                                        logical_tables.end());
+        ASSIGN_OR_RETURN(int head_slices, PredictSliceCount(*head));
+        ASSIGN_OR_RETURN(int table_slices,
+                         PredictSliceCount(physical_acl_table));
+        ASSIGN_OR_RETURN(int candidate_slices, PredictSliceCount(candidate));
+        if (candidate_slices <= head_slices + table_slices) {
+          VLOG(1) << "Packing P4 ACL Table "
+                  << physical_acl_table.logical_tables.front().Id()
+                  << " into the physical table of P4 ACL Table "
+                  << head->logical_tables.front().Id() << " (predicted slices: "
+                  << head_slices + table_slices << " -> " << candidate_slices
+                  << ").";
+          *head = std::move(candidate);
+          merged[index] = true;
+          continue;
+        }
+      }
+    }
+    head = &physical_acl_table;
+  }
+
+  std::vector<PhysicalAclTable> packed_tables;
+  for (size_t i = 0; i < physical_acl_tables.size(); ++i) {
+    if (!merged[i]) packed_tables.push_back(std::move(physical_acl_tables[i]));
+  }
+  return packed_tables;
+}
+
+::util::StatusOr<
+    absl::flat_hash_map<BcmField::Type, int, EnumHash<BcmField::Type>>>
+BcmAclManager::GetPhysicalTableKeyWidths(
+    const PhysicalAclTable& physical_acl_table) const {
+  absl::flat_hash_map<BcmField::Type, int, EnumHash<BcmField::Type>>
+      key_widths;
+  for (const AclTable& table : physical_acl_table.logical_tables) {
+    ::p4::config::v1::Table p4_table;
+    RETURN_IF_ERROR(p4_table_mapper_->LookupTable(table.Id(), &p4_table));
+    for (const auto& match_field : p4_table.match_fields()) {
+      MappedField field;
+      RETURN_IF_ERROR_WITH_APPEND(p4_table_mapper_->MapMatchField(
+          table.Id(), match_field.id(), &field))
+          << " Failed to get key widths for table " << table.Id() << ".";
+      BcmField::Type bcm_type =
+          bcm_table_manager_->P4FieldTypeToBcmFieldType(field.type());
+      // Unsupported fields are not installed, see GetTableMatchTypes().
+      if (bcm_type == BcmField::UNKNOWN) continue;
+      int& key_width = key_widths[bcm_type];
+      key_width = std::max(key_width, match_field.bitwidth());
+    }
+    ASSIGN_OR_RETURN(auto const_fields,
+                     BcmTableManager::ConstConditionsToBcmFields(table));
+    for (const BcmField& bcm_field : const_fields) {
+      int& key_width = key_widths[bcm_field.type()];
+      key_width =
+          std::max(key_width, ConstConditionKeyWidth(bcm_field.type()));
+    }
+  }
+  return key_widths;
+}
+
+::util::StatusOr<int> BcmAclManager::PredictSliceCount(
+    const PhysicalAclTable& physical_acl_table) const {
+  const FieldProcessor* field_processor =
+      FindFieldProcessor(chip_hardware_description_, physical_acl_table.stage);
+  if (field_processor == nullptr) return 0;
+
+  ASSIGN_OR_RETURN(auto key_widths,
+                   GetPhysicalTableKeyWidths(physical_acl_table));
+  int key_width = 0;
+  for (const auto& pair : key_widths) key_width += pair.second;
+  int entries = 0;
+  for (const AclTable& table : physical_acl_table.logical_tables) {
+    entries += table.Size();
+  }
+
+  // A key wider than a slice is chained across multiple slices (wide mode) and
+  // more entries than a slice holds are spread across multiple slices. Pick
+  // the slice profile that needs the fewest slices.
+  int best_slice_count = 0;
+  for (const auto& slice : field_processor->slices()) {
+    if (slice.count() == 0 || slice.width() == 0 || slice.size() == 0) {
+      continue;
+    }
+    int width = static_cast<int>(slice.width());
+    int size = static_cast<int>(slice.size());
+    int wide = std::max(1, (key_width + width - 1) / width);
+    int deep = std::max(1, (entries + size - 1) / size);
+    if (best_slice_count == 0 || wide * deep < best_slice_count) {
+      best_slice_count = wide * deep;
+    }
+  }
+  return best_slice_count;
+}
+
+::util::Status BcmAclManager::ReportSliceUtilization(
+    const std::vector<PhysicalAclTable>& physical_acl_tables) const {
+  BcmAclStageMap<int> used_slices;
+  BcmAclStageMap<int> table_counts;
+  for (const PhysicalAclTable& physical_acl_table : physical_acl_tables) {
+    ASSIGN_OR_RETURN(int slices, PredictSliceCount(physical_acl_table));
+    used_slices[physical_acl_table.stage] += slices;
+    ++table_counts[physical_acl_table.stage];
+  }
+  for (const auto& pair : used_slices) {
+    const FieldProcessor* field_processor =
+        FindFieldProcessor(chip_hardware_description_, pair.first);
+    if (field_processor == nullptr) {
+      VLOG(1) << "No TCAM description for ACL stage "
+              << BcmAclStage_Name(pair.first) << " on unit " << unit_
+              << ". Skipping slice utilization report.";
+      continue;
+    }
+    int available_slices = 0;
+    for (const auto& slice : field_processor->slices()) {
+      available_slices += slice.count();
+    }
+    if (pair.second > available_slices) {
+      LOG(WARNING) << "ACL stage " << BcmAclStage_Name(pair.first)
+                   << " on unit " << unit_ << " is predicted to need "
+                   << pair.second << " TCAM slices for "
+                   << table_counts[pair.first]
+                   << " physical tables, but only " << available_slices
+                   << " are available.";
+    } else {
+      LOG(INFO) << "ACL stage " << BcmAclStage_Name(pair.first) << " on unit "
+                << unit_ << " is predicted to use " << pair.second << " of "
+                << available_slices << " TCAM slices for "
+                << table_counts[pair.first] << " physical tables.";
+    }
+  }
+  return ::util::OkStatus();
+}
+
 }  // namespace bcm
 }  // namespace hal
 }  // namespace stratum
@@ -36,6 +36,7 @@
 #include "absl/container/flat_hash_set.h"
 
 DECLARE_string(bcm_hardware_specs_file);
+DECLARE_bool(bcm_acl_pack_physical_tables);
 
 namespace stratum {
 namespace hal {
@@ -150,6 +151,28 @@ class BcmAclManager {
       absl::flat_hash_set<BcmField::Type, EnumHash<BcmField::Type>>>
   GetTableMatchTypes(const AclTable& table) const;
 
+  // Merge adjacent physical tables of the same stage into one physical table
+  // when no packet can match more than one of them and the merged table is not
+  // predicted to take more TCAM slices than the tables it replaces. The input
+  // is expected in pipeline order.
+  ::util::StatusOr<std::vector<PhysicalAclTable>> PackPhysicalAclTables(
+      std::vector<PhysicalAclTable> physical_acl_tables) const;
+
+  // Get the match key width in bits of each qualifier used by a physical table.
+  ::util::StatusOr<
+      absl::flat_hash_map<BcmField::Type, int, EnumHash<BcmField::Type>>>
+  GetPhysicalTableKeyWidths(const PhysicalAclTable& physical_acl_table) const;
+
+  // Predict the number of TCAM slices used by a physical table based on the
+  // chip hardware description. Returns 0 if the stage is not described.
+  ::util::StatusOr<int> PredictSliceCount(
+      const PhysicalAclTable& physical_acl_table) const;
+
+  // Log the predicted TCAM slice utilization of each ACL stage. Stages that are
+  // predicted to run out of slices are reported as warnings.
+  ::util::Status ReportSliceUtilization(
+      const std::vector<PhysicalAclTable>& physical_acl_tables) const;
+
   // The last P4PipelineConfig pushed to the class.
   P4PipelineConfig p4_pipeline_config_;
 
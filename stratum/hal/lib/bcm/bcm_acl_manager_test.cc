@@ -1901,6 +1901,163 @@ TEST_F(BcmAclManagerTest, TestInstallPhysicalTableWithConstConditions) {
   ASSERT_OK(SetUpTables(tables, control_block));
 }
 
+// Tests that tables which can never match the same packet (IPv4 vs IPv6) are
+// packed into a single physical table.
+TEST_F(BcmAclManagerTest, TestPackMutuallyExclusivePhysicalTables) {
+  std::vector<string> table_strings = {
+      R"PROTO(
+        preamble { id: 1 name: "table_1" }
+        match_fields { id: 1 name: "P4_FIELD_TYPE_ETH_SRC" match_type: TERNARY }
+        size: 10
+      )PROTO",
+      R"PROTO(
+        preamble { id: 2 name: "table_2" }
+        match_fields { id: 1 name: "P4_FIELD_TYPE_ETH_DST" match_type: TERNARY }
+        size: 10
+      )PROTO"};
+
+  std::vector<::p4::config::v1::Table> tables;
+  for (const string& table_string : table_strings) {
+    ::p4::config::v1::Table table;
+    CHECK_OK(ParseProtoFromString(table_string, &table));
+    tables.push_back(table);
+  }
+
+  P4ControlBlock control_block;
+  *control_block.add_statements() =
+      IsValidBuilder()
+          .Header(P4HeaderType::P4_HEADER_IPV4)
+          .DoIfValid(ApplyTable(tables[0], P4Annotation::INGRESS_ACL))
+          .Build();
+  *control_block.add_statements() =
+      IsValidBuilder()
+          .Header(P4HeaderType::P4_HEADER_IPV6)
+          .DoIfValid(ApplyTable(tables[1], P4Annotation::INGRESS_ACL))
+          .Build();
+
+  BcmAclTable expected_bcm_table;
+  CHECK_OK(ParseProtoFromString(R"PROTO(
+    fields { type: ETH_SRC }
+    fields { type: ETH_DST }
+    fields { type: IP_TYPE }
+  )PROTO", &expected_bcm_table));
+  EXPECT_CALL(*bcm_sdk_mock_,
+              CreateAclTable(
+                  kUnit, PartiallyUnorderedEqualsProto(expected_bcm_table)))
+      .WillOnce(Return(100));
+
+  ASSERT_OK(SetUpTables(tables, control_block));
+  for (const auto& table : tables) {
+    const AclTable* acl_table;
+    ASSERT_OK_AND_ASSIGN(acl_table, bcm_table_manager_->GetReadOnlyAclTable(
+                                        table.preamble().id()));
+    EXPECT_EQ(acl_table->PhysicalTableId(), 100);
+  }
+}
+
+// Tests that mutually exclusive tables are kept apart when packing them would
+// take more TCAM slices than installing them separately.
+TEST_F(BcmAclManagerTest, TestNoPackingWhenMoreSlicesAreNeeded) {
+  ChassisConfig config;
+  config.add_nodes()->set_id(kNodeId);
+  EXPECT_CALL(*bcm_sdk_mock_, InitAclHardware(kUnit))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_sdk_mock_, SetAclControl(kUnit, _))
+      .WillOnce(Return(::util::OkStatus()));
+  ASSERT_OK(bcm_acl_manager_->PushChassisConfig(config, kNodeId));
+
+  // Each table fits a single 200-bit slice. Packed, the key is 304 bits wide
+  // and the 400 entries need two slices in depth.
+  std::vector<string> table_strings = {
+      R"PROTO(
+        preamble { id: 1 name: "table_1" }
+        match_fields {
+          id: 1
+          name: "P4_FIELD_TYPE_ETH_SRC"
+          bitwidth: 48
+          match_type: TERNARY
+        }
+        match_fields {
+          id: 2
+          name: "P4_FIELD_TYPE_ETH_DST"
+          bitwidth: 48
+          match_type: TERNARY
+        }
+        match_fields {
+          id: 3
+          name: "P4_FIELD_TYPE_IPV4_SRC"
+          bitwidth: 32
+          match_type: TERNARY
+        }
+        match_fields {
+          id: 4
+          name: "P4_FIELD_TYPE_IPV4_DST"
+          bitwidth: 32
+          match_type: TERNARY
+        }
+        size: 200
+      )PROTO",
+      R"PROTO(
+        preamble { id: 2 name: "table_2" }
+        match_fields {
+          id: 1
+          name: "P4_FIELD_TYPE_IPV6_SRC"
+          bitwidth: 64
+          match_type: TERNARY
+        }
+        match_fields {
+          id: 2
+          name: "P4_FIELD_TYPE_IPV6_DST"
+          bitwidth: 64
+          match_type: TERNARY
+        }
+        size: 200
+      )PROTO"};
+
+  std::vector<::p4::config::v1::Table> tables;
+  for (const string& table_string : table_strings) {
+    ::p4::config::v1::Table table;
+    CHECK_OK(ParseProtoFromString(table_string, &table));
+    tables.push_back(table);
+  }
+
+  P4ControlBlock control_block;
+  *control_block.add_statements() =
+      IsValidBuilder()
+          .Header(P4HeaderType::P4_HEADER_IPV4)
+          .DoIfValid(ApplyTable(tables[0], P4Annotation::INGRESS_ACL))
+          .Build();
+  *control_block.add_statements() =
+      IsValidBuilder()
+          .Header(P4HeaderType::P4_HEADER_IPV6)
+          .DoIfValid(ApplyTable(tables[1], P4Annotation::INGRESS_ACL))
+          .Build();
+
+  std::vector<string> bcm_table_strings = {
+      R"PROTO(
+        fields { type: ETH_SRC }
+        fields { type: ETH_DST }
+        fields { type: IPV4_SRC }
+        fields { type: IPV4_DST }
+        fields { type: IP_TYPE }
+      )PROTO",
+      R"PROTO(
+        fields { type: IPV6_SRC_UPPER_64 }
+        fields { type: IPV6_DST_UPPER_64 }
+        fields { type: IP_TYPE }
+      )PROTO",
+  };
+  for (const string& table_string : bcm_table_strings) {
+    BcmAclTable table;
+    CHECK_OK(ParseProtoFromString(table_string, &table));
+    EXPECT_CALL(*bcm_sdk_mock_,
+                CreateAclTable(kUnit, PartiallyUnorderedEqualsProto(table)))
+        .Times(1);
+  }
+
+  ASSERT_OK(SetUpTables(tables, control_block));
+}
+
 TEST_F(BcmAclManagerTest, TestInsertTableEntryWithConstConditions) {
   ::p4::config::v1::Table table;
   CHECK_OK(ParseProtoFromString(R"PROTO(
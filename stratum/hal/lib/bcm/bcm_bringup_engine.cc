@@ -0,0 +1,157 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/bcm/bcm_bringup_engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/macros.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+constexpr int BcmBringupEngine::kNoUnit;
+
+BcmBringupEngine::BcmBringupEngine(int max_parallel_tasks_per_unit)
+    : max_parallel_tasks_per_unit_(std::max(max_parallel_tasks_per_unit, 1)),
+      phases_(),
+      phase_stats_() {}
+
+void BcmBringupEngine::AddPhase(const std::string& name) {
+  phases_.emplace_back();
+  phases_.back().name = name;
+}
+
+void BcmBringupEngine::AddTask(int unit, Task task) {
+  CHECK(!phases_.empty()) << "AddPhase() must be called before AddTask().";
+  phases_.back().unit_to_tasks[unit].push_back(std::move(task));
+}
+
+::util::Status BcmBringupEngine::Run() {
+  phase_stats_.clear();
+  for (const auto& phase : phases_) {
+    phase_stats_.emplace_back();
+    ::util::Status status = RunPhase(phase, &phase_stats_.back());
+    VLOG(1) << "Bring-up phase " << phase.name << " took "
+            << phase_stats_.back().duration << ".";
+    if (!status.ok()) {
+      return APPEND_ERROR(status)
+             << " Bring-up phase " << phase.name << " failed.";
+    }
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status BcmBringupEngine::RunPhase(const Phase& phase,
+                                          PhaseStats* stats) {
+  stats->name = phase.name;
+  absl::Time start = absl::Now();
+
+  // Each unit gets up to max_parallel_tasks_per_unit_ workers, which take the
+  // tasks of the unit in order.
+  struct UnitState {
+    const std::vector<Task>* tasks;
+    std::atomic<size_t> next_task;
+    absl::Time last_done;
+  };
+  std::map<int, UnitState> unit_to_state;
+  int num_workers = 0;
+  for (const auto& e : phase.unit_to_tasks) {
+    UnitState& state = unit_to_state[e.first];
+    state.tasks = &e.second;
+    state.next_task = 0;
+    state.last_done = start;
+    stats->num_tasks += e.second.size();
+    num_workers +=
+        std::min<int>(max_parallel_tasks_per_unit_, e.second.size());
+  }
+
+  std::atomic<bool> failed(false);
+  absl::Mutex lock;
+  ::util::Status status = ::util::OkStatus();
+  auto worker = [&failed, &lock, &status](UnitState* state) {
+    while (!failed.load(std::memory_order_relaxed)) {
+      size_t i = state->next_task.fetch_add(1, std::memory_order_relaxed);
+      if (i >= state->tasks->size()) break;
+      ::util::Status error = (*state->tasks)[i]();
+      absl::MutexLock l(&lock);
+      state->last_done = std::max(state->last_done, absl::Now());
+      if (!error.ok()) {
+        failed = true;
+        APPEND_STATUS_IF_ERROR(status, error);
+      }
+    }
+  };
+
+  if (num_workers == 1) {
+    // Nothing to parallelize, run the only unit in the calling thread.
+    worker(&unit_to_state.begin()->second);
+  } else {
+    std::vector<std::thread> threads;
+    for (auto& e : unit_to_state) {
+      int n =
+          std::min<int>(max_parallel_tasks_per_unit_, e.second.tasks->size());
+      for (int i = 0; i < n; ++i) {
+        threads.emplace_back(worker, &e.second);
+      }
+    }
+    for (auto& t : threads) t.join();
+  }
+
+  stats->duration = absl::Now() - start;
+  for (const auto& e : unit_to_state) {
+    stats->unit_durations[e.first] = e.second.last_done - start;
+  }
+
+  return status;
+}
+
+std::string BcmBringupEngine::TimingReport() const {
+  std::string report = "";
+  absl::Duration total = absl::ZeroDuration();
+  for (const auto& stats : phase_stats_) {
+    absl::StrAppend(&report, stats.name, ": ",
+                    absl::FormatDuration(stats.duration), " (",
+                    stats.num_tasks, " tasks");
+    auto slowest = std::max_element(
+        stats.unit_durations.begin(), stats.unit_durations.end(),
+        [](const std::pair<const int, absl::Duration>& a,
+           const std::pair<const int, absl::Duration>& b) {
+          return a.second < b.second;
+        });
+    if (slowest != stats.unit_durations.end() && slowest->first != kNoUnit) {
+      absl::StrAppend(&report, ", slowest unit ", slowest->first, ": ",
+                      absl::FormatDuration(slowest->second));
+    }
+    absl::StrAppend(&report, ")\n");
+    total += stats.duration;
+  }
+  absl::StrAppend(&report, "total: ", absl::FormatDuration(total), "\n");
+
+  return report;
+}
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_HAL_LIB_BCM_BCM_BRINGUP_ENGINE_H_
+#define STRATUM_HAL_LIB_BCM_BCM_BRINGUP_ENGINE_H_
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "stratum/glue/status/status.h"
+#include "absl/time/time.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+// BcmBringupEngine runs the steps needed to bring up the BCM chips and their
+// ports as a sequence of phases (e.g. attach the units, then initialize the
+// ports, then set the port options). A phase starts only once all the tasks
+// of the previous phase are done, so a task may depend on anything done in
+// earlier phases. Within a phase, the tasks of different units are
+// independent and run concurrently, while the tasks of the same unit run at
+// most max_parallel_tasks_per_unit at a time (1 means in the order they were
+// added), as the SDK may not support concurrent calls on the same unit.
+//
+// Run() also measures each phase and the time each unit spent in it, which
+// are reported by TimingReport().
+//
+// The class is not thread-safe. The tasks themselves run in parallel, so they
+// must not modify any shared state without proper synchronization.
+class BcmBringupEngine {
+ public:
+  // Unit used for the tasks which are not specific to any unit.
+  static constexpr int kNoUnit = -1;
+
+  // A task of a phase.
+  using Task = std::function<::util::Status()>;
+
+  // The timing of a phase after Run().
+  struct PhaseStats {
+    std::string name;
+    int num_tasks;
+    // Wall clock time of the phase.
+    absl::Duration duration;
+    // Time spent running the tasks of each unit. The slowest unit bounds the
+    // duration of the phase.
+    std::map<int, absl::Duration> unit_durations;
+    PhaseStats() : name(), num_tasks(0), duration(), unit_durations() {}
+  };
+
+  explicit BcmBringupEngine(int max_parallel_tasks_per_unit);
+  ~BcmBringupEngine() {}
+
+  // Starts a new phase. The tasks added afterwards belong to this phase.
+  void AddPhase(const std::string& name);
+
+  // Adds a task for the given unit to the last phase. AddPhase() must have
+  // been called first.
+  void AddTask(int unit, Task task);
+
+  // Runs all the phases in order. If any task of a phase fails, no new task is
+  // started, the tasks already started are waited for and the errors of all
+  // the failed tasks are returned. The next phases are not run.
+  ::util::Status Run();
+
+  // Returns the stats of the phases which were run by Run().
+  const std::vector<PhaseStats>& phase_stats() const { return phase_stats_; }
+
+  // Returns a human readable report of the phase timings, e.g.
+  //   attach_units: 2.1s (2 tasks, slowest unit 1: 2.1s)
+  //   init_ports: 350ms (128 tasks, slowest unit 0: 340ms)
+  //   total: 2.45s
+  std::string TimingReport() const;
+
+  // BcmBringupEngine is neither copyable nor movable.
+  BcmBringupEngine(const BcmBringupEngine&) = delete;
+  BcmBringupEngine& operator=(const BcmBringupEngine&) = delete;
+
+ private:
+  // A phase and its tasks, grouped by unit in the order they were added.
+  struct Phase {
+    std::string name;
+    std::map<int, std::vector<Task>> unit_to_tasks;
+  };
+
+  // Runs all the tasks of a phase and fills in its stats.
+  ::util::Status RunPhase(const Phase& phase, PhaseStats* stats);
+
+  const int max_parallel_tasks_per_unit_;
+  std::vector<Phase> phases_;
+  std::vector<PhaseStats> phase_stats_;
+};
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BCM_BCM_BRINGUP_ENGINE_H_
@@ -0,0 +1,205 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/bcm/bcm_bringup_engine.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+namespace {
+
+// Tracks how many tasks run at the same time.
+class ConcurrencyTracker {
+ public:
+  ConcurrencyTracker() : running_(0), max_running_(0) {}
+
+  ::util::Status Run(absl::Duration duration) {
+    int running = ++running_;
+    int max_running = max_running_.load();
+    while (running > max_running &&
+           !max_running_.compare_exchange_weak(max_running, running)) {
+    }
+    absl::SleepFor(duration);
+    --running_;
+    return ::util::OkStatus();
+  }
+
+  int max_running() const { return max_running_; }
+
+ private:
+  std::atomic<int> running_;
+  std::atomic<int> max_running_;
+};
+
+}  // namespace
+
+TEST(BcmBringupEngineTest, PhasesRunInOrder) {
+  BcmBringupEngine engine(4);
+  absl::Mutex lock;
+  std::vector<std::string> done;
+  auto record = [&lock, &done](const std::string& step) {
+    return [&lock, &done, step]() {
+      absl::MutexLock l(&lock);
+      done.push_back(step);
+      return ::util::OkStatus();
+    };
+  };
+  engine.AddPhase("attach_units");
+  engine.AddTask(0, record("attach"));
+  engine.AddTask(1, record("attach"));
+  engine.AddPhase("init_ports");
+  for (int i = 0; i < 4; ++i) {
+    engine.AddTask(0, record("port"));
+    engine.AddTask(1, record("port"));
+  }
+  engine.AddPhase("start_diag_shell");
+  engine.AddTask(BcmBringupEngine::kNoUnit, record("diag"));
+
+  ASSERT_OK(engine.Run());
+  EXPECT_THAT(done, ElementsAre("attach", "attach", "port", "port", "port",
+                                "port", "port", "port", "port", "port",
+                                "diag"));
+  ASSERT_EQ(3, engine.phase_stats().size());
+  EXPECT_EQ("init_ports", engine.phase_stats()[1].name);
+  EXPECT_EQ(8, engine.phase_stats()[1].num_tasks);
+  EXPECT_EQ(2, engine.phase_stats()[1].unit_durations.size());
+}
+
+TEST(BcmBringupEngineTest, UnitsRunConcurrently) {
+  BcmBringupEngine engine(1);
+  absl::Notification unit0_started, unit1_started;
+  // Each unit waits for the other one to start, which only succeeds if the
+  // two units run at the same time.
+  engine.AddPhase("attach_units");
+  engine.AddTask(0, [&]() -> ::util::Status {
+    unit0_started.Notify();
+    CHECK_RETURN_IF_FALSE(
+        unit1_started.WaitForNotificationWithTimeout(absl::Seconds(10)));
+    return ::util::OkStatus();
+  });
+  engine.AddTask(1, [&]() -> ::util::Status {
+    unit1_started.Notify();
+    CHECK_RETURN_IF_FALSE(
+        unit0_started.WaitForNotificationWithTimeout(absl::Seconds(10)));
+    return ::util::OkStatus();
+  });
+
+  EXPECT_OK(engine.Run());
+}
+
+TEST(BcmBringupEngineTest, TasksOfSameUnitRunOneAtATimeByDefault) {
+  BcmBringupEngine engine(1);
+  ConcurrencyTracker tracker;
+  engine.AddPhase("init_ports");
+  for (int i = 0; i < 8; ++i) {
+    engine.AddTask(0, [&tracker]() {
+      return tracker.Run(absl::Milliseconds(2));
+    });
+  }
+
+  EXPECT_OK(engine.Run());
+  EXPECT_EQ(1, tracker.max_running());
+}
+
+TEST(BcmBringupEngineTest, TasksOfSameUnitRunConcurrentlyUpToMax) {
+  BcmBringupEngine engine(4);
+  ConcurrencyTracker tracker;
+  engine.AddPhase("init_ports");
+  for (int i = 0; i < 16; ++i) {
+    engine.AddTask(0, [&tracker]() {
+      return tracker.Run(absl::Milliseconds(20));
+    });
+  }
+
+  EXPECT_OK(engine.Run());
+  EXPECT_LE(tracker.max_running(), 4);
+  EXPECT_GT(tracker.max_running(), 1);
+}
+
+TEST(BcmBringupEngineTest, FailureStopsLaterPhases) {
+  BcmBringupEngine engine(1);
+  std::atomic<int> num_ports(0);
+  bool diag_started = false;
+  absl::Notification unit0_started, unit1_started;
+  // Both units fail, once they both started, so that both errors are reported.
+  engine.AddPhase("init_ports");
+  engine.AddTask(0, [&]() -> ::util::Status {
+    unit0_started.Notify();
+    unit1_started.WaitForNotificationWithTimeout(absl::Seconds(10));
+    return MAKE_ERROR(ERR_INTERNAL) << "Failed to init port 1 on unit 0.";
+  });
+  engine.AddTask(1, [&]() -> ::util::Status {
+    unit1_started.Notify();
+    unit0_started.WaitForNotificationWithTimeout(absl::Seconds(10));
+    return MAKE_ERROR(ERR_INTERNAL) << "Failed to init port 1 on unit 1.";
+  });
+  for (int i = 0; i < 4; ++i) {
+    engine.AddTask(2, [&num_ports]() {
+      ++num_ports;
+      return ::util::OkStatus();
+    });
+  }
+  engine.AddPhase("start_diag_shell");
+  engine.AddTask(BcmBringupEngine::kNoUnit, [&diag_started]() {
+    diag_started = true;
+    return ::util::OkStatus();
+  });
+
+  ::util::Status status = engine.Run();
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.error_message(), HasSubstr("on unit 0"));
+  EXPECT_THAT(status.error_message(), HasSubstr("on unit 1"));
+  EXPECT_THAT(status.error_message(), HasSubstr("init_ports"));
+  EXPECT_FALSE(diag_started);
+  EXPECT_EQ(1, engine.phase_stats().size());
+}
+
+TEST(BcmBringupEngineTest, TimingReport) {
+  BcmBringupEngine engine(1);
+  engine.AddPhase("attach_units");
+  engine.AddTask(0, []() { return ::util::OkStatus(); });
+  engine.AddTask(1, []() { return ::util::OkStatus(); });
+  engine.AddPhase("start_diag_shell");
+  engine.AddTask(BcmBringupEngine::kNoUnit,
+                 []() { return ::util::OkStatus(); });
+
+  ASSERT_OK(engine.Run());
+  std::string report = engine.TimingReport();
+  EXPECT_THAT(report, HasSubstr("attach_units: "));
+  EXPECT_THAT(report, HasSubstr("(2 tasks, slowest unit "));
+  EXPECT_THAT(report, HasSubstr("start_diag_shell: "));
+  EXPECT_THAT(report, HasSubstr("(1 tasks)"));
+  EXPECT_THAT(report, HasSubstr("total: "));
+}
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
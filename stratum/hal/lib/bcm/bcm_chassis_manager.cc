@@ -29,6 +29,7 @@
 #include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
 #include "stratum/glue/logging.h"
+#include "stratum/hal/lib/bcm/bcm_bringup_engine.h"
 #include "stratum/hal/lib/bcm/utils.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/constants.h"
@@ -55,6 +56,11 @@ DEFINE_string(bcm_sdk_shell_log_file, "/tmp/stratum/bcm.log",
 DEFINE_string(bcm_sdk_checkpoint_dir, "",
               "The dir used by SDK to save checkpoints. Default is empty and "
               "it is expected to be explicitly given by flags.");
+DEFINE_int32(bcm_bringup_max_parallel_ports_per_unit, 1,
+             "Max number of ports of the same unit configured concurrently "
+             "during bring-up. The units are always brought up concurrently. "
+             "Only increase this if the SDK supports concurrent port "
+             "configuration calls on the same unit.");
 
 namespace stratum {
 namespace hal {
@@ -1027,33 +1033,54 @@ bool IsGePortOnTridentPlus(const BcmPort& bcm_port,
   // initialized.
   RETURN_IF_ERROR(RecursivelyCreateDir(FLAGS_bcm_sdk_checkpoint_dir));
 
+  // The rest of the bring-up is done in phases, each of which starts once the
+  // previous one is done. Within a phase the units are brought up
+  // concurrently.
+  BcmBringupEngine engine(FLAGS_bcm_bringup_max_parallel_ports_per_unit);
+
   // Initialize the SDK.
-  RETURN_IF_ERROR(bcm_sdk_interface_->InitializeSdk(
-      FLAGS_bcm_sdk_config_file, FLAGS_bcm_sdk_config_flush_file,
-      FLAGS_bcm_sdk_shell_log_file));
+  engine.AddPhase("initialize_sdk");
+  engine.AddTask(BcmBringupEngine::kNoUnit, [this]() {
+    return bcm_sdk_interface_->InitializeSdk(FLAGS_bcm_sdk_config_file,
+                                             FLAGS_bcm_sdk_config_flush_file,
+                                             FLAGS_bcm_sdk_shell_log_file);
+  });
 
   // Attach all the units. Note that we keep the things simple. We will move
   // forward iff all the units are attched successfully.
+  engine.AddPhase("attach_units");
   for (const auto& bcm_chip : target_bcm_chassis_map.bcm_chips()) {
-    RETURN_IF_ERROR(
-        bcm_sdk_interface_->FindUnit(bcm_chip.unit(), bcm_chip.pci_bus(),
-                                     bcm_chip.pci_slot(), bcm_chip.type()));
-    RETURN_IF_ERROR(bcm_sdk_interface_->InitializeUnit(bcm_chip.unit(),
-                                                       /*warm_boot=*/false));
-    RETURN_IF_ERROR(
-        bcm_sdk_interface_->SetModuleId(bcm_chip.unit(), bcm_chip.module()));
+    engine.AddTask(bcm_chip.unit(), [this, &bcm_chip]() -> ::util::Status {
+      RETURN_IF_ERROR(
+          bcm_sdk_interface_->FindUnit(bcm_chip.unit(), bcm_chip.pci_bus(),
+                                       bcm_chip.pci_slot(), bcm_chip.type()));
+      RETURN_IF_ERROR(bcm_sdk_interface_->InitializeUnit(bcm_chip.unit(),
+                                                         /*warm_boot=*/false));
+      RETURN_IF_ERROR(
+          bcm_sdk_interface_->SetModuleId(bcm_chip.unit(), bcm_chip.module()));
+      return ::util::OkStatus();
+    });
   }
 
   // Initialize all the ports (flex or not).
+  engine.AddPhase("initialize_ports");
   for (const auto& bcm_port : target_bcm_chassis_map.bcm_ports()) {
-    RETURN_IF_ERROR(bcm_sdk_interface_->InitializePort(
-        bcm_port.unit(), bcm_port.logical_port()));
+    engine.AddTask(bcm_port.unit(), [this, &bcm_port]() {
+      return bcm_sdk_interface_->InitializePort(bcm_port.unit(),
+                                                bcm_port.logical_port());
+    });
   }
 
   // Start the diag thread.
-  RETURN_IF_ERROR(bcm_sdk_interface_->StartDiagShellServer());
+  engine.AddPhase("start_diag_shell");
+  engine.AddTask(BcmBringupEngine::kNoUnit, [this]() {
+    return bcm_sdk_interface_->StartDiagShellServer();
+  });
 
-  return ::util::OkStatus();
+  ::util::Status status = engine.Run();
+  LOG(INFO) << "BCM chip bring-up timing:\n" << engine.TimingReport();
+
+  return status;
 }
 
 ::util::Status BcmChassisManager::InitializeInternalState(
@@ -1415,9 +1442,26 @@ bool IsGePortOnTridentPlus(const BcmPort& bcm_port,
 
 ::util::Status BcmChassisManager::ConfigurePortGroups() {
   ::util::Status status = ::util::OkStatus();
-  // Set the speed for flex port groups first.
+  // Set the speed for flex port groups first. The port groups of different
+  // units are configured concurrently. The tasks only save their result, the
+  // internal state is updated afterwards in this thread.
+  std::map<PortKey, ::util::StatusOr<bool>> port_group_key_to_speed_changed;
+  BcmBringupEngine speed_engine(FLAGS_bcm_bringup_max_parallel_ports_per_unit);
+  speed_engine.AddPhase("set_flex_port_group_speeds");
   for (const auto& e : port_group_key_to_flex_bcm_ports_) {
-    ::util::StatusOr<bool> ret = SetSpeedForFlexPortGroup(e.first);
+    const PortKey port_group_key = e.first;
+    ::util::StatusOr<bool>* ret =
+        &port_group_key_to_speed_changed.emplace(port_group_key, false)
+             .first->second;
+    speed_engine.AddTask(GetUnitForPortGroup(port_group_key),
+                         [this, port_group_key, ret]() {
+                           *ret = SetSpeedForFlexPortGroup(port_group_key);
+                           return ::util::OkStatus();
+                         });
+  }
+  RETURN_IF_ERROR(speed_engine.Run());
+  for (const auto& e : port_group_key_to_speed_changed) {
+    const ::util::StatusOr<bool>& ret = e.second;
     if (!ret.ok()) {
       APPEND_STATUS_IF_ERROR(status, ret.status());
       continue;
@@ -1430,25 +1474,42 @@ bool IsGePortOnTridentPlus(const BcmPort& bcm_port,
       xcvr_port_key_to_xcvr_state_[e.first] = HW_STATE_PRESENT;
     }
   }
-  // Then continue with port options.
-  for (auto& e : xcvr_port_key_to_xcvr_state_) {
+  // Then continue with port options, again concurrently across units.
+  std::map<PortKey, ::util::Status> port_group_key_to_options_status;
+  BcmBringupEngine options_engine(
+      FLAGS_bcm_bringup_max_parallel_ports_per_unit);
+  options_engine.AddPhase("set_port_group_options");
+  for (const auto& e : xcvr_port_key_to_xcvr_state_) {
     if (e.second != HW_STATE_READY) {
+      const PortKey port_group_key = e.first;
       BcmPortOptions options;
       options.set_enabled(e.second == HW_STATE_PRESENT ? TRI_STATE_TRUE
                                                        : TRI_STATE_FALSE);
       options.set_blocked(e.second != HW_STATE_PRESENT ? TRI_STATE_TRUE
                                                        : TRI_STATE_FALSE);
-      ::util::Status error = SetPortOptionsForPortGroup(e.first, options);
-      if (!error.ok()) {
-        APPEND_STATUS_IF_ERROR(status, error);
-        continue;
-      }
-      if (e.second == HW_STATE_PRESENT) {
-        // A HW_STATE_PRESENT port group after configuration is HW_STATE_READY.
-        e.second = HW_STATE_READY;
-      }
+      ::util::Status* error = &port_group_key_to_options_status[port_group_key];
+      options_engine.AddTask(
+          GetUnitForPortGroup(port_group_key),
+          [this, port_group_key, options, error]() {
+            *error = SetPortOptionsForPortGroup(port_group_key, options);
+            return ::util::OkStatus();
+          });
     }
   }
+  RETURN_IF_ERROR(options_engine.Run());
+  for (const auto& e : port_group_key_to_options_status) {
+    if (!e.second.ok()) {
+      APPEND_STATUS_IF_ERROR(status, e.second);
+      continue;
+    }
+    HwState* state = &xcvr_port_key_to_xcvr_state_[e.first];
+    if (*state == HW_STATE_PRESENT) {
+      // A HW_STATE_PRESENT port group after configuration is HW_STATE_READY.
+      *state = HW_STATE_READY;
+    }
+  }
+  VLOG(1) << "Port group configuration timing:\n"
+          << speed_engine.TimingReport() << options_engine.TimingReport();
 
   return status;
 }
@@ -2044,6 +2105,21 @@ void BcmChassisManager::TransceiverEventHandler(int slot, int port,
   return ::util::OkStatus();
 }
 
+int BcmChassisManager::GetUnitForPortGroup(
+    const PortKey& port_group_key) const {
+  const std::vector<BcmPort*>* bcm_ports =
+      gtl::FindOrNull(port_group_key_to_flex_bcm_ports_, port_group_key);
+  if (bcm_ports == nullptr) {
+    bcm_ports =
+        gtl::FindOrNull(port_group_key_to_non_flex_bcm_ports_, port_group_key);
+  }
+  if (bcm_ports == nullptr || bcm_ports->empty()) {
+    return BcmBringupEngine::kNoUnit;
+  }
+  // All the ports of a port group are on the same unit.
+  return bcm_ports->front()->unit();
+}
+
 bool BcmChassisManager::IsInternalPort(const PortKey& port_key) const {
   // Note that we have alreay verified that all the port that are part of a
   // flex/non-flex port groups are all internal or non internal. So we need to
@@ -375,6 +375,10 @@ class BcmChassisManager : public BcmChassisRoInterface {
   ::util::Status SetPortOptionsForPortGroup(
       const PortKey& port_group_key, const BcmPortOptions& options) const;
 
+  // Returns the unit of the ports in a flex or non-flex port group, or -1 if
+  // the port group is unknown.
+  int GetUnitForPortGroup(const PortKey& port_group_key) const;
+
   // A boolean which determines whether a (slot, port) encapsulated in a
   // PortKey belongs to an internal port (e.g. BP port in BG or SPICA).
   bool IsInternalPort(const PortKey& port_key) const;
@@ -0,0 +1,218 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/bcm/bcm_compact_store.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "google/protobuf/io/coded_stream.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+namespace {
+
+// The original order of the match fields is only recorded for entries with up
+// to this many match fields. Entries with more match fields are read back with
+// their match fields in canonical order.
+constexpr int kMaxOrderedMatches = 255;
+
+}  // namespace
+
+CompactTableEntryStore::CompactTableEntryStore()
+    : arena_(new SlabArena()), records_() {}
+
+CompactTableEntryStore::CompactTableEntryStore(
+    const CompactTableEntryStore& other)
+    : CompactTableEntryStore() {
+  CopyFrom(other);
+}
+
+CompactTableEntryStore::CompactTableEntryStore(CompactTableEntryStore&& other)
+    : arena_(std::move(other.arena_)), records_(std::move(other.records_)) {
+  other.arena_.reset(new SlabArena());
+  other.records_.clear();
+}
+
+CompactTableEntryStore& CompactTableEntryStore::operator=(
+    const CompactTableEntryStore& other) {
+  if (this != &other) {
+    Clear();
+    CopyFrom(other);
+  }
+  return *this;
+}
+
+CompactTableEntryStore& CompactTableEntryStore::operator=(
+    CompactTableEntryStore&& other) {
+  if (this != &other) {
+    arena_ = std::move(other.arena_);
+    records_ = std::move(other.records_);
+    other.arena_.reset(new SlabArena());
+    other.records_.clear();
+  }
+  return *this;
+}
+
+bool CompactTableEntryStore::Insert(const ::p4::v1::TableEntry& entry) {
+  std::string key, value;
+  Encode(entry, &key, &value);
+  if (records_.find(absl::string_view(key)) != records_.end()) return false;
+  Record record;
+  record.key_size = key.size();
+  record.value_size = value.size();
+  record.data = arena_->Allocate(key.size() + value.size());
+  memcpy(record.data, key.data(), key.size());
+  memcpy(record.data + key.size(), value.data(), value.size());
+  records_.insert(record);
+  return true;
+}
+
+bool CompactTableEntryStore::Contains(const ::p4::v1::TableEntry& key) const {
+  std::string encoded_key;
+  Encode(key, &encoded_key, nullptr);
+  return records_.find(absl::string_view(encoded_key)) != records_.end();
+}
+
+bool CompactTableEntryStore::Find(const ::p4::v1::TableEntry& key,
+                                  ::p4::v1::TableEntry* entry) const {
+  std::string encoded_key;
+  Encode(key, &encoded_key, nullptr);
+  auto it = records_.find(absl::string_view(encoded_key));
+  if (it == records_.end()) return false;
+  if (entry != nullptr) *entry = Decode(*it);
+  return true;
+}
+
+bool CompactTableEntryStore::Erase(const ::p4::v1::TableEntry& key,
+                                   ::p4::v1::TableEntry* entry) {
+  std::string encoded_key;
+  Encode(key, &encoded_key, nullptr);
+  auto it = records_.find(absl::string_view(encoded_key));
+  if (it == records_.end()) return false;
+  if (entry != nullptr) *entry = Decode(*it);
+  Record record = *it;
+  records_.erase(it);
+  arena_->Free(record.data, record.key_size + record.value_size);
+  return true;
+}
+
+void CompactTableEntryStore::Clear() {
+  records_.clear();
+  arena_.reset(new SlabArena());
+}
+
+size_t CompactTableEntryStore::MemoryUsage() const {
+  // flat_hash_set uses one control byte per slot on top of the slot itself.
+  return arena_->BytesReserved() + records_.capacity() * (sizeof(Record) + 1);
+}
+
+void CompactTableEntryStore::Encode(const ::p4::v1::TableEntry& entry,
+                                    std::string* key, std::string* value) {
+  // The key is the entry without the fields ignored by the comparison and with
+  // the match fields sorted by their serialized bytes, so that entries whose
+  // match fields are permutations of each other have the same key.
+  ::p4::v1::TableEntry key_entry = entry;
+  key_entry.clear_table_id();
+  key_entry.clear_action();
+  key_entry.clear_controller_metadata();
+  key_entry.clear_meter_config();
+  key_entry.clear_counter_data();
+  const int num_matches = entry.match_size();
+  std::vector<std::pair<std::string, int>> matches;
+  matches.reserve(num_matches);
+  for (int i = 0; i < num_matches; ++i) {
+    matches.emplace_back(ProtoSerialize(entry.match(i)), i);
+  }
+  std::sort(matches.begin(), matches.end());
+  bool reordered = false;
+  for (int i = 0; i < num_matches; ++i) {
+    if (matches[i].second != i) reordered = true;
+  }
+  if (reordered) {
+    key_entry.clear_match();
+    for (const auto& match : matches) {
+      *key_entry.add_match() = entry.match(match.second);
+    }
+  }
+  *key = ProtoSerialize(key_entry);
+  if (value == nullptr) return;
+
+  // The value starts with the number of match fields followed by the original
+  // index of each of them in the canonical order, or a single 0 if the order
+  // is the canonical one. The fields ignored by the comparison follow.
+  value->clear();
+  if (reordered && num_matches <= kMaxOrderedMatches) {
+    value->push_back(static_cast<char>(num_matches));
+    for (const auto& match : matches) {
+      value->push_back(static_cast<char>(match.second));
+    }
+  } else {
+    value->push_back(0);
+  }
+  ::p4::v1::TableEntry value_entry;
+  value_entry.set_table_id(entry.table_id());
+  if (entry.has_action()) *value_entry.mutable_action() = entry.action();
+  value_entry.set_controller_metadata(entry.controller_metadata());
+  if (entry.has_meter_config()) {
+    *value_entry.mutable_meter_config() = entry.meter_config();
+  }
+  if (entry.has_counter_data()) {
+    *value_entry.mutable_counter_data() = entry.counter_data();
+  }
+  value->append(ProtoSerialize(value_entry));
+}
+
+::p4::v1::TableEntry CompactTableEntryStore::Decode(const Record& record) {
+  ::p4::v1::TableEntry entry;
+  absl::string_view key = record.key();
+  absl::string_view value = record.value();
+  entry.ParseFromArray(key.data(), key.size());
+  size_t num_ordered = static_cast<uint8>(value[0]);
+  absl::string_view order = value.substr(1, num_ordered);
+  value.remove_prefix(1 + num_ordered);
+  // The key and the value have no field in common, so merging the value into
+  // the parsed key restores the original entry.
+  ::google::protobuf::io::CodedInputStream input(
+      reinterpret_cast<const uint8*>(value.data()), value.size());
+  entry.MergeFromCodedStream(&input);
+  if (num_ordered > 0) {
+    ::google::protobuf::RepeatedPtrField<::p4::v1::FieldMatch> sorted;
+    sorted.Swap(entry.mutable_match());
+    for (size_t i = 0; i < num_ordered; ++i) entry.add_match();
+    for (size_t i = 0; i < num_ordered; ++i) {
+      entry.mutable_match(static_cast<uint8>(order[i]))
+          ->Swap(sorted.Mutable(i));
+    }
+  }
+
+  return entry;
+}
+
+void CompactTableEntryStore::CopyFrom(const CompactTableEntryStore& other) {
+  records_.reserve(other.records_.size());
+  for (const auto& other_record : other.records_) {
+    size_t size = other_record.key_size + other_record.value_size;
+    Record record = other_record;
+    record.data = arena_->Allocate(size);
+    memcpy(record.data, other_record.data, size);
+    records_.insert(record);
+  }
+}
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
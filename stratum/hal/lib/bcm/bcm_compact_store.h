@@ -0,0 +1,292 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_HAL_LIB_BCM_BCM_COMPACT_STORE_H_
+#define STRATUM_HAL_LIB_BCM_BCM_COMPACT_STORE_H_
+
+#include <stddef.h>
+#include <string.h>
+
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/lib/slab_arena.h"
+#include "stratum/lib/utils.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+// CompactTableEntryStore is a set of P4 TableEntry protos which keeps each
+// entry as a single block of serialized bytes in a SlabArena instead of as a
+// heap allocated proto. Each block holds the canonical serialized key of the
+// entry (used for hashing and comparison) followed by the serialized fields
+// which are not part of the key. Protos are only materialized when an entry is
+// read back.
+//
+// Two entries are considered the same if they only differ in the following
+// fields (the same definition as TableEntryEqual in bcm_flow_table.h):
+// 1) table_id
+// 2) action
+// 3) controller_metadata
+// 4) meter_config
+// 5) counter_data
+// and if their match fields are a permutation of each other. The order of the
+// match fields of an inserted entry is preserved when it is read back.
+class CompactTableEntryStore {
+ private:
+  // Handle of a stored entry: the first key_size bytes of the block are the
+  // key and the next value_size bytes are the value.
+  struct Record {
+    char* data;
+    uint32 key_size;
+    uint32 value_size;
+    absl::string_view key() const { return absl::string_view(data, key_size); }
+    absl::string_view value() const {
+      return absl::string_view(data + key_size, value_size);
+    }
+  };
+
+  // Hash and equality functors supporting lookups by key.
+  struct RecordHash {
+    using is_transparent = void;
+    size_t operator()(absl::string_view key) const {
+      return absl::Hash<absl::string_view>()(key);
+    }
+    size_t operator()(const Record& r) const { return (*this)(r.key()); }
+  };
+  struct RecordEqual {
+    using is_transparent = void;
+    static absl::string_view Key(absl::string_view key) { return key; }
+    static absl::string_view Key(const Record& r) { return r.key(); }
+    template <typename A, typename B>
+    bool operator()(const A& a, const B& b) const {
+      return Key(a) == Key(b);
+    }
+  };
+
+  using RecordSet = absl::flat_hash_set<Record, RecordHash, RecordEqual>;
+
+ public:
+  // Forward iterator materializing the stored entries.
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ::p4::v1::TableEntry;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = value_type;
+
+    value_type operator*() const { return Decode(*it_); }
+    const_iterator& operator++() {
+      ++it_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      ++it_;
+      return tmp;
+    }
+    bool operator==(const const_iterator& other) const {
+      return it_ == other.it_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return it_ != other.it_;
+    }
+
+   private:
+    friend class CompactTableEntryStore;
+    explicit const_iterator(RecordSet::const_iterator it) : it_(it) {}
+    RecordSet::const_iterator it_;
+  };
+
+  CompactTableEntryStore();
+  CompactTableEntryStore(const CompactTableEntryStore& other);
+  CompactTableEntryStore(CompactTableEntryStore&& other);
+  CompactTableEntryStore& operator=(const CompactTableEntryStore& other);
+  CompactTableEntryStore& operator=(CompactTableEntryStore&& other);
+  ~CompactTableEntryStore() {}
+
+  // Adds the entry to the store. Returns false (and leaves the store as is) if
+  // a matching entry already exists.
+  bool Insert(const ::p4::v1::TableEntry& entry);
+
+  // Returns true if the store contains an entry matching 'key'.
+  bool Contains(const ::p4::v1::TableEntry& key) const;
+
+  // Looks up the entry matching 'key'. If found, copies it to 'entry' (if not
+  // nullptr) and returns true.
+  bool Find(const ::p4::v1::TableEntry& key, ::p4::v1::TableEntry* entry) const;
+
+  // Removes the entry matching 'key'. If found, copies it to 'entry' (if not
+  // nullptr) before removing it and returns true.
+  bool Erase(const ::p4::v1::TableEntry& key, ::p4::v1::TableEntry* entry);
+
+  // Removes all the entries.
+  void Clear();
+
+  size_t size() const { return records_.size(); }
+  bool empty() const { return records_.empty(); }
+  const_iterator begin() const { return const_iterator(records_.begin()); }
+  const_iterator end() const { return const_iterator(records_.end()); }
+
+  // Returns the number of bytes used to store the entries, including the hash
+  // table.
+  size_t MemoryUsage() const;
+
+ private:
+  // Splits 'entry' into its canonical serialized key and, if 'value' is not
+  // nullptr, its serialized value.
+  static void Encode(const ::p4::v1::TableEntry& entry, std::string* key,
+                     std::string* value);
+
+  // Materializes the entry stored in 'record'.
+  static ::p4::v1::TableEntry Decode(const Record& record);
+
+  // Copies all the entries of 'other' to this store.
+  void CopyFrom(const CompactTableEntryStore& other);
+
+  std::unique_ptr<SlabArena> arena_;
+  RecordSet records_;
+};
+
+// CompactProtoMap is a map from uint32 IDs to protos of type Message which
+// keeps the serialized protos in a SlabArena, for the same reasons as
+// CompactTableEntryStore above. Protos are only materialized when looked up or
+// iterated over.
+template <typename Message>
+class CompactProtoMap {
+ private:
+  struct Record {
+    char* data;
+    uint32 size;
+  };
+  using RecordMap = absl::flat_hash_map<uint32, Record>;
+
+ public:
+  // Forward iterator materializing (id, proto) pairs.
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<uint32, Message>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = value_type;
+
+    value_type operator*() const {
+      value_type value;
+      value.first = it_->first;
+      value.second.ParseFromArray(it_->second.data, it_->second.size);
+      return value;
+    }
+    const_iterator& operator++() {
+      ++it_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      ++it_;
+      return tmp;
+    }
+    bool operator==(const const_iterator& other) const {
+      return it_ == other.it_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return it_ != other.it_;
+    }
+
+   private:
+    friend class CompactProtoMap;
+    explicit const_iterator(typename RecordMap::const_iterator it) : it_(it) {}
+    typename RecordMap::const_iterator it_;
+  };
+
+  CompactProtoMap() : arena_(new SlabArena()), records_() {}
+  ~CompactProtoMap() {}
+
+  // Adds the proto with the given ID. Returns false (and leaves the map as is)
+  // if the ID already exists.
+  bool Insert(uint32 id, const Message& message) {
+    if (records_.count(id)) return false;
+    std::string bytes = ProtoSerialize(message);
+    Record record = {arena_->Allocate(bytes.size()),
+                     static_cast<uint32>(bytes.size())};
+    memcpy(record.data, bytes.data(), bytes.size());
+    records_.emplace(id, record);
+    return true;
+  }
+
+  // Looks up the proto with the given ID. If found, copies it to 'message' (if
+  // not nullptr) and returns true.
+  bool Find(uint32 id, Message* message) const {
+    auto it = records_.find(id);
+    if (it == records_.end()) return false;
+    if (message != nullptr) {
+      message->ParseFromArray(it->second.data, it->second.size);
+    }
+    return true;
+  }
+
+  // Removes the proto with the given ID. Returns the number of removed protos.
+  size_t erase(uint32 id) {
+    auto it = records_.find(id);
+    if (it == records_.end()) return 0;
+    arena_->Free(it->second.data, it->second.size);
+    records_.erase(it);
+    return 1;
+  }
+
+  void clear() {
+    records_.clear();
+    arena_.reset(new SlabArena());
+  }
+
+  size_t count(uint32 id) const { return records_.count(id); }
+  size_t size() const { return records_.size(); }
+  bool empty() const { return records_.empty(); }
+  const_iterator begin() const { return const_iterator(records_.begin()); }
+  const_iterator end() const { return const_iterator(records_.end()); }
+
+  // Returns the number of bytes used to store the protos, including the hash
+  // table.
+  size_t MemoryUsage() const {
+    return arena_->BytesReserved() +
+           records_.capacity() *
+               (sizeof(typename RecordMap::value_type) + 1);
+  }
+
+  // CompactProtoMap is neither copyable nor movable.
+  CompactProtoMap(const CompactProtoMap&) = delete;
+  CompactProtoMap& operator=(const CompactProtoMap&) = delete;
+
+ private:
+  std::unique_ptr<SlabArena> arena_;
+  RecordMap records_;
+};
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BCM_BCM_COMPACT_STORE_H_
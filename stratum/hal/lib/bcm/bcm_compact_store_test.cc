@@ -0,0 +1,155 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/bcm/bcm_compact_store.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/test_utils/matchers.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+namespace {
+
+using test_utils::EqualsProto;
+
+constexpr char kTableEntry[] = R"PROTO(
+    table_id: 1
+    match {
+      field_id: 3
+      lpm {
+        value: "\x0a\x00\x00\x00"
+        prefix_len: 8
+      }
+    }
+    match {
+      field_id: 1
+      exact { value: "\x01" }
+    }
+    priority: 10
+    controller_metadata: 7
+    action {
+      action {
+        action_id: 100
+        params { param_id: 1 value: "\x12\x34" }
+      }
+    })PROTO";
+
+::p4::v1::TableEntry TableEntry() {
+  ::p4::v1::TableEntry entry;
+  CHECK_OK(ParseProtoFromString(kTableEntry, &entry));
+  return entry;
+}
+
+TEST(CompactTableEntryStoreTest, InsertFindErase) {
+  CompactTableEntryStore store;
+  EXPECT_TRUE(store.empty());
+  ASSERT_TRUE(store.Insert(TableEntry()));
+  EXPECT_EQ(1, store.size());
+  EXPECT_TRUE(store.Contains(TableEntry()));
+  ::p4::v1::TableEntry entry;
+  ASSERT_TRUE(store.Find(TableEntry(), &entry));
+  // The entry, including the order of its match fields, is restored as is.
+  EXPECT_THAT(entry, EqualsProto(TableEntry()));
+  entry.Clear();
+  ASSERT_TRUE(store.Erase(TableEntry(), &entry));
+  EXPECT_THAT(entry, EqualsProto(TableEntry()));
+  EXPECT_TRUE(store.empty());
+  EXPECT_FALSE(store.Contains(TableEntry()));
+  EXPECT_FALSE(store.Erase(TableEntry(), nullptr));
+}
+
+TEST(CompactTableEntryStoreTest, KeyIgnoresActionAndMatchOrder) {
+  CompactTableEntryStore store;
+  ASSERT_TRUE(store.Insert(TableEntry()));
+  // Same key with a different action, metadata and match field order.
+  ::p4::v1::TableEntry other = TableEntry();
+  other.mutable_action()->set_action_profile_member_id(5);
+  other.set_controller_metadata(8);
+  other.set_table_id(2);
+  other.mutable_match()->SwapElements(0, 1);
+  EXPECT_TRUE(store.Contains(other));
+  EXPECT_FALSE(store.Insert(other));
+  ::p4::v1::TableEntry entry;
+  ASSERT_TRUE(store.Find(other, &entry));
+  EXPECT_THAT(entry, EqualsProto(TableEntry()));
+  // A different priority is a different key.
+  other.set_priority(11);
+  EXPECT_FALSE(store.Contains(other));
+  EXPECT_TRUE(store.Insert(other));
+  EXPECT_EQ(2, store.size());
+}
+
+TEST(CompactTableEntryStoreTest, IterateCopyAndMove) {
+  CompactTableEntryStore store;
+  std::vector<::p4::v1::TableEntry> entries;
+  for (int i = 0; i < 100; ++i) {
+    entries.push_back(TableEntry());
+    entries.back().mutable_match(1)->mutable_exact()->set_value(
+        std::string(1, static_cast<char>(i)));
+    ASSERT_TRUE(store.Insert(entries.back()));
+  }
+  // Erase a few entries so that the freed blocks get reused.
+  for (int i = 0; i < 100; i += 10) {
+    ASSERT_TRUE(store.Erase(entries[i], nullptr));
+    ASSERT_TRUE(store.Insert(entries[i]));
+  }
+  CompactTableEntryStore copy(store);
+  CompactTableEntryStore moved(std::move(store));
+  EXPECT_TRUE(store.empty());
+  EXPECT_EQ(entries.size(), copy.size());
+  EXPECT_EQ(entries.size(), moved.size());
+  int count = 0;
+  for (const auto& entry : copy) {
+    ::p4::v1::TableEntry expected;
+    ASSERT_TRUE(moved.Find(entry, &expected));
+    EXPECT_THAT(entry, EqualsProto(expected));
+    ++count;
+  }
+  EXPECT_EQ(entries.size(), count);
+  for (const auto& entry : entries) {
+    ::p4::v1::TableEntry found;
+    ASSERT_TRUE(copy.Find(entry, &found));
+    EXPECT_THAT(found, EqualsProto(entry));
+  }
+  EXPECT_GT(copy.MemoryUsage(), 0);
+}
+
+TEST(CompactProtoMapTest, InsertFindErase) {
+  CompactProtoMap<::p4::v1::TableEntry> map;
+  EXPECT_TRUE(map.Insert(1, TableEntry()));
+  EXPECT_FALSE(map.Insert(1, ::p4::v1::TableEntry()));
+  EXPECT_EQ(1, map.size());
+  EXPECT_EQ(1, map.count(1));
+  ::p4::v1::TableEntry entry;
+  ASSERT_TRUE(map.Find(1, &entry));
+  EXPECT_THAT(entry, EqualsProto(TableEntry()));
+  EXPECT_FALSE(map.Find(2, &entry));
+  for (const auto& e : map) {
+    EXPECT_EQ(1, e.first);
+    EXPECT_THAT(e.second, EqualsProto(TableEntry()));
+  }
+  EXPECT_EQ(1, map.erase(1));
+  EXPECT_EQ(0, map.erase(1));
+  EXPECT_TRUE(map.empty());
+}
+
+}  // namespace
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
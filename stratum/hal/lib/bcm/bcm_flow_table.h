@@ -27,7 +27,7 @@
 #include "stratum/lib/utils.h"
 #include "stratum/public/lib/error.h"
 #include "stratum/glue/integral_types.h"
-#include "absl/container/node_hash_set.h"
+#include "stratum/hal/lib/bcm/bcm_compact_store.h"
 #include "p4/v1/p4runtime.pb.h"
 #include "stratum/glue/status/status.h"
 #include "stratum/glue/status/statusor.h"
@@ -93,15 +93,15 @@ struct TableEntryEqual {
   }
 };
 
-using TableEntrySet =
-    absl::node_hash_set<::p4::v1::TableEntry, TableEntryHash, TableEntryEqual>;
-
-// Class for managing a BCM table.
+// Class for managing a BCM table. The entries are kept in a compact serialized
+// form (see CompactTableEntryStore) and are only materialized as protos when
+// looked up or iterated over.
 class BcmFlowTable {
  public:
-  // STL-style types that allow table traversal.
-  using const_iterator = TableEntrySet::const_iterator;
-  using value_type = TableEntrySet::value_type;
+  // STL-style types that allow table traversal. Dereferencing an iterator
+  // returns a copy of the entry.
+  using const_iterator = CompactTableEntryStore::const_iterator;
+  using value_type = CompactTableEntryStore::const_iterator::value_type;
 
   // Constructors.
   explicit BcmFlowTable(uint32 p4_table_id)
@@ -148,7 +148,7 @@ class BcmFlowTable {
 
   // Returns true if this table already has this entry.
   virtual bool HasEntry(const ::p4::v1::TableEntry& entry) const {
-    return entries_.count(entry) > 0;
+    return entries_.Contains(entry);
   }
 
   // Returns the number of entries in this table.
@@ -157,21 +157,24 @@ class BcmFlowTable {
   // Returns true if this table has no entries.
   virtual bool Empty() const { return entries_.empty(); }
 
+  // Returns the number of bytes used to store the entries of this table.
+  size_t EntryMemoryUsage() const { return entries_.MemoryUsage(); }
+
   // Returns the P4 TableEntry that matches a given entry key.
   // Returns ERR_ENTRY_NOT_FOUND if a matching entry is not found.
   virtual ::util::StatusOr<::p4::v1::TableEntry> Lookup(
       const ::p4::v1::TableEntry& key) const {
-    auto lookup = entries_.find(key);
-    if (lookup == entries_.end()) {
+    ::p4::v1::TableEntry entry;
+    if (!entries_.Find(key, &entry)) {
       return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
              << TableStr()
              << " does not contain TableEntry: " << key.ShortDebugString();
     }
-    return *lookup;
+    return entry;
   }
 
-  TableEntrySet::const_iterator begin() const { return entries_.begin(); }
-  TableEntrySet::const_iterator end() const { return entries_.end(); }
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
 
   // Returns true if this is a const table.
   virtual bool IsConst() const { return is_const_; }
@@ -191,12 +194,13 @@ class BcmFlowTable {
   //
   // See TableEntryEqual below.
   virtual ::util::Status InsertEntry(const ::p4::v1::TableEntry& entry) {
-    auto result = entries_.insert(entry);
-    if (!result.second) {
+    if (!entries_.Insert(entry)) {
+      ::p4::v1::TableEntry existing;
+      entries_.Find(entry, &existing);
       return MAKE_ERROR(ERR_ENTRY_EXISTS)
              << TableStr() << " contains duplicate of TableEntry: "
              << entry.ShortDebugString()
-             << ". Matching TableEntry: " << result.first->ShortDebugString()
+             << ". Matching TableEntry: " << existing.ShortDebugString()
              << ".";
     }
     return ::util::OkStatus();
@@ -206,12 +210,12 @@ class BcmFlowTable {
   // inserted. If the entry can be inserted, returns ::util::OkStatus().
   virtual ::util::Status DryRunInsertEntry(
       const ::p4::v1::TableEntry& entry) const {
-    const auto result = entries_.find(entry);
-    if (result != entries_.end()) {
+    ::p4::v1::TableEntry existing;
+    if (entries_.Find(entry, &existing)) {
       return MAKE_ERROR(ERR_ENTRY_EXISTS)
              << TableStr() << " contains duplicate of TableEntry: "
              << entry.ShortDebugString()
-             << ". Matching TableEntry: " << result->ShortDebugString() << ".";
+             << ". Matching TableEntry: " << existing.ShortDebugString() << ".";
     }
     return ::util::OkStatus();
   }
@@ -223,7 +227,7 @@ class BcmFlowTable {
   virtual ::util::StatusOr<::p4::v1::TableEntry> ModifyEntry(
       const ::p4::v1::TableEntry& entry) {
     ASSIGN_OR_RETURN(::p4::v1::TableEntry old_entry, DeleteEntry(entry));
-    entries_.insert(entry);
+    entries_.Insert(entry);
     return old_entry;
   }
 
@@ -232,15 +236,13 @@ class BcmFlowTable {
   // Returns ERR_ENTRY_NOT_FOUND if a matching entry does not already exist.
   virtual ::util::StatusOr<::p4::v1::TableEntry> DeleteEntry(
       const ::p4::v1::TableEntry& key) {
-    const auto lookup = entries_.find(key);
-    if (lookup == entries_.end()) {
+    ::p4::v1::TableEntry entry;
+    if (!entries_.Erase(key, &entry)) {
       return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
              << TableStr()
              << " does not contain TableEntry: " << key.ShortDebugString()
              << ".";
     }
-    ::p4::v1::TableEntry entry = *lookup;
-    entries_.erase(lookup);
     return entry;
   }
 
@@ -256,7 +258,7 @@ class BcmFlowTable {
   uint32 id_;
   std::string name_;
   // Keeps track of all entries currently in the table.
-  TableEntrySet entries_;
+  CompactTableEntryStore entries_;
   // True is this is a const table. Const tables can only be modified during
   // SetForwardingPipelineConfig().
   bool is_const_;
@@ -0,0 +1,525 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/bcm/bcm_idle_timeout_manager.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "gflags/gflags.h"
+#include "stratum/glue/gtl/map_util.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/bcm/acl_table.h"
+#include "stratum/hal/lib/common/constants.h"
+#include "stratum/lib/macros.h"
+#include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+
+DEFINE_int32(idle_timeout_min_sweep_interval_ms, 100,
+             "Min interval between two reads of the hit bits of the flows "
+             "programmed with an idle timeout, per unit.");
+DEFINE_int32(idle_timeout_max_sweep_interval_ms, 10000,
+             "Max interval between two reads of the hit bits of the flows "
+             "programmed with an idle timeout, per unit, unless it takes more "
+             "time to read them at --idle_timeout_sweep_flows_per_sec.");
+DEFINE_int32(idle_timeout_sweep_flows_per_sec, 100000,
+             "Max number of flows programmed with an idle timeout whose hit "
+             "bits are read per second, per unit. Bounds the time spent "
+             "reading hit bits when many flows have an idle timeout.");
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+namespace {
+
+// Max number of entries per IdleTimeoutNotification.
+constexpr int kMaxEntriesPerNotification = 1000;
+
+// Returns the key of a host in the host flow map: the VRF followed by the
+// bytes of the IPv4 or IPv6 address, which have a different size.
+std::string HostFlowKey(int vrf, uint32 ipv4, const std::string& ipv6) {
+  std::string key(reinterpret_cast<const char*>(&vrf), sizeof(vrf));
+  if (ipv6.empty()) {
+    key.append(reinterpret_cast<const char*>(&ipv4), sizeof(ipv4));
+  } else {
+    key.append(ipv6);
+  }
+  return key;
+}
+
+// Returns the key of an ACL entry in the ACL entry map: the table ID, the
+// priority and the match fields sorted by field ID.
+std::string AclEntryKey(const ::p4::v1::TableEntry& entry) {
+  ::p4::v1::TableEntry key;
+  key.set_table_id(entry.table_id());
+  *key.mutable_match() = entry.match();
+  key.set_priority(entry.priority());
+  std::sort(key.mutable_match()->begin(), key.mutable_match()->end(),
+            [](const ::p4::v1::FieldMatch& l, const ::p4::v1::FieldMatch& r) {
+              return l.field_id() < r.field_id();
+            });
+  return ProtoSerialize(key);
+}
+
+}  // namespace
+
+BcmIdleTimeoutManager::BcmIdleTimeoutManager(
+    BcmSdkInterface* bcm_sdk_interface, BcmTableManager* bcm_table_manager,
+    int unit)
+    : bcm_sdk_interface_(ABSL_DIE_IF_NULL(bcm_sdk_interface)),
+      bcm_table_manager_(ABSL_DIE_IF_NULL(bcm_table_manager)),
+      unit_(unit),
+      host_flows_(),
+      acl_flows_(),
+      acl_entries_(),
+      num_acl_flows_(0),
+      min_idle_timeout_ns_(std::numeric_limits<int64>::max()),
+      last_sweep_time_(absl::Now()),
+      writer_(nullptr),
+      shutdown_(false),
+      host_hit_bit_support_(HitBitSupport::kUnknown),
+      acl_hit_bit_support_(HitBitSupport::kUnknown) {
+  sweeper_thread_ = std::thread(&BcmIdleTimeoutManager::SweepLoop, this);
+}
+
+BcmIdleTimeoutManager::BcmIdleTimeoutManager()
+    : bcm_sdk_interface_(nullptr),
+      bcm_table_manager_(nullptr),
+      unit_(-1),
+      host_flows_(),
+      acl_flows_(),
+      acl_entries_(),
+      num_acl_flows_(0),
+      min_idle_timeout_ns_(std::numeric_limits<int64>::max()),
+      last_sweep_time_(absl::InfinitePast()),
+      writer_(nullptr),
+      shutdown_(false),
+      host_hit_bit_support_(HitBitSupport::kUnknown),
+      acl_hit_bit_support_(HitBitSupport::kUnknown) {}
+
+BcmIdleTimeoutManager::~BcmIdleTimeoutManager() {
+  {
+    absl::MutexLock l(&lock_);
+    shutdown_ = true;
+    work_available_.SignalAll();
+  }
+  if (sweeper_thread_.joinable()) sweeper_thread_.join();
+}
+
+bool BcmIdleTimeoutManager::IsIdleTimeoutSupported(
+    BcmFlowEntry::BcmTableType type) {
+  return type == BcmFlowEntry::BCM_TABLE_IPV4_HOST ||
+         type == BcmFlowEntry::BCM_TABLE_IPV6_HOST ||
+         type == BcmFlowEntry::BCM_TABLE_ACL;
+}
+
+::util::Status BcmIdleTimeoutManager::CheckIdleTimeoutSupported(
+    const ::p4::v1::TableEntry& entry, const BcmFlowEntry& bcm_flow_entry) {
+  BcmFlowEntry::BcmTableType type = bcm_flow_entry.bcm_table_type();
+  if (!IsIdleTimeoutSupported(type)) {
+    return MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
+           << "Idle timeout is not supported for the flows of type "
+           << BcmFlowEntry::BcmTableType_Name(type) << ": "
+           << entry.ShortDebugString() << ".";
+  }
+  bool is_acl = type == BcmFlowEntry::BCM_TABLE_ACL;
+  int acl_table_id = 0;
+  if (is_acl) {
+    ASSIGN_OR_RETURN(const AclTable* table,
+                     bcm_table_manager_->GetReadOnlyAclTable(entry.table_id()));
+    acl_table_id = table->PhysicalTableId();
+  }
+
+  absl::MutexLock l(&lock_);
+  HitBitSupport* support =
+      is_acl ? &acl_hit_bit_support_ : &host_hit_bit_support_;
+  if (*support == HitBitSupport::kUnknown) {
+    // No flow of this kind is tracked yet, so no hit is lost by clearing the
+    // hit bits.
+    ::util::Status status;
+    if (is_acl) {
+      std::vector<int> flow_ids;
+      status = bcm_sdk_interface_->GetAndClearAclFlowHits(unit_, acl_table_id,
+                                                          &flow_ids);
+    } else {
+      std::vector<BcmSdkInterface::L3HostKey> hits;
+      status = bcm_sdk_interface_->GetAndClearL3HostHits(unit_, &hits);
+    }
+    if (status.ok()) {
+      *support = HitBitSupport::kSupported;
+    } else if (status.error_code() == ERR_FEATURE_UNAVAILABLE) {
+      *support = HitBitSupport::kUnsupported;
+    } else {
+      return status;
+    }
+  }
+  if (*support == HitBitSupport::kUnsupported) {
+    return MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
+           << "Idle timeout is not supported on unit " << unit_
+           << " as the hit bits of the " << (is_acl ? "ACL" : "L3 host")
+           << " flows cannot be read: " << entry.ShortDebugString() << ".";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status BcmIdleTimeoutManager::TrackTableEntry(
+    const ::p4::v1::TableEntry& entry, const BcmFlowEntry& bcm_flow_entry) {
+  if (entry.idle_timeout_ns() <= 0) {
+    // The idle timeout of a modified flow may have been removed.
+    UntrackTableEntry(entry, bcm_flow_entry);
+    return ::util::OkStatus();
+  }
+  ASSIGN_OR_RETURN(FlowKey key, GetFlowKey(entry, bcm_flow_entry));
+  // Only the fields identifying the entry are sent back to the controller.
+  ::p4::v1::TableEntry reported_entry;
+  reported_entry.set_table_id(entry.table_id());
+  *reported_entry.mutable_match() = entry.match();
+  reported_entry.set_priority(entry.priority());
+  reported_entry.set_controller_metadata(entry.controller_metadata());
+  reported_entry.set_idle_timeout_ns(entry.idle_timeout_ns());
+
+  absl::MutexLock l(&lock_);
+  TrackedFlow* flow = nullptr;
+  bool inserted = false;
+  if (key.is_acl) {
+    auto ret = acl_flows_[key.acl_table_id].emplace(key.acl_flow_id,
+                                                    TrackedFlow());
+    flow = &ret.first->second;
+    inserted = ret.second;
+    if (inserted) ++num_acl_flows_;
+    acl_entries_[AclEntryKey(entry)] =
+        std::make_pair(key.acl_table_id, key.acl_flow_id);
+  } else {
+    auto ret = host_flows_.emplace(key.host_key, TrackedFlow());
+    flow = &ret.first->second;
+    inserted = ret.second;
+  }
+  if (inserted) flow->last_hit_ns = absl::GetCurrentTimeNanos();
+  flow->entry = reported_entry.SerializeAsString();
+  flow->idle_timeout_ns = entry.idle_timeout_ns();
+  if (entry.idle_timeout_ns() < min_idle_timeout_ns_) {
+    min_idle_timeout_ns_ = entry.idle_timeout_ns();
+  }
+  // The sweeper may have to start, or to sweep sooner.
+  work_available_.Signal();
+
+  return ::util::OkStatus();
+}
+
+void BcmIdleTimeoutManager::UntrackTableEntry(
+    const ::p4::v1::TableEntry& entry, const BcmFlowEntry& bcm_flow_entry) {
+  if (!IsIdleTimeoutSupported(bcm_flow_entry.bcm_table_type())) return;
+  if (bcm_flow_entry.bcm_table_type() == BcmFlowEntry::BCM_TABLE_ACL) {
+    // The flow ID of a deleted ACL entry cannot be found in BcmTableManager
+    // anymore. It is found from the entry itself.
+    absl::MutexLock l(&lock_);
+    auto entry_it = acl_entries_.find(AclEntryKey(entry));
+    if (entry_it == acl_entries_.end()) return;
+    std::pair<int, int> ids = entry_it->second;
+    acl_entries_.erase(entry_it);
+    auto it = acl_flows_.find(ids.first);
+    if (it == acl_flows_.end() || !it->second.erase(ids.second)) return;
+    --num_acl_flows_;
+    if (it->second.empty()) acl_flows_.erase(it);
+    return;
+  }
+  {
+    absl::MutexLock l(&lock_);
+    if (host_flows_.empty()) return;
+  }
+  // The flow of an entry which cannot be found is not tracked either.
+  auto ret = GetFlowKey(entry, bcm_flow_entry);
+  if (!ret.ok()) return;
+  absl::MutexLock l(&lock_);
+  host_flows_.erase(ret.ValueOrDie().host_key);
+}
+
+void BcmIdleTimeoutManager::UntrackAllTableEntries() {
+  absl::MutexLock l(&lock_);
+  host_flows_.clear();
+  acl_flows_.clear();
+  acl_entries_.clear();
+  num_acl_flows_ = 0;
+  min_idle_timeout_ns_ = std::numeric_limits<int64>::max();
+}
+
+::util::Status BcmIdleTimeoutManager::RegisterIdleTimeoutNotificationWriter(
+    const std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>&
+        writer) {
+  CHECK_RETURN_IF_FALSE(writer != nullptr) << "Null writer.";
+  absl::MutexLock l(&lock_);
+  writer_ = writer;
+  work_available_.Signal();
+
+  return ::util::OkStatus();
+}
+
+::util::Status BcmIdleTimeoutManager::UnregisterIdleTimeoutNotificationWriter() {
+  absl::MutexLock l(&lock_);
+  writer_ = nullptr;
+
+  return ::util::OkStatus();
+}
+
+::util::Status BcmIdleTimeoutManager::Shutdown() {
+  UntrackAllTableEntries();
+  return ::util::OkStatus();
+}
+
+::util::Status BcmIdleTimeoutManager::Sweep() {
+  bool read_hosts = false;
+  std::vector<int> acl_table_ids;
+  {
+    absl::MutexLock l(&lock_);
+    read_hosts = !host_flows_.empty();
+    for (const auto& e : acl_flows_) acl_table_ids.push_back(e.first);
+  }
+
+  // The hit bits are read without holding the lock, so that the flows can be
+  // written meanwhile. The hits of the flows deleted in between are ignored.
+  ::util::Status status = ::util::OkStatus();
+  std::vector<BcmSdkInterface::L3HostKey> host_hits;
+  bool host_hits_read = false;
+  if (read_hosts) {
+    ::util::Status error =
+        bcm_sdk_interface_->GetAndClearL3HostHits(unit_, &host_hits);
+    host_hits_read = error.ok();
+    APPEND_STATUS_IF_ERROR(status, error);
+  }
+  absl::flat_hash_map<int, std::vector<int>> acl_hits;
+  for (int table_id : acl_table_ids) {
+    std::vector<int> flow_ids;
+    ::util::Status error =
+        bcm_sdk_interface_->GetAndClearAclFlowHits(unit_, table_id, &flow_ids);
+    if (error.ok()) acl_hits[table_id] = std::move(flow_ids);
+    APPEND_STATUS_IF_ERROR(status, error);
+  }
+
+  std::vector<::p4::v1::IdleTimeoutNotification> notifications;
+  std::vector<std::vector<FlowKey>> reported;
+  std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>> writer;
+  int64 now_ns = absl::GetCurrentTimeNanos();
+  {
+    absl::MutexLock l(&lock_);
+    last_sweep_time_ = absl::FromUnixNanos(now_ns);
+    min_idle_timeout_ns_ = std::numeric_limits<int64>::max();
+    // The flows are not aged while nobody is there to be notified.
+    writer = writer_;
+    bool age = writer != nullptr;
+    for (const auto& hit : host_hits) {
+      auto* flow =
+          gtl::FindOrNull(host_flows_, HostFlowKey(hit.vrf, hit.ipv4, hit.ipv6));
+      if (flow != nullptr) flow->last_hit_ns = now_ns;
+    }
+    AgeFlows(now_ns, age && host_hits_read, 0, &host_flows_, &notifications,
+             &reported);
+    for (auto& e : acl_flows_) {
+      const auto* flow_ids = gtl::FindOrNull(acl_hits, e.first);
+      if (flow_ids != nullptr) {
+        for (int flow_id : *flow_ids) {
+          auto* flow = gtl::FindOrNull(e.second, flow_id);
+          if (flow != nullptr) flow->last_hit_ns = now_ns;
+        }
+      }
+      AgeFlows(now_ns, age && flow_ids != nullptr, e.first, &e.second,
+               &notifications, &reported);
+    }
+  }
+
+  size_t num_sent = 0;
+  for (auto& notification : notifications) {
+    notification.set_timestamp(now_ns);
+    if (!writer->Write(notification)) {
+      ::util::Status error = MAKE_ERROR(ERR_INTERNAL)
+                             << "Failed to write the idle timeout "
+                             << "notifications of unit " << unit_ << ".";
+      APPEND_STATUS_IF_ERROR(status, error);
+      break;
+    }
+    ++num_sent;
+  }
+
+  // The idle time of the reported flows only starts over once the controller
+  // was notified. The flows of the notifications which were not sent are
+  // reported again by the next sweep.
+  if (num_sent > 0) {
+    absl::MutexLock l(&lock_);
+    for (size_t i = 0; i < num_sent; ++i) {
+      for (const auto& key : reported[i]) {
+        TrackedFlow* flow = FindTrackedFlow(key);
+        if (flow != nullptr && flow->last_hit_ns < now_ns) {
+          flow->last_hit_ns = now_ns;
+        }
+      }
+    }
+  }
+
+  return status;
+}
+
+BcmIdleTimeoutManager::FlowKey BcmIdleTimeoutManager::MakeFlowKey(
+    int acl_table_id, const std::string& host_key) {
+  FlowKey key;
+  key.host_key = host_key;
+  return key;
+}
+
+BcmIdleTimeoutManager::FlowKey BcmIdleTimeoutManager::MakeFlowKey(
+    int acl_table_id, int acl_flow_id) {
+  FlowKey key;
+  key.is_acl = true;
+  key.acl_table_id = acl_table_id;
+  key.acl_flow_id = acl_flow_id;
+  return key;
+}
+
+BcmIdleTimeoutManager::TrackedFlow* BcmIdleTimeoutManager::FindTrackedFlow(
+    const FlowKey& key) {
+  if (!key.is_acl) return gtl::FindOrNull(host_flows_, key.host_key);
+  auto* flows = gtl::FindOrNull(acl_flows_, key.acl_table_id);
+  return flows != nullptr ? gtl::FindOrNull(*flows, key.acl_flow_id) : nullptr;
+}
+
+template <typename FlowMap>
+void BcmIdleTimeoutManager::AgeFlows(
+    int64 now_ns, bool age, int acl_table_id, FlowMap* flows,
+    std::vector<::p4::v1::IdleTimeoutNotification>* notifications,
+    std::vector<std::vector<FlowKey>>* reported) {
+  for (auto& e : *flows) {
+    TrackedFlow& flow = e.second;
+    min_idle_timeout_ns_ = std::min(min_idle_timeout_ns_, flow.idle_timeout_ns);
+    if (!age || now_ns - flow.last_hit_ns < flow.idle_timeout_ns) continue;
+    if (notifications->empty() ||
+        notifications->back().table_entry_size() >=
+            kMaxEntriesPerNotification) {
+      notifications->emplace_back();
+      reported->emplace_back();
+    }
+    notifications->back().add_table_entry()->ParseFromString(flow.entry);
+    reported->back().push_back(MakeFlowKey(acl_table_id, e.first));
+  }
+}
+
+absl::Duration BcmIdleTimeoutManager::SweepInterval() const {
+  absl::ReaderMutexLock l(&lock_);
+  return SweepIntervalLocked();
+}
+
+absl::Duration BcmIdleTimeoutManager::SweepIntervalLocked() const {
+  // Sweeping twice per smallest idle timeout reports a flow at most half of its
+  // idle timeout late...
+  absl::Duration interval = std::min(
+      absl::Nanoseconds(min_idle_timeout_ns_ / 2),
+      absl::Milliseconds(FLAGS_idle_timeout_max_sweep_interval_ms));
+  // ...unless the hit bits of the flows cannot be read that often within the
+  // budget.
+  size_t num_flows = host_flows_.size() + num_acl_flows_;
+  absl::Duration min_interval =
+      absl::Milliseconds(FLAGS_idle_timeout_min_sweep_interval_ms);
+  if (FLAGS_idle_timeout_sweep_flows_per_sec > 0) {
+    min_interval = std::max(min_interval, absl::Seconds(1) *
+                                              static_cast<double>(num_flows) /
+                                              FLAGS_idle_timeout_sweep_flows_per_sec);
+  }
+
+  return std::max(interval, min_interval);
+}
+
+size_t BcmIdleTimeoutManager::NumTrackedFlows() const {
+  absl::ReaderMutexLock l(&lock_);
+  return host_flows_.size() + num_acl_flows_;
+}
+
+void BcmIdleTimeoutManager::SweepLoop() {
+  while (true) {
+    {
+      absl::MutexLock l(&lock_);
+      if (shutdown_) break;
+      if (writer_ == nullptr || (host_flows_.empty() && acl_flows_.empty())) {
+        work_available_.Wait(&lock_);
+        continue;
+      }
+      // The interval is computed again when woken up, as a flow with a smaller
+      // idle timeout may have been added.
+      absl::Time next_sweep_time = last_sweep_time_ + SweepIntervalLocked();
+      if (absl::Now() < next_sweep_time) {
+        work_available_.WaitWithDeadline(&lock_, next_sweep_time);
+        continue;
+      }
+    }
+    ::util::Status status = Sweep();
+    if (!status.ok()) {
+      LOG_EVERY_N(ERROR, 100) << "Failed to sweep the idle flows of unit "
+                              << unit_ << ": " << status.error_message();
+    }
+  }
+}
+
+std::unique_ptr<BcmIdleTimeoutManager> BcmIdleTimeoutManager::CreateInstance(
+    BcmSdkInterface* bcm_sdk_interface, BcmTableManager* bcm_table_manager,
+    int unit) {
+  return absl::WrapUnique(
+      new BcmIdleTimeoutManager(bcm_sdk_interface, bcm_table_manager, unit));
+}
+
+::util::StatusOr<BcmIdleTimeoutManager::FlowKey>
+BcmIdleTimeoutManager::GetFlowKey(const ::p4::v1::TableEntry& entry,
+                                  const BcmFlowEntry& bcm_flow_entry) const {
+  FlowKey key;
+  switch (bcm_flow_entry.bcm_table_type()) {
+    case BcmFlowEntry::BCM_TABLE_IPV4_HOST:
+    case BcmFlowEntry::BCM_TABLE_IPV6_HOST: {
+      // The same key as the one BcmL3Manager gives to the SDK.
+      int vrf = kVrfDefault;
+      uint32 ipv4 = 0;
+      std::string ipv6;
+      for (const auto& field : bcm_flow_entry.fields()) {
+        if (field.type() == BcmField::VRF) {
+          vrf = static_cast<int>(field.value().u32());
+        } else if (field.type() == BcmField::IPV4_DST) {
+          ipv4 = field.value().u32();
+        } else if (field.type() == BcmField::IPV6_DST) {
+          ipv6 = field.value().b();
+        }
+      }
+      key.host_key = HostFlowKey(vrf, ipv4, ipv6);
+      break;
+    }
+    case BcmFlowEntry::BCM_TABLE_ACL: {
+      ASSIGN_OR_RETURN(const AclTable* table,
+                       bcm_table_manager_->GetReadOnlyAclTable(entry.table_id()));
+      ASSIGN_OR_RETURN(int flow_id, table->BcmAclId(entry));
+      key.is_acl = true;
+      key.acl_table_id = table->PhysicalTableId();
+      key.acl_flow_id = flow_id;
+      break;
+    }
+    default:
+      return MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
+             << "Idle timeout is not supported for the flows of type "
+             << BcmFlowEntry::BcmTableType_Name(bcm_flow_entry.bcm_table_type())
+             << ": " << entry.ShortDebugString() << ".";
+  }
+
+  return key;
+}
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_HAL_LIB_BCM_BCM_IDLE_TIMEOUT_MANAGER_H_
+#define STRATUM_HAL_LIB_BCM_BCM_IDLE_TIMEOUT_MANAGER_H_
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/bcm/bcm.pb.h"
+#include "stratum/hal/lib/bcm/bcm_sdk_interface.h"
+#include "stratum/hal/lib/bcm/bcm_table_manager.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+// The "BcmIdleTimeoutManager" class ages out the L3 host and ACL flows of a
+// unit which were programmed with a non-zero idle_timeout_ns. A sweeper thread
+// periodically reads and clears the hit bits of the host table and of the ACL
+// tables holding such flows, one bulk SDK call per table, and records the time
+// of the sweep as the last hit time of the flows which were hit. The flows not
+// hit for their idle timeout are reported to the controller in batched
+// IdleTimeoutNotifications, after which their idle time starts over. The
+// flows of a notification which cannot be sent are reported again by the next
+// sweep.
+// The sweeps are spaced to half of the smallest idle timeout, to bound the
+// error on the reported idle times, but never closer than the time budgeted
+// to read the hit bits of all the tracked flows (see the idle_timeout_* flags)
+// so that large tables do not keep the SDK busy.
+// The flows whose hit bits cannot be read are never reported as idle, and an
+// idle timeout is refused for them while the SDK cannot read the hit bits.
+class BcmIdleTimeoutManager {
+ public:
+  virtual ~BcmIdleTimeoutManager();
+
+  // Starts tracking the idle time of an IPv4/IPv6 host or ACL flow which was
+  // just inserted or modified, given the entry written by the controller and
+  // its BcmFlowEntry. A modified flow keeps its last hit time, and stops being
+  // tracked if its idle timeout is removed. NOOP for flows without idle
+  // timeout. Must be called after the flow is recorded in BcmTableManager.
+  virtual ::util::Status TrackTableEntry(const ::p4::v1::TableEntry& entry,
+                                         const BcmFlowEntry& bcm_flow_entry)
+      LOCKS_EXCLUDED(lock_);
+
+  // Stops tracking the idle time of a flow which was just deleted, or whose
+  // idle timeout was removed. NOOP for flows which are not tracked.
+  virtual void UntrackTableEntry(const ::p4::v1::TableEntry& entry,
+                                 const BcmFlowEntry& bcm_flow_entry)
+      LOCKS_EXCLUDED(lock_);
+
+  // Returns true if the flows of the given type can be aged out.
+  static bool IsIdleTimeoutSupported(BcmFlowEntry::BcmTableType type);
+
+  // Returns ERR_OPER_NOT_SUPPORTED if an idle timeout cannot be given to the
+  // flow of an entry about to be inserted or modified: the flow is not of a
+  // supported type, or the SDK cannot read the hit bits of such flows. The
+  // SDK support is found out by reading the hit bits once, before any flow of
+  // the same kind is tracked.
+  virtual ::util::Status CheckIdleTimeoutSupported(
+      const ::p4::v1::TableEntry& entry, const BcmFlowEntry& bcm_flow_entry)
+      LOCKS_EXCLUDED(lock_);
+
+  // Stops tracking all the flows, e.g. when the tables are cleared for a new
+  // forwarding pipeline config.
+  virtual void UntrackAllTableEntries() LOCKS_EXCLUDED(lock_);
+
+  // Registers the writer the IdleTimeoutNotifications are sent to. There is
+  // no sweep while no writer is registered.
+  virtual ::util::Status RegisterIdleTimeoutNotificationWriter(
+      const std::shared_ptr<
+          WriterInterface<::p4::v1::IdleTimeoutNotification>>& writer)
+      LOCKS_EXCLUDED(lock_);
+
+  // Unregisters the writer registered by
+  // RegisterIdleTimeoutNotificationWriter().
+  virtual ::util::Status UnregisterIdleTimeoutNotificationWriter()
+      LOCKS_EXCLUDED(lock_);
+
+  // Performs coldboot shutdown: stops tracking all the flows. The sweeper
+  // thread runs until the class is destroyed.
+  virtual ::util::Status Shutdown() LOCKS_EXCLUDED(lock_);
+
+  // Reads the hit bits of the tracked flows and sends the notifications for
+  // the idle ones to the registered writer. Called by the sweeper thread.
+  // Public for testing.
+  ::util::Status Sweep() LOCKS_EXCLUDED(lock_);
+
+  // Returns the time to wait between two sweeps of the tracked flows. Public
+  // for testing.
+  absl::Duration SweepInterval() const LOCKS_EXCLUDED(lock_);
+
+  // Returns the number of tracked flows.
+  size_t NumTrackedFlows() const LOCKS_EXCLUDED(lock_);
+
+  // Factory function for creating the instance of the class. Starts the
+  // sweeper thread.
+  static std::unique_ptr<BcmIdleTimeoutManager> CreateInstance(
+      BcmSdkInterface* bcm_sdk_interface, BcmTableManager* bcm_table_manager,
+      int unit);
+
+  // BcmIdleTimeoutManager is neither copyable nor movable.
+  BcmIdleTimeoutManager(const BcmIdleTimeoutManager&) = delete;
+  BcmIdleTimeoutManager& operator=(const BcmIdleTimeoutManager&) = delete;
+
+ protected:
+  // Default constructor. To be called by the Mock class instance only.
+  BcmIdleTimeoutManager();
+
+ private:
+  // The idle state of a tracked flow. The entry is kept serialized, with only
+  // the fields sent back in the IdleTimeoutNotifications.
+  struct TrackedFlow {
+    std::string entry;
+    int64 idle_timeout_ns;
+    int64 last_hit_ns;
+  };
+
+  // Identifies a tracked flow: the key of a host (see HostFlowKey() in the .cc
+  // file), or the physical table ID and the flow ID of an ACL flow.
+  struct FlowKey {
+    bool is_acl;
+    std::string host_key;
+    int acl_table_id;
+    int acl_flow_id;
+    FlowKey() : is_acl(false), host_key(), acl_table_id(0), acl_flow_id(0) {}
+  };
+
+  // Whether the SDK can read the hit bits of a kind of flows.
+  enum class HitBitSupport { kUnknown, kSupported, kUnsupported };
+
+  using HostFlowMap = absl::flat_hash_map<std::string, TrackedFlow>;
+  using AclFlowMap = absl::flat_hash_map<int, TrackedFlow>;
+
+  // Private constructor. Use CreateInstance() to create an instance of this
+  // class.
+  BcmIdleTimeoutManager(BcmSdkInterface* bcm_sdk_interface,
+                        BcmTableManager* bcm_table_manager, int unit);
+
+  // Returns the key of an IPv4/IPv6 host or ACL flow.
+  ::util::StatusOr<FlowKey> GetFlowKey(
+      const ::p4::v1::TableEntry& entry,
+      const BcmFlowEntry& bcm_flow_entry) const;
+
+  // Returns the key of the host flow with the given host key, or of the ACL
+  // flow with the given physical table ID and flow ID.
+  static FlowKey MakeFlowKey(int acl_table_id, const std::string& host_key);
+  static FlowKey MakeFlowKey(int acl_table_id, int acl_flow_id);
+
+  // Returns the tracked flow with the given key, or nullptr if not tracked.
+  TrackedFlow* FindTrackedFlow(const FlowKey& key)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Updates min_idle_timeout_ns_ with the flows of the given map, which holds
+  // the host flows or the ACL flows of the physical table 'acl_table_id'. If
+  // 'age' is true, also adds the entries of the flows which are idle at time
+  // 'now_ns' to the last notification of 'notifications' (or to a new one once
+  // the last one is full), and their keys to the same element of 'reported'.
+  template <typename FlowMap>
+  void AgeFlows(int64 now_ns, bool age, int acl_table_id, FlowMap* flows,
+                std::vector<::p4::v1::IdleTimeoutNotification>* notifications,
+                std::vector<std::vector<FlowKey>>* reported)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Implementation of SweepInterval().
+  absl::Duration SweepIntervalLocked() const SHARED_LOCKS_REQUIRED(lock_);
+
+  // Body of the sweeper thread.
+  void SweepLoop() LOCKS_EXCLUDED(lock_);
+
+  // Pointer to a BcmSdkInterface implementation that wraps all the SDK calls.
+  BcmSdkInterface* bcm_sdk_interface_;  // not owned by this class.
+
+  // Pointer to a BcmTableManager, used to find the flow IDs of the ACL flows.
+  BcmTableManager* bcm_table_manager_;  // not owned by this class.
+
+  // Fixed zero-based BCM unit number corresponding to the node/ASIC managed
+  // by this class instance. Assigned in the class constructor.
+  const int unit_;
+
+  mutable absl::Mutex lock_;
+  // Signaled when a flow or the writer is added, or when the class is being
+  // destroyed.
+  absl::CondVar work_available_;
+  // The tracked host flows, and the tracked ACL flows by physical table ID.
+  HostFlowMap host_flows_ GUARDED_BY(lock_);
+  absl::flat_hash_map<int, AclFlowMap> acl_flows_ GUARDED_BY(lock_);
+  // Map from the key of the entry of a tracked ACL flow (see AclEntryKey() in
+  // the .cc file) to the physical table ID and the flow ID of the flow, used
+  // to untrack the flow once the entry is deleted.
+  absl::flat_hash_map<std::string, std::pair<int, int>> acl_entries_
+      GUARDED_BY(lock_);
+  size_t num_acl_flows_ GUARDED_BY(lock_);
+  // A lower bound of the idle timeouts of the tracked flows, recomputed by
+  // each sweep.
+  int64 min_idle_timeout_ns_ GUARDED_BY(lock_);
+  absl::Time last_sweep_time_ GUARDED_BY(lock_);
+  std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>> writer_
+      GUARDED_BY(lock_);
+  bool shutdown_ GUARDED_BY(lock_);
+  // Whether the hit bits of the host flows and of the ACL flows can be read,
+  // found out by CheckIdleTimeoutSupported().
+  HitBitSupport host_hit_bit_support_ GUARDED_BY(lock_);
+  HitBitSupport acl_hit_bit_support_ GUARDED_BY(lock_);
+
+  std::thread sweeper_thread_;
+};
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BCM_BCM_IDLE_TIMEOUT_MANAGER_H_
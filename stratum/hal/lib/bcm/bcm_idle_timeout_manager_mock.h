@@ -0,0 +1,53 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_HAL_LIB_BCM_BCM_IDLE_TIMEOUT_MANAGER_MOCK_H_
+#define STRATUM_HAL_LIB_BCM_BCM_IDLE_TIMEOUT_MANAGER_MOCK_H_
+
+#include <memory>
+
+#include "stratum/hal/lib/bcm/bcm_idle_timeout_manager.h"
+#include "gmock/gmock.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+class BcmIdleTimeoutManagerMock : public BcmIdleTimeoutManager {
+ public:
+  MOCK_METHOD2(TrackTableEntry,
+               ::util::Status(const ::p4::v1::TableEntry& entry,
+                              const BcmFlowEntry& bcm_flow_entry));
+  MOCK_METHOD2(UntrackTableEntry, void(const ::p4::v1::TableEntry& entry,
+                                       const BcmFlowEntry& bcm_flow_entry));
+  MOCK_METHOD2(CheckIdleTimeoutSupported,
+               ::util::Status(const ::p4::v1::TableEntry& entry,
+                              const BcmFlowEntry& bcm_flow_entry));
+  MOCK_METHOD0(UntrackAllTableEntries, void());
+  MOCK_METHOD1(
+      RegisterIdleTimeoutNotificationWriter,
+      ::util::Status(const std::shared_ptr<
+                     WriterInterface<::p4::v1::IdleTimeoutNotification>>&
+                         writer));
+  MOCK_METHOD0(UnregisterIdleTimeoutNotificationWriter, ::util::Status());
+  MOCK_METHOD0(Shutdown, ::util::Status());
+};
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BCM_BCM_IDLE_TIMEOUT_MANAGER_MOCK_H_
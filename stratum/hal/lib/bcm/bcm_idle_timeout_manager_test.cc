@@ -0,0 +1,429 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/bcm/bcm_idle_timeout_manager.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/hal/lib/bcm/acl_table.h"
+#include "stratum/hal/lib/bcm/bcm_sdk_mock.h"
+#include "stratum/hal/lib/bcm/bcm_table_manager_mock.h"
+#include "stratum/hal/lib/common/writer_mock.h"
+#include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+
+DECLARE_int32(idle_timeout_min_sweep_interval_ms);
+DECLARE_int32(idle_timeout_max_sweep_interval_ms);
+DECLARE_int32(idle_timeout_sweep_flows_per_sec);
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+
+constexpr int kUnit = 3;
+constexpr uint32 kHostTableId = 1;
+constexpr uint32 kAclTableId = 2;
+constexpr int kPhysicalAclTableId = 7;
+
+class BcmIdleTimeoutManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // The sweeps are triggered by the tests only.
+    FLAGS_idle_timeout_min_sweep_interval_ms = 3600 * 1000;
+    FLAGS_idle_timeout_max_sweep_interval_ms = 3600 * 1000;
+    FLAGS_idle_timeout_sweep_flows_per_sec = 100000;
+    bcm_sdk_mock_ = absl::make_unique<BcmSdkMock>();
+    bcm_table_manager_mock_ = absl::make_unique<BcmTableManagerMock>();
+    writer_ = std::make_shared<WriterMock<::p4::v1::IdleTimeoutNotification>>();
+    bcm_idle_timeout_manager_ = BcmIdleTimeoutManager::CreateInstance(
+        bcm_sdk_mock_.get(), bcm_table_manager_mock_.get(), kUnit);
+    ASSERT_OK(
+        bcm_idle_timeout_manager_->RegisterIdleTimeoutNotificationWriter(
+            writer_));
+  }
+
+  void TearDown() override {
+    FLAGS_idle_timeout_min_sweep_interval_ms = 100;
+    FLAGS_idle_timeout_max_sweep_interval_ms = 10000;
+  }
+
+  // Returns an IPv4 host entry and its BcmFlowEntry.
+  static void HostEntry(uint32 ipv4, int64 idle_timeout_ns,
+                        ::p4::v1::TableEntry* entry,
+                        BcmFlowEntry* bcm_flow_entry) {
+    entry->set_table_id(kHostTableId);
+    auto* match = entry->add_match();
+    match->set_field_id(1);
+    match->mutable_exact()->set_value(std::to_string(ipv4));
+    entry->set_idle_timeout_ns(idle_timeout_ns);
+    entry->mutable_action()->mutable_action()->set_action_id(10);
+    bcm_flow_entry->set_unit(kUnit);
+    bcm_flow_entry->set_bcm_table_type(BcmFlowEntry::BCM_TABLE_IPV4_HOST);
+    auto* field = bcm_flow_entry->add_fields();
+    field->set_type(BcmField::IPV4_DST);
+    field->mutable_value()->set_u32(ipv4);
+  }
+
+  static BcmSdkInterface::L3HostKey HostKey(uint32 ipv4) {
+    BcmSdkInterface::L3HostKey key;
+    key.ipv4 = ipv4;
+    return key;
+  }
+
+  // Expects the next write to the writer to be a notification with the given
+  // entries, ignoring their order.
+  void ExpectNotification(const std::vector<::p4::v1::TableEntry>& entries) {
+    EXPECT_CALL(*writer_, Write(_))
+        .WillOnce([entries](const ::p4::v1::IdleTimeoutNotification& n) {
+          EXPECT_GT(n.timestamp(), 0);
+          EXPECT_EQ(entries.size(), n.table_entry_size());
+          for (const auto& expected : entries) {
+            bool found = false;
+            for (const auto& entry : n.table_entry()) {
+              if (ProtoEqual(entry, expected)) found = true;
+            }
+            EXPECT_TRUE(found) << expected.ShortDebugString();
+          }
+          return true;
+        });
+  }
+
+  // Returns the entry as reported in the notifications.
+  static ::p4::v1::TableEntry Reported(const ::p4::v1::TableEntry& entry) {
+    ::p4::v1::TableEntry reported = entry;
+    reported.clear_action();
+    return reported;
+  }
+
+  std::unique_ptr<BcmSdkMock> bcm_sdk_mock_;
+  std::unique_ptr<BcmTableManagerMock> bcm_table_manager_mock_;
+  std::shared_ptr<WriterMock<::p4::v1::IdleTimeoutNotification>> writer_;
+  std::unique_ptr<BcmIdleTimeoutManager> bcm_idle_timeout_manager_;
+};
+
+TEST_F(BcmIdleTimeoutManagerTest, IdleHostsAreReported) {
+  ::p4::v1::TableEntry entry1, entry2;
+  BcmFlowEntry bcm_flow_entry1, bcm_flow_entry2;
+  HostEntry(0x0a000001, 1000, &entry1, &bcm_flow_entry1);  // 1us
+  HostEntry(0x0a000002, 3600000000000LL, &entry2, &bcm_flow_entry2);  // 1h
+  ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry1,
+                                                       bcm_flow_entry1));
+  ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry2,
+                                                       bcm_flow_entry2));
+  EXPECT_EQ(2, bcm_idle_timeout_manager_->NumTrackedFlows());
+  absl::SleepFor(absl::Milliseconds(1));
+
+  // The hit bits of the host table are read once for all the hosts.
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearL3HostHits(kUnit, _))
+      .WillOnce(Return(::util::OkStatus()));
+  ExpectNotification({Reported(entry1)});
+  EXPECT_OK(bcm_idle_timeout_manager_->Sweep());
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, HitHostsAreNotReported) {
+  ::p4::v1::TableEntry entry;
+  BcmFlowEntry bcm_flow_entry;
+  HostEntry(0x0a000001, 2000000, &entry, &bcm_flow_entry);  // 2ms
+  ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                       bcm_flow_entry));
+  absl::SleepFor(absl::Milliseconds(3));
+
+  // The host was hit since it was inserted.
+  std::vector<BcmSdkInterface::L3HostKey> hits = {HostKey(0x0a000001)};
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearL3HostHits(kUnit, _))
+      .WillOnce(DoAll(SetArgPointee<1>(hits), Return(::util::OkStatus())))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*writer_, Write(_)).Times(0);
+  EXPECT_OK(bcm_idle_timeout_manager_->Sweep());
+  ::testing::Mock::VerifyAndClearExpectations(writer_.get());
+
+  // Not hit anymore.
+  absl::SleepFor(absl::Milliseconds(3));
+  ExpectNotification({Reported(entry)});
+  EXPECT_OK(bcm_idle_timeout_manager_->Sweep());
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, ReportedHostsStartOver) {
+  ::p4::v1::TableEntry entry;
+  BcmFlowEntry bcm_flow_entry;
+  HostEntry(0x0a000001, 50000000, &entry, &bcm_flow_entry);  // 50ms
+  ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                       bcm_flow_entry));
+  absl::SleepFor(absl::Milliseconds(60));
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearL3HostHits(kUnit, _))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  ExpectNotification({Reported(entry)});
+  EXPECT_OK(bcm_idle_timeout_manager_->Sweep());
+  ::testing::Mock::VerifyAndClearExpectations(writer_.get());
+
+  // The host is reported again only after another idle timeout.
+  EXPECT_CALL(*writer_, Write(_)).Times(0);
+  EXPECT_OK(bcm_idle_timeout_manager_->Sweep());
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, HostsAreReportedAgainIfNotificationFails) {
+  ::p4::v1::TableEntry entry;
+  BcmFlowEntry bcm_flow_entry;
+  HostEntry(0x0a000001, 50000000, &entry, &bcm_flow_entry);  // 50ms
+  ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                       bcm_flow_entry));
+  absl::SleepFor(absl::Milliseconds(60));
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearL3HostHits(kUnit, _))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*writer_, Write(_)).WillOnce(Return(false));
+  EXPECT_FALSE(bcm_idle_timeout_manager_->Sweep().ok());
+  ::testing::Mock::VerifyAndClearExpectations(writer_.get());
+
+  // The idle time of the host did not start over.
+  ExpectNotification({Reported(entry)});
+  EXPECT_OK(bcm_idle_timeout_manager_->Sweep());
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, IdleAclFlowsAreReported) {
+  ::p4::config::v1::Table p4_table;
+  p4_table.mutable_preamble()->set_id(kAclTableId);
+  p4_table.add_match_fields()->set_id(1);
+  p4_table.set_size(10);
+  AclTable acl_table(p4_table, BCM_ACL_STAGE_IFP, 1, {});
+  acl_table.SetPhysicalTableId(kPhysicalAclTableId);
+  std::vector<::p4::v1::TableEntry> entries(2);
+  for (int i = 0; i < 2; ++i) {
+    entries[i].set_table_id(kAclTableId);
+    auto* match = entries[i].add_match();
+    match->set_field_id(1);
+    match->mutable_ternary()->set_value(std::to_string(i));
+    match->mutable_ternary()->set_mask("\xff");
+    entries[i].set_priority(10);
+    entries[i].set_controller_metadata(i);
+    entries[i].set_idle_timeout_ns(1000);
+    ASSERT_OK(acl_table.InsertEntry(entries[i], 100 + i));
+  }
+  EXPECT_CALL(*bcm_table_manager_mock_, GetReadOnlyAclTable(kAclTableId))
+      .WillRepeatedly(Return(::util::StatusOr<const AclTable*>(&acl_table)));
+  BcmFlowEntry bcm_flow_entry;
+  bcm_flow_entry.set_bcm_table_type(BcmFlowEntry::BCM_TABLE_ACL);
+  for (const auto& entry : entries) {
+    ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                         bcm_flow_entry));
+  }
+  absl::SleepFor(absl::Milliseconds(1));
+
+  // Flow 101 was hit.
+  std::vector<int> hits = {101};
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearAclFlowHits(kUnit,
+                                                     kPhysicalAclTableId, _))
+      .WillOnce(DoAll(SetArgPointee<2>(hits), Return(::util::OkStatus())));
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearL3HostHits(_, _)).Times(0);
+  ExpectNotification({entries[0]});
+  EXPECT_OK(bcm_idle_timeout_manager_->Sweep());
+
+  // The flows are not tracked anymore once deleted, even though BcmTableManager
+  // no longer knows their flow IDs. The deleted entries only hold their key.
+  for (const auto& entry : entries) {
+    ASSERT_OK(acl_table.DeleteEntry(entry).status());
+    ::p4::v1::TableEntry deleted_entry = entry;
+    deleted_entry.clear_controller_metadata();
+    deleted_entry.clear_idle_timeout_ns();
+    bcm_idle_timeout_manager_->UntrackTableEntry(deleted_entry,
+                                                 bcm_flow_entry);
+  }
+  EXPECT_EQ(0, bcm_idle_timeout_manager_->NumTrackedFlows());
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearAclFlowHits(_, _, _)).Times(0);
+  EXPECT_OK(bcm_idle_timeout_manager_->Sweep());
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, FlowsAreNotReportedWithoutHitBits) {
+  ::p4::v1::TableEntry entry;
+  BcmFlowEntry bcm_flow_entry;
+  HostEntry(0x0a000001, 1000, &entry, &bcm_flow_entry);
+  ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                       bcm_flow_entry));
+  absl::SleepFor(absl::Milliseconds(1));
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearL3HostHits(kUnit, _))
+      .WillOnce(Return(::util::Status(StratumErrorSpace(),
+                                      ERR_FEATURE_UNAVAILABLE, "Nope.")));
+  EXPECT_CALL(*writer_, Write(_)).Times(0);
+  EXPECT_FALSE(bcm_idle_timeout_manager_->Sweep().ok());
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, FlowsAreNotReportedWithoutWriter) {
+  ::p4::v1::TableEntry entry;
+  BcmFlowEntry bcm_flow_entry;
+  HostEntry(0x0a000001, 1000, &entry, &bcm_flow_entry);
+  ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                       bcm_flow_entry));
+  ASSERT_OK(
+      bcm_idle_timeout_manager_->UnregisterIdleTimeoutNotificationWriter());
+  absl::SleepFor(absl::Milliseconds(1));
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearL3HostHits(kUnit, _))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*writer_, Write(_)).Times(0);
+  EXPECT_OK(bcm_idle_timeout_manager_->Sweep());
+  ::testing::Mock::VerifyAndClearExpectations(writer_.get());
+
+  // The idle time of the flow was not reset.
+  ASSERT_OK(bcm_idle_timeout_manager_->RegisterIdleTimeoutNotificationWriter(
+      writer_));
+  ExpectNotification({Reported(entry)});
+  EXPECT_OK(bcm_idle_timeout_manager_->Sweep());
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, ModifyKeepsOrStopsTracking) {
+  ::p4::v1::TableEntry entry;
+  BcmFlowEntry bcm_flow_entry;
+  HostEntry(0x0a000001, 1000, &entry, &bcm_flow_entry);
+  ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                       bcm_flow_entry));
+  entry.set_idle_timeout_ns(2000);
+  ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                       bcm_flow_entry));
+  EXPECT_EQ(1, bcm_idle_timeout_manager_->NumTrackedFlows());
+  entry.clear_idle_timeout_ns();
+  ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                       bcm_flow_entry));
+  EXPECT_EQ(0, bcm_idle_timeout_manager_->NumTrackedFlows());
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, UnsupportedFlowsAreRejected) {
+  ::p4::v1::TableEntry entry;
+  entry.set_table_id(kHostTableId);
+  entry.set_idle_timeout_ns(1000);
+  BcmFlowEntry bcm_flow_entry;
+  bcm_flow_entry.set_bcm_table_type(BcmFlowEntry::BCM_TABLE_IPV4_LPM);
+  EXPECT_FALSE(BcmIdleTimeoutManager::IsIdleTimeoutSupported(
+      BcmFlowEntry::BCM_TABLE_IPV4_LPM));
+  ::util::Status status =
+      bcm_idle_timeout_manager_->TrackTableEntry(entry, bcm_flow_entry);
+  EXPECT_EQ(ERR_OPER_NOT_SUPPORTED, status.error_code());
+  EXPECT_EQ(0, bcm_idle_timeout_manager_->NumTrackedFlows());
+  status = bcm_idle_timeout_manager_->CheckIdleTimeoutSupported(entry,
+                                                                bcm_flow_entry);
+  EXPECT_EQ(ERR_OPER_NOT_SUPPORTED, status.error_code());
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, CheckIdleTimeoutSupportedReadsHitBitsOnce) {
+  ::p4::v1::TableEntry entry;
+  BcmFlowEntry bcm_flow_entry;
+  HostEntry(0x0a000001, 1000, &entry, &bcm_flow_entry);
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearL3HostHits(kUnit, _))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_OK(bcm_idle_timeout_manager_->CheckIdleTimeoutSupported(
+      entry, bcm_flow_entry));
+  EXPECT_OK(bcm_idle_timeout_manager_->CheckIdleTimeoutSupported(
+      entry, bcm_flow_entry));
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, IdleTimeoutIsRejectedWithoutHitBits) {
+  ::p4::v1::TableEntry entry;
+  BcmFlowEntry bcm_flow_entry;
+  HostEntry(0x0a000001, 1000, &entry, &bcm_flow_entry);
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearL3HostHits(kUnit, _))
+      .WillOnce(Return(::util::Status(StratumErrorSpace(),
+                                      ERR_FEATURE_UNAVAILABLE, "Nope.")));
+  for (int i = 0; i < 2; ++i) {
+    ::util::Status status =
+        bcm_idle_timeout_manager_->CheckIdleTimeoutSupported(entry,
+                                                             bcm_flow_entry);
+    EXPECT_EQ(ERR_OPER_NOT_SUPPORTED, status.error_code());
+  }
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, SweepIntervalAdaptsToTableSize) {
+  FLAGS_idle_timeout_min_sweep_interval_ms = 100;
+  FLAGS_idle_timeout_max_sweep_interval_ms = 60 * 1000;
+  FLAGS_idle_timeout_sweep_flows_per_sec = 100;
+  // Half of the smallest idle timeout.
+  ::p4::v1::TableEntry entry;
+  BcmFlowEntry bcm_flow_entry;
+  HostEntry(0, 20000000000LL, &entry, &bcm_flow_entry);  // 20s
+  ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                       bcm_flow_entry));
+  EXPECT_EQ(absl::Seconds(10), bcm_idle_timeout_manager_->SweepInterval());
+
+  // The hit bits of 3000 flows cannot be read in less than 30s.
+  for (uint32 i = 1; i < 3000; ++i) {
+    ::p4::v1::TableEntry entry;
+    BcmFlowEntry bcm_flow_entry;
+    HostEntry(i, 20000000000LL, &entry, &bcm_flow_entry);
+    ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                         bcm_flow_entry));
+  }
+  EXPECT_EQ(absl::Seconds(30), bcm_idle_timeout_manager_->SweepInterval());
+
+  // Without flows the sweeps are as far apart as possible.
+  bcm_idle_timeout_manager_->UntrackAllTableEntries();
+  EXPECT_EQ(absl::Seconds(60), bcm_idle_timeout_manager_->SweepInterval());
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, NotificationsAreBatched) {
+  for (uint32 i = 0; i < 2500; ++i) {
+    ::p4::v1::TableEntry entry;
+    BcmFlowEntry bcm_flow_entry;
+    HostEntry(i, 1000, &entry, &bcm_flow_entry);
+    ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                         bcm_flow_entry));
+  }
+  absl::SleepFor(absl::Milliseconds(1));
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearL3HostHits(kUnit, _))
+      .WillOnce(Return(::util::OkStatus()));
+  int num_entries = 0;
+  EXPECT_CALL(*writer_, Write(_))
+      .Times(3)
+      .WillRepeatedly([&](const ::p4::v1::IdleTimeoutNotification& n) {
+        EXPECT_LE(n.table_entry_size(), 1000);
+        num_entries += n.table_entry_size();
+        return true;
+      });
+  EXPECT_OK(bcm_idle_timeout_manager_->Sweep());
+  EXPECT_EQ(2500, num_entries);
+}
+
+TEST_F(BcmIdleTimeoutManagerTest, SweeperThreadReportsIdleFlows) {
+  FLAGS_idle_timeout_min_sweep_interval_ms = 1;
+  // Swept every 5ms.
+  ::p4::v1::TableEntry entry;
+  BcmFlowEntry bcm_flow_entry;
+  HostEntry(0x0a000001, 10000000, &entry, &bcm_flow_entry);  // 10ms
+  EXPECT_CALL(*bcm_sdk_mock_, GetAndClearL3HostHits(kUnit, _))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  absl::Notification reported;
+  EXPECT_CALL(*writer_, Write(_))
+      .WillOnce([&](const ::p4::v1::IdleTimeoutNotification& n) {
+        reported.Notify();
+        return true;
+      })
+      .WillRepeatedly(Return(true));
+  ASSERT_OK(bcm_idle_timeout_manager_->TrackTableEntry(entry,
+                                                       bcm_flow_entry));
+  EXPECT_TRUE(reported.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  bcm_idle_timeout_manager_.reset();
+}
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
@@ -14,20 +14,70 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <functional>
+#include <iterator>
+#include <string>
 #include <vector>
 
 #include "stratum/hal/lib/bcm/bcm_l3_manager.h"
+#include "gflags/gflags.h"
+#include "stratum/glue/net_util/bits.h"
+#include "stratum/hal/lib/bcm/constants.h"
+#include "stratum/hal/lib/bcm/utils.h"
 #include "stratum/hal/lib/common/constants.h"
 #include "stratum/lib/macros.h"
+#include "stratum/lib/request_arena.h"
 #include "stratum/public/proto/p4_table_defs.pb.h"
 #include "stratum/glue/integral_types.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "stratum/glue/gtl/map_util.h"
 
+DEFINE_int32(max_wcmp_group_size, stratum::hal::bcm::kMaxEcmpGroupSize,
+             "Max number of ECMP member slots used by a WCMP group. The "
+             "weights of the members of larger groups are approximated to "
+             "fit. Cannot be more than the max size of an ECMP group.");
+
 namespace stratum {
 namespace hal {
 namespace bcm {
 
+namespace {
+
+// Returns the number of ECMP member slots the given nexthop would take if its
+// weights were not reduced.
+int64 GetRequestedSlots(const BcmMultipathNexthop& nexthop) {
+  int64 slots = 0;
+  for (const auto& member : nexthop.members()) slots += member.weight();
+  return slots;
+}
+
+std::string EcmpMemberSlotStatsToString(const EcmpMemberSlotStats& stats) {
+  return absl::StrCat(stats.num_groups, " ECMP groups using ",
+                      stats.programmed_slots, " member slots, ",
+                      stats.saved_by_weight_reduction,
+                      " slots saved by weight reduction, ",
+                      stats.saved_by_sharing, " slots saved by sharing");
+}
+
+// Returns a functor appending the routes of an IPRangeTrie visited in the
+// given VRF to the given vector.
+std::function<void(const IPRange&, const LpmOrHostActionParams&)>
+AppendRouteFunctor(int vrf, bool is_host, std::vector<L3Route>* routes) {
+  return [vrf, is_host, routes](const IPRange& prefix,
+                                const LpmOrHostActionParams& action_params) {
+    routes->emplace_back();
+    routes->back().vrf = vrf;
+    routes->back().prefix = prefix;
+    routes->back().is_host = is_host;
+    routes->back().action_params = action_params;
+  };
+}
+
+}  // namespace
+
 BcmL3Manager::BcmL3Manager(BcmSdkInterface* bcm_sdk_interface,
                            BcmTableManager* bcm_table_manager, int unit)
     : router_intf_ref_count_(),
@@ -77,6 +127,8 @@ BcmL3Manager::~BcmL3Manager() {}
 
 ::util::Status BcmL3Manager::Shutdown() {
   router_intf_ref_count_.clear();
+  vrf_to_route_index_.clear();
+  ecmp_group_slots_.clear();
   return ::util::OkStatus();
 }
 
@@ -183,10 +235,35 @@ BcmL3Manager::~BcmL3Manager() {}
     return MAKE_ERROR(ERR_INVALID_PARAM) << "No egress_intf_id found for "
                                          << nexthop.ShortDebugString() << ".";
   }
+  // The SDK returns an existing group if one with the same members exists.
+  EcmpGroupSlots& slots = ecmp_group_slots_[egress_intf_id];
+  slots.ref_count++;
+  slots.requested_slots = GetRequestedSlots(nexthop);
+  slots.programmed_slots = member_ids.size();
+  VLOG(1) << "Using ECMP group " << egress_intf_id << " with "
+          << slots.programmed_slots << " member slots for "
+          << slots.requested_slots << " requested (ref count "
+          << slots.ref_count << ") on unit " << unit_ << ": "
+          << EcmpMemberSlotStatsToString(GetEcmpMemberSlotStats()) << ".";
 
   return egress_intf_id;
 }
 
+::util::Status BcmL3Manager::ShareMultipathNexthop(int egress_intf_id) {
+  EcmpGroupSlots* slots = gtl::FindOrNull(ecmp_group_slots_, egress_intf_id);
+  if (slots == nullptr) {
+    return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+           << "No ECMP group with egress_intf_id " << egress_intf_id
+           << " to share on unit " << unit_ << ".";
+  }
+  slots->ref_count++;
+  VLOG(1) << "ECMP group " << egress_intf_id << " is now shared by "
+          << slots->ref_count << " groups on unit " << unit_ << ": "
+          << EcmpMemberSlotStatsToString(GetEcmpMemberSlotStats()) << ".";
+
+  return ::util::OkStatus();
+}
+
 ::util::Status BcmL3Manager::ModifyNonMultipathNexthop(
     int egress_intf_id, const BcmNonMultipathNexthop& nexthop) {
   if (egress_intf_id <= 0) {
@@ -274,7 +351,7 @@ BcmL3Manager::~BcmL3Manager() {}
   return ::util::OkStatus();
 }
 
-::util::Status BcmL3Manager::ModifyMultipathNexthop(
+::util::StatusOr<int> BcmL3Manager::ModifyMultipathNexthop(
     int egress_intf_id, const BcmMultipathNexthop& nexthop) {
   if (egress_intf_id <= 0) {
     return MAKE_ERROR(ERR_INVALID_PARAM)
@@ -283,11 +360,28 @@ BcmL3Manager::~BcmL3Manager() {}
   CHECK_RETURN_IF_FALSE(nexthop.unit() == unit_)
       << "Received multipath nexthop for unit " << nexthop.unit() << " on unit "
       << unit_ << ".";
+  EcmpGroupSlots* slots = gtl::FindOrNull(ecmp_group_slots_, egress_intf_id);
+  if (slots != nullptr && slots->ref_count > 1) {
+    // The other groups sharing the ECMP group keep it unchanged. The modified
+    // group gets an ECMP group of its own.
+    ASSIGN_OR_RETURN(int new_egress_intf_id,
+                     FindOrCreateMultipathNexthop(nexthop));
+    // Look up again, as the map may have been rehashed.
+    ecmp_group_slots_[egress_intf_id].ref_count--;
+    VLOG(1) << "Moved a group sharing ECMP group " << egress_intf_id
+            << " to new ECMP group " << new_egress_intf_id << " on unit "
+            << unit_ << ".";
+    return new_egress_intf_id;
+  }
   ASSIGN_OR_RETURN(std::vector<int> member_ids, FindEcmpGroupMembers(nexthop));
   RETURN_IF_ERROR(bcm_sdk_interface_->ModifyEcmpEgressIntf(
       unit_, egress_intf_id, member_ids));
+  if (slots != nullptr) {
+    slots->requested_slots = GetRequestedSlots(nexthop);
+    slots->programmed_slots = member_ids.size();
+  }
 
-  return ::util::OkStatus();
+  return egress_intf_id;
 }
 
 ::util::Status BcmL3Manager::DeleteNonMultipathNexthop(int egress_intf_id) {
@@ -316,15 +410,23 @@ BcmL3Manager::~BcmL3Manager() {}
     return MAKE_ERROR(ERR_INVALID_PARAM)
            << "Invalid egress_intf_id: " << egress_intf_id << ".";
   }
+  EcmpGroupSlots* slots = gtl::FindOrNull(ecmp_group_slots_, egress_intf_id);
+  if (slots != nullptr && slots->ref_count > 1) {
+    // Still used by other groups.
+    slots->ref_count--;
+    return ::util::OkStatus();
+  }
   RETURN_IF_ERROR(
       bcm_sdk_interface_->DeleteEcmpEgressIntf(unit_, egress_intf_id));
+  ecmp_group_slots_.erase(egress_intf_id);
 
   return ::util::OkStatus();
 }
 
 ::util::Status BcmL3Manager::InsertTableEntry(
     const ::p4::v1::TableEntry& entry) {
-  BcmFlowEntry bcm_flow_entry;
+  RequestArena arena;
+  BcmFlowEntry& bcm_flow_entry = *arena.Create<BcmFlowEntry>();
   RETURN_IF_ERROR(bcm_table_manager_->FillBcmFlowEntry(
       entry, ::p4::v1::Update::INSERT, &bcm_flow_entry));
   RETURN_IF_ERROR(InsertLpmOrHostFlow(bcm_flow_entry));
@@ -343,36 +445,50 @@ BcmL3Manager::~BcmL3Manager() {}
   LpmOrHostActionParams action_params;
   RETURN_IF_ERROR(ExtractLpmOrHostKey(bcm_flow_entry, &key));
   RETURN_IF_ERROR(ExtractLpmOrHostActionParams(bcm_flow_entry, &action_params));
+  ASSIGN_OR_RETURN(IPRange prefix, ExtractLpmOrHostPrefix(bcm_flow_entry, key));
+  bool is_host = false;
   switch (bcm_table_type) {
     case BcmFlowEntry::BCM_TABLE_IPV4_LPM:
-      return bcm_sdk_interface_->AddL3RouteIpv4(
+      RETURN_IF_ERROR(bcm_sdk_interface_->AddL3RouteIpv4(
           unit_, key.vrf, key.subnet_ipv4, key.mask_ipv4,
           action_params.class_id, action_params.egress_intf_id,
-          action_params.is_intf_multipath);
+          action_params.is_intf_multipath));
+      break;
     case BcmFlowEntry::BCM_TABLE_IPV4_HOST:
-      return bcm_sdk_interface_->AddL3HostIpv4(unit_, key.vrf, key.subnet_ipv4,
-                                               action_params.class_id,
-                                               action_params.egress_intf_id);
+      RETURN_IF_ERROR(bcm_sdk_interface_->AddL3HostIpv4(
+          unit_, key.vrf, key.subnet_ipv4, action_params.class_id,
+          action_params.egress_intf_id));
+      is_host = true;
+      break;
     case BcmFlowEntry::BCM_TABLE_IPV6_LPM:
-      return bcm_sdk_interface_->AddL3RouteIpv6(
+      RETURN_IF_ERROR(bcm_sdk_interface_->AddL3RouteIpv6(
           unit_, key.vrf, key.subnet_ipv6, key.mask_ipv6,
           action_params.class_id, action_params.egress_intf_id,
-          action_params.is_intf_multipath);
+          action_params.is_intf_multipath));
+      break;
     case BcmFlowEntry::BCM_TABLE_IPV6_HOST:
-      return bcm_sdk_interface_->AddL3HostIpv6(unit_, key.vrf, key.subnet_ipv6,
-                                               action_params.class_id,
-                                               action_params.egress_intf_id);
+      RETURN_IF_ERROR(bcm_sdk_interface_->AddL3HostIpv6(
+          unit_, key.vrf, key.subnet_ipv6, action_params.class_id,
+          action_params.egress_intf_id));
+      is_host = true;
+      break;
     default:
       return MAKE_ERROR(ERR_INVALID_PARAM)
              << "Invalid table_id: "
              << BcmFlowEntry::BcmTableType_Name(bcm_table_type) << ", found in "
              << bcm_flow_entry.ShortDebugString() << ".";
   }
+  VrfRouteIndex& route_index = vrf_to_route_index_[key.vrf];
+  (is_host ? route_index.host_routes : route_index.lpm_routes)
+      .Insert(prefix, action_params);
+
+  return ::util::OkStatus();
 }
 
 ::util::Status BcmL3Manager::ModifyTableEntry(
     const ::p4::v1::TableEntry& entry) {
-  BcmFlowEntry bcm_flow_entry;
+  RequestArena arena;
+  BcmFlowEntry& bcm_flow_entry = *arena.Create<BcmFlowEntry>();
   RETURN_IF_ERROR(bcm_table_manager_->FillBcmFlowEntry(
       entry, ::p4::v1::Update::MODIFY, &bcm_flow_entry));
   RETURN_IF_ERROR(ModifyLpmOrHostFlow(bcm_flow_entry));
@@ -389,34 +505,48 @@ BcmL3Manager::~BcmL3Manager() {}
   LpmOrHostActionParams action_params;
   RETURN_IF_ERROR(ExtractLpmOrHostKey(bcm_flow_entry, &key));
   RETURN_IF_ERROR(ExtractLpmOrHostActionParams(bcm_flow_entry, &action_params));
+  ASSIGN_OR_RETURN(IPRange prefix, ExtractLpmOrHostPrefix(bcm_flow_entry, key));
+  bool is_host = false;
   switch (bcm_table_type) {
     case BcmFlowEntry::BCM_TABLE_IPV4_LPM:
-      return bcm_sdk_interface_->ModifyL3RouteIpv4(
+      RETURN_IF_ERROR(bcm_sdk_interface_->ModifyL3RouteIpv4(
           unit, key.vrf, key.subnet_ipv4, key.mask_ipv4, action_params.class_id,
-          action_params.egress_intf_id, action_params.is_intf_multipath);
+          action_params.egress_intf_id, action_params.is_intf_multipath));
+      break;
     case BcmFlowEntry::BCM_TABLE_IPV4_HOST:
-      return bcm_sdk_interface_->ModifyL3HostIpv4(
+      RETURN_IF_ERROR(bcm_sdk_interface_->ModifyL3HostIpv4(
           unit, key.vrf, key.subnet_ipv4, action_params.class_id,
-          action_params.egress_intf_id);
+          action_params.egress_intf_id));
+      is_host = true;
+      break;
     case BcmFlowEntry::BCM_TABLE_IPV6_LPM:
-      return bcm_sdk_interface_->ModifyL3RouteIpv6(
+      RETURN_IF_ERROR(bcm_sdk_interface_->ModifyL3RouteIpv6(
           unit, key.vrf, key.subnet_ipv6, key.mask_ipv6, action_params.class_id,
-          action_params.egress_intf_id, action_params.is_intf_multipath);
+          action_params.egress_intf_id, action_params.is_intf_multipath));
+      break;
     case BcmFlowEntry::BCM_TABLE_IPV6_HOST:
-      return bcm_sdk_interface_->ModifyL3HostIpv6(
+      RETURN_IF_ERROR(bcm_sdk_interface_->ModifyL3HostIpv6(
           unit, key.vrf, key.subnet_ipv6, action_params.class_id,
-          action_params.egress_intf_id);
+          action_params.egress_intf_id));
+      is_host = true;
+      break;
     default:
       return MAKE_ERROR(ERR_INVALID_PARAM)
              << "Invalid bcm_table_type: "
              << BcmFlowEntry::BcmTableType_Name(bcm_table_type) << ", found in "
              << bcm_flow_entry.ShortDebugString() << ".";
   }
+  VrfRouteIndex& route_index = vrf_to_route_index_[key.vrf];
+  (is_host ? route_index.host_routes : route_index.lpm_routes)
+      .Insert(prefix, action_params);
+
+  return ::util::OkStatus();
 }
 
 ::util::Status BcmL3Manager::DeleteTableEntry(
     const ::p4::v1::TableEntry& entry) {
-  BcmFlowEntry bcm_flow_entry;
+  RequestArena arena;
+  BcmFlowEntry& bcm_flow_entry = *arena.Create<BcmFlowEntry>();
   RETURN_IF_ERROR(bcm_table_manager_->FillBcmFlowEntry(
       entry, ::p4::v1::Update::DELETE, &bcm_flow_entry));
   RETURN_IF_ERROR(DeleteLpmOrHostFlow(bcm_flow_entry));
@@ -426,17 +556,51 @@ BcmL3Manager::~BcmL3Manager() {}
 }
 
 ::util::Status BcmL3Manager::UpdateMultipathGroupsForPort(uint32 port_id) {
-  // Generate map from BCM multipath group id to data for all groups which
-  // reference the given port.
+  absl::Time start = absl::Now();
+  // Find the members to keep for all groups which reference the given port.
+  // The groups used by the largest number of routes come first.
   ASSIGN_OR_RETURN(
-      auto nexthops,
-      bcm_table_manager_->FillBcmMultipathNexthopsWithPort(port_id));
-  for (const auto& nexthop : nexthops) {
-    RETURN_IF_ERROR(ModifyMultipathNexthop(nexthop.first, nexthop.second));
+      auto updates,
+      bcm_table_manager_->GetMultipathGroupUpdatesForPort(port_id));
+  if (updates.empty()) return ::util::OkStatus();
+  std::vector<std::pair<int, std::vector<int>>> groups;
+  groups.reserve(updates.size());
+  for (const auto& update : updates) {
+    ASSIGN_OR_RETURN(std::vector<int> member_ids,
+                     FindEcmpGroupMembers(update.members));
+    groups.emplace_back(update.egress_intf_id, std::move(member_ids));
+  }
+  // Reprogram all the groups at once instead of one SDK call per group, which
+  // would keep the groups at the end of the list blackholing traffic until
+  // all the other groups are done.
+  RETURN_IF_ERROR(bcm_sdk_interface_->ModifyEcmpEgressIntfs(unit_, groups));
+  for (const auto& group : groups) {
+    EcmpGroupSlots* slots = gtl::FindOrNull(ecmp_group_slots_, group.first);
+    if (slots != nullptr) slots->programmed_slots = group.second.size();
   }
+  int64 usecs = absl::ToInt64Microseconds(absl::Now() - start);
+  multipath_failover_usecs_.Record(usecs);
+  VLOG(1) << "Updated " << groups.size() << " ECMP/WCMP groups referencing "
+          << "port " << port_id << " on unit " << unit_ << " in " << usecs
+          << " usecs.";
+
   return ::util::OkStatus();
 }
 
+EcmpMemberSlotStats BcmL3Manager::GetEcmpMemberSlotStats() const {
+  EcmpMemberSlotStats stats;
+  for (const auto& e : ecmp_group_slots_) {
+    const EcmpGroupSlots& slots = e.second;
+    stats.num_groups++;
+    stats.programmed_slots += slots.programmed_slots;
+    stats.saved_by_weight_reduction +=
+        std::max<int64>(0, slots.requested_slots - slots.programmed_slots);
+    stats.saved_by_sharing += (slots.ref_count - 1) * slots.programmed_slots;
+  }
+
+  return stats;
+}
+
 ::util::Status BcmL3Manager::DeleteLpmOrHostFlow(
     const BcmFlowEntry& bcm_flow_entry) {
   CHECK_RETURN_IF_FALSE(bcm_flow_entry.unit() == unit_)
@@ -445,25 +609,119 @@ BcmL3Manager::~BcmL3Manager() {}
   const auto bcm_table_type = bcm_flow_entry.bcm_table_type();
   LpmOrHostKey key;
   RETURN_IF_ERROR(ExtractLpmOrHostKey(bcm_flow_entry, &key));
+  ASSIGN_OR_RETURN(IPRange prefix, ExtractLpmOrHostPrefix(bcm_flow_entry, key));
+  bool is_host = false;
   switch (bcm_table_type) {
     case BcmFlowEntry::BCM_TABLE_IPV4_LPM:
-      return bcm_sdk_interface_->DeleteL3RouteIpv4(
-          unit_, key.vrf, key.subnet_ipv4, key.mask_ipv4);
+      RETURN_IF_ERROR(bcm_sdk_interface_->DeleteL3RouteIpv4(
+          unit_, key.vrf, key.subnet_ipv4, key.mask_ipv4));
+      break;
     case BcmFlowEntry::BCM_TABLE_IPV4_HOST:
-      return bcm_sdk_interface_->DeleteL3HostIpv4(unit_, key.vrf,
-                                                  key.subnet_ipv4);
+      RETURN_IF_ERROR(bcm_sdk_interface_->DeleteL3HostIpv4(unit_, key.vrf,
+                                                             key.subnet_ipv4));
+      is_host = true;
+      break;
     case BcmFlowEntry::BCM_TABLE_IPV6_LPM:
-      return bcm_sdk_interface_->DeleteL3RouteIpv6(
-          unit_, key.vrf, key.subnet_ipv6, key.mask_ipv6);
+      RETURN_IF_ERROR(bcm_sdk_interface_->DeleteL3RouteIpv6(
+          unit_, key.vrf, key.subnet_ipv6, key.mask_ipv6));
+      break;
     case BcmFlowEntry::BCM_TABLE_IPV6_HOST:
-      return bcm_sdk_interface_->DeleteL3HostIpv6(unit_, key.vrf,
-                                                  key.subnet_ipv6);
+      RETURN_IF_ERROR(bcm_sdk_interface_->DeleteL3HostIpv6(unit_, key.vrf,
+                                                             key.subnet_ipv6));
+      is_host = true;
+      break;
     default:
       return MAKE_ERROR(ERR_INVALID_PARAM)
              << "Invalid bcm_table_type: "
              << BcmFlowEntry::BcmTableType_Name(bcm_table_type) << ", found in "
              << bcm_flow_entry.ShortDebugString() << ".";
   }
+  auto* route_index = gtl::FindOrNull(vrf_to_route_index_, key.vrf);
+  if (route_index != nullptr) {
+    (is_host ? route_index->host_routes : route_index->lpm_routes)
+        .Remove(prefix);
+    if (route_index->empty()) vrf_to_route_index_.erase(key.vrf);
+  }
+
+  return ::util::OkStatus();
+}
+
+std::vector<L3Route> BcmL3Manager::GetRoutesCoveredBy(
+    int vrf, const IPRange& prefix) const {
+  std::vector<L3Route> lpm_routes, host_routes, routes;
+  const auto* route_index = gtl::FindOrNull(vrf_to_route_index_, vrf);
+  if (route_index == nullptr) return routes;
+  route_index->lpm_routes.ForEachCoveredBy(
+      prefix, AppendRouteFunctor(vrf, /*is_host=*/false, &lpm_routes));
+  route_index->host_routes.ForEachCoveredBy(
+      prefix, AppendRouteFunctor(vrf, /*is_host=*/true, &host_routes));
+  // Both lists are in address order. A host route comes after an LPM route
+  // with the same prefix.
+  std::merge(lpm_routes.begin(), lpm_routes.end(), host_routes.begin(),
+             host_routes.end(), std::back_inserter(routes),
+             [](const L3Route& a, const L3Route& b) {
+               if (a.prefix.host() != b.prefix.host()) {
+                 return IPAddressOrdering()(a.prefix.host(), b.prefix.host());
+               }
+               return a.prefix.length() < b.prefix.length();
+             });
+
+  return routes;
+}
+
+std::vector<L3Route> BcmL3Manager::GetRoutesCovering(
+    int vrf, const IPRange& prefix) const {
+  std::vector<L3Route> lpm_routes, host_routes, routes;
+  const auto* route_index = gtl::FindOrNull(vrf_to_route_index_, vrf);
+  if (route_index == nullptr) return routes;
+  route_index->lpm_routes.ForEachCovering(
+      prefix, AppendRouteFunctor(vrf, /*is_host=*/false, &lpm_routes));
+  route_index->host_routes.ForEachCovering(
+      prefix, AppendRouteFunctor(vrf, /*is_host=*/true, &host_routes));
+  // Both lists go from the least to the most specific. A host route comes
+  // after an LPM route with the same prefix.
+  std::merge(lpm_routes.begin(), lpm_routes.end(), host_routes.begin(),
+             host_routes.end(), std::back_inserter(routes),
+             [](const L3Route& a, const L3Route& b) {
+               return a.prefix.length() < b.prefix.length();
+             });
+
+  return routes;
+}
+
+std::string BcmL3Manager::DumpRoutes() const {
+  std::vector<int> vrfs;
+  for (const auto& e : vrf_to_route_index_) vrfs.push_back(e.first);
+  std::sort(vrfs.begin(), vrfs.end());
+  std::string dump;
+  for (int vrf : vrfs) {
+    absl::StrAppend(&dump, "VRF ", vrf, ":\n");
+    for (const char* all : {"0.0.0.0/0", "::/0"}) {
+      for (const auto& route :
+           GetRoutesCoveredBy(vrf, StringToIPRangeOrDie(all))) {
+        absl::StrAppend(&dump, "  ", route.prefix.ToString(),
+                        route.is_host ? " host" : " lpm", " class_id=",
+                        route.action_params.class_id, " egress_intf_id=",
+                        route.action_params.egress_intf_id,
+                        route.action_params.is_intf_multipath
+                            ? " (multipath)"
+                            : "");
+        // The covering routes end with the route itself, preceded by the
+        // route it shadows (the next less specific one).
+        std::vector<L3Route> covering = GetRoutesCovering(vrf, route.prefix);
+        for (auto it = covering.rbegin(); it != covering.rend(); ++it) {
+          if (it->prefix != route.prefix) {
+            absl::StrAppend(&dump, " shadows ", it->prefix.ToString(),
+                            it->is_host ? " host" : " lpm");
+            break;
+          }
+        }
+        absl::StrAppend(&dump, "\n");
+      }
+    }
+  }
+
+  return dump;
 }
 
 std::unique_ptr<BcmL3Manager> BcmL3Manager::CreateInstance(
@@ -546,6 +804,53 @@ std::unique_ptr<BcmL3Manager> BcmL3Manager::CreateInstance(
   return ::util::OkStatus();
 }
 
+::util::StatusOr<IPRange> BcmL3Manager::ExtractLpmOrHostPrefix(
+    const BcmFlowEntry& bcm_flow_entry, const LpmOrHostKey& key) {
+  const auto bcm_table_type = bcm_flow_entry.bcm_table_type();
+  switch (bcm_table_type) {
+    case BcmFlowEntry::BCM_TABLE_IPV4_LPM: {
+      int length = Bits::CountOnes(key.mask_ipv4);
+      CHECK_RETURN_IF_FALSE(
+          key.mask_ipv4 ==
+          static_cast<uint32>(~static_cast<uint64>(0) << (32 - length)))
+          << "Non-prefix IPV4_DST mask in LPM flow: "
+          << bcm_flow_entry.ShortDebugString() << ".";
+      return IPRange(HostUInt32ToIPAddress(key.subnet_ipv4), length);
+    }
+    case BcmFlowEntry::BCM_TABLE_IPV4_HOST:
+      return IPRange(HostUInt32ToIPAddress(key.subnet_ipv4), 32);
+    case BcmFlowEntry::BCM_TABLE_IPV6_LPM:
+    case BcmFlowEntry::BCM_TABLE_IPV6_HOST: {
+      // Subnets and masks shorter than an IPv6 address (e.g. for the
+      // IPV6_DST_UPPER_64 fields) hold its upper bytes.
+      CHECK_RETURN_IF_FALSE(key.subnet_ipv6.size() <= 16 &&
+                            key.mask_ipv6.size() <= 16)
+          << "Invalid IPV6_DST field in flow: "
+          << bcm_flow_entry.ShortDebugString() << ".";
+      std::string subnet = key.subnet_ipv6;
+      subnet.resize(16, '\0');
+      if (bcm_table_type == BcmFlowEntry::BCM_TABLE_IPV6_HOST) {
+        return IPRange(PackedStringToIPAddressOrDie(subnet), 128);
+      }
+      std::string mask = key.mask_ipv6;
+      mask.resize(16, '\0');
+      absl::uint128 mask_bits =
+          IPAddressToUInt128(PackedStringToIPAddressOrDie(mask));
+      int length = Bits::CountOnes128(mask_bits);
+      CHECK_RETURN_IF_FALSE(length == 0 ||
+                            mask_bits == ~absl::uint128(0) << (128 - length))
+          << "Non-prefix IPV6_DST mask in LPM flow: "
+          << bcm_flow_entry.ShortDebugString() << ".";
+      return IPRange(PackedStringToIPAddressOrDie(subnet), length);
+    }
+    default:
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Invalid bcm_table_type: "
+             << BcmFlowEntry::BcmTableType_Name(bcm_table_type) << ", found in "
+             << bcm_flow_entry.ShortDebugString() << ".";
+  }
+}
+
 ::util::Status BcmL3Manager::ExtractLpmOrHostActionParams(
     const BcmFlowEntry& bcm_flow_entry, LpmOrHostActionParams* action_params) {
   if (action_params == nullptr) {
@@ -676,7 +981,8 @@ std::unique_ptr<BcmL3Manager> BcmL3Manager::CreateInstance(
   // trunk ports being down or blocked. Add the default drop interface in that
   // case.
   if (!nexthop.members_size()) return std::vector<int>(1, default_drop_intf_);
-  std::vector<int> member_ids;
+  std::vector<std::pair<int, uint32>> members;
+  members.reserve(nexthop.members_size());
   for (const auto& member : nexthop.members()) {
     if (member.weight() == 0) {
       return MAKE_ERROR(ERR_INVALID_PARAM)
@@ -687,9 +993,41 @@ std::unique_ptr<BcmL3Manager> BcmL3Manager::CreateInstance(
              << "Invalid member egress_intf_id: " << nexthop.ShortDebugString()
              << ".";
     }
-    for (size_t i = 0; i < member.weight(); ++i) {
-      member_ids.push_back(member.egress_intf_id());
+    members.emplace_back(member.egress_intf_id(), member.weight());
+  }
+
+  return FindEcmpGroupMembers(members);
+}
+
+::util::StatusOr<std::vector<int>> BcmL3Manager::FindEcmpGroupMembers(
+    const std::vector<std::pair<int, uint32>>& members) {
+  // If this group has no members, it has been pruned due to member singleton or
+  // trunk ports being down or blocked. Add the default drop interface in that
+  // case.
+  if (members.empty()) return std::vector<int>(1, default_drop_intf_);
+  std::vector<uint32> weights;
+  weights.reserve(members.size());
+  for (const auto& member : members) {
+    if (member.second == 0) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Zero weight for member egress_intf_id: " << member.first
+             << ".";
+    }
+    if (member.first <= 0) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Invalid member egress_intf_id: " << member.first << ".";
     }
+    weights.push_back(member.second);
+  }
+  // WCMP weights are realized by repeating the members, so use the smallest
+  // weights giving (about) the same traffic split.
+  ReduceWcmpWeights(&weights);
+  RETURN_IF_ERROR(ApproximateWcmpWeights(
+      std::max(1, std::min(FLAGS_max_wcmp_group_size, kMaxEcmpGroupSize)),
+      &weights));
+  std::vector<int> member_ids;
+  for (size_t i = 0; i < members.size(); ++i) {
+    member_ids.insert(member_ids.end(), weights[i], members[i].first);
   }
   std::sort(member_ids.begin(), member_ids.end());  // sort the member ids
 
@@ -27,12 +27,16 @@
 #include "stratum/glue/integral_types.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "stratum/glue/net_util/ip_range_trie.h"
+#include "stratum/glue/net_util/ipaddress.h"
 #include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
 #include "stratum/hal/lib/bcm/bcm.pb.h"
 #include "stratum/hal/lib/bcm/bcm_sdk_interface.h"
 #include "stratum/hal/lib/bcm/bcm_table_manager.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/constants.h"
+#include "stratum/lib/latency_histogram.h"
 #include "stratum/lib/utils.h"
 
 namespace stratum {
@@ -70,6 +74,39 @@ struct LpmOrHostActionParams {
       : class_id(-1), egress_intf_id(-1), is_intf_multipath(false) {}
 };
 
+// This struct describes an IPv4/IPv6 LPM/host route programmed on a unit, as
+// returned by the route queries of BcmL3Manager.
+struct L3Route {
+  // The VRF of the route.
+  int vrf;
+  // The prefix matched by the route. Host routes are /32 or /128 prefixes.
+  IPRange prefix;
+  // True if the route is in the host table, false if it is in the LPM table.
+  bool is_host;
+  // The action params of the route.
+  LpmOrHostActionParams action_params;
+  L3Route() : vrf(kVrfDefault), prefix(), is_host(false), action_params() {}
+};
+
+// This struct reports the usage of the ECMP member table by the ECMP/WCMP
+// groups programmed on a unit.
+struct EcmpMemberSlotStats {
+  // Number of ECMP groups in hardware.
+  int64 num_groups;
+  // Number of ECMP member slots used by these groups.
+  int64 programmed_slots;
+  // Number of slots saved by reducing or approximating the WCMP weights, i.e.
+  // the sum of the weights given to the groups minus programmed_slots.
+  int64 saved_by_weight_reduction;
+  // Number of slots saved by programming identical groups only once.
+  int64 saved_by_sharing;
+  EcmpMemberSlotStats()
+      : num_groups(0),
+        programmed_slots(0),
+        saved_by_weight_reduction(0),
+        saved_by_sharing(0) {}
+};
+
 // The "BcmL3Manager" class implements the L3 routing functionality.
 class BcmL3Manager {
  public:
@@ -104,24 +141,36 @@ class BcmL3Manager {
   // Finds or creates an egress multipath (ECMP/WCMP) nexthop and returns its
   // egress intf ID. Note that it is perfectly OK for multiple groups to point
   // to the same egress intf ID, so we need to make sure if the egress intf
-  // is already there we just return its ID without returning error.
+  // is already there we just return its ID without returning error. The
+  // weights of the members are divided by their greatest common divisor, and
+  // approximated if they do not fit in --max_wcmp_group_size member slots.
   virtual ::util::StatusOr<int> FindOrCreateMultipathNexthop(
       const BcmMultipathNexthop& nexthop);
 
+  // Adds a reference to an existing egress multipath (ECMP/WCMP) nexthop, for
+  // a group with the same members as the one(s) it was created for. The
+  // nexthop is removed from hardware by DeleteMultipathNexthop() only once
+  // all the references are gone.
+  virtual ::util::Status ShareMultipathNexthop(int egress_intf_id);
+
   // Modifies an existing egress non-multipath nexthop given its ID. The same
   // egress ID will point to a new nexthop using this method.
   virtual ::util::Status ModifyNonMultipathNexthop(
       int egress_intf_id, const BcmNonMultipathNexthop& nexthop);
 
   // Modifies an existing egress multipath (ECMP/WCMP) nexthop given its ID
-  // with a new set of members given in BcmMultipathNexthop.
-  virtual ::util::Status ModifyMultipathNexthop(
+  // with a new set of members given in BcmMultipathNexthop. If the nexthop is
+  // shared by several groups (see ShareMultipathNexthop()), the other groups
+  // keep it and a new nexthop is created instead. Returns the egress intf ID
+  // of the modified group, to which the flows using the group must point.
+  virtual ::util::StatusOr<int> ModifyMultipathNexthop(
       int egress_intf_id, const BcmMultipathNexthop& nexthop);
 
   // Deletes an egress non-multipath nexthop given its ID.
   virtual ::util::Status DeleteNonMultipathNexthop(int egress_intf_id);
 
-  // Deletes an egress multipath (ECMP/WCMP) nexthop given its ID.
+  // Deletes an egress multipath (ECMP/WCMP) nexthop given its ID, or removes
+  // one of its references if it is shared.
   virtual ::util::Status DeleteMultipathNexthop(int egress_intf_id);
 
   // Inserts an IPv4/IPv6 L3 LPM/Host flow. The function programs the
@@ -144,8 +193,38 @@ class BcmL3Manager {
   // it based on whether the port is UP or not, respectively. In the case that
   // a group becomes empty, a drop egress interface will be substituted in
   // as the SDK does not support ECMP groups programmed with no nexthops.
+  // All the affected groups are reprogrammed in one batch, starting with the
+  // groups used by the largest number of routes. The time it takes is recorded
+  // in the histogram returned by GetMultipathFailoverHistogram().
   virtual ::util::Status UpdateMultipathGroupsForPort(uint32 port_id);
 
+  // Returns the LPM/host routes of the given VRF whose prefix is equal to or
+  // more specific than the given prefix (i.e. the routes shadowing part of
+  // it), in address order.
+  virtual std::vector<L3Route> GetRoutesCoveredBy(int vrf,
+                                                  const IPRange& prefix) const;
+
+  // Returns the LPM/host routes of the given VRF whose prefix is equal to or
+  // less specific than the given prefix (i.e. the routes shadowed by it),
+  // from the least to the most specific.
+  virtual std::vector<L3Route> GetRoutesCovering(int vrf,
+                                                 const IPRange& prefix) const;
+
+  // Returns a human readable dump of the LPM/host routes programmed on the
+  // unit, VRF by VRF. Each route is followed by the less specific route it
+  // shadows, if any. Used for debugging only.
+  virtual std::string DumpRoutes() const;
+
+  // Returns the histogram of the durations (in usecs) of all the calls to
+  // UpdateMultipathGroupsForPort() which had to update at least one group.
+  const LatencyHistogram& GetMultipathFailoverHistogram() const {
+    return multipath_failover_usecs_;
+  }
+
+  // Returns the usage of the ECMP member table by the ECMP/WCMP groups, and
+  // the number of member slots saved by weight reduction and group sharing.
+  virtual EcmpMemberSlotStats GetEcmpMemberSlotStats() const;
+
   // Factory function for creating the instance of the class.
   static std::unique_ptr<BcmL3Manager> CreateInstance(
       BcmSdkInterface* bcm_sdk_interface, BcmTableManager* bcm_table_manager,
@@ -160,6 +239,15 @@ class BcmL3Manager {
   BcmL3Manager();
 
  private:
+  // The index of the LPM/host routes programmed on the unit in one VRF. Host
+  // and LPM routes are indexed separately since they live in separate tables
+  // on the unit, where a host route and an LPM route can have the same prefix.
+  struct VrfRouteIndex {
+    IPRangeTrie<LpmOrHostActionParams> lpm_routes;
+    IPRangeTrie<LpmOrHostActionParams> host_routes;
+    bool empty() const { return lpm_routes.empty() && host_routes.empty(); }
+  };
+
   // Private constructor. Use CreateInstance() to create an instance of this
   // class.
   BcmL3Manager(BcmSdkInterface* bcm_sdk_interface,
@@ -183,17 +271,40 @@ class BcmL3Manager {
   ::util::Status ExtractLpmOrHostKey(const BcmFlowEntry& bcm_flow_entry,
                                      LpmOrHostKey* key);
 
+  // Helper to find the prefix matched by an IPv4/IPv6 L3 LPM/Host flow given
+  // its key.
+  ::util::StatusOr<IPRange> ExtractLpmOrHostPrefix(
+      const BcmFlowEntry& bcm_flow_entry, const LpmOrHostKey& key);
+
   // Helper to extract IPv4/IPv6 L3 LPM/Host flow actions given BcmFlowEntry.
   ::util::Status ExtractLpmOrHostActionParams(
       const BcmFlowEntry& bcm_flow_entry, LpmOrHostActionParams* action_params);
 
+  // The ECMP member slots and the references of an ECMP/WCMP group created by
+  // this class.
+  struct EcmpGroupSlots {
+    // Number of groups using this ECMP group (see ShareMultipathNexthop()).
+    uint32 ref_count;
+    // Sum of the weights of the members, as given to the class.
+    int64 requested_slots;
+    // Number of members programmed in hardware.
+    int64 programmed_slots;
+    EcmpGroupSlots()
+        : ref_count(0), requested_slots(0), programmed_slots(0) {}
+  };
+
   // A helper to find the sorted vector of the member egress intf ids of an
   // ECMP group. The output vector is going to have the following format:
   // [a,...,a,b,...,b,c,...,c,...] where each egress intf id is repeated based
-  // on its weight.
+  // on its weight, once the weights are reduced (see ReduceWcmpWeights() and
+  // ApproximateWcmpWeights()).
   ::util::StatusOr<std::vector<int>> FindEcmpGroupMembers(
       const BcmMultipathNexthop& nexthop);
 
+  // Same as above, for the members given as (egress intf id, weight) pairs.
+  ::util::StatusOr<std::vector<int>> FindEcmpGroupMembers(
+      const std::vector<std::pair<int, uint32>>& members);
+
   // Helpers for incrementing/decrementing the ref count for a router intf. In
   // case router intf has zero ref count, DecrementRefCount() will cleanup the
   // router intf from SDK as well.
@@ -206,6 +317,16 @@ class BcmL3Manager {
   // directly from SDK. Investigate.
   absl::flat_hash_map<int, uint32> router_intf_ref_count_;
 
+  // Map from VRF to the index of the LPM/host routes programmed on the unit in
+  // this VRF. Updated after each successful LPM/host flow write, and used to
+  // answer the route queries (GetRoutesCoveredBy(), etc.) without the SDK.
+  absl::flat_hash_map<int, VrfRouteIndex> vrf_to_route_index_;
+
+  // Map from the egress intf ID of the ECMP/WCMP groups created by this class
+  // to their member slots and ref counts. Groups missing from this map (e.g.
+  // modified but not created by this class) are never shared.
+  absl::flat_hash_map<int, EcmpGroupSlots> ecmp_group_slots_;
+
   // Pointer to a BcmSdkInterface implementation that wraps all the SDK calls.
   BcmSdkInterface* bcm_sdk_interface_;  // Not owned by this class.
 
@@ -226,6 +347,10 @@ class BcmL3Manager {
   // less than 2 active members due to port down events.
   int default_drop_intf_;
 
+  // Durations (in usecs) of the ECMP/WCMP group updates triggered by port
+  // state changes, i.e. the time traffic can be blackholed after a link down.
+  LatencyHistogram multipath_failover_usecs_;
+
   friend class BcmL3ManagerTest;
 };
 
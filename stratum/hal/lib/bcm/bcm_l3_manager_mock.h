@@ -40,9 +40,10 @@ class BcmL3ManagerMock : public BcmL3Manager {
   MOCK_METHOD2(ModifyNonMultipathNexthop,
                ::util::Status(int egress_intf_id,
                               const BcmNonMultipathNexthop& nexthop));
+  MOCK_METHOD1(ShareMultipathNexthop, ::util::Status(int egress_intf_id));
   MOCK_METHOD2(ModifyMultipathNexthop,
-               ::util::Status(int egress_intf_id,
-                              const BcmMultipathNexthop& nexthop));
+               ::util::StatusOr<int>(int egress_intf_id,
+                                     const BcmMultipathNexthop& nexthop));
   MOCK_METHOD1(DeleteNonMultipathNexthop, ::util::Status(int egress_intf_id));
   MOCK_METHOD1(DeleteMultipathNexthop, ::util::Status(int egress_intf_id));
   MOCK_METHOD1(InsertTableEntry,
@@ -52,6 +53,12 @@ class BcmL3ManagerMock : public BcmL3Manager {
   MOCK_METHOD1(DeleteTableEntry,
                ::util::Status(const ::p4::v1::TableEntry& entry));
   MOCK_METHOD1(UpdateMultipathGroupsForPort, ::util::Status(uint32 port_id));
+  MOCK_CONST_METHOD0(GetEcmpMemberSlotStats, EcmpMemberSlotStats());
+  MOCK_CONST_METHOD2(GetRoutesCoveredBy,
+                     std::vector<L3Route>(int vrf, const IPRange& prefix));
+  MOCK_CONST_METHOD2(GetRoutesCovering,
+                     std::vector<L3Route>(int vrf, const IPRange& prefix));
+  MOCK_CONST_METHOD0(DumpRoutes, std::string());
 };
 
 }  // namespace bcm
@@ -16,6 +16,8 @@
 
 #include "stratum/hal/lib/bcm/bcm_l3_manager.h"
 
+#include "gflags/gflags.h"
+#include "stratum/glue/net_util/ipaddress.h"
 #include "stratum/glue/status/status_test_util.h"
 #include "stratum/hal/lib/bcm/bcm_sdk_mock.h"
 #include "stratum/hal/lib/bcm/bcm_table_manager_mock.h"
@@ -28,6 +30,8 @@
 #include "absl/memory/memory.h"
 #include "stratum/glue/gtl/source_location.h"
 
+DECLARE_int32(max_wcmp_group_size);
+
 namespace stratum {
 namespace hal {
 namespace bcm {
@@ -97,9 +101,8 @@ class BcmL3ManagerTest : public ::testing::Test {
       member = wcmp_nexthop2_.add_members();
       member->set_egress_intf_id(kMemberEgressIntfId3);
       member->set_weight(kMemberWeight3);
-      for (int i = 0; i < kMemberWeight3; ++i) {
-        wcmp_group2_member_ids_.push_back(kMemberEgressIntfId3);
-      }
+      // The weight of a single member is always reduced to 1.
+      wcmp_group2_member_ids_.push_back(kMemberEgressIntfId3);
     }
   }
 
@@ -504,6 +507,51 @@ TEST_F(BcmL3ManagerTest,
   EXPECT_EQ(kEgressIntfId1, ret.ValueOrDie());
 }
 
+TEST_F(BcmL3ManagerTest,
+       FindOrCreateMultipathNexthopSuccessForGroupsWithReducibleWeights) {
+  // Weights {4, 6} take as many slots as {2, 3}.
+  wcmp_nexthop1_.mutable_members(0)->set_weight(2 * kMemberWeight1);
+  wcmp_nexthop1_.mutable_members(1)->set_weight(2 * kMemberWeight2);
+
+  // Expectations for the mock objects.
+  EXPECT_CALL(*bcm_sdk_mock_,
+              FindOrCreateEcmpEgressIntf(kUnit, wcmp_group1_member_ids_))
+      .WillOnce(Return(kEgressIntfId1));
+
+  auto ret = bcm_l3_manager_->FindOrCreateMultipathNexthop(wcmp_nexthop1_);
+  ASSERT_TRUE(ret.ok());
+  EXPECT_EQ(kEgressIntfId1, ret.ValueOrDie());
+  auto stats = bcm_l3_manager_->GetEcmpMemberSlotStats();
+  EXPECT_EQ(1, stats.num_groups);
+  EXPECT_EQ(kMemberWeight1 + kMemberWeight2, stats.programmed_slots);
+  EXPECT_EQ(kMemberWeight1 + kMemberWeight2, stats.saved_by_weight_reduction);
+  EXPECT_EQ(0, stats.saved_by_sharing);
+}
+
+TEST_F(BcmL3ManagerTest,
+       FindOrCreateMultipathNexthopSuccessForGroupsLargerThanMaxSize) {
+  ::gflags::FlagSaver flag_saver;
+  FLAGS_max_wcmp_group_size = 4;
+  // Weights {1, 1000} cannot fit in 4 slots and are approximated by {1, 3}.
+  wcmp_nexthop1_.mutable_members(0)->set_weight(1);
+  wcmp_nexthop1_.mutable_members(1)->set_weight(1000);
+
+  // Expectations for the mock objects.
+  EXPECT_CALL(*bcm_sdk_mock_,
+              FindOrCreateEcmpEgressIntf(
+                  kUnit, std::vector<int>(
+                             {kMemberEgressIntfId1, kMemberEgressIntfId2,
+                              kMemberEgressIntfId2, kMemberEgressIntfId2})))
+      .WillOnce(Return(kEgressIntfId1));
+
+  auto ret = bcm_l3_manager_->FindOrCreateMultipathNexthop(wcmp_nexthop1_);
+  ASSERT_TRUE(ret.ok());
+  EXPECT_EQ(kEgressIntfId1, ret.ValueOrDie());
+  auto stats = bcm_l3_manager_->GetEcmpMemberSlotStats();
+  EXPECT_EQ(4, stats.programmed_slots);
+  EXPECT_EQ(997, stats.saved_by_weight_reduction);
+}
+
 TEST_F(BcmL3ManagerTest,
        FindOrCreateMultipathNexthopFailureForZeroMemberWeight) {
   wcmp_nexthop1_.mutable_members(0)->clear_weight();
@@ -907,8 +955,35 @@ TEST_F(BcmL3ManagerTest, ModifyMultipathNexthopSuccess) {
                                                    wcmp_group1_member_ids_))
       .WillOnce(Return(::util::OkStatus()));
 
-  ASSERT_OK(
-      bcm_l3_manager_->ModifyMultipathNexthop(kEgressIntfId1, wcmp_nexthop1_));
+  auto ret =
+      bcm_l3_manager_->ModifyMultipathNexthop(kEgressIntfId1, wcmp_nexthop1_);
+  ASSERT_TRUE(ret.ok());
+  EXPECT_EQ(kEgressIntfId1, ret.ValueOrDie());
+}
+
+TEST_F(BcmL3ManagerTest, ModifyMultipathNexthopSuccessForSharedGroup) {
+  // Expectations for the mock objects. The group sharing the ECMP group gets
+  // a new one, the ECMP group itself is not changed.
+  EXPECT_CALL(*bcm_sdk_mock_,
+              FindOrCreateEcmpEgressIntf(kUnit, wcmp_group1_member_ids_))
+      .WillOnce(Return(kEgressIntfId1));
+  EXPECT_CALL(*bcm_sdk_mock_,
+              FindOrCreateEcmpEgressIntf(
+                  kUnit, std::vector<int>(
+                             {kMemberEgressIntfId3, kMemberEgressIntfId3})))
+      .WillOnce(Return(kEgressIntfId2));
+  EXPECT_CALL(*bcm_sdk_mock_, DeleteEcmpEgressIntf(kUnit, kEgressIntfId1))
+      .WillOnce(Return(::util::OkStatus()));
+
+  ASSERT_OK(bcm_l3_manager_->FindOrCreateMultipathNexthop(wcmp_nexthop1_));
+  ASSERT_OK(bcm_l3_manager_->ShareMultipathNexthop(kEgressIntfId1));
+  auto ret =
+      bcm_l3_manager_->ModifyMultipathNexthop(kEgressIntfId1, wcmp_nexthop2_);
+  ASSERT_TRUE(ret.ok());
+  EXPECT_EQ(kEgressIntfId2, ret.ValueOrDie());
+  // The ECMP group is no longer shared, so it is deleted with its last user.
+  ASSERT_OK(bcm_l3_manager_->DeleteMultipathNexthop(kEgressIntfId1));
+  EXPECT_EQ(1, bcm_l3_manager_->GetEcmpMemberSlotStats().num_groups);
 }
 
 TEST_F(BcmL3ManagerTest, ModifyMultipathNexthopFailureForInvalidEgressIntf) {
@@ -958,6 +1033,35 @@ TEST_F(BcmL3ManagerTest, DeleteMultipathNexthopSuccess) {
   ASSERT_OK(bcm_l3_manager_->DeleteMultipathNexthop(kEgressIntfId1));
 }
 
+TEST_F(BcmL3ManagerTest, DeleteMultipathNexthopSuccessForSharedGroup) {
+  // Expectations for the mock objects. The ECMP group is deleted only once all
+  // the groups sharing it are deleted.
+  EXPECT_CALL(*bcm_sdk_mock_,
+              FindOrCreateEcmpEgressIntf(kUnit, wcmp_group1_member_ids_))
+      .WillOnce(Return(kEgressIntfId1));
+  EXPECT_CALL(*bcm_sdk_mock_, DeleteEcmpEgressIntf(kUnit, kEgressIntfId1))
+      .WillOnce(Return(::util::OkStatus()));
+
+  ASSERT_OK(bcm_l3_manager_->FindOrCreateMultipathNexthop(wcmp_nexthop1_));
+  ASSERT_OK(bcm_l3_manager_->ShareMultipathNexthop(kEgressIntfId1));
+  ASSERT_OK(bcm_l3_manager_->ShareMultipathNexthop(kEgressIntfId1));
+  auto stats = bcm_l3_manager_->GetEcmpMemberSlotStats();
+  EXPECT_EQ(1, stats.num_groups);
+  const int64 kSlots = wcmp_group1_member_ids_.size();
+  EXPECT_EQ(kSlots, stats.programmed_slots);
+  EXPECT_EQ(2 * kSlots, stats.saved_by_sharing);
+  ASSERT_OK(bcm_l3_manager_->DeleteMultipathNexthop(kEgressIntfId1));
+  ASSERT_OK(bcm_l3_manager_->DeleteMultipathNexthop(kEgressIntfId1));
+  ASSERT_OK(bcm_l3_manager_->DeleteMultipathNexthop(kEgressIntfId1));
+  EXPECT_EQ(0, bcm_l3_manager_->GetEcmpMemberSlotStats().num_groups);
+}
+
+TEST_F(BcmL3ManagerTest, ShareMultipathNexthopFailureForUnknownGroup) {
+  auto status = bcm_l3_manager_->ShareMultipathNexthop(kEgressIntfId1);
+  ASSERT_FALSE(status.ok());
+  EXPECT_EQ(ERR_ENTRY_NOT_FOUND, status.error_code());
+}
+
 TEST_F(BcmL3ManagerTest, DeleteMultipathNexthopFailure) {
   // Expectations for the mock objects.
   EXPECT_CALL(*bcm_sdk_mock_, DeleteEcmpEgressIntf(kUnit, kEgressIntfId1))
@@ -971,38 +1075,71 @@ TEST_F(BcmL3ManagerTest, DeleteMultipathNexthopFailure) {
 }
 
 TEST_F(BcmL3ManagerTest, UpdateMultipathGroupsForPortSuccess) {
-  // Expectations for the mock objects.
-  absl::flat_hash_map<int, BcmMultipathNexthop> nexthops = {
-      {kEgressIntfId1, wcmp_nexthop1_}, {kEgressIntfId2, wcmp_nexthop2_}};
+  // Expectations for the mock objects. All the groups are updated in one SDK
+  // call, in the order returned by BcmTableManager.
+  std::vector<BcmMultipathGroupUpdate> updates = {
+      {kEgressIntfId2, 5, {{kMemberEgressIntfId3, kMemberWeight3}}},
+      {kEgressIntfId1,
+       1,
+       {{kMemberEgressIntfId1, kMemberWeight1},
+        {kMemberEgressIntfId2, kMemberWeight2}}}};
+  std::vector<std::pair<int, std::vector<int>>> groups = {
+      {kEgressIntfId2, wcmp_group2_member_ids_},
+      {kEgressIntfId1, wcmp_group1_member_ids_}};
   EXPECT_CALL(*bcm_table_manager_mock_,
-              FillBcmMultipathNexthopsWithPort(kLogicalPort))
-      .WillOnce(Return(nexthops));
-  EXPECT_CALL(*bcm_sdk_mock_, ModifyEcmpEgressIntf(kUnit, kEgressIntfId1,
-                                                   wcmp_group1_member_ids_))
+              GetMultipathGroupUpdatesForPort(kLogicalPort))
+      .WillOnce(Return(updates));
+  EXPECT_CALL(*bcm_sdk_mock_, ModifyEcmpEgressIntfs(kUnit, groups))
       .WillOnce(Return(::util::OkStatus()));
-  EXPECT_CALL(*bcm_sdk_mock_, ModifyEcmpEgressIntf(kUnit, kEgressIntfId2,
-                                                   wcmp_group2_member_ids_))
+
+  ASSERT_OK(bcm_l3_manager_->UpdateMultipathGroupsForPort(kLogicalPort));
+  EXPECT_EQ(1, bcm_l3_manager_->GetMultipathFailoverHistogram().Count());
+}
+
+TEST_F(BcmL3ManagerTest, UpdateMultipathGroupsForPortWithAllMembersDown) {
+  // Expectations for the mock objects. A group with no member left points to
+  // the default drop interface.
+  std::vector<BcmMultipathGroupUpdate> updates = {{kEgressIntfId1, 1, {}}};
+  std::vector<std::pair<int, std::vector<int>>> groups = {
+      {kEgressIntfId1, {kEgressIntfId2}}};
+  EXPECT_CALL(*bcm_sdk_mock_, FindOrCreateL3DropIntf(kUnit))
+      .WillOnce(Return(kEgressIntfId2));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              GetMultipathGroupUpdatesForPort(kLogicalPort))
+      .WillOnce(Return(updates));
+  EXPECT_CALL(*bcm_sdk_mock_, ModifyEcmpEgressIntfs(kUnit, groups))
       .WillOnce(Return(::util::OkStatus()));
 
+  ASSERT_OK(bcm_l3_manager_->PushChassisConfig(ChassisConfig(), kNodeId));
+  ASSERT_OK(bcm_l3_manager_->UpdateMultipathGroupsForPort(kLogicalPort));
+}
+
+TEST_F(BcmL3ManagerTest, UpdateMultipathGroupsForPortWithNoGroups) {
+  // Expectations for the mock objects. Nothing is programmed if the port is
+  // not used by any group.
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              GetMultipathGroupUpdatesForPort(kLogicalPort))
+      .WillOnce(Return(std::vector<BcmMultipathGroupUpdate>()));
+
   ASSERT_OK(bcm_l3_manager_->UpdateMultipathGroupsForPort(kLogicalPort));
+  EXPECT_EQ(0, bcm_l3_manager_->GetMultipathFailoverHistogram().Count());
 }
 
 TEST_F(BcmL3ManagerTest, UpdateMultipathGroupsForPortFailure) {
   // Expectations for the mock objects. First, the BcmTableManager call will
-  // fail, then one of the SDK calls will fail.
-  absl::flat_hash_map<int, BcmMultipathNexthop> nexthops = {
-      {kEgressIntfId1, wcmp_nexthop1_}, {kEgressIntfId2, wcmp_nexthop2_}};
+  // fail, then the SDK call will fail.
+  std::vector<BcmMultipathGroupUpdate> updates = {
+      {kEgressIntfId1,
+       1,
+       {{kMemberEgressIntfId1, kMemberWeight1},
+        {kMemberEgressIntfId2, kMemberWeight2}}},
+      {kEgressIntfId2, 1, {{kMemberEgressIntfId3, kMemberWeight3}}}};
   EXPECT_CALL(*bcm_table_manager_mock_,
-              FillBcmMultipathNexthopsWithPort(kLogicalPort))
+              GetMultipathGroupUpdatesForPort(kLogicalPort))
       .WillOnce(Return(::util::UnknownErrorBuilder(GTL_LOC) << "error1"))
-      .WillRepeatedly(Return(nexthops));
-  EXPECT_CALL(*bcm_sdk_mock_, ModifyEcmpEgressIntf(kUnit, kEgressIntfId1,
-                                                   wcmp_group1_member_ids_))
+      .WillRepeatedly(Return(updates));
+  EXPECT_CALL(*bcm_sdk_mock_, ModifyEcmpEgressIntfs(kUnit, _))
       .WillOnce(Return(::util::UnknownErrorBuilder(GTL_LOC) << "error2"));
-  // this one doesn't matter.
-  EXPECT_CALL(*bcm_sdk_mock_, ModifyEcmpEgressIntf(kUnit, kEgressIntfId2,
-                                                   wcmp_group2_member_ids_))
-      .WillRepeatedly(Return(::util::OkStatus()));
 
   auto status = bcm_l3_manager_->UpdateMultipathGroupsForPort(kLogicalPort);
   EXPECT_FALSE(status.ok());
@@ -1012,6 +1149,7 @@ TEST_F(BcmL3ManagerTest, UpdateMultipathGroupsForPortFailure) {
   EXPECT_FALSE(status.ok());
   EXPECT_EQ(ERR_UNKNOWN, status.error_code());
   EXPECT_EQ("error2", status.error_message());
+  EXPECT_EQ(0, bcm_l3_manager_->GetMultipathFailoverHistogram().Count());
 }
 
 // TODO(unknown): Define static proto text and others constants in the test
@@ -1906,6 +2044,200 @@ TEST_F(BcmL3ManagerTest, DeleteLpmOrHostFlowP4ConversionFailure) {
   ASSERT_FALSE(bcm_l3_manager_->DeleteTableEntry(p4_table_entry).ok());
 }
 
+namespace {
+
+// Returns an IPv4 flow in VRF 80 pointing to the given egress intf. The flow
+// is an LPM flow if mask is non-zero, and a host flow otherwise.
+BcmFlowEntry Ipv4RouteFlow(uint32 subnet, uint32 mask, int egress_intf_id) {
+  BcmFlowEntry bcm_flow_entry;
+  bcm_flow_entry.set_unit(3);
+  bcm_flow_entry.set_bcm_table_type(mask != 0
+                                        ? BcmFlowEntry::BCM_TABLE_IPV4_LPM
+                                        : BcmFlowEntry::BCM_TABLE_IPV4_HOST);
+  auto* field = bcm_flow_entry.add_fields();
+  field->set_type(BcmField::IPV4_DST);
+  field->mutable_value()->set_u32(subnet);
+  if (mask != 0) field->mutable_mask()->set_u32(mask);
+  field = bcm_flow_entry.add_fields();
+  field->set_type(BcmField::VRF);
+  field->mutable_value()->set_u32(80);
+  auto* action = bcm_flow_entry.add_actions();
+  action->set_type(BcmAction::OUTPUT_PORT);
+  auto* param = action->add_params();
+  param->set_type(BcmAction::Param::EGRESS_INTF_ID);
+  param->mutable_value()->set_u32(egress_intf_id);
+  return bcm_flow_entry;
+}
+
+}  // namespace
+
+TEST_F(BcmL3ManagerTest, RouteQueriesFollowLpmAndHostFlowWrites) {
+  EXPECT_CALL(*bcm_sdk_mock_, AddL3RouteIpv4(kUnit, 80, _, _, _, _, false))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_sdk_mock_, AddL3HostIpv4(kUnit, 80, _, _, _))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_sdk_mock_, ModifyL3RouteIpv4(kUnit, 80, _, _, _, _, false))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_sdk_mock_, DeleteL3RouteIpv4(kUnit, 80, _, _))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_table_manager_mock_, AddTableEntry(_))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_table_manager_mock_, UpdateTableEntry(_))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_table_manager_mock_, DeleteTableEntry(_))
+      .WillRepeatedly(Return(::util::OkStatus()));
+
+  // 192.160.0.0/16, 192.160.1.0/24 and 192.160.1.5/32 (host).
+  ASSERT_OK(bcm_l3_manager_->InsertTableEntry(ExpectFlowConversion(
+      ::p4::v1::Update::INSERT, Ipv4RouteFlow(0xc0a00000, 0xffff0000, 1))));
+  ASSERT_OK(bcm_l3_manager_->InsertTableEntry(ExpectFlowConversion(
+      ::p4::v1::Update::INSERT, Ipv4RouteFlow(0xc0a00100, 0xffffff00, 2))));
+  ASSERT_OK(bcm_l3_manager_->InsertTableEntry(ExpectFlowConversion(
+      ::p4::v1::Update::INSERT, Ipv4RouteFlow(0xc0a00105, 0, 3))));
+
+  std::vector<L3Route> routes = bcm_l3_manager_->GetRoutesCoveredBy(
+      80, StringToIPRangeOrDie("192.160.0.0/16"));
+  ASSERT_EQ(3, routes.size());
+  EXPECT_EQ(StringToIPRangeOrDie("192.160.0.0/16"), routes[0].prefix);
+  EXPECT_FALSE(routes[0].is_host);
+  EXPECT_EQ(StringToIPRangeOrDie("192.160.1.0/24"), routes[1].prefix);
+  EXPECT_EQ(2, routes[1].action_params.egress_intf_id);
+  EXPECT_EQ(StringToIPRangeOrDie("192.160.1.5/32"), routes[2].prefix);
+  EXPECT_TRUE(routes[2].is_host);
+  EXPECT_EQ(3, routes[2].action_params.egress_intf_id);
+  EXPECT_TRUE(bcm_l3_manager_
+                  ->GetRoutesCoveredBy(kVrfDefault,
+                                       StringToIPRangeOrDie("0.0.0.0/0"))
+                  .empty());
+  routes = bcm_l3_manager_->GetRoutesCovering(
+      80, StringToIPRangeOrDie("192.160.1.0/24"));
+  ASSERT_EQ(2, routes.size());
+  EXPECT_EQ(StringToIPRangeOrDie("192.160.0.0/16"), routes[0].prefix);
+  EXPECT_EQ(80, routes[0].vrf);
+  EXPECT_EQ(StringToIPRangeOrDie("192.160.1.0/24"), routes[1].prefix);
+
+  // Modify the /16 route and remove the /24 one.
+  ASSERT_OK(bcm_l3_manager_->ModifyTableEntry(ExpectFlowConversion(
+      ::p4::v1::Update::MODIFY, Ipv4RouteFlow(0xc0a00000, 0xffff0000, 4))));
+  ASSERT_OK(bcm_l3_manager_->DeleteTableEntry(ExpectFlowConversion(
+      ::p4::v1::Update::DELETE, Ipv4RouteFlow(0xc0a00100, 0xffffff00, 2))));
+  routes = bcm_l3_manager_->GetRoutesCovering(
+      80, StringToIPRangeOrDie("192.160.1.6/32"));
+  ASSERT_EQ(1, routes.size());
+  EXPECT_EQ(StringToIPRangeOrDie("192.160.0.0/16"), routes[0].prefix);
+  EXPECT_EQ(4, routes[0].action_params.egress_intf_id);
+  EXPECT_EQ(
+      "VRF 80:\n"
+      "  192.160.0.0/16 lpm class_id=-1 egress_intf_id=4\n"
+      "  192.160.1.5/32 host class_id=-1 egress_intf_id=3 shadows "
+      "192.160.0.0/16 lpm\n",
+      bcm_l3_manager_->DumpRoutes());
+
+  // Shutdown clears all the routes.
+  ASSERT_OK(bcm_l3_manager_->Shutdown());
+  EXPECT_TRUE(bcm_l3_manager_
+                  ->GetRoutesCoveredBy(80, StringToIPRangeOrDie("0.0.0.0/0"))
+                  .empty());
+}
+
+TEST_F(BcmL3ManagerTest, RouteQueriesIgnoreFailedFlowWrites) {
+  BcmFlowEntry bcm_flow_entry = Ipv4RouteFlow(0xc0a00100, 0xffffff00, 2);
+  EXPECT_CALL(*bcm_sdk_mock_, AddL3RouteIpv4(kUnit, 80, 0xc0a00100, 0xffffff00,
+                                             -1, 2, false))
+      .WillOnce(Return(::util::UnknownErrorBuilder(GTL_LOC) << "error"));
+
+  EXPECT_FALSE(bcm_l3_manager_
+                   ->InsertTableEntry(ExpectFlowConversion(
+                       ::p4::v1::Update::INSERT, bcm_flow_entry))
+                   .ok());
+  EXPECT_TRUE(bcm_l3_manager_
+                  ->GetRoutesCoveredBy(80, StringToIPRangeOrDie("0.0.0.0/0"))
+                  .empty());
+}
+
+TEST_F(BcmL3ManagerTest, RouteQueriesKeepHostAndLpmFlowsWithSamePrefix) {
+  EXPECT_CALL(*bcm_sdk_mock_, AddL3RouteIpv4(kUnit, 80, _, _, _, _, false))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_sdk_mock_, AddL3HostIpv4(kUnit, 80, _, _, _))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_sdk_mock_, DeleteL3HostIpv4(kUnit, 80, _))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_table_manager_mock_, AddTableEntry(_))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_table_manager_mock_, DeleteTableEntry(_))
+      .WillOnce(Return(::util::OkStatus()));
+
+  // 192.160.1.5/32 both in the LPM table and in the host table.
+  ASSERT_OK(bcm_l3_manager_->InsertTableEntry(ExpectFlowConversion(
+      ::p4::v1::Update::INSERT, Ipv4RouteFlow(0xc0a00105, 0xffffffff, 1))));
+  ASSERT_OK(bcm_l3_manager_->InsertTableEntry(ExpectFlowConversion(
+      ::p4::v1::Update::INSERT, Ipv4RouteFlow(0xc0a00105, 0, 2))));
+  std::vector<L3Route> routes = bcm_l3_manager_->GetRoutesCoveredBy(
+      80, StringToIPRangeOrDie("192.160.1.5/32"));
+  ASSERT_EQ(2, routes.size());
+  EXPECT_FALSE(routes[0].is_host);
+  EXPECT_EQ(1, routes[0].action_params.egress_intf_id);
+  EXPECT_TRUE(routes[1].is_host);
+  EXPECT_EQ(2, routes[1].action_params.egress_intf_id);
+
+  // Deleting the host route keeps the LPM one.
+  ASSERT_OK(bcm_l3_manager_->DeleteTableEntry(ExpectFlowConversion(
+      ::p4::v1::Update::DELETE, Ipv4RouteFlow(0xc0a00105, 0, 2))));
+  routes = bcm_l3_manager_->GetRoutesCovering(
+      80, StringToIPRangeOrDie("192.160.1.5/32"));
+  ASSERT_EQ(1, routes.size());
+  EXPECT_FALSE(routes[0].is_host);
+  EXPECT_EQ(1, routes[0].action_params.egress_intf_id);
+}
+
+TEST_F(BcmL3ManagerTest, InsertLpmOrHostFlowFailureForNonPrefixMask) {
+  BcmFlowEntry bcm_flow_entry = Ipv4RouteFlow(0xc0a00100, 0xff00ff00, 2);
+  EXPECT_CALL(*bcm_table_manager_mock_, AddTableEntry(_)).Times(0);
+
+  auto status = bcm_l3_manager_->InsertTableEntry(
+      ExpectFlowConversion(::p4::v1::Update::INSERT, bcm_flow_entry));
+  EXPECT_EQ(ERR_INVALID_PARAM, status.error_code());
+  EXPECT_THAT(status.error_message(), HasSubstr("Non-prefix IPV4_DST mask"));
+}
+
+TEST_F(BcmL3ManagerTest, RouteQueriesForIpv6LpmFlowWithUpper64Mask) {
+  BcmFlowEntry bcm_flow_entry;
+  ASSERT_OK(ParseProtoFromString(R"(
+      unit: 3
+      bcm_table_type: BCM_TABLE_IPV6_LPM
+      fields: {
+        type: IPV6_DST_UPPER_64
+        value {
+          b: "\x20\x01\x0d\xb8\x00\x01\x00\x00"
+        }
+        mask {
+          b: "\xff\xff\xff\xff\xff\xff\x00\x00"
+        }
+      }
+      actions: {
+        type: OUTPUT_L3
+        params {
+          type: EGRESS_INTF_ID
+          value {
+            u32: 200256
+          }
+        }
+      }
+  )", &bcm_flow_entry));
+  EXPECT_CALL(*bcm_sdk_mock_, AddL3RouteIpv6(kUnit, 0, _, _, -1, 200256, true))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_table_manager_mock_, AddTableEntry(_))
+      .WillOnce(Return(::util::OkStatus()));
+
+  ASSERT_OK(bcm_l3_manager_->InsertTableEntry(
+      ExpectFlowConversion(::p4::v1::Update::INSERT, bcm_flow_entry)));
+  std::vector<L3Route> routes = bcm_l3_manager_->GetRoutesCovering(
+      kVrfDefault, StringToIPRangeOrDie("2001:db8:1::1/128"));
+  ASSERT_EQ(1, routes.size());
+  EXPECT_EQ(StringToIPRangeOrDie("2001:db8:1::/48"), routes[0].prefix);
+  EXPECT_TRUE(routes[0].action_params.is_intf_multipath);
+}
+
 // TODO(unknown): Add more coverage for the failure case.
 
 }  // namespace bcm
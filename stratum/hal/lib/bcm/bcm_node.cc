@@ -18,6 +18,7 @@
 
 #include "gflags/gflags.h"
 #include "stratum/lib/macros.h"
+#include "stratum/lib/request_arena.h"
 #include "stratum/hal/lib/bcm/bcm_node.h"
 #include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
@@ -32,14 +33,16 @@ namespace stratum {
 namespace hal {
 namespace bcm {
 
-BcmNode::BcmNode(BcmAclManager* bcm_acl_manager, BcmL2Manager* bcm_l2_manager,
-                 BcmL3Manager* bcm_l3_manager,
+BcmNode::BcmNode(BcmAclManager* bcm_acl_manager,
+                 BcmIdleTimeoutManager* bcm_idle_timeout_manager,
+                 BcmL2Manager* bcm_l2_manager, BcmL3Manager* bcm_l3_manager,
                  BcmPacketioManager* bcm_packetio_manager,
                  BcmTableManager* bcm_table_manager,
                  BcmTunnelManager* bcm_tunnel_manager,
                  P4TableMapper* p4_table_mapper, int unit)
     : initialized_(false),
       bcm_acl_manager_(ABSL_DIE_IF_NULL(bcm_acl_manager)),
+      bcm_idle_timeout_manager_(bcm_idle_timeout_manager),
       bcm_l2_manager_(ABSL_DIE_IF_NULL(bcm_l2_manager)),
       bcm_l3_manager_(ABSL_DIE_IF_NULL(bcm_l3_manager)),
       bcm_packetio_manager_(ABSL_DIE_IF_NULL(bcm_packetio_manager)),
@@ -52,6 +55,7 @@ BcmNode::BcmNode(BcmAclManager* bcm_acl_manager, BcmL2Manager* bcm_l2_manager,
 BcmNode::BcmNode()
     : initialized_(false),
       bcm_acl_manager_(nullptr),
+      bcm_idle_timeout_manager_(nullptr),
       bcm_l2_manager_(nullptr),
       bcm_l3_manager_(nullptr),
       bcm_packetio_manager_(nullptr),
@@ -122,6 +126,10 @@ BcmNode::~BcmNode() {}
       << node_id_ << ".";
   RETURN_IF_ERROR(StaticEntryWrite(p4_pipeline_config, /*post_push=*/false));
   RETURN_IF_ERROR(p4_table_mapper_->PushForwardingPipelineConfig(config));
+  // The table IDs of the flows programmed so far may not be valid anymore.
+  if (bcm_idle_timeout_manager_ != nullptr) {
+    bcm_idle_timeout_manager_->UntrackAllTableEntries();
+  }
   RETURN_IF_ERROR(bcm_acl_manager_->PushForwardingPipelineConfig(config));
   RETURN_IF_ERROR(bcm_tunnel_manager_->PushForwardingPipelineConfig(config));
   RETURN_IF_ERROR(StaticEntryWrite(p4_pipeline_config, /*post_push=*/true));
@@ -147,6 +155,9 @@ BcmNode::~BcmNode() {}
   absl::WriterMutexLock l(&lock_);
   auto status = ::util::OkStatus();
   APPEND_STATUS_IF_ERROR(status, bcm_packetio_manager_->Shutdown());
+  if (bcm_idle_timeout_manager_ != nullptr) {
+    APPEND_STATUS_IF_ERROR(status, bcm_idle_timeout_manager_->Shutdown());
+  }
   APPEND_STATUS_IF_ERROR(status, bcm_tunnel_manager_->Shutdown());
   APPEND_STATUS_IF_ERROR(status, bcm_acl_manager_->Shutdown());
   APPEND_STATUS_IF_ERROR(status, bcm_l3_manager_->Shutdown());
@@ -345,6 +356,33 @@ BcmNode::~BcmNode() {}
       GoogleConfig::BCM_KNET_INTF_PURPOSE_CONTROLLER);
 }
 
+::util::Status BcmNode::RegisterIdleTimeoutNotificationWriter(
+    const std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>&
+        writer) {
+  absl::WriterMutexLock l(&lock_);
+  if (!initialized_) {
+    return MAKE_ERROR(ERR_NOT_INITIALIZED) << "Not initialized!";
+  }
+  if (bcm_idle_timeout_manager_ == nullptr) {
+    return MAKE_ERROR(ERR_UNIMPLEMENTED)
+           << "Idle timeouts are not supported on node " << node_id_ << ".";
+  }
+  return bcm_idle_timeout_manager_->RegisterIdleTimeoutNotificationWriter(
+      writer);
+}
+
+::util::Status BcmNode::UnregisterIdleTimeoutNotificationWriter() {
+  absl::WriterMutexLock l(&lock_);
+  if (!initialized_) {
+    return MAKE_ERROR(ERR_NOT_INITIALIZED) << "Not initialized!";
+  }
+  if (bcm_idle_timeout_manager_ == nullptr) {
+    return MAKE_ERROR(ERR_UNIMPLEMENTED)
+           << "Idle timeouts are not supported on node " << node_id_ << ".";
+  }
+  return bcm_idle_timeout_manager_->UnregisterIdleTimeoutNotificationWriter();
+}
+
 ::util::Status BcmNode::TransmitPacket(const ::p4::v1::PacketOut& packet) {
   absl::ReaderMutexLock l(&lock_);
   if (!initialized_) {
@@ -364,14 +402,25 @@ BcmNode::~BcmNode() {}
   return ::util::OkStatus();
 }
 
+::util::StatusOr<std::string> BcmNode::GetL3RouteDebugString() {
+  absl::ReaderMutexLock l(&lock_);
+  if (!initialized_) {
+    return MAKE_ERROR(ERR_NOT_INITIALIZED) << "Not initialized!";
+  }
+  return bcm_l3_manager_->DumpRoutes();
+}
+
 std::unique_ptr<BcmNode> BcmNode::CreateInstance(
-    BcmAclManager* bcm_acl_manager, BcmL2Manager* bcm_l2_manager,
-    BcmL3Manager* bcm_l3_manager, BcmPacketioManager* bcm_packetio_manager,
+    BcmAclManager* bcm_acl_manager,
+    BcmIdleTimeoutManager* bcm_idle_timeout_manager,
+    BcmL2Manager* bcm_l2_manager, BcmL3Manager* bcm_l3_manager,
+    BcmPacketioManager* bcm_packetio_manager,
     BcmTableManager* bcm_table_manager, BcmTunnelManager* bcm_tunnel_manager,
     P4TableMapper* p4_table_mapper, int unit) {
   return absl::WrapUnique(new BcmNode(
-      bcm_acl_manager, bcm_l2_manager, bcm_l3_manager, bcm_packetio_manager,
-      bcm_table_manager, bcm_tunnel_manager, p4_table_mapper, unit));
+      bcm_acl_manager, bcm_idle_timeout_manager, bcm_l2_manager,
+      bcm_l3_manager, bcm_packetio_manager, bcm_table_manager,
+      bcm_tunnel_manager, p4_table_mapper, unit));
 }
 
 ::util::Status BcmNode::StaticEntryWrite(const P4PipelineConfig& config,
@@ -506,11 +555,20 @@ std::unique_ptr<BcmNode> BcmNode::CreateInstance(
                                    ::p4::v1::Update::Type type) {
   CHECK_RETURN_IF_FALSE(type != ::p4::v1::Update::UNSPECIFIED);
 
-  // We populate BcmFlowEntry based on the given TableEntry.
-  BcmFlowEntry bcm_flow_entry;
+  // We populate BcmFlowEntry based on the given TableEntry. The BcmFlowEntry
+  // and the intermediate protos created by FillBcmFlowEntry() are allocated on
+  // an arena which is freed in one step when we are done with this entry.
+  RequestArena arena;
+  BcmFlowEntry& bcm_flow_entry = *arena.Create<BcmFlowEntry>();
   RETURN_IF_ERROR(
       bcm_table_manager_->FillBcmFlowEntry(entry, type, &bcm_flow_entry));
   BcmFlowEntry::BcmTableType bcm_table_type = bcm_flow_entry.bcm_table_type();
+  // A flow is only programmed with an idle timeout if it can be aged out.
+  if (bcm_idle_timeout_manager_ != nullptr &&
+      type != ::p4::v1::Update::DELETE && entry.idle_timeout_ns() > 0) {
+    RETURN_IF_ERROR(bcm_idle_timeout_manager_->CheckIdleTimeoutSupported(
+        entry, bcm_flow_entry));
+  }
   // Try to program the flow.
   bool consumed = false;  // will be set to true if we know what to do
   switch (type) {
@@ -646,6 +704,15 @@ std::unique_ptr<BcmNode> BcmNode::CreateInstance(
       << BcmFlowEntry::BcmTableType_Name(bcm_table_type)
       << ". ::p4::v1::TableEntry: " << entry.ShortDebugString() << ".";
 
+  if (bcm_idle_timeout_manager_ != nullptr) {
+    if (type == ::p4::v1::Update::DELETE) {
+      bcm_idle_timeout_manager_->UntrackTableEntry(entry, bcm_flow_entry);
+    } else {
+      RETURN_IF_ERROR(
+          bcm_idle_timeout_manager_->TrackTableEntry(entry, bcm_flow_entry));
+    }
+  }
+
   return ::util::OkStatus();
 }
 
@@ -848,13 +915,27 @@ namespace {
       BcmMultipathNexthop nexthop;
       RETURN_IF_ERROR(bcm_table_manager_->FillBcmMultipathNexthop(
           group, &nexthop));  // will error out if any member not found
-      ASSIGN_OR_RETURN(int egress_intf_id,
-                       bcm_l3_manager_->FindOrCreateMultipathNexthop(nexthop));
+      // Groups with the same members and (reduced) weights share the same
+      // hardware group, which saves ECMP member table slots.
+      int egress_intf_id =
+          bcm_table_manager_->FindShareableMultipathNexthop(group);
+      if (egress_intf_id > 0) {
+        RETURN_IF_ERROR(bcm_l3_manager_->ShareMultipathNexthop(egress_intf_id));
+      } else {
+        ASSIGN_OR_RETURN(
+            egress_intf_id,
+            bcm_l3_manager_->FindOrCreateMultipathNexthop(nexthop));
+      }
       // Update the internal records in BcmTableManager. Note that if the
-      // egress intf ID is already assigned to an existing group, this method
-      // will return error.
-      RETURN_IF_ERROR(
-          bcm_table_manager_->AddActionProfileGroup(group, egress_intf_id));
+      // egress intf ID is already assigned to an existing group which cannot
+      // be shared, this method will return error.
+      ::util::Status status =
+          bcm_table_manager_->AddActionProfileGroup(group, egress_intf_id);
+      if (!status.ok()) {
+        APPEND_STATUS_IF_ERROR(
+            status, bcm_l3_manager_->DeleteMultipathNexthop(egress_intf_id));
+        return status;
+      }
       consumed = true;
       break;
     }
@@ -878,11 +959,43 @@ namespace {
       CHECK_RETURN_IF_FALSE(unit_ == nexthop.unit())
           << "Something is wrong. This should never happen (" << unit_
           << " != " << nexthop.unit() << ").";
-      RETURN_IF_ERROR(
+      ASSIGN_OR_RETURN(
+          int new_egress_intf_id,
           bcm_l3_manager_->ModifyMultipathNexthop(egress_intf_id, nexthop));
-      // Update the internal records in BcmTableManager. Note that there
-      // is no change in the egress intf for the group so no need to pass
-      // anything else to the function.
+      if (new_egress_intf_id != egress_intf_id) {
+        // The group was sharing its hardware group and got one of its own.
+        // Move the flows pointing to the group to the new hardware group.
+        std::vector<::p4::v1::TableEntry> entries;
+        if (info.flow_ref_count > 0) {
+          entries = bcm_table_manager_->GetTableEntriesForGroup(group_id);
+        }
+        ::util::Status status =
+            bcm_table_manager_->UpdateActionProfileGroupEgressIntf(
+                group_id, new_egress_intf_id);
+        size_t num_moved = 0;
+        while (status.ok() && num_moved < entries.size()) {
+          status = bcm_l3_manager_->ModifyTableEntry(entries[num_moved]);
+          if (status.ok()) ++num_moved;
+        }
+        if (!status.ok()) {
+          // Move the flows back to the shared hardware group, take back the
+          // reference to it and delete the new hardware group.
+          APPEND_STATUS_IF_ERROR(
+              status, bcm_table_manager_->UpdateActionProfileGroupEgressIntf(
+                          group_id, egress_intf_id));
+          for (size_t i = 0; i < num_moved; ++i) {
+            APPEND_STATUS_IF_ERROR(
+                status, bcm_l3_manager_->ModifyTableEntry(entries[i]));
+          }
+          APPEND_STATUS_IF_ERROR(
+              status, bcm_l3_manager_->ShareMultipathNexthop(egress_intf_id));
+          APPEND_STATUS_IF_ERROR(
+              status,
+              bcm_l3_manager_->DeleteMultipathNexthop(new_egress_intf_id));
+          return status;
+        }
+      }
+      // Update the internal records in BcmTableManager.
       RETURN_IF_ERROR(bcm_table_manager_->UpdateActionProfileGroup(group));
       consumed = true;
       break;
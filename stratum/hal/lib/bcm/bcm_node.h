@@ -20,10 +20,12 @@
 #define STRATUM_HAL_LIB_BCM_BCM_NODE_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "stratum/hal/lib/bcm/bcm_acl_manager.h"
 #include "stratum/hal/lib/bcm/bcm_global_vars.h"
+#include "stratum/hal/lib/bcm/bcm_idle_timeout_manager.h"
 #include "stratum/hal/lib/bcm/bcm_l2_manager.h"
 #include "stratum/hal/lib/bcm/bcm_l3_manager.h"
 #include "stratum/hal/lib/bcm/bcm_packetio_manager.h"
@@ -107,6 +109,16 @@ class BcmNode {
   virtual ::util::Status UnregisterPacketReceiveWriter()
       SHARED_LOCKS_REQUIRED(chassis_lock) LOCKS_EXCLUDED(lock_);
 
+  // Registers a writer to be invoked when some of the table entries programmed
+  // with an idle timeout on this node have not been hit for their timeout.
+  virtual ::util::Status RegisterIdleTimeoutNotificationWriter(
+      const std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>&
+          writer) SHARED_LOCKS_REQUIRED(chassis_lock) LOCKS_EXCLUDED(lock_);
+
+  // Unregisters writer registered in RegisterIdleTimeoutNotificationWriter().
+  virtual ::util::Status UnregisterIdleTimeoutNotificationWriter()
+      SHARED_LOCKS_REQUIRED(chassis_lock) LOCKS_EXCLUDED(lock_);
+
   // Transmits a packet received from controller directly to a port on this node
   // or to the ingress pipeline of the node to let the chip route the packet.
   // The given P4 PacketOut instance includes all the info on where to
@@ -119,10 +131,19 @@ class BcmNode {
   virtual ::util::Status UpdatePortState(uint32 port_id)
       SHARED_LOCKS_REQUIRED(chassis_lock) LOCKS_EXCLUDED(lock_);
 
-  // Factory function for creating a BcmNode instance.
+  // Returns a human readable dump of the L3 LPM/host routes programmed on this
+  // node. Used for debugging only.
+  virtual ::util::StatusOr<std::string> GetL3RouteDebugString()
+      SHARED_LOCKS_REQUIRED(chassis_lock) LOCKS_EXCLUDED(lock_);
+
+  // Factory function for creating a BcmNode instance. The
+  // bcm_idle_timeout_manager may be nullptr, in which case the flows are not
+  // aged and their idle_timeout_ns is ignored.
   static std::unique_ptr<BcmNode> CreateInstance(
-      BcmAclManager* bcm_acl_manager, BcmL2Manager* bcm_l2_manager,
-      BcmL3Manager* bcm_l3_manager, BcmPacketioManager* bcm_packetio_manager,
+      BcmAclManager* bcm_acl_manager,
+      BcmIdleTimeoutManager* bcm_idle_timeout_manager,
+      BcmL2Manager* bcm_l2_manager, BcmL3Manager* bcm_l3_manager,
+      BcmPacketioManager* bcm_packetio_manager,
       BcmTableManager* bcm_table_manager, BcmTunnelManager* bcm_tunnel_manager,
       P4TableMapper* p4_table_mapper, int unit);
 
@@ -137,8 +158,9 @@ class BcmNode {
  private:
   // Private constructor. Use CreateInstance() to create an instance of this
   // class.
-  BcmNode(BcmAclManager* bcm_acl_manager, BcmL2Manager* bcm_l2_manager,
-          BcmL3Manager* bcm_l3_manager,
+  BcmNode(BcmAclManager* bcm_acl_manager,
+          BcmIdleTimeoutManager* bcm_idle_timeout_manager,
+          BcmL2Manager* bcm_l2_manager, BcmL3Manager* bcm_l3_manager,
           BcmPacketioManager* bcm_packetio_manager,
           BcmTableManager* bcm_table_manager,
           BcmTunnelManager* bcm_tunnel_manager, P4TableMapper* p4_table_mapper,
@@ -182,6 +204,7 @@ class BcmNode {
 
   // Managers. Not owned by the class.
   BcmAclManager* bcm_acl_manager_;
+  BcmIdleTimeoutManager* bcm_idle_timeout_manager_;  // may be nullptr.
   BcmL2Manager* bcm_l2_manager_;
   BcmL3Manager* bcm_l3_manager_;
   BcmPacketioManager* bcm_packetio_manager_;
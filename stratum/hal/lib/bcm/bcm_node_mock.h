@@ -19,6 +19,7 @@
 #ifndef STRATUM_HAL_LIB_BCM_BCM_NODE_MOCK_H_
 #define STRATUM_HAL_LIB_BCM_BCM_NODE_MOCK_H_
 
+#include <string>
 #include <vector>
 
 #include "stratum/hal/lib/bcm/bcm_node.h"
@@ -54,9 +55,16 @@ class BcmNodeMock : public BcmNode {
       RegisterPacketReceiveHandler,
       ::util::Status(
           std::function<void(const ::p4::v1::PacketIn& packet)> callback));
+  MOCK_METHOD1(
+      RegisterIdleTimeoutNotificationWriter,
+      ::util::Status(const std::shared_ptr<
+                     WriterInterface<::p4::v1::IdleTimeoutNotification>>&
+                         writer));
+  MOCK_METHOD0(UnregisterIdleTimeoutNotificationWriter, ::util::Status());
   MOCK_METHOD1(TransmitPacket,
                ::util::Status(const ::p4::v1::PacketOut& packet));
   MOCK_METHOD1(UpdatePortState, ::util::Status(uint32 port_id));
+  MOCK_METHOD0(GetL3RouteDebugString, ::util::StatusOr<std::string>());
 };
 
 }  // namespace bcm
@@ -19,6 +19,7 @@
 #include "stratum/glue/status/canonical_errors.h"
 #include "stratum/glue/status/status_test_util.h"
 #include "stratum/hal/lib/bcm/bcm_acl_manager_mock.h"
+#include "stratum/hal/lib/bcm/bcm_idle_timeout_manager_mock.h"
 #include "stratum/hal/lib/bcm/bcm_l2_manager_mock.h"
 #include "stratum/hal/lib/bcm/bcm_l3_manager_mock.h"
 #include "stratum/hal/lib/bcm/bcm_packetio_manager_mock.h"
@@ -63,6 +64,8 @@ class BcmNodeTest : public ::testing::Test {
  protected:
   void SetUp() override {
     bcm_acl_manager_mock_ = absl::make_unique<BcmAclManagerMock>();
+    bcm_idle_timeout_manager_mock_ =
+        absl::make_unique<BcmIdleTimeoutManagerMock>();
     bcm_l2_manager_mock_ = absl::make_unique<BcmL2ManagerMock>();
     bcm_l3_manager_mock_ = absl::make_unique<BcmL3ManagerMock>();
     bcm_packetio_manager_mock_ = absl::make_unique<BcmPacketioManagerMock>();
@@ -70,10 +73,10 @@ class BcmNodeTest : public ::testing::Test {
     bcm_tunnel_manager_mock_ = absl::make_unique<BcmTunnelManagerMock>();
     p4_table_mapper_mock_ = absl::make_unique<P4TableMapperMock>();
     bcm_node_ = BcmNode::CreateInstance(
-        bcm_acl_manager_mock_.get(), bcm_l2_manager_mock_.get(),
-        bcm_l3_manager_mock_.get(), bcm_packetio_manager_mock_.get(),
-        bcm_table_manager_mock_.get(), bcm_tunnel_manager_mock_.get(),
-        p4_table_mapper_mock_.get(), kUnit);
+        bcm_acl_manager_mock_.get(), bcm_idle_timeout_manager_mock_.get(),
+        bcm_l2_manager_mock_.get(), bcm_l3_manager_mock_.get(),
+        bcm_packetio_manager_mock_.get(), bcm_table_manager_mock_.get(),
+        bcm_tunnel_manager_mock_.get(), p4_table_mapper_mock_.get(), kUnit);
   }
 
   ::util::Status PushChassisConfig(const ChassisConfig& config,
@@ -117,11 +120,28 @@ class BcmNodeTest : public ::testing::Test {
     return bcm_node_->UnregisterPacketReceiveWriter();
   }
 
+  ::util::Status RegisterIdleTimeoutNotificationWriter(
+      const std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>&
+          writer) {
+    absl::ReaderMutexLock l(&chassis_lock);
+    return bcm_node_->RegisterIdleTimeoutNotificationWriter(writer);
+  }
+
+  ::util::Status UnregisterIdleTimeoutNotificationWriter() {
+    absl::ReaderMutexLock l(&chassis_lock);
+    return bcm_node_->UnregisterIdleTimeoutNotificationWriter();
+  }
+
   ::util::Status UpdatePortState(uint32 port_id) {
     absl::ReaderMutexLock l(&chassis_lock);
     return bcm_node_->UpdatePortState(port_id);
   }
 
+  ::util::StatusOr<std::string> GetL3RouteDebugString() {
+    absl::ReaderMutexLock l(&chassis_lock);
+    return bcm_node_->GetL3RouteDebugString();
+  }
+
   void PushChassisConfigWithCheck() {
     ChassisConfig config;
     config.add_nodes()->set_id(kNodeId);
@@ -172,6 +192,7 @@ class BcmNodeTest : public ::testing::Test {
   static constexpr uint32 kPortId = 941;
 
   std::unique_ptr<BcmAclManagerMock> bcm_acl_manager_mock_;
+  std::unique_ptr<BcmIdleTimeoutManagerMock> bcm_idle_timeout_manager_mock_;
   std::unique_ptr<BcmL2ManagerMock> bcm_l2_manager_mock_;
   std::unique_ptr<BcmL3ManagerMock> bcm_l3_manager_mock_;
   std::unique_ptr<BcmPacketioManagerMock> bcm_packetio_manager_mock_;
@@ -686,6 +707,8 @@ TEST_F(BcmNodeTest, ShutdownSuccess) {
     InSequence sequence;  // The order of the calls are important. Enforce it.
     EXPECT_CALL(*bcm_packetio_manager_mock_, Shutdown())
         .WillOnce(Return(::util::OkStatus()));
+    EXPECT_CALL(*bcm_idle_timeout_manager_mock_, Shutdown())
+        .WillOnce(Return(::util::OkStatus()));
     EXPECT_CALL(*bcm_tunnel_manager_mock_, Shutdown())
         .WillOnce(Return(::util::OkStatus()));
     EXPECT_CALL(*bcm_acl_manager_mock_, Shutdown())
@@ -709,6 +732,8 @@ TEST_F(BcmNodeTest, ShutdownFailureWhenSomeManagerShutdownFails) {
 
   EXPECT_CALL(*bcm_packetio_manager_mock_, Shutdown())
       .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_idle_timeout_manager_mock_, Shutdown())
+      .WillOnce(Return(::util::OkStatus()));
   EXPECT_CALL(*bcm_tunnel_manager_mock_, Shutdown())
       .WillOnce(Return(::util::OkStatus()));
   EXPECT_CALL(*bcm_acl_manager_mock_, Shutdown())
@@ -739,6 +764,8 @@ TEST_F(BcmNodeTest, PushForwardingPipelineConfigSuccess) {
     EXPECT_CALL(*p4_table_mapper_mock_,
                 PushForwardingPipelineConfig(EqualsProto(config)))
         .WillOnce(Return(::util::OkStatus()));
+    // The flows programmed with the previous config are not aged anymore.
+    EXPECT_CALL(*bcm_idle_timeout_manager_mock_, UntrackAllTableEntries());
     EXPECT_CALL(*bcm_acl_manager_mock_,
                 PushForwardingPipelineConfig(EqualsProto(config)))
         .WillOnce(Return(::util::OkStatus()));
@@ -766,6 +793,8 @@ TEST_F(BcmNodeTest, PushForwardingPipelineConfigFailueOnAnyManagerPushFailure) {
               PushForwardingPipelineConfig(EqualsProto(config)))
       .WillOnce(Return(DefaultError()))
       .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_idle_timeout_manager_mock_, UntrackAllTableEntries())
+      .Times(3);
   EXPECT_CALL(*bcm_acl_manager_mock_,
               PushForwardingPipelineConfig(EqualsProto(config)))
       .WillOnce(Return(DefaultError()))
@@ -1474,6 +1503,9 @@ TEST_F(BcmNodeTest, WriteForwardingEntriesSuccess_InsertActionProfileGroup) {
       .WillOnce(DoAll(WithArgs<1>(Invoke(
                           [](BcmMultipathNexthop* x) { x->set_unit(kUnit); })),
                       Return(::util::OkStatus())));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              FindShareableMultipathNexthop(EqualsProto(*group)))
+      .WillOnce(Return(-1));
   EXPECT_CALL(*bcm_l3_manager_mock_, FindOrCreateMultipathNexthop(_))
       .WillOnce(Return(kEgressIntfId));
   EXPECT_CALL(*bcm_table_manager_mock_,
@@ -1484,6 +1516,78 @@ TEST_F(BcmNodeTest, WriteForwardingEntriesSuccess_InsertActionProfileGroup) {
   EXPECT_EQ(1U, results.size());
 }
 
+TEST_F(BcmNodeTest,
+       WriteForwardingEntriesSuccess_InsertSharedActionProfileGroup) {
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+
+  ::p4::v1::WriteRequest req;
+  req.set_device_id(kNodeId);
+  auto* update = req.add_updates();
+  update->set_type(::p4::v1::Update::INSERT);
+  auto* entity = update->mutable_entity();
+  auto* group = entity->mutable_action_profile_group();
+  group->set_group_id(kGroupId);
+  std::vector<::util::Status> results = {};
+
+  EXPECT_CALL(*bcm_table_manager_mock_, ActionProfileGroupExists(kGroupId))
+      .WillOnce(Return(false));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              FillBcmMultipathNexthop(EqualsProto(*group), _))
+      .WillOnce(DoAll(WithArgs<1>(Invoke(
+                          [](BcmMultipathNexthop* x) { x->set_unit(kUnit); })),
+                      Return(::util::OkStatus())));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              FindShareableMultipathNexthop(EqualsProto(*group)))
+      .WillOnce(Return(kEgressIntfId));
+  EXPECT_CALL(*bcm_l3_manager_mock_, ShareMultipathNexthop(kEgressIntfId))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_l3_manager_mock_, FindOrCreateMultipathNexthop(_)).Times(0);
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              AddActionProfileGroup(EqualsProto(*group), kEgressIntfId))
+      .WillOnce(Return(::util::OkStatus()));
+
+  EXPECT_OK(WriteForwardingEntries(req, &results));
+  EXPECT_EQ(1U, results.size());
+}
+
+TEST_F(BcmNodeTest, WriteForwardingEntriesFailure_InsertActionProfileGroup) {
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+
+  ::p4::v1::WriteRequest req;
+  req.set_device_id(kNodeId);
+  auto* update = req.add_updates();
+  update->set_type(::p4::v1::Update::INSERT);
+  auto* entity = update->mutable_entity();
+  auto* group = entity->mutable_action_profile_group();
+  group->set_group_id(kGroupId);
+  std::vector<::util::Status> results = {};
+
+  EXPECT_CALL(*bcm_table_manager_mock_, ActionProfileGroupExists(kGroupId))
+      .WillOnce(Return(false));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              FillBcmMultipathNexthop(EqualsProto(*group), _))
+      .WillOnce(DoAll(WithArgs<1>(Invoke(
+                          [](BcmMultipathNexthop* x) { x->set_unit(kUnit); })),
+                      Return(::util::OkStatus())));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              FindShareableMultipathNexthop(EqualsProto(*group)))
+      .WillOnce(Return(-1));
+  EXPECT_CALL(*bcm_l3_manager_mock_, FindOrCreateMultipathNexthop(_))
+      .WillOnce(Return(kEgressIntfId));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              AddActionProfileGroup(EqualsProto(*group), kEgressIntfId))
+      .WillOnce(Return(DefaultError()));
+  // The reference taken on the hardware group is given back.
+  EXPECT_CALL(*bcm_l3_manager_mock_, DeleteMultipathNexthop(kEgressIntfId))
+      .WillOnce(Return(::util::OkStatus()));
+
+  ::util::Status status = WriteForwardingEntries(req, &results);
+  ASSERT_FALSE(status.ok());
+  ASSERT_EQ(1U, results.size());
+  EXPECT_EQ(ERR_UNKNOWN, results[0].error_code());
+  EXPECT_THAT(results[0].error_message(), HasSubstr(kErrorMsg));
+}
+
 TEST_F(BcmNodeTest, WriteForwardingEntriesSuccess_ModifyActionProfileGroup) {
   ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
 
@@ -1507,15 +1611,122 @@ TEST_F(BcmNodeTest, WriteForwardingEntriesSuccess_ModifyActionProfileGroup) {
                           [](BcmMultipathNexthop* x) { x->set_unit(kUnit); })),
                       Return(::util::OkStatus())));
   EXPECT_CALL(*bcm_l3_manager_mock_, ModifyMultipathNexthop(kEgressIntfId, _))
+      .WillOnce(Return(kEgressIntfId));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              UpdateActionProfileGroup(EqualsProto(*group)))
       .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              UpdateActionProfileGroupEgressIntf(_, _))
+      .Times(0);
+
+  EXPECT_OK(WriteForwardingEntries(req, &results));
+  EXPECT_EQ(1U, results.size());
+}
+
+TEST_F(BcmNodeTest,
+       WriteForwardingEntriesSuccess_ModifySharedActionProfileGroup) {
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+
+  ::p4::v1::WriteRequest req;
+  req.set_device_id(kNodeId);
+  auto* update = req.add_updates();
+  update->set_type(::p4::v1::Update::MODIFY);
+  auto* entity = update->mutable_entity();
+  auto* group = entity->mutable_action_profile_group();
+  group->set_group_id(kGroupId);
+  std::vector<::util::Status> results = {};
+  ::p4::v1::TableEntry flow;
+  flow.set_table_id(1);
+  flow.mutable_action()->set_action_profile_group_id(kGroupId);
+
+  EXPECT_CALL(*bcm_table_manager_mock_, GetBcmMultipathNexthopInfo(kGroupId, _))
+      .WillOnce(DoAll(WithArgs<1>(Invoke([](BcmMultipathNexthopInfo* x) {
+                        x->egress_intf_id = kEgressIntfId;
+                        x->flow_ref_count = 1;
+                      })),
+                      Return(::util::OkStatus())));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              FillBcmMultipathNexthop(EqualsProto(*group), _))
+      .WillOnce(DoAll(WithArgs<1>(Invoke(
+                          [](BcmMultipathNexthop* x) { x->set_unit(kUnit); })),
+                      Return(::util::OkStatus())));
+  // The group was sharing its hardware group and gets a new one.
+  EXPECT_CALL(*bcm_l3_manager_mock_, ModifyMultipathNexthop(kEgressIntfId, _))
+      .WillOnce(Return(kEgressIntfId + 1));
   EXPECT_CALL(*bcm_table_manager_mock_,
               UpdateActionProfileGroup(EqualsProto(*group)))
       .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              UpdateActionProfileGroupEgressIntf(kGroupId, kEgressIntfId + 1))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_table_manager_mock_, GetTableEntriesForGroup(kGroupId))
+      .WillOnce(Return(std::vector<::p4::v1::TableEntry>({flow})));
+  EXPECT_CALL(*bcm_l3_manager_mock_, ModifyTableEntry(EqualsProto(flow)))
+      .WillOnce(Return(::util::OkStatus()));
 
   EXPECT_OK(WriteForwardingEntries(req, &results));
   EXPECT_EQ(1U, results.size());
 }
 
+TEST_F(BcmNodeTest,
+       WriteForwardingEntriesFailure_ModifySharedActionProfileGroupRollback) {
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+
+  ::p4::v1::WriteRequest req;
+  req.set_device_id(kNodeId);
+  auto* update = req.add_updates();
+  update->set_type(::p4::v1::Update::MODIFY);
+  auto* entity = update->mutable_entity();
+  auto* group = entity->mutable_action_profile_group();
+  group->set_group_id(kGroupId);
+  std::vector<::util::Status> results = {};
+  ::p4::v1::TableEntry flow1;
+  flow1.set_table_id(1);
+  flow1.set_priority(1);
+  flow1.mutable_action()->set_action_profile_group_id(kGroupId);
+  ::p4::v1::TableEntry flow2 = flow1;
+  flow2.set_priority(2);
+
+  EXPECT_CALL(*bcm_table_manager_mock_, GetBcmMultipathNexthopInfo(kGroupId, _))
+      .WillOnce(DoAll(WithArgs<1>(Invoke([](BcmMultipathNexthopInfo* x) {
+                        x->egress_intf_id = kEgressIntfId;
+                        x->flow_ref_count = 2;
+                      })),
+                      Return(::util::OkStatus())));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              FillBcmMultipathNexthop(EqualsProto(*group), _))
+      .WillOnce(DoAll(WithArgs<1>(Invoke(
+                          [](BcmMultipathNexthop* x) { x->set_unit(kUnit); })),
+                      Return(::util::OkStatus())));
+  EXPECT_CALL(*bcm_l3_manager_mock_, ModifyMultipathNexthop(kEgressIntfId, _))
+      .WillOnce(Return(kEgressIntfId + 1));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              UpdateActionProfileGroupEgressIntf(kGroupId, kEgressIntfId + 1))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_table_manager_mock_, GetTableEntriesForGroup(kGroupId))
+      .WillOnce(Return(std::vector<::p4::v1::TableEntry>({flow1, flow2})));
+  // The second flow fails to move. The first one is moved back.
+  EXPECT_CALL(*bcm_l3_manager_mock_, ModifyTableEntry(EqualsProto(flow1)))
+      .Times(2)
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_l3_manager_mock_, ModifyTableEntry(EqualsProto(flow2)))
+      .WillOnce(Return(DefaultError()));
+  EXPECT_CALL(*bcm_table_manager_mock_,
+              UpdateActionProfileGroupEgressIntf(kGroupId, kEgressIntfId))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_l3_manager_mock_, ShareMultipathNexthop(kEgressIntfId))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_l3_manager_mock_, DeleteMultipathNexthop(kEgressIntfId + 1))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_table_manager_mock_, UpdateActionProfileGroup(_)).Times(0);
+
+  ::util::Status status = WriteForwardingEntries(req, &results);
+  ASSERT_FALSE(status.ok());
+  ASSERT_EQ(1U, results.size());
+  EXPECT_EQ(ERR_UNKNOWN, results[0].error_code());
+  EXPECT_THAT(results[0].error_message(), HasSubstr(kErrorMsg));
+}
+
 TEST_F(BcmNodeTest, WriteForwardingEntriesSuccess_DeleteActionProfileGroup) {
   ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
 
@@ -1649,6 +1860,149 @@ TEST_F(BcmNodeTest, UnregisterPacketReceiveWriter) {
               DerivedFromStatus(DefaultError()));
 }
 
+TEST_F(BcmNodeTest, WriteForwardingEntriesSuccess_TableEntryWithIdleTimeout) {
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+
+  ::p4::v1::WriteRequest req;
+  auto* table_entry = SetupTableEntryToInsert(&req, kNodeId);
+  table_entry->set_idle_timeout_ns(1000000000);
+
+  EXPECT_CALL(
+      *bcm_table_manager_mock_,
+      FillBcmFlowEntry(EqualsProto(*table_entry), ::p4::v1::Update::INSERT, _))
+      .WillOnce(DoAll(WithArgs<2>(Invoke([](BcmFlowEntry* x) {
+                        x->set_bcm_table_type(BcmFlowEntry::BCM_TABLE_ACL);
+                      })),
+                      Return(::util::OkStatus())));
+  {
+    InSequence sequence;
+    // The flow is tracked once programmed.
+    EXPECT_CALL(*bcm_idle_timeout_manager_mock_,
+                CheckIdleTimeoutSupported(EqualsProto(*table_entry), _))
+        .WillOnce(Return(::util::OkStatus()));
+    EXPECT_CALL(*bcm_acl_manager_mock_, InsertTableEntry(_))
+        .WillOnce(Return(::util::OkStatus()));
+    EXPECT_CALL(*bcm_idle_timeout_manager_mock_,
+                TrackTableEntry(EqualsProto(*table_entry), _))
+        .WillOnce(Return(::util::OkStatus()));
+  }
+
+  std::vector<::util::Status> results = {};
+  EXPECT_OK(WriteForwardingEntries(req, &results));
+  EXPECT_EQ(1U, results.size());
+
+  req.mutable_updates(0)->set_type(::p4::v1::Update::DELETE);
+  EXPECT_CALL(
+      *bcm_table_manager_mock_,
+      FillBcmFlowEntry(EqualsProto(*table_entry), ::p4::v1::Update::DELETE, _))
+      .WillOnce(DoAll(WithArgs<2>(Invoke([](BcmFlowEntry* x) {
+                        x->set_bcm_table_type(BcmFlowEntry::BCM_TABLE_ACL);
+                      })),
+                      Return(::util::OkStatus())));
+  {
+    InSequence sequence;
+    // The flow stays tracked if it fails to be deleted, and is untracked
+    // once deleted.
+    EXPECT_CALL(*bcm_acl_manager_mock_, DeleteTableEntry(_))
+        .WillOnce(Return(DefaultError()));
+    EXPECT_CALL(*bcm_acl_manager_mock_, DeleteTableEntry(_))
+        .WillOnce(Return(::util::OkStatus()));
+    EXPECT_CALL(*bcm_idle_timeout_manager_mock_,
+                UntrackTableEntry(EqualsProto(*table_entry), _));
+  }
+
+  results.clear();
+  EXPECT_FALSE(WriteForwardingEntries(req, &results).ok());
+  EXPECT_EQ(1U, results.size());
+  results.clear();
+  EXPECT_OK(WriteForwardingEntries(req, &results));
+  EXPECT_EQ(1U, results.size());
+}
+
+TEST_F(BcmNodeTest, WriteForwardingEntriesSuccess_IdleTimeoutWithoutManager) {
+  bcm_node_ = BcmNode::CreateInstance(
+      bcm_acl_manager_mock_.get(), /*bcm_idle_timeout_manager=*/nullptr,
+      bcm_l2_manager_mock_.get(), bcm_l3_manager_mock_.get(),
+      bcm_packetio_manager_mock_.get(), bcm_table_manager_mock_.get(),
+      bcm_tunnel_manager_mock_.get(), p4_table_mapper_mock_.get(), kUnit);
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+
+  // The idle timeout is ignored when the flows cannot be aged.
+  ::p4::v1::WriteRequest req;
+  auto* table_entry = SetupTableEntryToInsert(&req, kNodeId);
+  table_entry->set_idle_timeout_ns(1000000000);
+  EXPECT_CALL(
+      *bcm_table_manager_mock_,
+      FillBcmFlowEntry(EqualsProto(*table_entry), ::p4::v1::Update::INSERT, _))
+      .WillOnce(DoAll(WithArgs<2>(Invoke([](BcmFlowEntry* x) {
+                        x->set_bcm_table_type(BcmFlowEntry::BCM_TABLE_ACL);
+                      })),
+                      Return(::util::OkStatus())));
+  EXPECT_CALL(*bcm_acl_manager_mock_, InsertTableEntry(_))
+      .WillOnce(Return(::util::OkStatus()));
+
+  std::vector<::util::Status> results = {};
+  EXPECT_OK(WriteForwardingEntries(req, &results));
+  EXPECT_EQ(1U, results.size());
+
+  auto writer =
+      std::make_shared<WriterMock<::p4::v1::IdleTimeoutNotification>>();
+  EXPECT_EQ(ERR_UNIMPLEMENTED,
+            RegisterIdleTimeoutNotificationWriter(writer).error_code());
+  EXPECT_EQ(ERR_UNIMPLEMENTED,
+            UnregisterIdleTimeoutNotificationWriter().error_code());
+}
+
+TEST_F(BcmNodeTest, WriteForwardingEntriesFailure_IdleTimeoutNotSupported) {
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+
+  ::p4::v1::WriteRequest req;
+  auto* table_entry = SetupTableEntryToInsert(&req, kNodeId);
+  table_entry->set_idle_timeout_ns(1000000000);
+
+  EXPECT_CALL(
+      *bcm_table_manager_mock_,
+      FillBcmFlowEntry(EqualsProto(*table_entry), ::p4::v1::Update::INSERT, _))
+      .WillOnce(DoAll(WithArgs<2>(Invoke([](BcmFlowEntry* x) {
+                        x->set_bcm_table_type(
+                            BcmFlowEntry::BCM_TABLE_IPV4_LPM);
+                      })),
+                      Return(::util::OkStatus())));
+  EXPECT_CALL(*bcm_idle_timeout_manager_mock_,
+              CheckIdleTimeoutSupported(EqualsProto(*table_entry), _))
+      .WillOnce(Return(::util::Status(StratumErrorSpace(),
+                                      ERR_OPER_NOT_SUPPORTED, "Nope.")));
+  EXPECT_CALL(*bcm_l3_manager_mock_, InsertTableEntry(_)).Times(0);
+  EXPECT_CALL(*bcm_idle_timeout_manager_mock_, TrackTableEntry(_, _)).Times(0);
+
+  std::vector<::util::Status> results = {};
+  EXPECT_FALSE(WriteForwardingEntries(req, &results).ok());
+  ASSERT_EQ(1U, results.size());
+  EXPECT_EQ(ERR_OPER_NOT_SUPPORTED, results[0].error_code());
+}
+
+// RegisterIdleTimeoutNotificationWriter() should forward the call to
+// BcmIdleTimeoutManager and return success or error based on the returned
+// result.
+TEST_F(BcmNodeTest, RegisterIdleTimeoutNotificationWriter) {
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+
+  auto writer =
+      std::make_shared<WriterMock<::p4::v1::IdleTimeoutNotification>>();
+  EXPECT_CALL(*bcm_idle_timeout_manager_mock_,
+              RegisterIdleTimeoutNotificationWriter(Eq(writer)))
+      .WillOnce(Return(::util::OkStatus()))
+      .WillOnce(Return(DefaultError()));
+  EXPECT_CALL(*bcm_idle_timeout_manager_mock_,
+              UnregisterIdleTimeoutNotificationWriter())
+      .WillOnce(Return(::util::OkStatus()));
+
+  EXPECT_OK(RegisterIdleTimeoutNotificationWriter(writer));
+  EXPECT_THAT(RegisterIdleTimeoutNotificationWriter(writer),
+              DerivedFromStatus(DefaultError()));
+  EXPECT_OK(UnregisterIdleTimeoutNotificationWriter());
+}
+
 // Check functions invoked on UpdatePortState() call.
 TEST_F(BcmNodeTest, TestUpdatePortState) {
   ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
@@ -1665,6 +2019,17 @@ TEST_F(BcmNodeTest, TestUpdatePortState) {
   EXPECT_EQ(expected_error.ToString(), status.ToString());
 }
 
+// Check the L3 route dump comes from BcmL3Manager once initialized.
+TEST_F(BcmNodeTest, TestGetL3RouteDebugString) {
+  EXPECT_EQ(ERR_NOT_INITIALIZED, GetL3RouteDebugString().status().error_code());
+  ASSERT_NO_FATAL_FAILURE(PushChassisConfigWithCheck());
+
+  EXPECT_CALL(*bcm_l3_manager_mock_, DumpRoutes())
+      .WillOnce(Return("VRF 80:\n"));
+  ASSERT_OK_AND_ASSIGN(std::string dump, GetL3RouteDebugString());
+  EXPECT_EQ("VRF 80:\n", dump);
+}
+
 // TODO(unknown): Complete unit test coverage.
 
 }  // namespace bcm
@@ -39,6 +39,7 @@
 #include "stratum/lib/utils.h"
 #include "stratum/glue/integral_types.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/substitute.h"
 #include "absl/synchronization/mutex.h"
 #include "stratum/glue/gtl/map_util.h"
@@ -97,6 +98,8 @@ BcmPacketioManager::BcmPacketioManager(
       bcm_tx_config_(nullptr),
       bcm_knet_config_(nullptr),
       bcm_rate_limit_config_(nullptr),
+      bcm_rx_scheduler_config_(nullptr),
+      purpose_to_rx_scheduler_(),
       purpose_to_rx_writer_(),
       knet_intf_rx_thread_data_(),
       purpose_to_tx_stats_(),
@@ -117,6 +120,8 @@ BcmPacketioManager::BcmPacketioManager()
       bcm_tx_config_(nullptr),
       bcm_knet_config_(nullptr),
       bcm_rate_limit_config_(nullptr),
+      bcm_rx_scheduler_config_(nullptr),
+      purpose_to_rx_scheduler_(),
       purpose_to_rx_writer_(),
       knet_intf_rx_thread_data_(),
       purpose_to_tx_stats_(),
@@ -163,8 +168,11 @@ BcmPacketioManager::~BcmPacketioManager() {}
       new GoogleConfig::BcmKnetConfig());
   std::unique_ptr<GoogleConfig::BcmRateLimitConfig> bcm_rate_limit_config(
       new GoogleConfig::BcmRateLimitConfig());
+  std::unique_ptr<GoogleConfig::BcmRxSchedulerConfig> bcm_rx_scheduler_config(
+      new GoogleConfig::BcmRxSchedulerConfig());
   ParseConfig(config, node_id, bcm_rx_config.get(), bcm_tx_config.get(),
-              bcm_knet_config.get(), bcm_rate_limit_config.get());
+              bcm_knet_config.get(), bcm_rate_limit_config.get(),
+              bcm_rx_scheduler_config.get());
 
   // Now try to start RX and TX before setting up KNET interfaces. Save the
   // configs only after the operations were successful. Note that in case of
@@ -191,6 +199,10 @@ BcmPacketioManager::~BcmPacketioManager() {}
   RETURN_IF_ERROR(SetRateLimit(*bcm_rate_limit_config));
   bcm_rate_limit_config_ = std::move(bcm_rate_limit_config);
 
+  // Similarly, the RX queue sizes and scheduling can be changed at any time.
+  RETURN_IF_ERROR(SetRxScheduling(*bcm_rx_scheduler_config));
+  bcm_rx_scheduler_config_ = std::move(bcm_rx_scheduler_config);
+
   // The last step is to update the port_id_to_logical_port_ and
   // logical_port_to_port_id_ (reverse of port_id_to_logical_port_) maps using
   // the last updated maps from BcmChassisRoInterface. This is done after each
@@ -304,6 +316,23 @@ BcmPacketioManager::~BcmPacketioManager() {}
       APPEND_STATUS_IF_ERROR(status, error);
     }
   }
+  // Once no packet is received anymore, stop the RX schedulers, which drops
+  // the packets not sent yet and lets the RX writer threads exit.
+  {
+    absl::ReaderMutexLock l(&rx_scheduler_lock_);
+    for (const auto& entry : purpose_to_rx_scheduler_) {
+      entry.second->Shutdown();
+    }
+  }
+  for (const auto& entry : purpose_to_knet_intf_) {
+    if (entry.second.rx_writer_thread_id > 0 &&
+        pthread_join(entry.second.rx_writer_thread_id, nullptr) != 0) {
+      ::util::Status error = MAKE_ERROR(ERR_INTERNAL)
+                             << "Failed to join thread "
+                             << entry.second.rx_writer_thread_id;
+      APPEND_STATUS_IF_ERROR(status, error);
+    }
+  }
   // Perform the rest of the shutdown. First close the TX/RX sockets and
   // destroy all the KNET filters and KNET interfaces.
   for (const auto& entry : purpose_to_knet_intf_) {
@@ -335,6 +364,11 @@ BcmPacketioManager::~BcmPacketioManager() {}
   bcm_tx_config_.reset(nullptr);
   bcm_knet_config_.reset(nullptr);
   bcm_rate_limit_config_.reset(nullptr);
+  bcm_rx_scheduler_config_.reset(nullptr);
+  {
+    absl::WriterMutexLock l(&rx_scheduler_lock_);
+    purpose_to_rx_scheduler_.clear();
+  }
   {
     absl::WriterMutexLock l(&rx_writer_lock_);
     purpose_to_rx_writer_.clear();
@@ -525,6 +559,18 @@ BcmPacketioManager::~BcmPacketioManager() {}
   return *stats;
 }
 
+::util::StatusOr<BcmRxQueueStats> BcmPacketioManager::GetRxQueueStats(
+    GoogleConfig::BcmKnetIntfPurpose purpose, int cos) const {
+  absl::ReaderMutexLock l(&rx_scheduler_lock_);
+  const auto* rx_scheduler = gtl::FindOrNull(purpose_to_rx_scheduler_, purpose);
+  CHECK_RETURN_IF_FALSE(rx_scheduler != nullptr)
+      << "RX queues for KNET intf "
+      << GoogleConfig::BcmKnetIntfPurpose_Name(purpose) << " not found on node "
+      << node_id_ << ".";
+
+  return (*rx_scheduler)->GetQueueStats(cos);
+}
+
 ::util::Status BcmPacketioManager::InsertPacketReplicationEntry(
     const BcmPacketReplicationEntry& entry) {
   return bcm_sdk_interface_->InsertPacketReplicationEntry(entry);
@@ -553,6 +599,14 @@ std::string BcmPacketioManager::DumpStats() const {
                       e.second.ToString());
     }
   }
+  {
+    absl::ReaderMutexLock l(&rx_scheduler_lock_);
+    for (const auto& e : purpose_to_rx_scheduler_) {
+      absl::StrAppend(&msg, "\nRX queue stats for KNET intf ",
+                      GoogleConfig::BcmKnetIntfPurpose_Name(e.first), ":",
+                      e.second->DumpStats());
+    }
+  }
 
   LOG(INFO) << msg;
   return msg;
@@ -572,7 +626,8 @@ void BcmPacketioManager::ParseConfig(
     GoogleConfig::BcmRxConfig* bcm_rx_config,
     GoogleConfig::BcmTxConfig* bcm_tx_config,
     GoogleConfig::BcmKnetConfig* bcm_knet_config,
-    GoogleConfig::BcmRateLimitConfig* bcm_rate_limit_config) const {
+    GoogleConfig::BcmRateLimitConfig* bcm_rate_limit_config,
+    GoogleConfig::BcmRxSchedulerConfig* bcm_rx_scheduler_config) const {
   if (config.has_vendor_config() &&
       config.vendor_config().has_google_config()) {
     const auto& node_id_to_rx_config =
@@ -583,6 +638,8 @@ void BcmPacketioManager::ParseConfig(
         config.vendor_config().google_config().node_id_to_knet_config();
     const auto& node_id_to_rate_limit_config =
         config.vendor_config().google_config().node_id_to_rate_limit_config();
+    const auto& node_id_to_rx_scheduler_config =
+        config.vendor_config().google_config().node_id_to_rx_scheduler_config();
     if (bcm_rx_config != nullptr) {
       auto it = node_id_to_rx_config.find(node_id);
       if (it != node_id_to_rx_config.end()) {
@@ -607,6 +664,12 @@ void BcmPacketioManager::ParseConfig(
         *bcm_rate_limit_config = it->second;
       }
     }
+    if (bcm_rx_scheduler_config != nullptr) {
+      auto it = node_id_to_rx_scheduler_config.find(node_id);
+      if (it != node_id_to_rx_scheduler_config.end()) {
+        *bcm_rx_scheduler_config = it->second;
+      }
+    }
   }
 }
 
@@ -731,17 +794,37 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
     RETURN_IF_ERROR(SetupSingleKnetIntf(entry.first, &entry.second));
   }
 
-  // Finally after all the KNET intfs are setup, bring up the RX threads.
+  // Finally after all the KNET intfs are setup, bring up the RX threads,
+  // together with the RX schedulers and the RX writer threads sending the
+  // packets queued by the RX threads. The schedulers start with the default
+  // config, the pushed one is applied by SetRxScheduling().
   // If spawning the thread has some issues we will return error but we will
   // not retry after the next config push. This probably points to a serious
   // system issue unrelated to Stratum.
   for (auto& entry : purpose_to_knet_intf_) {
+    {
+      absl::WriterMutexLock l(&rx_scheduler_lock_);
+      purpose_to_rx_scheduler_[entry.first] =
+          absl::make_unique<BcmRxScheduler>(
+              GoogleConfig::BcmRxSchedulerConfig());
+    }
     KnetIntfRxThreadData* data =
         new KnetIntfRxThreadData(node_id_, entry.first, this);
     knet_intf_rx_thread_data_.push_back(data);
+    int ret = pthread_create(&entry.second.rx_writer_thread_id, nullptr,
+                             &BcmPacketioManager::KnetIntfRxWriterThreadFunc,
+                             data);
+    if (ret != 0) {
+      return MAKE_ERROR(ERR_INTERNAL)
+             << "Failed to spawn RX writer thread for KNET interface "
+             << entry.second.netif_name << " created for node with ID "
+             << node_id_ << " (unit: " << unit_ << ", purpose: "
+             << GoogleConfig::BcmKnetIntfPurpose_Name(entry.first)
+             << "). Err: " << ret << ".";
+    }
     // TODO(unknown): How about some thread attributes. Do we need any?
-    int ret = pthread_create(&entry.second.rx_thread_id, nullptr,
-                             &BcmPacketioManager::KnetIntfRxThreadFunc, data);
+    ret = pthread_create(&entry.second.rx_thread_id, nullptr,
+                         &BcmPacketioManager::KnetIntfRxThreadFunc, data);
     if (ret != 0) {
       return MAKE_ERROR(ERR_INTERNAL)
              << "Failed to spawn RX thread for KNET interface "
@@ -980,6 +1063,17 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
   return bcm_sdk_interface_->SetRateLimit(unit_, sdk_rate_limit_config);
 }
 
+::util::Status BcmPacketioManager::SetRxScheduling(
+    const GoogleConfig::BcmRxSchedulerConfig& bcm_rx_scheduler_config) const {
+  RETURN_IF_ERROR(BcmRxScheduler::VerifyConfig(bcm_rx_scheduler_config));
+  absl::ReaderMutexLock l(&rx_scheduler_lock_);
+  for (const auto& e : purpose_to_rx_scheduler_) {
+    e.second->UpdateConfig(bcm_rx_scheduler_config);
+  }
+
+  return ::util::OkStatus();
+}
+
 ::util::StatusOr<BcmKnetIntf*> BcmPacketioManager::GetBcmKnetIntf(
     GoogleConfig::BcmKnetIntfPurpose purpose) {
   BcmKnetIntf* intf = gtl::FindOrNull(purpose_to_knet_intf_, purpose);
@@ -999,12 +1093,24 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
   // not expect BcmKnetIntf for this purpose to change at all (if it does,
   // VerifyChassisConfig() will return reboot required).
   int rx_sock = -1, netif_index = -1;
+  BcmRxScheduler* rx_scheduler = nullptr;
   {
     absl::ReaderMutexLock l(&chassis_lock);
     if (shutdown) return ::util::OkStatus();
     ASSIGN_OR_RETURN(const BcmKnetIntf* intf, GetBcmKnetIntf(purpose));
     rx_sock = intf->rx_sock;
     netif_index = intf->netif_index;
+    {
+      absl::ReaderMutexLock scheduler_lock(&rx_scheduler_lock_);
+      const auto* scheduler =
+          gtl::FindOrNull(purpose_to_rx_scheduler_, purpose);
+      CHECK_RETURN_IF_FALSE(scheduler != nullptr)  // MUST NOT HAPPEN!
+          << "KNET interface with purpose "
+          << GoogleConfig::BcmKnetIntfPurpose_Name(purpose)
+          << " on node with ID " << node_id_ << " mapped to unit " << unit_
+          << " does not have a RX scheduler.";
+      rx_scheduler = scheduler->get();
+    }
     CHECK_RETURN_IF_FALSE(rx_sock > 0)  // MUST NOT HAPPEN!
         << "KNET interface with purpose "
         << GoogleConfig::BcmKnetIntfPurpose_Name(purpose) << " on node with ID "
@@ -1042,8 +1148,8 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
     } else if (ret > 0 && pevents[0].events & EPOLLIN) {
       // We have data to receive. Try to read max of
       // FLAGS_knet_max_num_packets_to_read_at_once packets before we try to
-      // check for exit criteria.
-      std::vector<::p4::v1::PacketIn> packets;
+      // check for exit criteria. The packets are queued per CoS and sent to
+      // the RX writer by the RX writer thread.
       for (int i = 0; i < FLAGS_knet_max_num_packets_to_read_at_once; ++i) {
         absl::ReaderMutexLock l(&chassis_lock);
         if (shutdown) break;
@@ -1117,18 +1223,11 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
             INCREMENT_RX_COUNTER(purpose, rx_drops_metadata_deparse_error);
             continue;  // let it retry
           }
-          INCREMENT_RX_COUNTER(purpose, rx_accepts);
-          packets.push_back(packet);
-        }
-      }
-      // Send the packet to the packet RX writer.
-      if (!packets.empty()) {
-        absl::ReaderMutexLock l(&rx_writer_lock_);
-        auto* writer = gtl::FindOrNull(purpose_to_rx_writer_, purpose);
-        if (writer != nullptr) {
-          for (const auto& p : packets) {
-            (*writer)->Write(p);
+          if (!rx_scheduler->Enqueue(meta.cos, std::move(packet))) {
+            INCREMENT_RX_COUNTER(purpose, rx_drops_rx_queue_full);
+            continue;  // let it retry
           }
+          INCREMENT_RX_COUNTER(purpose, rx_accepts);
         }
       }
     }
@@ -1143,6 +1242,46 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
   return ::util::OkStatus();
 }
 
+::util::Status BcmPacketioManager::HandleKnetIntfPacketWrite(
+    GoogleConfig::BcmKnetIntfPurpose purpose) {
+  // Similar to HandleKnetIntfPacketRx(), wait for the config push to be done.
+  // The RX scheduler is not changed afterwards, until shutdown.
+  BcmRxScheduler* rx_scheduler = nullptr;
+  {
+    absl::ReaderMutexLock l(&chassis_lock);
+    if (shutdown) return ::util::OkStatus();
+    {
+      absl::ReaderMutexLock scheduler_lock(&rx_scheduler_lock_);
+      const auto* scheduler =
+          gtl::FindOrNull(purpose_to_rx_scheduler_, purpose);
+      CHECK_RETURN_IF_FALSE(scheduler != nullptr)  // MUST NOT HAPPEN!
+          << "KNET interface with purpose "
+          << GoogleConfig::BcmKnetIntfPurpose_Name(purpose)
+          << " on node with ID " << node_id_ << " mapped to unit " << unit_
+          << " does not have a RX scheduler.";
+      rx_scheduler = scheduler->get();
+    }
+  }
+
+  // Dequeue() blocks until there is a packet to send and returns false after
+  // the scheduler is shutdown. The same PacketIn is reused for all the packets.
+  ::p4::v1::PacketIn packet;
+  while (rx_scheduler->Dequeue(&packet)) {
+    absl::ReaderMutexLock l(&rx_writer_lock_);
+    auto* writer = gtl::FindOrNull(purpose_to_rx_writer_, purpose);
+    if (writer != nullptr) {
+      (*writer)->Write(packet);
+    }
+  }
+
+  LOG(INFO) << "Killed RX writer thread for KNET interface with purpose "
+            << GoogleConfig::BcmKnetIntfPurpose_Name(purpose)
+            << " on node with ID " << node_id_ << " mapped to unit " << unit_
+            << ".";
+
+  return ::util::OkStatus();
+}
+
 ::util::StatusOr<bool> BcmPacketioManager::RxPacket(
     GoogleConfig::BcmKnetIntfPurpose purpose, int sock, int netif_index,
     std::string* header, std::string* payload) {
@@ -1253,39 +1392,40 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
 
 ::util::Status BcmPacketioManager::DeparsePacketInMetadata(
     const PacketInMetadata& meta, ::p4::v1::PacketIn* packet) {
+  // This runs for every packet punted to the controller. The codec compiled at
+  // pipeline push is used when available. Otherwise we go through the generic
+  // MappedPacketMetadata based translation of P4TableMapper.
+  const PacketMetadataCodec* codec =
+      p4_table_mapper_->GetPacketInMetadataCodec();
+  auto deparse = [this, codec, packet](P4FieldType type,
+                                       uint32 value) -> ::util::Status {
+    if (codec != nullptr) {
+      return codec->Encode(type, value, packet->add_metadata());
+    }
+    MappedPacketMetadata mapped_packet_metadata;
+    mapped_packet_metadata.set_type(type);
+    mapped_packet_metadata.set_u32(value);
+    return p4_table_mapper_->DeparsePacketInMetadata(mapped_packet_metadata,
+                                                     packet->add_metadata());
+  };
   // Note: We are down-casting to uint32 for the port/trunk IDs in this method.
   // This should not cause an issue as controller is already using 32 bit port
   // or trunk IDs.
   if (meta.ingress_port_id > 0) {
-    MappedPacketMetadata mapped_packet_metadata;
-    mapped_packet_metadata.set_type(P4_FIELD_TYPE_INGRESS_PORT);
-    mapped_packet_metadata.set_u32(meta.ingress_port_id);
-    RETURN_IF_ERROR(p4_table_mapper_->DeparsePacketInMetadata(
-        mapped_packet_metadata, packet->add_metadata()));
+    RETURN_IF_ERROR(deparse(P4_FIELD_TYPE_INGRESS_PORT, meta.ingress_port_id));
   }
   if (meta.ingress_trunk_id > 0) {
-    MappedPacketMetadata mapped_packet_metadata;
-    mapped_packet_metadata.set_type(P4_FIELD_TYPE_INGRESS_TRUNK);
-    mapped_packet_metadata.set_u32(meta.ingress_trunk_id);
-    RETURN_IF_ERROR(p4_table_mapper_->DeparsePacketInMetadata(
-        mapped_packet_metadata, packet->add_metadata()));
+    RETURN_IF_ERROR(
+        deparse(P4_FIELD_TYPE_INGRESS_TRUNK, meta.ingress_trunk_id));
   }
   if (meta.egress_port_id > 0) {
-    MappedPacketMetadata mapped_packet_metadata;
-    mapped_packet_metadata.set_type(P4_FIELD_TYPE_EGRESS_PORT);
-    mapped_packet_metadata.set_u32(meta.egress_port_id);
-    RETURN_IF_ERROR(p4_table_mapper_->DeparsePacketInMetadata(
-        mapped_packet_metadata, packet->add_metadata()));
+    RETURN_IF_ERROR(deparse(P4_FIELD_TYPE_EGRESS_PORT, meta.egress_port_id));
   }
   // TODO(unknown): Controller has not defined any metadata for CoS yet. Enable
   // this after this is done.
   /*
   if (meta.cos > 0) {
-    MappedPacketMetadata mapped_packet_metadata;
-    mapped_packet_metadata.set_type(P4_FIELD_TYPE_COS);
-    mapped_packet_metadata.set_u32(static_cast<uint32>(meta.cos));
-    RETURN_IF_ERROR(p4_table_mapper_->DeparsePacketInMetadata(
-        mapped_packet_metadata, packet->add_metadata()));
+    RETURN_IF_ERROR(deparse(P4_FIELD_TYPE_COS, static_cast<uint32>(meta.cos)));
   }
   */
 
@@ -1393,20 +1533,31 @@ std::string BcmPacketioManager::GetKnetIntfNameTemplate(
 ::util::Status BcmPacketioManager::ParsePacketOutMetadata(
     const ::p4::v1::PacketOut& packet, PacketOutMetadata* meta) {
   meta->cos = kDefaultCos;  // default
+  // Same as DeparsePacketInMetadata(), use the compiled codec if available.
+  const PacketMetadataCodec* codec =
+      p4_table_mapper_->GetPacketOutMetadataCodec();
   for (const auto& metadata : packet.metadata()) {
-    // Query P4TableMapper to understand what this metadata refers to.
-    MappedPacketMetadata mapped_packet_metadata;
-    RETURN_IF_ERROR(p4_table_mapper_->ParsePacketOutMetadata(
-        metadata, &mapped_packet_metadata));
-    switch (mapped_packet_metadata.type()) {
+    P4FieldType type = P4_FIELD_TYPE_UNKNOWN;
+    uint32 value = 0;
+    if (codec != nullptr) {
+      RETURN_IF_ERROR(codec->Decode(metadata, &type, &value));
+    } else {
+      // Query P4TableMapper to understand what this metadata refers to.
+      MappedPacketMetadata mapped_packet_metadata;
+      RETURN_IF_ERROR(p4_table_mapper_->ParsePacketOutMetadata(
+          metadata, &mapped_packet_metadata));
+      type = mapped_packet_metadata.type();
+      value = mapped_packet_metadata.u32();
+    }
+    switch (type) {
       case P4_FIELD_TYPE_EGRESS_PORT:
-        meta->egress_port_id = mapped_packet_metadata.u32();
+        meta->egress_port_id = value;
         break;
       case P4_FIELD_TYPE_EGRESS_TRUNK:
-        meta->egress_trunk_id = mapped_packet_metadata.u32();
+        meta->egress_trunk_id = value;
         break;
       case P4_FIELD_TYPE_COS:
-        meta->cos = static_cast<int>(mapped_packet_metadata.u32());
+        meta->cos = static_cast<int>(value);
         break;
       default:
         VLOG(1) << "Unknown/unsupported meta: " << metadata.ShortDebugString()
@@ -1462,6 +1613,18 @@ void* BcmPacketioManager::KnetIntfRxThreadFunc(void* arg) {
   return nullptr;
 }
 
+void* BcmPacketioManager::KnetIntfRxWriterThreadFunc(void* arg) {
+  KnetIntfRxThreadData* data = static_cast<KnetIntfRxThreadData*>(arg);
+  ::util::Status status = data->mgr->HandleKnetIntfPacketWrite(data->purpose);
+  if (!status.ok()) {
+    LOG(ERROR) << "Non-OK exit of RX writer thread for KNET interface with "
+               << "purpose "
+               << GoogleConfig::BcmKnetIntfPurpose_Name(data->purpose)
+               << " on node with ID " << data->node_id << ".";
+  }
+  return nullptr;
+}
+
 }  // namespace bcm
 }  // namespace hal
 }  // namespace stratum
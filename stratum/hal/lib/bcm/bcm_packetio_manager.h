@@ -34,6 +34,7 @@
 #include "stratum/hal/lib/bcm/bcm.pb.h"
 #include "stratum/hal/lib/bcm/bcm_chassis_ro_interface.h"
 #include "stratum/hal/lib/bcm/bcm_global_vars.h"
+#include "stratum/hal/lib/bcm/bcm_rx_scheduler.h"
 #include "stratum/hal/lib/bcm/bcm_sdk_interface.h"
 #include "stratum/hal/lib/bcm/constants.h"
 #include "stratum/hal/lib/common/writer_interface.h"
@@ -141,6 +142,9 @@ struct BcmKnetRxStats {
   uint64 rx_drops_unknown_ingress_port;
   // (Probably valid) RX packets dropped due to unknown egress port.
   uint64 rx_drops_unknown_egress_port;
+  // (Probably valid) RX packets dropped because the RX queue for their CoS was
+  // full.
+  uint64 rx_drops_rx_queue_full;
   BcmKnetRxStats()
       : all_rx(0),
         rx_accepts(0),
@@ -152,7 +156,8 @@ struct BcmKnetRxStats {
         rx_drops_knet_header_parse_error(0),
         rx_drops_metadata_deparse_error(0),
         rx_drops_unknown_ingress_port(0),
-        rx_drops_unknown_egress_port(0) {}
+        rx_drops_unknown_egress_port(0),
+        rx_drops_rx_queue_full(0) {}
   std::string ToString() const {
     return absl::StrCat(
         "(all_rx:", all_rx, ", rx_accepts:", rx_accepts,
@@ -164,7 +169,8 @@ struct BcmKnetRxStats {
         ", rx_drops_knet_header_parse_error:", rx_drops_knet_header_parse_error,
         ", rx_drops_metadata_deparse_error:", rx_drops_metadata_deparse_error,
         ", rx_drops_unknown_ingress_port:", rx_drops_unknown_ingress_port,
-        ", rx_drops_unknown_egress_port:", rx_drops_unknown_egress_port, ")");
+        ", rx_drops_unknown_egress_port:", rx_drops_unknown_egress_port,
+        ", rx_drops_rx_queue_full:", rx_drops_rx_queue_full, ")");
   }
 };
 
@@ -197,6 +203,9 @@ struct BcmKnetIntf {
   int rx_sock;
   // The ID of the RX thread which is in charge of receiving the packets.
   pthread_t rx_thread_id;
+  // The ID of the thread which is in charge of sending the packets queued by
+  // the RX thread to the registered writer.
+  pthread_t rx_writer_thread_id;
   BcmKnetIntf()
       : cpu_queue(-1),
         mtu(0),
@@ -208,7 +217,8 @@ struct BcmKnetIntf {
         filter_ids(),
         tx_sock(-1),
         rx_sock(-1),
-        rx_thread_id(0) {}
+        rx_thread_id(0),
+        rx_writer_thread_id(0) {}
 };
 
 // Metadata we need to parse from each packet received from controller to
@@ -312,6 +322,13 @@ class BcmPacketioManager {
       GoogleConfig::BcmKnetIntfPurpose purpose) const
       LOCKS_EXCLUDED(rx_stats_lock_);
 
+  // Returns a copy of the stats of the RX queue for a given CoS on the KNET
+  // intf with the given purpose. Returns error if there is no such KNET intf
+  // or the CoS is invalid.
+  virtual ::util::StatusOr<BcmRxQueueStats> GetRxQueueStats(
+      GoogleConfig::BcmKnetIntfPurpose purpose, int cos) const
+      LOCKS_EXCLUDED(rx_scheduler_lock_);
+
   // Creates a packet replication group.
   virtual ::util::Status InsertPacketReplicationEntry(
       const BcmPacketReplicationEntry& entry);
@@ -323,7 +340,7 @@ class BcmPacketioManager {
   // Returns the RX/TX stats for all KNET intfs as string. It also dumps the
   // string to stdout.
   virtual std::string DumpStats() const
-      LOCKS_EXCLUDED(tx_stats_lock_, rx_stats_lock_);
+      LOCKS_EXCLUDED(tx_stats_lock_, rx_stats_lock_, rx_scheduler_lock_);
 
   // Factory function for creating the instance of the class.
   static std::unique_ptr<BcmPacketioManager> CreateInstance(
@@ -359,14 +376,15 @@ class BcmPacketioManager {
                      P4TableMapper* p4_table_mapper,
                      BcmSdkInterface* bcm_sdk_interface, int unit);
 
-  // Helper to parse the config and return any RX/TX/KNET/rate limit config for
-  // a given node ID.
+  // Helper to parse the config and return any RX/TX/KNET/rate limit/RX
+  // scheduler config for a given node ID.
   void ParseConfig(
       const ChassisConfig& config, uint64 node_id,
       GoogleConfig::BcmRxConfig* bcm_rx_config,
       GoogleConfig::BcmTxConfig* bcm_tx_config,
       GoogleConfig::BcmKnetConfig* bcm_knet_config,
-      GoogleConfig::BcmRateLimitConfig* bcm_rate_limit_config) const;
+      GoogleConfig::BcmRateLimitConfig* bcm_rate_limit_config,
+      GoogleConfig::BcmRxSchedulerConfig* bcm_rx_scheduler_config) const;
 
   // Start RX on given unit. The RX parameters are given by 'bcm_rx_config'.
   ::util::Status StartRx(const GoogleConfig::BcmRxConfig& bcm_rx_config) const;
@@ -394,6 +412,12 @@ class BcmPacketioManager {
   ::util::Status SetRateLimit(
       const GoogleConfig::BcmRateLimitConfig& bcm_rate_limit_config) const;
 
+  // Applies the given per CoS queueing and scheduling config to the RX
+  // schedulers of all the KNET interfaces.
+  ::util::Status SetRxScheduling(
+      const GoogleConfig::BcmRxSchedulerConfig& bcm_rx_scheduler_config) const
+      LOCKS_EXCLUDED(rx_scheduler_lock_);
+
   // Returns a pointer to an already existing  BcmKnetIntf instance which
   // corresponds to the given purpose the node this class is mapped to. Returns
   // error if it cannot find the instance.
@@ -401,11 +425,18 @@ class BcmPacketioManager {
       GoogleConfig::BcmKnetIntfPurpose purpose);
 
   // Called in the context of the KNET interface RX thread. Includes a loop to
-  // receive the packets from a given KNET interface and forward it to the
-  // registered callback (if any).
+  // receive the packets from a given KNET interface and queue them in the RX
+  // scheduler of the interface.
   ::util::Status HandleKnetIntfPacketRx(
       GoogleConfig::BcmKnetIntfPurpose purpose)
-      LOCKS_EXCLUDED(chassis_lock, rx_writer_lock_);
+      LOCKS_EXCLUDED(chassis_lock, rx_writer_lock_, rx_scheduler_lock_);
+
+  // Called in the context of the KNET interface RX writer thread. Includes a
+  // loop to dequeue the packets from the RX scheduler of a given KNET interface
+  // and forward them to the registered callback (if any).
+  ::util::Status HandleKnetIntfPacketWrite(
+      GoogleConfig::BcmKnetIntfPurpose purpose)
+      LOCKS_EXCLUDED(chassis_lock, rx_writer_lock_, rx_scheduler_lock_);
 
   // Helper called by HandleKnetIntfPacketRx() to read one single full message
   // from a socket. Returns true if we need to retry the receive and false if
@@ -441,6 +472,9 @@ class BcmPacketioManager {
   // KNET interface RX thread function.
   static void* KnetIntfRxThreadFunc(void* arg);
 
+  // KNET interface RX writer thread function.
+  static void* KnetIntfRxWriterThreadFunc(void* arg);
+
   // Determines the mode of operation:
   // - OPERATION_MODE_STANDALONE: when Stratum stack runs independently and
   // therefore needs to do all the SDK initialization itself.
@@ -460,6 +494,9 @@ class BcmPacketioManager {
   // Mutex lock for protecting the purpose_to_rx_stats_ map.
   mutable absl::Mutex rx_stats_lock_;
 
+  // Mutex lock for protecting the purpose_to_rx_scheduler_ map.
+  mutable absl::Mutex rx_scheduler_lock_;
+
   // Map from KNET interface purpose (specifying which application will use the
   // interface, e.g. controller, sflow, etc.) to the BcmKnetIntf instance
   // encapsulating the settings for that KNET interface. Each node can only
@@ -495,6 +532,17 @@ class BcmPacketioManager {
   // config.
   std::unique_ptr<GoogleConfig::BcmRateLimitConfig> bcm_rate_limit_config_;
 
+  // Copy of the BcmRxSchedulerConfig received from pushed config. Updated only
+  // after the config push is successful.
+  std::unique_ptr<GoogleConfig::BcmRxSchedulerConfig> bcm_rx_scheduler_config_;
+
+  // Map from KNET interface purpose to the scheduler queueing the packets
+  // received on that interface until they are sent to the RX writer. Created
+  // together with the KNET interfaces and never changed afterwards, until
+  // shutdown.
+  std::map<GoogleConfig::BcmKnetIntfPurpose, std::unique_ptr<BcmRxScheduler>>
+      purpose_to_rx_scheduler_ GUARDED_BY(rx_scheduler_lock_);
+
   // Map from purpose for a KNET interface to the RX packet handler. This map
   // is updated every time a controller is connected.
   std::map<GoogleConfig::BcmKnetIntfPurpose,
@@ -326,6 +326,10 @@ class BcmPacketioManagerTest : public ::testing::TestWithParam<OperationMode> {
       EXPECT_EQ(10, purpose_to_knet_intf.at(sflow_purpose).vlan);
       EXPECT_EQ(std::set<int>({kSflowIngressFilterId1, kSflowEgressFilterId1}),
                 purpose_to_knet_intf.at(sflow_purpose).filter_ids);
+      {
+        absl::ReaderMutexLock l(&bcm_packetio_manager_->rx_scheduler_lock_);
+        EXPECT_EQ(2U, bcm_packetio_manager_->purpose_to_rx_scheduler_.size());
+      }
 
       ASSERT_EQ(1U, bcm_packetio_manager_->logical_port_to_port_id_.size());
       ASSERT_EQ(1U, bcm_packetio_manager_->port_id_to_logical_port_.size());
@@ -341,6 +345,10 @@ class BcmPacketioManagerTest : public ::testing::TestWithParam<OperationMode> {
       EXPECT_EQ(std::set<int>({kNonSflowFilterId1}),
                 purpose_to_knet_intf.at(controller_purpose).filter_ids);
       EXPECT_FALSE(purpose_to_knet_intf.count(sflow_purpose));
+      {
+        absl::ReaderMutexLock l(&bcm_packetio_manager_->rx_scheduler_lock_);
+        EXPECT_EQ(1U, bcm_packetio_manager_->purpose_to_rx_scheduler_.size());
+      }
 
       ASSERT_EQ(1U, bcm_packetio_manager_->logical_port_to_port_id_.size());
       ASSERT_EQ(1U, bcm_packetio_manager_->port_id_to_logical_port_.size());
@@ -1787,6 +1795,26 @@ TEST_P(BcmPacketioManagerTest, TransmitPacketAfterChassisConfigPush) {
                           tx_drops_down_trunk);
   }
 
+  // Same as 2, with the metadata codec compiled by P4TableMapper. The
+  // MappedPacketMetadata based translation is bypassed, so no new call to
+  // ParsePacketOutMetadata() is expected.
+  {
+    PacketMetadataCodec codec({{123456, P4_FIELD_TYPE_EGRESS_PORT, 32}});
+    ::p4::v1::PacketOut codec_packet = packet;
+    ASSERT_OK(codec.Encode(P4_FIELD_TYPE_EGRESS_PORT, kPortId1,
+                           codec_packet.mutable_metadata(0)));
+    EXPECT_CALL(*p4_table_mapper_mock_, GetPacketOutMetadataCodec())
+        .WillOnce(Return(&codec));
+    EXPECT_CALL(*bcm_chassis_ro_mock_, GetPortState(kNodeId1, kPortId1))
+        .WillOnce(Return(PORT_STATE_DOWN));
+
+    status = TransmitPacket(GoogleConfig::BCM_KNET_INTF_PURPOSE_CONTROLLER,
+                            codec_packet);
+    ASSERT_FALSE(status.ok());
+    EXPECT_EQ(ERR_INVALID_PARAM, status.error_code());
+    EXPECT_THAT(status.error_message(), HasSubstr("is not UP"));
+  }
+
   // 3- A packet with up port.
   EXPECT_CALL(*p4_table_mapper_mock_,
               ParsePacketOutMetadata(EqualsProto(packet.metadata(0)), _))
@@ -0,0 +1,194 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/bcm/bcm_rx_scheduler.h"
+
+#include <utility>
+
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+#include "absl/time/clock.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+constexpr int BcmRxScheduler::kDefaultMaxQueuePkts;
+constexpr int BcmRxScheduler::kDrrQuantumBytes;
+constexpr int BcmRxScheduler::kNumQueues;
+
+BcmRxScheduler::BcmRxScheduler(
+    const GoogleConfig::BcmRxSchedulerConfig& config)
+    : scheduling_mode_(GoogleConfig::BcmRxSchedulerConfig::STRICT_PRIORITY),
+      size_(0),
+      drr_cos_(kMaxCos),
+      drr_quantum_added_(false),
+      shutdown_(false) {
+  UpdateConfig(config);
+}
+
+::util::Status BcmRxScheduler::VerifyConfig(
+    const GoogleConfig::BcmRxSchedulerConfig& config) {
+  CHECK_RETURN_IF_FALSE(config.max_queue_pkts() >= 0)
+      << "Invalid max_queue_pkts in " << config.ShortDebugString();
+  for (const auto& e : config.per_cos_queue_configs()) {
+    CHECK_RETURN_IF_FALSE(e.first >= 0 && e.first <= kMaxCos)
+        << "Invalid CoS " << e.first << " in " << config.ShortDebugString();
+    CHECK_RETURN_IF_FALSE(e.second.max_queue_pkts() >= 0)
+        << "Invalid max_queue_pkts for CoS " << e.first << " in "
+        << config.ShortDebugString();
+    CHECK_RETURN_IF_FALSE(e.second.weight() >= 0)
+        << "Invalid weight for CoS " << e.first << " in "
+        << config.ShortDebugString();
+  }
+
+  return ::util::OkStatus();
+}
+
+void BcmRxScheduler::UpdateConfig(
+    const GoogleConfig::BcmRxSchedulerConfig& config) {
+  absl::MutexLock l(&lock_);
+  scheduling_mode_ = config.scheduling_mode();
+  size_t default_max_size = config.max_queue_pkts() > 0
+                                ? config.max_queue_pkts()
+                                : kDefaultMaxQueuePkts;
+  for (int cos = 0; cos < kNumQueues; ++cos) {
+    queues_[cos].max_size = default_max_size;
+    queues_[cos].weight = 1;
+  }
+  for (const auto& e : config.per_cos_queue_configs()) {
+    if (e.first < 0 || e.first > kMaxCos) continue;
+    Queue& queue = queues_[e.first];
+    if (e.second.max_queue_pkts() > 0) {
+      queue.max_size = e.second.max_queue_pkts();
+    }
+    if (e.second.weight() > 0) queue.weight = e.second.weight();
+  }
+}
+
+bool BcmRxScheduler::Enqueue(int cos, ::p4::v1::PacketIn packet) {
+  if (cos < 0 || cos > kMaxCos) cos = 0;
+  int64 now_usecs = absl::GetCurrentTimeNanos() / 1000;
+  absl::MutexLock l(&lock_);
+  if (shutdown_) return false;
+  Queue& queue = queues_[cos];
+  if (queue.entries.size() >= queue.max_size) {
+    ++queue.stats.dropped;
+    return false;
+  }
+  queue.entries.push_back(Entry{std::move(packet), now_usecs});
+  ++queue.stats.enqueued;
+  ++size_;
+  queue_not_empty_.Signal();
+
+  return true;
+}
+
+bool BcmRxScheduler::Dequeue(::p4::v1::PacketIn* packet) {
+  int cos = 0;
+  int64 enqueue_time_usecs = 0;
+  {
+    absl::MutexLock l(&lock_);
+    while (!shutdown_ && size_ == 0) queue_not_empty_.Wait(&lock_);
+    if (shutdown_) return false;
+    cos = PickQueue();
+    Queue& queue = queues_[cos];
+    packet->Swap(&queue.entries.front().packet);
+    enqueue_time_usecs = queue.entries.front().enqueue_time_usecs;
+    queue.entries.pop_front();
+    ++queue.stats.dequeued;
+    --size_;
+  }
+  int64 latency_usecs =
+      absl::GetCurrentTimeNanos() / 1000 - enqueue_time_usecs;
+  latency_usecs_[cos].Record(latency_usecs > 0 ? latency_usecs : 0);
+
+  return true;
+}
+
+int BcmRxScheduler::PickQueue() {
+  if (scheduling_mode_ != GoogleConfig::BcmRxSchedulerConfig::WEIGHTED_FAIR) {
+    for (int cos = kMaxCos; cos > 0; --cos) {
+      if (!queues_[cos].entries.empty()) return cos;
+    }
+    return 0;
+  }
+
+  // Deficit round robin. Each visit to a non-empty queue adds weight x
+  // quantum bytes to its deficit, and the queue is served as long as its head
+  // packet fits in the deficit. Empty queues do not accumulate any deficit.
+  // As at least one queue is non-empty, this terminates after a bounded
+  // number of rounds.
+  while (true) {
+    Queue& queue = queues_[drr_cos_];
+    if (!queue.entries.empty()) {
+      if (!drr_quantum_added_) {
+        queue.deficit += static_cast<int64>(queue.weight) * kDrrQuantumBytes;
+        drr_quantum_added_ = true;
+      }
+      int64 packet_size = queue.entries.front().packet.payload().size();
+      if (packet_size <= queue.deficit) {
+        queue.deficit -= packet_size;
+        return drr_cos_;
+      }
+    } else {
+      queue.deficit = 0;
+    }
+    drr_cos_ = drr_cos_ > 0 ? drr_cos_ - 1 : kMaxCos;
+    drr_quantum_added_ = false;
+  }
+}
+
+void BcmRxScheduler::Shutdown() {
+  absl::MutexLock l(&lock_);
+  if (shutdown_) return;
+  shutdown_ = true;
+  for (auto& queue : queues_) {
+    queue.stats.dropped += queue.entries.size();
+    queue.entries.clear();
+    queue.deficit = 0;
+  }
+  size_ = 0;
+  queue_not_empty_.SignalAll();
+}
+
+::util::StatusOr<BcmRxQueueStats> BcmRxScheduler::GetQueueStats(
+    int cos) const {
+  CHECK_RETURN_IF_FALSE(cos >= 0 && cos <= kMaxCos) << "Invalid CoS " << cos;
+  absl::MutexLock l(&lock_);
+  return queues_[cos].stats;
+}
+
+std::string BcmRxScheduler::DumpStats() const {
+  std::string msg = "";
+  absl::MutexLock l(&lock_);
+  for (int cos = kMaxCos; cos >= 0; --cos) {
+    const Queue& queue = queues_[cos];
+    if (queue.stats.enqueued == 0 && queue.stats.dropped == 0) continue;
+    absl::StrAppend(&msg, "\n  CoS ", cos, ": ", queue.stats.ToString(),
+                    " latency_usecs: ", latency_usecs_[cos].ToString());
+  }
+
+  return msg;
+}
+
+size_t BcmRxScheduler::size() const {
+  absl::MutexLock l(&lock_);
+  return size_;
+}
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
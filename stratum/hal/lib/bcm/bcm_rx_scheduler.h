@@ -0,0 +1,173 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_HAL_LIB_BCM_BCM_RX_SCHEDULER_H_
+#define STRATUM_HAL_LIB_BCM_BCM_RX_SCHEDULER_H_
+
+#include <deque>
+#include <string>
+
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/bcm/constants.h"
+#include "stratum/hal/lib/common/common.pb.h"
+#include "stratum/lib/latency_histogram.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "p4/v1/p4runtime.pb.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+// All the stats we collect for each CoS queue of a BcmRxScheduler.
+struct BcmRxQueueStats {
+  // All packets accepted in the queue.
+  uint64 enqueued;
+  // All packets taken out of the queue to be sent.
+  uint64 dequeued;
+  // Packets dropped because the queue was full or the scheduler was shutdown
+  // while they were waiting in the queue.
+  uint64 dropped;
+  BcmRxQueueStats() : enqueued(0), dequeued(0), dropped(0) {}
+  std::string ToString() const {
+    return absl::StrCat("(enqueued:", enqueued, ", dequeued:", dequeued,
+                        ", dropped:", dropped, ")");
+  }
+};
+
+// BcmRxScheduler sits between the RX thread of a KNET interface and the
+// PacketIn writer registered for it. The received packets are classified by
+// their CoS into separate bounded queues, so that a flood of punted packets on
+// a low CoS (e.g. ARP or TTL expired packets) can neither delay nor crowd out
+// the protocol packets (e.g. BGP or LACP) received on a higher CoS. The
+// packets are dequeued either with strict priority (highest CoS first) or
+// with deficit round robin, weighted by the per-CoS weights in the config.
+//
+// The class is thread-safe. Typically one thread enqueues the packets and
+// another one dequeues them and writes them to the controller.
+class BcmRxScheduler {
+ public:
+  // Default max number of packets waiting in each CoS queue.
+  static constexpr int kDefaultMaxQueuePkts = 256;
+  // Number of bytes a queue of weight 1 may send in each deficit round robin
+  // round.
+  static constexpr int kDrrQuantumBytes = 2048;
+
+  explicit BcmRxScheduler(const GoogleConfig::BcmRxSchedulerConfig& config);
+  ~BcmRxScheduler() {}
+
+  // Verifies the given config. Returns error if the config includes an invalid
+  // CoS, queue size or weight.
+  static ::util::Status VerifyConfig(
+      const GoogleConfig::BcmRxSchedulerConfig& config);
+
+  // Applies a new config. The packets already in the queues are kept, even if
+  // a queue now holds more packets than its new max size. Assumes the config
+  // has been verified with VerifyConfig().
+  void UpdateConfig(const GoogleConfig::BcmRxSchedulerConfig& config)
+      LOCKS_EXCLUDED(lock_);
+
+  // Adds the packet to the queue of the given CoS. A CoS out of the [0,
+  // kMaxCos] range is treated as the lowest CoS (0). Never blocks. Returns
+  // false if the queue is full or the scheduler is shutdown, in which case the
+  // packet is dropped.
+  bool Enqueue(int cos, ::p4::v1::PacketIn packet) LOCKS_EXCLUDED(lock_);
+
+  // Blocks until there is a packet to send and moves the next packet, based
+  // on the scheduling mode, to 'packet'. Returns false once the scheduler is
+  // shutdown.
+  bool Dequeue(::p4::v1::PacketIn* packet) LOCKS_EXCLUDED(lock_);
+
+  // Drops all the waiting packets and wakes up any Dequeue() call. All the
+  // Enqueue() and Dequeue() calls after this will fail. Idempotent.
+  void Shutdown() LOCKS_EXCLUDED(lock_);
+
+  // Returns a copy of the stats for the queue of the given CoS.
+  ::util::StatusOr<BcmRxQueueStats> GetQueueStats(int cos) const
+      LOCKS_EXCLUDED(lock_);
+
+  // Returns the histogram of the time, in microseconds, the packets of the
+  // given CoS waited in their queue. 'cos' must be in [0, kMaxCos].
+  const LatencyHistogram& latency_histogram(int cos) const {
+    return latency_usecs_[cos];
+  }
+
+  // Returns the stats and latencies of all the queues as string.
+  std::string DumpStats() const LOCKS_EXCLUDED(lock_);
+
+  // Number of packets currently waiting in all the queues.
+  size_t size() const LOCKS_EXCLUDED(lock_);
+
+  // BcmRxScheduler is neither copyable nor movable.
+  BcmRxScheduler(const BcmRxScheduler&) = delete;
+  BcmRxScheduler& operator=(const BcmRxScheduler&) = delete;
+
+ private:
+  static constexpr int kNumQueues = kMaxCos + 1;
+
+  // A packet waiting in a queue.
+  struct Entry {
+    ::p4::v1::PacketIn packet;
+    int64 enqueue_time_usecs;
+  };
+
+  // A CoS queue and its scheduling state.
+  struct Queue {
+    std::deque<Entry> entries;
+    size_t max_size;
+    int weight;
+    // Number of bytes the queue may still send in the current deficit round
+    // robin round.
+    int64 deficit;
+    BcmRxQueueStats stats;
+    Queue()
+        : entries(),
+          max_size(kDefaultMaxQueuePkts),
+          weight(1),
+          deficit(0),
+          stats() {}
+  };
+
+  // Returns the CoS of the queue to dequeue the next packet from. Must be
+  // called only if there is at least one waiting packet.
+  int PickQueue() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  mutable absl::Mutex lock_;
+  absl::CondVar queue_not_empty_;
+  GoogleConfig::BcmRxSchedulerConfig::SchedulingMode scheduling_mode_
+      GUARDED_BY(lock_);
+  // The CoS queues, indexed by CoS.
+  Queue queues_[kNumQueues] GUARDED_BY(lock_);
+  // Total number of packets waiting in all the queues.
+  size_t size_ GUARDED_BY(lock_);
+  // The queue currently visited by the deficit round robin, and whether it
+  // already got its quantum for this visit.
+  int drr_cos_ GUARDED_BY(lock_);
+  bool drr_quantum_added_ GUARDED_BY(lock_);
+  bool shutdown_ GUARDED_BY(lock_);
+
+  // Per CoS histograms of the time spent in the queue. Recorded lock-free.
+  LatencyHistogram latency_usecs_[kNumQueues];
+};
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BCM_BCM_RX_SCHEDULER_H_
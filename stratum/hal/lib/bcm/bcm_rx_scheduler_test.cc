@@ -0,0 +1,210 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/bcm/bcm_rx_scheduler.h"
+
+#include <map>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/utils.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+namespace {
+
+::p4::v1::PacketIn Packet(const std::string& payload) {
+  ::p4::v1::PacketIn packet;
+  packet.set_payload(payload);
+  return packet;
+}
+
+GoogleConfig::BcmRxSchedulerConfig ParseConfig(const std::string& text) {
+  GoogleConfig::BcmRxSchedulerConfig config;
+  CHECK_OK(ParseProtoFromString(text, &config));
+  return config;
+}
+
+// Dequeues 'n' packets and returns their payloads.
+std::vector<std::string> DequeueN(BcmRxScheduler* scheduler, int n) {
+  std::vector<std::string> payloads;
+  ::p4::v1::PacketIn packet;
+  for (int i = 0; i < n && scheduler->Dequeue(&packet); ++i) {
+    payloads.push_back(packet.payload());
+  }
+  return payloads;
+}
+
+TEST(BcmRxSchedulerTest, StrictPriority) {
+  BcmRxScheduler scheduler((GoogleConfig::BcmRxSchedulerConfig()));
+  EXPECT_TRUE(scheduler.Enqueue(0, Packet("arp1")));
+  EXPECT_TRUE(scheduler.Enqueue(0, Packet("arp2")));
+  EXPECT_TRUE(scheduler.Enqueue(6, Packet("bgp")));
+  EXPECT_TRUE(scheduler.Enqueue(3, Packet("ttl")));
+  EXPECT_TRUE(scheduler.Enqueue(7, Packet("lacp")));
+  EXPECT_EQ(5U, scheduler.size());
+  EXPECT_EQ(std::vector<std::string>({"lacp", "bgp", "ttl", "arp1", "arp2"}),
+            DequeueN(&scheduler, 5));
+  EXPECT_EQ(0U, scheduler.size());
+  EXPECT_EQ(2, scheduler.latency_histogram(0).Count());
+  EXPECT_EQ(1, scheduler.latency_histogram(7).Count());
+}
+
+TEST(BcmRxSchedulerTest, InvalidCosUsesLowestQueue) {
+  BcmRxScheduler scheduler((GoogleConfig::BcmRxSchedulerConfig()));
+  EXPECT_TRUE(scheduler.Enqueue(kMaxCos + 1, Packet("a")));
+  EXPECT_TRUE(scheduler.Enqueue(-1, Packet("b")));
+  ASSERT_OK_AND_ASSIGN(BcmRxQueueStats stats, scheduler.GetQueueStats(0));
+  EXPECT_EQ(2U, stats.enqueued);
+  EXPECT_FALSE(scheduler.GetQueueStats(kMaxCos + 1).ok());
+}
+
+TEST(BcmRxSchedulerTest, TailDropPerQueue) {
+  BcmRxScheduler scheduler(ParseConfig(R"(
+      max_queue_pkts: 2
+      per_cos_queue_configs {
+        key: 6
+        value { max_queue_pkts: 3 }
+      }
+  )"));
+  // A flood on CoS 0 does not take any room from CoS 6.
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i < 2, scheduler.Enqueue(0, Packet("arp")));
+  }
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(i < 3, scheduler.Enqueue(6, Packet("bgp")));
+  }
+  ASSERT_OK_AND_ASSIGN(BcmRxQueueStats stats, scheduler.GetQueueStats(0));
+  EXPECT_EQ(2U, stats.enqueued);
+  EXPECT_EQ(8U, stats.dropped);
+  ASSERT_OK_AND_ASSIGN(stats, scheduler.GetQueueStats(6));
+  EXPECT_EQ(3U, stats.enqueued);
+  EXPECT_EQ(1U, stats.dropped);
+  EXPECT_EQ(5U, scheduler.size());
+}
+
+TEST(BcmRxSchedulerTest, WeightedFair) {
+  BcmRxScheduler scheduler(ParseConfig(R"(
+      scheduling_mode: WEIGHTED_FAIR
+      max_queue_pkts: 1000
+      per_cos_queue_configs {
+        key: 0
+        value { weight: 1 }
+      }
+      per_cos_queue_configs {
+        key: 6
+        value { weight: 3 }
+      }
+  )"));
+  // Same size packets, so the queues should get packets in a 3:1 ratio as long
+  // as both are backlogged.
+  const std::string payload(BcmRxScheduler::kDrrQuantumBytes / 2, 'x');
+  for (int i = 0; i < 400; ++i) {
+    ASSERT_TRUE(scheduler.Enqueue(0, Packet(payload + "0")));
+    ASSERT_TRUE(scheduler.Enqueue(6, Packet(payload + "6")));
+  }
+  std::map<char, int> counts;
+  for (const auto& p : DequeueN(&scheduler, 400)) counts[p.back()]++;
+  EXPECT_NEAR(300, counts['6'], 4);
+  EXPECT_NEAR(100, counts['0'], 4);
+  // Once CoS 6 is drained, CoS 0 gets all the bandwidth.
+  for (const auto& p : DequeueN(&scheduler, 400)) counts[p.back()]++;
+  EXPECT_EQ(400, counts['6']);
+  EXPECT_EQ(400, counts['0']);
+  EXPECT_EQ(0U, scheduler.size());
+}
+
+TEST(BcmRxSchedulerTest, WeightedFairLargePackets) {
+  BcmRxScheduler scheduler(ParseConfig("scheduling_mode: WEIGHTED_FAIR"));
+  // Packets larger than the quantum are sent after a few rounds.
+  const std::string payload(BcmRxScheduler::kDrrQuantumBytes * 3, 'x');
+  ASSERT_TRUE(scheduler.Enqueue(2, Packet(payload)));
+  ASSERT_TRUE(scheduler.Enqueue(5, Packet("small")));
+  EXPECT_EQ(std::vector<std::string>({"small", payload}),
+            DequeueN(&scheduler, 2));
+}
+
+TEST(BcmRxSchedulerTest, UpdateConfig) {
+  BcmRxScheduler scheduler(ParseConfig("max_queue_pkts: 1"));
+  EXPECT_TRUE(scheduler.Enqueue(1, Packet("a")));
+  EXPECT_FALSE(scheduler.Enqueue(1, Packet("b")));
+  scheduler.UpdateConfig(ParseConfig("max_queue_pkts: 2"));
+  EXPECT_TRUE(scheduler.Enqueue(1, Packet("b")));
+  EXPECT_EQ(std::vector<std::string>({"a", "b"}), DequeueN(&scheduler, 2));
+}
+
+TEST(BcmRxSchedulerTest, VerifyConfig) {
+  EXPECT_OK(BcmRxScheduler::VerifyConfig(ParseConfig(R"(
+      scheduling_mode: WEIGHTED_FAIR
+      per_cos_queue_configs {
+        key: 7
+        value { max_queue_pkts: 10 weight: 5 }
+      }
+  )")));
+  EXPECT_FALSE(BcmRxScheduler::VerifyConfig(ParseConfig(R"(
+      per_cos_queue_configs {
+        key: 8
+        value { weight: 1 }
+      }
+  )")).ok());
+  EXPECT_FALSE(BcmRxScheduler::VerifyConfig(ParseConfig(R"(
+      per_cos_queue_configs {
+        key: 1
+        value { weight: -1 }
+      }
+  )")).ok());
+  EXPECT_FALSE(
+      BcmRxScheduler::VerifyConfig(ParseConfig("max_queue_pkts: -2")).ok());
+}
+
+TEST(BcmRxSchedulerTest, ShutdownWakesUpDequeue) {
+  BcmRxScheduler scheduler((GoogleConfig::BcmRxSchedulerConfig()));
+  std::vector<std::string> payloads;
+  std::thread t([&scheduler, &payloads] {
+    ::p4::v1::PacketIn packet;
+    while (scheduler.Dequeue(&packet)) payloads.push_back(packet.payload());
+  });
+  EXPECT_TRUE(scheduler.Enqueue(4, Packet("a")));
+  while (scheduler.size() > 0) {
+  }  // wait for the packet to be taken
+  scheduler.Shutdown();
+  t.join();
+  EXPECT_EQ(std::vector<std::string>({"a"}), payloads);
+  EXPECT_FALSE(scheduler.Enqueue(4, Packet("b")));
+  ASSERT_OK_AND_ASSIGN(BcmRxQueueStats stats, scheduler.GetQueueStats(4));
+  EXPECT_EQ(1U, stats.enqueued);
+  EXPECT_EQ(1U, stats.dequeued);
+}
+
+TEST(BcmRxSchedulerTest, ShutdownDropsWaitingPackets) {
+  BcmRxScheduler scheduler((GoogleConfig::BcmRxSchedulerConfig()));
+  EXPECT_TRUE(scheduler.Enqueue(4, Packet("a")));
+  EXPECT_TRUE(scheduler.Enqueue(4, Packet("b")));
+  scheduler.Shutdown();
+  ::p4::v1::PacketIn packet;
+  EXPECT_FALSE(scheduler.Dequeue(&packet));
+  ASSERT_OK_AND_ASSIGN(BcmRxQueueStats stats, scheduler.GetQueueStats(4));
+  EXPECT_EQ(2U, stats.dropped);
+  EXPECT_EQ(0U, scheduler.size());
+}
+
+}  // namespace
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
@@ -24,6 +24,7 @@
 #include <vector>
 #include <memory>
 #include <set>
+#include <utility>
 
 #include "stratum/glue/integral_types.h"
 #include "stratum/glue/status/status.h"
@@ -180,6 +181,15 @@ class BcmSdkInterface {
     PortState state;
   };
 
+  // L3HostKey identifies an IPv4 or IPv6 L3 host route, as given to
+  // AddL3HostIpv4() and AddL3HostIpv6().
+  struct L3HostKey {
+    int vrf;
+    uint32 ipv4;       // Used for IPv4 hosts, i.e. if ipv6 is empty.
+    std::string ipv6;  // Used for IPv6 hosts.
+    L3HostKey() : vrf(0), ipv4(0), ipv6() {}
+  };
+
   // A few predefined priority values that can be used by external functions
   // when calling RegisterLinkscanEventWriter.
   static constexpr int kLinkscanEventWriterPriorityHigh = 100;
@@ -354,6 +364,15 @@ class BcmSdkInterface {
   virtual ::util::Status ModifyEcmpEgressIntf(
       int unit, int egress_intf_id, const std::vector<int>& member_ids) = 0;
 
+  // Modifies the members of several existing ECMP/WCMP egress intfs on a unit
+  // in one batch. Each element of 'groups' holds the ID of an ECMP/WCMP egress
+  // intf and its new list of member egress intf IDs. The groups are handed
+  // to the SDK in the given order. Return error if any of the ECMP/WCMP egress
+  // intfs does not exist.
+  virtual ::util::Status ModifyEcmpEgressIntfs(
+      int unit,
+      const std::vector<std::pair<int, std::vector<int>>>& groups) = 0;
+
   // Deletes an L3 ECMP/WCMP egress intf given its ID from a given unit.
   virtual ::util::Status DeleteEcmpEgressIntf(int unit, int egress_intf_id) = 0;
 
@@ -457,6 +476,12 @@ class BcmSdkInterface {
   virtual ::util::Status DeleteL3HostIpv6(int unit, int vrf,
                                           const std::string& ipv6) = 0;
 
+  // Reads and clears the hit bits of all the IPv4 and IPv6 L3 host routes in
+  // one pass over the host tables. The keys of the hosts which were hit by a
+  // packet since the previous call are appended to 'hits'.
+  virtual ::util::Status GetAndClearL3HostHits(
+      int unit, std::vector<L3HostKey>* hits) = 0;
+
   // Adds an entry to match the given (vlan, vlan_mask, dst_mac, dst_mac_mask)
   // to the my station TCAM, with the given priority. NOOP if the entry already
   // exists. All the IPv4/IPv6 packets, independent of the src port, will be
@@ -687,6 +712,12 @@ class BcmSdkInterface {
   virtual ::util::Status GetAclStats(int unit, int flow_id,
                                      BcmAclStats* stats) = 0;
 
+  // Reads and clears the hit bits of all the flows in table given by table_id
+  // in one pass over the table. The IDs of the flows which were hit by a
+  // packet since the previous call are appended to 'flow_ids'.
+  virtual ::util::Status GetAndClearAclFlowHits(int unit, int table_id,
+                                                std::vector<int>* flow_ids) = 0;
+
   // **************************************************************************
   // ACL Flow Metering Functions
   // **************************************************************************
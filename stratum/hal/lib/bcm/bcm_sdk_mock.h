@@ -92,6 +92,11 @@ class BcmSdkMock : public BcmSdkInterface {
   MOCK_METHOD3(ModifyEcmpEgressIntf,
                ::util::Status(int unit, int egress_intf_id,
                               const std::vector<int>& member_ids));
+  MOCK_METHOD2(
+      ModifyEcmpEgressIntfs,
+      ::util::Status(
+          int unit,
+          const std::vector<std::pair<int, std::vector<int>>>& groups));
   MOCK_METHOD2(DeleteEcmpEgressIntf,
                ::util::Status(int unit, int egress_intf_id));
   MOCK_METHOD7(AddL3RouteIpv4,
@@ -130,6 +135,8 @@ class BcmSdkMock : public BcmSdkInterface {
                ::util::Status(int unit, int vrf, uint32 ipv4));
   MOCK_METHOD3(DeleteL3HostIpv6,
                ::util::Status(int unit, int vrf, const std::string& ipv6));
+  MOCK_METHOD2(GetAndClearL3HostHits,
+               ::util::Status(int unit, std::vector<L3HostKey>* hits));
   MOCK_METHOD6(AddMyStationEntry,
                ::util::StatusOr<int>(int unit, int priority, int vlan,
                                      int vlan_mask, uint64 dst_mac,
@@ -223,6 +230,9 @@ class BcmSdkMock : public BcmSdkInterface {
   MOCK_METHOD2(RemoveAclStats, ::util::Status(int unit, int flow_id));
   MOCK_METHOD3(GetAclStats,
                ::util::Status(int unit, int flow_id, BcmAclStats* stats));
+  MOCK_METHOD3(GetAndClearAclFlowHits,
+               ::util::Status(int unit, int table_id,
+                              std::vector<int>* flow_ids));
   MOCK_METHOD3(SetAclPolicer, ::util::Status(int unit, int flow_id,
                                              const BcmMeterConfig& meter));
 };
@@ -0,0 +1,682 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/bcm/bcm_sdk_tracer.h"
+
+#include "stratum/glue/logging.h"
+#include "stratum/lib/call_tracer.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+
+// Records the enclosing BcmSdkInterface call. The argument summary, made of
+// the StrCat() of the remaining macro arguments, is only built when tracing.
+#define BCM_SDK_TRACE(unit, ...)                                      \
+  ::stratum::ScopedTraceEvent trace_event("bcm_sdk", __func__, unit); \
+  if (trace_event.active()) trace_event.set_args(absl::StrCat(__VA_ARGS__))
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+BcmSdkTracer::BcmSdkTracer(BcmSdkInterface* bcm_sdk_interface)
+    : bcm_sdk_interface_(ABSL_DIE_IF_NULL(bcm_sdk_interface)) {}
+
+::util::Status BcmSdkTracer::InitializeSdk(
+    const std::string& config_file_path,
+    const std::string& config_flush_file_path,
+    const std::string& bcm_shell_log_file_path) {
+  BCM_SDK_TRACE(-1, "config_file_path=", config_file_path,
+                " config_flush_file_path=", config_flush_file_path,
+                " bcm_shell_log_file_path=", bcm_shell_log_file_path);
+  return bcm_sdk_interface_->InitializeSdk(config_file_path, config_flush_file_path,
+                                       bcm_shell_log_file_path);
+}
+
+::util::Status BcmSdkTracer::FindUnit(int unit, int pci_bus, int pci_slot,
+                                      BcmChip::BcmChipType chip_type) {
+  BCM_SDK_TRACE(unit, "pci_bus=", pci_bus, " pci_slot=", pci_slot,
+                " chip_type=", BcmChip::BcmChipType_Name(chip_type));
+  return bcm_sdk_interface_->FindUnit(unit, pci_bus, pci_slot, chip_type);
+}
+
+::util::Status BcmSdkTracer::InitializeUnit(int unit, bool warm_boot) {
+  BCM_SDK_TRACE(unit, "warm_boot=", warm_boot);
+  return bcm_sdk_interface_->InitializeUnit(unit, warm_boot);
+}
+
+::util::Status BcmSdkTracer::ShutdownUnit(int unit) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->ShutdownUnit(unit);
+}
+
+::util::Status BcmSdkTracer::ShutdownAllUnits() {
+  BCM_SDK_TRACE(-1, "");
+  return bcm_sdk_interface_->ShutdownAllUnits();
+}
+
+::util::Status BcmSdkTracer::SetModuleId(int unit, int module) {
+  BCM_SDK_TRACE(unit, "module=", module);
+  return bcm_sdk_interface_->SetModuleId(unit, module);
+}
+
+::util::Status BcmSdkTracer::InitializePort(int unit, int port) {
+  BCM_SDK_TRACE(unit, "port=", port);
+  return bcm_sdk_interface_->InitializePort(unit, port);
+}
+
+::util::Status BcmSdkTracer::SetPortOptions(int unit, int port,
+                                            const BcmPortOptions& options) {
+  BCM_SDK_TRACE(unit, "port=", port, " options=", options.ShortDebugString());
+  return bcm_sdk_interface_->SetPortOptions(unit, port, options);
+}
+
+::util::Status BcmSdkTracer::GetPortOptions(int unit, int port,
+                                            BcmPortOptions* options) {
+  BCM_SDK_TRACE(unit, "port=", port);
+  return bcm_sdk_interface_->GetPortOptions(unit, port, options);
+}
+
+::util::Status BcmSdkTracer::GetPortCounters(int unit, int port,
+                                             PortCounters* pc) {
+  BCM_SDK_TRACE(unit, "port=", port);
+  return bcm_sdk_interface_->GetPortCounters(unit, port, pc);
+}
+
+::util::Status BcmSdkTracer::StartDiagShellServer() {
+  BCM_SDK_TRACE(-1, "");
+  return bcm_sdk_interface_->StartDiagShellServer();
+}
+
+::util::Status BcmSdkTracer::StartLinkscan(int unit) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->StartLinkscan(unit);
+}
+
+::util::Status BcmSdkTracer::StopLinkscan(int unit) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->StopLinkscan(unit);
+}
+
+void BcmSdkTracer::OnLinkscanEvent(int unit, int port, PortState linkstatus) {
+  BCM_SDK_TRACE(unit, "port=", port, " linkstatus=",
+                PortState_Name(linkstatus));
+  bcm_sdk_interface_->OnLinkscanEvent(unit, port, linkstatus);
+}
+
+::util::StatusOr<int> BcmSdkTracer::RegisterLinkscanEventWriter(
+    std::unique_ptr<ChannelWriter<LinkscanEvent>> writer, int priority) {
+  BCM_SDK_TRACE(-1, "priority=", priority);
+  return bcm_sdk_interface_->RegisterLinkscanEventWriter(std::move(writer),
+                                                     priority);
+}
+
+::util::Status BcmSdkTracer::UnregisterLinkscanEventWriter(int id) {
+  BCM_SDK_TRACE(-1, "id=", id);
+  return bcm_sdk_interface_->UnregisterLinkscanEventWriter(id);
+}
+
+::util::StatusOr<BcmPortOptions::LinkscanMode>
+BcmSdkTracer::GetPortLinkscanMode(int unit, int port) {
+  BCM_SDK_TRACE(unit, "port=", port);
+  return bcm_sdk_interface_->GetPortLinkscanMode(unit, port);
+}
+
+::util::Status BcmSdkTracer::SetMtu(int unit, int mtu) {
+  BCM_SDK_TRACE(unit, "mtu=", mtu);
+  return bcm_sdk_interface_->SetMtu(unit, mtu);
+}
+
+::util::StatusOr<int> BcmSdkTracer::FindOrCreateL3RouterIntf(int unit,
+                                                             uint64 router_mac,
+                                                             int vlan) {
+  BCM_SDK_TRACE(unit, "router_mac=", absl::Hex(router_mac), " vlan=", vlan);
+  return bcm_sdk_interface_->FindOrCreateL3RouterIntf(unit, router_mac, vlan);
+}
+
+::util::Status BcmSdkTracer::DeleteL3RouterIntf(int unit, int router_intf_id) {
+  BCM_SDK_TRACE(unit, "router_intf_id=", router_intf_id);
+  return bcm_sdk_interface_->DeleteL3RouterIntf(unit, router_intf_id);
+}
+
+::util::StatusOr<int> BcmSdkTracer::FindOrCreateL3CpuEgressIntf(int unit) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->FindOrCreateL3CpuEgressIntf(unit);
+}
+
+::util::StatusOr<int> BcmSdkTracer::FindOrCreateL3PortEgressIntf(
+    int unit, stratum::uint64 nexthop_mac, int port, int vlan,
+    int router_intf_id) {
+  BCM_SDK_TRACE(unit, "nexthop_mac=", absl::Hex(nexthop_mac), " port=", port,
+                " vlan=", vlan, " router_intf_id=", router_intf_id);
+  return bcm_sdk_interface_->FindOrCreateL3PortEgressIntf(unit, nexthop_mac, port,
+                                                      vlan, router_intf_id);
+}
+
+::util::StatusOr<int> BcmSdkTracer::FindOrCreateL3TrunkEgressIntf(
+    int unit, stratum::uint64 nexthop_mac, int trunk, int vlan,
+    int router_intf_id) {
+  BCM_SDK_TRACE(unit, "nexthop_mac=", absl::Hex(nexthop_mac), " trunk=", trunk,
+                " vlan=", vlan, " router_intf_id=", router_intf_id);
+  return bcm_sdk_interface_->FindOrCreateL3TrunkEgressIntf(unit, nexthop_mac, trunk,
+                                                       vlan, router_intf_id);
+}
+
+::util::StatusOr<int> BcmSdkTracer::FindOrCreateL3DropIntf(int unit) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->FindOrCreateL3DropIntf(unit);
+}
+
+::util::Status BcmSdkTracer::ModifyL3CpuEgressIntf(int unit,
+                                                   int egress_intf_id) {
+  BCM_SDK_TRACE(unit, "egress_intf_id=", egress_intf_id);
+  return bcm_sdk_interface_->ModifyL3CpuEgressIntf(unit, egress_intf_id);
+}
+
+::util::Status BcmSdkTracer::ModifyL3PortEgressIntf(int unit,
+                                                    int egress_intf_id,
+                                                    stratum::uint64 nexthop_mac,
+                                                    int port, int vlan,
+                                                    int router_intf_id) {
+  BCM_SDK_TRACE(unit, "egress_intf_id=", egress_intf_id, " nexthop_mac=",
+                absl::Hex(nexthop_mac), " port=", port, " vlan=", vlan,
+                " router_intf_id=", router_intf_id);
+  return bcm_sdk_interface_->ModifyL3PortEgressIntf(unit, egress_intf_id,
+                                                nexthop_mac, port, vlan,
+                                                router_intf_id);
+}
+
+::util::Status BcmSdkTracer::ModifyL3TrunkEgressIntf(
+    int unit, int egress_intf_id, stratum::uint64 nexthop_mac, int trunk,
+    int vlan, int router_intf_id) {
+  BCM_SDK_TRACE(unit, "egress_intf_id=", egress_intf_id, " nexthop_mac=",
+                absl::Hex(nexthop_mac), " trunk=", trunk, " vlan=", vlan,
+                " router_intf_id=", router_intf_id);
+  return bcm_sdk_interface_->ModifyL3TrunkEgressIntf(unit, egress_intf_id,
+                                                 nexthop_mac, trunk, vlan,
+                                                 router_intf_id);
+}
+
+::util::Status BcmSdkTracer::ModifyL3DropIntf(int unit, int egress_intf_id) {
+  BCM_SDK_TRACE(unit, "egress_intf_id=", egress_intf_id);
+  return bcm_sdk_interface_->ModifyL3DropIntf(unit, egress_intf_id);
+}
+
+::util::Status BcmSdkTracer::DeleteL3EgressIntf(int unit, int egress_intf_id) {
+  BCM_SDK_TRACE(unit, "egress_intf_id=", egress_intf_id);
+  return bcm_sdk_interface_->DeleteL3EgressIntf(unit, egress_intf_id);
+}
+
+::util::StatusOr<int> BcmSdkTracer::FindRouterIntfFromEgressIntf(
+    int unit, int egress_intf_id) {
+  BCM_SDK_TRACE(unit, "egress_intf_id=", egress_intf_id);
+  return bcm_sdk_interface_->FindRouterIntfFromEgressIntf(unit, egress_intf_id);
+}
+
+::util::StatusOr<int> BcmSdkTracer::FindOrCreateEcmpEgressIntf(
+    int unit, const std::vector<int>& member_ids) {
+  BCM_SDK_TRACE(unit, "member_ids=", absl::StrJoin(member_ids, ","));
+  return bcm_sdk_interface_->FindOrCreateEcmpEgressIntf(unit, member_ids);
+}
+
+::util::Status BcmSdkTracer::ModifyEcmpEgressIntf(
+    int unit, int egress_intf_id, const std::vector<int>& member_ids) {
+  BCM_SDK_TRACE(unit, "egress_intf_id=", egress_intf_id, " member_ids=",
+                absl::StrJoin(member_ids, ","));
+  return bcm_sdk_interface_->ModifyEcmpEgressIntf(unit, egress_intf_id, member_ids);
+}
+
+::util::Status BcmSdkTracer::ModifyEcmpEgressIntfs(
+    int unit, const std::vector<std::pair<int, std::vector<int>>>& groups) {
+  BCM_SDK_TRACE(unit, "num_groups=", groups.size());
+  return bcm_sdk_interface_->ModifyEcmpEgressIntfs(unit, groups);
+}
+
+::util::Status BcmSdkTracer::DeleteEcmpEgressIntf(int unit,
+                                                  int egress_intf_id) {
+  BCM_SDK_TRACE(unit, "egress_intf_id=", egress_intf_id);
+  return bcm_sdk_interface_->DeleteEcmpEgressIntf(unit, egress_intf_id);
+}
+
+::util::Status BcmSdkTracer::AddL3RouteIpv4(int unit, int vrf, uint32 subnet,
+                                            uint32 mask, int class_id,
+                                            int egress_intf_id,
+                                            bool is_intf_multipath) {
+  BCM_SDK_TRACE(unit, "vrf=", vrf, " subnet=", subnet, " mask=", mask,
+                " class_id=", class_id, " egress_intf_id=", egress_intf_id,
+                " is_intf_multipath=", is_intf_multipath);
+  return bcm_sdk_interface_->AddL3RouteIpv4(unit, vrf, subnet, mask, class_id,
+                                        egress_intf_id, is_intf_multipath);
+}
+
+::util::Status BcmSdkTracer::AddL3RouteIpv6(int unit, int vrf,
+                                            const std::string& subnet,
+                                            const std::string& mask,
+                                            int class_id, int egress_intf_id,
+                                            bool is_intf_multipath) {
+  BCM_SDK_TRACE(unit, "vrf=", vrf, " subnet=", absl::BytesToHexString(subnet),
+                " mask=", absl::BytesToHexString(mask), " class_id=", class_id,
+                " egress_intf_id=", egress_intf_id, " is_intf_multipath=",
+                is_intf_multipath);
+  return bcm_sdk_interface_->AddL3RouteIpv6(unit, vrf, subnet, mask, class_id,
+                                        egress_intf_id, is_intf_multipath);
+}
+
+::util::Status BcmSdkTracer::AddL3HostIpv4(int unit, int vrf, uint32 ipv4,
+                                           int class_id, int egress_intf_id) {
+  BCM_SDK_TRACE(unit, "vrf=", vrf, " ipv4=", ipv4, " class_id=", class_id,
+                " egress_intf_id=", egress_intf_id);
+  return bcm_sdk_interface_->AddL3HostIpv4(unit, vrf, ipv4, class_id,
+                                       egress_intf_id);
+}
+
+::util::Status BcmSdkTracer::AddL3HostIpv6(int unit, int vrf,
+                                           const std::string& ipv6,
+                                           int class_id, int egress_intf_id) {
+  BCM_SDK_TRACE(unit, "vrf=", vrf, " ipv6=", absl::BytesToHexString(ipv6),
+                " class_id=", class_id, " egress_intf_id=", egress_intf_id);
+  return bcm_sdk_interface_->AddL3HostIpv6(unit, vrf, ipv6, class_id,
+                                       egress_intf_id);
+}
+
+::util::Status BcmSdkTracer::ModifyL3RouteIpv4(int unit, int vrf, uint32 subnet,
+                                               uint32 mask, int class_id,
+                                               int egress_intf_id,
+                                               bool is_intf_multipath) {
+  BCM_SDK_TRACE(unit, "vrf=", vrf, " subnet=", subnet, " mask=", mask,
+                " class_id=", class_id, " egress_intf_id=", egress_intf_id,
+                " is_intf_multipath=", is_intf_multipath);
+  return bcm_sdk_interface_->ModifyL3RouteIpv4(unit, vrf, subnet, mask, class_id,
+                                           egress_intf_id, is_intf_multipath);
+}
+
+::util::Status BcmSdkTracer::ModifyL3RouteIpv6(int unit, int vrf,
+                                               const std::string& subnet,
+                                               const std::string& mask,
+                                               int class_id, int egress_intf_id,
+                                               bool is_intf_multipath) {
+  BCM_SDK_TRACE(unit, "vrf=", vrf, " subnet=", absl::BytesToHexString(subnet),
+                " mask=", absl::BytesToHexString(mask), " class_id=", class_id,
+                " egress_intf_id=", egress_intf_id, " is_intf_multipath=",
+                is_intf_multipath);
+  return bcm_sdk_interface_->ModifyL3RouteIpv6(unit, vrf, subnet, mask, class_id,
+                                           egress_intf_id, is_intf_multipath);
+}
+
+::util::Status BcmSdkTracer::ModifyL3HostIpv4(int unit, int vrf, uint32 ipv4,
+                                              int class_id,
+                                              int egress_intf_id) {
+  BCM_SDK_TRACE(unit, "vrf=", vrf, " ipv4=", ipv4, " class_id=", class_id,
+                " egress_intf_id=", egress_intf_id);
+  return bcm_sdk_interface_->ModifyL3HostIpv4(unit, vrf, ipv4, class_id,
+                                          egress_intf_id);
+}
+
+::util::Status BcmSdkTracer::ModifyL3HostIpv6(int unit, int vrf,
+                                              const std::string& ipv6,
+                                              int class_id,
+                                              int egress_intf_id) {
+  BCM_SDK_TRACE(unit, "vrf=", vrf, " ipv6=", absl::BytesToHexString(ipv6),
+                " class_id=", class_id, " egress_intf_id=", egress_intf_id);
+  return bcm_sdk_interface_->ModifyL3HostIpv6(unit, vrf, ipv6, class_id,
+                                          egress_intf_id);
+}
+
+::util::Status BcmSdkTracer::DeleteL3RouteIpv4(int unit, int vrf, uint32 subnet,
+                                               uint32 mask) {
+  BCM_SDK_TRACE(unit, "vrf=", vrf, " subnet=", subnet, " mask=", mask);
+  return bcm_sdk_interface_->DeleteL3RouteIpv4(unit, vrf, subnet, mask);
+}
+
+::util::Status BcmSdkTracer::DeleteL3RouteIpv6(int unit, int vrf,
+                                               const std::string& subnet,
+                                               const std::string& mask) {
+  BCM_SDK_TRACE(unit, "vrf=", vrf, " subnet=", absl::BytesToHexString(subnet),
+                " mask=", absl::BytesToHexString(mask));
+  return bcm_sdk_interface_->DeleteL3RouteIpv6(unit, vrf, subnet, mask);
+}
+
+::util::Status BcmSdkTracer::DeleteL3HostIpv4(int unit, int vrf, uint32 ipv4) {
+  BCM_SDK_TRACE(unit, "vrf=", vrf, " ipv4=", ipv4);
+  return bcm_sdk_interface_->DeleteL3HostIpv4(unit, vrf, ipv4);
+}
+
+::util::Status BcmSdkTracer::DeleteL3HostIpv6(int unit, int vrf,
+                                              const std::string& ipv6) {
+  BCM_SDK_TRACE(unit, "vrf=", vrf, " ipv6=", absl::BytesToHexString(ipv6));
+  return bcm_sdk_interface_->DeleteL3HostIpv6(unit, vrf, ipv6);
+}
+
+::util::Status BcmSdkTracer::GetAndClearL3HostHits(
+    int unit, std::vector<L3HostKey>* hits) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->GetAndClearL3HostHits(unit, hits);
+}
+
+::util::StatusOr<int> BcmSdkTracer::AddMyStationEntry(int unit, int priority,
+                                                      int vlan, int vlan_mask,
+                                                      uint64 dst_mac,
+                                                      uint64 dst_mac_mask) {
+  BCM_SDK_TRACE(unit, "priority=", priority, " vlan=", vlan, " vlan_mask=",
+                vlan_mask, " dst_mac=", absl::Hex(dst_mac), " dst_mac_mask=",
+                absl::Hex(dst_mac_mask));
+  return bcm_sdk_interface_->AddMyStationEntry(unit, priority, vlan, vlan_mask,
+                                           dst_mac, dst_mac_mask);
+}
+
+::util::Status BcmSdkTracer::DeleteMyStationEntry(int unit, int station_id) {
+  BCM_SDK_TRACE(unit, "station_id=", station_id);
+  return bcm_sdk_interface_->DeleteMyStationEntry(unit, station_id);
+}
+
+::util::Status BcmSdkTracer::AddL2Entry(int unit, int vlan, uint64 dst_mac,
+                                        int logical_port, int trunk_port,
+                                        int l2_mcast_group_id, int class_id,
+                                        bool copy_to_cpu, bool dst_drop) {
+  BCM_SDK_TRACE(unit, "vlan=", vlan, " dst_mac=", absl::Hex(dst_mac),
+                " logical_port=", logical_port, " trunk_port=", trunk_port,
+                " l2_mcast_group_id=", l2_mcast_group_id, " class_id=",
+                class_id, " copy_to_cpu=", copy_to_cpu, " dst_drop=", dst_drop);
+  return bcm_sdk_interface_->AddL2Entry(unit, vlan, dst_mac, logical_port,
+                                    trunk_port, l2_mcast_group_id, class_id,
+                                    copy_to_cpu, dst_drop);
+}
+
+::util::Status BcmSdkTracer::DeleteL2Entry(int unit, int vlan, uint64 dst_mac) {
+  BCM_SDK_TRACE(unit, "vlan=", vlan, " dst_mac=", absl::Hex(dst_mac));
+  return bcm_sdk_interface_->DeleteL2Entry(unit, vlan, dst_mac);
+}
+
+::util::Status BcmSdkTracer::AddL2MulticastEntry(int unit, int priority,
+                                                 int vlan, int vlan_mask,
+                                                 uint64 dst_mac,
+                                                 uint64 dst_mac_mask,
+                                                 bool copy_to_cpu, bool drop,
+                                                 uint8 l2_mcast_group_id) {
+  BCM_SDK_TRACE(unit, "priority=", priority, " vlan=", vlan, " vlan_mask=",
+                vlan_mask, " dst_mac=", absl::Hex(dst_mac), " dst_mac_mask=",
+                absl::Hex(dst_mac_mask), " copy_to_cpu=", copy_to_cpu, " drop=",
+                drop, " l2_mcast_group_id=",
+                static_cast<int>(l2_mcast_group_id));
+  return bcm_sdk_interface_->AddL2MulticastEntry(unit, priority, vlan, vlan_mask,
+                                             dst_mac, dst_mac_mask, copy_to_cpu,
+                                             drop, l2_mcast_group_id);
+}
+
+::util::Status BcmSdkTracer::DeleteL2MulticastEntry(int unit, int vlan,
+                                                    int vlan_mask,
+                                                    uint64 dst_mac,
+                                                    uint64 dst_mac_mask) {
+  BCM_SDK_TRACE(unit, "vlan=", vlan, " vlan_mask=", vlan_mask, " dst_mac=",
+                absl::Hex(dst_mac), " dst_mac_mask=", absl::Hex(dst_mac_mask));
+  return bcm_sdk_interface_->DeleteL2MulticastEntry(unit, vlan, vlan_mask, dst_mac,
+                                                dst_mac_mask);
+}
+
+::util::Status BcmSdkTracer::InsertPacketReplicationEntry(
+    const BcmPacketReplicationEntry& entry) {
+  BCM_SDK_TRACE(entry.unit(), "entry=", entry.ShortDebugString());
+  return bcm_sdk_interface_->InsertPacketReplicationEntry(entry);
+}
+
+::util::Status BcmSdkTracer::DeletePacketReplicationEntry(
+    const BcmPacketReplicationEntry& entry) {
+  BCM_SDK_TRACE(entry.unit(), "entry=", entry.ShortDebugString());
+  return bcm_sdk_interface_->DeletePacketReplicationEntry(entry);
+}
+
+::util::Status BcmSdkTracer::DeleteL2EntriesByVlan(int unit, int vlan) {
+  BCM_SDK_TRACE(unit, "vlan=", vlan);
+  return bcm_sdk_interface_->DeleteL2EntriesByVlan(unit, vlan);
+}
+
+::util::Status BcmSdkTracer::AddVlanIfNotFound(int unit, int vlan) {
+  BCM_SDK_TRACE(unit, "vlan=", vlan);
+  return bcm_sdk_interface_->AddVlanIfNotFound(unit, vlan);
+}
+
+::util::Status BcmSdkTracer::DeleteVlanIfFound(int unit, int vlan) {
+  BCM_SDK_TRACE(unit, "vlan=", vlan);
+  return bcm_sdk_interface_->DeleteVlanIfFound(unit, vlan);
+}
+
+::util::Status BcmSdkTracer::ConfigureVlanBlock(int unit, int vlan,
+                                                bool block_broadcast,
+                                                bool block_known_multicast,
+                                                bool block_unknown_multicast,
+                                                bool block_unknown_unicast) {
+  BCM_SDK_TRACE(unit, "vlan=", vlan, " block_broadcast=", block_broadcast,
+                " block_known_multicast=", block_known_multicast,
+                " block_unknown_multicast=", block_unknown_multicast,
+                " block_unknown_unicast=", block_unknown_unicast);
+  return bcm_sdk_interface_->ConfigureVlanBlock(unit, vlan, block_broadcast,
+                                            block_known_multicast,
+                                            block_unknown_multicast,
+                                            block_unknown_unicast);
+}
+
+::util::Status BcmSdkTracer::ConfigureL2Learning(int unit, int vlan,
+                                                 bool disable_l2_learning) {
+  BCM_SDK_TRACE(unit, "vlan=", vlan, " disable_l2_learning=",
+                disable_l2_learning);
+  return bcm_sdk_interface_->ConfigureL2Learning(unit, vlan, disable_l2_learning);
+}
+
+::util::Status BcmSdkTracer::SetL2AgeTimer(int unit, int l2_age_duration_sec) {
+  BCM_SDK_TRACE(unit, "l2_age_duration_sec=", l2_age_duration_sec);
+  return bcm_sdk_interface_->SetL2AgeTimer(unit, l2_age_duration_sec);
+}
+
+::util::Status BcmSdkTracer::ConfigSerdesForPort(
+    int unit, int port, uint64 speed_bps, int serdes_core, int serdes_lane,
+    int serdes_num_lanes, const std::string& intf_type,
+    const SerdesRegisterConfigs& serdes_register_configs,
+    const SerdesAttrConfigs& serdes_attr_configs) {
+  BCM_SDK_TRACE(unit, "port=", port, " speed_bps=", speed_bps, " serdes_core=",
+                serdes_core, " serdes_lane=", serdes_lane, " serdes_num_lanes=",
+                serdes_num_lanes, " intf_type=", intf_type,
+                " num_serdes_register_configs=", serdes_register_configs.size(),
+                " num_serdes_attr_configs=", serdes_attr_configs.size());
+  return bcm_sdk_interface_->ConfigSerdesForPort(unit, port, speed_bps, serdes_core,
+                                             serdes_lane, serdes_num_lanes,
+                                             intf_type, serdes_register_configs,
+                                             serdes_attr_configs);
+}
+
+::util::Status BcmSdkTracer::CreateKnetIntf(int unit, int vlan,
+                                            std::string* netif_name,
+                                            int* netif_id) {
+  BCM_SDK_TRACE(unit, "vlan=", vlan);
+  return bcm_sdk_interface_->CreateKnetIntf(unit, vlan, netif_name, netif_id);
+}
+
+::util::Status BcmSdkTracer::DestroyKnetIntf(int unit, int netif_id) {
+  BCM_SDK_TRACE(unit, "netif_id=", netif_id);
+  return bcm_sdk_interface_->DestroyKnetIntf(unit, netif_id);
+}
+
+::util::StatusOr<int> BcmSdkTracer::CreateKnetFilter(int unit, int netif_id,
+                                                     KnetFilterType type) {
+  BCM_SDK_TRACE(unit, "netif_id=", netif_id, " type=", static_cast<int>(type));
+  return bcm_sdk_interface_->CreateKnetFilter(unit, netif_id, type);
+}
+
+::util::Status BcmSdkTracer::DestroyKnetFilter(int unit, int filter_id) {
+  BCM_SDK_TRACE(unit, "filter_id=", filter_id);
+  return bcm_sdk_interface_->DestroyKnetFilter(unit, filter_id);
+}
+
+::util::Status BcmSdkTracer::StartRx(int unit, const RxConfig& rx_config) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->StartRx(unit, rx_config);
+}
+
+::util::Status BcmSdkTracer::StopRx(int unit) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->StopRx(unit);
+}
+
+::util::Status BcmSdkTracer::SetRateLimit(
+    int unit, const RateLimitConfig& rate_limit_config) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->SetRateLimit(unit, rate_limit_config);
+}
+
+::util::Status BcmSdkTracer::GetKnetHeaderForDirectTx(int unit, int port,
+                                                      int cos, uint64 smac,
+                                                      size_t packet_len,
+                                                      std::string* header) {
+  BCM_SDK_TRACE(unit, "port=", port, " cos=", cos, " smac=", absl::Hex(smac),
+                " packet_len=", packet_len);
+  return bcm_sdk_interface_->GetKnetHeaderForDirectTx(unit, port, cos, smac,
+                                                  packet_len, header);
+}
+
+::util::Status BcmSdkTracer::GetKnetHeaderForIngressPipelineTx(
+    int unit, uint64 smac, size_t packet_len, std::string* header) {
+  BCM_SDK_TRACE(unit, "smac=", absl::Hex(smac), " packet_len=", packet_len);
+  return bcm_sdk_interface_->GetKnetHeaderForIngressPipelineTx(unit, smac,
+                                                           packet_len, header);
+}
+
+size_t BcmSdkTracer::GetKnetHeaderSizeForRx(int unit) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->GetKnetHeaderSizeForRx(unit);
+}
+
+::util::Status BcmSdkTracer::ParseKnetHeaderForRx(int unit,
+                                                  const std::string& header,
+                                                  int* ingress_logical_port,
+                                                  int* egress_logical_port,
+                                                  int* cos) {
+  BCM_SDK_TRACE(unit, "header_size=", header.size());
+  return bcm_sdk_interface_->ParseKnetHeaderForRx(unit, header,
+                                              ingress_logical_port,
+                                              egress_logical_port, cos);
+}
+
+::util::Status BcmSdkTracer::InitAclHardware(int unit) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->InitAclHardware(unit);
+}
+
+::util::Status BcmSdkTracer::SetAclControl(int unit,
+                                           const AclControl& acl_control) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->SetAclControl(unit, acl_control);
+}
+
+::util::Status BcmSdkTracer::SetAclUdfChunks(int unit, const BcmUdfSet& udfs) {
+  BCM_SDK_TRACE(unit, "udfs=", udfs.ShortDebugString());
+  return bcm_sdk_interface_->SetAclUdfChunks(unit, udfs);
+}
+
+::util::Status BcmSdkTracer::GetAclUdfChunks(int unit, BcmUdfSet* udfs) {
+  BCM_SDK_TRACE(unit, "");
+  return bcm_sdk_interface_->GetAclUdfChunks(unit, udfs);
+}
+
+::util::StatusOr<int> BcmSdkTracer::CreateAclTable(int unit,
+                                                   const BcmAclTable& table) {
+  BCM_SDK_TRACE(unit, "table=", table.ShortDebugString());
+  return bcm_sdk_interface_->CreateAclTable(unit, table);
+}
+
+::util::Status BcmSdkTracer::DestroyAclTable(int unit, int table_id) {
+  BCM_SDK_TRACE(unit, "table_id=", table_id);
+  return bcm_sdk_interface_->DestroyAclTable(unit, table_id);
+}
+
+::util::Status BcmSdkTracer::GetAclTable(int unit, int table_id,
+                                         BcmAclTable* table) {
+  BCM_SDK_TRACE(unit, "table_id=", table_id);
+  return bcm_sdk_interface_->GetAclTable(unit, table_id, table);
+}
+
+::util::StatusOr<int> BcmSdkTracer::InsertAclFlow(int unit,
+                                                  const BcmFlowEntry& flow,
+                                                  bool add_stats,
+                                                  bool color_aware) {
+  BCM_SDK_TRACE(unit, "flow=", flow.ShortDebugString(), " add_stats=",
+                add_stats, " color_aware=", color_aware);
+  return bcm_sdk_interface_->InsertAclFlow(unit, flow, add_stats, color_aware);
+}
+
+::util::Status BcmSdkTracer::ModifyAclFlow(int unit, int flow_id,
+                                           const BcmFlowEntry& flow) {
+  BCM_SDK_TRACE(unit, "flow_id=", flow_id, " flow=", flow.ShortDebugString());
+  return bcm_sdk_interface_->ModifyAclFlow(unit, flow_id, flow);
+}
+
+::util::Status BcmSdkTracer::RemoveAclFlow(int unit, int flow_id) {
+  BCM_SDK_TRACE(unit, "flow_id=", flow_id);
+  return bcm_sdk_interface_->RemoveAclFlow(unit, flow_id);
+}
+
+::util::Status BcmSdkTracer::GetAclFlow(int unit, int flow_id,
+                                        BcmFlowEntry* flow) {
+  BCM_SDK_TRACE(unit, "flow_id=", flow_id);
+  return bcm_sdk_interface_->GetAclFlow(unit, flow_id, flow);
+}
+
+::util::Status BcmSdkTracer::AddAclStats(int unit, int table_id, int flow_id,
+                                         bool color_aware) {
+  BCM_SDK_TRACE(unit, "table_id=", table_id, " flow_id=", flow_id,
+                " color_aware=", color_aware);
+  return bcm_sdk_interface_->AddAclStats(unit, table_id, flow_id, color_aware);
+}
+
+::util::Status BcmSdkTracer::RemoveAclStats(int unit, int flow_id) {
+  BCM_SDK_TRACE(unit, "flow_id=", flow_id);
+  return bcm_sdk_interface_->RemoveAclStats(unit, flow_id);
+}
+
+::util::Status BcmSdkTracer::GetAclStats(int unit, int flow_id,
+                                         BcmAclStats* stats) {
+  BCM_SDK_TRACE(unit, "flow_id=", flow_id);
+  return bcm_sdk_interface_->GetAclStats(unit, flow_id, stats);
+}
+
+::util::Status BcmSdkTracer::GetAndClearAclFlowHits(
+    int unit, int table_id, std::vector<int>* flow_ids) {
+  BCM_SDK_TRACE(unit, "table_id=", table_id);
+  return bcm_sdk_interface_->GetAndClearAclFlowHits(unit, table_id, flow_ids);
+}
+
+::util::Status BcmSdkTracer::SetAclPolicer(int unit, int flow_id,
+                                           const BcmMeterConfig& meter) {
+  BCM_SDK_TRACE(unit, "flow_id=", flow_id, " meter=", meter.ShortDebugString());
+  return bcm_sdk_interface_->SetAclPolicer(unit, flow_id, meter);
+}
+
+::util::Status BcmSdkTracer::GetAclTableFlowIds(int unit, int table_id,
+                                                std::vector<int>* flow_ids) {
+  BCM_SDK_TRACE(unit, "table_id=", table_id);
+  return bcm_sdk_interface_->GetAclTableFlowIds(unit, table_id, flow_ids);
+}
+
+::util::StatusOr<std::string> BcmSdkTracer::MatchAclFlow(
+    int unit, int flow_id, const BcmFlowEntry& flow) {
+  BCM_SDK_TRACE(unit, "flow_id=", flow_id, " flow=", flow.ShortDebugString());
+  return bcm_sdk_interface_->MatchAclFlow(unit, flow_id, flow);
+}
+std::unique_ptr<BcmSdkTracer> BcmSdkTracer::CreateInstance(
+    BcmSdkInterface* bcm_sdk_interface) {
+  return absl::WrapUnique(new BcmSdkTracer(bcm_sdk_interface));
+}
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
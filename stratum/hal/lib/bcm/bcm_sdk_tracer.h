@@ -0,0 +1,244 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_HAL_LIB_BCM_BCM_SDK_TRACER_H_
+#define STRATUM_HAL_LIB_BCM_BCM_SDK_TRACER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/bcm/bcm_sdk_interface.h"
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+// BcmSdkTracer is a decorator around any BcmSdkInterface implementation (the
+// real BcmSdkWrapper, the simulator or a fake) which records every call into
+// the global CallTracer: its name, unit, a summary of its input arguments,
+// start time and duration. Together with the trace context set for each
+// P4Runtime Write, this tells which SDK calls dominate a slow convergence.
+//
+// Recording only happens while CallTracer::Global() is enabled. When it is
+// not, each call costs one extra virtual call and one relaxed atomic load.
+class BcmSdkTracer : public BcmSdkInterface {
+ public:
+  ~BcmSdkTracer() override {}
+
+  // BcmSdkInterface public methods.
+  ::util::Status InitializeSdk(
+      const std::string& config_file_path,
+      const std::string& config_flush_file_path,
+      const std::string& bcm_shell_log_file_path) override;
+  ::util::Status FindUnit(int unit, int pci_bus, int pci_slot,
+                          BcmChip::BcmChipType chip_type) override;
+  ::util::Status InitializeUnit(int unit, bool warm_boot) override;
+  ::util::Status ShutdownUnit(int unit) override;
+  ::util::Status ShutdownAllUnits() override;
+  ::util::Status SetModuleId(int unit, int module) override;
+  ::util::Status InitializePort(int unit, int port) override;
+  ::util::Status SetPortOptions(int unit, int port,
+                                const BcmPortOptions& options) override;
+  ::util::Status GetPortOptions(int unit, int port,
+                                BcmPortOptions* options) override;
+  ::util::Status GetPortCounters(int unit, int port, PortCounters* pc) override;
+  ::util::Status StartDiagShellServer() override;
+  ::util::Status StartLinkscan(int unit) override;
+  ::util::Status StopLinkscan(int unit) override;
+  void OnLinkscanEvent(int unit, int port, PortState linkstatus) override;
+  ::util::StatusOr<int> RegisterLinkscanEventWriter(
+      std::unique_ptr<ChannelWriter<LinkscanEvent>> writer,
+      int priority) override;
+  ::util::Status UnregisterLinkscanEventWriter(int id) override;
+  ::util::StatusOr<BcmPortOptions::LinkscanMode> GetPortLinkscanMode(
+      int unit, int port) override;
+  ::util::Status SetMtu(int unit, int mtu) override;
+  ::util::StatusOr<int> FindOrCreateL3RouterIntf(int unit, uint64 router_mac,
+                                                 int vlan) override;
+  ::util::Status DeleteL3RouterIntf(int unit, int router_intf_id) override;
+  ::util::StatusOr<int> FindOrCreateL3CpuEgressIntf(int unit) override;
+  ::util::StatusOr<int> FindOrCreateL3PortEgressIntf(
+      int unit, stratum::uint64 nexthop_mac, int port, int vlan,
+      int router_intf_id) override;
+  ::util::StatusOr<int> FindOrCreateL3TrunkEgressIntf(
+      int unit, stratum::uint64 nexthop_mac, int trunk, int vlan,
+      int router_intf_id) override;
+  ::util::StatusOr<int> FindOrCreateL3DropIntf(int unit) override;
+  ::util::Status ModifyL3CpuEgressIntf(int unit, int egress_intf_id) override;
+  ::util::Status ModifyL3PortEgressIntf(int unit, int egress_intf_id,
+                                        stratum::uint64 nexthop_mac, int port,
+                                        int vlan, int router_intf_id) override;
+  ::util::Status ModifyL3TrunkEgressIntf(int unit, int egress_intf_id,
+                                         stratum::uint64 nexthop_mac, int trunk,
+                                         int vlan, int router_intf_id) override;
+  ::util::Status ModifyL3DropIntf(int unit, int egress_intf_id) override;
+  ::util::Status DeleteL3EgressIntf(int unit, int egress_intf_id) override;
+  ::util::StatusOr<int> FindRouterIntfFromEgressIntf(
+      int unit, int egress_intf_id) override;
+  ::util::StatusOr<int> FindOrCreateEcmpEgressIntf(
+      int unit, const std::vector<int>& member_ids) override;
+  ::util::Status ModifyEcmpEgressIntf(
+      int unit, int egress_intf_id,
+      const std::vector<int>& member_ids) override;
+  ::util::Status ModifyEcmpEgressIntfs(
+      int unit,
+      const std::vector<std::pair<int, std::vector<int>>>& groups) override;
+  ::util::Status DeleteEcmpEgressIntf(int unit, int egress_intf_id) override;
+  ::util::Status AddL3RouteIpv4(int unit, int vrf, uint32 subnet, uint32 mask,
+                                int class_id, int egress_intf_id,
+                                bool is_intf_multipath) override;
+  ::util::Status AddL3RouteIpv6(int unit, int vrf, const std::string& subnet,
+                                const std::string& mask, int class_id,
+                                int egress_intf_id,
+                                bool is_intf_multipath) override;
+  ::util::Status AddL3HostIpv4(int unit, int vrf, uint32 ipv4, int class_id,
+                               int egress_intf_id) override;
+  ::util::Status AddL3HostIpv6(int unit, int vrf, const std::string& ipv6,
+                               int class_id, int egress_intf_id) override;
+  ::util::Status ModifyL3RouteIpv4(int unit, int vrf, uint32 subnet,
+                                   uint32 mask, int class_id,
+                                   int egress_intf_id,
+                                   bool is_intf_multipath) override;
+  ::util::Status ModifyL3RouteIpv6(int unit, int vrf, const std::string& subnet,
+                                   const std::string& mask, int class_id,
+                                   int egress_intf_id,
+                                   bool is_intf_multipath) override;
+  ::util::Status ModifyL3HostIpv4(int unit, int vrf, uint32 ipv4, int class_id,
+                                  int egress_intf_id) override;
+  ::util::Status ModifyL3HostIpv6(int unit, int vrf, const std::string& ipv6,
+                                  int class_id, int egress_intf_id) override;
+  ::util::Status DeleteL3RouteIpv4(int unit, int vrf, uint32 subnet,
+                                   uint32 mask) override;
+  ::util::Status DeleteL3RouteIpv6(int unit, int vrf, const std::string& subnet,
+                                   const std::string& mask) override;
+  ::util::Status DeleteL3HostIpv4(int unit, int vrf, uint32 ipv4) override;
+  ::util::Status DeleteL3HostIpv6(int unit, int vrf,
+                                  const std::string& ipv6) override;
+  ::util::Status GetAndClearL3HostHits(int unit,
+                                       std::vector<L3HostKey>* hits) override;
+  ::util::StatusOr<int> AddMyStationEntry(int unit, int priority, int vlan,
+                                          int vlan_mask, uint64 dst_mac,
+                                          uint64 dst_mac_mask) override;
+  ::util::Status DeleteMyStationEntry(int unit, int station_id) override;
+  ::util::Status AddL2Entry(int unit, int vlan, uint64 dst_mac,
+                            int logical_port, int trunk_port,
+                            int l2_mcast_group_id, int class_id,
+                            bool copy_to_cpu, bool dst_drop) override;
+  ::util::Status DeleteL2Entry(int unit, int vlan, uint64 dst_mac) override;
+  ::util::Status AddL2MulticastEntry(int unit, int priority, int vlan,
+                                     int vlan_mask, uint64 dst_mac,
+                                     uint64 dst_mac_mask, bool copy_to_cpu,
+                                     bool drop,
+                                     uint8 l2_mcast_group_id) override;
+  ::util::Status DeleteL2MulticastEntry(int unit, int vlan, int vlan_mask,
+                                        uint64 dst_mac,
+                                        uint64 dst_mac_mask) override;
+  ::util::Status InsertPacketReplicationEntry(
+      const BcmPacketReplicationEntry& entry) override;
+  ::util::Status DeletePacketReplicationEntry(
+      const BcmPacketReplicationEntry& entry) override;
+  ::util::Status DeleteL2EntriesByVlan(int unit, int vlan) override;
+  ::util::Status AddVlanIfNotFound(int unit, int vlan) override;
+  ::util::Status DeleteVlanIfFound(int unit, int vlan) override;
+  ::util::Status ConfigureVlanBlock(int unit, int vlan, bool block_broadcast,
+                                    bool block_known_multicast,
+                                    bool block_unknown_multicast,
+                                    bool block_unknown_unicast) override;
+  ::util::Status ConfigureL2Learning(int unit, int vlan,
+                                     bool disable_l2_learning) override;
+  ::util::Status SetL2AgeTimer(int unit, int l2_age_duration_sec) override;
+  ::util::Status ConfigSerdesForPort(
+      int unit, int port, uint64 speed_bps, int serdes_core, int serdes_lane,
+      int serdes_num_lanes, const std::string& intf_type,
+      const SerdesRegisterConfigs& serdes_register_configs,
+      const SerdesAttrConfigs& serdes_attr_configs) override;
+  ::util::Status CreateKnetIntf(int unit, int vlan, std::string* netif_name,
+                                int* netif_id) override;
+  ::util::Status DestroyKnetIntf(int unit, int netif_id) override;
+  ::util::StatusOr<int> CreateKnetFilter(int unit, int netif_id,
+                                         KnetFilterType type) override;
+  ::util::Status DestroyKnetFilter(int unit, int filter_id) override;
+  ::util::Status StartRx(int unit, const RxConfig& rx_config) override;
+  ::util::Status StopRx(int unit) override;
+  ::util::Status SetRateLimit(
+      int unit, const RateLimitConfig& rate_limit_config) override;
+  ::util::Status GetKnetHeaderForDirectTx(int unit, int port, int cos,
+                                          uint64 smac, size_t packet_len,
+                                          std::string* header) override;
+  ::util::Status GetKnetHeaderForIngressPipelineTx(
+      int unit, uint64 smac, size_t packet_len, std::string* header) override;
+  size_t GetKnetHeaderSizeForRx(int unit) override;
+  ::util::Status ParseKnetHeaderForRx(int unit, const std::string& header,
+                                      int* ingress_logical_port,
+                                      int* egress_logical_port,
+                                      int* cos) override;
+  ::util::Status InitAclHardware(int unit) override;
+  ::util::Status SetAclControl(int unit,
+                               const AclControl& acl_control) override;
+  ::util::Status SetAclUdfChunks(int unit, const BcmUdfSet& udfs) override;
+  ::util::Status GetAclUdfChunks(int unit, BcmUdfSet* udfs) override;
+  ::util::StatusOr<int> CreateAclTable(int unit,
+                                       const BcmAclTable& table) override;
+  ::util::Status DestroyAclTable(int unit, int table_id) override;
+  ::util::Status GetAclTable(int unit, int table_id,
+                             BcmAclTable* table) override;
+  ::util::StatusOr<int> InsertAclFlow(int unit, const BcmFlowEntry& flow,
+                                      bool add_stats,
+                                      bool color_aware) override;
+  ::util::Status ModifyAclFlow(int unit, int flow_id,
+                               const BcmFlowEntry& flow) override;
+  ::util::Status RemoveAclFlow(int unit, int flow_id) override;
+  ::util::Status GetAclFlow(int unit, int flow_id, BcmFlowEntry* flow) override;
+  ::util::Status AddAclStats(int unit, int table_id, int flow_id,
+                             bool color_aware) override;
+  ::util::Status RemoveAclStats(int unit, int flow_id) override;
+  ::util::Status GetAclStats(int unit, int flow_id,
+                             BcmAclStats* stats) override;
+  ::util::Status GetAndClearAclFlowHits(int unit, int table_id,
+                                        std::vector<int>* flow_ids) override;
+  ::util::Status SetAclPolicer(int unit, int flow_id,
+                               const BcmMeterConfig& meter) override;
+  ::util::Status GetAclTableFlowIds(int unit, int table_id,
+                                    std::vector<int>* flow_ids) override;
+  ::util::StatusOr<std::string> MatchAclFlow(int unit, int flow_id,
+                                             const BcmFlowEntry& flow) override;
+
+  // Factory function for creating the instance of the class. The calls are
+  // only recorded while the global CallTracer is enabled.
+  static std::unique_ptr<BcmSdkTracer> CreateInstance(
+      BcmSdkInterface* bcm_sdk_interface);
+
+  // BcmSdkTracer is neither copyable nor movable.
+  BcmSdkTracer(const BcmSdkTracer&) = delete;
+  BcmSdkTracer& operator=(const BcmSdkTracer&) = delete;
+
+ private:
+  // Private constructor. Use CreateInstance() to create an instance.
+  explicit BcmSdkTracer(BcmSdkInterface* bcm_sdk_interface);
+
+  // The traced implementation. Not owned by this class.
+  BcmSdkInterface* bcm_sdk_interface_;
+};
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_BCM_BCM_SDK_TRACER_H_
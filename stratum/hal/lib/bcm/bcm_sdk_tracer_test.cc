@@ -0,0 +1,93 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/bcm/bcm_sdk_tracer.h"
+
+#include <vector>
+
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/hal/lib/bcm/bcm_sdk_mock.h"
+#include "stratum/lib/call_tracer.h"
+#include "stratum/lib/test_utils/matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+
+using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::Return;
+
+namespace stratum {
+namespace hal {
+namespace bcm {
+
+class BcmSdkTracerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    bcm_sdk_mock_ = absl::make_unique<BcmSdkMock>();
+    CallTracer::Global()->Clear();
+    bcm_sdk_tracer_ = BcmSdkTracer::CreateInstance(bcm_sdk_mock_.get());
+    CallTracer::Global()->Enable(true);
+  }
+
+  void TearDown() override {
+    CallTracer::Global()->Enable(false);
+    CallTracer::Global()->Clear();
+  }
+
+  std::unique_ptr<BcmSdkMock> bcm_sdk_mock_;
+  std::unique_ptr<BcmSdkTracer> bcm_sdk_tracer_;
+};
+
+TEST_F(BcmSdkTracerTest, CallsAreForwardedAndRecorded) {
+  EXPECT_CALL(*bcm_sdk_mock_, AddL3RouteIpv4(1, 10, 0x0a000000, 0xff000000, 0,
+                                             100002, false))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*bcm_sdk_mock_, FindOrCreateEcmpEgressIntf(1, _))
+      .WillOnce(Return(200100));
+
+  uint64 context_id = 0;
+  {
+    ScopedTraceContext trace_context;
+    context_id = trace_context.context_id();
+    EXPECT_OK(bcm_sdk_tracer_->AddL3RouteIpv4(1, 10, 0x0a000000, 0xff000000, 0,
+                                              100002, false));
+  }
+  ASSERT_OK_AND_ASSIGN(int ecmp_id, bcm_sdk_tracer_->FindOrCreateEcmpEgressIntf(
+                                        1, {100002, 100003}));
+  EXPECT_EQ(200100, ecmp_id);
+
+  std::vector<TraceEvent> events = CallTracer::Global()->GetEvents();
+  ASSERT_EQ(2U, events.size());
+  EXPECT_STREQ("bcm_sdk", events[0].category);
+  EXPECT_STREQ("AddL3RouteIpv4", events[0].name);
+  EXPECT_EQ(1, events[0].unit);
+  EXPECT_EQ(context_id, events[0].context_id);
+  EXPECT_THAT(events[0].args, HasSubstr("vrf=10 subnet=167772160"));
+  EXPECT_STREQ("FindOrCreateEcmpEgressIntf", events[1].name);
+  EXPECT_EQ(0U, events[1].context_id);
+  EXPECT_EQ("member_ids=100002,100003", events[1].args);
+}
+
+TEST_F(BcmSdkTracerTest, NothingRecordedWhenTracingDisabled) {
+  CallTracer::Global()->Enable(false);
+  EXPECT_CALL(*bcm_sdk_mock_, DeleteL3RouteIpv4(0, 10, 0x0a000000, 0xff000000))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_OK(bcm_sdk_tracer_->DeleteL3RouteIpv4(0, 10, 0x0a000000, 0xff000000));
+  EXPECT_TRUE(CallTracer::Global()->GetEvents().empty());
+}
+
+}  // namespace bcm
+}  // namespace hal
+}  // namespace stratum
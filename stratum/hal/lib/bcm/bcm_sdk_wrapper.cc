@@ -54,6 +54,7 @@
 #include "stratum/hal/lib/common/constants.h"
 #include "stratum/lib/constants.h"
 #include "stratum/lib/macros.h"
+#include "stratum/lib/metrics.h"
 #include "stratum/lib/utils.h"
 // #include "util/endian/endian.h"
 
@@ -720,6 +721,21 @@ int bcmlt_custom_entry_commit(bcmlt_entry_handle_t entry_hdl,
   return entry_info.status;
 }
 
+int bcmlt_custom_transaction_commit(bcmlt_transaction_hdl_t trans_hdl,
+                                    bcmlt_priority_level_t prio) {
+  int rv;
+  bcmlt_transaction_info_t trans_info;
+  rv = bcmlt_transaction_commit(trans_hdl, prio);
+  if (rv != SHR_E_NONE) {
+    return rv;
+  }
+  rv = bcmlt_transaction_info_get(trans_hdl, &trans_info);
+  if (rv != SHR_E_NONE) {
+    return rv;
+  }
+  return trans_info.status;
+}
+
 ::util::Status GetTableLimits(int unit, const char* table, int* min, int* max) {
   uint64_t table_max;
   uint64_t table_min;
@@ -2060,6 +2076,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 ::util::StatusOr<int> BcmSdkWrapper::FindOrCreateL3RouterIntf(int unit,
                                                               uint64 router_mac,
                                                               int vlan) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/find_or_create_l3_router_intf");
   bcmlt_entry_handle_t entry_hdl;
   bcmlt_entry_info_t entry_info;
   uint64_t max;
@@ -2152,6 +2169,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 }
 
 ::util::Status BcmSdkWrapper::DeleteL3RouterIntf(int unit, int router_intf_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/delete_l3_router_intf");
   // Check if the unit is valid
   RETURN_IF_BCM_ERROR(CheckIfUnitExists(unit));
   auto unit_to_l3_intf = gtl::FindOrNull(l3_interface_ids_, unit);
@@ -2209,6 +2227,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 
 ::util::StatusOr<int> BcmSdkWrapper::FindOrCreateL3PortEgressIntf(
     int unit, uint64 nexthop_mac, int port, int vlan, int router_intf_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/find_or_create_l3_port_egress_intf");
   bcmlt_entry_handle_t entry_hdl;
   int egress_intf_id = 0;
   bool found;
@@ -2279,6 +2298,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 
 ::util::StatusOr<int> BcmSdkWrapper::FindOrCreateL3TrunkEgressIntf(
     int unit, uint64 nexthop_mac, int trunk, int vlan, int router_intf_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/find_or_create_l3_trunk_egress_intf");
   bcmlt_entry_handle_t entry_hdl;
   int egress_intf_id = 0;
   bool found;
@@ -2450,6 +2470,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
                                                      uint64 nexthop_mac,
                                                      int port, int vlan,
                                                      int router_intf_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/modify_l3_port_egress_intf");
   bcmlt_entry_handle_t entry_hdl;
   InUseMap::iterator it;
   bool found;
@@ -2526,6 +2547,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
                                                       uint64 nexthop_mac,
                                                       int trunk, int vlan,
                                                       int router_intf_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/modify_l3_trunk_egress_intf");
   bcmlt_entry_handle_t entry_hdl;
   InUseMap::iterator it;
   bool found;
@@ -2678,6 +2700,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 }
 
 ::util::Status BcmSdkWrapper::DeleteL3EgressIntf(int unit, int egress_intf_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/delete_l3_egress_intf");
   bcmlt_entry_handle_t entry_hdl;
   InUseMap::iterator it;
   // Check if the unit is valid
@@ -2765,6 +2788,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 
 ::util::StatusOr<int> BcmSdkWrapper::FindOrCreateEcmpEgressIntf(
     int unit, const std::vector<int>& member_ids) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/find_or_create_ecmp_egress_intf");
   bcmlt_entry_handle_t entry_hdl;
   int ecmp_intf_id = 0;
 
@@ -2806,6 +2830,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 
 ::util::Status BcmSdkWrapper::ModifyEcmpEgressIntf(
     int unit, int egress_intf_id, const std::vector<int>& member_ids) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/modify_ecmp_egress_intf");
   bcmlt_entry_handle_t entry_hdl;
   InUseMap::iterator it;
   // Check if the unit is valid
@@ -2854,8 +2879,74 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
   return ::util::OkStatus();
 }
 
+::util::Status BcmSdkWrapper::ModifyEcmpEgressIntfs(
+    int unit, const std::vector<std::pair<int, std::vector<int>>>& groups) {
+  // Check if the unit is valid
+  RETURN_IF_BCM_ERROR(CheckIfUnitExists(unit));
+  if (groups.empty()) return ::util::OkStatus();
+
+  InUseMap* ecmp_intfs = gtl::FindOrNull(l3_ecmp_egress_interface_ids_, unit);
+  CHECK_RETURN_IF_FALSE(ecmp_intfs != nullptr)
+      << "Unit " << unit
+      << " not initialized yet. Call InitializeUnit first.";
+  // Validate all the groups first, so nothing is committed if one is invalid.
+  for (const auto& group : groups) {
+    auto it = ecmp_intfs->find(group.first);
+    if (it == ecmp_intfs->end()) {
+      return MAKE_ERROR(ERR_INTERNAL)
+             << "Invalid ECMP egress interface " << group.first << ".";
+    }
+    if (!it->second) {
+      return MAKE_ERROR(ERR_INTERNAL)
+             << "ECMP egress interface " << group.first << " is not created.";
+    }
+    CHECK_RETURN_IF_FALSE(static_cast<int>(group.second.size()) <=
+                          kMaxEcmpGroupSize)
+        << "ECMP egress interface " << group.first << " cannot have "
+        << group.second.size() << " members.";
+  }
+
+  // All the updates are handed to the SDK as one batch transaction with high
+  // priority, instead of one blocking commit per group. The transaction owns
+  // the entries added to it and frees them together with itself.
+  bcmlt_transaction_hdl_t trans_hdl;
+  RETURN_IF_BCM_ERROR(
+      bcmlt_transaction_allocate(BCMLT_TRANS_TYPE_BATCH, &trans_hdl));
+  auto _ = gtl::MakeCleanup(
+      [trans_hdl]() { bcmlt_transaction_free(trans_hdl); });
+  uint64 members_array[kMaxEcmpGroupSize] = {};
+  for (const auto& group : groups) {
+    const std::vector<int>& member_ids = group.second;
+    for (size_t i = 0; i < member_ids.size(); ++i) {
+      members_array[i] = static_cast<uint64>(member_ids[i]);
+    }
+    int members_count = static_cast<int>(member_ids.size());
+    bcmlt_entry_handle_t entry_hdl;
+    RETURN_IF_BCM_ERROR(bcmlt_entry_allocate(unit, ECMPs, &entry_hdl));
+    // The entry is ours to free until the transaction has taken it.
+    auto entry_cleanup =
+        gtl::MakeCleanup([entry_hdl]() { bcmlt_entry_free(entry_hdl); });
+    RETURN_IF_BCM_ERROR(
+        bcmlt_entry_field_add(entry_hdl, ECMP_IDs, group.first));
+    RETURN_IF_BCM_ERROR(
+        bcmlt_entry_field_add(entry_hdl, NUM_PATHSs, members_count));
+    RETURN_IF_BCM_ERROR(bcmlt_entry_field_array_add(
+        entry_hdl, NHOP_IDs, 0, members_array, members_count));
+    RETURN_IF_BCM_ERROR(bcmlt_transaction_entry_add(
+        trans_hdl, BCMLT_OPCODE_UPDATE, entry_hdl));
+    entry_cleanup.release();
+  }
+  RETURN_IF_BCM_ERROR(
+      bcmlt_custom_transaction_commit(trans_hdl, BCMLT_PRIORITY_HIGH));
+
+  VLOG(1) << "Modified " << groups.size()
+          << " ECMP groups in one batch on unit " << unit << ".";
+  return ::util::OkStatus();
+}
+
 ::util::Status BcmSdkWrapper::DeleteEcmpEgressIntf(int unit,
                                                    int egress_intf_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/delete_ecmp_egress_intf");
   bcmlt_entry_handle_t entry_hdl;
   InUseMap::iterator it;
   // Check if the unit is valid
@@ -2894,6 +2985,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
                                              uint32 mask, int class_id,
                                              int egress_intf_id,
                                              bool is_intf_multipath) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/add_l3_route_ipv4");
   bcmlt_entry_handle_t entry_hdl;
   uint64_t max;
   uint64_t min;
@@ -2978,6 +3070,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
                                              const std::string& mask,
                                              int class_id, int egress_intf_id,
                                              bool is_intf_multipath) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/add_l3_route_ipv6");
   bcmlt_entry_handle_t entry_hdl;
   uint64_t max;
   uint64_t min;
@@ -3066,6 +3159,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 
 ::util::Status BcmSdkWrapper::AddL3HostIpv4(int unit, int vrf, uint32 ipv4,
                                             int class_id, int egress_intf_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/add_l3_host_ipv4");
   bcmlt_entry_handle_t entry_hdl;
   uint64_t max;
   uint64_t min;
@@ -3117,6 +3211,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 ::util::Status BcmSdkWrapper::AddL3HostIpv6(int unit, int vrf,
                                             const std::string& ipv6,
                                             int class_id, int egress_intf_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/add_l3_host_ipv6");
   bcmlt_entry_handle_t entry_hdl;
   uint64_t max;
   uint64_t min;
@@ -3176,6 +3271,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
                                                 int class_id,
                                                 int egress_intf_id,
                                                 bool is_intf_multipath) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/modify_l3_route_ipv4");
   bcmlt_entry_handle_t entry_hdl;
   bcmlt_entry_info_t entry_info;
   uint64_t max;
@@ -3273,6 +3369,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 ::util::Status BcmSdkWrapper::ModifyL3RouteIpv6(
     int unit, int vrf, const std::string& subnet, const std::string& mask,
     int class_id, int egress_intf_id, bool is_intf_multipath) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/modify_l3_route_ipv6");
   bcmlt_entry_handle_t entry_hdl;
   bcmlt_entry_info_t entry_info;
   uint64_t max;
@@ -3375,6 +3472,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 ::util::Status BcmSdkWrapper::ModifyL3HostIpv4(int unit, int vrf, uint32 ipv4,
                                                int class_id,
                                                int egress_intf_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/modify_l3_host_ipv4");
   uint64_t max;
   uint64_t min;
   bool entry_updated = false;
@@ -3439,6 +3537,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
                                                const std::string& ipv6,
                                                int class_id,
                                                int egress_intf_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/modify_l3_host_ipv6");
 
   uint64_t max;
   uint64_t min;
@@ -3510,6 +3609,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 
 ::util::Status BcmSdkWrapper::DeleteL3RouteIpv4(int unit, int vrf,
                                                 uint32 subnet, uint32 mask) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/delete_l3_route_ipv4");
   bcmlt_entry_handle_t entry_hdl;
   bcmlt_entry_info_t entry_info;
   uint64_t max;
@@ -3568,6 +3668,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 ::util::Status BcmSdkWrapper::DeleteL3RouteIpv6(int unit, int vrf,
                                                 const std::string& subnet,
                                                 const std::string& mask) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/delete_l3_route_ipv6");
   bcmlt_entry_handle_t entry_hdl;
   bcmlt_entry_info_t entry_info;
   uint64_t max;
@@ -3637,6 +3738,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 }
 
 ::util::Status BcmSdkWrapper::DeleteL3HostIpv4(int unit, int vrf, uint32 ipv4) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/delete_l3_host_ipv4");
   uint64_t max;
   uint64_t min;
   uint64_t data;
@@ -3693,6 +3795,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 
 ::util::Status BcmSdkWrapper::DeleteL3HostIpv6(int unit, int vrf,
                                                const std::string& ipv6) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/delete_l3_host_ipv6");
   uint64_t max;
   uint64_t min;
   uint64_t data;
@@ -3755,10 +3858,18 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
   return ::util::OkStatus();
 }
 
+::util::Status BcmSdkWrapper::GetAndClearL3HostHits(
+    int unit, std::vector<L3HostKey>* hits) {
+  // TODO(unknown): Implement once the hit bits of the L3_IPV4_UC_HOST and
+  // L3_IPV6_UC_HOST logical tables are exposed by SDKLT.
+  return MAKE_ERROR(ERR_FEATURE_UNAVAILABLE) << "Not supported.";
+}
+
 ::util::StatusOr<int> BcmSdkWrapper::AddMyStationEntry(int unit, int priority,
                                                        int vlan, int vlan_mask,
                                                        uint64 dst_mac,
                                                        uint64 dst_mac_mask) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/add_my_station_entry");
   bcmlt_entry_handle_t entry_hdl;
   uint64_t max;
   uint64_t min;
@@ -3844,6 +3955,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 }
 
 ::util::Status BcmSdkWrapper::DeleteMyStationEntry(int unit, int station_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/delete_my_station_entry");
   bcmlt_entry_handle_t entry_hdl;
   // Check if the unit is valid
   RETURN_IF_BCM_ERROR(CheckIfUnitExists(unit));
@@ -3877,6 +3989,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
                             int logical_port, int trunk_port,
                             int l2_mcast_group_id, int class_id,
                             bool copy_to_cpu, bool dst_drop) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/add_l2_entry");
   RETURN_IF_BCM_ERROR(CheckIfUnitExists(unit));
   bcmlt_entry_handle_t entry_hdl;
   RETURN_IF_BCM_ERROR(bcmlt_entry_allocate(unit, L2_FDB_VLANs, &entry_hdl));
@@ -3899,6 +4012,7 @@ BcmSdkWrapper::GetPortLinkscanMode(int unit, int port) {
 }
 
 ::util::Status BcmSdkWrapper::DeleteL2Entry(int unit, int vlan, uint64 dst_mac) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/delete_l2_entry");
   RETURN_IF_BCM_ERROR(CheckIfUnitExists(unit));
   bcmlt_entry_handle_t entry_hdl;
   RETURN_IF_BCM_ERROR(bcmlt_entry_allocate(unit, L2_FDB_VLANs, &entry_hdl));
@@ -6510,6 +6624,7 @@ namespace {
                                                    const BcmFlowEntry& flow,
                                                    bool add_stats,
                                                    bool color_aware) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/insert_acl_flow");
   int rule_id = 0;
   int policy_id = 0;
   int meter_id = 0;
@@ -6861,6 +6976,7 @@ namespace {
 
 ::util::Status BcmSdkWrapper::ModifyAclFlow(int unit, int flow_id,
                                             const BcmFlowEntry& flow) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/modify_acl_flow");
   bool found;
   std::pair<BcmAclStage, int> entry;
   RETURN_IF_BCM_ERROR(CheckIfUnitExists(unit));
@@ -6997,6 +7113,7 @@ namespace {
 }
 
 ::util::Status BcmSdkWrapper::RemoveAclFlow(int unit, int flow_id) {
+  METRICS_LATENCY_SCOPE("bcm_sdk/remove_acl_flow");
   // check if unit is valid
   bool found;
   std::pair<BcmAclStage, int> entry;
@@ -7468,6 +7585,13 @@ inline int bcm_get_field_u32(F func, int unit, int flow_id, uint32* value,
   return ::util::OkStatus();
 }
 
+::util::Status BcmSdkWrapper::GetAndClearAclFlowHits(
+    int unit, int table_id, std::vector<int>* flow_ids) {
+  // TODO(unknown): Implement once the hit bits of the FP entries are exposed
+  // by SDKLT.
+  return MAKE_ERROR(ERR_FEATURE_UNAVAILABLE) << "Not supported.";
+}
+
 BcmSdkWrapper* BcmSdkWrapper::CreateSingleton(BcmDiagShell* bcm_diag_shell) {
   absl::WriterMutexLock l(&init_lock_);
   if (!singleton_) {
@@ -152,6 +152,9 @@ class BcmSdkWrapper : public BcmSdkInterface {
   ::util::Status ModifyEcmpEgressIntf(
       int unit, int egress_intf_id,
       const std::vector<int>& member_ids) override;
+  ::util::Status ModifyEcmpEgressIntfs(
+      int unit,
+      const std::vector<std::pair<int, std::vector<int>>>& groups) override;
   ::util::Status DeleteEcmpEgressIntf(int unit, int egress_intf_id) override;
   ::util::Status AddL3RouteIpv4(int unit, int vrf, uint32 subnet, uint32 mask,
                                 int class_id, int egress_intf_id,
@@ -183,6 +186,8 @@ class BcmSdkWrapper : public BcmSdkInterface {
   ::util::Status DeleteL3HostIpv4(int unit, int vrf, uint32 ipv4) override;
   ::util::Status DeleteL3HostIpv6(int unit, int vrf,
                                   const std::string& ipv6) override;
+  ::util::Status GetAndClearL3HostHits(int unit,
+                                       std::vector<L3HostKey>* hits) override;
   ::util::StatusOr<int> AddMyStationEntry(int unit, int priority, int vlan,
                                           int vlan_mask, uint64 dst_mac,
                                           uint64 dst_mac_mask) override;
@@ -262,6 +267,8 @@ class BcmSdkWrapper : public BcmSdkInterface {
   ::util::Status RemoveAclStats(int unit, int flow_id) override;
   ::util::Status GetAclStats(int unit, int flow_id,
                              BcmAclStats* stats) override;
+  ::util::Status GetAndClearAclFlowHits(int unit, int table_id,
+                                        std::vector<int>* flow_ids) override;
   ::util::Status SetAclPolicer(int unit, int flow_id,
                                const BcmMeterConfig& meter) override;
   ::util::Status InsertPacketReplicationEntry(
@@ -222,6 +222,42 @@ BcmSwitch::~BcmSwitch() {}
   return bcm_node->UnregisterPacketReceiveWriter();
 }
 
+::util::Status BcmSwitch::RegisterDigestReceiveWriter(
+    uint64 node_id,
+    std::shared_ptr<WriterInterface<::p4::v1::DigestList>> writer) {
+  return MAKE_ERROR(ERR_UNIMPLEMENTED)
+         << "Digests are not supported on BCM-based switches.";
+}
+
+::util::Status BcmSwitch::UnregisterDigestReceiveWriter(uint64 node_id) {
+  return MAKE_ERROR(ERR_UNIMPLEMENTED)
+         << "Digests are not supported on BCM-based switches.";
+}
+
+::util::Status BcmSwitch::RegisterIdleTimeoutNotificationWriter(
+    uint64 node_id,
+    std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>
+        writer) {
+  absl::ReaderMutexLock l(&chassis_lock);
+  if (shutdown) {
+    return MAKE_ERROR(ERR_CANCELLED) << "Switch is shutdown.";
+  }
+  // Get BcmNode which the node_id is associated with.
+  ASSIGN_OR_RETURN(auto* bcm_node, GetBcmNodeFromNodeId(node_id));
+  return bcm_node->RegisterIdleTimeoutNotificationWriter(writer);
+}
+
+::util::Status BcmSwitch::UnregisterIdleTimeoutNotificationWriter(
+    uint64 node_id) {
+  absl::ReaderMutexLock l(&chassis_lock);
+  if (shutdown) {
+    return MAKE_ERROR(ERR_CANCELLED) << "Switch is shutdown.";
+  }
+  // Get BcmNode which the node_id is associated with.
+  ASSIGN_OR_RETURN(auto* bcm_node, GetBcmNodeFromNodeId(node_id));
+  return bcm_node->UnregisterIdleTimeoutNotificationWriter();
+}
+
 ::util::Status BcmSwitch::TransmitPacket(uint64 node_id,
                                          const ::p4::v1::PacketOut& packet) {
   absl::ReaderMutexLock l(&chassis_lock);
@@ -401,6 +437,25 @@ BcmSwitch::~BcmSwitch() {}
         resp.mutable_node_packetio_debug_info()->set_debug_string(
             "A (sample) node debug string.");
         break;
+      case DataRequest::Request::kNodeL3RouteDebugInfo: {
+        // Dump the L3 routes programmed on the node located at:
+        // - node_id: req.node_l3_route_debug_info().node_id()
+        // and then write it into the response.
+        auto bcm_node =
+            GetBcmNodeFromNodeId(req.node_l3_route_debug_info().node_id());
+        if (!bcm_node.ok()) {
+          status.Update(bcm_node.status());
+          break;
+        }
+        auto debug_string = bcm_node.ValueOrDie()->GetL3RouteDebugString();
+        if (!debug_string.ok()) {
+          status.Update(debug_string.status());
+          break;
+        }
+        resp.mutable_node_l3_route_debug_info()->set_debug_string(
+            debug_string.ValueOrDie());
+        break;
+      }
       default:
         status = MAKE_ERROR(ERR_INTERNAL) << "Not supported yet!";
     }
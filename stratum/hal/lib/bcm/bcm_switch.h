@@ -75,6 +75,16 @@ class BcmSwitch : public SwitchInterface {
       LOCKS_EXCLUDED(chassis_lock);
   ::util::Status UnregisterPacketReceiveWriter(uint64 node_id) override
       LOCKS_EXCLUDED(chassis_lock);
+  ::util::Status RegisterDigestReceiveWriter(
+      uint64 node_id,
+      std::shared_ptr<WriterInterface<::p4::v1::DigestList>> writer) override;
+  ::util::Status UnregisterDigestReceiveWriter(uint64 node_id) override;
+  ::util::Status RegisterIdleTimeoutNotificationWriter(
+      uint64 node_id,
+      std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>
+          writer) override LOCKS_EXCLUDED(chassis_lock);
+  ::util::Status UnregisterIdleTimeoutNotificationWriter(uint64 node_id)
+      override LOCKS_EXCLUDED(chassis_lock);
   ::util::Status TransmitPacket(uint64 node_id,
                                 const ::p4::v1::PacketOut& packet) override
       LOCKS_EXCLUDED(chassis_lock);
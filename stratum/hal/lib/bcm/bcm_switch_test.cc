@@ -646,6 +646,27 @@ TEST_F(BcmSwitchTest, GetNodePacketIoDebugInfoPass) {
   EXPECT_THAT(details.at(0), ::util::OkStatus());
 }
 
+TEST_F(BcmSwitchTest, GetNodeL3RouteDebugInfoPass) {
+  PushChassisConfigSuccess();
+
+  WriterMock<DataResponse> writer;
+  DataResponse resp;
+  // Expect Write() call and store data in resp.
+  ExpectMockWriteDataResponse(&writer, &resp);
+  EXPECT_CALL(*bcm_node_mock_, GetL3RouteDebugString())
+      .WillOnce(Return(std::string("VRF 80:\n")));
+
+  DataRequest req;
+  auto* request = req.add_requests()->mutable_node_l3_route_debug_info();
+  request->set_node_id(kNodeId);
+
+  std::vector<::util::Status> details;
+  EXPECT_OK(bcm_switch_->RetrieveValue(kNodeId, req, &writer, &details));
+  EXPECT_EQ("VRF 80:\n", resp.node_l3_route_debug_info().debug_string());
+  ASSERT_EQ(details.size(), 1);
+  EXPECT_THAT(details.at(0), ::util::OkStatus());
+}
+
 TEST_F(BcmSwitchTest, SetPortAdminStatusPass) {
   SetRequest req;
   auto* request = req.add_requests()->mutable_port();
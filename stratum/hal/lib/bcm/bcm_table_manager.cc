@@ -25,6 +25,7 @@
 #include "stratum/hal/lib/bcm/utils.h"
 #include "stratum/hal/lib/common/constants.h"
 #include "stratum/lib/macros.h"
+#include "stratum/lib/metrics.h"
 #include "stratum/lib/utils.h"
 #include "stratum/glue/integral_types.h"
 #include "absl/container/flat_hash_map.h"
@@ -374,6 +375,9 @@ BcmTableManager::~BcmTableManager() {}
   trunk_id_to_trunk_port_.clear();
   members_.clear();
   groups_.clear();
+  egress_intf_id_to_group_ids_.clear();
+  reduced_members_to_egress_intf_id_.clear();
+  group_id_to_flows_.clear();
   gtl::STLDeleteValues(&member_id_to_nexthop_info_);
   gtl::STLDeleteValues(&group_id_to_nexthop_info_);
 
@@ -641,25 +645,36 @@ BcmTableManager::ConstConditionsToBcmFields(const AclTable& table) {
 ::util::Status BcmTableManager::FillBcmFlowEntry(
     const ::p4::v1::TableEntry& table_entry, ::p4::v1::Update::Type type,
     BcmFlowEntry* bcm_flow_entry) const {
-  std::string error_message =
-      " TableEntry is " + table_entry.ShortDebugString() + ".";
+  METRICS_LATENCY_SCOPE("bcm_table_manager/fill_bcm_flow_entry");
+  // Only evaluated on errors, to not print every TableEntry on the fast path.
+  const auto error_message = [&table_entry]() {
+    return absl::StrCat(" TableEntry is ", table_entry.ShortDebugString(), ".");
+  };
 
   CHECK_RETURN_IF_FALSE(table_entry.table_id())
-      << "Must specify table_id for each TableEntry." << error_message;
+      << "Must specify table_id for each TableEntry." << error_message();
   // Fill the CommonFlowEntry by calling P4TableMapper::MapFlowEntry(). This
-  // will include all the mappings that are common to all the platforms.
-  CommonFlowEntry common_flow_entry;
+  // will include all the mappings that are common to all the platforms. The
+  // CommonFlowEntry is an intermediate result only, so it is allocated on the
+  // same arena as the given BcmFlowEntry if there is one (e.g. a RequestArena
+  // used by the caller) and freed together with it.
+  CommonFlowEntry local_common_flow_entry;
+  CommonFlowEntry* common_flow_entry = &local_common_flow_entry;
+  if (bcm_flow_entry->GetArena() != nullptr) {
+    common_flow_entry = ::google::protobuf::Arena::CreateMessage<
+        CommonFlowEntry>(bcm_flow_entry->GetArena());
+  }
   RETURN_IF_ERROR_WITH_APPEND(
-      p4_table_mapper_->MapFlowEntry(table_entry, type, &common_flow_entry))
-      << error_message;
+      p4_table_mapper_->MapFlowEntry(table_entry, type, common_flow_entry))
+      << error_message();
   RETURN_IF_ERROR_WITH_APPEND(
-      CommonFlowEntryToBcmFlowEntry(common_flow_entry, type, bcm_flow_entry))
-      << error_message;
+      CommonFlowEntryToBcmFlowEntry(*common_flow_entry, type, bcm_flow_entry))
+      << error_message();
 
   // We do not support initializing flow packet counter values.
   CHECK_RETURN_IF_FALSE(!table_entry.has_counter_data())
       << "Unsupported counter initialization given in TableEntry."
-      << error_message;
+      << error_message();
 
   // Transfer meter configuration. For DELETE, this is redundant data and is
   // not used.
@@ -667,11 +682,11 @@ BcmTableManager::ConstConditionsToBcmFields(const AclTable& table) {
     // Meters are only available for ACL flows.
     if (bcm_flow_entry->bcm_table_type() != BcmFlowEntry::BCM_TABLE_ACL) {
       return MAKE_ERROR(ERR_INVALID_PARAM)
-             << "Metering is only supported for ACL flows." << error_message;
+             << "Metering is only supported for ACL flows." << error_message();
     }
     RETURN_IF_ERROR_WITH_APPEND(FillBcmMeterConfig(table_entry.meter_config(),
                                        bcm_flow_entry->mutable_meter()))
-        << error_message;
+        << error_message();
   }
 
   return ::util::OkStatus();
@@ -977,7 +992,7 @@ namespace {
   if (member_id > 0) {
     RETURN_IF_ERROR(UpdateFlowRefCountForMember(member_id, 1));
   } else if (group_id > 0) {
-    RETURN_IF_ERROR(UpdateFlowRefCountForGroup(group_id, 1));
+    RETURN_IF_ERROR(UpdateFlowRefCountForGroup(group_id, table_entry, 1));
   }
 
   return ::util::OkStatus();
@@ -1006,12 +1021,12 @@ namespace {
   if (old_member_id > 0) {
     RETURN_IF_ERROR(UpdateFlowRefCountForMember(old_member_id, -1));
   } else if (old_group_id > 0) {
-    RETURN_IF_ERROR(UpdateFlowRefCountForGroup(old_group_id, -1));
+    RETURN_IF_ERROR(UpdateFlowRefCountForGroup(old_group_id, old_entry, -1));
   }
   if (new_member_id > 0) {
     RETURN_IF_ERROR(UpdateFlowRefCountForMember(new_member_id, 1));
   } else if (new_group_id > 0) {
-    RETURN_IF_ERROR(UpdateFlowRefCountForGroup(new_group_id, 1));
+    RETURN_IF_ERROR(UpdateFlowRefCountForGroup(new_group_id, table_entry, 1));
   }
 
   return ::util::OkStatus();
@@ -1030,7 +1045,7 @@ namespace {
   if (member_id > 0) {
     RETURN_IF_ERROR(UpdateFlowRefCountForMember(member_id, -1));
   } else if (group_id > 0) {
-    RETURN_IF_ERROR(UpdateFlowRefCountForGroup(group_id, -1));
+    RETURN_IF_ERROR(UpdateFlowRefCountForGroup(group_id, old_entry, -1));
   }
 
   // If this is the last entry in a generic table, remove the generic table.
@@ -1105,7 +1120,7 @@ namespace {
   }
 
   // Save a copy of P4 ActionProfileMember.
-  if (!gtl::InsertIfNotPresent(&members_, {member_id, action_profile_member})) {
+  if (!members_.Insert(member_id, action_profile_member)) {
     return MAKE_ERROR(ERR_INVALID_PARAM)
            << "Inconsistent state. Member with ID " << member_id << " already "
            << "exists in members_.";
@@ -1132,27 +1147,32 @@ namespace {
       << "Cannot add already existing group_id: " << group_id << ".";
 
   // The egress intf ID for this group must not be assigned to an existing
-  // group.
-  using Entry = std::pair<uint32, BcmMultipathNexthopInfo*>;
-  auto it = std::find_if(group_id_to_nexthop_info_.begin(),
-                         group_id_to_nexthop_info_.end(),
-                         [egress_intf_id](const Entry& e) {
-                           return e.second->egress_intf_id == egress_intf_id;
-                         });
-  CHECK_RETURN_IF_FALSE(it == group_id_to_nexthop_info_.end())
+  // group, unless that group has the same members and can share it.
+  auto* sharing_group_ids =
+      gtl::FindOrNull(egress_intf_id_to_group_ids_, egress_intf_id);
+  CHECK_RETURN_IF_FALSE(
+      sharing_group_ids == nullptr ||
+      FindShareableMultipathNexthop(action_profile_group) == egress_intf_id)
       << "Group with ID " << group_id
       << " is supposed to point to egress intf with ID " << egress_intf_id
       << ". However this egress intf is already assigned to group with ID "
-      << it->first << " on this node.";
+      << *sharing_group_ids->begin() << " on this node.";
 
-  // Add an BcmMultipathNexthopInfo for the group.
-  auto* group_nexthop_info = new BcmMultipathNexthopInfo();
+  // Add an BcmMultipathNexthopInfo for the group. All the members are looked
+  // up first so that nothing is modified if one of them is not found.
+  auto group_nexthop_info = absl::make_unique<BcmMultipathNexthopInfo>();
   group_nexthop_info->egress_intf_id = egress_intf_id;
+  std::vector<BcmNonMultipathNexthopInfo*> member_nexthop_infos;
   for (const auto& member : action_profile_group.members()) {
+    ASSIGN_OR_RETURN(BcmNonMultipathNexthopInfo* member_nexthop_info,
+                     GetBcmNonMultipathNexthopInfo(member.member_id()));
+    member_nexthop_infos.push_back(member_nexthop_info);
+  }
+  for (int i = 0; i < action_profile_group.members_size(); ++i) {
+    const auto& member = action_profile_group.members(i);
     uint32 member_id = member.member_id();
     uint32 weight = std::max(member.weight(), 1);
-    ASSIGN_OR_RETURN(BcmNonMultipathNexthopInfo* member_nexthop_info,
-                     GetBcmNonMultipathNexthopInfo(member_id));
+    BcmNonMultipathNexthopInfo* member_nexthop_info = member_nexthop_infos[i];
     group_nexthop_info->member_id_to_weight[member_id] = weight;
     member_nexthop_info->group_ref_count++;
     // For singleton port members, add reference from the port to this group.
@@ -1163,15 +1183,11 @@ namespace {
       group_ids.insert(group_id);
     }
   }
-  if (!gtl::InsertIfNotPresent(&group_id_to_nexthop_info_, group_id,
-                               group_nexthop_info)) {
-    delete group_nexthop_info;
-    return MAKE_ERROR(ERR_INVALID_PARAM)
-           << "Cannot add already existing group_id: " << group_id << ".";
-  }
+  AddToMultipathIndex(group_id, *group_nexthop_info);
+  group_id_to_nexthop_info_[group_id] = group_nexthop_info.release();
 
   // Save a copy of P4 ActionProfileGroup.
-  if (!gtl::InsertIfNotPresent(&groups_, {group_id, action_profile_group})) {
+  if (!groups_.Insert(group_id, action_profile_group)) {
     return MAKE_ERROR(ERR_INVALID_PARAM)
            << "Inconsistent state. Group with ID " << group_id << " already "
            << "exists in groups_.";
@@ -1238,7 +1254,7 @@ namespace {
   CHECK_RETURN_IF_FALSE(members_.erase(member_id) == 1)
       << "Inconsistent state. Old member with ID " << member_id << " did not "
       << "exist in members_.";
-  members_.insert({member_id, action_profile_member});
+  members_.Insert(member_id, action_profile_member);
 
   return ::util::OkStatus();
 }
@@ -1252,6 +1268,10 @@ namespace {
   // for the group and update it.
   ASSIGN_OR_RETURN(BcmMultipathNexthopInfo* group_nexthop_info,
                    GetBcmMultipathNexthopInfo(group_id));
+  for (const auto& member : action_profile_group.members()) {
+    RETURN_IF_ERROR(GetBcmNonMultipathNexthopInfo(member.member_id()).status());
+  }
+  RemoveFromMultipathIndex(group_id, *group_nexthop_info);
 
   // Save a copy of old member_id_to_weight and then populate it with the new
   // members.
@@ -1311,13 +1331,25 @@ namespace {
       }
     }
   }
+  AddToMultipathIndex(group_id, *group_nexthop_info);
 
   // Update the copy of P4 ActionProfileGroup matching the input
   // (remove the old match and add the new one instead).
   CHECK_RETURN_IF_FALSE(groups_.erase(group_id) == 1)
       << "Inconsistent state. Old group with ID " << group_id << " did not "
       << "exist in groups_.";
-  groups_.insert({group_id, action_profile_group});
+  groups_.Insert(group_id, action_profile_group);
+
+  return ::util::OkStatus();
+}
+
+::util::Status BcmTableManager::UpdateActionProfileGroupEgressIntf(
+    uint32 group_id, int egress_intf_id) {
+  ASSIGN_OR_RETURN(BcmMultipathNexthopInfo* group_nexthop_info,
+                   GetBcmMultipathNexthopInfo(group_id));
+  RemoveFromMultipathIndex(group_id, *group_nexthop_info);
+  group_nexthop_info->egress_intf_id = egress_intf_id;
+  AddToMultipathIndex(group_id, *group_nexthop_info);
 
   return ::util::OkStatus();
 }
@@ -1372,8 +1404,10 @@ namespace {
       group_ids->erase(group_id);
     }
   }
+  RemoveFromMultipathIndex(group_id, *group_nexthop_info);
   delete group_nexthop_info;
   group_id_to_nexthop_info_.erase(group_id);
+  group_id_to_flows_.erase(group_id);
 
   // Delete the copy of P4 ActionProfileGroup matching the input.
   CHECK_RETURN_IF_FALSE(groups_.erase(group_id) == 1)
@@ -1405,24 +1439,71 @@ namespace {
   return ::util::OkStatus();
 }
 
-::util::StatusOr<absl::flat_hash_map<int, BcmMultipathNexthop>>
-BcmTableManager::FillBcmMultipathNexthopsWithPort(uint32 port_id) const {
+::util::StatusOr<std::vector<BcmMultipathGroupUpdate>>
+BcmTableManager::GetMultipathGroupUpdatesForPort(uint32 port_id) const {
   auto* port = gtl::FindOrNull(port_id_to_logical_port_, port_id);
   CHECK_RETURN_IF_FALSE(port != nullptr);
+  std::vector<BcmMultipathGroupUpdate> updates;
   auto* group_ids = gtl::FindOrNull(port_to_group_ids_, *port);
-  if (!group_ids) return absl::flat_hash_map<int, BcmMultipathNexthop>();
-  absl::flat_hash_map<int, BcmMultipathNexthop> nexthops;
+  if (!group_ids) return updates;
+  // Groups referencing the same port usually share most of their other
+  // members as well, so the state of each member port is looked up only once.
+  absl::flat_hash_map<int, bool> port_is_up;
+  // Groups sharing a hardware group result in a single update.
+  absl::flat_hash_map<int, size_t> egress_intf_id_to_update_index;
+  updates.reserve(group_ids->size());
   for (const auto& group_id : *group_ids) {
-    // Get nexthop info for the BCM egress_intf_id.
-    ASSIGN_OR_RETURN(auto* nexthop_info, GetBcmMultipathNexthopInfo(group_id));
-    auto& nexthop =
-        gtl::LookupOrInsert(&nexthops, nexthop_info->egress_intf_id, {});
-    // Populate the BcmMultipathNexthopInfo.
-    const auto* group = gtl::FindOrNull(groups_, group_id);
-    CHECK_RETURN_IF_FALSE(group != nullptr);
-    RETURN_IF_ERROR(FillBcmMultipathNexthop(*group, &nexthop));
-  }
-  return std::move(nexthops);
+    ASSIGN_OR_RETURN(auto* group_nexthop_info,
+                     GetBcmMultipathNexthopInfo(group_id));
+    auto it = egress_intf_id_to_update_index.find(
+        group_nexthop_info->egress_intf_id);
+    if (it != egress_intf_id_to_update_index.end()) {
+      updates[it->second].flow_ref_count += group_nexthop_info->flow_ref_count;
+      continue;
+    }
+    egress_intf_id_to_update_index.emplace(group_nexthop_info->egress_intf_id,
+                                           updates.size());
+    BcmMultipathGroupUpdate update;
+    update.egress_intf_id = group_nexthop_info->egress_intf_id;
+    update.flow_ref_count = group_nexthop_info->flow_ref_count;
+    update.members.reserve(group_nexthop_info->member_id_to_weight.size());
+    for (const auto& e : group_nexthop_info->member_id_to_weight) {
+      ASSIGN_OR_RETURN(BcmNonMultipathNexthopInfo* member_nexthop_info,
+                       GetBcmNonMultipathNexthopInfo(e.first));
+      // If member points to singleton port, check state before adding member.
+      // TODO(madhaviyengar): Add support for checking trunk state once this
+      // functionality becomes available.
+      if (member_nexthop_info->type ==
+          BcmNonMultipathNexthop::NEXTHOP_TYPE_PORT) {
+        int member_port = member_nexthop_info->bcm_port;
+        auto it = port_is_up.find(member_port);
+        if (it == port_is_up.end()) {
+          ASSIGN_OR_RETURN(PortState port_state,
+                           bcm_chassis_ro_interface_->GetPortState(
+                               SdkPort(unit_, member_port)));
+          it = port_is_up.emplace(member_port, port_state == PORT_STATE_UP)
+                   .first;
+        }
+        // Only keep member if port is UP.
+        if (!it->second) continue;
+      }
+      update.members.emplace_back(member_nexthop_info->egress_intf_id,
+                                  e.second);
+    }
+    updates.push_back(std::move(update));
+  }
+  // Groups used by the largest number of flows go first. Ties are broken by
+  // the egress intf ID to keep the order deterministic.
+  std::sort(updates.begin(), updates.end(),
+            [](const BcmMultipathGroupUpdate& a,
+               const BcmMultipathGroupUpdate& b) {
+              if (a.flow_ref_count != b.flow_ref_count) {
+                return a.flow_ref_count > b.flow_ref_count;
+              }
+              return a.egress_intf_id < b.egress_intf_id;
+            });
+
+  return updates;
 }
 
 ::util::StatusOr<std::set<uint32>> BcmTableManager::GetGroupsForMember(
@@ -1440,6 +1521,92 @@ bool BcmTableManager::ActionProfileGroupExists(uint32 group_id) const {
   return group_id_to_nexthop_info_.count(group_id);
 }
 
+int BcmTableManager::FindShareableMultipathNexthop(
+    const ::p4::v1::ActionProfileGroup& action_profile_group) const {
+  std::map<uint32, uint32> member_id_to_weight;
+  for (const auto& member : action_profile_group.members()) {
+    member_id_to_weight[member.member_id()] = std::max(member.weight(), 1);
+  }
+  return gtl::FindWithDefault(reduced_members_to_egress_intf_id_,
+                              GetReducedMultipathMembers(member_id_to_weight),
+                              -1);
+}
+
+std::vector<::p4::v1::TableEntry> BcmTableManager::GetTableEntriesForGroup(
+    uint32 group_id) const {
+  std::vector<::p4::v1::TableEntry> entries;
+  const auto* flows = gtl::FindOrNull(group_id_to_flows_, group_id);
+  if (flows == nullptr) return entries;
+  for (const auto& e : *flows) {
+    // Only the generic flow tables are looked at. ACL flows are not moved
+    // between hardware groups.
+    const auto* table = gtl::FindOrNull(generic_flow_tables_, e.first);
+    if (table == nullptr) continue;
+    for (const auto& key : e.second) {
+      auto result = table->Lookup(key);
+      if (!result.ok()) {
+        // If this error triggers, there is a bug.
+        LOG(ERROR) << "Flow referencing group_id " << group_id
+                   << " not found: " << result.status();
+        continue;
+      }
+      entries.push_back(result.ConsumeValueOrDie());
+    }
+  }
+
+  return entries;
+}
+
+BcmTableManager::ReducedMultipathMembers
+BcmTableManager::GetReducedMultipathMembers(
+    const std::map<uint32, uint32>& member_id_to_weight) {
+  std::vector<uint32> weights;
+  weights.reserve(member_id_to_weight.size());
+  for (const auto& e : member_id_to_weight) weights.push_back(e.second);
+  ReduceWcmpWeights(&weights);
+  ReducedMultipathMembers members;
+  members.reserve(member_id_to_weight.size());
+  size_t i = 0;
+  for (const auto& e : member_id_to_weight) {
+    members.emplace_back(e.first, weights[i++]);
+  }
+
+  return members;
+}
+
+void BcmTableManager::AddToMultipathIndex(uint32 group_id,
+                                          const BcmMultipathNexthopInfo& info) {
+  egress_intf_id_to_group_ids_[info.egress_intf_id].insert(group_id);
+  reduced_members_to_egress_intf_id_.emplace(
+      GetReducedMultipathMembers(info.member_id_to_weight),
+      info.egress_intf_id);
+}
+
+void BcmTableManager::RemoveFromMultipathIndex(
+    uint32 group_id, const BcmMultipathNexthopInfo& info) {
+  auto it = egress_intf_id_to_group_ids_.find(info.egress_intf_id);
+  if (it == egress_intf_id_to_group_ids_.end()) return;
+  it->second.erase(group_id);
+  auto members = GetReducedMultipathMembers(info.member_id_to_weight);
+  // Keep the entry for the members as long as another group with the same
+  // members still points to the hardware group.
+  for (uint32 other_group_id : it->second) {
+    auto* other_info =
+        gtl::FindPtrOrNull(group_id_to_nexthop_info_, other_group_id);
+    if (other_info != nullptr &&
+        GetReducedMultipathMembers(other_info->member_id_to_weight) ==
+            members) {
+      return;
+    }
+  }
+  if (it->second.empty()) egress_intf_id_to_group_ids_.erase(it);
+  auto jt = reduced_members_to_egress_intf_id_.find(members);
+  if (jt != reduced_members_to_egress_intf_id_.end() &&
+      jt->second == info.egress_intf_id) {
+    reduced_members_to_egress_intf_id_.erase(jt);
+  }
+}
+
 ::util::Status BcmTableManager::GetBcmNonMultipathNexthopInfo(
     uint32 member_id, BcmNonMultipathNexthopInfo* info) const {
   if (info == nullptr) {
@@ -1733,8 +1900,8 @@ std::unique_ptr<BcmTableManager> BcmTableManager::CreateInstance(
   return ::util::OkStatus();
 }
 
-::util::Status BcmTableManager::UpdateFlowRefCountForGroup(uint32 group_id,
-                                                           int delta) {
+::util::Status BcmTableManager::UpdateFlowRefCountForGroup(
+    uint32 group_id, const ::p4::v1::TableEntry& table_entry, int delta) {
   ASSIGN_OR_RETURN(BcmMultipathNexthopInfo* group_nexthop_info,
                    GetBcmMultipathNexthopInfo(group_id));
   if (delta < 0) {
@@ -1745,6 +1912,26 @@ std::unique_ptr<BcmTableManager> BcmTableManager::CreateInstance(
   }
   group_nexthop_info->flow_ref_count += delta;
 
+  // Only the key of the flow is kept. The rest is found in its flow table.
+  ::p4::v1::TableEntry key = table_entry;
+  key.clear_action();
+  key.clear_controller_metadata();
+  key.clear_meter_config();
+  key.clear_counter_data();
+  if (delta > 0) {
+    group_id_to_flows_[group_id][key.table_id()].insert(key);
+  } else {
+    auto it = group_id_to_flows_.find(group_id);
+    if (it != group_id_to_flows_.end()) {
+      auto jt = it->second.find(key.table_id());
+      if (jt != it->second.end()) {
+        jt->second.erase(key);
+        if (jt->second.empty()) it->second.erase(jt);
+      }
+      if (it->second.empty()) group_id_to_flows_.erase(it);
+    }
+  }
+
   return ::util::OkStatus();
 }
 
@@ -31,6 +31,7 @@
 #include "stratum/hal/lib/bcm/acl_table.h"
 #include "stratum/hal/lib/bcm/bcm.pb.h"
 #include "stratum/hal/lib/bcm/bcm_chassis_ro_interface.h"
+#include "stratum/hal/lib/bcm/bcm_compact_store.h"
 #include "stratum/hal/lib/bcm/bcm_flow_table.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/writer_interface.h"
@@ -83,6 +84,21 @@ struct BcmMultipathNexthopInfo {
       : egress_intf_id(-1), flow_ref_count(0), member_id_to_weight() {}
 };
 
+// This struct encapsulates the members an already programmed multipath
+// (ECMP/WCMP) nexthop needs to be reprogrammed with after the state of one of
+// its member ports changed.
+struct BcmMultipathGroupUpdate {
+  // Egress intf ID of the group as given by the SDK after creation.
+  int egress_intf_id;
+  // Ref count for flows (number of flows directly pointing to this group).
+  uint32 flow_ref_count;
+  // Egress intf IDs and weights of all the members which can still forward
+  // traffic, i.e. members not pointing to a singleton port which is not UP.
+  std::vector<std::pair<int, uint32>> members;
+  BcmMultipathGroupUpdate()
+      : egress_intf_id(-1), flow_ref_count(0), members() {}
+};
+
 // The "BcmTableManager" class implements the L3 routing functionality.
 class BcmTableManager {
  public:
@@ -156,14 +172,18 @@ class BcmTableManager {
       const ::p4::v1::ActionProfileGroup& action_profile_group,
       BcmMultipathNexthop* bcm_multipath_nexthop) const;
 
-  // Populates and returns the BCM id and configuration for all existing
+  // Returns the BCM id and the members to keep for all existing
   // ActionProfileGroups with members referencing the given port_id. This does
   // not modify BcmTableManager state, as this is an internal functionality with
   // the purpose of mitigating blackholing. This function is generally invoked
   // on a LinkscanEvent with the purpose of adding or removing the relevant port
-  // to or from any referencing groups.
-  virtual ::util::StatusOr<absl::flat_hash_map<int, BcmMultipathNexthop>>
-  FillBcmMultipathNexthopsWithPort(uint32 port_id) const;
+  // to or from any referencing groups. Only the nexthop info already kept for
+  // the groups is used: the groups are not re-validated against the P4
+  // pipeline and the state of every member port is looked up only once.
+  // The updates are sorted by flow_ref_count (highest first), so that the
+  // groups carrying the largest number of routes can be repaired first.
+  virtual ::util::StatusOr<std::vector<BcmMultipathGroupUpdate>>
+  GetMultipathGroupUpdatesForPort(uint32 port_id) const;
 
   // Transer meter configuration from P4 MeterConfig to BcmMeterConfig.
   // TODO(max): Why is this function not virtual like the rest
@@ -219,7 +239,9 @@ class BcmTableManager {
   // controller later. This function also adds a BcmMultipathNexthopInfo for the
   // ECMP/WCMP group corresponding to the P4 ActionProfileGroup, giving
   // its egress intf ID (there is no type for BcmMultipathNexthopInfo). This is
-  // called after the group is added to hardware.
+  // called after the group is added to hardware. The egress intf ID can only
+  // be already assigned to other groups if it was returned by
+  // FindShareableMultipathNexthop() for this group.
   virtual ::util::Status AddActionProfileGroup(
       const ::p4::v1::ActionProfileGroup& action_profile_group,
       int egress_intf_id);
@@ -254,6 +276,12 @@ class BcmTableManager {
   virtual ::util::Status UpdateActionProfileGroup(
       const ::p4::v1::ActionProfileGroup& action_profile_group);
 
+  // Points an existing ECMP/WCMP group to another egress intf ID. This is
+  // called after a group sharing its hardware group with other groups got a
+  // hardware group of its own as part of a group modify.
+  virtual ::util::Status UpdateActionProfileGroupEgressIntf(uint32 group_id,
+                                                            int egress_intf_id);
+
   // Deletes an existing copy of P4 ActionProfileMember which is matching
   // the one passed to the function. This function also deletes the
   // BcmNonMultipathNexthopInfo for the ECMP/WCMP group member corresponding to
@@ -292,6 +320,19 @@ class BcmTableManager {
   // Helper which determines whether a group exists.
   virtual bool ActionProfileGroupExists(uint32 group_id) const;
 
+  // Returns the egress intf ID of an existing ECMP/WCMP group with the same
+  // members as the given P4 ActionProfileGroup and the same weights once
+  // divided by their GCD, or -1 if there is no such group. The hardware group
+  // can then be shared instead of programming an identical one.
+  virtual int FindShareableMultipathNexthop(
+      const ::p4::v1::ActionProfileGroup& action_profile_group) const;
+
+  // Returns copies of all the P4 TableEntry(s) in the generic flow tables
+  // whose action points to the given ActionProfileGroup. Only the flows
+  // referencing the group are looked up.
+  virtual std::vector<::p4::v1::TableEntry> GetTableEntriesForGroup(
+      uint32 group_id) const;
+
   // Populates the BcmNonMultipathNexthopInfo corresponding to an ECMP/WCMP
   // group member given its member_id. Returns error if the member cannot be
   // found in the internal maps. Internally uses the private version of
@@ -399,7 +440,8 @@ class BcmTableManager {
 
   // Private helpers for mutating flow_ref_count for members and groups.
   ::util::Status UpdateFlowRefCountForMember(uint32 member_id, int delta);
-  ::util::Status UpdateFlowRefCountForGroup(uint32 group_id, int delta);
+  ::util::Status UpdateFlowRefCountForGroup(
+      uint32 group_id, const ::p4::v1::TableEntry& table_entry, int delta);
 
   // Private helpers to get the pointers to nexthop info for members and groups.
   ::util::StatusOr<BcmNonMultipathNexthopInfo*> GetBcmNonMultipathNexthopInfo(
@@ -407,6 +449,21 @@ class BcmTableManager {
   ::util::StatusOr<BcmMultipathNexthopInfo*> GetBcmMultipathNexthopInfo(
       uint32 group_id) const;
 
+  // Members of a multipath group sorted by member_id, with their weights
+  // divided by the GCD of all the weights. Groups with the same reduced
+  // members forward traffic the same way and can share a hardware group.
+  typedef std::vector<std::pair<uint32, uint32>> ReducedMultipathMembers;
+  static ReducedMultipathMembers GetReducedMultipathMembers(
+      const std::map<uint32, uint32>& member_id_to_weight);
+
+  // Private helpers to add/remove a group to/from the maps used to find
+  // shareable hardware groups. Must be called whenever the egress intf ID or
+  // the members of a group change.
+  void AddToMultipathIndex(uint32 group_id,
+                           const BcmMultipathNexthopInfo& info);
+  void RemoveFromMultipathIndex(uint32 group_id,
+                                const BcmMultipathNexthopInfo& info);
+
   // Construct an egress port action from a port_id. Verify the port against the
   // node_id_. The bcm_action parameter type will indicate if the port is a
   // logical port or a trunk port.
@@ -515,13 +572,29 @@ class BcmTableManager {
   // should be updated based on the port.
   absl::flat_hash_map<int, absl::flat_hash_set<uint32>> port_to_group_ids_;
 
+  // Map from egress intf ID of an ECMP/WCMP group to the ids of the P4 groups
+  // pointing to it. There is more than one group when a hardware group is
+  // shared.
+  absl::flat_hash_map<int, absl::flat_hash_set<uint32>>
+      egress_intf_id_to_group_ids_;
+
+  // Map from the reduced members of a group to the egress intf ID of the
+  // hardware group programmed for them. Used to find shareable groups.
+  absl::flat_hash_map<ReducedMultipathMembers, int>
+      reduced_members_to_egress_intf_id_;
+
+  // Map from group_id to the keys of the flows pointing to the group, indexed
+  // by table id. Kept together with the flow_ref_count of the group.
+  absl::flat_hash_map<uint32, TableIdToTableEntrySetMap> group_id_to_flows_;
+
   // Map from id to the ActionProfileMembers (egress objects) programmed on the
-  // node.
-  absl::flat_hash_map<uint32, ::p4::v1::ActionProfileMember> members_;
+  // node. Kept serialized, as they are only needed to answer reads.
+  CompactProtoMap<::p4::v1::ActionProfileMember> members_;
 
   // Map from id to the ActionProfileGroups (multipath egress objects)
-  // programmed on the node.
-  absl::flat_hash_map<uint32, ::p4::v1::ActionProfileGroup> groups_;
+  // programmed on the node. Kept serialized, as they are only needed to answer
+  // reads and to rebuild the multipath nexthops.
+  CompactProtoMap<::p4::v1::ActionProfileGroup> groups_;
 
   // Map from id to the CloneSessionEntry programmed on the node.
   absl::flat_hash_map<uint32, ::p4::v1::CloneSessionEntry> clone_sessions_;
@@ -62,9 +62,8 @@ class BcmTableManagerMock : public BcmTableManager {
       ::util::Status(const ::p4::v1::ActionProfileGroup& action_profile_group,
                      BcmMultipathNexthop* bcm_multipath_nexthop));
   MOCK_CONST_METHOD1(
-      FillBcmMultipathNexthopsWithPort,
-      ::util::StatusOr<absl::flat_hash_map<int, BcmMultipathNexthop>>(
-          uint32 port_id));
+      GetMultipathGroupUpdatesForPort,
+      ::util::StatusOr<std::vector<BcmMultipathGroupUpdate>>(uint32 port_id));
   MOCK_CONST_METHOD2(FillBcmMeterConfig,
                      ::util::Status(const ::p4::v1::MeterConfig& p4_meter,
                                     BcmMeterConfig* bcm_meter));
@@ -95,6 +94,8 @@ class BcmTableManagerMock : public BcmTableManager {
   MOCK_METHOD1(
       UpdateActionProfileGroup,
       ::util::Status(const ::p4::v1::ActionProfileGroup& action_profile_group));
+  MOCK_METHOD2(UpdateActionProfileGroupEgressIntf,
+               ::util::Status(uint32 group_id, int egress_intf_id));
   MOCK_METHOD1(DeleteActionProfileMember,
                ::util::Status(
                    const ::p4::v1::ActionProfileMember& action_profile_member));
@@ -105,6 +106,11 @@ class BcmTableManagerMock : public BcmTableManager {
                      ::util::StatusOr<std::set<uint32>>(uint32 member_id));
   MOCK_CONST_METHOD1(ActionProfileMemberExists, bool(uint32 member_id));
   MOCK_CONST_METHOD1(ActionProfileGroupExists, bool(uint32 group_id));
+  MOCK_CONST_METHOD1(
+      FindShareableMultipathNexthop,
+      int(const ::p4::v1::ActionProfileGroup& action_profile_group));
+  MOCK_CONST_METHOD1(GetTableEntriesForGroup,
+                     std::vector<::p4::v1::TableEntry>(uint32 group_id));
   MOCK_CONST_METHOD2(GetBcmNonMultipathNexthopInfo,
                      ::util::Status(uint32 member_id,
                                     BcmNonMultipathNexthopInfo* info));
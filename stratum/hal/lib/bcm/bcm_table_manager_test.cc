@@ -3193,7 +3193,7 @@ TEST_F(BcmTableManagerTest, FillBcmMultipathNexthopFailure) {
   EXPECT_EQ("error2", status.error_message());
 }
 
-TEST_F(BcmTableManagerTest, FillBcmMultipathNexthopsWithPortSuccess) {
+TEST_F(BcmTableManagerTest, GetMultipathGroupUpdatesForPortSuccess) {
   ASSERT_NO_FATAL_FAILURE(PushTestConfig());
 
   // Set up P4 members and groups, with one member, shared by 2 groups, pointing
@@ -3221,7 +3221,6 @@ TEST_F(BcmTableManagerTest, FillBcmMultipathNexthopsWithPortSuccess) {
   group3.add_members()->set_member_id(kMemberId2);
   group3.add_members()->set_member_id(kMemberId3);
 
-  // Add and verify the members and groups.
   ASSERT_OK(bcm_table_manager_->AddActionProfileMember(
       member1, BcmNonMultipathNexthop::NEXTHOP_TYPE_PORT, kEgressIntfId1,
       kLogicalPort1));
@@ -3231,91 +3230,52 @@ TEST_F(BcmTableManagerTest, FillBcmMultipathNexthopsWithPortSuccess) {
   ASSERT_OK(bcm_table_manager_->AddActionProfileMember(
       member3, BcmNonMultipathNexthop::NEXTHOP_TYPE_PORT, kEgressIntfId3,
       kLogicalPort2));
-  ASSERT_OK(bcm_table_manager_->AddActionProfileGroup(group1, kEgressIntfId4));
-  ASSERT_OK(bcm_table_manager_->AddActionProfileGroup(group2, kEgressIntfId5));
+  ASSERT_OK(bcm_table_manager_->AddActionProfileGroup(group1, kEgressIntfId5));
+  ASSERT_OK(bcm_table_manager_->AddActionProfileGroup(group2, kEgressIntfId4));
   ASSERT_OK(bcm_table_manager_->AddActionProfileGroup(group3, kEgressIntfId6));
-  ASSERT_OK(VerifyActionProfileMember(member1,
-                                      BcmNonMultipathNexthop::NEXTHOP_TYPE_PORT,
-                                      kEgressIntfId1, kLogicalPort1, 2, 0));
-  ASSERT_OK(VerifyActionProfileMember(
-      member2, BcmNonMultipathNexthop::NEXTHOP_TYPE_TRUNK, kEgressIntfId2,
-      kTrunkPort1, 2, 0));
-  ASSERT_OK(VerifyActionProfileMember(member3,
-                                      BcmNonMultipathNexthop::NEXTHOP_TYPE_PORT,
-                                      kEgressIntfId3, kLogicalPort2, 2, 0));
-  ASSERT_OK(VerifyActionProfileGroup(
-      group1, kEgressIntfId4, 0,
-      {{kMemberId1, std::make_tuple(1, 2, kLogicalPort1)},
-       {kMemberId2, std::make_tuple(1, 2, kTrunkPort1)}}));
-  ASSERT_OK(VerifyActionProfileGroup(
-      group2, kEgressIntfId5, 0,
-      {{kMemberId1, std::make_tuple(1, 2, kLogicalPort1)},
-       {kMemberId3, std::make_tuple(1, 2, kLogicalPort2)}}));
-  ASSERT_OK(VerifyActionProfileGroup(
-      group3, kEgressIntfId6, 0,
-      {{kMemberId2, std::make_tuple(1, 2, kTrunkPort1)},
-       {kMemberId3, std::make_tuple(1, 2, kLogicalPort2)}}));
 
-  // Set up expectations for the FillBcmMultipathNexthop() calls. This should
-  // only be called for group1 and group2 which share kLogicalPort1.
-  EXPECT_CALL(*p4_table_mapper_mock_,
-              MapActionProfileGroup(EqualsProto(group1), _))
-      .WillOnce(Return(::util::OkStatus()));
-  EXPECT_CALL(*p4_table_mapper_mock_,
-              MapActionProfileGroup(EqualsProto(group2), _))
-      .WillOnce(Return(::util::OkStatus()));
+  // kLogicalPort1 went down. The state of each port must only be queried once,
+  // even if it is used by several groups.
   EXPECT_CALL(*bcm_chassis_ro_mock_,
               GetPortState(SdkPortEq(SdkPort(kUnit, kLogicalPort1))))
-      .Times(2)
-      .WillRepeatedly(Return(PORT_STATE_UP));
+      .WillOnce(Return(PORT_STATE_DOWN));
   EXPECT_CALL(*bcm_chassis_ro_mock_,
               GetPortState(SdkPortEq(SdkPort(kUnit, kLogicalPort2))))
       .WillOnce(Return(PORT_STATE_UP));
 
-  auto status_or_nexthops =
-      bcm_table_manager_->FillBcmMultipathNexthopsWithPort(kPortId1);
-  ASSERT_TRUE(status_or_nexthops.ok());
-  auto nexthops = std::move(status_or_nexthops).ValueOrDie();
-
-  // Check that the nexthop groups are filled as expected.
-  ASSERT_EQ(2, nexthops.size());
-  bool nexthop1_ok = false, nexthop2_ok = false;
-  for (auto& e : nexthops) {
-    int egress_intf_id = e.first;
-    BcmMultipathNexthop& nexthop = e.second;
-    EXPECT_EQ(kUnit, nexthop.unit());
-    ASSERT_EQ(2, nexthop.members_size());
-    if (egress_intf_id == kEgressIntfId4) {
-      EXPECT_EQ(kEgressIntfId1, nexthop.members(0).egress_intf_id());
-      EXPECT_EQ(1, nexthop.members(0).weight());
-      EXPECT_EQ(kEgressIntfId2, nexthop.members(1).egress_intf_id());
-      EXPECT_EQ(1, nexthop.members(1).weight());
-      nexthop1_ok = true;
-    } else if (egress_intf_id == kEgressIntfId5) {
-      EXPECT_EQ(kEgressIntfId1, nexthop.members(0).egress_intf_id());
-      EXPECT_EQ(1, nexthop.members(0).weight());
-      EXPECT_EQ(kEgressIntfId3, nexthop.members(1).egress_intf_id());
-      EXPECT_EQ(1, nexthop.members(1).weight());
-      nexthop2_ok = true;
-    }
-  }
-  EXPECT_TRUE(nexthop1_ok);
-  EXPECT_TRUE(nexthop2_ok);
+  auto status_or_updates =
+      bcm_table_manager_->GetMultipathGroupUpdatesForPort(kPortId1);
+  ASSERT_TRUE(status_or_updates.ok());
+  const auto& updates = status_or_updates.ValueOrDie();
+
+  // Only group1 and group2 share kLogicalPort1. As no flow uses them, they are
+  // sorted by egress intf ID. Members on kLogicalPort1 are pruned.
+  ASSERT_EQ(2, updates.size());
+  EXPECT_EQ(kEgressIntfId4, updates[0].egress_intf_id);
+  EXPECT_EQ(0, updates[0].flow_ref_count);
+  ASSERT_EQ(1, updates[0].members.size());
+  EXPECT_EQ(kEgressIntfId3, updates[0].members[0].first);
+  EXPECT_EQ(1, updates[0].members[0].second);
+  EXPECT_EQ(kEgressIntfId5, updates[1].egress_intf_id);
+  EXPECT_EQ(0, updates[1].flow_ref_count);
+  ASSERT_EQ(1, updates[1].members.size());
+  EXPECT_EQ(kEgressIntfId2, updates[1].members[0].first);
+  EXPECT_EQ(1, updates[1].members[0].second);
 }
 
-TEST_F(BcmTableManagerTest, FillBcmMultipathNexthopsWithPortFailure) {
+TEST_F(BcmTableManagerTest, GetMultipathGroupUpdatesForPortFailure) {
   ASSERT_NO_FATAL_FAILURE(PushTestConfig());
 
   // Failure due to unknown port.
-  auto status_or_nexthops =
-      bcm_table_manager_->FillBcmMultipathNexthopsWithPort(10493232);
-  EXPECT_FALSE(status_or_nexthops.ok());
-  EXPECT_EQ(ERR_INVALID_PARAM, status_or_nexthops.status().error_code());
-  // No groups reference the port. Empty map should be returned.
-  status_or_nexthops =
-      bcm_table_manager_->FillBcmMultipathNexthopsWithPort(kPortId1);
-  EXPECT_TRUE(status_or_nexthops.ok());
-  EXPECT_TRUE(status_or_nexthops.ValueOrDie().empty());
+  auto status_or_updates =
+      bcm_table_manager_->GetMultipathGroupUpdatesForPort(10493232);
+  EXPECT_FALSE(status_or_updates.ok());
+  EXPECT_EQ(ERR_INVALID_PARAM, status_or_updates.status().error_code());
+  // No groups reference the port. Empty vector should be returned.
+  status_or_updates =
+      bcm_table_manager_->GetMultipathGroupUpdatesForPort(kPortId1);
+  EXPECT_TRUE(status_or_updates.ok());
+  EXPECT_TRUE(status_or_updates.ValueOrDie().empty());
 }
 
 TEST_F(BcmTableManagerTest, AddTableEntrySuccess) {
@@ -4108,6 +4068,172 @@ TEST_F(BcmTableManagerTest, AddActionProfileGroupFailureForNoActionProfileId) {
               HasSubstr("Need non-zero group_id and action_profile_id:"));
 }
 
+TEST_F(BcmTableManagerTest, AddActionProfileGroupSuccessForSharedGroups) {
+  ASSERT_NO_FATAL_FAILURE(PushTestConfig());
+
+  ::p4::v1::ActionProfileMember member1, member2;
+  ::p4::v1::ActionProfileGroup group1, group2, group3;
+
+  member1.set_member_id(kMemberId1);
+  member1.set_action_profile_id(kActionProfileId1);
+  member2.set_member_id(kMemberId2);
+  member2.set_action_profile_id(kActionProfileId1);
+
+  // group1 and group2 have the same weights once reduced, group3 does not.
+  group1.set_group_id(kGroupId1);
+  group1.set_action_profile_id(kActionProfileId1);
+  auto* member = group1.add_members();
+  member->set_member_id(kMemberId1);
+  member->set_weight(2);
+  member = group1.add_members();
+  member->set_member_id(kMemberId2);
+  member->set_weight(4);
+  group2.set_group_id(kGroupId2);
+  group2.set_action_profile_id(kActionProfileId1);
+  member = group2.add_members();
+  member->set_member_id(kMemberId2);
+  member->set_weight(2);
+  member = group2.add_members();
+  member->set_member_id(kMemberId1);
+  member->set_weight(1);
+  group3.set_group_id(kGroupId3);
+  group3.set_action_profile_id(kActionProfileId1);
+  group3.add_members()->set_member_id(kMemberId1);
+  group3.add_members()->set_member_id(kMemberId2);
+
+  ASSERT_OK(bcm_table_manager_->AddActionProfileMember(
+      member1, BcmNonMultipathNexthop::NEXTHOP_TYPE_PORT, kEgressIntfId1,
+      kLogicalPort1));
+  ASSERT_OK(bcm_table_manager_->AddActionProfileMember(
+      member2, BcmNonMultipathNexthop::NEXTHOP_TYPE_TRUNK, kEgressIntfId2,
+      kTrunkPort1));
+
+  EXPECT_EQ(-1, bcm_table_manager_->FindShareableMultipathNexthop(group1));
+  ASSERT_OK(bcm_table_manager_->AddActionProfileGroup(group1, kEgressIntfId4));
+  EXPECT_EQ(kEgressIntfId4,
+            bcm_table_manager_->FindShareableMultipathNexthop(group2));
+  EXPECT_EQ(-1, bcm_table_manager_->FindShareableMultipathNexthop(group3));
+
+  // Only group2 can share the egress intf of group1.
+  ASSERT_OK(bcm_table_manager_->AddActionProfileGroup(group2, kEgressIntfId4));
+  ::util::Status status =
+      bcm_table_manager_->AddActionProfileGroup(group3, kEgressIntfId4);
+  ASSERT_FALSE(status.ok());
+  EXPECT_THAT(status.error_message(), HasSubstr("already assigned"));
+  EXPECT_FALSE(bcm_table_manager_->ActionProfileGroupExists(kGroupId3));
+  ASSERT_OK(VerifyActionProfileGroup(
+      group2, kEgressIntfId4, 0,
+      {{kMemberId1, std::make_tuple(1, 2, kLogicalPort1)},
+       {kMemberId2, std::make_tuple(2, 2, kTrunkPort1)}}));
+
+  // The shared group is only updated once on a port change.
+  EXPECT_CALL(*bcm_chassis_ro_mock_,
+              GetPortState(SdkPortEq(SdkPort(kUnit, kLogicalPort1))))
+      .WillOnce(Return(PORT_STATE_UP));
+  auto status_or_updates =
+      bcm_table_manager_->GetMultipathGroupUpdatesForPort(kPortId1);
+  ASSERT_TRUE(status_or_updates.ok());
+  ASSERT_EQ(1, status_or_updates.ValueOrDie().size());
+  EXPECT_EQ(kEgressIntfId4,
+            status_or_updates.ValueOrDie()[0].egress_intf_id);
+
+  // The egress intf stays shareable as long as one of the groups uses it.
+  ASSERT_OK(bcm_table_manager_->DeleteActionProfileGroup(group1));
+  EXPECT_EQ(kEgressIntfId4,
+            bcm_table_manager_->FindShareableMultipathNexthop(group1));
+  ASSERT_OK(bcm_table_manager_->DeleteActionProfileGroup(group2));
+  EXPECT_EQ(-1, bcm_table_manager_->FindShareableMultipathNexthop(group1));
+}
+
+TEST_F(BcmTableManagerTest, UpdateActionProfileGroupEgressIntfSuccess) {
+  ASSERT_NO_FATAL_FAILURE(PushTestConfig());
+
+  ::p4::v1::ActionProfileMember member1;
+  ::p4::v1::ActionProfileGroup group1, group2;
+
+  member1.set_member_id(kMemberId1);
+  member1.set_action_profile_id(kActionProfileId1);
+  group1.set_group_id(kGroupId1);
+  group1.set_action_profile_id(kActionProfileId1);
+  group1.add_members()->set_member_id(kMemberId1);
+  group2 = group1;
+  group2.set_group_id(kGroupId2);
+
+  ASSERT_OK(bcm_table_manager_->AddActionProfileMember(
+      member1, BcmNonMultipathNexthop::NEXTHOP_TYPE_PORT, kEgressIntfId1,
+      kLogicalPort1));
+  ASSERT_OK(bcm_table_manager_->AddActionProfileGroup(group1, kEgressIntfId4));
+  ASSERT_OK(bcm_table_manager_->AddActionProfileGroup(group2, kEgressIntfId4));
+
+  // group2 moves to its own egress intf. group1 still owns the old one.
+  ASSERT_OK(bcm_table_manager_->UpdateActionProfileGroupEgressIntf(
+      kGroupId2, kEgressIntfId5));
+  BcmMultipathNexthopInfo info;
+  ASSERT_OK(bcm_table_manager_->GetBcmMultipathNexthopInfo(kGroupId2, &info));
+  EXPECT_EQ(kEgressIntfId5, info.egress_intf_id);
+  EXPECT_EQ(kEgressIntfId4,
+            bcm_table_manager_->FindShareableMultipathNexthop(group2));
+
+  EXPECT_FALSE(bcm_table_manager_
+                   ->UpdateActionProfileGroupEgressIntf(kGroupId3,
+                                                        kEgressIntfId6)
+                   .ok());
+}
+
+TEST_F(BcmTableManagerTest, GetTableEntriesForGroupSuccess) {
+  ASSERT_NO_FATAL_FAILURE(PushTestConfig());
+
+  ::p4::v1::ActionProfileMember member1;
+  ::p4::v1::ActionProfileGroup group1, group2;
+  ::p4::v1::TableEntry entry1, entry2, entry3, entry4;
+
+  member1.set_member_id(kMemberId1);
+  member1.set_action_profile_id(kActionProfileId1);
+  group1.set_group_id(kGroupId1);
+  group1.set_action_profile_id(kActionProfileId1);
+  group1.add_members()->set_member_id(kMemberId1);
+  group2 = group1;
+  group2.set_group_id(kGroupId2);
+
+  entry1.set_table_id(kTableId1);
+  entry1.add_match()->set_field_id(kFieldId1);
+  entry1.mutable_action()->set_action_profile_group_id(kGroupId1);
+  entry2.set_table_id(kTableId2);
+  entry2.add_match()->set_field_id(kFieldId2);
+  entry2.mutable_action()->set_action_profile_group_id(kGroupId1);
+  entry3.set_table_id(kTableId1);
+  entry3.add_match()->set_field_id(kFieldId2);
+  entry3.mutable_action()->set_action_profile_group_id(kGroupId2);
+  entry4.set_table_id(kTableId2);
+  entry4.add_match()->set_field_id(kFieldId1);
+  entry4.mutable_action()->set_action_profile_member_id(kMemberId1);
+
+  ASSERT_OK(bcm_table_manager_->AddActionProfileMember(
+      member1, BcmNonMultipathNexthop::NEXTHOP_TYPE_PORT, kEgressIntfId1,
+      kLogicalPort1));
+  ASSERT_OK(bcm_table_manager_->AddActionProfileGroup(group1, kEgressIntfId4));
+  ASSERT_OK(bcm_table_manager_->AddActionProfileGroup(group2, kEgressIntfId5));
+  ASSERT_OK(bcm_table_manager_->AddTableEntry(entry1));
+  ASSERT_OK(bcm_table_manager_->AddTableEntry(entry2));
+  ASSERT_OK(bcm_table_manager_->AddTableEntry(entry3));
+  ASSERT_OK(bcm_table_manager_->AddTableEntry(entry4));
+
+  EXPECT_THAT(bcm_table_manager_->GetTableEntriesForGroup(kGroupId1),
+              UnorderedElementsAre(EqualsProto(entry1), EqualsProto(entry2)));
+  EXPECT_THAT(bcm_table_manager_->GetTableEntriesForGroup(kGroupId2),
+              UnorderedElementsAre(EqualsProto(entry3)));
+
+  // Move entry1 to group2 and delete entry2.
+  entry1.mutable_action()->set_action_profile_group_id(kGroupId2);
+  ASSERT_OK(bcm_table_manager_->UpdateTableEntry(entry1));
+  ASSERT_OK(bcm_table_manager_->DeleteTableEntry(entry2));
+
+  EXPECT_THAT(bcm_table_manager_->GetTableEntriesForGroup(kGroupId1),
+              UnorderedElementsAre());
+  EXPECT_THAT(bcm_table_manager_->GetTableEntriesForGroup(kGroupId2),
+              UnorderedElementsAre(EqualsProto(entry1), EqualsProto(entry3)));
+}
+
 TEST_F(BcmTableManagerTest, UpdateActionProfileMemberSuccess) {
   ASSERT_NO_FATAL_FAILURE(PushTestConfig());
 
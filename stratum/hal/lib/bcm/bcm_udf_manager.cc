@@ -245,16 +245,34 @@ bool BcmUdfManager::DefaultIsUdfEligible(const MappedField& mapped_field,
     return ::util::OkStatus();
   }
 
+  // Plan the allocation for all tables at once: place the tables that need
+  // the most chunks first (first-fit decreasing), as they have the fewest
+  // candidate sets. Ties are broken by table ID so that the same pipeline
+  // config always results in the same allocation.
+  std::vector<AclTable*> allocation_order;
+  for (const auto& pair : udf_sets_per_table) {
+    allocation_order.push_back(pair.first);
+  }
+  std::sort(allocation_order.begin(), allocation_order.end(),
+            [&udf_sets_per_table](AclTable* a, AclTable* b) {
+              size_t a_chunks = udf_sets_per_table.at(a).chunks().size();
+              size_t b_chunks = udf_sets_per_table.at(b).chunks().size();
+              if (a_chunks != b_chunks) return a_chunks > b_chunks;
+              return a->Id() < b->Id();
+            });
+
   // Allocate each ACL table's UDF set to the static tables.
   std::vector<int> static_sets = UdfSetsByUsage(kStatic);
   const std::vector<uint32> empty_vector;
-  for (const auto& pair : udf_sets_per_table) {
-    ASSIGN_OR_RETURN(int udf_set_id, AllocateUdfSet(pair.second, static_sets));
-    // FIXME error message: _ << " Failed to allocate UDF set for table "
-    // << pair.first->Id() << "."
+  for (AclTable* table : allocation_order) {
+    auto allocate_result =
+        AllocateUdfSet(udf_sets_per_table.at(table), static_sets);
+    RETURN_IF_ERROR_WITH_APPEND(allocate_result.status())
+        << " Failed to allocate UDF set for table " << table->Id() << ".";
+    int udf_set_id = allocate_result.ValueOrDie();
     for (uint32 match_field : gtl::FindWithDefault(udf_match_fields_per_table,
-                                                   pair.first, empty_vector)) {
-      RETURN_IF_ERROR(pair.first->MarkUdfMatchField(match_field, udf_set_id));
+                                                   table, empty_vector)) {
+      RETURN_IF_ERROR(table->MarkUdfMatchField(match_field, udf_set_id));
     }
   }
 
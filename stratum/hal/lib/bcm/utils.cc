@@ -16,10 +16,13 @@
 
 #include "stratum/hal/lib/bcm/utils.h"
 
+#include <algorithm>
 #include <sstream>  // IWYU pragma: keep
 
 #include "stratum/hal/lib/common/utils.h"
 #include "stratum/lib/constants.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
 
 namespace stratum {
 namespace hal {
@@ -81,6 +84,72 @@ std::string PrintBcmPortOptions(const BcmPortOptions& options) {
   return buffer.str();
 }
 
+void ReduceWcmpWeights(std::vector<uint32>* weights) {
+  uint32 gcd = 0;
+  for (uint32 weight : *weights) {
+    uint32 a = gcd, b = weight;
+    while (b != 0) {
+      uint32 r = a % b;
+      a = b;
+      b = r;
+    }
+    gcd = a;
+    if (gcd == 1) return;
+  }
+  if (gcd == 0) return;
+  for (auto& weight : *weights) weight /= gcd;
+}
+
+::util::Status ApproximateWcmpWeights(int max_size,
+                                      std::vector<uint32>* weights) {
+  CHECK_RETURN_IF_FALSE(weights != nullptr);
+  uint64 sum = 0;
+  for (uint32 weight : *weights) sum += weight;
+  if (sum <= static_cast<uint64>(max_size)) return ::util::OkStatus();
+  if (weights->size() > static_cast<size_t>(max_size)) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Cannot fit a WCMP group of " << weights->size()
+           << " members in " << max_size << " ECMP member slots.";
+  }
+
+  // The exact number of slots each member would get out of max_size.
+  std::vector<double> shares(weights->size());
+  int64 total = 0;
+  for (size_t i = 0; i < weights->size(); ++i) {
+    shares[i] = static_cast<double>((*weights)[i]) * max_size / sum;
+    (*weights)[i] = std::max<uint32>(1, static_cast<uint32>(shares[i]));
+    total += (*weights)[i];
+  }
+  // Rounding the smallest weights up to 1 may use too many slots. Take them
+  // back from the members which got the most slots above their share.
+  while (total > max_size) {
+    size_t best = weights->size();
+    for (size_t i = 0; i < weights->size(); ++i) {
+      if ((*weights)[i] <= 1) continue;
+      if (best == weights->size() ||
+          (*weights)[i] - shares[i] > (*weights)[best] - shares[best]) {
+        best = i;
+      }
+    }
+    --(*weights)[best];
+    --total;
+  }
+  // Hand out the remaining slots to the members furthest below their share.
+  while (total < max_size) {
+    size_t best = 0;
+    for (size_t i = 1; i < weights->size(); ++i) {
+      if (shares[i] - (*weights)[i] > shares[best] - (*weights)[best]) {
+        best = i;
+      }
+    }
+    ++(*weights)[best];
+    ++total;
+  }
+  ReduceWcmpWeights(weights);
+
+  return ::util::OkStatus();
+}
+
 }  // namespace bcm
 }  // namespace hal
 }  // namespace stratum
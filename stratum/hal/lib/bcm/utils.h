@@ -20,9 +20,11 @@
 #define STRATUM_HAL_LIB_BCM_UTILS_H_
 
 #include <string>
+#include <vector>
 
 #include "stratum/hal/lib/bcm/bcm.pb.h"
 #include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
 #include "absl/strings/str_cat.h"
 
 namespace stratum {
@@ -74,6 +76,22 @@ std::string PrintBcmPort(const BcmPort& p);
 // Prints BcmPortOptions message in a consistent and readable format.
 std::string PrintBcmPortOptions(const BcmPortOptions& options);
 
+// Divides the weights of the members of a WCMP group by their greatest common
+// divisor. The share of the traffic sent to each member does not change, but
+// the group takes fewer ECMP member slots, e.g. {2, 4, 6} becomes {1, 2, 3}.
+// The weights must be non-zero.
+void ReduceWcmpWeights(std::vector<uint32>* weights);
+
+// Approximates the weights of the members of a WCMP group so that they sum up
+// to at most max_size, i.e. the group fits in max_size ECMP member slots. Each
+// member keeps a weight of at least 1. Otherwise the scaled weights are
+// rounded with the largest remainder method, so that the share of the traffic
+// sent to a member is off by less than 1/max_size in most cases. The weights
+// are not changed if they already fit. Returns an error if the group has more
+// than max_size members.
+::util::Status ApproximateWcmpWeights(int max_size,
+                                      std::vector<uint32>* weights);
+
 }  // namespace bcm
 }  // namespace hal
 }  // namespace stratum
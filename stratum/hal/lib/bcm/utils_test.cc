@@ -16,6 +16,9 @@
 
 #include "stratum/hal/lib/bcm/utils.h"
 
+#include <vector>
+
+#include "stratum/glue/status/status_test_util.h"
 #include "stratum/lib/constants.h"
 #include "gtest/gtest.h"
 
@@ -105,6 +108,46 @@ TEST(BcmUtilsTest, PrintBcmPortOptionsForNonEmptyOption) {
             PrintBcmPortOptions(options));
 }
 
+TEST(BcmUtilsTest, ReduceWcmpWeights) {
+  std::vector<uint32> weights = {4, 6, 10};
+  ReduceWcmpWeights(&weights);
+  EXPECT_EQ(std::vector<uint32>({2, 3, 5}), weights);
+
+  weights = {3, 3};
+  ReduceWcmpWeights(&weights);
+  EXPECT_EQ(std::vector<uint32>({1, 1}), weights);
+
+  weights = {1, 7};
+  ReduceWcmpWeights(&weights);
+  EXPECT_EQ(std::vector<uint32>({1, 7}), weights);
+}
+
+TEST(BcmUtilsTest, ApproximateWcmpWeights) {
+  // Weights which already fit are not changed.
+  std::vector<uint32> weights = {2, 6};
+  EXPECT_OK(ApproximateWcmpWeights(8, &weights));
+  EXPECT_EQ(std::vector<uint32>({2, 6}), weights);
+
+  // Rounded to the closest shares of 10 slots.
+  weights = {33, 33, 34};
+  EXPECT_OK(ApproximateWcmpWeights(10, &weights));
+  EXPECT_EQ(std::vector<uint32>({3, 3, 4}), weights);
+
+  // Reduced again once approximated.
+  weights = {49, 51};
+  EXPECT_OK(ApproximateWcmpWeights(10, &weights));
+  EXPECT_EQ(std::vector<uint32>({1, 1}), weights);
+
+  // Every member keeps at least one slot.
+  weights = {1, 1, 1000};
+  EXPECT_OK(ApproximateWcmpWeights(4, &weights));
+  EXPECT_EQ(std::vector<uint32>({1, 1, 2}), weights);
+
+  // Too many members.
+  weights = {1, 1, 1};
+  EXPECT_FALSE(ApproximateWcmpWeights(2, &weights).ok());
+}
+
 }  // namespace bcm
 }  // namespace hal
 }  // namespace stratum
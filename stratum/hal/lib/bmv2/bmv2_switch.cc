@@ -165,6 +165,32 @@ Bmv2Switch::~Bmv2Switch() {}
   return pi_node->UnregisterPacketReceiveWriter();
 }
 
+::util::Status Bmv2Switch::RegisterDigestReceiveWriter(
+    uint64 node_id,
+    std::shared_ptr<WriterInterface<::p4::v1::DigestList>> writer) {
+  ASSIGN_OR_RETURN(auto* pi_node, GetPINodeFromNodeId(node_id));
+  return pi_node->RegisterDigestReceiveWriter(writer);
+}
+
+::util::Status Bmv2Switch::UnregisterDigestReceiveWriter(uint64 node_id) {
+  ASSIGN_OR_RETURN(auto* pi_node, GetPINodeFromNodeId(node_id));
+  return pi_node->UnregisterDigestReceiveWriter();
+}
+
+::util::Status Bmv2Switch::RegisterIdleTimeoutNotificationWriter(
+    uint64 node_id,
+    std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>
+        writer) {
+  ASSIGN_OR_RETURN(auto* pi_node, GetPINodeFromNodeId(node_id));
+  return pi_node->RegisterIdleTimeoutNotificationWriter(writer);
+}
+
+::util::Status Bmv2Switch::UnregisterIdleTimeoutNotificationWriter(
+    uint64 node_id) {
+  ASSIGN_OR_RETURN(auto* pi_node, GetPINodeFromNodeId(node_id));
+  return pi_node->UnregisterIdleTimeoutNotificationWriter();
+}
+
 ::util::Status Bmv2Switch::TransmitPacket(uint64 node_id,
                                         const ::p4::v1::PacketOut& packet) {
   ASSIGN_OR_RETURN(auto* pi_node, GetPINodeFromNodeId(node_id));
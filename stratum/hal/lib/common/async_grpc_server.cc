@@ -0,0 +1,141 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/common/async_grpc_server.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+
+CompletionQueuePool::CompletionQueuePool(::grpc::ServerBuilder* builder,
+                                         const Options& options)
+    : options_(options),
+      queues_(),
+      pollers_(),
+      handler_threads_(),
+      shutdown_(false),
+      handlers_(),
+      handlers_running_(false) {
+  for (int i = 0; i < options_.num_completion_queues; ++i) {
+    queues_.push_back(builder->AddCompletionQueue());
+  }
+}
+
+CompletionQueuePool::~CompletionQueuePool() { Shutdown(); }
+
+::util::Status CompletionQueuePool::Start() {
+  CHECK_RETURN_IF_FALSE(pollers_.empty())
+      << "The completion queue pollers are already started.";
+  CHECK_RETURN_IF_FALSE(!queues_.empty() && options_.pollers_per_queue > 0)
+      << "Invalid number of completion queues or pollers.";
+  CHECK_RETURN_IF_FALSE(options_.num_handler_threads > 0)
+      << "Invalid number of handler threads.";
+  {
+    absl::MutexLock l(&handler_lock_);
+    handlers_running_ = true;
+  }
+  for (int i = 0; i < options_.num_handler_threads; ++i) {
+    handler_threads_.emplace_back(&CompletionQueuePool::RunHandlers, this);
+  }
+  const int num_cores = std::thread::hardware_concurrency();
+  for (int i = 0; i < options_.pollers_per_queue; ++i) {
+    for (const auto& queue : queues_) {
+      pollers_.emplace_back(&CompletionQueuePool::Poll, queue.get());
+      if (!options_.pin_pollers_to_cores || num_cores <= 0) continue;
+      int core = (pollers_.size() - 1) % num_cores;
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      CPU_SET(core, &cpu_set);
+      int ret = pthread_setaffinity_np(pollers_.back().native_handle(),
+                                       sizeof(cpu_set), &cpu_set);
+      if (ret != 0) {
+        LOG(WARNING) << "Failed to pin completion queue poller to core "
+                     << core << " with error " << ret << ".";
+      }
+    }
+  }
+  LOG(INFO) << "Started " << pollers_.size() << " pollers for "
+            << queues_.size() << " completion queues and "
+            << handler_threads_.size() << " handler threads.";
+
+  return ::util::OkStatus();
+}
+
+void CompletionQueuePool::Shutdown() {
+  if (shutdown_) return;
+  shutdown_ = true;
+  // The queued handlers send their responses on the queues, so they are run
+  // before the queues are shut down. The handlers given from now on run on
+  // the pollers.
+  {
+    absl::MutexLock l(&handler_lock_);
+    handlers_running_ = false;
+  }
+  for (auto& handler_thread : handler_threads_) handler_thread.join();
+  handler_threads_.clear();
+  for (const auto& queue : queues_) queue->Shutdown();
+  for (auto& poller : pollers_) poller.join();
+  pollers_.clear();
+  // Drains the queues in case the pollers were never started. No-op otherwise.
+  for (const auto& queue : queues_) Poll(queue.get());
+}
+
+void CompletionQueuePool::RunHandler(std::function<void()> handler) {
+  {
+    absl::MutexLock l(&handler_lock_);
+    if (handlers_running_) {
+      handlers_.push_back(std::move(handler));
+      return;
+    }
+  }
+  handler();
+}
+
+void CompletionQueuePool::RunHandlers() {
+  while (true) {
+    std::function<void()> handler;
+    {
+      absl::MutexLock l(&handler_lock_);
+      auto ready = [this]() {
+        handler_lock_.AssertHeld();
+        return !handlers_.empty() || !handlers_running_;
+      };
+      handler_lock_.Await(absl::Condition(&ready));
+      // The pending handlers are drained before the thread exits.
+      if (handlers_.empty()) return;
+      handler = std::move(handlers_.front());
+      handlers_.pop_front();
+    }
+    handler();
+  }
+}
+
+void CompletionQueuePool::Poll(::grpc::ServerCompletionQueue* queue) {
+  void* tag;
+  bool ok;
+  // Next() returns false once the queue is shut down and drained.
+  while (queue->Next(&tag, &ok)) {
+    static_cast<AsyncCallTag*>(tag)->Proceed(ok);
+  }
+}
+
+}  // namespace hal
+}  // namespace stratum
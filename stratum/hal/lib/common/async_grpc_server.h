@@ -0,0 +1,570 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_HAL_LIB_COMMON_ASYNC_GRPC_SERVER_H_
+#define STRATUM_HAL_LIB_COMMON_ASYNC_GRPC_SERVER_H_
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/support/async_stream.h>
+#include <grpcpp/support/async_unary_call.h>
+#include <grpcpp/support/sync_stream.h>
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "stratum/glue/status/status.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace stratum {
+namespace hal {
+
+// The building blocks of the asynchronous gRPC server mode, in which the
+// streaming RPCs are served by state machines driven from a few completion
+// queues, instead of holding a thread of the synchronous server per stream.
+//
+// Each asynchronous operation (e.g. waiting for a new call, a read or a write
+// on a stream) is given an AsyncCallTag, whose Proceed() is called by one of
+// the CompletionQueuePool pollers once the operation is complete.
+class AsyncCallTag {
+ public:
+  virtual ~AsyncCallTag() {}
+  // Called once the operation is complete. 'ok' is false if the operation
+  // failed, e.g. the stream was closed or the server is shutting down.
+  virtual void Proceed(bool ok) = 0;
+};
+
+// CompletionQueuePool owns the completion queues of the asynchronous server,
+// the threads polling them and the threads running the unary RPC handlers.
+class CompletionQueuePool {
+ public:
+  struct Options {
+    Options()
+        : num_completion_queues(1),
+          pollers_per_queue(1),
+          pin_pollers_to_cores(false),
+          num_handler_threads(4) {}
+    int num_completion_queues;
+    int pollers_per_queue;
+    // If true, the pollers are pinned to the cores in a round robin fashion,
+    // so that the work of each queue stays on a warm cache.
+    bool pin_pollers_to_cores;
+    // Number of threads running the handlers given to RunHandler().
+    int num_handler_threads;
+  };
+
+  // Adds the completion queues to the builder. Must be called before the
+  // server is built.
+  CompletionQueuePool(::grpc::ServerBuilder* builder, const Options& options);
+  ~CompletionQueuePool();
+
+  // Starts the pollers and the handler threads. Must be called after the
+  // server is started, and after the asynchronous methods requested their
+  // first calls.
+  ::util::Status Start();
+
+  // Runs the handlers still queued, then shuts the queues down and waits for
+  // the pollers to drain them. Must be called after the server is shut down,
+  // as no new operation can be started on the queues afterwards.
+  void Shutdown();
+
+  // Queues a handler to be run on one of the handler threads, so that it does
+  // not hold up the poller serving the other calls of its queue. The handler
+  // runs right away on the calling thread if the handler threads are not
+  // running. Thread-safe.
+  void RunHandler(std::function<void()> handler) LOCKS_EXCLUDED(handler_lock_);
+
+  int num_completion_queues() const { return queues_.size(); }
+  ::grpc::ServerCompletionQueue* completion_queue(int i) const {
+    return queues_[i].get();
+  }
+  int num_pollers() const { return pollers_.size(); }
+
+  // CompletionQueuePool is neither copyable nor movable.
+  CompletionQueuePool(const CompletionQueuePool&) = delete;
+  CompletionQueuePool& operator=(const CompletionQueuePool&) = delete;
+
+ private:
+  // The poller threads function.
+  static void Poll(::grpc::ServerCompletionQueue* queue);
+
+  // The handler threads function.
+  void RunHandlers() LOCKS_EXCLUDED(handler_lock_);
+
+  const Options options_;
+  std::vector<std::unique_ptr<::grpc::ServerCompletionQueue>> queues_;
+  std::vector<std::thread> pollers_;
+  std::vector<std::thread> handler_threads_;
+  bool shutdown_;
+
+  absl::Mutex handler_lock_;
+  // The handlers waiting for a handler thread.
+  std::deque<std::function<void()>> handlers_ GUARDED_BY(handler_lock_);
+  // True while the handler threads are taking new handlers.
+  bool handlers_running_ GUARDED_BY(handler_lock_);
+};
+
+// AsyncUnaryCall serves one call of a unary RPC: it waits for a call, spawns
+// the AsyncUnaryCall waiting for the next one, runs the handler on one of the
+// handler threads of the pool and sends the response. The handlers can block
+// (e.g. on the switch) without holding up the streams served by the pollers.
+// It deletes itself once the call is done.
+template <typename Request, typename Response>
+class AsyncUnaryCall : public AsyncCallTag {
+ public:
+  // Requests a new call on the given queue, e.g. a wrapper around the
+  // generated RequestWrite() of a service with an asynchronous Write.
+  using RequestCallFunc = std::function<void(
+      ::grpc::ServerContext*, Request*,
+      ::grpc::ServerAsyncResponseWriter<Response>*,
+      ::grpc::ServerCompletionQueue*, void*)>;
+  // Handles the call, e.g. the synchronous implementation of the RPC.
+  using HandlerFunc = std::function<::grpc::Status(
+      ::grpc::ServerContext*, const Request*, Response*)>;
+
+  // Starts waiting for a call on the given queue of the pool.
+  static void Start(RequestCallFunc request_call, HandlerFunc handler,
+                    CompletionQueuePool* pool,
+                    ::grpc::ServerCompletionQueue* cq) {
+    auto* call = new AsyncUnaryCall(std::move(request_call),
+                                    std::move(handler), pool, cq);
+    call->request_call_(&call->context_, &call->request_, &call->responder_,
+                        cq, call);
+  }
+
+  void Proceed(bool ok) override {
+    if (!ok || finishing_) {
+      // Either the server is shutting down, or the response was sent.
+      delete this;
+      return;
+    }
+    Start(request_call_, handler_, pool_, cq_);
+    // Nothing else touches the call until the Finish operation completes.
+    pool_->RunHandler([this]() {
+      Response response;
+      ::grpc::Status status = handler_(&context_, &request_, &response);
+      finishing_ = true;
+      responder_.Finish(response, status, this);
+    });
+  }
+
+  // AsyncUnaryCall is neither copyable nor movable.
+  AsyncUnaryCall(const AsyncUnaryCall&) = delete;
+  AsyncUnaryCall& operator=(const AsyncUnaryCall&) = delete;
+
+ private:
+  AsyncUnaryCall(RequestCallFunc request_call, HandlerFunc handler,
+                 CompletionQueuePool* pool, ::grpc::ServerCompletionQueue* cq)
+      : request_call_(std::move(request_call)),
+        handler_(std::move(handler)),
+        pool_(pool),
+        cq_(cq),
+        responder_(&context_),
+        finishing_(false) {}
+
+  const RequestCallFunc request_call_;
+  const HandlerFunc handler_;
+  CompletionQueuePool* pool_;  // not owned by the class.
+  ::grpc::ServerCompletionQueue* cq_;  // not owned by the class.
+  ::grpc::ServerContext context_;
+  Request request_;
+  ::grpc::ServerAsyncResponseWriter<Response> responder_;
+  // True once the response is being sent.
+  bool finishing_;
+};
+
+// What AsyncBidiStreamCall does with a droppable message written while
+// max_pending_writes droppable messages are already queued.
+enum class AsyncStreamOverflowPolicy {
+  // Drop the oldest queued droppable message to make room for the new one.
+  kDropOldest,
+  // Drop the new message.
+  kDropNewest,
+};
+
+// AsyncBidiStreamCall is the state machine of one call of a bidirectional
+// streaming RPC. There is at most one read and one write in flight at any
+// time, as required by gRPC: the messages written with Write() are queued and
+// sent one after the other, so writing never blocks and a slow client only
+// costs memory, not a thread. Only the messages the derived class marks as
+// droppable (e.g. PacketIns) are bounded: at most max_pending_writes of them
+// are queued, the others (e.g. arbitration updates) are always queued. The
+// derived classes handle the call through OnStart(), OnRead() and OnDone(),
+// which are called from the pollers, one at a time.
+//
+// The call deletes itself once the stream is finished and no operation is in
+// flight. The writers returned by writer() can outlive it: they fail to write
+// once the call is done.
+template <typename Request, typename Response>
+class AsyncBidiStreamCall {
+ public:
+  // Requests a new call on the given queue, e.g. a wrapper around the
+  // generated RequestStreamChannel() of a service with an asynchronous
+  // StreamChannel.
+  using RequestCallFunc = std::function<void(
+      ::grpc::ServerContext*,
+      ::grpc::ServerAsyncReaderWriter<Response, Request>*,
+      ::grpc::ServerCompletionQueue*, void*)>;
+
+  virtual ~AsyncBidiStreamCall() { writer_->Detach(); }
+
+  // Queues a message to be written on the stream. Returns false if the stream
+  // is done, or if the message is droppable and dropped by the overflow
+  // policy. Thread-safe and never blocks.
+  bool Write(const Response& response) LOCKS_EXCLUDED(lock_);
+
+  // Ends the call with the given status, once the queued messages are sent.
+  // OnRead() is not called anymore. To be called from OnStart() or OnRead().
+  void Finish(const ::grpc::Status& status) LOCKS_EXCLUDED(lock_);
+
+  // Returns a writer to the stream, which can be handed to the code written
+  // against WriterInterface. It can outlive the call.
+  std::shared_ptr<WriterInterface<Response>> writer() const { return writer_; }
+
+  ::grpc::ServerContext* context() { return &context_; }
+  ::grpc::ServerCompletionQueue* completion_queue() const { return cq_; }
+
+  // AsyncBidiStreamCall is neither copyable nor movable.
+  AsyncBidiStreamCall(const AsyncBidiStreamCall&) = delete;
+  AsyncBidiStreamCall& operator=(const AsyncBidiStreamCall&) = delete;
+
+ protected:
+  AsyncBidiStreamCall(RequestCallFunc request_call,
+                      ::grpc::ServerCompletionQueue* cq,
+                      size_t max_pending_writes,
+                      AsyncStreamOverflowPolicy overflow_policy);
+
+  // Starts waiting for a call. To be called by the derived classes once they
+  // are constructed, as the callbacks can run right away on the pollers.
+  void RequestCall() LOCKS_EXCLUDED(lock_);
+
+  // Called once a client started the call. The implementations are expected
+  // to spawn a new instance here, waiting for the next call.
+  virtual void OnStart() = 0;
+
+  // Called for each message read from the stream.
+  virtual void OnRead(const Request& request) = 0;
+
+  // Called once when the stream is done, i.e. the client closed it, a write
+  // failed or Finish() was called. The writes fail from now on.
+  virtual void OnDone() = 0;
+
+  // Returns true if the message can be dropped when too many are queued. All
+  // the messages are droppable unless overridden. Called under the stream
+  // lock, so it must not call back into the stream.
+  virtual bool IsDroppable(const Response& response) const { return true; }
+
+ private:
+  // The operations a call can have in flight, at most one of each.
+  enum Operation { kRequestCall, kRead, kWrite, kFinish };
+
+  // A message waiting to be written.
+  struct PendingWrite {
+    Response response;
+    bool droppable;
+  };
+
+  // The tag given to the completion queue for each operation.
+  class OperationTag : public AsyncCallTag {
+   public:
+    OperationTag(AsyncBidiStreamCall* call, Operation operation)
+        : call_(call), operation_(operation) {}
+    void Proceed(bool ok) override { call_->OnOperationDone(operation_, ok); }
+
+   private:
+    AsyncBidiStreamCall* call_;
+    const Operation operation_;
+  };
+
+  // The writer returned by writer(), which forwards the writes to the call
+  // until it is done.
+  class StreamWriter : public WriterInterface<Response> {
+   public:
+    explicit StreamWriter(AsyncBidiStreamCall* call) : call_(call) {}
+    bool Write(const Response& msg) override LOCKS_EXCLUDED(lock_) {
+      absl::MutexLock l(&lock_);
+      return call_ != nullptr && call_->Write(msg);
+    }
+    void Detach() LOCKS_EXCLUDED(lock_) {
+      absl::MutexLock l(&lock_);
+      call_ = nullptr;
+    }
+
+   private:
+    absl::Mutex lock_;
+    AsyncBidiStreamCall* call_ GUARDED_BY(lock_);
+  };
+
+  // Drives the state machine once an operation is complete.
+  void OnOperationDone(Operation operation, bool ok) LOCKS_EXCLUDED(lock_);
+
+  // Starts the next read, or the next write if there is a queued message.
+  void StartReadLocked() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void StartWriteLocked() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Marks the stream as finishing with the given status, and starts the
+  // Finish operation if no write is pending. Returns true if the stream was
+  // not finishing already, i.e. if OnDone() needs to be called.
+  bool StartFinishLocked(const ::grpc::Status& status)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void MaybeFinishLocked() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Detaches the writers and calls OnDone().
+  void Done();
+
+  // Releases a reference to the call, and deletes it with the last one.
+  void Unref() LOCKS_EXCLUDED(lock_);
+
+  const RequestCallFunc request_call_;
+  ::grpc::ServerCompletionQueue* cq_;  // not owned by the class.
+  const size_t max_pending_writes_;
+  const AsyncStreamOverflowPolicy overflow_policy_;
+  ::grpc::ServerContext context_;
+  ::grpc::ServerAsyncReaderWriter<Response, Request> stream_;
+  OperationTag request_call_tag_;
+  OperationTag read_tag_;
+  OperationTag write_tag_;
+  OperationTag finish_tag_;
+  const std::shared_ptr<StreamWriter> writer_;
+
+  // Protects the state of the stream below, which is changed by the pollers
+  // as well as by the threads calling Write().
+  absl::Mutex lock_;
+  // The message being read, and the message being written.
+  Request read_request_;
+  Response write_response_ GUARDED_BY(lock_);
+  // The messages waiting for the write in flight to complete, and the number
+  // of droppable ones among them.
+  std::deque<PendingWrite> pending_writes_ GUARDED_BY(lock_);
+  size_t num_pending_droppable_writes_ GUARDED_BY(lock_);
+  // True once a client started the call.
+  bool started_ GUARDED_BY(lock_);
+  bool write_in_flight_ GUARDED_BY(lock_);
+  // True once the stream is finishing, i.e. no more messages are read and the
+  // Finish operation is started as soon as the queued writes are sent.
+  bool finishing_ GUARDED_BY(lock_);
+  bool finish_started_ GUARDED_BY(lock_);
+  ::grpc::Status finish_status_ GUARDED_BY(lock_);
+  // Number of operations in flight plus the callbacks being run. The call is
+  // deleted when it drops to zero.
+  int refs_ GUARDED_BY(lock_);
+};
+
+// AsyncServerReaderWriter lets the code written against the synchronous
+// streams (e.g. GnmiPublisher, which writes to a ServerReaderWriterInterface)
+// write to an asynchronous stream. Only Write() is supported, the messages
+// are read by the asynchronous call.
+template <typename W, typename R>
+class AsyncServerReaderWriter
+    : public ::grpc::ServerReaderWriterInterface<W, R> {
+ public:
+  explicit AsyncServerReaderWriter(std::shared_ptr<WriterInterface<W>> writer)
+      : writer_(std::move(writer)) {}
+
+  bool Write(const W& msg, ::grpc::WriteOptions options) override {
+    return writer_->Write(msg);
+  }
+
+  // AsyncServerReaderWriter is neither copyable nor movable.
+  AsyncServerReaderWriter(const AsyncServerReaderWriter&) = delete;
+  AsyncServerReaderWriter& operator=(const AsyncServerReaderWriter&) = delete;
+
+ private:
+  // Required by the interface but not supported. The initial metadata is sent
+  // with the first message.
+  void SendInitialMetadata() override {}
+  bool NextMessageSize(uint32_t* sz) override { return false; }
+  bool Read(R* msg) override { return false; }
+
+  const std::shared_ptr<WriterInterface<W>> writer_;
+};
+
+template <typename Request, typename Response>
+AsyncBidiStreamCall<Request, Response>::AsyncBidiStreamCall(
+    RequestCallFunc request_call, ::grpc::ServerCompletionQueue* cq,
+    size_t max_pending_writes, AsyncStreamOverflowPolicy overflow_policy)
+    : request_call_(std::move(request_call)),
+      cq_(cq),
+      max_pending_writes_(max_pending_writes),
+      overflow_policy_(overflow_policy),
+      stream_(&context_),
+      request_call_tag_(this, kRequestCall),
+      read_tag_(this, kRead),
+      write_tag_(this, kWrite),
+      finish_tag_(this, kFinish),
+      writer_(std::make_shared<StreamWriter>(this)),
+      num_pending_droppable_writes_(0),
+      started_(false),
+      write_in_flight_(false),
+      finishing_(false),
+      finish_started_(false),
+      refs_(0) {}
+
+template <typename Request, typename Response>
+void AsyncBidiStreamCall<Request, Response>::RequestCall() {
+  {
+    absl::MutexLock l(&lock_);
+    ++refs_;
+  }
+  request_call_(&context_, &stream_, cq_, &request_call_tag_);
+}
+
+template <typename Request, typename Response>
+bool AsyncBidiStreamCall<Request, Response>::Write(const Response& response) {
+  absl::MutexLock l(&lock_);
+  if (!started_ || finishing_) return false;
+  const bool droppable = IsDroppable(response);
+  if (droppable && num_pending_droppable_writes_ >= max_pending_writes_) {
+    if (overflow_policy_ == AsyncStreamOverflowPolicy::kDropNewest ||
+        num_pending_droppable_writes_ == 0) {
+      return false;
+    }
+    auto oldest = std::find_if(
+        pending_writes_.begin(), pending_writes_.end(),
+        [](const PendingWrite& write) { return write.droppable; });
+    pending_writes_.erase(oldest);
+    --num_pending_droppable_writes_;
+  }
+  pending_writes_.push_back(PendingWrite{response, droppable});
+  if (droppable) ++num_pending_droppable_writes_;
+  if (!write_in_flight_) StartWriteLocked();
+  return true;
+}
+
+template <typename Request, typename Response>
+void AsyncBidiStreamCall<Request, Response>::Finish(
+    const ::grpc::Status& status) {
+  bool done;
+  {
+    absl::MutexLock l(&lock_);
+    done = StartFinishLocked(status);
+  }
+  if (done) Done();
+}
+
+template <typename Request, typename Response>
+void AsyncBidiStreamCall<Request, Response>::OnOperationDone(
+    Operation operation, bool ok) {
+  // The reference held by the completed operation is kept until the end of
+  // the callbacks run below.
+  bool start = false, read = false, done = false;
+  {
+    absl::MutexLock l(&lock_);
+    switch (operation) {
+      case kRequestCall:
+        // Not ok if the server is shutting down before a client showed up.
+        started_ = ok;
+        start = ok;
+        break;
+      case kRead:
+        if (ok) {
+          read = !finishing_;
+        } else {
+          // The client closed the stream (or the call was cancelled). Same as
+          // the synchronous services returning once Read() fails.
+          done = StartFinishLocked(::grpc::Status::OK);
+        }
+        break;
+      case kWrite:
+        write_in_flight_ = false;
+        if (ok) {
+          if (!pending_writes_.empty()) StartWriteLocked();
+          MaybeFinishLocked();
+        } else {
+          pending_writes_.clear();
+          num_pending_droppable_writes_ = 0;
+          done = StartFinishLocked(::grpc::Status(
+              ::grpc::StatusCode::UNAVAILABLE, "Failed to write on stream."));
+          MaybeFinishLocked();
+        }
+        break;
+      case kFinish:
+        break;
+    }
+  }
+  if (start) {
+    OnStart();
+    absl::MutexLock l(&lock_);
+    if (!finishing_) StartReadLocked();
+  }
+  if (read) {
+    OnRead(read_request_);
+    absl::MutexLock l(&lock_);
+    if (!finishing_) StartReadLocked();
+  }
+  if (done) Done();
+  Unref();
+}
+
+template <typename Request, typename Response>
+void AsyncBidiStreamCall<Request, Response>::StartReadLocked() {
+  ++refs_;
+  stream_.Read(&read_request_, &read_tag_);
+}
+
+template <typename Request, typename Response>
+void AsyncBidiStreamCall<Request, Response>::StartWriteLocked() {
+  write_response_ = std::move(pending_writes_.front().response);
+  if (pending_writes_.front().droppable) --num_pending_droppable_writes_;
+  pending_writes_.pop_front();
+  write_in_flight_ = true;
+  ++refs_;
+  stream_.Write(write_response_, &write_tag_);
+}
+
+template <typename Request, typename Response>
+bool AsyncBidiStreamCall<Request, Response>::StartFinishLocked(
+    const ::grpc::Status& status) {
+  if (finishing_) return false;
+  finishing_ = true;
+  finish_status_ = status;
+  MaybeFinishLocked();
+  return true;
+}
+
+template <typename Request, typename Response>
+void AsyncBidiStreamCall<Request, Response>::MaybeFinishLocked() {
+  if (!finishing_ || finish_started_ || write_in_flight_) return;
+  finish_started_ = true;
+  ++refs_;
+  stream_.Finish(finish_status_, &finish_tag_);
+}
+
+template <typename Request, typename Response>
+void AsyncBidiStreamCall<Request, Response>::Done() {
+  writer_->Detach();
+  OnDone();
+}
+
+template <typename Request, typename Response>
+void AsyncBidiStreamCall<Request, Response>::Unref() {
+  bool last;
+  {
+    absl::MutexLock l(&lock_);
+    last = --refs_ == 0;
+  }
+  if (last) delete this;
+}
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_ASYNC_GRPC_SERVER_H_
@@ -0,0 +1,428 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/common/async_grpc_server.h"
+
+#include <chrono>  // NOLINT
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "p4/v1/p4runtime.grpc.pb.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+using ::p4::v1::P4Runtime;
+using ::p4::v1::StreamMessageRequest;
+using ::p4::v1::StreamMessageResponse;
+
+// Max number of PacketIns queued on each stream of the EchoService.
+constexpr int kMaxPendingWrites = 4;
+
+// Device ID of the Write requests blocked until ReleaseWrites() is called.
+constexpr int kBlockedWriteDeviceId = 2;
+
+// A P4Runtime service serving StreamChannel and Write asynchronously.
+// StreamChannel echoes the arbitration updates, and fails the stream on a
+// zero device ID. Only the PacketIns it sends are droppable. Write fails the
+// requests with a zero device ID.
+class EchoService final
+    : public P4Runtime::WithAsyncMethod_StreamChannel<
+          P4Runtime::WithAsyncMethod_Write<P4Runtime::Service>> {
+ public:
+  EchoService()
+      : overflow_policy_(AsyncStreamOverflowPolicy::kDropNewest),
+        num_started_(0),
+        num_done_(0) {}
+
+  // Sets the overflow policy of the streams. To be called before Start().
+  void set_overflow_policy(AsyncStreamOverflowPolicy overflow_policy) {
+    overflow_policy_ = overflow_policy;
+  }
+
+  void Start(CompletionQueuePool* pool) {
+    for (int i = 0; i < pool->num_completion_queues(); ++i) {
+      EchoCall::Create(this, pool->completion_queue(i));
+      StartWriteCall(pool, pool->completion_queue(i));
+    }
+  }
+
+  // Unblocks the Write requests with kBlockedWriteDeviceId.
+  void ReleaseWrites() { release_writes_.Notify(); }
+
+  // Waits until the given number of streams are done.
+  void WaitForDoneStreams(int num_done) {
+    absl::MutexLock l(&lock_);
+    auto done = [this, num_done]() {
+      lock_.AssertHeld();
+      return num_done_ >= num_done;
+    };
+    lock_.Await(absl::Condition(&done));
+  }
+
+  // Returns the writer of the last started stream.
+  std::shared_ptr<WriterInterface<StreamMessageResponse>> last_writer() {
+    absl::MutexLock l(&lock_);
+    return last_writer_;
+  }
+
+  // Returns the results of the writes done by the last started stream when it
+  // started, i.e. before any of them could be sent.
+  std::vector<bool> initial_write_results() {
+    absl::MutexLock l(&lock_);
+    return initial_write_results_;
+  }
+
+  int num_started() {
+    absl::MutexLock l(&lock_);
+    return num_started_;
+  }
+
+ private:
+  class EchoCall
+      : public AsyncBidiStreamCall<StreamMessageRequest,
+                                   StreamMessageResponse> {
+   public:
+    static void Create(EchoService* service,
+                       ::grpc::ServerCompletionQueue* cq) {
+      (new EchoCall(service, cq))->RequestCall();
+    }
+
+   private:
+    EchoCall(EchoService* service, ::grpc::ServerCompletionQueue* cq)
+        : AsyncBidiStreamCall(
+              [service](::grpc::ServerContext* context,
+                        ::grpc::ServerAsyncReaderWriter<StreamMessageResponse,
+                                                        StreamMessageRequest>*
+                            stream,
+                        ::grpc::ServerCompletionQueue* cq, void* tag) {
+                service->RequestStreamChannel(context, stream, cq, cq, tag);
+              },
+              cq, kMaxPendingWrites, service->overflow_policy_),
+          service_(service) {}
+
+    bool IsDroppable(const StreamMessageResponse& resp) const override {
+      return resp.has_packet();
+    }
+
+    void OnStart() override {
+      Create(service_, completion_queue());
+      // One write in flight plus kMaxPendingWrites queued PacketIns, as the
+      // write in flight cannot complete before this callback returns. The
+      // last PacketIn overflows the queue, while the arbitration update is
+      // queued anyway.
+      std::vector<bool> results;
+      for (int i = 0; i < kMaxPendingWrites + 2; ++i) {
+        StreamMessageResponse resp;
+        resp.mutable_packet()->set_payload(std::to_string(i));
+        results.push_back(Write(resp));
+      }
+      StreamMessageResponse resp;
+      resp.mutable_arbitration()->set_device_id(100);
+      results.push_back(Write(resp));
+      absl::MutexLock l(&service_->lock_);
+      ++service_->num_started_;
+      service_->last_writer_ = writer();
+      service_->initial_write_results_ = results;
+    }
+
+    void OnRead(const StreamMessageRequest& req) override {
+      if (req.arbitration().device_id() == 0) {
+        Finish(::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT,
+                              "Invalid device ID."));
+        return;
+      }
+      StreamMessageResponse resp;
+      *resp.mutable_arbitration() = req.arbitration();
+      EXPECT_TRUE(Write(resp));
+    }
+
+    void OnDone() override {
+      absl::MutexLock l(&service_->lock_);
+      ++service_->num_done_;
+    }
+
+    EchoService* service_;
+  };
+
+  void StartWriteCall(CompletionQueuePool* pool,
+                      ::grpc::ServerCompletionQueue* cq) {
+    AsyncUnaryCall<::p4::v1::WriteRequest, ::p4::v1::WriteResponse>::Start(
+        [this](::grpc::ServerContext* context, ::p4::v1::WriteRequest* req,
+               ::grpc::ServerAsyncResponseWriter<::p4::v1::WriteResponse>*
+                   responder,
+               ::grpc::ServerCompletionQueue* cq, void* tag) {
+          RequestWrite(context, req, responder, cq, cq, tag);
+        },
+        [this](::grpc::ServerContext* context,
+               const ::p4::v1::WriteRequest* req,
+               ::p4::v1::WriteResponse* resp) {
+          if (req->device_id() == 0) {
+            return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT,
+                                  "Invalid device ID.");
+          }
+          if (req->device_id() == kBlockedWriteDeviceId) {
+            release_writes_.WaitForNotification();
+          }
+          return ::grpc::Status::OK;
+        },
+        pool, cq);
+  }
+
+  AsyncStreamOverflowPolicy overflow_policy_;
+  absl::Notification release_writes_;
+  absl::Mutex lock_;
+  int num_started_ GUARDED_BY(lock_);
+  int num_done_ GUARDED_BY(lock_);
+  std::shared_ptr<WriterInterface<StreamMessageResponse>> last_writer_
+      GUARDED_BY(lock_);
+  std::vector<bool> initial_write_results_ GUARDED_BY(lock_);
+};
+
+class AsyncGrpcServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ::grpc::ServerBuilder builder;
+    builder.RegisterService(&service_);
+    CompletionQueuePool::Options options;
+    options.num_completion_queues = 2;
+    pool_ = absl::make_unique<CompletionQueuePool>(&builder, options);
+    server_ = builder.BuildAndStart();
+    ASSERT_NE(nullptr, server_);
+    service_.Start(pool_.get());
+    ASSERT_OK(pool_->Start());
+    EXPECT_EQ(2, pool_->num_pollers());
+    stub_ = P4Runtime::NewStub(
+        server_->InProcessChannel(::grpc::ChannelArguments()));
+  }
+
+  void TearDown() override {
+    server_->Shutdown(std::chrono::system_clock::now());
+    pool_->Shutdown();
+  }
+
+  // Reads the messages the EchoService writes when a stream starts, i.e. all
+  // the PacketIns but the dropped one, followed by the arbitration update.
+  void ReadInitialResponses(
+      ::grpc::ClientReaderWriter<StreamMessageRequest, StreamMessageResponse>*
+          stream,
+      int dropped_packet = kMaxPendingWrites + 1) {
+    StreamMessageResponse resp;
+    for (int i = 0; i < kMaxPendingWrites + 2; ++i) {
+      if (i == dropped_packet) continue;
+      ASSERT_TRUE(stream->Read(&resp));
+      EXPECT_EQ(std::to_string(i), resp.packet().payload());
+    }
+    ASSERT_TRUE(stream->Read(&resp));
+    EXPECT_EQ(100, resp.arbitration().device_id());
+  }
+
+  EchoService service_;
+  std::unique_ptr<CompletionQueuePool> pool_;
+  std::unique_ptr<::grpc::Server> server_;
+  std::unique_ptr<P4Runtime::Stub> stub_;
+};
+
+TEST_F(AsyncGrpcServerTest, UnaryCalls) {
+  for (int i = 0; i < 10; ++i) {
+    ::grpc::ClientContext context;
+    ::p4::v1::WriteRequest req;
+    ::p4::v1::WriteResponse resp;
+    req.set_device_id(i % 2);
+    ::grpc::Status status = stub_->Write(&context, req, &resp);
+    if (i % 2) {
+      EXPECT_TRUE(status.ok()) << status.error_message();
+    } else {
+      EXPECT_EQ(::grpc::StatusCode::INVALID_ARGUMENT, status.error_code());
+      EXPECT_EQ("Invalid device ID.", status.error_message());
+    }
+  }
+}
+
+TEST_F(AsyncGrpcServerTest, BlockedUnaryCallsDoNotHoldUpStreams) {
+  // One blocked Write per poller.
+  std::vector<std::thread> clients;
+  for (int i = 0; i < pool_->num_pollers(); ++i) {
+    clients.emplace_back([this]() {
+      ::grpc::ClientContext context;
+      ::p4::v1::WriteRequest req;
+      ::p4::v1::WriteResponse resp;
+      req.set_device_id(kBlockedWriteDeviceId);
+      EXPECT_TRUE(stub_->Write(&context, req, &resp).ok());
+    });
+  }
+  // The streams and the other Writes are still served.
+  {
+    ::grpc::ClientContext context;
+    auto stream = stub_->StreamChannel(&context);
+    ReadInitialResponses(stream.get());
+    StreamMessageRequest req;
+    req.mutable_arbitration()->set_device_id(1);
+    ASSERT_TRUE(stream->Write(req));
+    StreamMessageResponse resp;
+    ASSERT_TRUE(stream->Read(&resp));
+    EXPECT_EQ(1, resp.arbitration().device_id());
+    stream->WritesDone();
+    EXPECT_TRUE(stream->Finish().ok());
+  }
+  {
+    ::grpc::ClientContext context;
+    ::p4::v1::WriteRequest req;
+    ::p4::v1::WriteResponse resp;
+    req.set_device_id(1);
+    EXPECT_TRUE(stub_->Write(&context, req, &resp).ok());
+  }
+  service_.ReleaseWrites();
+  for (auto& client : clients) client.join();
+}
+
+TEST_F(AsyncGrpcServerTest, StreamEchoesInOrderUntilClientCloses) {
+  ::grpc::ClientContext context;
+  auto stream = stub_->StreamChannel(&context);
+  ReadInitialResponses(stream.get());
+  for (int i = 1; i <= 100; ++i) {
+    StreamMessageRequest req;
+    req.mutable_arbitration()->set_device_id(i);
+    ASSERT_TRUE(stream->Write(req));
+    StreamMessageResponse resp;
+    ASSERT_TRUE(stream->Read(&resp));
+    EXPECT_EQ(i, resp.arbitration().device_id());
+  }
+  ASSERT_TRUE(stream->WritesDone());
+  ::grpc::Status status = stream->Finish();
+  EXPECT_TRUE(status.ok()) << status.error_message();
+  service_.WaitForDoneStreams(1);
+}
+
+TEST_F(AsyncGrpcServerTest, NewestPacketDroppedWhenTooManyArePending) {
+  ::grpc::ClientContext context;
+  auto stream = stub_->StreamChannel(&context);
+  ReadInitialResponses(stream.get());
+  std::vector<bool> expected(kMaxPendingWrites + 1, true);
+  expected.push_back(false);  // The last PacketIn.
+  expected.push_back(true);   // The arbitration update.
+  EXPECT_EQ(expected, service_.initial_write_results());
+  stream->WritesDone();
+  EXPECT_TRUE(stream->Finish().ok());
+}
+
+TEST_F(AsyncGrpcServerTest, ServerFinishesStreamWithError) {
+  ::grpc::ClientContext context;
+  auto stream = stub_->StreamChannel(&context);
+  ReadInitialResponses(stream.get());
+  StreamMessageRequest req;
+  req.mutable_arbitration()->set_device_id(1);
+  ASSERT_TRUE(stream->Write(req));
+  req.mutable_arbitration()->set_device_id(0);
+  ASSERT_TRUE(stream->Write(req));
+  // The echo of the first request is sent before the stream is finished.
+  StreamMessageResponse resp;
+  ASSERT_TRUE(stream->Read(&resp));
+  EXPECT_EQ(1, resp.arbitration().device_id());
+  EXPECT_FALSE(stream->Read(&resp));
+  ::grpc::Status status = stream->Finish();
+  EXPECT_EQ(::grpc::StatusCode::INVALID_ARGUMENT, status.error_code());
+  EXPECT_EQ("Invalid device ID.", status.error_message());
+  service_.WaitForDoneStreams(1);
+}
+
+TEST_F(AsyncGrpcServerTest, WriterOutlivesStream) {
+  {
+    ::grpc::ClientContext context;
+    auto stream = stub_->StreamChannel(&context);
+    ReadInitialResponses(stream.get());
+    // Writes from another thread than the pollers are sent too.
+    StreamMessageResponse resp;
+    resp.mutable_arbitration()->set_device_id(42);
+    EXPECT_TRUE(service_.last_writer()->Write(resp));
+    ASSERT_TRUE(stream->Read(&resp));
+    EXPECT_EQ(42, resp.arbitration().device_id());
+    context.TryCancel();
+    stream->Finish();
+  }
+  service_.WaitForDoneStreams(1);
+  StreamMessageResponse resp;
+  EXPECT_FALSE(service_.last_writer()->Write(resp));
+}
+
+TEST_F(AsyncGrpcServerTest, ConcurrentStreams) {
+  constexpr int kNumStreams = 50;
+  std::vector<std::unique_ptr<::grpc::ClientContext>> contexts;
+  std::vector<std::unique_ptr<
+      ::grpc::ClientReaderWriter<StreamMessageRequest, StreamMessageResponse>>>
+      streams;
+  for (int i = 0; i < kNumStreams; ++i) {
+    contexts.push_back(absl::make_unique<::grpc::ClientContext>());
+    streams.push_back(stub_->StreamChannel(contexts.back().get()));
+  }
+  for (int i = 0; i < kNumStreams; ++i) {
+    ReadInitialResponses(streams[i].get());
+    StreamMessageRequest req;
+    req.mutable_arbitration()->set_device_id(i + 1);
+    ASSERT_TRUE(streams[i]->Write(req));
+  }
+  for (int i = 0; i < kNumStreams; ++i) {
+    StreamMessageResponse resp;
+    ASSERT_TRUE(streams[i]->Read(&resp));
+    EXPECT_EQ(i + 1, resp.arbitration().device_id());
+    streams[i]->WritesDone();
+    EXPECT_TRUE(streams[i]->Finish().ok());
+  }
+  EXPECT_EQ(kNumStreams, service_.num_started());
+  service_.WaitForDoneStreams(kNumStreams);
+}
+
+TEST_F(AsyncGrpcServerTest, ShutdownWithOpenStreams) {
+  ::grpc::ClientContext context;
+  auto stream = stub_->StreamChannel(&context);
+  ReadInitialResponses(stream.get());
+  // The server cancels the stream, which ends the call on the pollers.
+  server_->Shutdown(std::chrono::system_clock::now());
+  service_.WaitForDoneStreams(1);
+  StreamMessageResponse resp;
+  EXPECT_FALSE(stream->Read(&resp));
+  EXPECT_FALSE(stream->Finish().ok());
+}
+
+class AsyncGrpcServerDropOldestTest : public AsyncGrpcServerTest {
+ protected:
+  void SetUp() override {
+    service_.set_overflow_policy(AsyncStreamOverflowPolicy::kDropOldest);
+    AsyncGrpcServerTest::SetUp();
+  }
+};
+
+TEST_F(AsyncGrpcServerDropOldestTest,
+       OldestPacketDroppedWhenTooManyArePending) {
+  ::grpc::ClientContext context;
+  auto stream = stub_->StreamChannel(&context);
+  // The first PacketIn is in flight, so the second one is the oldest queued.
+  ReadInitialResponses(stream.get(), /*dropped_packet=*/1);
+  std::vector<bool> expected(kMaxPendingWrites + 3, true);
+  EXPECT_EQ(expected, service_.initial_write_results());
+  stream->WritesDone();
+  EXPECT_TRUE(stream->Finish().ok());
+}
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,249 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/common/async_services.h"
+
+#include <memory>
+
+#include "gflags/gflags.h"
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/hal/lib/common/packet_in_queue.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+#include "absl/memory/memory.h"
+
+DECLARE_int32(packet_in_queue_size);
+DECLARE_string(packet_in_overflow_policy);
+DEFINE_int32(gnmi_subscribe_max_pending_writes, 1024,
+             "Max number of SubscribeResponses queued on a gNMI Subscribe "
+             "stream served by the asynchronous gRPC server. Updates are "
+             "dropped when a subscriber is too slow to read them.");
+
+namespace stratum {
+namespace hal {
+
+// The state machine of a StreamChannel call. The PacketIns are queued by the
+// stream itself (up to packet_in_queue_size, dropped according to
+// packet_in_overflow_policy), so there is no PacketInQueue and no thread per
+// stream. The other messages (arbitration updates, errors, digests, etc.) are
+// never dropped.
+class AsyncP4Service::StreamChannelCall
+    : public AsyncBidiStreamCall<::p4::v1::StreamMessageRequest,
+                                 ::p4::v1::StreamMessageResponse> {
+ public:
+  // Starts waiting for a StreamChannel call on the given queue.
+  static void Create(AsyncP4Service* service,
+                     ::grpc::ServerCompletionQueue* cq) {
+    (new StreamChannelCall(service, cq))->RequestCall();
+  }
+
+ private:
+  using Stream = ::grpc::ServerAsyncReaderWriter<
+      ::p4::v1::StreamMessageResponse, ::p4::v1::StreamMessageRequest>;
+
+  StreamChannelCall(AsyncP4Service* service, ::grpc::ServerCompletionQueue* cq)
+      : AsyncBidiStreamCall(
+            [service](::grpc::ServerContext* context, Stream* stream,
+                      ::grpc::ServerCompletionQueue* cq, void* tag) {
+              service->RequestStreamChannel(context, stream, cq, cq, tag);
+            },
+            cq, FLAGS_packet_in_queue_size,
+            service->packet_in_overflow_policy_),
+        service_(service),
+        state_() {}
+
+  bool IsDroppable(
+      const ::p4::v1::StreamMessageResponse& resp) const override {
+    return resp.has_packet();
+  }
+
+  void OnStart() override {
+    Create(service_, completion_queue());
+    ::grpc::Status status =
+        service_->p4_service_->StartStreamChannel(context(), writer(), &state_);
+    if (!status.ok()) Finish(status);
+  }
+
+  void OnRead(const ::p4::v1::StreamMessageRequest& req) override {
+    ::grpc::Status status =
+        service_->p4_service_->HandleStreamMessageRequest(req, &state_);
+    if (!status.ok()) Finish(status);
+  }
+
+  void OnDone() override { service_->p4_service_->EndStreamChannel(&state_); }
+
+  AsyncP4Service* service_;  // not owned by the class.
+  P4Service::StreamChannelState state_;
+};
+
+AsyncP4Service::AsyncP4Service(
+    P4Service* p4_service, AsyncStreamOverflowPolicy packet_in_overflow_policy)
+    : p4_service_(CHECK_NOTNULL(p4_service)),
+      packet_in_overflow_policy_(packet_in_overflow_policy) {}
+
+::util::StatusOr<std::unique_ptr<AsyncP4Service>>
+AsyncP4Service::CreateInstance(P4Service* p4_service) {
+  ASSIGN_OR_RETURN(
+      PacketInQueue::OverflowPolicy policy,
+      PacketInQueue::ParseOverflowPolicy(FLAGS_packet_in_overflow_policy));
+  CHECK_RETURN_IF_FALSE(FLAGS_packet_in_queue_size > 0)
+      << "Invalid packet_in_queue_size " << FLAGS_packet_in_queue_size << ".";
+  AsyncStreamOverflowPolicy async_policy;
+  switch (policy) {
+    case PacketInQueue::OverflowPolicy::kDropOldest:
+      async_policy = AsyncStreamOverflowPolicy::kDropOldest;
+      break;
+    case PacketInQueue::OverflowPolicy::kDropNewest:
+      async_policy = AsyncStreamOverflowPolicy::kDropNewest;
+      break;
+    default:
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "packet_in_overflow_policy '"
+             << FLAGS_packet_in_overflow_policy
+             << "' is not supported with grpc_async_server.";
+  }
+
+  return absl::WrapUnique(new AsyncP4Service(p4_service, async_policy));
+}
+
+void AsyncP4Service::Start(CompletionQueuePool* pool) {
+  for (int i = 0; i < pool->num_completion_queues(); ++i) {
+    StreamChannelCall::Create(this, pool->completion_queue(i));
+    StartWriteCall(pool, pool->completion_queue(i));
+  }
+}
+
+void AsyncP4Service::StartWriteCall(CompletionQueuePool* pool,
+                                    ::grpc::ServerCompletionQueue* cq) {
+  // Write does not stream, but holding a thread per call would let a burst of
+  // controllers writing at once take all the threads of the server. The
+  // handler runs on the handler threads of the pool, as P4Service::Write()
+  // blocks on the switch.
+  AsyncUnaryCall<::p4::v1::WriteRequest, ::p4::v1::WriteResponse>::Start(
+      [this](::grpc::ServerContext* context, ::p4::v1::WriteRequest* req,
+             ::grpc::ServerAsyncResponseWriter<::p4::v1::WriteResponse>*
+                 responder,
+             ::grpc::ServerCompletionQueue* cq, void* tag) {
+        RequestWrite(context, req, responder, cq, cq, tag);
+      },
+      [this](::grpc::ServerContext* context, const ::p4::v1::WriteRequest* req,
+             ::p4::v1::WriteResponse* resp) {
+        return p4_service_->Write(context, req, resp);
+      },
+      pool, cq);
+}
+
+::grpc::Status AsyncP4Service::Read(
+    ::grpc::ServerContext* context, const ::p4::v1::ReadRequest* req,
+    ::grpc::ServerWriter<::p4::v1::ReadResponse>* writer) {
+  return p4_service_->Read(context, req, writer);
+}
+
+::grpc::Status AsyncP4Service::SetForwardingPipelineConfig(
+    ::grpc::ServerContext* context,
+    const ::p4::v1::SetForwardingPipelineConfigRequest* req,
+    ::p4::v1::SetForwardingPipelineConfigResponse* resp) {
+  return p4_service_->SetForwardingPipelineConfig(context, req, resp);
+}
+
+::grpc::Status AsyncP4Service::GetForwardingPipelineConfig(
+    ::grpc::ServerContext* context,
+    const ::p4::v1::GetForwardingPipelineConfigRequest* req,
+    ::p4::v1::GetForwardingPipelineConfigResponse* resp) {
+  return p4_service_->GetForwardingPipelineConfig(context, req, resp);
+}
+
+// The state machine of a Subscribe call. GnmiPublisher writes the updates to
+// an AsyncServerReaderWriter, which queues them on the stream.
+class AsyncConfigMonitoringService::SubscribeCall
+    : public AsyncBidiStreamCall<::gnmi::SubscribeRequest,
+                                 ::gnmi::SubscribeResponse> {
+ public:
+  // Starts waiting for a Subscribe call on the given queue.
+  static void Create(AsyncConfigMonitoringService* service,
+                     ::grpc::ServerCompletionQueue* cq) {
+    (new SubscribeCall(service, cq))->RequestCall();
+  }
+
+ private:
+  using Stream = ::grpc::ServerAsyncReaderWriter<::gnmi::SubscribeResponse,
+                                                 ::gnmi::SubscribeRequest>;
+
+  SubscribeCall(AsyncConfigMonitoringService* service,
+                ::grpc::ServerCompletionQueue* cq)
+      : AsyncBidiStreamCall(
+            [service](::grpc::ServerContext* context, Stream* stream,
+                      ::grpc::ServerCompletionQueue* cq, void* tag) {
+              service->RequestSubscribe(context, stream, cq, cq, tag);
+            },
+            cq, FLAGS_gnmi_subscribe_max_pending_writes,
+            AsyncStreamOverflowPolicy::kDropNewest),
+        service_(service),
+        stream_(),
+        state_() {}
+
+  void OnStart() override {
+    Create(service_, completion_queue());
+    stream_ = absl::make_unique<AsyncServerReaderWriter<
+        ::gnmi::SubscribeResponse, ::gnmi::SubscribeRequest>>(writer());
+  }
+
+  void OnRead(const ::gnmi::SubscribeRequest& req) override {
+    ::grpc::Status status =
+        service_->config_monitoring_service_->HandleAsyncSubscribeRequest(
+            context(), req, stream_.get(), &state_);
+    if (!status.ok()) Finish(status);
+  }
+
+  void OnDone() override {
+    service_->config_monitoring_service_->EndAsyncSubscribe(&state_);
+  }
+
+  AsyncConfigMonitoringService* service_;  // not owned by the class.
+  // The stream the subscriptions write to.
+  std::unique_ptr<ServerSubscribeReaderWriterInterface> stream_;
+  ConfigMonitoringService::SubscribeState state_;
+};
+
+AsyncConfigMonitoringService::AsyncConfigMonitoringService(
+    ConfigMonitoringService* config_monitoring_service)
+    : config_monitoring_service_(CHECK_NOTNULL(config_monitoring_service)) {}
+
+void AsyncConfigMonitoringService::Start(CompletionQueuePool* pool) {
+  for (int i = 0; i < pool->num_completion_queues(); ++i) {
+    SubscribeCall::Create(this, pool->completion_queue(i));
+  }
+}
+
+::grpc::Status AsyncConfigMonitoringService::Capabilities(
+    ::grpc::ServerContext* context, const ::gnmi::CapabilityRequest* req,
+    ::gnmi::CapabilityResponse* resp) {
+  return config_monitoring_service_->Capabilities(context, req, resp);
+}
+
+::grpc::Status AsyncConfigMonitoringService::Get(
+    ::grpc::ServerContext* context, const ::gnmi::GetRequest* req,
+    ::gnmi::GetResponse* resp) {
+  return config_monitoring_service_->Get(context, req, resp);
+}
+
+::grpc::Status AsyncConfigMonitoringService::Set(
+    ::grpc::ServerContext* context, const ::gnmi::SetRequest* req,
+    ::gnmi::SetResponse* resp) {
+  return config_monitoring_service_->Set(context, req, resp);
+}
+
+}  // namespace hal
+}  // namespace stratum
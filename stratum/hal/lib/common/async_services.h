@@ -0,0 +1,133 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_HAL_LIB_COMMON_ASYNC_SERVICES_H_
+#define STRATUM_HAL_LIB_COMMON_ASYNC_SERVICES_H_
+
+#include <grpcpp/grpcpp.h>
+
+#include <memory>
+
+#include "gnmi/gnmi.grpc.pb.h"
+#include "p4/v1/p4runtime.grpc.pb.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/common/async_grpc_server.h"
+#include "stratum/hal/lib/common/config_monitoring_service.h"
+#include "stratum/hal/lib/common/p4_service.h"
+
+namespace stratum {
+namespace hal {
+
+// The P4Runtime service of the asynchronous server mode. StreamChannel and
+// Write are served from the completion queues of a CompletionQueuePool, the
+// other RPCs are served by the synchronous P4Service. gRPC does not allow
+// registering a method twice, hence this single service forwarding to
+// P4Service instead of registering P4Service next to it.
+class AsyncP4Service final
+    : public ::p4::v1::P4Runtime::WithAsyncMethod_StreamChannel<
+          ::p4::v1::P4Runtime::WithAsyncMethod_Write<
+              ::p4::v1::P4Runtime::Service>> {
+ public:
+  ~AsyncP4Service() override {}
+
+  // Factory function for creating the instance of the class. Fails if the
+  // PacketIn queue flags are not supported by the asynchronous streams, which
+  // do not implement the 'priority' overflow policy.
+  static ::util::StatusOr<std::unique_ptr<AsyncP4Service>> CreateInstance(
+      P4Service* p4_service);
+
+  // Starts waiting for StreamChannel and Write calls on every queue of the
+  // pool. To be called once the server is started.
+  void Start(CompletionQueuePool* pool);
+
+  // The synchronous RPCs, forwarded to P4Service.
+  ::grpc::Status Read(
+      ::grpc::ServerContext* context, const ::p4::v1::ReadRequest* req,
+      ::grpc::ServerWriter<::p4::v1::ReadResponse>* writer) override;
+  ::grpc::Status SetForwardingPipelineConfig(
+      ::grpc::ServerContext* context,
+      const ::p4::v1::SetForwardingPipelineConfigRequest* req,
+      ::p4::v1::SetForwardingPipelineConfigResponse* resp) override;
+  ::grpc::Status GetForwardingPipelineConfig(
+      ::grpc::ServerContext* context,
+      const ::p4::v1::GetForwardingPipelineConfigRequest* req,
+      ::p4::v1::GetForwardingPipelineConfigResponse* resp) override;
+
+  // AsyncP4Service is neither copyable nor movable.
+  AsyncP4Service(const AsyncP4Service&) = delete;
+  AsyncP4Service& operator=(const AsyncP4Service&) = delete;
+
+ private:
+  class StreamChannelCall;
+
+  // Private constructor. Use CreateInstance() to create an instance of this
+  // class.
+  AsyncP4Service(P4Service* p4_service,
+                 AsyncStreamOverflowPolicy packet_in_overflow_policy);
+
+  // Starts waiting for a Write call on the given queue of the pool.
+  void StartWriteCall(CompletionQueuePool* pool,
+                      ::grpc::ServerCompletionQueue* cq);
+
+  // Pointer to the P4Service handling the RPCs. Not owned by this class.
+  P4Service* p4_service_;
+
+  // What the StreamChannel calls drop when too many PacketIns are queued.
+  const AsyncStreamOverflowPolicy packet_in_overflow_policy_;
+};
+
+// The gNMI service of the asynchronous server mode. Subscribe is served from
+// the completion queues of a CompletionQueuePool, the other RPCs are served by
+// the synchronous ConfigMonitoringService.
+class AsyncConfigMonitoringService final
+    : public ::gnmi::gNMI::WithAsyncMethod_Subscribe<::gnmi::gNMI::Service> {
+ public:
+  explicit AsyncConfigMonitoringService(
+      ConfigMonitoringService* config_monitoring_service);
+  ~AsyncConfigMonitoringService() override {}
+
+  // Starts waiting for Subscribe calls on every queue of the pool. To be
+  // called once the server is started.
+  void Start(CompletionQueuePool* pool);
+
+  // The synchronous RPCs, forwarded to ConfigMonitoringService.
+  ::grpc::Status Capabilities(::grpc::ServerContext* context,
+                              const ::gnmi::CapabilityRequest* req,
+                              ::gnmi::CapabilityResponse* resp) override;
+  ::grpc::Status Get(::grpc::ServerContext* context,
+                     const ::gnmi::GetRequest* req,
+                     ::gnmi::GetResponse* resp) override;
+  ::grpc::Status Set(::grpc::ServerContext* context,
+                     const ::gnmi::SetRequest* req,
+                     ::gnmi::SetResponse* resp) override;
+
+  // AsyncConfigMonitoringService is neither copyable nor movable.
+  AsyncConfigMonitoringService(const AsyncConfigMonitoringService&) = delete;
+  AsyncConfigMonitoringService& operator=(
+      const AsyncConfigMonitoringService&) = delete;
+
+ private:
+  class SubscribeCall;
+
+  // Pointer to the ConfigMonitoringService handling the RPCs. Not owned by
+  // this class.
+  ConfigMonitoringService* config_monitoring_service_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_ASYNC_SERVICES_H_
@@ -377,6 +377,7 @@ constexpr int kThousandMilliseconds = 1000 /* milliseconds */;
 
 ::util::Status HandleInitialSubscribeRequest(
     GnmiPublisher* publisher, ::grpc::ServerContext* context,
+    const ::gnmi::SubscribeRequest& req,
     ServerSubscribeReaderWriterInterface* stream,
     PathToHandleMap* subscriptions, PathToHandleMap* polls) {
   // Setting send_sync_response to `true` triggers sending a notification to the
@@ -384,13 +385,6 @@ constexpr int kThousandMilliseconds = 1000 /* milliseconds */;
   // for initial ON_CHANGE values and the ONCE operation.
   bool send_sync_response = false;
   ::util::Status status;
-  ::gnmi::SubscribeRequest req;
-  if (!stream->Read(&req)) {
-    // The client called WritesDone() or the stream has been closed.
-    // Report error to the remote side.
-    ReportError("No subscription request received.", stream);
-    return MAKE_ERROR(ERR_INVALID_PARAM) << "No subscription request received.";
-  }
   if (!req.has_subscribe()) {
     // The request did not contain actual subscribe request.
     // Report error to the remote side.
@@ -435,15 +429,15 @@ constexpr int kThousandMilliseconds = 1000 /* milliseconds */;
         uint64 sample_interval = subscription.sample_interval() == 0
                                      ? kThousandMilliseconds
                                      : subscription.sample_interval();
-        uint64 heartbeat_interval = subscription.heartbeat_interval() == 0
-                                        ? kThousandMilliseconds
-                                        : subscription.heartbeat_interval();
         if (!subscription.suppress_redundant()) {
           status = publisher->SubscribePeriodic(
               Periodic(sample_interval), subscription.path(), stream, &h);
         } else {
+          // Without a heartbeat interval, the leaves are only sent when their
+          // value changes.
           status = publisher->SubscribePeriodic(
-              PeriodicWithHeartbeat(sample_interval, heartbeat_interval),
+              PeriodicWithHeartbeat(sample_interval,
+                                    subscription.heartbeat_interval()),
               subscription.path(), stream, &h);
         }
         if (status == ::util::OkStatus()) {
@@ -540,54 +534,63 @@ constexpr int kThousandMilliseconds = 1000 /* milliseconds */;
   return ::util::OkStatus();
 }
 
+// Handles the requests received after the initial subscription request, i.e.
+// polls.
+void HandleSubsequentSubscribeRequest(
+    GnmiPublisher* publisher, const ::gnmi::SubscribeRequest& req,
+    const PathToHandleMap& polls,
+    ServerSubscribeReaderWriterInterface* stream) {
+  if (req.has_subscribe()) {
+    // Invalid type of request at this stage! Such message is valid only
+    // once at the very beginning.
+    // Report error to the remote side.
+    ReportError(
+        "Invalid subscription request received. Only one per call "
+        "allowed.",
+        stream);
+  } else if (req.has_poll()) {
+    // A poll request. Get updates on all subscribed paths.
+    VLOG(1) << "poll";
+    for (const auto& mapping : polls) {
+      if (publisher->HandlePoll(mapping.second) != ::util::OkStatus()) {
+        ReportError("Error while executing POLL.", stream);
+      }
+    }
+  } else if (req.has_aliases()) {
+    // Received aliases to be created.
+    ReportError("Received an alias request. Unsupported.", stream);
+  } else {
+    // Empty request!?
+    ReportError("Received an empty request.", stream);
+  }
+}
+
 }  // namespace
 
 ::grpc::Status ConfigMonitoringService::DoSubscribe(
     GnmiPublisher* publisher, ::grpc::ServerContext* context,
     ServerSubscribeReaderWriterInterface* stream) {
-  PathToHandleMap subscriptions;
-  PathToHandleMap polls;
-  ::util::Status status;
+  SubscribeState state;
+  std::string uri = context->peer();  // remote connection uri
+  ::gnmi::SubscribeRequest req;
   // First process the subscription request. According to the spec there can be
   // only one!
-  if ((status = HandleInitialSubscribeRequest(publisher, context, stream,
-                                              &subscriptions, &polls)) !=
-      ::util::OkStatus()) {
+  if (!stream->Read(&req)) {
+    // The client called WritesDone() or the stream has been closed.
+    // Report error to the remote side.
+    ReportError("No subscription request received.", stream);
+    ::util::Status status = MAKE_ERROR(ERR_INVALID_PARAM)
+                            << "No subscription request received.";
     return ::grpc::Status(::grpc::StatusCode::INTERNAL, status.ToString());
   }
+  ::grpc::Status status =
+      HandleSubscribeRequest(publisher, context, req, stream, &state);
 
-  std::string uri = context->peer();  // remote connection uri
   // Now the only valid requests can be either POLL or ALIAS.
-  ::gnmi::SubscribeRequest req;
-  while (true) {
+  while (status.ok()) {
     if (stream->Read(&req)) {
       // All good! The message has been received! Let's process it!
-      LOG(INFO) << "Subscribe request from " << uri << " over stream " << stream
-                << ".";
-      VLOG(1) << "SubscribeRequest: " << req.ShortDebugString();
-      if (req.has_subscribe()) {
-        // Invalid type of request at this stage! Such message is valid only
-        // once at the very beginning.
-        // Report error to the remote side.
-        ReportError(
-            "Invalid subscription request received. Only one per call "
-            "allowed.",
-            stream);
-      } else if (req.has_poll()) {
-        // A poll request. Get updates on all subscribed paths.
-        VLOG(1) << "poll";
-        for (const auto& mapping : polls) {
-          if (publisher->HandlePoll(mapping.second) != ::util::OkStatus()) {
-            ReportError("Error while executing POLL.", stream);
-          }
-        }
-      } else if (req.has_aliases()) {
-        // Received aliases to be created.
-        ReportError("Received an alias request. Unsupported.", stream);
-      } else {
-        // Empty request!?
-        ReportError("Received an empty request.", stream);
-      }
+      status = HandleSubscribeRequest(publisher, context, req, stream, &state);
     } else {
       // The client called WritesDone() or the stream has been closed.
       // Now the infinite loop should be stopped - no more requests will be
@@ -598,15 +601,55 @@ constexpr int kThousandMilliseconds = 1000 /* milliseconds */;
     }
   }
 
+  EndSubscribe(publisher, &state);
+
+  return status;
+}
+
+::grpc::Status ConfigMonitoringService::HandleSubscribeRequest(
+    GnmiPublisher* publisher, ::grpc::ServerContext* context,
+    const ::gnmi::SubscribeRequest& req,
+    ServerSubscribeReaderWriterInterface* stream, SubscribeState* state) {
+  if (!state->initialized) {
+    state->initialized = true;
+    ::util::Status status = HandleInitialSubscribeRequest(
+        publisher, context, req, stream, &state->subscriptions, &state->polls);
+    if (!status.ok()) {
+      return ::grpc::Status(::grpc::StatusCode::INTERNAL, status.ToString());
+    }
+    return ::grpc::Status::OK;
+  }
+  LOG(INFO) << "Subscribe request from " << context->peer() << " over stream "
+            << stream << ".";
+  VLOG(1) << "SubscribeRequest: " << req.ShortDebugString();
+  HandleSubsequentSubscribeRequest(publisher, req, state->polls, stream);
+
+  return ::grpc::Status::OK;
+}
+
+void ConfigMonitoringService::EndSubscribe(GnmiPublisher* publisher,
+                                           SubscribeState* state) {
   // Unsubscribe and delete all subscriptions and polls. This stops scheduled
   // timers and prevents access to freed gRPC resources.
-  for (auto& subscription : subscriptions) {
+  for (auto& subscription : state->subscriptions) {
     publisher->UnSubscribe(subscription.second);
   }
-  subscriptions.clear();
-  polls.clear();
+  state->subscriptions.clear();
+  state->polls.clear();
+}
 
-  return ::grpc::Status::OK;
+::grpc::Status ConfigMonitoringService::HandleAsyncSubscribeRequest(
+    ::grpc::ServerContext* context, const ::gnmi::SubscribeRequest& req,
+    ServerSubscribeReaderWriterInterface* stream, SubscribeState* state) {
+  if (!state->initialized) {
+    RETURN_IF_NOT_AUTHORIZED(auth_policy_checker_, ConfigMonitoringService,
+                             Subscribe, context);
+  }
+  return HandleSubscribeRequest(&gnmi_publisher_, context, req, stream, state);
+}
+
+void ConfigMonitoringService::EndAsyncSubscribe(SubscribeState* state) {
+  EndSubscribe(&gnmi_publisher_, state);
 }
 
 }  // namespace hal
@@ -104,6 +104,27 @@ class ConfigMonitoringService final : public ::gnmi::gNMI::Service {
                            ServerSubscribeReaderWriter* stream) override
       LOCKS_EXCLUDED(config_lock_);
 
+  // The subscriptions and polls of a Subscribe stream.
+  struct SubscribeState {
+    SubscribeState() : initialized(false) {}
+    // True once the initial subscription request is handled.
+    bool initialized;
+    PathToHandleMap subscriptions;
+    PathToHandleMap polls;
+  };
+
+  // The steps of Subscribe(), exposed for the asynchronous server which does
+  // not hold a thread per stream (see AsyncConfigMonitoringService).
+  // HandleAsyncSubscribeRequest() is called for each message read from the
+  // stream, the first one being the subscription request. The stream is to be
+  // ended if it returns a non-OK status. EndAsyncSubscribe() cancels the
+  // subscriptions once the stream is done.
+  ::grpc::Status HandleAsyncSubscribeRequest(
+      ::grpc::ServerContext* context, const ::gnmi::SubscribeRequest& req,
+      ServerSubscribeReaderWriterInterface* stream, SubscribeState* state)
+      LOCKS_EXCLUDED(config_lock_);
+  void EndAsyncSubscribe(SubscribeState* state) LOCKS_EXCLUDED(config_lock_);
+
   // ConfigMonitoringService is neither copyable nor movable.
   ConfigMonitoringService(const ConfigMonitoringService&) = delete;
   ConfigMonitoringService& operator=(const ConfigMonitoringService&) = delete;
@@ -128,6 +149,17 @@ class ConfigMonitoringService final : public ::gnmi::gNMI::Service {
                              ServerSubscribeReaderWriterInterface* stream)
       LOCKS_EXCLUDED(config_lock_);
 
+  // Handles a message read from a Subscribe stream, and cancels the
+  // subscriptions of the stream once it is done. Shared by DoSubscribe() and
+  // the asynchronous server.
+  ::grpc::Status HandleSubscribeRequest(
+      GnmiPublisher* publisher, ::grpc::ServerContext* context,
+      const ::gnmi::SubscribeRequest& req,
+      ServerSubscribeReaderWriterInterface* stream, SubscribeState* state)
+      LOCKS_EXCLUDED(config_lock_);
+  void EndSubscribe(GnmiPublisher* publisher, SubscribeState* state)
+      LOCKS_EXCLUDED(config_lock_);
+
   // The actual method that implements 'Get' that allows a client to
   // request the switch to send it values of particular paths within the
   // config/state tree. These values are sent as a one-off
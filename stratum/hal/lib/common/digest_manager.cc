@@ -0,0 +1,269 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/common/digest_manager.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "stratum/glue/gtl/map_util.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/macros.h"
+#include "stratum/lib/metrics.h"
+#include "stratum/public/lib/error.h"
+#include "absl/time/clock.h"
+
+namespace stratum {
+namespace hal {
+
+namespace {
+
+// A max_list_size of 0 means that the lists are not limited in size, and are
+// only sent when they time out.
+bool IsBatchFull(const ::p4::v1::DigestList& batch,
+                 const ::p4::v1::DigestEntry::Config& config) {
+  return config.max_list_size() > 0 &&
+         batch.data_size() >= config.max_list_size();
+}
+
+}  // namespace
+
+DigestManager::DigestManager(
+    std::function<bool(const ::p4::v1::DigestList&)> send,
+    const Options& options)
+    : send_(std::move(send)),
+      options_(options),
+      digests_(),
+      next_list_id_(1),
+      shutdown_(false),
+      stats_() {
+  sender_thread_ = std::thread(&DigestManager::SendDigestLists, this);
+}
+
+DigestManager::~DigestManager() { Shutdown(); }
+
+::util::Status DigestManager::UpdateConfig(
+    ::p4::v1::Update::Type type, const ::p4::v1::DigestEntry& entry) {
+  CHECK_RETURN_IF_FALSE(entry.digest_id() != 0) << "Invalid digest ID 0.";
+  absl::MutexLock l(&lock_);
+  switch (type) {
+    case ::p4::v1::Update::INSERT:
+    case ::p4::v1::Update::MODIFY: {
+      auto& state = digests_[entry.digest_id()];
+      state.config = entry.config();
+      state.batch.set_digest_id(entry.digest_id());
+      break;
+    }
+    case ::p4::v1::Update::DELETE:
+      digests_.erase(entry.digest_id());
+      break;
+    default:
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Invalid update type " << type << " for digest "
+             << entry.digest_id() << ".";
+  }
+  // The new config may change the deadline of the current batch.
+  work_available_.Signal();
+
+  return ::util::OkStatus();
+}
+
+void DigestManager::ClearConfigs() {
+  absl::MutexLock l(&lock_);
+  digests_.clear();
+}
+
+bool DigestManager::Write(const ::p4::v1::DigestList& list) {
+  absl::Time now = absl::Now();
+  absl::MutexLock l(&lock_);
+  if (shutdown_) return false;
+  stats_.received += list.data_size();
+  auto it = digests_.find(list.digest_id());
+  if (it == digests_.end()) {
+    stats_.unconfigured += list.data_size();
+    return true;
+  }
+  DigestState* state = &it->second;
+  bool ready = false;
+  for (const auto& data : list.data()) {
+    std::string key = data.SerializeAsString();
+    if (state->keys.count(key)) {
+      ++stats_.duplicates;
+      continue;
+    }
+    // The batch can only be full if the pending lists are too. The digest data
+    // is dropped to make the target drop the following ones as well, instead
+    // of growing the queue.
+    if (IsBatchFull(state->batch, state->config) &&
+        !MoveBatchToPending(state)) {
+      ++stats_.dropped;
+      continue;
+    }
+    if (state->batch.data_size() == 0) {
+      state->batch_deadline =
+          now + absl::Nanoseconds(state->config.max_timeout_ns());
+    }
+    *state->batch.add_data() = data;
+    state->keys.insert(std::move(key));
+    if (IsBatchFull(state->batch, state->config) ||
+        state->config.max_timeout_ns() <= 0) {
+      ready |= MoveBatchToPending(state);
+    }
+  }
+  // A non-empty batch has a new deadline to wait for.
+  if (ready || state->batch.data_size() > 0) work_available_.Signal();
+
+  return true;
+}
+
+::util::Status DigestManager::Ack(const ::p4::v1::DigestListAck& ack) {
+  absl::MutexLock l(&lock_);
+  auto* state = gtl::FindOrNull(digests_, ack.digest_id());
+  CHECK_RETURN_IF_FALSE(state != nullptr)
+      << "Unknown digest " << ack.digest_id() << ".";
+  auto it = state->unacked.find(ack.list_id());
+  if (it == state->unacked.end()) {
+    return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+           << "List " << ack.list_id() << " of digest " << ack.digest_id()
+           << " is unknown or timed out.";
+  }
+  for (const auto& key : it->second.keys) state->keys.erase(key);
+  state->unacked.erase(it);
+  ++stats_.lists_acked;
+  // A pending list may be sent now.
+  work_available_.Signal();
+
+  return ::util::OkStatus();
+}
+
+void DigestManager::Shutdown() {
+  {
+    absl::MutexLock l(&lock_);
+    if (shutdown_) return;
+    shutdown_ = true;
+    for (const auto& e : digests_) {
+      stats_.dropped += e.second.batch.data_size();
+      for (const auto& list : e.second.pending) {
+        stats_.dropped += list.data_size();
+      }
+    }
+    digests_.clear();
+    work_available_.Signal();
+  }
+  if (sender_thread_.joinable()) sender_thread_.join();
+}
+
+DigestManager::Stats DigestManager::GetStats() const {
+  absl::MutexLock l(&lock_);
+  return stats_;
+}
+
+bool DigestManager::MoveBatchToPending(DigestState* state) {
+  if (state->batch.data_size() == 0) return true;
+  if (state->pending.size() >= options_.max_pending_lists) return false;
+  uint32 digest_id = state->batch.digest_id();
+  state->pending.push_back(std::move(state->batch));
+  state->batch.Clear();
+  state->batch.set_digest_id(digest_id);
+  return true;
+}
+
+void DigestManager::SendDigestLists() {
+  std::vector<::p4::v1::DigestList> lists;
+  absl::MutexLock l(&lock_);
+  while (!shutdown_) {
+    absl::Time now = absl::Now();
+    absl::Time next_deadline = absl::InfiniteFuture();
+    for (auto& e : digests_) {
+      DigestState* state = &e.second;
+      // The digest data of the lists which were not acked in time can be sent
+      // again.
+      for (auto it = state->unacked.begin(); it != state->unacked.end();) {
+        if (it->second.ack_deadline > now) {
+          next_deadline = std::min(next_deadline, it->second.ack_deadline);
+          ++it;
+          continue;
+        }
+        for (const auto& key : it->second.keys) state->keys.erase(key);
+        it = state->unacked.erase(it);
+        ++stats_.ack_timeouts;
+      }
+      // Fill the window of unacked lists. A batch which timed out while the
+      // pending lists were full is sent as soon as there is room for it.
+      bool batch_due =
+          state->batch.data_size() > 0 && state->batch_deadline <= now;
+      while (state->unacked.size() < options_.max_unacked_lists) {
+        if (state->pending.empty()) {
+          if (!batch_due || !MoveBatchToPending(state)) break;
+          batch_due = false;
+        }
+        ::p4::v1::DigestList list = std::move(state->pending.front());
+        state->pending.pop_front();
+        list.set_list_id(next_list_id_++);
+        list.set_timestamp(absl::ToUnixNanos(now));
+        if (state->config.ack_timeout_ns() > 0) {
+          // The list is tracked until it is acked or times out.
+          absl::Time ack_deadline =
+              now + absl::Nanoseconds(state->config.ack_timeout_ns());
+          auto& unacked = state->unacked[list.list_id()];
+          unacked.ack_deadline = ack_deadline;
+          for (const auto& data : list.data()) {
+            unacked.keys.push_back(data.SerializeAsString());
+          }
+          next_deadline = std::min(next_deadline, ack_deadline);
+        } else {
+          for (const auto& data : list.data()) {
+            state->keys.erase(data.SerializeAsString());
+          }
+        }
+        lists.push_back(std::move(list));
+      }
+      if (batch_due) MoveBatchToPending(state);
+      if (state->batch.data_size() > 0 && state->batch_deadline > now) {
+        next_deadline = std::min(next_deadline, state->batch_deadline);
+      }
+    }
+    if (!lists.empty()) {
+      // The lists are sent without the lock, so that the switch can keep on
+      // writing digests while the controller stream is busy.
+      lock_.Unlock();
+      std::vector<bool> results;
+      for (const auto& list : lists) {
+        results.push_back(send_(list));
+        METRICS_COUNTER_ADD("p4_service/digest_lists_sent", 1);
+      }
+      lock_.Lock();
+      for (size_t i = 0; i < lists.size(); ++i) {
+        if (results[i]) {
+          ++stats_.lists_sent;
+          continue;
+        }
+        ++stats_.write_failures;
+        // The controller will never ack this list.
+        auto* state = gtl::FindOrNull(digests_, lists[i].digest_id());
+        if (state == nullptr) continue;
+        auto it = state->unacked.find(lists[i].list_id());
+        if (it == state->unacked.end()) continue;
+        for (const auto& key : it->second.keys) state->keys.erase(key);
+        state->unacked.erase(it);
+      }
+      lists.clear();
+      continue;
+    }
+    work_available_.WaitWithDeadline(&lock_, next_deadline);
+  }
+}
+
+}  // namespace hal
+}  // namespace stratum
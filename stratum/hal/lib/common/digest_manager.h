@@ -0,0 +1,162 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_HAL_LIB_COMMON_DIGEST_MANAGER_H_
+#define STRATUM_HAL_LIB_COMMON_DIGEST_MANAGER_H_
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "p4/v1/p4runtime.pb.h"
+
+namespace stratum {
+namespace hal {
+
+// DigestManager streams the digests generated by a node to its master
+// controller, as DigestList messages. The switch writes the digest lists it
+// receives from the target to the manager (which is registered with
+// SwitchInterface::RegisterDigestReceiveWriter()), and the manager:
+// - batches the digest data per digest ID into lists of up to max_list_size
+//   entries, sent at the latest max_timeout_ns after their first entry, as
+//   given by the DigestEntry config of the digest.
+// - drops the digest data which is already waiting to be sent or was sent and
+//   not acked yet (nor timed out after ack_timeout_ns), so that a host learned
+//   many times before the controller handles it is reported once.
+// - sends at most max_unacked_lists lists per digest before the controller
+//   acks them. The following lists wait in a per-digest queue of up to
+//   max_pending_lists lists, after which new digest data is dropped instead of
+//   back-pressuring the target.
+// The lists are sent by a dedicated thread, so writing to the manager never
+// blocks on the controller stream.
+class DigestManager : public WriterInterface<::p4::v1::DigestList> {
+ public:
+  struct Options {
+    Options() : max_pending_lists(64), max_unacked_lists(8) {}
+    // Max number of full lists waiting to be sent, per digest.
+    size_t max_pending_lists;
+    // Max number of lists sent to the controller and not acked yet, per
+    // digest.
+    size_t max_unacked_lists;
+  };
+
+  // Counters for the digest data written to the manager, and for the lists
+  // sent to the controller.
+  struct Stats {
+    uint64 received = 0;      // digest data written by the switch
+    uint64 duplicates = 0;    // dropped as a copy of an unacked digest
+    uint64 dropped = 0;       // dropped as the queue of the digest was full
+    uint64 unconfigured = 0;  // dropped as the digest was not configured
+    uint64 lists_sent = 0;
+    uint64 lists_acked = 0;
+    uint64 ack_timeouts = 0;
+    uint64 write_failures = 0;
+  };
+
+  // Creates the manager and starts the thread sending the lists with 'send',
+  // which returns false if the list could not be written to the controller.
+  DigestManager(std::function<bool(const ::p4::v1::DigestList&)> send,
+                const Options& options);
+  ~DigestManager() override;
+
+  // Adds, modifies or removes the config of a digest, following a successful
+  // write of its DigestEntry to the switch. Removing a digest drops its
+  // pending digest data.
+  ::util::Status UpdateConfig(::p4::v1::Update::Type type,
+                              const ::p4::v1::DigestEntry& entry)
+      LOCKS_EXCLUDED(lock_);
+
+  // Removes the config of all the digests, e.g. when a new pipeline is pushed.
+  void ClearConfigs() LOCKS_EXCLUDED(lock_);
+
+  // Hands the digest data of a list generated by the target over to the
+  // manager. The list ID of the target is not used. Never blocks. Returns
+  // false only once the manager is shut down.
+  bool Write(const ::p4::v1::DigestList& list) override LOCKS_EXCLUDED(lock_);
+
+  // Handles an ack from the controller for a list previously sent.
+  ::util::Status Ack(const ::p4::v1::DigestListAck& ack) LOCKS_EXCLUDED(lock_);
+
+  // Stops the sending thread and drops all the pending digest data.
+  // Idempotent.
+  void Shutdown() LOCKS_EXCLUDED(lock_);
+
+  // Returns a snapshot of the counters.
+  Stats GetStats() const LOCKS_EXCLUDED(lock_);
+
+  // DigestManager is neither copyable nor movable.
+  DigestManager(const DigestManager&) = delete;
+  DigestManager& operator=(const DigestManager&) = delete;
+
+ private:
+  // A list sent to the controller, not acked yet.
+  struct UnackedList {
+    absl::Time ack_deadline;
+    // The serialized digest data of the list.
+    std::vector<std::string> keys;
+  };
+
+  // The state of a configured digest.
+  struct DigestState {
+    ::p4::v1::DigestEntry::Config config;
+    // The list being filled, and the time it must be sent by.
+    ::p4::v1::DigestList batch;
+    absl::Time batch_deadline;
+    // Full lists waiting for earlier lists to be acked.
+    std::deque<::p4::v1::DigestList> pending;
+    // Lists sent and not acked yet, by list ID.
+    std::map<uint64, UnackedList> unacked;
+    // The serialized digest data of all the batched, pending and unacked
+    // lists. New copies of these digests are dropped.
+    absl::flat_hash_set<std::string> keys;
+  };
+
+  // Moves the batch of the digest to its pending lists, if there is room for
+  // it. Returns false otherwise.
+  bool MoveBatchToPending(DigestState* state) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Body of the sending thread.
+  void SendDigestLists() LOCKS_EXCLUDED(lock_);
+
+  const std::function<bool(const ::p4::v1::DigestList&)> send_;
+  const Options options_;
+
+  mutable absl::Mutex lock_;
+  // Signaled whenever there may be lists to send, or an earlier deadline to
+  // wait for.
+  absl::CondVar work_available_;
+  std::map<uint32, DigestState> digests_ GUARDED_BY(lock_);
+  uint64 next_list_id_ GUARDED_BY(lock_);
+  bool shutdown_ GUARDED_BY(lock_);
+  Stats stats_ GUARDED_BY(lock_);
+
+  std::thread sender_thread_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_DIGEST_MANAGER_H_
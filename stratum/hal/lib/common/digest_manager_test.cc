@@ -0,0 +1,268 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/common/digest_manager.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+constexpr uint32 kDigestId = 1;
+
+// Records the lists sent by the manager, as a controller would.
+class FakeController {
+ public:
+  FakeController() : num_wanted_(0), fail_writes_(false) {}
+
+  bool Send(const ::p4::v1::DigestList& list) {
+    absl::MutexLock l(&lock_);
+    if (fail_writes_) return false;
+    lists_.push_back(list);
+    return true;
+  }
+
+  void FailWrites(bool fail) {
+    absl::MutexLock l(&lock_);
+    fail_writes_ = fail;
+  }
+
+  // Waits until 'n' lists have been sent and returns them.
+  std::vector<::p4::v1::DigestList> WaitForLists(size_t n) {
+    absl::MutexLock l(&lock_);
+    num_wanted_ = n;
+    lock_.AwaitWithTimeout(
+        absl::Condition(this, &FakeController::HasLists), absl::Seconds(5));
+    return lists_;
+  }
+
+  std::vector<::p4::v1::DigestList> lists() {
+    absl::MutexLock l(&lock_);
+    return lists_;
+  }
+
+ private:
+  bool HasLists() const EXCLUSIVE_LOCKS_REQUIRED(lock_) {
+    return lists_.size() >= num_wanted_;
+  }
+
+  absl::Mutex lock_;
+  size_t num_wanted_ GUARDED_BY(lock_);
+  bool fail_writes_ GUARDED_BY(lock_);
+  std::vector<::p4::v1::DigestList> lists_ GUARDED_BY(lock_);
+};
+
+// A list of digests as generated by the target, with one MAC address per
+// digest data.
+::p4::v1::DigestList Digests(const std::vector<std::string>& macs,
+                             uint32 digest_id = kDigestId) {
+  ::p4::v1::DigestList list;
+  list.set_digest_id(digest_id);
+  list.set_list_id(1234);
+  for (const auto& mac : macs) list.add_data()->set_bitstring(mac);
+  return list;
+}
+
+std::vector<std::string> Macs(const ::p4::v1::DigestList& list) {
+  std::vector<std::string> macs;
+  for (const auto& data : list.data()) macs.push_back(data.bitstring());
+  return macs;
+}
+
+::p4::v1::DigestListAck Ack(const ::p4::v1::DigestList& list) {
+  ::p4::v1::DigestListAck ack;
+  ack.set_digest_id(list.digest_id());
+  ack.set_list_id(list.list_id());
+  return ack;
+}
+
+class DigestManagerTest : public ::testing::Test {
+ protected:
+  void CreateManager(size_t max_pending_lists = 64,
+                     size_t max_unacked_lists = 8) {
+    DigestManager::Options options;
+    options.max_pending_lists = max_pending_lists;
+    options.max_unacked_lists = max_unacked_lists;
+    manager_ = absl::make_unique<DigestManager>(
+        [this](const ::p4::v1::DigestList& list) {
+          return controller_.Send(list);
+        },
+        options);
+  }
+
+  ::util::Status Configure(int32 max_list_size, absl::Duration max_timeout,
+                           absl::Duration ack_timeout) {
+    ::p4::v1::DigestEntry entry;
+    entry.set_digest_id(kDigestId);
+    entry.mutable_config()->set_max_list_size(max_list_size);
+    entry.mutable_config()->set_max_timeout_ns(
+        absl::ToInt64Nanoseconds(max_timeout));
+    entry.mutable_config()->set_ack_timeout_ns(
+        absl::ToInt64Nanoseconds(ack_timeout));
+    return manager_->UpdateConfig(::p4::v1::Update::INSERT, entry);
+  }
+
+  FakeController controller_;
+  std::unique_ptr<DigestManager> manager_;
+};
+
+TEST_F(DigestManagerTest, BatchesUpToMaxListSize) {
+  CreateManager();
+  ASSERT_OK(Configure(3, absl::Seconds(60), absl::Seconds(60)));
+  EXPECT_TRUE(manager_->Write(Digests({"a", "b"})));
+  EXPECT_TRUE(manager_->Write(Digests({"c", "d", "e", "f", "g"})));
+
+  auto lists = controller_.WaitForLists(2);
+  ASSERT_EQ(2, lists.size());
+  EXPECT_EQ(std::vector<std::string>({"a", "b", "c"}), Macs(lists[0]));
+  EXPECT_EQ(std::vector<std::string>({"d", "e", "f"}), Macs(lists[1]));
+  EXPECT_EQ(kDigestId, lists[0].digest_id());
+  EXPECT_NE(lists[0].list_id(), lists[1].list_id());
+  EXPECT_GT(lists[0].timestamp(), 0);
+  // "g" waits for more digests or for max_timeout_ns.
+  absl::SleepFor(absl::Milliseconds(20));
+  EXPECT_EQ(2, controller_.lists().size());
+}
+
+TEST_F(DigestManagerTest, SendsBatchOnTimeout) {
+  CreateManager();
+  ASSERT_OK(Configure(100, absl::Milliseconds(10), absl::Seconds(60)));
+  absl::Time start = absl::Now();
+  EXPECT_TRUE(manager_->Write(Digests({"a"})));
+  EXPECT_TRUE(manager_->Write(Digests({"b"})));
+
+  auto lists = controller_.WaitForLists(1);
+  ASSERT_EQ(1, lists.size());
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(10));
+  EXPECT_EQ(std::vector<std::string>({"a", "b"}), Macs(lists[0]));
+}
+
+TEST_F(DigestManagerTest, NoBatchingWithZeroTimeout) {
+  CreateManager();
+  ASSERT_OK(Configure(0, absl::ZeroDuration(), absl::Seconds(60)));
+  EXPECT_TRUE(manager_->Write(Digests({"a", "b"})));
+
+  auto lists = controller_.WaitForLists(2);
+  ASSERT_EQ(2, lists.size());
+  EXPECT_EQ(std::vector<std::string>({"a"}), Macs(lists[0]));
+  EXPECT_EQ(std::vector<std::string>({"b"}), Macs(lists[1]));
+}
+
+TEST_F(DigestManagerTest, DropsDuplicatesUntilAcked) {
+  CreateManager();
+  ASSERT_OK(Configure(1, absl::ZeroDuration(), absl::Seconds(60)));
+  EXPECT_TRUE(manager_->Write(Digests({"a", "a"})));
+  auto lists = controller_.WaitForLists(1);
+  ASSERT_EQ(1, lists.size());
+  EXPECT_TRUE(manager_->Write(Digests({"a"})));
+  absl::SleepFor(absl::Milliseconds(20));
+  EXPECT_EQ(1, controller_.lists().size());
+  EXPECT_EQ(2, manager_->GetStats().duplicates);
+
+  // Once acked, the same digest is reported again.
+  EXPECT_OK(manager_->Ack(Ack(lists[0])));
+  EXPECT_TRUE(manager_->Write(Digests({"a"})));
+  lists = controller_.WaitForLists(2);
+  ASSERT_EQ(2, lists.size());
+  EXPECT_EQ(std::vector<std::string>({"a"}), Macs(lists[1]));
+  EXPECT_EQ(1, manager_->GetStats().lists_acked);
+
+  // A list can only be acked once.
+  EXPECT_FALSE(manager_->Ack(Ack(lists[0])).ok());
+}
+
+TEST_F(DigestManagerTest, AckTimeoutReleasesDigests) {
+  CreateManager();
+  ASSERT_OK(Configure(1, absl::ZeroDuration(), absl::Milliseconds(10)));
+  EXPECT_TRUE(manager_->Write(Digests({"a"})));
+  ASSERT_EQ(1, controller_.WaitForLists(1).size());
+  absl::SleepFor(absl::Milliseconds(50));
+  EXPECT_EQ(1, manager_->GetStats().ack_timeouts);
+
+  EXPECT_TRUE(manager_->Write(Digests({"a"})));
+  ASSERT_EQ(2, controller_.WaitForLists(2).size());
+}
+
+TEST_F(DigestManagerTest, FlowControlAndBackpressure) {
+  // One list on the wire, one waiting for its ack, and one being filled.
+  CreateManager(/*max_pending_lists=*/1, /*max_unacked_lists=*/1);
+  ASSERT_OK(Configure(1, absl::ZeroDuration(), absl::Seconds(60)));
+  EXPECT_TRUE(manager_->Write(Digests({"a"})));
+  auto lists = controller_.WaitForLists(1);
+  ASSERT_EQ(1, lists.size());
+  EXPECT_TRUE(manager_->Write(Digests({"b", "c", "d"})));
+  absl::SleepFor(absl::Milliseconds(20));
+  EXPECT_EQ(1, controller_.lists().size());
+  auto stats = manager_->GetStats();
+  EXPECT_EQ(4, stats.received);
+  EXPECT_EQ(1, stats.dropped);
+
+  // Each ack lets the next list go.
+  EXPECT_OK(manager_->Ack(Ack(lists[0])));
+  lists = controller_.WaitForLists(2);
+  ASSERT_EQ(2, lists.size());
+  EXPECT_EQ(std::vector<std::string>({"b"}), Macs(lists[1]));
+  EXPECT_OK(manager_->Ack(Ack(lists[1])));
+  lists = controller_.WaitForLists(3);
+  ASSERT_EQ(3, lists.size());
+  EXPECT_EQ(std::vector<std::string>({"c"}), Macs(lists[2]));
+}
+
+TEST_F(DigestManagerTest, WriteFailureReleasesDigests) {
+  CreateManager();
+  ASSERT_OK(Configure(1, absl::ZeroDuration(), absl::Seconds(60)));
+  controller_.FailWrites(true);
+  EXPECT_TRUE(manager_->Write(Digests({"a"})));
+  absl::SleepFor(absl::Milliseconds(20));
+  EXPECT_EQ(1, manager_->GetStats().write_failures);
+
+  controller_.FailWrites(false);
+  EXPECT_TRUE(manager_->Write(Digests({"a"})));
+  ASSERT_EQ(1, controller_.WaitForLists(1).size());
+}
+
+TEST_F(DigestManagerTest, UnconfiguredDigestsAreDropped) {
+  CreateManager();
+  ASSERT_OK(Configure(1, absl::ZeroDuration(), absl::Seconds(60)));
+  EXPECT_TRUE(manager_->Write(Digests({"a", "b"}, kDigestId + 1)));
+  ::p4::v1::DigestEntry entry;
+  entry.set_digest_id(kDigestId);
+  ASSERT_OK(manager_->UpdateConfig(::p4::v1::Update::DELETE, entry));
+  EXPECT_TRUE(manager_->Write(Digests({"c"})));
+  absl::SleepFor(absl::Milliseconds(20));
+  EXPECT_TRUE(controller_.lists().empty());
+  EXPECT_EQ(3, manager_->GetStats().unconfigured);
+}
+
+TEST_F(DigestManagerTest, WriteFailsAfterShutdown) {
+  CreateManager();
+  ASSERT_OK(Configure(100, absl::Seconds(60), absl::Seconds(60)));
+  EXPECT_TRUE(manager_->Write(Digests({"a", "b"})));
+  manager_->Shutdown();
+  EXPECT_FALSE(manager_->Write(Digests({"c"})));
+  EXPECT_EQ(2, manager_->GetStats().dropped);
+  EXPECT_TRUE(controller_.lists().empty());
+}
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
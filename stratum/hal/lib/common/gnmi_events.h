@@ -23,6 +23,7 @@
 #include <string>
 #include <list>
 #include <set>
+#include <utility>
 
 #include "gnmi/gnmi.grpc.pb.h"
 #include "stratum/glue/status/status.h"
@@ -511,11 +512,21 @@ class EventHandlerRecord {
 
   TimerDaemon::DescriptorPtr* mutable_timer() { return &timer_; }
 
+  // Makes the handler write to 'stream', which wraps the stream to the client
+  // (e.g. to filter the responses), instead of to the stream to the client
+  // directly. The record takes the ownership of 'stream'.
+  void WrapStream(std::unique_ptr<GnmiSubscribeStream> stream) {
+    wrapping_stream_ = std::move(stream);
+    stream_ = wrapping_stream_.get();
+  }
+
  protected:
   // The handler functor. Is called every time there is an event to handle.
   GnmiEventHandler handler_;
   // A stream to the client (the controller).
   GnmiSubscribeStream* stream_;
+  // The stream set by WrapStream(), if any.
+  std::unique_ptr<GnmiSubscribeStream> wrapping_stream_;
   // Not every EventHandler is executed on timer, but some are and this is the
   // handler that is used by the timer sub-system.
   TimerDaemon::DescriptorPtr timer_;
@@ -16,19 +16,103 @@
 
 #include "stratum/hal/lib/common/gnmi_publisher.h"
 
+#include <functional>
 #include <list>
 #include <string>
 #include <utility>
 
 #include "gnmi/gnmi.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "stratum/hal/lib/common/channel_writer_wrapper.h"
 #include "stratum/hal/lib/common/yang_parse_tree_paths.h"
+#include "stratum/lib/metrics.h"
+#include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 #include "stratum/glue/gtl/map_util.h"
 
 namespace stratum {
 namespace hal {
 
+namespace {
+
+// Serializes 'message' so that equal messages give equal strings, which is not
+// guaranteed by SerializeAsString() for messages with map fields (e.g. the
+// keys of ::gnmi::PathElem).
+std::string SerializeDeterministically(
+    const ::google::protobuf::Message& message) {
+  std::string serialized;
+  {
+    ::google::protobuf::io::StringOutputStream output(&serialized);
+    ::google::protobuf::io::CodedOutputStream coded_output(&output);
+    coded_output.SetSerializationDeterministic(true);
+    message.SerializeToCodedStream(&coded_output);
+  }
+  return serialized;
+}
+
+// Returns the key of the leaf at 'path', relative to 'prefix', in the state
+// kept by SuppressRedundantGnmiSubscribeStream.
+std::string LeafKey(const ::gnmi::Path& prefix, const ::gnmi::Path& path) {
+  if (prefix.elem_size() == 0) return SerializeDeterministically(path);
+  ::gnmi::Path full_path = prefix;
+  for (const auto& elem : path.elem()) *full_path.add_elem() = elem;
+  return SerializeDeterministically(full_path);
+}
+
+}  // namespace
+
+bool SuppressRedundantGnmiSubscribeStream::Write(
+    const ::gnmi::SubscribeResponse& msg, ::grpc::WriteOptions options) {
+  if (!msg.has_update()) return stream_->Write(msg, options);
+  absl::Time now = absl::Now();
+  ::gnmi::SubscribeResponse resp = msg;
+  auto* notification = resp.mutable_update();
+  notification->clear_update();
+  int suppressed = 0;
+  {
+    absl::MutexLock l(&lock_);
+    for (const auto& update : msg.update().update()) {
+      size_t value_hash =
+          std::hash<std::string>()(SerializeDeterministically(update.val()));
+      auto ret = leaves_.emplace(LeafKey(msg.update().prefix(), update.path()),
+                                 LeafState{value_hash, now, now});
+      LeafState* leaf = &ret.first->second;
+      if (!ret.second) {
+        leaf->written_time = now;
+        bool changed = leaf->value_hash != value_hash;
+        bool heartbeat_due = heartbeat_ > absl::ZeroDuration() &&
+                             now - leaf->sent_time >= heartbeat_;
+        if (!changed && !heartbeat_due) {
+          ++suppressed;
+          continue;
+        }
+        leaf->value_hash = value_hash;
+        leaf->sent_time = now;
+      }
+      *notification->add_update() = update;
+    }
+  }
+  if (suppressed > 0) {
+    METRICS_COUNTER_ADD("gnmi/suppressed_updates", suppressed);
+  }
+  if (notification->update_size() == 0 && notification->delete__size() == 0) {
+    return true;
+  }
+  return stream_->Write(resp, options);
+}
+
+bool SuppressRedundantGnmiSubscribeStream::KnownSince(
+    const ::gnmi::Path& path, absl::Time since) const {
+  absl::MutexLock l(&lock_);
+  const LeafState* leaf =
+      gtl::FindOrNull(leaves_, LeafKey(::gnmi::Path(), path));
+  if (leaf == nullptr || leaf->written_time < since) return false;
+  return heartbeat_ <= absl::ZeroDuration() ||
+         absl::Now() - leaf->sent_time < heartbeat_;
+}
+
 GnmiPublisher::GnmiPublisher(SwitchInterface* switch_interface)
     : switch_interface_(ABSL_DIE_IF_NULL(switch_interface)),
       parse_tree_(ABSL_DIE_IF_NULL(switch_interface)),
@@ -44,6 +128,7 @@ GnmiPublisher::~GnmiPublisher() {}
 ::util::Status GnmiPublisher::HandleUpdate(
     const ::gnmi::Path& path, const ::google::protobuf::Message& val,
     CopyOnWriteChassisConfig* config) {
+  METRICS_LATENCY_SCOPE("gnmi/handle_update");
   absl::WriterMutexLock l(&access_lock_);
 
   // Map the input path to the supported one - walk the tree of known elements
@@ -63,6 +148,7 @@ GnmiPublisher::~GnmiPublisher() {}
 ::util::Status GnmiPublisher::HandleReplace(
     const ::gnmi::Path& path, const ::google::protobuf::Message& val,
     CopyOnWriteChassisConfig* config) {
+  METRICS_LATENCY_SCOPE("gnmi/handle_replace");
   absl::WriterMutexLock l(&access_lock_);
 
   // Map the input path to the supported one - walk the tree of known elements
@@ -81,6 +167,7 @@ GnmiPublisher::~GnmiPublisher() {}
 
 ::util::Status GnmiPublisher::HandleDelete(const ::gnmi::Path& path,
                                            CopyOnWriteChassisConfig* config) {
+  METRICS_LATENCY_SCOPE("gnmi/handle_delete");
   absl::WriterMutexLock l(&access_lock_);
 
   // Map the input path to the supported one - walk the tree of known elements
@@ -98,6 +185,7 @@ GnmiPublisher::~GnmiPublisher() {}
 }
 
 ::util::Status GnmiPublisher::HandleChange(const GnmiEvent& event) {
+  METRICS_LATENCY_SCOPE("gnmi/handle_change");
   absl::WriterMutexLock l(&access_lock_);
 
   ::util::Status status = event.Process();
@@ -108,6 +196,7 @@ GnmiPublisher::~GnmiPublisher() {}
 
 ::util::Status GnmiPublisher::HandleEvent(
     const GnmiEvent& event, const std::weak_ptr<EventHandlerRecord>& h) {
+  METRICS_LATENCY_SCOPE("gnmi/handle_event");
   absl::WriterMutexLock l(&access_lock_);
 
   // In order to reference a weak pointer, first it has to be used to create a
@@ -119,6 +208,7 @@ GnmiPublisher::~GnmiPublisher() {}
 }
 
 ::util::Status GnmiPublisher::HandlePoll(const SubscriptionHandle& handle) {
+  METRICS_LATENCY_SCOPE("gnmi/handle_poll");
   absl::WriterMutexLock l(&access_lock_);
 
   ::util::Status status;
@@ -138,6 +228,11 @@ GnmiPublisher::~GnmiPublisher() {}
   if (status != ::util::OkStatus()) {
     return status;
   }
+  if (freq.suppress_redundant_) {
+    // The record is not registered yet, so its stream can be safely wrapped.
+    (*h)->WrapStream(absl::make_unique<SuppressRedundantGnmiSubscribeStream>(
+        stream, freq.heartbeat_ms_));
+  }
   EventHandlerRecordPtr weak(*h);
   if (TimerDaemon::RequestPeriodicTimer(
           freq.delay_ms_, freq.period_ms_,
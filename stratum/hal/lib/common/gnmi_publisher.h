@@ -38,6 +38,7 @@
 #include "stratum/public/lib/error.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
 #include "stratum/glue/gtl/map_util.h"
 
 namespace stratum {
@@ -53,29 +54,80 @@ class Frequency {
   uint64 delay_ms_;
   uint64 period_ms_;
   uint64 heartbeat_ms_;
+  bool suppress_redundant_;
 
  protected:
-  Frequency(uint64 delay_ms, uint64 period_ms, uint64 heartbeat_ms)
+  Frequency(uint64 delay_ms, uint64 period_ms, uint64 heartbeat_ms,
+            bool suppress_redundant)
       : delay_ms_(delay_ms),
         period_ms_(period_ms),
-        heartbeat_ms_(heartbeat_ms) {}
+        heartbeat_ms_(heartbeat_ms),
+        suppress_redundant_(suppress_redundant) {}
 };
 
 // Specialization of the Frequency container to be used by subscriptions that
 // require updates every 'period_ms' milliseconds.
 class Periodic : public Frequency {
  public:
-  explicit Periodic(uint64 period_ms) : Frequency(0, period_ms, 0) {}
+  explicit Periodic(uint64 period_ms) : Frequency(0, period_ms, 0, false) {}
 };
 
 // Specialization of the Frequency container to be used by subscriptions that
 // require updates every 'period_ms' milliseconds. The current state is _only_
 // reported if there is change in the value of the node unless since last update
-// 'heartbeat_ms' milliseconds have elapsed.
+// 'heartbeat_ms' milliseconds have elapsed. A 'heartbeat_ms' of 0 means that
+// the state is only reported when it changes.
 class PeriodicWithHeartbeat : public Frequency {
  public:
   PeriodicWithHeartbeat(uint64 period_ms, uint64 heartbeat_ms)
-      : Frequency(0, period_ms, heartbeat_ms) {}
+      : Frequency(0, period_ms, heartbeat_ms, true) {}
+};
+
+// The stream used by the subscriptions created with PeriodicWithHeartbeat. It
+// wraps the stream to the client and only forwards the leaves whose value has
+// changed since they were last sent, or which were last sent at least
+// 'heartbeat_ms' milliseconds ago. Only a hash of the last value sent is kept
+// per leaf.
+class SuppressRedundantGnmiSubscribeStream : public GnmiSubscribeStream {
+ public:
+  // Does not take the ownership of 'stream'.
+  SuppressRedundantGnmiSubscribeStream(GnmiSubscribeStream* stream,
+                                       uint64 heartbeat_ms)
+      : stream_(stream), heartbeat_(absl::Milliseconds(heartbeat_ms)) {}
+
+  // Writes 'msg' to the stream to the client without its redundant updates.
+  // Nothing is written if all of them are redundant.
+  bool Write(const ::gnmi::SubscribeResponse& msg,
+             ::grpc::WriteOptions options) override LOCKS_EXCLUDED(lock_);
+
+  // Returns true if a value of the leaf at 'path' was written to the stream
+  // (sent or suppressed) after 'since' and, with a heartbeat, was last sent
+  // less than 'heartbeat_ms' milliseconds ago. The same value would then not
+  // be sent again.
+  bool KnownSince(const ::gnmi::Path& path, absl::Time since) const
+      LOCKS_EXCLUDED(lock_);
+
+ private:
+  // What is known of the last value sent for a leaf.
+  struct LeafState {
+    size_t value_hash;
+    absl::Time sent_time;
+    // When a value was last written for the leaf, even if suppressed.
+    absl::Time written_time;
+  };
+
+  // Required by the interface but not used. Made private to prevent their
+  // accidental usage.
+  void SendInitialMetadata() override { CHECK(false); }
+  bool NextMessageSize(uint32_t* sz) override { CHECK(false); }
+  bool Read(::gnmi::SubscribeRequest* msg) override { CHECK(false); }
+
+  GnmiSubscribeStream* const stream_;  // not owned by the class
+  const absl::Duration heartbeat_;
+
+  mutable absl::Mutex lock_;
+  // The state of the leaves sent on the stream, by serialized path.
+  absl::flat_hash_map<std::string, LeafState> leaves_ GUARDED_BY(lock_);
 };
 
 // The main class responsible for handling all aspects of gNMI subscriptions and
@@ -24,6 +24,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 
 using ::testing::_;
 using ::testing::DoAll;
@@ -245,6 +246,112 @@ TEST_F(SubscriptionTest, HandleTimer) {
   EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
 }
 
+// Mock implementation of RetrieveValue() that sends an admin status response
+// set to 'state'.
+auto RetrieveAdminStatus(AdminState state) {
+  return DoAll(WithArgs<2>(Invoke([state](WriterInterface<DataResponse>* w) {
+                 DataResponse resp;
+                 resp.mutable_admin_status()->set_state(state);
+                 w->Write(resp);
+               })),
+               Return(::util::OkStatus()));
+}
+
+TEST_F(SubscriptionTest, HandleTimerSuppressesRedundantUpdates) {
+  SubscribeReaderWriterMock stream;
+
+  SubscriptionHandle h;
+  ::gnmi::Path path =
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/1")(
+          "state")("admin-status")();
+  EXPECT_OK(gnmi_publisher_->SubscribePeriodic(
+      PeriodicWithHeartbeat(1000, /*heartbeat_ms=*/0), path, &stream, &h));
+
+  // The value is read on every sample, but only sent when it changes.
+  EXPECT_CALL(switch_mock_, RetrieveValue(_, _, _, _))
+      .WillOnce(RetrieveAdminStatus(ADMIN_STATE_ENABLED))
+      .WillOnce(RetrieveAdminStatus(ADMIN_STATE_ENABLED))
+      .WillOnce(RetrieveAdminStatus(ADMIN_STATE_DISABLED));
+  ::gnmi::SubscribeResponse resp;
+  EXPECT_CALL(stream, Write(_, _))
+      .Times(2)
+      .WillRepeatedly(DoAll(SaveArg<0>(&resp), Return(true)));
+
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+  ASSERT_EQ(1, resp.update().update_size());
+  EXPECT_EQ("DOWN", resp.update().update(0).val().string_val());
+}
+
+TEST_F(SubscriptionTest, HandleTimerSendsUnchangedUpdatesOnHeartbeat) {
+  SubscribeReaderWriterMock stream;
+
+  SubscriptionHandle h;
+  ::gnmi::Path path =
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/1")(
+          "state")("admin-status")();
+  EXPECT_OK(gnmi_publisher_->SubscribePeriodic(
+      PeriodicWithHeartbeat(1000, /*heartbeat_ms=*/1), path, &stream, &h));
+
+  EXPECT_CALL(switch_mock_, RetrieveValue(_, _, _, _))
+      .WillRepeatedly(RetrieveAdminStatus(ADMIN_STATE_ENABLED));
+  EXPECT_CALL(stream, Write(_, _)).Times(2).WillRepeatedly(Return(true));
+
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+  absl::SleepFor(absl::Milliseconds(5));
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+}
+
+TEST_F(SubscriptionTest, HandleTimerSkipsStaticLeavesWithinHeartbeat) {
+  SubscribeReaderWriterMock stream;
+
+  SubscriptionHandle h;
+  ::gnmi::Path path =
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/1")(
+          "state")("hardware-port")();
+  EXPECT_OK(gnmi_publisher_->SubscribePeriodic(
+      PeriodicWithHeartbeat(1000, /*heartbeat_ms=*/60000), path, &stream, &h));
+
+  // The hardware port is only read from the switch for the first sample.
+  EXPECT_CALL(switch_mock_, RetrieveValue(_, _, _, _))
+      .WillOnce(DoAll(WithArgs<2>(Invoke([](WriterInterface<DataResponse>* w) {
+                        DataResponse resp;
+                        resp.mutable_hardware_port()->set_name("1/1");
+                        w->Write(resp);
+                      })),
+                      Return(::util::OkStatus())));
+  EXPECT_CALL(stream, Write(_, _)).WillOnce(Return(true));
+
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+}
+
+TEST_F(SubscriptionTest, HandleTimerSkipsSentStaticLeavesWithoutHeartbeat) {
+  SubscribeReaderWriterMock stream;
+
+  SubscriptionHandle h;
+  ::gnmi::Path path =
+      GetPath("interfaces")("interface", "device1.domain.net.com:ce-1/1")(
+          "state")("hardware-port")();
+  EXPECT_OK(gnmi_publisher_->SubscribePeriodic(
+      PeriodicWithHeartbeat(1000, /*heartbeat_ms=*/0), path, &stream, &h));
+
+  // Without a heartbeat, a static leaf is never read again once sent.
+  EXPECT_CALL(switch_mock_, RetrieveValue(_, _, _, _))
+      .WillOnce(DoAll(WithArgs<2>(Invoke([](WriterInterface<DataResponse>* w) {
+                        DataResponse resp;
+                        resp.mutable_hardware_port()->set_name("1/1");
+                        w->Write(resp);
+                      })),
+                      Return(::util::OkStatus())));
+  EXPECT_CALL(stream, Write(_, _)).WillOnce(Return(true));
+
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+  EXPECT_OK(gnmi_publisher_->HandleChange(TimerEvent()));
+}
+
 TEST_F(SubscriptionTest, OnUpdateUnSupportedPath) {
   // Configure the device - the model will reconfigure itself to reflect the
   // configuration.
@@ -52,6 +52,22 @@ DEFINE_uint32(grpc_max_recv_msg_size, 0,
               "grpc server max receive message size in MB");
 DEFINE_uint32(grpc_max_send_msg_size, 0,
               "grpc server max send message size in MB");
+DEFINE_bool(grpc_async_server, false,
+            "Serve the P4Runtime StreamChannel and Write and the gNMI "
+            "Subscribe RPCs from completion queues, instead of holding a "
+            "server thread per stream.");
+DEFINE_int32(grpc_num_completion_queues, 2,
+             "Number of completion queues of the async grpc server.");
+DEFINE_int32(grpc_pollers_per_completion_queue, 1,
+             "Number of threads polling each completion queue of the async "
+             "grpc server.");
+DEFINE_bool(grpc_pin_pollers_to_cores, false,
+            "Pin the completion queue pollers of the async grpc server to the "
+            "cores, in a round robin fashion.");
+DEFINE_int32(grpc_async_handler_threads, 4,
+             "Number of threads running the unary RPC handlers (e.g. "
+             "P4Runtime Write) of the async grpc server, so that a slow "
+             "handler does not hold up the streams of a completion queue.");
 
 namespace stratum {
 namespace hal {
@@ -99,6 +115,7 @@ Hal::Hal(OperationMode mode, SwitchInterface* switch_interface,
       certificate_management_service_(nullptr),
       diag_service_(nullptr),
       file_service_(nullptr),
+      profiling_service_(nullptr),
       external_server_(nullptr),
       old_signal_handlers_() {}
 
@@ -150,6 +167,7 @@ Hal::~Hal() {
   RETURN_IF_ERROR(certificate_management_service_->Setup(FLAGS_warmboot));
   RETURN_IF_ERROR(diag_service_->Setup(FLAGS_warmboot));
   RETURN_IF_ERROR(file_service_->Setup(FLAGS_warmboot));
+  RETURN_IF_ERROR(profiling_service_->Setup(FLAGS_warmboot));
   if (FLAGS_warmboot) {
     // In case of warmboot, we also call unfreeze the switch interface after
     // services are setup. Note that finding the saved configs in case of
@@ -180,6 +198,7 @@ Hal::~Hal() {
   APPEND_STATUS_IF_ERROR(status, certificate_management_service_->Teardown());
   APPEND_STATUS_IF_ERROR(status, diag_service_->Teardown());
   APPEND_STATUS_IF_ERROR(status, file_service_->Teardown());
+  APPEND_STATUS_IF_ERROR(status, profiling_service_->Teardown());
   APPEND_STATUS_IF_ERROR(status, switch_interface_->Shutdown());
   APPEND_STATUS_IF_ERROR(status, auth_policy_checker_->Shutdown());
   APPEND_STATUS_IF_ERROR(status, admin_service_->Teardown());
@@ -219,18 +238,43 @@ Hal::~Hal() {
       builder.SetMaxSendMessageSize(
           FLAGS_grpc_max_send_msg_size * 1024 * 1024);
     }
-    builder.RegisterService(config_monitoring_service_.get());
-    builder.RegisterService(p4_service_.get());
+    if (FLAGS_grpc_async_server) {
+      // The async services replace ConfigMonitoringService and P4Service, and
+      // forward the RPCs they do not serve asynchronously to them.
+      async_config_monitoring_service_ =
+          absl::make_unique<AsyncConfigMonitoringService>(
+              config_monitoring_service_.get());
+      ASSIGN_OR_RETURN(async_p4_service_,
+                       AsyncP4Service::CreateInstance(p4_service_.get()));
+      CompletionQueuePool::Options options;
+      options.num_completion_queues = FLAGS_grpc_num_completion_queues;
+      options.pollers_per_queue = FLAGS_grpc_pollers_per_completion_queue;
+      options.pin_pollers_to_cores = FLAGS_grpc_pin_pollers_to_cores;
+      options.num_handler_threads = FLAGS_grpc_async_handler_threads;
+      completion_queue_pool_ =
+          absl::make_unique<CompletionQueuePool>(&builder, options);
+      builder.RegisterService(async_config_monitoring_service_.get());
+      builder.RegisterService(async_p4_service_.get());
+    } else {
+      builder.RegisterService(config_monitoring_service_.get());
+      builder.RegisterService(p4_service_.get());
+    }
     builder.RegisterService(admin_service_.get());
     builder.RegisterService(certificate_management_service_.get());
     builder.RegisterService(diag_service_.get());
     builder.RegisterService(file_service_.get());
+    builder.RegisterService(profiling_service_.get());
     external_server_ = builder.BuildAndStart();
     if (external_server_ == nullptr) {
       return MAKE_ERROR(ERR_INTERNAL)
              << "Failed to start Stratum external facing services. This is an "
              << "internal error.";
     }
+    if (completion_queue_pool_) {
+      async_config_monitoring_service_->Start(completion_queue_pool_.get());
+      async_p4_service_->Start(completion_queue_pool_.get());
+      RETURN_IF_ERROR(completion_queue_pool_->Start());
+    }
     LOG(ERROR) << "Stratum external facing services are listening to "
                << absl::StrJoin(external_stratum_urls, ", ") << ", "
                << FLAGS_local_stratum_url << "...";
@@ -248,6 +292,8 @@ Hal::~Hal() {
 
   external_server_->Wait();  // blocking until external_server_->Shutdown()
                              // is called. We dont wait on internal_service.
+  // The server is shut down, so the pending asynchronous calls are done.
+  if (completion_queue_pool_) completion_queue_pool_->Shutdown();
   return Teardown();
 }
 
@@ -304,6 +350,7 @@ Hal* Hal::GetSingleton() {
   CHECK_IS_NULL(certificate_management_service_);
   CHECK_IS_NULL(diag_service_);
   CHECK_IS_NULL(file_service_);
+  CHECK_IS_NULL(profiling_service_);
   CHECK_IS_NULL(external_server_);
   // FIXME(boc) google only
   // CHECK_IS_NULL(internal_server_);
@@ -326,6 +373,8 @@ Hal* Hal::GetSingleton() {
       mode_, switch_interface_, auth_policy_checker_, error_buffer_.get());
   file_service_ = absl::make_unique<FileService>(
       mode_, switch_interface_, auth_policy_checker_, error_buffer_.get());
+  profiling_service_ = absl::make_unique<ProfilingService>(
+      mode_, auth_policy_checker_, error_buffer_.get());
 
   return ::util::OkStatus();
 }
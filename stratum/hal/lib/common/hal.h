@@ -33,6 +33,8 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
 #include "stratum/hal/lib/common/admin_service.h"
+#include "stratum/hal/lib/common/async_grpc_server.h"
+#include "stratum/hal/lib/common/async_services.h"
 #include "stratum/hal/lib/common/certificate_management_service.h"
 // #include "stratum/hal/lib/common/cmal_service.h"
 #include "stratum/hal/lib/common/common.pb.h"
@@ -41,6 +43,7 @@
 #include "stratum/hal/lib/common/error_buffer.h"
 #include "stratum/hal/lib/common/file_service.h"
 #include "stratum/hal/lib/common/p4_service.h"
+#include "stratum/hal/lib/common/profiling_service.h"
 #include "stratum/hal/lib/common/switch_interface.h"
 #include "stratum/lib/security/auth_policy_checker.h"
 #include "stratum/lib/security/credentials_manager.h"
@@ -160,6 +163,15 @@ class Hal final {
   std::unique_ptr<CertificateManagementService> certificate_management_service_;
   std::unique_ptr<DiagService> diag_service_;
   std::unique_ptr<FileService> file_service_;
+  std::unique_ptr<ProfilingService> profiling_service_;
+
+  // The services and the completion queues of the asynchronous server mode
+  // (see grpc_async_server flag), in which the streaming RPCs do not hold a
+  // thread each. Null in the default synchronous mode. Owned by the class.
+  std::unique_ptr<AsyncP4Service> async_p4_service_;
+  std::unique_ptr<AsyncConfigMonitoringService>
+      async_config_monitoring_service_;
+  std::unique_ptr<CompletionQueuePool> completion_queue_pool_;
 
   // Unique pointer to the gRPC server serving the external RPC connections
   // serviced by ConfigMonitoringService and P4Service. Owned by the class.
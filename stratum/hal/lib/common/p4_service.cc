@@ -27,8 +27,10 @@
 #include "stratum/glue/logging.h"
 #include "stratum/glue/status/status_macros.h"
 #include "stratum/hal/lib/common/server_writer_wrapper.h"
+#include "stratum/lib/call_tracer.h"
 #include "stratum/lib/channel/channel.h"
 #include "stratum/lib/macros.h"
+#include "stratum/lib/metrics.h"
 #include "stratum/lib/utils.h"
 #include "stratum/public/lib/error.h"
 #include "absl/memory/memory.h"
@@ -55,10 +57,46 @@ DEFINE_int32(max_num_controllers_per_node, 5,
 DEFINE_int32(max_num_controller_connections, 20,
              "Max number of active/inactive streaming connections from outside "
              "controllers (for all of the nodes combined).");
+DEFINE_int32(packet_in_queue_size, 1024,
+             "Max number of PacketIns queued for each controller stream. "
+             "PacketIns are dropped according to packet_in_overflow_policy "
+             "when the controller does not read them fast enough.");
+DEFINE_string(packet_in_overflow_policy, "drop-oldest",
+              "What to drop when the PacketIn queue of a controller stream is "
+              "full: 'drop-oldest', 'drop-newest' or 'priority'. With "
+              "'priority', PacketIns are sent and dropped based on the value "
+              "of the metadata given by packet_in_priority_metadata_id (e.g. "
+              "the CPU queue of the packet).");
+DEFINE_uint32(packet_in_priority_metadata_id, 0,
+              "ID of the PacketIn metadata used as the priority of the packet "
+              "when packet_in_overflow_policy is 'priority'.");
+DEFINE_int32(digest_max_pending_lists, 64,
+             "Max number of DigestLists waiting to be sent to the master "
+             "controller, per digest. New digest data is dropped when the "
+             "controller does not ack the lists fast enough.");
+DEFINE_int32(digest_max_unacked_lists, 8,
+             "Max number of DigestLists sent to the master controller and not "
+             "acked yet, per digest.");
 
 namespace stratum {
 namespace hal {
 
+namespace {
+
+// A writer which passes the messages to a callback.
+template <typename T>
+class CallbackWriter : public WriterInterface<T> {
+ public:
+  explicit CallbackWriter(std::function<bool(const T&)> callback)
+      : callback_(std::move(callback)) {}
+  bool Write(const T& msg) override { return callback_(msg); }
+
+ private:
+  std::function<bool(const T&)> callback_;
+};
+
+}  // namespace
+
 // TODO(unknown): This class move possibly big configs in memory. See if there
 // is a way to make this more efficient.
 
@@ -106,7 +144,26 @@ P4Service::~P4Service() {}
       }
       pair.second->Close();
     }
+    // Unregister the idle timeout notification writers, registered for the
+    // same nodes as the PacketIn writers.
+    for (const auto& pair : packet_in_channels_) {
+      auto status = switch_interface_->UnregisterIdleTimeoutNotificationWriter(
+          pair.first);
+      if (!status.ok() && status.error_code() != ERR_UNIMPLEMENTED) {
+        LOG(ERROR) << status;
+      }
+    }
     packet_in_channels_.clear();
+    // Unregister and stop the digest managers.
+    for (const auto& pair : digest_managers_) {
+      auto status =
+          switch_interface_->UnregisterDigestReceiveWriter(pair.first);
+      if (!status.ok() && status.error_code() != ERR_UNIMPLEMENTED) {
+        LOG(ERROR) << status;
+      }
+      pair.second->Shutdown();
+    }
+    digest_managers_.clear();
     // Join threads.
     for (const auto& tid : packet_in_reader_tids_) {
       int ret = pthread_join(tid, nullptr);
@@ -248,8 +305,18 @@ void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
                                 const ::p4::v1::WriteRequest* req,
                                 ::p4::v1::WriteResponse* resp) {
   RETURN_IF_NOT_AUTHORIZED(auth_policy_checker_, P4Service, Write, context);
+  METRICS_LATENCY_SCOPE("p4_service/write");
 
   if (!req->updates_size()) return ::grpc::Status::OK;  // Nothing to do.
+  METRICS_COUNTER_ADD("p4_service/write_updates", req->updates_size());
+  // All the calls traced while handling this request (e.g. the SDK calls) are
+  // tagged with the same trace context, to correlate them with the request.
+  ScopedTraceContext trace_context;
+  ScopedTraceEvent trace_event("p4runtime", "Write", -1);
+  if (trace_event.active()) {
+    trace_event.set_args(absl::StrCat("device_id=", req->device_id(),
+                                      " updates=", req->updates_size()));
+  }
 
   // device_id is nothing but the node_id specified in the config for the node.
   uint64 node_id = req->device_id();
@@ -282,6 +349,27 @@ void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
                << ": " << status.error_message();
   }
 
+  // Apply the digest configs the switch accepted. An empty results vector
+  // with an OK status means that all the updates succeeded.
+  std::shared_ptr<DigestManager> digest_manager = GetDigestManager(node_id);
+  if (digest_manager != nullptr) {
+    for (int i = 0; i < req->updates_size(); ++i) {
+      const auto& update = req->updates(i);
+      if (!update.entity().has_digest_entry()) continue;
+      if (static_cast<size_t>(i) < results.size() ? !results[i].ok()
+                                                  : !status.ok()) {
+        continue;
+      }
+      auto ret = digest_manager->UpdateConfig(update.type(),
+                                              update.entity().digest_entry());
+      if (!ret.ok()) {
+        LOG(ERROR) << "Failed to update the config of digest "
+                   << update.entity().digest_entry().digest_id()
+                   << " for node " << node_id << ": " << ret.error_message();
+      }
+    }
+  }
+
   // Log debug info for future debugging.
   LogWriteRequest(node_id, *req, results, timestamp);
 
@@ -420,6 +508,15 @@ void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
                           status.error_message());
   }
 
+  // The digests of the previous pipeline are gone, and the ones of the new
+  // pipeline are yet to be configured.
+  if (req->action() ==
+          ::p4::v1::SetForwardingPipelineConfigRequest::VERIFY_AND_COMMIT ||
+      req->action() == ::p4::v1::SetForwardingPipelineConfigRequest::COMMIT) {
+    std::shared_ptr<DigestManager> digest_manager = GetDigestManager(node_id);
+    if (digest_manager != nullptr) digest_manager->ClearConfigs();
+  }
+
   return ::grpc::Status::OK;
 }
 
@@ -485,9 +582,6 @@ void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
 
 ::grpc::Status P4Service::StreamChannel(
     ::grpc::ServerContext* context, ServerStreamChannelReaderWriter* stream) {
-  RETURN_IF_NOT_AUTHORIZED(auth_policy_checker_, P4Service, StreamChannel,
-                           context);
-
   // Here are the rules:
   // 1- When a client (aka controller) connects for the first time, we do not do
   //    anything until a MasterArbitrationUpdate proto is received.
@@ -496,76 +590,151 @@ void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
   // 3- At any point of time, only the master stream is capable of sending
   //    and receiving packets.
 
-  // First thing to do is to find a new ID for this connection.
+  // Options for the PacketIn queue of this stream.
+  PacketInQueue::Options options;
+  options.max_size = FLAGS_packet_in_queue_size;
+  options.priority_metadata_id = FLAGS_packet_in_priority_metadata_id;
+  auto policy =
+      PacketInQueue::ParseOverflowPolicy(FLAGS_packet_in_overflow_policy);
+  if (!policy.ok() || FLAGS_packet_in_queue_size <= 0) {
+    return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION,
+                          "Invalid PacketIn queue size or overflow policy.");
+  }
+  options.overflow_policy = policy.ValueOrDie();
+
+  // Authorize the stream and find a new ID for this connection.
+  StreamChannelState state;
+  ::grpc::Status status = StartStreamChannel(
+      context,
+      std::make_shared<ServerReaderWriterWrapper<
+          ::p4::v1::StreamMessageResponse, ::p4::v1::StreamMessageRequest>>(
+          stream),
+      &state);
+  if (!status.ok()) return status;
+
+  // The queue for the PacketIns sent on this stream. All the writes to the
+  // stream go through the queue from now on.
+  state.packet_in_queue = std::make_shared<PacketInQueue>(
+      absl::make_unique<
+          ServerReaderWriterWrapper<::p4::v1::StreamMessageResponse,
+                                    ::p4::v1::StreamMessageRequest>>(stream),
+      options);
+
+  // The cleanup object. Will call RemoveController() upon exit and stop the
+  // PacketIn queue before the stream is gone.
+  auto cleaner =
+      gtl::MakeCleanup([this, &state]() { this->EndStreamChannel(&state); });
+
+  ::p4::v1::StreamMessageRequest req;
+  while (stream->Read(&req)) {
+    status = HandleStreamMessageRequest(req, &state);
+    if (!status.ok()) return status;
+  }
+
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status P4Service::StartStreamChannel(
+    ::grpc::ServerContext* context,
+    std::shared_ptr<WriterInterface<::p4::v1::StreamMessageResponse>> writer,
+    StreamChannelState* state) {
+  RETURN_IF_NOT_AUTHORIZED(auth_policy_checker_, P4Service, StreamChannel,
+                           context);
   auto ret = FindNewConnectionId();
   if (!ret.ok()) {
     return ::grpc::Status(ToGrpcCode(ret.status().CanonicalCode()),
                           ret.status().error_message());
   }
-  uint64 connection_id = ret.ValueOrDie();
-
-  // The ID of the node this stream channel corresponds to. This is MUST NOT
-  // change after it is set for the first time.
-  uint64 node_id = 0;
+  state->connection_id = ret.ValueOrDie();
+  state->uri = context->peer();
+  state->writer = std::move(writer);
 
-  // The cleanup object. Will call RemoveController() upon exit.
-  auto cleaner = gtl::MakeCleanup([this, &node_id, &connection_id]() {
-    this->RemoveController(node_id, connection_id);
-  });
+  return ::grpc::Status::OK;
+}
 
-  ::p4::v1::StreamMessageRequest req;
-  while (stream->Read(&req)) {
-    switch (req.update_case()) {
-      case ::p4::v1::StreamMessageRequest::kArbitration: {
-        if (req.arbitration().device_id() == 0) {
-          return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT,
-                                "Invalid node (aka device) ID.");
-        } else if (node_id == 0) {
-          node_id = req.arbitration().device_id();
-        } else if (node_id != req.arbitration().device_id()) {
-          std::stringstream ss;
-          ss << "Node (aka device) ID for this stream has changed. Was "
-             << node_id << ", now is " << req.arbitration().device_id() << ".";
-          return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, ss.str());
-        }
-        absl::uint128 election_id =
-            absl::MakeUint128(req.arbitration().election_id().high(),
-                              req.arbitration().election_id().low());
-        if (election_id == 0) {
-          return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT,
-                                "Invalid election ID.");
-        }
-        // Try to add the controller to controllers_.
-        auto status = AddOrModifyController(node_id, connection_id, election_id,
-                                            context->peer(), stream);
-        if (!status.ok()) {
-          return ::grpc::Status(ToGrpcCode(status.CanonicalCode()),
-                                status.error_message());
-        }
-        break;
-      }
-      case ::p4::v1::StreamMessageRequest::kPacket: {
-        // If this stream is not the master stream do not do anything.
-        if (!IsMasterController(node_id, connection_id)) break;
-        // If master, try to transmit the packet. No error reporting.
-        ::util::Status status =
-            switch_interface_->TransmitPacket(node_id, req.packet());
-        if (!status.ok()) {
-          LOG_EVERY_N(INFO, 500) << "Failed to transmit packet: " << status;
-        }
-        break;
+::grpc::Status P4Service::HandleStreamMessageRequest(
+    const ::p4::v1::StreamMessageRequest& req, StreamChannelState* state) {
+  switch (req.update_case()) {
+    case ::p4::v1::StreamMessageRequest::kArbitration: {
+      if (req.arbitration().device_id() == 0) {
+        return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT,
+                              "Invalid node (aka device) ID.");
+      } else if (state->node_id == 0) {
+        state->node_id = req.arbitration().device_id();
+      } else if (state->node_id != req.arbitration().device_id()) {
+        std::stringstream ss;
+        ss << "Node (aka device) ID for this stream has changed. Was "
+           << state->node_id << ", now is " << req.arbitration().device_id()
+           << ".";
+        return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, ss.str());
       }
-      case ::p4::v1::StreamMessageRequest::kDigestAck:
-      case ::p4::v1::StreamMessageRequest::UPDATE_NOT_SET:
+      absl::uint128 election_id =
+          absl::MakeUint128(req.arbitration().election_id().high(),
+                            req.arbitration().election_id().low());
+      if (election_id == 0) {
         return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT,
-                              "Need to specify either arbitration or packet.");
-        break;
+                              "Invalid election ID.");
+      }
+      // Try to add the controller to controllers_.
+      auto status = AddOrModifyController(
+          state->node_id, state->connection_id, election_id, state->uri,
+          state->writer, state->packet_in_queue);
+      if (!status.ok()) {
+        return ::grpc::Status(ToGrpcCode(status.CanonicalCode()),
+                              status.error_message());
+      }
+      break;
     }
+    case ::p4::v1::StreamMessageRequest::kPacket: {
+      // If this stream is not the master stream do not do anything.
+      if (!IsMasterController(state->node_id, state->connection_id)) break;
+      // If master, try to transmit the packet. No error reporting.
+      ::util::Status status =
+          switch_interface_->TransmitPacket(state->node_id, req.packet());
+      if (!status.ok()) {
+        LOG_EVERY_N(INFO, 500) << "Failed to transmit packet: " << status;
+      }
+      break;
+    }
+    case ::p4::v1::StreamMessageRequest::kDigestAck: {
+      // Digests are only sent to the master stream, which is the only one
+      // expected to ack them.
+      if (!IsMasterController(state->node_id, state->connection_id)) break;
+      std::shared_ptr<DigestManager> digest_manager =
+          GetDigestManager(state->node_id);
+      if (digest_manager == nullptr) break;
+      // An ack for an unknown or timed out list is not a stream error.
+      ::util::Status status = digest_manager->Ack(req.digest_ack());
+      if (!status.ok()) {
+        VLOG(1) << "Failed to handle digest ack: " << status;
+      }
+      break;
+    }
+    case ::p4::v1::StreamMessageRequest::UPDATE_NOT_SET:
+      return ::grpc::Status(
+          ::grpc::StatusCode::INVALID_ARGUMENT,
+          "Need to specify either arbitration, packet or digest ack.");
+      break;
   }
 
   return ::grpc::Status::OK;
 }
 
+void P4Service::EndStreamChannel(StreamChannelState* state) {
+  if (state->connection_id == 0) return;  // never started
+  RemoveController(state->node_id, state->connection_id);
+  if (state->packet_in_queue == nullptr) return;
+  state->packet_in_queue->Shutdown();
+  PacketInQueue::Stats stats = state->packet_in_queue->GetStats();
+  LOG(INFO) << "PacketIn stats for connection " << state->connection_id
+            << " to node (aka device) with ID " << state->node_id
+            << ": enqueued=" << stats.enqueued << ", sent=" << stats.sent
+            << ", dropped=" << stats.dropped
+            << ", write_failures=" << stats.write_failures
+            << ", latency_usecs: "
+            << state->packet_in_queue->latency_histogram().ToString();
+}
+
 ::util::StatusOr<uint64> P4Service::FindNewConnectionId() {
   absl::WriterMutexLock l(&controller_lock_);
   if (static_cast<int>(connection_ids_.size()) >=
@@ -587,7 +756,9 @@ void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
 
 ::util::Status P4Service::AddOrModifyController(
     uint64 node_id, uint64 connection_id, absl::uint128 election_id,
-    const std::string& uri, ServerStreamChannelReaderWriter* stream) {
+    const std::string& uri,
+    std::shared_ptr<WriterInterface<::p4::v1::StreamMessageResponse>> writer,
+    std::shared_ptr<PacketInQueue> packet_in_queue) {
   // To be called by all the threads handling controller connections.
   absl::WriterMutexLock l(&controller_lock_);
   auto it = node_id_to_controllers_.find(node_id);
@@ -620,6 +791,39 @@ void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
     // Store Channel and tid for Teardown().
     packet_in_reader_tids_.push_back(tid);
     packet_in_channels_[node_id] = channel;
+    // Not all the nodes support digests. The manager (and its sending thread)
+    // is only kept for the nodes which do.
+    DigestManager::Options digest_options;
+    digest_options.max_pending_lists = FLAGS_digest_max_pending_lists;
+    digest_options.max_unacked_lists = FLAGS_digest_max_unacked_lists;
+    auto digest_manager = std::make_shared<DigestManager>(
+        [this, node_id](const ::p4::v1::DigestList& list) {
+          return DigestListHandler(node_id, list);
+        },
+        digest_options);
+    auto status =
+        switch_interface_->RegisterDigestReceiveWriter(node_id, digest_manager);
+    if (status.ok()) {
+      digest_managers_[node_id] = digest_manager;
+    } else {
+      if (status.error_code() != ERR_UNIMPLEMENTED) {
+        LOG(ERROR) << "Failed to register the digest writer for node "
+                   << node_id << ": " << status.error_message();
+      }
+      digest_manager->Shutdown();
+    }
+    // Same for the idle timeouts.
+    status = switch_interface_->RegisterIdleTimeoutNotificationWriter(
+        node_id,
+        std::make_shared<CallbackWriter<::p4::v1::IdleTimeoutNotification>>(
+            [this, node_id](
+                const ::p4::v1::IdleTimeoutNotification& notification) {
+              return IdleTimeoutNotificationHandler(node_id, notification);
+            }));
+    if (!status.ok() && status.error_code() != ERR_UNIMPLEMENTED) {
+      LOG(ERROR) << "Failed to register the idle timeout notification writer "
+                 << "for node " << node_id << ": " << status.error_message();
+    }
     node_id_to_controllers_[node_id] = {};
     it = node_id_to_controllers_.find(node_id);
   }
@@ -648,7 +852,8 @@ void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
 
   // Now add the controller to the set of controllers for this node. The add
   // will possibly lead to a new master.
-  Controller controller(connection_id, election_id, uri, stream);
+  Controller controller(connection_id, election_id, uri, std::move(writer),
+                        std::move(packet_in_queue));
   it->second.insert(controller);
 
   // Find the most updated master. Also find out if this controller is master
@@ -675,7 +880,7 @@ void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
   if (is_master || was_master) {
     resp.mutable_arbitration()->mutable_status()->set_code(::google::rpc::OK);
     for (const auto& c : it->second) {
-      if (!c.stream()->Write(resp)) {
+      if (!c.Write(resp)) {
         return MAKE_ERROR(ERR_INTERNAL)
                << "Failed to write to a stream for node " << node_id << ".";
       }
@@ -690,7 +895,7 @@ void LogWriteRequest(uint64 node_id, const ::p4::v1::WriteRequest& req,
         ::google::rpc::ALREADY_EXISTS);
     resp.mutable_arbitration()->mutable_status()->set_message(
         "You are not my master!");
-    if (!stream->Write(resp)) {
+    if (!controller.Write(resp)) {
       return MAKE_ERROR(ERR_INTERNAL)
              << "Failed to write to a stream for node " << node_id << ".";
     }
@@ -743,7 +948,7 @@ void P4Service::RemoveController(uint64 node_id, uint64 connection_id) {
         resp.mutable_arbitration()->mutable_status()->set_code(
             ::google::rpc::OK);
         for (const auto& c : it->second) {
-          c.stream()->Write(resp);  // Best effort.
+          c.Write(resp);  // Best effort.
           // For non masters.
           resp.mutable_arbitration()->mutable_status()->set_code(
               ::google::rpc::ALREADY_EXISTS);
@@ -803,20 +1008,63 @@ void* P4Service::ReceivePackets(
       continue;
     }
     // Handle PacketIn.
-    PacketReceiveHandler(node_id, packet_in);
+    PacketReceiveHandler(node_id, std::move(packet_in));
   } while (true);
   return nullptr;
 }
 
 void P4Service::PacketReceiveHandler(uint64 node_id,
-                                     const ::p4::v1::PacketIn& packet) {
+                                     ::p4::v1::PacketIn packet) {
   // We send the packets only to the master controller stream for this node.
   absl::ReaderMutexLock l(&controller_lock_);
   auto it = node_id_to_controllers_.find(node_id);
   if (it == node_id_to_controllers_.end() || it->second.empty()) return;
+  if (!it->second.begin()->SendPacketIn(std::move(packet))) {
+    LOG_EVERY_N(INFO, 500) << "Dropped PacketIn for node (aka device) with ID "
+                           << node_id << ". The controller is not reading "
+                           << "fast enough.";
+  }
+}
+
+std::shared_ptr<DigestManager> P4Service::GetDigestManager(
+    uint64 node_id) const {
+  absl::ReaderMutexLock l(&packet_in_thread_lock_);
+  auto* digest_manager = gtl::FindOrNull(digest_managers_, node_id);
+  return digest_manager != nullptr ? *digest_manager : nullptr;
+}
+
+bool P4Service::DigestListHandler(uint64 node_id,
+                                  const ::p4::v1::DigestList& list) {
+  // Like the PacketIns, the digests are only sent to the master controller.
+  ::p4::v1::StreamMessageResponse resp;
+  *resp.mutable_digest() = list;
+  return WriteToMaster(node_id, resp);
+}
+
+bool P4Service::IdleTimeoutNotificationHandler(
+    uint64 node_id, const ::p4::v1::IdleTimeoutNotification& notification) {
+  // The idle timeout notifications are only sent to the master controller too.
   ::p4::v1::StreamMessageResponse resp;
-  *resp.mutable_packet() = packet;
-  it->second.begin()->stream()->Write(resp);
+  *resp.mutable_idle_timeout_notification() = notification;
+  return WriteToMaster(node_id, resp);
+}
+
+bool P4Service::WriteToMaster(uint64 node_id,
+                              const ::p4::v1::StreamMessageResponse& resp) {
+  Controller master;
+  {
+    absl::ReaderMutexLock l(&controller_lock_);
+    auto it = node_id_to_controllers_.find(node_id);
+    if (it == node_id_to_controllers_.end() || it->second.empty()) {
+      return false;
+    }
+    master = *it->second.begin();
+  }
+  // The write blocks while the controller is slow to read. It is done without
+  // holding controller_lock_, so that master arbitrations and streams starting
+  // or ending are not stalled meanwhile. The copy of the controller keeps its
+  // stream writer alive; the write fails if the stream ended in between.
+  return master.Write(resp);
 }
 
 }  // namespace hal
@@ -28,13 +28,17 @@
 #include <set>
 #include <vector>
 #include <map>
+#include <utility>
 
 #include "stratum/glue/status/status.h"
 #include "stratum/glue/status/statusor.h"
 #include "stratum/hal/lib/common/channel_writer_wrapper.h"
 #include "stratum/hal/lib/common/common.pb.h"
+#include "stratum/hal/lib/common/digest_manager.h"
 #include "stratum/hal/lib/common/error_buffer.h"
+#include "stratum/hal/lib/common/packet_in_queue.h"
 #include "stratum/hal/lib/common/switch_interface.h"
+#include "stratum/hal/lib/common/writer_interface.h"
 #include "stratum/hal/lib/p4/forwarding_pipeline_configs.pb.h"
 #include "stratum/lib/security/auth_policy_checker.h"
 #include "stratum/glue/integral_types.h"
@@ -60,15 +64,21 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
   class Controller {
    public:
     Controller()
-        : connection_id_(0), election_id_(0), uri_(""), stream_(nullptr) {}
-    Controller(uint64 connection_id, absl::uint128 election_id,
-               const std::string& uri, ServerStreamChannelReaderWriter* stream)
+        : connection_id_(0),
+          election_id_(0),
+          uri_(""),
+          writer_(nullptr),
+          packet_in_queue_(nullptr) {}
+    Controller(
+        uint64 connection_id, absl::uint128 election_id, const std::string& uri,
+        std::shared_ptr<WriterInterface<::p4::v1::StreamMessageResponse>>
+            writer,
+        std::shared_ptr<PacketInQueue> packet_in_queue = nullptr)
         : connection_id_(connection_id),
           election_id_(election_id),
           uri_(uri),
-          stream_(stream) {}
-    // TODO(unknown): Done for unit testing. Find a better way.
-    // stream_(CHECK_NOTNULL(stream)) {}
+          writer_(std::move(writer)),
+          packet_in_queue_(std::move(packet_in_queue)) {}
     uint64 connection_id() const { return connection_id_; }
     uint64 election_id_high() const {
       return absl::Uint128High64(election_id_);
@@ -76,7 +86,24 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
     uint64 election_id_low() const { return absl::Uint128Low64(election_id_); }
     absl::uint128 election_id() const { return election_id_; }
     std::string uri() const { return uri_; }
-    ServerStreamChannelReaderWriter* stream() const { return stream_; }
+    PacketInQueue* packet_in_queue() const { return packet_in_queue_.get(); }
+    // Writes a message to the stream. Goes through the PacketInQueue of the
+    // stream if there is one, so that the write does not race with the
+    // PacketIns being sent.
+    bool Write(const ::p4::v1::StreamMessageResponse& resp) const {
+      if (packet_in_queue_) return packet_in_queue_->Write(resp);
+      return writer_->Write(resp);
+    }
+    // Sends a PacketIn to the controller. Hands the packet over to the
+    // PacketInQueue of the stream if there is one. Otherwise the stream is
+    // served by the asynchronous server, whose writes never block.
+    bool SendPacketIn(::p4::v1::PacketIn packet) const {
+      if (packet_in_queue_) return packet_in_queue_->Enqueue(std::move(packet));
+      if (writer_ == nullptr) return false;
+      ::p4::v1::StreamMessageResponse resp;
+      *resp.mutable_packet() = std::move(packet);
+      return writer_->Write(resp);
+    }
     // A unique name string for the controller.
     std::string Name() const {
       std::stringstream ss;
@@ -89,7 +116,12 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
     uint64 connection_id_;
     absl::uint128 election_id_;
     std::string uri_;
-    ServerStreamChannelReaderWriter* stream_;  // not owned
+    // Writer to the stream, shared with the code serving the stream.
+    std::shared_ptr<WriterInterface<::p4::v1::StreamMessageResponse>> writer_;
+    // Queue for the PacketIns sent on the stream, if any. Shared with the
+    // thread serving the stream, which shuts the queue down when the stream
+    // ends.
+    std::shared_ptr<PacketInQueue> packet_in_queue_;
   };
 
   // Custom comparator for Controller class.
@@ -154,6 +186,39 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
       ::grpc::ServerContext* context,
       ServerStreamChannelReaderWriter* stream) override;
 
+  // The state of a StreamChannel stream, shared by the synchronous
+  // StreamChannel() and the asynchronous server (see AsyncP4Service).
+  struct StreamChannelState {
+    StreamChannelState() : connection_id(0), node_id(0) {}
+    // The ID of the connection, 0 until the stream is started.
+    uint64 connection_id;
+    // The ID of the node this stream channel corresponds to. This is MUST NOT
+    // change after it is set for the first time, by the first arbitration.
+    uint64 node_id;
+    // The remote connection uri.
+    std::string uri;
+    std::shared_ptr<WriterInterface<::p4::v1::StreamMessageResponse>> writer;
+    // The queue for the PacketIns sent on the stream, if any. Without a queue,
+    // the writes (which must not block) go to the writer directly.
+    std::shared_ptr<PacketInQueue> packet_in_queue;
+  };
+
+  // The steps of StreamChannel(), exposed for the asynchronous server which
+  // does not hold a thread per stream. StartStreamChannel() authorizes the
+  // stream and assigns it a connection ID. HandleStreamMessageRequest() is
+  // called for each message read from the stream, the stream is to be ended
+  // if it returns a non-OK status. EndStreamChannel() is called once the
+  // stream is done.
+  ::grpc::Status StartStreamChannel(
+      ::grpc::ServerContext* context,
+      std::shared_ptr<WriterInterface<::p4::v1::StreamMessageResponse>> writer,
+      StreamChannelState* state) LOCKS_EXCLUDED(controller_lock_);
+  ::grpc::Status HandleStreamMessageRequest(
+      const ::p4::v1::StreamMessageRequest& req, StreamChannelState* state)
+      LOCKS_EXCLUDED(controller_lock_);
+  void EndStreamChannel(StreamChannelState* state)
+      LOCKS_EXCLUDED(controller_lock_);
+
   // P4Service is neither copyable nor movable.
   P4Service(const P4Service&) = delete;
   P4Service& operator=(const P4Service&) = delete;
@@ -185,10 +250,11 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
   // is received right at the same time) before PacketReceiveHandler() takes
   // the lock. After successful completion of this function, the first element
   // in controllers_ set will have the master controller stream for packet I/O.
-  ::util::Status AddOrModifyController(uint64 node_id, uint64 connection_id,
-                                       absl::uint128 election_id,
-                                       const std::string& uri,
-                                       ServerStreamChannelReaderWriter* stream)
+  ::util::Status AddOrModifyController(
+      uint64 node_id, uint64 connection_id, absl::uint128 election_id,
+      const std::string& uri,
+      std::shared_ptr<WriterInterface<::p4::v1::StreamMessageResponse>> writer,
+      std::shared_ptr<PacketInQueue> packet_in_queue)
       LOCKS_EXCLUDED(controller_lock_);
 
   // Removes an existing controller from the controllers_ set given its stream.
@@ -219,8 +285,34 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
       LOCKS_EXCLUDED(controller_lock_);
 
   // Callback to be called whenever we receive a packet on the specified node
-  // which is destined to controller.
-  void PacketReceiveHandler(uint64 node_id, const ::p4::v1::PacketIn& packet)
+  // which is destined to controller. The packet is handed over to the
+  // PacketInQueue of the master controller stream (or queued by the
+  // asynchronous stream), so this never blocks on the stream.
+  void PacketReceiveHandler(uint64 node_id, ::p4::v1::PacketIn packet)
+      LOCKS_EXCLUDED(controller_lock_);
+
+  // Returns the DigestManager of the node, or nullptr if no controller has
+  // connected to the node yet.
+  std::shared_ptr<DigestManager> GetDigestManager(uint64 node_id) const
+      LOCKS_EXCLUDED(packet_in_thread_lock_);
+
+  // Called by the DigestManager of the node to send a DigestList to the master
+  // controller stream. Returns false if there is no master or the write fails.
+  bool DigestListHandler(uint64 node_id, const ::p4::v1::DigestList& list)
+      LOCKS_EXCLUDED(controller_lock_);
+
+  // Called by the switch to send an IdleTimeoutNotification generated by the
+  // node to the master controller stream. Returns false if there is no master
+  // or the write fails.
+  bool IdleTimeoutNotificationHandler(
+      uint64 node_id, const ::p4::v1::IdleTimeoutNotification& notification)
+      LOCKS_EXCLUDED(controller_lock_);
+
+  // Writes a message to the master controller stream of the node. Returns
+  // false if there is no master or the write fails. controller_lock_ is only
+  // held to find the master, not while writing.
+  bool WriteToMaster(uint64 node_id,
+                     const ::p4::v1::StreamMessageResponse& resp)
       LOCKS_EXCLUDED(controller_lock_);
 
   // Mutex lock used to protect node_id_to_controllers_ which is updated
@@ -233,7 +325,7 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
   mutable absl::Mutex config_lock_;
 
   // Mutex which protects the creation and destruction of the Packet RX
-  // Channels and threads.
+  // Channels and threads, and of the DigestManagers.
   mutable absl::Mutex packet_in_thread_lock_;
 
   // Map from node ID to the set of Controller instances corresponding to the
@@ -252,6 +344,11 @@ class P4Service final : public ::p4::v1::P4Runtime::Service {
   std::map<uint64, std::shared_ptr<Channel<::p4::v1::PacketIn>>>
       packet_in_channels_ GUARDED_BY(packet_in_thread_lock_);
 
+  // Map of per-node DigestManagers which batch the digests generated by the
+  // node and send them to its master controller.
+  std::map<uint64, std::shared_ptr<DigestManager>> digest_managers_
+      GUARDED_BY(packet_in_thread_lock_);
+
   // Holds the IDs of all streaming connections. Every time there is a new
   // streaming connection, we select min{1,...,max(connection_ids_) + 1} as
   // the ID of the new connection. Also, whenever the connection is dropped
@@ -1086,6 +1086,132 @@ TEST_P(P4ServiceTest, StreamChannelSuccess) {
   ASSERT_TRUE(stream3->Finish().ok());
 }
 
+TEST_P(P4ServiceTest, StreamChannelDigestSuccess) {
+  ::grpc::ClientContext context;
+  ::p4::v1::StreamMessageRequest req;
+  ::p4::v1::StreamMessageResponse resp;
+  std::shared_ptr<WriterInterface<::p4::v1::DigestList>> digest_writer;
+
+  EXPECT_CALL(*auth_policy_checker_mock_,
+              Authorize("P4Service", "StreamChannel", _))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*auth_policy_checker_mock_, Authorize("P4Service", "Write", _))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*switch_mock_, RegisterPacketReceiveWriter(kNodeId1, _))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*switch_mock_, RegisterDigestReceiveWriter(kNodeId1, _))
+      .WillOnce(DoAll(::testing::SaveArg<1>(&digest_writer),
+                      Return(::util::OkStatus())));
+  EXPECT_CALL(*switch_mock_, WriteForwardingEntries(_, _))
+      .WillOnce(Return(::util::OkStatus()));
+
+  // The controller connects and becomes master.
+  std::unique_ptr<ClientStreamChannelReaderWriter> stream =
+      stub_->StreamChannel(&context);
+  req.mutable_arbitration()->set_device_id(kNodeId1);
+  req.mutable_arbitration()->mutable_election_id()->set_high(
+      absl::Uint128High64(kElectionId1));
+  req.mutable_arbitration()->mutable_election_id()->set_low(
+      absl::Uint128Low64(kElectionId1));
+  ASSERT_TRUE(stream->Write(req));
+  ASSERT_TRUE(stream->Read(&resp));
+  ASSERT_EQ(::google::rpc::OK, resp.arbitration().status().code());
+  ASSERT_NE(nullptr, digest_writer);
+
+  // The controller enables the digest, with no batching.
+  ::grpc::ClientContext write_context;
+  ::p4::v1::WriteRequest write_req;
+  ::p4::v1::WriteResponse write_resp;
+  write_req.set_device_id(kNodeId1);
+  write_req.mutable_election_id()->set_high(absl::Uint128High64(kElectionId1));
+  write_req.mutable_election_id()->set_low(absl::Uint128Low64(kElectionId1));
+  auto* update = write_req.add_updates();
+  update->set_type(::p4::v1::Update::INSERT);
+  auto* digest_entry = update->mutable_entity()->mutable_digest_entry();
+  digest_entry->set_digest_id(1);
+  digest_entry->mutable_config()->set_max_list_size(1);
+  digest_entry->mutable_config()->set_ack_timeout_ns(60000000000LL);
+  ASSERT_TRUE(stub_->Write(&write_context, write_req, &write_resp).ok());
+
+  // A digest received from the switch is sent to the master, and its copies
+  // are dropped until the master acks it.
+  ::p4::v1::DigestList list;
+  list.set_digest_id(1);
+  list.add_data()->set_bitstring("\x01");
+  ASSERT_TRUE(digest_writer->Write(list));
+  ASSERT_TRUE(stream->Read(&resp));
+  ASSERT_EQ(1, resp.digest().digest_id());
+  ASSERT_EQ(1, resp.digest().data_size());
+  EXPECT_EQ("\x01", resp.digest().data(0).bitstring());
+  ASSERT_TRUE(digest_writer->Write(list));
+
+  ::p4::v1::StreamMessageRequest ack_req;
+  ack_req.mutable_digest_ack()->set_digest_id(1);
+  ack_req.mutable_digest_ack()->set_list_id(resp.digest().list_id());
+  ASSERT_TRUE(stream->Write(ack_req));
+  // The messages of a stream are handled in order, so the ack is handled once
+  // the arbitration sent after it is answered.
+  ASSERT_TRUE(stream->Write(req));
+  ASSERT_TRUE(stream->Read(&resp));
+  ASSERT_TRUE(resp.has_arbitration());
+
+  // Once acked, the same digest is sent again.
+  ASSERT_TRUE(digest_writer->Write(list));
+  ASSERT_TRUE(stream->Read(&resp));
+  ASSERT_EQ(1, resp.digest().data_size());
+  EXPECT_EQ("\x01", resp.digest().data(0).bitstring());
+
+  stream->WritesDone();
+  ASSERT_TRUE(stream->Finish().ok());
+}
+
+TEST_P(P4ServiceTest, StreamChannelIdleTimeoutNotificationSuccess) {
+  ::grpc::ClientContext context;
+  ::p4::v1::StreamMessageRequest req;
+  ::p4::v1::StreamMessageResponse resp;
+  std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>
+      idle_timeout_writer;
+
+  EXPECT_CALL(*auth_policy_checker_mock_,
+              Authorize("P4Service", "StreamChannel", _))
+      .WillRepeatedly(Return(::util::OkStatus()));
+  EXPECT_CALL(*switch_mock_, RegisterPacketReceiveWriter(kNodeId1, _))
+      .WillOnce(Return(::util::OkStatus()));
+  EXPECT_CALL(*switch_mock_, RegisterIdleTimeoutNotificationWriter(kNodeId1, _))
+      .WillOnce(DoAll(::testing::SaveArg<1>(&idle_timeout_writer),
+                      Return(::util::OkStatus())));
+
+  // The controller connects and becomes master.
+  std::unique_ptr<ClientStreamChannelReaderWriter> stream =
+      stub_->StreamChannel(&context);
+  req.mutable_arbitration()->set_device_id(kNodeId1);
+  req.mutable_arbitration()->mutable_election_id()->set_high(
+      absl::Uint128High64(kElectionId1));
+  req.mutable_arbitration()->mutable_election_id()->set_low(
+      absl::Uint128Low64(kElectionId1));
+  ASSERT_TRUE(stream->Write(req));
+  ASSERT_TRUE(stream->Read(&resp));
+  ASSERT_EQ(::google::rpc::OK, resp.arbitration().status().code());
+  ASSERT_NE(nullptr, idle_timeout_writer);
+
+  // A notification generated by the switch is sent to the master.
+  ::p4::v1::IdleTimeoutNotification notification;
+  notification.add_table_entry()->set_table_id(10);
+  notification.set_timestamp(1234);
+  ASSERT_TRUE(idle_timeout_writer->Write(notification));
+  ASSERT_TRUE(stream->Read(&resp));
+  ASSERT_TRUE(resp.has_idle_timeout_notification());
+  EXPECT_EQ(1234, resp.idle_timeout_notification().timestamp());
+  ASSERT_EQ(1, resp.idle_timeout_notification().table_entry_size());
+  EXPECT_EQ(10, resp.idle_timeout_notification().table_entry(0).table_id());
+
+  stream->WritesDone();
+  ASSERT_TRUE(stream->Finish().ok());
+
+  // Nothing is sent once the master is gone.
+  EXPECT_FALSE(idle_timeout_writer->Write(notification));
+}
+
 TEST_P(P4ServiceTest, StreamChannelFailureForTooManyConnections) {
   FLAGS_max_num_controller_connections = 2;  // max two connections
   ::grpc::ClientContext context1;
@@ -0,0 +1,170 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/common/packet_in_queue.h"
+
+#include <utility>
+
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/metrics.h"
+#include "stratum/public/lib/error.h"
+#include "absl/time/clock.h"
+
+namespace stratum {
+namespace hal {
+
+PacketInQueue::PacketInQueue(
+    std::unique_ptr<WriterInterface<::p4::v1::StreamMessageResponse>> writer,
+    const Options& options)
+    : writer_(std::move(writer)),
+      options_(options),
+      queues_(),
+      size_(0),
+      shutdown_(false),
+      stats_(),
+      closed_(false) {
+  writer_thread_ = std::thread(&PacketInQueue::WritePackets, this);
+}
+
+PacketInQueue::~PacketInQueue() { Shutdown(); }
+
+::util::StatusOr<PacketInQueue::OverflowPolicy>
+PacketInQueue::ParseOverflowPolicy(const std::string& name) {
+  if (name == "drop-oldest") return OverflowPolicy::kDropOldest;
+  if (name == "drop-newest") return OverflowPolicy::kDropNewest;
+  if (name == "priority") return OverflowPolicy::kPriority;
+  return MAKE_ERROR(ERR_INVALID_PARAM)
+         << "Invalid PacketIn overflow policy '" << name << "'. Must be one "
+         << "of 'drop-oldest', 'drop-newest' or 'priority'.";
+}
+
+bool PacketInQueue::Enqueue(::p4::v1::PacketIn packet) {
+  uint32 priority = Priority(packet);
+  int64 now_usecs = absl::GetCurrentTimeNanos() / 1000;
+  absl::MutexLock l(&queue_lock_);
+  if (shutdown_) return false;
+  ++stats_.enqueued;
+  if (size_ >= options_.max_size) {
+    if (options_.overflow_policy == OverflowPolicy::kDropNewest) {
+      ++stats_.dropped;
+      return false;
+    }
+    // Make room by dropping the oldest packet of the lowest priority. Empty
+    // queues are kept around to avoid reallocating them.
+    auto lowest = queues_.rbegin();
+    while (lowest != queues_.rend() && lowest->second.empty()) ++lowest;
+    if (lowest == queues_.rend() || priority < lowest->first) {
+      ++stats_.dropped;
+      return false;
+    }
+    lowest->second.pop_front();
+    --size_;
+    ++stats_.dropped;
+  }
+  queues_[priority].push_back(Entry{std::move(packet), now_usecs});
+  ++size_;
+  queue_not_empty_.Signal();
+
+  return true;
+}
+
+bool PacketInQueue::Write(const ::p4::v1::StreamMessageResponse& resp) {
+  absl::MutexLock l(&write_lock_);
+  return !closed_ && writer_->Write(resp);
+}
+
+void PacketInQueue::Shutdown() {
+  {
+    absl::MutexLock l(&queue_lock_);
+    if (shutdown_) return;
+    shutdown_ = true;
+    stats_.dropped += size_;
+    queues_.clear();
+    size_ = 0;
+    queue_not_empty_.Signal();
+  }
+  if (writer_thread_.joinable()) writer_thread_.join();
+  // The stream may be destroyed once this returns.
+  absl::MutexLock l(&write_lock_);
+  closed_ = true;
+}
+
+PacketInQueue::Stats PacketInQueue::GetStats() const {
+  absl::MutexLock l(&queue_lock_);
+  return stats_;
+}
+
+size_t PacketInQueue::size() const {
+  absl::MutexLock l(&queue_lock_);
+  return size_;
+}
+
+uint32 PacketInQueue::Priority(const ::p4::v1::PacketIn& packet) const {
+  if (options_.overflow_policy != OverflowPolicy::kPriority) return 0;
+  for (const auto& metadata : packet.metadata()) {
+    if (metadata.metadata_id() != options_.priority_metadata_id) continue;
+    // The value is a big-endian byte string. Only the 4 least significant
+    // bytes are considered.
+    uint32 priority = 0;
+    for (unsigned char c : metadata.value()) priority = (priority << 8) | c;
+    return priority;
+  }
+  return 0;
+}
+
+void PacketInQueue::WritePackets() {
+  // The response is reused for all the packets. The packets are swapped in and
+  // out of it, so no copy or allocation is needed per packet.
+  ::p4::v1::StreamMessageResponse resp;
+  ::p4::v1::PacketIn* packet = resp.mutable_packet();
+  while (true) {
+    int64 enqueue_time_usecs = 0;
+    {
+      absl::MutexLock l(&queue_lock_);
+      while (!shutdown_ && size_ == 0) queue_not_empty_.Wait(&queue_lock_);
+      if (shutdown_) break;
+      for (auto& e : queues_) {
+        if (e.second.empty()) continue;
+        packet->Swap(&e.second.front().packet);
+        enqueue_time_usecs = e.second.front().enqueue_time_usecs;
+        e.second.pop_front();
+        break;
+      }
+      --size_;
+    }
+    bool write_ok = false;
+    {
+      absl::MutexLock l(&write_lock_);
+      write_ok = writer_->Write(resp);
+    }
+    {
+      // Count the result right away, so the stats include the last packet
+      // written before a shutdown.
+      absl::MutexLock l(&queue_lock_);
+      if (write_ok) {
+        ++stats_.sent;
+      } else {
+        ++stats_.write_failures;
+      }
+    }
+    int64 latency_usecs =
+        absl::GetCurrentTimeNanos() / 1000 - enqueue_time_usecs;
+    latency_usecs_.Record(latency_usecs > 0 ? latency_usecs : 0);
+    METRICS_HISTOGRAM_RECORD("p4_service/packet_in_delivery",
+                             latency_usecs > 0 ? latency_usecs : 0);
+  }
+}
+
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_HAL_LIB_COMMON_PACKET_IN_QUEUE_H_
+#define STRATUM_HAL_LIB_COMMON_PACKET_IN_QUEUE_H_
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+#include "stratum/lib/latency_histogram.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "p4/v1/p4runtime.pb.h"
+
+namespace stratum {
+namespace hal {
+
+// PacketInQueue decouples the thread receiving PacketIns from the switch from
+// the controller stream the packets are sent on. Enqueue() hands the packet
+// over to the queue and returns right away, while a dedicated thread writes
+// the queued packets to the stream. When the queue is full (e.g. the
+// controller is slow to read), packets are dropped according to the overflow
+// policy instead of back-pressuring the packet RX path of the switch.
+//
+// All the writes to the stream (packets as well as the messages written with
+// Write(), e.g. arbitration updates) are serialized by the queue, as gRPC does
+// not allow concurrent writes on the same stream.
+class PacketInQueue {
+ public:
+  enum class OverflowPolicy {
+    // Drop the packet at the head of the queue to make room for the new one.
+    kDropOldest,
+    // Drop the new packet.
+    kDropNewest,
+    // Packets are sent in decreasing order of their priority (FIFO for the
+    // same priority). When the queue is full, the oldest packet with the
+    // lowest priority is dropped, unless the new packet has an even lower
+    // priority, in which case the new packet is dropped.
+    kPriority,
+  };
+
+  struct Options {
+    Options()
+        : max_size(1024),
+          overflow_policy(OverflowPolicy::kDropOldest),
+          priority_metadata_id(0) {}
+    // Max number of packets waiting to be written to the stream.
+    size_t max_size;
+    OverflowPolicy overflow_policy;
+    // Only used by kPriority. The value of the PacketIn metadata with this ID
+    // (e.g. the metadata carrying the CPU queue or CoS of the packet) is used
+    // as the priority of the packet. Packets without it have priority 0.
+    uint32 priority_metadata_id;
+  };
+
+  // Counters for the packets handed over to the queue. Every enqueued packet
+  // is eventually either sent, dropped or failed to be written.
+  struct Stats {
+    uint64 enqueued = 0;
+    uint64 sent = 0;
+    uint64 dropped = 0;
+    uint64 write_failures = 0;
+  };
+
+  // Creates the queue and starts the thread writing packets to 'writer'.
+  PacketInQueue(
+      std::unique_ptr<WriterInterface<::p4::v1::StreamMessageResponse>> writer,
+      const Options& options);
+  ~PacketInQueue();
+
+  // Parses the name of an overflow policy: "drop-oldest", "drop-newest" or
+  // "priority".
+  static ::util::StatusOr<OverflowPolicy> ParseOverflowPolicy(
+      const std::string& name);
+
+  // Hands the packet over to the queue. Never blocks on the stream. Returns
+  // false if the queue is shut down or the packet was dropped right away.
+  bool Enqueue(::p4::v1::PacketIn packet) LOCKS_EXCLUDED(queue_lock_);
+
+  // Writes a message to the stream synchronously, bypassing the queued
+  // packets. Returns the result of the write, or false once the queue is shut
+  // down.
+  bool Write(const ::p4::v1::StreamMessageResponse& resp)
+      LOCKS_EXCLUDED(write_lock_);
+
+  // Stops the writer thread, drops all the pending packets and waits for a
+  // Write() in progress to complete. Must be called before the stream is
+  // destroyed. Idempotent.
+  void Shutdown() LOCKS_EXCLUDED(queue_lock_);
+
+  // Returns a snapshot of the counters.
+  Stats GetStats() const LOCKS_EXCLUDED(queue_lock_);
+
+  // Histogram of the time, in microseconds, from Enqueue() until the packet
+  // is written to the stream.
+  const LatencyHistogram& latency_histogram() const { return latency_usecs_; }
+
+  // Number of packets currently waiting in the queue.
+  size_t size() const LOCKS_EXCLUDED(queue_lock_);
+
+  // PacketInQueue is neither copyable nor movable.
+  PacketInQueue(const PacketInQueue&) = delete;
+  PacketInQueue& operator=(const PacketInQueue&) = delete;
+
+ private:
+  struct Entry {
+    ::p4::v1::PacketIn packet;
+    int64 enqueue_time_usecs;
+  };
+
+  // Returns the priority of the packet under the current policy.
+  uint32 Priority(const ::p4::v1::PacketIn& packet) const;
+
+  // Body of the writer thread.
+  void WritePackets() LOCKS_EXCLUDED(queue_lock_, write_lock_);
+
+  // Writer for the underlying stream. The stream itself is not owned.
+  const std::unique_ptr<WriterInterface<::p4::v1::StreamMessageResponse>>
+      writer_;
+  const Options options_;
+
+  mutable absl::Mutex queue_lock_;
+  absl::CondVar queue_not_empty_;
+  // Pending packets, per priority, highest priority first. Without the
+  // kPriority policy, all the packets have priority 0.
+  std::map<uint32, std::deque<Entry>, std::greater<uint32>> queues_
+      GUARDED_BY(queue_lock_);
+  size_t size_ GUARDED_BY(queue_lock_);
+  bool shutdown_ GUARDED_BY(queue_lock_);
+  Stats stats_ GUARDED_BY(queue_lock_);
+
+  // Serializes the writes to the stream.
+  absl::Mutex write_lock_;
+  // Set by Shutdown(), after which nothing is written to the stream anymore.
+  bool closed_ GUARDED_BY(write_lock_);
+
+  LatencyHistogram latency_usecs_;
+  std::thread writer_thread_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_PACKET_IN_QUEUE_H_
@@ -0,0 +1,207 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/common/packet_in_queue.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+// A writer which records the payloads of the written packets and blocks the
+// writes while it is paused, emulating a controller which is slow to read.
+class FakeStreamWriter
+    : public WriterInterface<::p4::v1::StreamMessageResponse> {
+ public:
+  FakeStreamWriter() : paused_(false), blocked_(false), num_wanted_(0) {}
+
+  bool Write(const ::p4::v1::StreamMessageResponse& resp) override {
+    absl::MutexLock l(&lock_);
+    blocked_ = true;
+    lock_.Await(absl::Condition(
+        +[](bool* paused) { return !*paused; }, &paused_));
+    blocked_ = false;
+    written_.push_back(resp.has_packet() ? resp.packet().payload()
+                                         : resp.arbitration().DebugString());
+    return true;
+  }
+
+  void Pause() {
+    absl::MutexLock l(&lock_);
+    paused_ = true;
+  }
+
+  void Resume() {
+    absl::MutexLock l(&lock_);
+    paused_ = false;
+  }
+
+  // Waits until a write is blocked on the paused writer.
+  void WaitUntilBlocked() {
+    absl::MutexLock l(&lock_);
+    lock_.Await(absl::Condition(&blocked_));
+  }
+
+  // Waits until 'n' messages have been written and returns them.
+  std::vector<std::string> WaitForWritten(size_t n) {
+    absl::MutexLock l(&lock_);
+    num_wanted_ = n;
+    lock_.AwaitWithTimeout(
+        absl::Condition(this, &FakeStreamWriter::HasWritten),
+        absl::Seconds(5));
+    return written_;
+  }
+
+ private:
+  bool HasWritten() const EXCLUSIVE_LOCKS_REQUIRED(lock_) {
+    return written_.size() >= num_wanted_;
+  }
+
+  absl::Mutex lock_;
+  bool paused_ GUARDED_BY(lock_);
+  bool blocked_ GUARDED_BY(lock_);
+  size_t num_wanted_ GUARDED_BY(lock_);
+  std::vector<std::string> written_ GUARDED_BY(lock_);
+};
+
+::p4::v1::PacketIn Packet(const std::string& payload, int priority = -1) {
+  ::p4::v1::PacketIn packet;
+  packet.set_payload(payload);
+  if (priority >= 0) {
+    auto* metadata = packet.add_metadata();
+    metadata->set_metadata_id(1);
+    metadata->set_value(std::string(1, static_cast<char>(priority)));
+  }
+  return packet;
+}
+
+class PacketInQueueTest : public ::testing::Test {
+ protected:
+  void CreateQueue(PacketInQueue::OverflowPolicy policy, size_t max_size) {
+    auto writer = absl::make_unique<FakeStreamWriter>();
+    writer_ = writer.get();
+    PacketInQueue::Options options;
+    options.max_size = max_size;
+    options.overflow_policy = policy;
+    options.priority_metadata_id = 1;
+    queue_ = absl::make_unique<PacketInQueue>(std::move(writer), options);
+  }
+
+  // Blocks the writer thread in the middle of writing packet "0", so that
+  // the packets enqueued afterwards pile up in the queue.
+  void BlockWriter() {
+    writer_->Pause();
+    ASSERT_TRUE(queue_->Enqueue(Packet("0")));
+    writer_->WaitUntilBlocked();
+    ASSERT_EQ(0, queue_->size());
+  }
+
+  FakeStreamWriter* writer_;  // owned by queue_
+  std::unique_ptr<PacketInQueue> queue_;
+};
+
+TEST_F(PacketInQueueTest, WritesPacketsInOrder) {
+  CreateQueue(PacketInQueue::OverflowPolicy::kDropOldest, 10);
+  for (const char* payload : {"a", "b", "c"}) {
+    EXPECT_TRUE(queue_->Enqueue(Packet(payload)));
+  }
+  EXPECT_EQ(std::vector<std::string>({"a", "b", "c"}),
+            writer_->WaitForWritten(3));
+  queue_->Shutdown();
+  PacketInQueue::Stats stats = queue_->GetStats();
+  EXPECT_EQ(3, stats.enqueued);
+  EXPECT_EQ(3, stats.sent);
+  EXPECT_EQ(0, stats.dropped);
+  EXPECT_EQ(3, queue_->latency_histogram().Count());
+}
+
+TEST_F(PacketInQueueTest, DropOldest) {
+  CreateQueue(PacketInQueue::OverflowPolicy::kDropOldest, 2);
+  BlockWriter();
+  EXPECT_TRUE(queue_->Enqueue(Packet("1")));
+  EXPECT_TRUE(queue_->Enqueue(Packet("2")));
+  EXPECT_TRUE(queue_->Enqueue(Packet("3")));
+  EXPECT_EQ(2, queue_->size());
+  writer_->Resume();
+  EXPECT_EQ(std::vector<std::string>({"0", "2", "3"}),
+            writer_->WaitForWritten(3));
+  queue_->Shutdown();
+  EXPECT_EQ(1, queue_->GetStats().dropped);
+}
+
+TEST_F(PacketInQueueTest, DropNewest) {
+  CreateQueue(PacketInQueue::OverflowPolicy::kDropNewest, 2);
+  BlockWriter();
+  EXPECT_TRUE(queue_->Enqueue(Packet("1")));
+  EXPECT_TRUE(queue_->Enqueue(Packet("2")));
+  EXPECT_FALSE(queue_->Enqueue(Packet("3")));
+  writer_->Resume();
+  EXPECT_EQ(std::vector<std::string>({"0", "1", "2"}),
+            writer_->WaitForWritten(3));
+  queue_->Shutdown();
+  EXPECT_EQ(1, queue_->GetStats().dropped);
+}
+
+TEST_F(PacketInQueueTest, Priority) {
+  CreateQueue(PacketInQueue::OverflowPolicy::kPriority, 2);
+  BlockWriter();
+  EXPECT_TRUE(queue_->Enqueue(Packet("low", 1)));
+  EXPECT_TRUE(queue_->Enqueue(Packet("high", 3)));
+  // Full. Evicts "low".
+  EXPECT_TRUE(queue_->Enqueue(Packet("mid", 2)));
+  // Full and lower than anything queued. Dropped.
+  EXPECT_FALSE(queue_->Enqueue(Packet("none")));
+  writer_->Resume();
+  EXPECT_EQ(std::vector<std::string>({"0", "high", "mid"}),
+            writer_->WaitForWritten(3));
+  queue_->Shutdown();
+  EXPECT_EQ(2, queue_->GetStats().dropped);
+}
+
+TEST_F(PacketInQueueTest, ShutdownDropsPendingPackets) {
+  CreateQueue(PacketInQueue::OverflowPolicy::kDropOldest, 10);
+  BlockWriter();
+  EXPECT_TRUE(queue_->Enqueue(Packet("1")));
+  EXPECT_TRUE(queue_->Enqueue(Packet("2")));
+  writer_->Resume();
+  queue_->Shutdown();
+  EXPECT_FALSE(queue_->Enqueue(Packet("3")));
+  PacketInQueue::Stats stats = queue_->GetStats();
+  EXPECT_EQ(stats.enqueued, stats.sent + stats.dropped);
+  // Nothing is written to the stream anymore, as it may be destroyed.
+  ::p4::v1::StreamMessageResponse resp;
+  resp.mutable_arbitration()->set_device_id(1);
+  EXPECT_FALSE(queue_->Write(resp));
+}
+
+TEST(PacketInQueueParseTest, ParseOverflowPolicy) {
+  EXPECT_EQ(PacketInQueue::OverflowPolicy::kDropOldest,
+            PacketInQueue::ParseOverflowPolicy("drop-oldest").ValueOrDie());
+  EXPECT_EQ(PacketInQueue::OverflowPolicy::kDropNewest,
+            PacketInQueue::ParseOverflowPolicy("drop-newest").ValueOrDie());
+  EXPECT_EQ(PacketInQueue::OverflowPolicy::kPriority,
+            PacketInQueue::ParseOverflowPolicy("priority").ValueOrDie());
+  EXPECT_FALSE(PacketInQueue::ParseOverflowPolicy("random").ok());
+}
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,157 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/common/profiling_service.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+
+#include "gflags/gflags.h"
+#include "stratum/glue/logging.h"
+#include "stratum/lib/cpu_profiler.h"
+#include "stratum/lib/macros.h"
+#include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
+#include "absl/time/clock.h"
+
+DEFINE_int32(max_cpu_profile_duration_ms, 60000,
+             "Max duration of a CPU profile taken with the Profiling service.");
+
+namespace stratum {
+namespace hal {
+
+namespace {
+
+constexpr size_t kProfileChunkSize = 64 * 1024;
+constexpr uint64 kDefaultCpuProfileDurationMs = 10000;
+
+}  // namespace
+
+ProfilingService::ProfilingService(OperationMode mode,
+                                   AuthPolicyChecker* auth_policy_checker,
+                                   ErrorBuffer* error_buffer)
+    : mode_(mode),
+      auth_policy_checker_(ABSL_DIE_IF_NULL(auth_policy_checker)),
+      error_buffer_(ABSL_DIE_IF_NULL(error_buffer)) {}
+
+::util::Status ProfilingService::Setup(bool warmboot) {
+  // Nothing to do.
+  return ::util::OkStatus();
+}
+
+::util::Status ProfilingService::Teardown() {
+  // A CPU profile still being taken is stopped by its RPC, which is cancelled
+  // when the server shuts down.
+  return ::util::OkStatus();
+}
+
+::grpc::Status ProfilingService::CpuProfile(
+    ::grpc::ServerContext* context, const CpuProfileRequest* req,
+    ::grpc::ServerWriter<ProfileChunk>* writer) {
+  RETURN_IF_NOT_AUTHORIZED(auth_policy_checker_, ProfilingService, CpuProfile,
+                           context);
+  uint64 duration_ms = req->duration_ms() > 0 ? req->duration_ms()
+                                              : kDefaultCpuProfileDurationMs;
+  if (duration_ms > static_cast<uint64>(FLAGS_max_cpu_profile_duration_ms)) {
+    return ::grpc::Status(
+        ::grpc::StatusCode::INVALID_ARGUMENT,
+        "Profile duration " + std::to_string(duration_ms) +
+            " ms is over the limit of " +
+            std::to_string(FLAGS_max_cpu_profile_duration_ms) + " ms.");
+  }
+  CpuProfiler::Options options;
+  if (req->frequency_hz() != 0) options.frequency_hz = req->frequency_hz();
+  ::util::Status status = CpuProfiler::Start(options);
+  if (!status.ok()) {
+    return ::grpc::Status(ToGrpcCode(status.CanonicalCode()),
+                          status.error_message());
+  }
+  LOG(INFO) << "Taking a CPU profile for " << duration_ms << " ms at "
+            << options.frequency_hz << " Hz.";
+
+  // The profile is stopped early if the client goes away.
+  absl::Time end = absl::Now() + absl::Milliseconds(duration_ms);
+  for (absl::Time now = absl::Now(); now < end && !context->IsCancelled();
+       now = absl::Now()) {
+    absl::SleepFor(std::min(end - now, absl::Milliseconds(100)));
+  }
+  CpuProfiler::Stats stats;
+  ::util::StatusOr<std::string> profile = CpuProfiler::Stop(&stats);
+  if (!profile.ok()) {
+    return ::grpc::Status(ToGrpcCode(profile.status().CanonicalCode()),
+                          profile.status().error_message());
+  }
+  if (context->IsCancelled()) {
+    return ::grpc::Status(::grpc::StatusCode::CANCELLED,
+                          "The CPU profile was cancelled.");
+  }
+  ProfileChunk last_chunk;
+  last_chunk.set_samples(stats.samples);
+  last_chunk.set_dropped_samples(stats.dropped_samples);
+
+  return WriteProfile(profile.ValueOrDie(), last_chunk, writer);
+}
+
+::grpc::Status ProfilingService::HeapProfile(
+    ::grpc::ServerContext* context, const HeapProfileRequest* req,
+    ::grpc::ServerWriter<ProfileChunk>* writer) {
+  RETURN_IF_NOT_AUTHORIZED(auth_policy_checker_, ProfilingService, HeapProfile,
+                           context);
+  char* buffer = nullptr;
+  size_t size = 0;
+  FILE* stream = open_memstream(&buffer, &size);
+  if (stream == nullptr) {
+    return ::grpc::Status(::grpc::StatusCode::INTERNAL,
+                          "Failed to open a memory stream.");
+  }
+  int ret = malloc_info(0, stream);
+  fclose(stream);
+  std::string profile(buffer, size);
+  free(buffer);
+  if (ret != 0) {
+    return ::grpc::Status(::grpc::StatusCode::INTERNAL,
+                          "Failed to get the malloc statistics.");
+  }
+
+  return WriteProfile(profile, ProfileChunk(), writer);
+}
+
+::grpc::Status ProfilingService::WriteProfile(
+    const std::string& profile, ProfileChunk last_chunk,
+    ::grpc::ServerWriter<ProfileChunk>* writer) {
+  size_t offset = 0;
+  while (profile.size() - offset > kProfileChunkSize) {
+    ProfileChunk chunk;
+    chunk.set_data(profile.substr(offset, kProfileChunkSize));
+    if (!writer->Write(chunk)) {
+      return ::grpc::Status(::grpc::StatusCode::UNAVAILABLE,
+                            "Failed to write the profile to the client.");
+    }
+    offset += kProfileChunkSize;
+  }
+  last_chunk.set_data(profile.substr(offset));
+  if (!writer->Write(last_chunk)) {
+    return ::grpc::Status(::grpc::StatusCode::UNAVAILABLE,
+                          "Failed to write the profile to the client.");
+  }
+
+  return ::grpc::Status::OK;
+}
+
+}  // namespace hal
+}  // namespace stratum
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_HAL_LIB_COMMON_PROFILING_SERVICE_H_
+#define STRATUM_HAL_LIB_COMMON_PROFILING_SERVICE_H_
+
+#include <grpc++/grpc++.h>
+
+#include <string>
+
+#include "stratum/hal/lib/common/common.pb.h"
+#include "stratum/hal/lib/common/error_buffer.h"
+#include "stratum/hal/lib/common/profiling.grpc.pb.h"
+#include "stratum/lib/security/auth_policy_checker.h"
+#include "stratum/glue/status/status.h"
+
+namespace stratum {
+namespace hal {
+
+// ProfilingService is an implementation of the stratum.hal.Profiling gRPC
+// service, which takes CPU profiles and heap snapshots of the running process
+// on request, so that hot spots can be found on live switches without shell
+// access or a special build.
+class ProfilingService final : public Profiling::Service {
+ public:
+  // Input parameters:
+  // mode: The mode of operation.
+  // auth_policy_checker: for per RPC authorization policy checks.
+  // error_buffer: pointer to an ErrorBuffer for logging all critical errors.
+  ProfilingService(OperationMode mode, AuthPolicyChecker* auth_policy_checker,
+                   ErrorBuffer* error_buffer);
+  ~ProfilingService() override {}
+
+  // Sets up the service in coldboot or warmboot mode.
+  ::util::Status Setup(bool warmboot);
+
+  // Tears down the class. Called in both warmboot or coldboot mode.
+  ::util::Status Teardown();
+
+  // Please see //stratum/hal/lib/common/profiling.proto for the
+  // documentation of the RPCs.
+  ::grpc::Status CpuProfile(
+      ::grpc::ServerContext* context, const CpuProfileRequest* req,
+      ::grpc::ServerWriter<ProfileChunk>* writer) override;
+
+  ::grpc::Status HeapProfile(
+      ::grpc::ServerContext* context, const HeapProfileRequest* req,
+      ::grpc::ServerWriter<ProfileChunk>* writer) override;
+
+  // ProfilingService is neither copyable nor movable.
+  ProfilingService(const ProfilingService&) = delete;
+  ProfilingService& operator=(const ProfilingService&) = delete;
+
+ private:
+  // Streams the profile back in chunks of at most kProfileChunkSize bytes.
+  // 'last_chunk' holds the fields of the last chunk other than its data.
+  static ::grpc::Status WriteProfile(const std::string& profile,
+                                     ProfileChunk last_chunk,
+                                     ::grpc::ServerWriter<ProfileChunk>* writer);
+
+  // Determines the mode of operation:
+  // - OPERATION_MODE_STANDALONE: when Stratum stack runs independently and
+  // therefore needs to do all the SDK initialization itself.
+  // - OPERATION_MODE_COUPLED: when Stratum stack runs as part of Sandcastle
+  // stack, coupled with the rest of stack processes.
+  // - OPERATION_MODE_SIM: when Stratum stack runs in simulation mode.
+  // Note that this variable is set upon initialization and is never changed
+  // afterwards.
+  const OperationMode mode_;
+
+  // Pointer to AuthPolicyChecker. Not owned by this class.
+  AuthPolicyChecker* auth_policy_checker_;
+
+  // Pointer to ErrorBuffer to save any critical errors we encounter. Not owned
+  // by this class.
+  ErrorBuffer* error_buffer_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_COMMON_PROFILING_SERVICE_H_
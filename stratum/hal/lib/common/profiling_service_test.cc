@@ -0,0 +1,192 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/common/profiling_service.h"
+
+#include <grpc++/grpc++.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "gflags/gflags.h"
+#include "stratum/glue/net_util/ports.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/hal/lib/common/error_buffer.h"
+#include "stratum/lib/cpu_profiler.h"
+#include "stratum/lib/security/auth_policy_checker_mock.h"
+#include "stratum/public/lib/error.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+
+DECLARE_int32(max_cpu_profile_duration_ms);
+
+namespace stratum {
+namespace hal {
+
+using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::Return;
+
+class ProfilingServiceTest : public ::testing::TestWithParam<OperationMode> {
+ protected:
+  void SetUp() override {
+    auth_policy_checker_mock_ = absl::make_unique<AuthPolicyCheckerMock>();
+    error_buffer_ = absl::make_unique<ErrorBuffer>();
+    profiling_service_ = absl::make_unique<ProfilingService>(
+        GetParam(), auth_policy_checker_mock_.get(), error_buffer_.get());
+    std::string url =
+        "localhost:" + std::to_string(stratum::PickUnusedPortOrDie());
+    ::grpc::ServerBuilder builder;
+    builder.AddListeningPort(url, ::grpc::InsecureServerCredentials());
+    builder.RegisterService(profiling_service_.get());
+    server_ = builder.BuildAndStart();
+    ASSERT_NE(server_, nullptr);
+    stub_ = Profiling::NewStub(
+        ::grpc::CreateChannel(url, ::grpc::InsecureChannelCredentials()));
+    ASSERT_NE(stub_, nullptr);
+    ASSERT_OK(profiling_service_->Setup(false));
+  }
+
+  void TearDown() override {
+    ASSERT_OK(profiling_service_->Teardown());
+    server_->Shutdown();
+  }
+
+  // Reads all the chunks of a profile. Returns the status of the RPC.
+  ::grpc::Status ReadProfile(::grpc::ClientReader<ProfileChunk>* reader,
+                             std::string* profile, ProfileChunk* last_chunk) {
+    ProfileChunk chunk;
+    while (reader->Read(&chunk)) {
+      profile->append(chunk.data());
+      *last_chunk = chunk;
+    }
+    return reader->Finish();
+  }
+
+  std::unique_ptr<AuthPolicyCheckerMock> auth_policy_checker_mock_;
+  std::unique_ptr<ErrorBuffer> error_buffer_;
+  std::unique_ptr<ProfilingService> profiling_service_;
+  std::unique_ptr<::grpc::Server> server_;
+  std::unique_ptr<Profiling::Stub> stub_;
+};
+
+TEST_P(ProfilingServiceTest, CpuProfileSuccess) {
+  // Keeps the CPU busy while the profile is taken.
+  std::thread busy([]() {
+    volatile uint64 sum = 0;
+    absl::Time end = absl::Now() + absl::Milliseconds(300);
+    while (absl::Now() < end) {
+      for (int i = 0; i < 10000; ++i) sum = sum + i;
+    }
+  });
+  ::grpc::ClientContext context;
+  CpuProfileRequest req;
+  req.set_duration_ms(200);
+  req.set_frequency_hz(1000);
+  std::string profile;
+  ProfileChunk last_chunk;
+  ::grpc::Status status = ReadProfile(
+      stub_->CpuProfile(&context, req).get(), &profile, &last_chunk);
+  busy.join();
+  ASSERT_TRUE(status.ok()) << status.error_message();
+
+  EXPECT_GT(last_chunk.samples(), 0);
+  EXPECT_EQ(0, last_chunk.dropped_samples());
+  // The profile starts with the header of the legacy pprof format, with the
+  // sampling period in us, and ends with the memory map.
+  ASSERT_GT(profile.size(), 5 * sizeof(uintptr_t));
+  uintptr_t header[5];
+  memcpy(header, profile.data(), sizeof(header));
+  EXPECT_EQ(0, header[0]);
+  EXPECT_EQ(3, header[1]);
+  EXPECT_EQ(1000, header[3]);
+  EXPECT_THAT(profile, HasSubstr("[stack]"));
+  EXPECT_FALSE(CpuProfiler::IsRunning());
+}
+
+TEST_P(ProfilingServiceTest, CpuProfileFailsWhenAlreadyRunning) {
+  ASSERT_OK(CpuProfiler::Start(CpuProfiler::Options()));
+  ::grpc::ClientContext context;
+  CpuProfileRequest req;
+  req.set_duration_ms(10);
+  std::string profile;
+  ProfileChunk last_chunk;
+  ::grpc::Status status = ReadProfile(
+      stub_->CpuProfile(&context, req).get(), &profile, &last_chunk);
+  EXPECT_EQ(::grpc::StatusCode::RESOURCE_EXHAUSTED, status.error_code());
+  EXPECT_TRUE(profile.empty());
+  ASSERT_OK(CpuProfiler::Stop(nullptr).status());
+}
+
+TEST_P(ProfilingServiceTest, CpuProfileFailsForInvalidRequests) {
+  CpuProfileRequest req;
+  req.set_duration_ms(FLAGS_max_cpu_profile_duration_ms + 1);
+  std::string profile;
+  ProfileChunk last_chunk;
+  {
+    ::grpc::ClientContext context;
+    ::grpc::Status status = ReadProfile(
+        stub_->CpuProfile(&context, req).get(), &profile, &last_chunk);
+    EXPECT_EQ(::grpc::StatusCode::INVALID_ARGUMENT, status.error_code());
+    EXPECT_THAT(status.error_message(), HasSubstr("over the limit"));
+  }
+  req.set_duration_ms(10);
+  req.set_frequency_hz(CpuProfiler::kMaxFrequencyHz + 1);
+  {
+    ::grpc::ClientContext context;
+    ::grpc::Status status = ReadProfile(
+        stub_->CpuProfile(&context, req).get(), &profile, &last_chunk);
+    EXPECT_EQ(::grpc::StatusCode::INVALID_ARGUMENT, status.error_code());
+  }
+  EXPECT_TRUE(profile.empty());
+  EXPECT_FALSE(CpuProfiler::IsRunning());
+}
+
+TEST_P(ProfilingServiceTest, CpuProfileNotAuthorized) {
+  EXPECT_CALL(*auth_policy_checker_mock_,
+              Authorize("ProfilingService", "CpuProfile", _))
+      .WillOnce(Return(::util::Status(StratumErrorSpace(),
+                                      ERR_PERMISSION_DENIED, "Denied.")));
+  ::grpc::ClientContext context;
+  CpuProfileRequest req;
+  std::string profile;
+  ProfileChunk last_chunk;
+  ::grpc::Status status = ReadProfile(
+      stub_->CpuProfile(&context, req).get(), &profile, &last_chunk);
+  EXPECT_EQ(::grpc::StatusCode::PERMISSION_DENIED, status.error_code());
+  EXPECT_FALSE(CpuProfiler::IsRunning());
+}
+
+TEST_P(ProfilingServiceTest, HeapProfileSuccess) {
+  ::grpc::ClientContext context;
+  HeapProfileRequest req;
+  std::string profile;
+  ProfileChunk last_chunk;
+  ::grpc::Status status = ReadProfile(stub_->HeapProfile(&context, req).get(),
+                                      &profile, &last_chunk);
+  ASSERT_TRUE(status.ok()) << status.error_message();
+  EXPECT_THAT(profile, HasSubstr("<malloc version="));
+}
+
+INSTANTIATE_TEST_SUITE_P(ProfilingServiceTestWithMode, ProfilingServiceTest,
+                         ::testing::Values(OPERATION_MODE_STANDALONE,
+                                           OPERATION_MODE_COUPLED,
+                                           OPERATION_MODE_SIM));
+
+}  // namespace hal
+}  // namespace stratum
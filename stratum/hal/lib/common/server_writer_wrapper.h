@@ -40,6 +40,23 @@ class ServerWriterWrapper : public WriterInterface<T> {
   ::grpc::ServerWriter<T>* writer_;  // not owned by the class.
 };
 
+// Wrapper for the writing side of ::grpc::ServerReaderWriter based on
+// WriterInterface class.
+template <typename W, typename R>
+class ServerReaderWriterWrapper : public WriterInterface<W> {
+ public:
+  explicit ServerReaderWriterWrapper(
+      ::grpc::ServerReaderWriter<W, R>* reader_writer)
+      : reader_writer_(reader_writer) {}
+  bool Write(const W& msg) override {
+    if (reader_writer_) return reader_writer_->Write(msg);
+    return false;
+  }
+
+ private:
+  ::grpc::ServerReaderWriter<W, R>* reader_writer_;  // not owned by the class.
+};
+
 }  // namespace hal
 }  // namespace stratum
 
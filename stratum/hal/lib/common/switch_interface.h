@@ -175,6 +175,34 @@ class SwitchInterface {
   // RegisterPacketReceiveWriter().
   virtual ::util::Status UnregisterPacketReceiveWriter(uint64 node_id) = 0;
 
+  // Registers a writer to be invoked with the DigestList messages generated
+  // by the specified node, for the digests configured with DigestEntry
+  // writes. The switch owns the acks of its target: the digest data is
+  // considered delivered once written, and the writer takes care of batching,
+  // deduplicating and acking it with the controller. Returns ERR_UNIMPLEMENTED
+  // if the node does not support digests.
+  virtual ::util::Status RegisterDigestReceiveWriter(
+      uint64 node_id,
+      std::shared_ptr<WriterInterface<::p4::v1::DigestList>> writer) = 0;
+
+  // Unregisters the writer registered to this node by
+  // RegisterDigestReceiveWriter().
+  virtual ::util::Status UnregisterDigestReceiveWriter(uint64 node_id) = 0;
+
+  // Registers a writer to be invoked with the IdleTimeoutNotification messages
+  // generated by the specified node for the table entries programmed with an
+  // idle timeout which have not been hit for that long. Returns
+  // ERR_UNIMPLEMENTED if the node does not support idle timeouts.
+  virtual ::util::Status RegisterIdleTimeoutNotificationWriter(
+      uint64 node_id,
+      std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>
+          writer) = 0;
+
+  // Unregisters the writer registered to this node by
+  // RegisterIdleTimeoutNotificationWriter().
+  virtual ::util::Status UnregisterIdleTimeoutNotificationWriter(
+      uint64 node_id) = 0;
+
   // Transmits a packet received from controller directly to a port on a given
   // node (specified by 'node_id') or to the ingress pipeline of the node
   // to let the chip route the packet. The given ::p4::PacketOut instance
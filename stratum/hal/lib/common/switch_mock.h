@@ -66,6 +66,20 @@ class SwitchMock : public SwitchInterface {
           uint64 node_id,
           std::shared_ptr<WriterInterface<::p4::v1::PacketIn>> writer));
   MOCK_METHOD1(UnregisterPacketReceiveWriter, ::util::Status(uint64 node_id));
+  MOCK_METHOD2(
+      RegisterDigestReceiveWriter,
+      ::util::Status(
+          uint64 node_id,
+          std::shared_ptr<WriterInterface<::p4::v1::DigestList>> writer));
+  MOCK_METHOD1(UnregisterDigestReceiveWriter, ::util::Status(uint64 node_id));
+  MOCK_METHOD2(
+      RegisterIdleTimeoutNotificationWriter,
+      ::util::Status(
+          uint64 node_id,
+          std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>
+              writer));
+  MOCK_METHOD1(UnregisterIdleTimeoutNotificationWriter,
+               ::util::Status(uint64 node_id));
   MOCK_METHOD2(TransmitPacket,
                ::util::Status(uint64 node_id,
                               const ::p4::v1::PacketOut& packet));
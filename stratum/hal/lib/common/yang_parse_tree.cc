@@ -17,7 +17,6 @@
 #include "stratum/hal/lib/common/yang_parse_tree.h"
 
 #include <grpcpp/grpcpp.h>
-#include <list>
 #include <string>
 #include <unordered_set>
 
@@ -57,18 +56,41 @@ void TreeNode::CopySubtree(const TreeNode& src) {
   supports_on_delete_ = src.supports_on_delete_;
   // Copy flags.
   is_name_a_key_ = src.is_name_a_key_;
+  is_static_ = src.is_static_;
+  static_since_ = src.static_since_;
+  // The parent might have changed, so the path has to be recomputed.
+  UpdatePath();
 
   // Deep-copy children.
   for (const auto& entry : src.children_) {
-    children_.emplace(entry.first, TreeNode(*this, entry.first));
-    children_[entry.first].CopySubtree(entry.second);
+    AddChild(entry.first)->CopySubtree(entry.second);
   }
 }
 
+TreeNode* TreeNode::AddChild(const std::string& name, bool is_name_a_key) {
+  TreeNode* child = FindChildOrNull(name);
+  if (child == nullptr) {
+    auto it = children_.emplace(name, TreeNode(*this, name, is_name_a_key))
+                  .first;
+    child = &it->second;
+    // The key of the index must point to the string owned by the map as the
+    // 'name' parameter might not outlive the node.
+    child_index_[it->first] = child;
+  }
+  return child;
+}
+
 ::util::Status TreeNode::VisitThisNodeAndItsChildren(
     const TreeNodeEventHandlerPtr& handler, const GnmiEvent& event,
     const ::gnmi::Path& path, GnmiSubscribeStream* stream) const {
-  RETURN_IF_ERROR((this->*handler)(event, path, stream));
+  // A static leaf which was already sent on a stream suppressing redundant
+  // updates would not be sent again, so there is no need to read it.
+  auto* filter =
+      is_static_ ? dynamic_cast<SuppressRedundantGnmiSubscribeStream*>(stream)
+                 : nullptr;
+  if (filter == nullptr || !filter->KnownSince(path, static_since_)) {
+    RETURN_IF_ERROR((this->*handler)(event, path, stream));
+  }
   for (const auto& child : children_) {
     RETURN_IF_ERROR(child.second.VisitThisNodeAndItsChildren(
         handler, event, child.second.GetPath(), stream));
@@ -85,31 +107,21 @@ void TreeNode::CopySubtree(const TreeNode& src) {
   return ::util::OkStatus();
 }
 
-::gnmi::Path TreeNode::GetPath() const {
-  std::list<const TreeNode*> elements;
-  for (const TreeNode* node = this; node != nullptr; node = node->parent_) {
-    elements.push_front(node);
-  }
-
-  // Remove the first element as it is a fake root and should never apear in the
-  // path.
-  if (!elements.empty()) elements.pop_front();
-
-  ::gnmi::Path path;
-  ::gnmi::PathElem* elem = nullptr;
-  for (const auto& element : elements) {
-    if (element->is_name_a_key_) {
-      if (elem != nullptr) {
-        (*elem->mutable_key())["name"] = element->name_;
-      } else {
-        LOG(ERROR) << "Found a key element without a parent!";
-      }
+void TreeNode::UpdatePath() {
+  // The fake root never apears in the path, so nodes attached directly to it
+  // start with an empty one.
+  path_ = parent_ != nullptr ? parent_->path_ : ::gnmi::Path();
+  if (parent_ == nullptr) return;
+  if (is_name_a_key_) {
+    if (path_.elem_size() > 0) {
+      (*path_.mutable_elem(path_.elem_size() - 1)->mutable_key())["name"] =
+          name_;
     } else {
-      elem = path.add_elem();
-      elem->set_name(element->name_);
+      LOG(ERROR) << "Found a key element without a parent!";
     }
+  } else {
+    path_.add_elem()->set_name(name_);
   }
-  return path;
 }
 
 const TreeNode* TreeNode::FindNodeOrNull(const ::gnmi::Path& path) const {
@@ -120,10 +132,11 @@ const TreeNode* TreeNode::FindNodeOrNull(const ::gnmi::Path& path) const {
   const TreeNode* node = this;
   for (; node != nullptr && !node->children_.empty() &&
          element < path.elem_size();) {
-    node = gtl::FindOrNull(node->children_, path.elem(element).name());
-    auto* search = gtl::FindOrNull(path.elem(element).key(), "name");
-    if (search != nullptr && node != nullptr) {
-      node = gtl::FindOrNull(node->children_, *search);
+    const auto& elem = path.elem(element);
+    node = node->FindChildOrNull(elem.name());
+    if (node != nullptr && elem.key_size() > 0) {
+      auto* search = gtl::FindOrNull(elem.key(), "name");
+      if (search != nullptr) node = node->FindChildOrNull(*search);
     }
     ++element;
   }
@@ -148,6 +161,10 @@ void YangParseTree::SendNotification(const GnmiEventPtr& event) {
     const ConfigHasBeenPushedEvent& change) {
   absl::WriterMutexLock r(&root_access_lock_);
 
+  // The new config may add new interfaces, so all wildcard expansions that
+  // have been resolved so far might be incomplete.
+  InvalidateWildcardExpansionCache();
+
   // Translation from node ID to an object describing the node.
   absl::flat_hash_map<uint64, const Node*> node_id_to_node;
   for (const auto& node : change.new_config_.nodes()) {
@@ -211,18 +228,54 @@ bool YangParseTree::IsWildcard(const std::string& name) const {
   return false;
 }
 
+namespace {
+
+// Appends a compact, unambiguous representation of 'path' to 'key'.
+void AppendPathToCacheKey(const ::gnmi::Path& path, std::string* key) {
+  for (const auto& elem : path.elem()) {
+    absl::StrAppend(key, "/", elem.name());
+    auto* search = gtl::FindOrNull(elem.key(), "name");
+    if (search != nullptr) absl::StrAppend(key, "[", *search, "]");
+  }
+}
+
+}  // namespace
+
 ::util::Status YangParseTree::PerformActionForAllNonWildcardNodes(
     const gnmi::Path& path, const gnmi::Path& subpath,
     const std::function<::util::Status(const TreeNode& leaf)>& action) const {
-  const auto* root = root_.FindNodeOrNull(path);
-  ::util::Status ret = ::util::OkStatus();
-  for (const auto& entry : root->children_) {
-    if (IsWildcard(entry.first)) {
-      // Skip this one!
-      continue;
+  std::string key;
+  AppendPathToCacheKey(path, &key);
+  absl::StrAppend(&key, "|");
+  AppendPathToCacheKey(subpath, &key);
+
+  // Resolve the expansion only if it has not been done since the last change
+  // of the tree. The list is copied as the action might modify the cache.
+  std::vector<const TreeNode*> leaves;
+  {
+    absl::MutexLock l(&wildcard_cache_lock_);
+    auto it = wildcard_expansion_cache_.find(key);
+    if (it == wildcard_expansion_cache_.end()) {
+      std::vector<const TreeNode*> expansion;
+      const auto* root = root_.FindNodeOrNull(path);
+      if (root != nullptr) {
+        for (const auto& entry : root->children_) {
+          if (IsWildcard(entry.first)) {
+            // Skip this one!
+            continue;
+          }
+          expansion.push_back(subpath.elem_size()
+                                  ? entry.second.FindNodeOrNull(subpath)
+                                  : &entry.second);
+        }
+      }
+      it = wildcard_expansion_cache_.emplace(key, std::move(expansion)).first;
     }
-    auto* leaf = subpath.elem_size() ? entry.second.FindNodeOrNull(subpath)
-                                     : &entry.second;
+    leaves = it->second;
+  }
+
+  ::util::Status ret = ::util::OkStatus();
+  for (const auto* leaf : leaves) {
     if (leaf == nullptr) {
       // Should not happen!
       ::util::Status status = MAKE_ERROR(ERR_INTERNAL)
@@ -236,46 +289,45 @@ bool YangParseTree::IsWildcard(const std::string& name) const {
   return ret;
 }
 
+void YangParseTree::InvalidateWildcardExpansionCache() const {
+  absl::MutexLock l(&wildcard_cache_lock_);
+  wildcard_expansion_cache_.clear();
+}
+
 YangParseTree::YangParseTree(SwitchInterface* switch_interface)
     : switch_interface_(ABSL_DIE_IF_NULL(switch_interface)) {
   // Add the minimum nodes:
   //   /interfaces/interface[name=*]/state/ifindex
   //   /interfaces/interface[name=*]/state/name
   //   /interfaces/interface/...
+  //   /debug/metrics/debug-string
+  //   /debug/call-trace/chrome-trace
+  //   /debug/call-trace/enabled
   //   /
   // The rest of nodes will be added once the config is pushed.
   absl::WriterMutexLock l(&root_access_lock_);
   AddSubtreeAllInterfaces();
+  AddSubtreeProcessDebug();
   AddRoot();
 }
 
 TreeNode* YangParseTree::AddNode(const ::gnmi::Path& path) {
   // No need to lock the mutex - it is locked by method calling this one.
+  // The tree is about to change, so cached wildcard expansions are stale.
+  InvalidateWildcardExpansionCache();
+
   TreeNode* node = &root_;
   for (const auto& element : path.elem()) {
-    TreeNode* child = gtl::FindOrNull(node->children_, element.name());
-    if (child == nullptr) {
-      // This path is not supported yet. Let's add a node with default
-      // processing.
-      node->children_.emplace(element.name(), TreeNode(*node, element.name()));
-      child = gtl::FindOrNull(node->children_, element.name());
-    }
-    node = child;
+    // If this path is not supported yet, a node with default processing is
+    // added.
+    node = node->AddChild(element.name());
     auto* search = gtl::FindOrNull(element.key(), "name");
     if (search == nullptr) {
       continue;
     }
 
     // A filtering pattern has been found!
-    child = gtl::FindOrNull(node->children_, *search);
-    if (child == nullptr) {
-      // This path is not supported yet. Let's add a node with default
-      // processing.
-      node->children_.emplace(
-          *search, TreeNode(*node, *search, true /* mark as a key */));
-      child = gtl::FindOrNull(node->children_, *search);
-    }
-    node = child;
+    node = node->AddChild(*search, true /* mark as a key */);
   }
   return node;
 }
@@ -291,7 +343,8 @@ TreeNode* YangParseTree::AddNode(const ::gnmi::Path& path) {
   }
   // Now 'source' points to the root of the source subtree.
 
-  // Set 'dest' to the insertion point of the new subtree.
+  // Set 'dest' to the insertion point of the new subtree. AddNode() takes care
+  // of invalidating the wildcard expansion cache.
   TreeNode* node = AddNode(to);
   // Now 'node' points to the insertion point of the new subtree.
 
@@ -302,7 +355,7 @@ TreeNode* YangParseTree::AddNode(const ::gnmi::Path& path) {
 }
 
 const TreeNode* YangParseTree::FindNodeOrNull(const ::gnmi::Path& path) const {
-  absl::WriterMutexLock l(&root_access_lock_);
+  absl::ReaderMutexLock l(&root_access_lock_);
 
   // Map the input path to the supported one - walk the tree of known elements
   // element by element starting from the root and if the element is found the
@@ -344,6 +397,12 @@ void YangParseTree::AddSubtreeAllInterfaces() {
   YangParseTreePaths::AddSubtreeAllInterfaces(this);
 }
 
+void YangParseTree::AddSubtreeProcessDebug() {
+  // No need to lock the mutex - it is locked by method calling this one.
+
+  YangParseTreePaths::AddSubtreeProcessDebug(this);
+}
+
 void YangParseTree::AddRoot() {
   // No need to lock the mutex - it is locked by method calling this one.
 
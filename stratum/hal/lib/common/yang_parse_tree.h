@@ -23,15 +23,20 @@
 #include <memory>
 #include <string>
 #include <map>
+#include <vector>
 
 #include "stratum/lib/macros.h"
+#include "stratum/glue/gtl/map_util.h"
 #include "stratum/glue/status/status.h"
 #include "gnmi/gnmi.grpc.pb.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/common/gnmi_events.h"
 #include "stratum/hal/lib/common/switch_interface.h"
 #include "stratum/hal/lib/common/writer_interface.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 
 namespace stratum {
 namespace hal {
@@ -66,6 +71,10 @@ using TreeNodeEventRegistration =
 // its children and so on until the first unknown path element is found (and the
 // client is notified that such leaf is not supported) or the whole path is
 // processed (which means that the leaf is supported).
+// To keep the walk cheap each node keeps a hashed index of its children (keyed
+// by the names owned by 'children_', so every name is stored only once) and the
+// ::gnmi::Path leading to it, which is computed once when the node is attached
+// to the tree.
 class TreeNode {
  public:
   using SupportsOnPtr = bool TreeNode::*;
@@ -81,7 +90,9 @@ class TreeNode {
         supports_on_poll_(false),
         supports_on_update_(false),
         supports_on_replace_(false),
-        supports_on_delete_(false) {}
+        supports_on_delete_(false),
+        is_static_(false),
+        static_since_(absl::InfinitePast()) {}
   TreeNode(const TreeNode& parent, const std::string& name,
            bool is_name_a_key = false)
       : parent_(&parent),
@@ -92,7 +103,11 @@ class TreeNode {
         supports_on_poll_(false),
         supports_on_update_(false),
         supports_on_replace_(false),
-        supports_on_delete_(false) {}
+        supports_on_delete_(false),
+        is_static_(false),
+        static_since_(absl::InfinitePast()) {
+    UpdatePath();
+  }
   TreeNode(const TreeNode& src);
 
   void CopySubtree(const TreeNode& src);
@@ -159,9 +174,35 @@ class TreeNode {
     return this;
   }
 
+  // Marks this leaf as static: its value is known when the node is created
+  // (e.g. it comes from the pushed config) and only changes when the node is
+  // set up again for a new config. A SAMPLE subscription with
+  // suppress_redundant set does not call the on-timer handler of a static leaf
+  // it has sent since then, as long as it was sent within its heartbeat
+  // interval (if any).
+  TreeNode* MarkAsStatic() {
+    is_static_ = true;
+    static_since_ = absl::Now();
+    return this;
+  }
+  bool is_static() const { return is_static_; }
+
   // Returns a node that handles the YANG path starting from this node.
   const TreeNode* FindNodeOrNull(const ::gnmi::Path& path) const;
 
+  // Returns the direct child called 'name' or nullptr if there is no such
+  // child.
+  const TreeNode* FindChildOrNull(absl::string_view name) const {
+    return gtl::FindPtrOrNull(child_index_, name);
+  }
+  TreeNode* FindChildOrNull(absl::string_view name) {
+    return gtl::FindPtrOrNull(child_index_, name);
+  }
+
+  // Returns the direct child called 'name'. If there is no such child, a new
+  // one with default processing is added first.
+  TreeNode* AddChild(const std::string& name, bool is_name_a_key = false);
+
   // A generic method that checks if the subtree starting from this node
   // supports a particular type of events. The input parameter is a pointer to
   // the mameber variable that keeps information if this node supports the
@@ -286,13 +327,18 @@ class TreeNode {
   const std::string& name() const { return name_; }
 
   // Returns path from root to this node.
-  ::gnmi::Path GetPath() const;
+  const ::gnmi::Path& GetPath() const { return path_; }
 
+  // Children of this node. Do not insert into this map directly - use
+  // AddChild() instead, so the hashed index of the children stays in sync.
   std::map<std::string, TreeNode> children_;
 
  private:
   using TreeNodeEventHandlerPtr = TreeNodeEventHandler TreeNode::*;
 
+  // Recomputes 'path_' using the path of the parent node.
+  void UpdatePath();
+
   // Traverses the whole subtree starting from this node.
   // This method is used to visit all subtree nodes and execute handler functor
   // - this implements the expected behavior when a client subscribes to a node
@@ -378,6 +424,15 @@ class TreeNode {
   bool supports_on_update_;
   bool supports_on_replace_;
   bool supports_on_delete_;
+  bool is_static_;
+  // When the value of this static leaf was last set, see MarkAsStatic().
+  absl::Time static_since_;
+  // Path from the root to this node. It never changes once the node is added
+  // to the tree, so it is computed only once instead of on every request.
+  ::gnmi::Path path_;
+  // Hashed index of 'children_'. The keys point to the strings owned by
+  // 'children_', whose nodes are never moved once inserted.
+  absl::flat_hash_map<absl::string_view, TreeNode*> child_index_;
 
   friend class stratum::hal::YangParseTreeTest;
   friend class stratum::hal::SubscriptionTestBase;
@@ -431,6 +486,10 @@ class YangParseTree {
   void AddSubtreeChassis(const Chassis& chassis)
       EXCLUSIVE_LOCKS_REQUIRED(root_access_lock_);
 
+  // Add supported leaf handles for the process wide debug state (metrics and
+  // call tracer).
+  void AddSubtreeProcessDebug() EXCLUSIVE_LOCKS_REQUIRED(root_access_lock_);
+
   // Configure the root element.
   void AddRoot() EXCLUSIVE_LOCKS_REQUIRED(root_access_lock_);
 
@@ -482,12 +541,18 @@ class YangParseTree {
 
   // A helper function. Finds a node specified by 'path' and then for all
   // non-wildcard children finds leaf specified by 'subpath' and executes
-  // 'action' on that leaf.
+  // 'action' on that leaf. The list of leaves a given ('path', 'subpath') pair
+  // expands to is cached until the tree is modified.
   ::util::Status PerformActionForAllNonWildcardNodes(
       const gnmi::Path& path, const gnmi::Path& subpath,
       const std::function<::util::Status(const TreeNode& leaf)>& action) const
       EXCLUSIVE_LOCKS_REQUIRED(root_access_lock_);
 
+  // Drops all cached wildcard expansions. Called every time the shape of the
+  // tree changes.
+  void InvalidateWildcardExpansionCache() const
+      LOCKS_EXCLUDED(wildcard_cache_lock_);
+
   SwitchInterface* switch_interface_ GUARDED_BY(root_access_lock_);
 
   // A channel between YangParseTree object and GnmiPublisher objest.
@@ -499,6 +564,16 @@ class YangParseTree {
   // A Mutex used to guard access to the root.
   mutable absl::Mutex root_access_lock_;
 
+  // Cache of resolved wildcard expansions used by
+  // PerformActionForAllNonWildcardNodes(). The key is built from the 'path'
+  // and 'subpath' arguments and the value lists the matching leaves in the
+  // order of the children of 'path' (nullptr marks a child without the
+  // 'subpath' leaf).
+  mutable absl::flat_hash_map<std::string, std::vector<const TreeNode*>>
+      wildcard_expansion_cache_ GUARDED_BY(wildcard_cache_lock_);
+  // A Mutex used to guard access to the wildcard expansion cache.
+  mutable absl::Mutex wildcard_cache_lock_;
+
   // In most cases the TARGET_DEFINED mode is ON_CHANGE mode as this mode
   // is the least resource-hungry. But to make the gNMI demo more realistic it
   // is changed to SAMPLE with the period of 1s.
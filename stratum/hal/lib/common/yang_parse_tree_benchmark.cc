@@ -0,0 +1,120 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks measuring the gNMI path resolution rate of YangParseTree.
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "gnmi/gnmi.pb.h"
+#include "gmock/gmock.h"
+#include "stratum/hal/lib/common/gnmi_publisher.h"
+#include "stratum/hal/lib/common/switch_mock.h"
+#include "stratum/hal/lib/common/yang_parse_tree.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+// Exposes the protected wildcard expansion helper of YangParseTree.
+class YangParseTreeUnderTest : public YangParseTree {
+ public:
+  explicit YangParseTreeUnderTest(SwitchInterface* switch_interface)
+      : YangParseTree(switch_interface) {}
+
+  ::util::Status ExpandAllInterfaces(
+      const std::function<::util::Status(const TreeNode& leaf)>& action) {
+    absl::WriterMutexLock l(&root_access_lock_);
+    return PerformActionForAllNonWildcardNodes(
+        GetPath("interfaces")("interface")(), GetPath("state")("ifindex")(),
+        action);
+  }
+};
+
+std::string InterfaceName(int i) { return absl::StrCat("interface-", i); }
+
+// Pushes a config with 'num_ports' singleton ports to 'tree'.
+void PushConfig(int num_ports, YangParseTree* tree) {
+  ChassisConfig config;
+  config.mutable_chassis()->set_name("chassis-1");
+  auto* node = config.add_nodes();
+  node->set_id(1);
+  node->set_name("node-1");
+  for (int i = 0; i < num_ports; ++i) {
+    auto* singleton = config.add_singleton_ports();
+    singleton->set_id(i + 1);
+    singleton->set_node(1);
+    singleton->set_name(InterfaceName(i));
+  }
+  CHECK_OK(tree->ProcessPushedConfig(ConfigHasBeenPushedEvent(config)));
+}
+
+void BM_FindNodeOrNull(benchmark::State& state) {
+  const int num_ports = state.range(0);
+  ::testing::NiceMock<SwitchMock> switch_mock;
+  YangParseTree tree(&switch_mock);
+  PushConfig(num_ports, &tree);
+  std::vector<::gnmi::Path> paths;
+  for (int i = 0; i < num_ports; ++i) {
+    paths.push_back(GetPath("interfaces")("interface", InterfaceName(i))(
+        "state")("counters")("in-octets")());
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tree.FindNodeOrNull(paths[i]));
+    if (++i == paths.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindNodeOrNull)->Arg(32)->Arg(128)->Arg(1024);
+
+void BM_GetPath(benchmark::State& state) {
+  ::testing::NiceMock<SwitchMock> switch_mock;
+  YangParseTree tree(&switch_mock);
+  PushConfig(1, &tree);
+  const TreeNode* node = tree.FindNodeOrNull(GetPath("interfaces")(
+      "interface", InterfaceName(0))("state")("counters")("in-octets")());
+  CHECK(node != nullptr);
+  for (auto _ : state) {
+    ::gnmi::Path path = node->GetPath();
+    benchmark::DoNotOptimize(path);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetPath);
+
+void BM_WildcardExpansion(benchmark::State& state) {
+  const int num_ports = state.range(0);
+  ::testing::NiceMock<SwitchMock> switch_mock;
+  YangParseTreeUnderTest tree(&switch_mock);
+  PushConfig(num_ports, &tree);
+  int leaves = 0;
+  const auto& action = [&leaves](const TreeNode& leaf) {
+    ++leaves;
+    return ::util::OkStatus();
+  };
+  for (auto _ : state) {
+    CHECK_OK(tree.ExpandAllInterfaces(action));
+  }
+  state.SetItemsProcessed(leaves);
+}
+BENCHMARK(BM_WildcardExpansion)->Arg(32)->Arg(128)->Arg(1024);
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
+
+BENCHMARK_MAIN();
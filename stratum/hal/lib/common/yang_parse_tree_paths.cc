@@ -13,6 +13,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <functional>
+#include <string>
 #include <vector>
 
 #include "stratum/hal/lib/common/yang_parse_tree_paths.h"
@@ -22,7 +24,9 @@
 #include "stratum/hal/lib/common/gnmi_publisher.h"
 #include "stratum/hal/lib/common/utils.h"
 #include "stratum/hal/lib/common/openconfig_converter.h"
+#include "stratum/lib/call_tracer.h"
 #include "stratum/lib/constants.h"
+#include "stratum/lib/metrics.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_format.h"
 #include "absl/time/clock.h"
@@ -703,7 +707,8 @@ void SetUpInterfacesInterfaceStateLastChange(TreeNode* node) {
 // /interfaces/interface[name=<name>]/state/ifindex
 void SetUpInterfacesInterfaceStateIfindex(uint32 port_id, TreeNode* node) {
   auto on_change_functor = UnsupportedFunc();
-  node->SetOnTimerHandler([port_id](const GnmiEvent& event,
+  node->MarkAsStatic()
+      ->SetOnTimerHandler([port_id](const GnmiEvent& event,
                                     const ::gnmi::Path& path,
                                     GnmiSubscribeStream* stream) {
         return SendResponse(GetResponse(path, port_id), stream);
@@ -721,7 +726,8 @@ void SetUpInterfacesInterfaceStateIfindex(uint32 port_id, TreeNode* node) {
 void SetUpInterfacesInterfaceStateName(const std::string& name,
                                        TreeNode* node) {
   auto on_change_functor = UnsupportedFunc();
-  node->SetOnTimerHandler([name](const GnmiEvent& event,
+  node->MarkAsStatic()
+      ->SetOnTimerHandler([name](const GnmiEvent& event,
                                  const ::gnmi::Path& path,
                                  GnmiSubscribeStream* stream) {
         return SendResponse(GetResponse(path, name), stream);
@@ -808,7 +814,8 @@ void SetUpInterfacesInterfaceStateHardwarePort(uint64 node_id, uint32 port_id,
     return SendResponse(GetResponse(path, resp), stream);
   };
   auto on_change_functor = UnsupportedFunc();
-  node->SetOnTimerHandler(poll_functor)
+  node->MarkAsStatic()
+      ->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeHandler(on_change_functor);
 }
@@ -2103,7 +2110,8 @@ void SetUpQosInterfacesInterfaceOutputQueuesQueueStateName(
     return SendResponse(GetResponse(path, name), stream);
   };
   auto on_change_functor = UnsupportedFunc();
-  node->SetOnTimerHandler(poll_functor)
+  node->MarkAsStatic()
+      ->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeHandler(on_change_functor);
 }
@@ -2124,7 +2132,8 @@ void SetUpQosInterfacesInterfaceOutputQueuesQueueStateId(uint64 node_id,
   auto register_functor = RegisterFunc<PortQosCountersChangedEvent>();
   auto on_change_functor = GetOnChangeFunctor(
       node_id, port_id, queue_id, &PortQosCountersChangedEvent::GetQueueId);
-  node->SetOnTimerHandler(poll_functor)
+  node->MarkAsStatic()
+      ->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeRegistration(register_functor)
       ->SetOnChangeHandler(on_change_functor);
@@ -2204,7 +2213,8 @@ void SetUpQusQueuesQueueConfigId(uint32 queue_id, TreeNode* node,
     return SendResponse(GetResponse(path, queue_id), stream);
   };
   auto on_change_functor = UnsupportedFunc();
-  node->SetOnTimerHandler(poll_functor)
+  node->MarkAsStatic()
+      ->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeHandler(on_change_functor);
 }
@@ -2221,11 +2231,55 @@ void SetUpQusQueuesQueueStateId(uint32 queue_id, TreeNode* node,
     return SendResponse(GetResponse(path, queue_id), stream);
   };
   auto on_change_functor = UnsupportedFunc();
-  node->SetOnTimerHandler(poll_functor)
+  node->MarkAsStatic()
+      ->SetOnTimerHandler(poll_functor)
       ->SetOnPollHandler(poll_functor)
       ->SetOnChangeHandler(on_change_functor);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// /debug/metrics/debug-string
+// /debug/call-trace/chrome-trace
+void SetUpProcessDebugStringLeaf(std::function<std::string()> get_value,
+                                 TreeNode* node) {
+  // The value is process wide, so unlike the other debug leaves this one does
+  // not need to query the switch.
+  auto poll_functor = [get_value](const GnmiEvent& event,
+                                  const ::gnmi::Path& path,
+                                  GnmiSubscribeStream* stream) {
+    return SendResponse(GetResponse(path, get_value()), stream);
+  };
+  node->SetOnTimerHandler(poll_functor)->SetOnPollHandler(poll_functor);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// /debug/call-trace/enabled
+void SetUpDebugCallTraceEnabled(TreeNode* node) {
+  auto poll_functor = [](const GnmiEvent& event, const ::gnmi::Path& path,
+                         GnmiSubscribeStream* stream) {
+    return SendResponse(GetResponse(path, CallTracer::Global()->enabled()),
+                        stream);
+  };
+  auto on_set_functor =
+      [](const ::gnmi::Path& path, const ::google::protobuf::Message& val,
+         CopyOnWriteChassisConfig* config) -> ::util::Status {
+    const gnmi::TypedValue* typed_val =
+        dynamic_cast<const gnmi::TypedValue*>(&val);
+    if (typed_val == nullptr) {
+      return MAKE_ERROR(ERR_INVALID_PARAM) << "not a TypedValue message!";
+    }
+    // Tracing is a process wide debug facility, not a part of the chassis
+    // config, so the switch is not involved.
+    CallTracer::Global()->Enable(typed_val->bool_val());
+
+    return ::util::OkStatus();
+  };
+  node->SetOnTimerHandler(poll_functor)
+      ->SetOnPollHandler(poll_functor)
+      ->SetOnUpdateHandler(on_set_functor)
+      ->SetOnReplaceHandler(on_set_functor);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // /debug/nodes/node[name=<name>]/packet-io/debug-string
 void SetUpDebugNodesNodePacketIoDebugString(uint64 node_id, TreeNode* node,
@@ -2260,6 +2314,31 @@ void SetUpDebugNodesNodePacketIoDebugString(uint64 node_id, TreeNode* node,
   node->SetOnTimerHandler(poll_functor)->SetOnPollHandler(poll_functor);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// /debug/nodes/node[name=<name>]/l3-routes/debug-string
+void SetUpDebugNodesNodeL3RoutesDebugString(uint64 node_id, TreeNode* node,
+                                            YangParseTree* tree) {
+  // Same as /debug/nodes/node[name=<name>]/packet-io/debug-string.
+  auto poll_functor = [node_id, tree](const GnmiEvent& event,
+                                      const ::gnmi::Path& path,
+                                      GnmiSubscribeStream* stream) {
+    DataRequest req;
+    auto* request = req.add_requests()->mutable_node_l3_route_debug_info();
+    request->set_node_id(node_id);
+    std::string resp{};
+    DataResponseWriter writer([&resp](const DataResponse& in) {
+      if (!in.has_node_l3_route_debug_info()) return false;
+      resp = in.node_l3_route_debug_info().debug_string();
+      return true;
+    });
+    tree->GetSwitchInterface()
+        ->RetrieveValue(node_id, req, &writer, /* details= */ nullptr)
+        .IgnoreError();
+    return SendResponse(GetResponse(path, resp), stream);
+  };
+  node->SetOnTimerHandler(poll_functor)->SetOnPollHandler(poll_functor);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // /components/component[name=<name-of-component>]/integrated-circuit/config/node-id
 void SetUpComponentsComponentIntegratedCircuitConfigNodeId(uint64 node_id,
@@ -2271,7 +2350,8 @@ void SetUpComponentsComponentIntegratedCircuitConfigNodeId(uint64 node_id,
     return SendResponse(GetResponse(path, node_id), stream);
   };
   auto on_change_functor = UnsupportedFunc();
-  node->SetOnPollHandler(poll_functor)
+  node->MarkAsStatic()
+      ->SetOnPollHandler(poll_functor)
       ->SetOnTimerHandler(poll_functor)
       ->SetOnChangeHandler(on_change_functor);
 }
@@ -2287,7 +2367,8 @@ void SetUpComponentsComponentIntegratedCircuitStateNodeId(uint64 node_id,
     return SendResponse(GetResponse(path, node_id), stream);
   };
   auto on_change_functor = UnsupportedFunc();
-  node->SetOnPollHandler(poll_functor)
+  node->MarkAsStatic()
+      ->SetOnPollHandler(poll_functor)
       ->SetOnTimerHandler(poll_functor)
       ->SetOnChangeHandler(on_change_functor);
 }
@@ -2574,6 +2655,9 @@ void YangParseTreePaths::AddSubtreeNode(const Node& node, YangParseTree* tree) {
   TreeNode* tree_node = tree->AddNode(GetPath("debug")("nodes")(
       "node", node.name())("packet-io")("debug-string")());
   SetUpDebugNodesNodePacketIoDebugString(node.id(), tree_node, tree);
+  tree_node = tree->AddNode(GetPath("debug")("nodes")(
+      "node", node.name())("l3-routes")("debug-string")());
+  SetUpDebugNodesNodeL3RoutesDebugString(node.id(), tree_node, tree);
   tree_node = tree->AddNode(GetPath("components")("component", node.name())
       ("integrated-circuit")("config")("node-id")());
   SetUpComponentsComponentIntegratedCircuitConfigNodeId(node.id(),
@@ -2741,6 +2825,23 @@ void YangParseTreePaths::AddSubtreeAllInterfaces(YangParseTree* tree) {
       ->SetOnPollHandler(interfaces_on_poll);
 }
 
+void YangParseTreePaths::AddSubtreeProcessDebug(YangParseTree* tree) {
+  // Add support for "/debug/metrics/debug-string".
+  SetUpProcessDebugStringLeaf(
+      [] { return MetricsRegistry::Global()->DumpMetrics(); },
+      tree->AddNode(GetPath("debug")("metrics")("debug-string")()));
+  // Add support for "/debug/call-trace/chrome-trace". Returns all the calls
+  // recorded by the global CallTracer (e.g. the BCM SDK calls when the tracing
+  // is enabled) as Chrome trace-event JSON.
+  SetUpProcessDebugStringLeaf(
+      [] { return CallTracer::Global()->ToChromeTraceJson(); },
+      tree->AddNode(GetPath("debug")("call-trace")("chrome-trace")()));
+  // Add support for "/debug/call-trace/enabled". Turns the recording of the
+  // calls on and off at runtime.
+  SetUpDebugCallTraceEnabled(
+      tree->AddNode(GetPath("debug")("call-trace")("enabled")()));
+}
+
 void YangParseTreePaths::AddRoot(YangParseTree* tree) {
   // Add support for "/"
   SetUpRoot(tree->AddNode(GetPath()()), tree);
@@ -60,6 +60,12 @@ class YangParseTreePaths {
   static void AddSubtreeAllInterfaces(YangParseTree* tree)
       EXCLUSIVE_LOCKS_REQUIRED(tree->root_access_lock_);
 
+  // Adds the paths exposing the process wide debug state: the metrics (see
+  // stratum/lib/metrics.h) and the calls recorded by the call tracer (see
+  // stratum/lib/call_tracer.h).
+  static void AddSubtreeProcessDebug(YangParseTree* tree)
+      EXCLUSIVE_LOCKS_REQUIRED(tree->root_access_lock_);
+
   // Configure the root element.
   static void AddRoot(YangParseTree* tree)
       EXCLUSIVE_LOCKS_REQUIRED(tree->root_access_lock_);
@@ -24,7 +24,9 @@
 #include "stratum/hal/lib/common/switch_mock.h"
 #include "stratum/hal/lib/common/writer_mock.h"
 #include "stratum/lib/utils.h"
+#include "stratum/lib/call_tracer.h"
 #include "stratum/lib/constants.h"
+#include "stratum/lib/metrics.h"
 #include "stratum/lib/test_utils/matchers.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -597,6 +599,57 @@ TEST_F(YangParseTreeTest, PerformActionForAllNodesOnePresent) {
       GetPath("interfaces")("interface", "interface-1")("state")("ifindex")()));
 }
 
+// Check if the wildcard expansion cache is invalidated when the tree changes.
+TEST_F(YangParseTreeTest, PerformActionForAllNodesAfterTreeChange) {
+  int counter = 0;
+
+  const auto& action = [&counter](const TreeNode& leaf) {
+    // Count every execution of this action.
+    ++counter;
+    return ::util::OkStatus();
+  };
+
+  // No interface has been added yet, so the (cached) expansion is empty.
+  EXPECT_OK(PerformActionForAllNonWildcardNodes(
+      GetPath("interfaces")("interface")(), GetPath("state")("ifindex")(),
+      action));
+  EXPECT_EQ(0, counter);
+
+  // Adding an interface must drop the cached expansion.
+  AddSubtreeInterface("interface-1");
+  EXPECT_OK(PerformActionForAllNonWildcardNodes(
+      GetPath("interfaces")("interface")(), GetPath("state")("ifindex")(),
+      action));
+  EXPECT_EQ(1, counter);
+
+  // The cached expansion is used now.
+  EXPECT_OK(PerformActionForAllNonWildcardNodes(
+      GetPath("interfaces")("interface")(), GetPath("state")("ifindex")(),
+      action));
+  EXPECT_EQ(2, counter);
+}
+
+// Check if the precomputed path of a node matches the path it was added at.
+TEST_F(YangParseTreeTest, AddNodeSetsPath) {
+  auto path =
+      GetPath("interfaces")("interface", "interface-1")("state")("name")();
+  auto* node = AddNode(path);
+  ASSERT_NE(node, nullptr);
+  EXPECT_FALSE(compare_(node->GetPath(), path));
+  EXPECT_EQ(node, GetRoot().FindNodeOrNull(path));
+}
+
+// Check if adding an existing child returns the existing node.
+TEST_F(YangParseTreeTest, AddChildReturnsExistingChild) {
+  auto* node = AddNode(GetPath("interfaces")());
+  ASSERT_NE(node, nullptr);
+  auto* child = node->AddChild("interface");
+  ASSERT_NE(child, nullptr);
+  EXPECT_EQ(child, node->AddChild("interface"));
+  EXPECT_EQ(child, node->FindChildOrNull("interface"));
+  EXPECT_EQ(nullptr, node->FindChildOrNull("no-such-child"));
+}
+
 // Check if RetrieveValue is called.
 TEST_F(YangParseTreeTest, GetDataFromSwitchInterfaceCalled) {
   // Create a fake switch interface object.
@@ -3260,5 +3313,98 @@ TEST_F(YangParseTreeTest, DebugNodesNodePacketIoDebugStringOnPollSuccess) {
   EXPECT_EQ(resp.update().update(0).val().string_val(), kTestString);
 }
 
+// Check if /debug/nodes/node/l3-routes/debug-string
+// OnPoll action works correctly.
+TEST_F(YangParseTreeTest, DebugNodesNodeL3RoutesDebugStringOnPollSuccess) {
+  auto path = GetPath("debug")("nodes")(
+      "node", "node-1")("l3-routes")("debug-string")();
+  constexpr char kTestString[] = "VRF 80:\n";
+
+  // Mock implementation of RetrieveValue() that sends a response set to
+  // kTestString.
+  EXPECT_CALL(switch_, RetrieveValue(_, _, _, _))
+      .WillOnce(
+          DoAll(WithArg<2>(Invoke([&](WriterInterface<DataResponse>* w) {
+                  DataResponse resp;
+                  // Set the response.
+                  resp.mutable_node_l3_route_debug_info()->set_debug_string(
+                      kTestString);
+                  // Send it to the caller.
+                  w->Write(resp);
+                })),
+                Return(::util::OkStatus())));
+
+  // Call the event handler. 'resp' will contain the message that is sent to the
+  // controller.
+  ::gnmi::SubscribeResponse resp;
+  EXPECT_OK(ExecuteOnPoll(path, &resp));
+
+  // Check that the result of the call is what is expected.
+  ASSERT_EQ(resp.update().update_size(), 1);
+  EXPECT_EQ(resp.update().update(0).val().string_val(), kTestString);
+}
+
+// Check if /debug/metrics/debug-string OnPoll action works correctly.
+TEST_F(YangParseTreeTest, DebugMetricsDebugStringOnPollSuccess) {
+  auto path = GetPath("debug")("metrics")("debug-string")();
+  MetricsRegistry::Global()
+      ->GetCounter("yang_parse_tree_test/debug_metrics")
+      ->Add(42);
+
+  // Call the event handler. 'resp' will contain the message that is sent to the
+  // controller.
+  ::gnmi::SubscribeResponse resp;
+  EXPECT_OK(ExecuteOnPoll(path, &resp));
+
+  // Check that the result of the call is what is expected.
+  ASSERT_EQ(resp.update().update_size(), 1);
+  EXPECT_THAT(resp.update().update(0).val().string_val(),
+              HasSubstr("counter yang_parse_tree_test/debug_metrics 42\n"));
+}
+
+// Check if /debug/call-trace/chrome-trace OnPoll action works correctly.
+TEST_F(YangParseTreeTest, DebugCallTraceChromeTraceOnPollSuccess) {
+  auto path = GetPath("debug")("call-trace")("chrome-trace")();
+  CallTracer::Global()->Enable(true);
+  {
+    ScopedTraceEvent trace_event("test", "TracedCall", 0);
+  }
+  CallTracer::Global()->Enable(false);
+
+  // Call the event handler. 'resp' will contain the message that is sent to the
+  // controller.
+  ::gnmi::SubscribeResponse resp;
+  EXPECT_OK(ExecuteOnPoll(path, &resp));
+  CallTracer::Global()->Clear();
+
+  // Check that the result of the call is what is expected.
+  ASSERT_EQ(resp.update().update_size(), 1);
+  EXPECT_THAT(resp.update().update(0).val().string_val(),
+              HasSubstr("{\"name\":\"TracedCall\",\"cat\":\"test\""));
+}
+
+// Check if /debug/call-trace/enabled OnUpdate action works correctly.
+TEST_F(YangParseTreeTest, DebugCallTraceEnabledOnUpdateSuccess) {
+  auto path = GetPath("debug")("call-trace")("enabled")();
+  CallTracer::Global()->Enable(false);
+
+  // Set new value. The switch is not involved, so no SetRequest and no
+  // notification are expected.
+  ::gnmi::TypedValue val;
+  val.set_bool_val(true);
+  ASSERT_OK(ExecuteOnUpdate(path, val, nullptr, nullptr));
+  EXPECT_TRUE(CallTracer::Global()->enabled());
+
+  // The new value is reported back.
+  ::gnmi::SubscribeResponse resp;
+  EXPECT_OK(ExecuteOnPoll(path, &resp));
+  ASSERT_EQ(resp.update().update_size(), 1);
+  EXPECT_TRUE(resp.update().update(0).val().bool_val());
+
+  val.set_bool_val(false);
+  ASSERT_OK(ExecuteOnReplace(path, val, nullptr, nullptr));
+  EXPECT_FALSE(CallTracer::Global()->enabled());
+}
+
 }  // namespace hal
 }  // namespace stratum
@@ -48,21 +48,19 @@ namespace dummy_switch {
 
 ::util::Status DummyNode::PushForwardingPipelineConfig(
       const ::p4::v1::ForwardingPipelineConfig& config) {
-  // TODO(Yi Tseng): Implement this method.
   absl::WriterMutexLock l(&node_lock_);
-  return ::util::OkStatus();
+  return table_store_->PushP4Info(config.p4info());
 }
 
 ::util::Status DummyNode::VerifyForwardingPipelineConfig(
     const ::p4::v1::ForwardingPipelineConfig& config) {
-  // TODO(Yi Tseng): Implement this method.
   absl::ReaderMutexLock l(&node_lock_);
-  return ::util::OkStatus();
+  return table_store_->VerifyP4Info(config.p4info());
 }
 
 ::util::Status DummyNode::Shutdown() {
-  // TODO(Yi Tseng): Implement this method.
   absl::WriterMutexLock l(&node_lock_);
+  table_store_->Clear();
   return ::util::OkStatus();
 }
 
@@ -80,18 +78,16 @@ namespace dummy_switch {
 ::util::Status DummyNode::WriteForwardingEntries(
       const ::p4::v1::WriteRequest& req,
       std::vector<::util::Status>* results) {
-  // TODO(Yi Tseng): Implement this method.
   absl::WriterMutexLock l(&node_lock_);
-  return ::util::OkStatus();
+  return table_store_->Write(req, results);
 }
 
 ::util::Status DummyNode::ReadForwardingEntries(
     const ::p4::v1::ReadRequest& req,
     WriterInterface<::p4::v1::ReadResponse>* writer,
     std::vector<::util::Status>* details) {
-  // TODO(Yi Tseng): Implement this method.
   absl::ReaderMutexLock l(&node_lock_);
-  return ::util::OkStatus();
+  return table_store_->Read(req, writer, details);
 }
 
 ::util::Status DummyNode::RegisterPacketReceiveWriter(
@@ -372,7 +368,8 @@ DummyNode::DummyNode(const uint64 id, const std::string& name,
     name_(name),
     slot_(slot),
     index_(index),
-    dummy_box_(DummyBox::GetSingleton()) {}
+    dummy_box_(DummyBox::GetSingleton()),
+    table_store_(DummyTableStore::CreateInstance()) {}
 
 }  // namespace dummy_switch
 }  // namespace hal
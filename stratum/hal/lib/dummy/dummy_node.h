@@ -29,6 +29,7 @@
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/dummy/dummy_box.h"
 #include "stratum/hal/lib/dummy/dummy_global_vars.h"
+#include "stratum/hal/lib/dummy/dummy_table_store.h"
 #include "stratum/hal/lib/common/gnmi_events.h"
 
 namespace stratum {
@@ -180,6 +181,8 @@ class DummyNode {
   int32 slot_;
   int32 index_;
   DummyBox* dummy_box_;
+  // The forwarding state written by the P4Runtime controller.
+  std::unique_ptr<DummyTableStore> table_store_ GUARDED_BY(node_lock_);
 
   // Should use CreateInstance to create new DummyNode instance
   DummyNode(const uint64 id, const std::string& name,
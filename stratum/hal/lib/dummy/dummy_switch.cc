@@ -210,6 +210,32 @@ namespace dummy_switch {
   return node->UnregisterPacketReceiveWriter();
 }
 
+::util::Status DummySwitch::RegisterDigestReceiveWriter(
+    uint64 node_id,
+    std::shared_ptr<WriterInterface<::p4::v1::DigestList>> writer) {
+  return MAKE_ERROR(ERR_UNIMPLEMENTED)
+         << "Digests are not supported by the dummy switch.";
+}
+
+::util::Status DummySwitch::UnregisterDigestReceiveWriter(uint64 node_id) {
+  return MAKE_ERROR(ERR_UNIMPLEMENTED)
+         << "Digests are not supported by the dummy switch.";
+}
+
+::util::Status DummySwitch::RegisterIdleTimeoutNotificationWriter(
+    uint64 node_id,
+    std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>
+        writer) {
+  return MAKE_ERROR(ERR_UNIMPLEMENTED)
+         << "Idle timeouts are not supported by the dummy switch.";
+}
+
+::util::Status DummySwitch::UnregisterIdleTimeoutNotificationWriter(
+    uint64 node_id) {
+  return MAKE_ERROR(ERR_UNIMPLEMENTED)
+         << "Idle timeouts are not supported by the dummy switch.";
+}
+
 ::util::Status DummySwitch::TransmitPacket(uint64 node_id,
                               const ::p4::v1::PacketOut& packet) {
   absl::ReaderMutexLock l(&chassis_lock);
@@ -0,0 +1,977 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/dummy/dummy_table_store.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "absl/container/inlined_vector.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "stratum/glue/gtl/map_util.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/p4/p4_info_manager.h"
+#include "stratum/lib/macros.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+namespace dummy_switch {
+
+constexpr int DummyTableStore::kMaxEntitiesPerReadResponse;
+
+namespace {
+
+using ::p4::config::v1::MatchField;
+
+// Returns the number of bytes needed to hold a value of the given bitwidth.
+int NumBytes(int bitwidth) { return (bitwidth + 7) / 8; }
+
+// Removes the leading zero bytes of a P4Runtime bytestring. P4Runtime allows
+// both the canonical (shortest) and the padded representations of a value, so
+// the values are compared once stripped.
+absl::string_view StripLeadingZeros(absl::string_view value) {
+  size_t i = 0;
+  while (i < value.size() && value[i] == '\0') ++i;
+  return value.substr(i);
+}
+
+// Returns true if the stripped big-endian value fits in bitwidth bits.
+bool FitsInBitwidth(absl::string_view stripped, int bitwidth) {
+  if (stripped.empty()) return true;
+  int num_bits = (stripped.size() - 1) * 8;
+  for (uint8 msb = stripped[0]; msb != 0; msb >>= 1) ++num_bits;
+  return num_bits <= bitwidth;
+}
+
+// Appends the stripped value to the key, left-padded with zeros to width
+// bytes. The width of each match field is fixed, so the values of the fields
+// do not need separators.
+void AppendPadded(absl::string_view stripped, int width, std::string* key) {
+  key->append(width - stripped.size(), '\0');
+  key->append(stripped.data(), stripped.size());
+}
+
+// Appends a 32-bit integer to the key, in big-endian order.
+void AppendUint32(uint32 value, std::string* key) {
+  char bytes[4] = {static_cast<char>(value >> 24),
+                   static_cast<char>(value >> 16),
+                   static_cast<char>(value >> 8), static_cast<char>(value)};
+  key->append(bytes, sizeof(bytes));
+}
+
+// Verifies that a bytestring is a valid value for the given bitwidth, and
+// returns it stripped. The kind and ID of the value (e.g. "match field" 1) are
+// only used for the error messages.
+::util::StatusOr<absl::string_view> VerifyValue(const std::string& value,
+                                                int bitwidth, const char* kind,
+                                                uint32 id) {
+  if (value.empty()) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Empty value for " << kind << " " << id << ".";
+  }
+  absl::string_view stripped = StripLeadingZeros(value);
+  if (!FitsInBitwidth(stripped, bitwidth)) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Value of " << kind << " " << id << " does not fit in "
+           << bitwidth << " bits.";
+  }
+  return stripped;
+}
+
+// Returns true if the bits of the padded value of the given bitwidth are all
+// zero after the first prefix_len bits.
+bool IsZeroAfterPrefix(absl::string_view padded, int bitwidth,
+                       int prefix_len) {
+  int first_bit = padded.size() * 8 - bitwidth + prefix_len;
+  for (size_t i = first_bit / 8; i < padded.size(); ++i) {
+    uint8 mask = 0xff;
+    if (i == static_cast<size_t>(first_bit / 8)) mask >>= first_bit % 8;
+    if (static_cast<uint8>(padded[i]) & mask) return false;
+  }
+  return true;
+}
+
+// Returns true if the given table entry action refers to an action profile
+// member or group.
+bool IsIndirectAction(const ::p4::v1::TableAction& action) {
+  return action.type_case() ==
+             ::p4::v1::TableAction::kActionProfileMemberId ||
+         action.type_case() == ::p4::v1::TableAction::kActionProfileGroupId;
+}
+
+// Adds the entity to the response, and writes the response once it is full.
+template <typename Fn>
+::util::Status AddEntity(::p4::v1::ReadResponse* resp,
+                         WriterInterface<::p4::v1::ReadResponse>* writer,
+                         Fn fill_entity) {
+  fill_entity(resp->add_entities());
+  if (resp->entities_size() >= DummyTableStore::kMaxEntitiesPerReadResponse) {
+    if (!writer->Write(*resp)) {
+      return MAKE_ERROR(ERR_INTERNAL) << "Write to stream failed.";
+    }
+    resp->Clear();
+  }
+  return ::util::OkStatus();
+}
+
+}  // namespace
+
+DummyTableStore::DummyTableStore()
+    : pipeline_pushed_(false), num_table_entries_(0) {}
+
+std::unique_ptr<DummyTableStore> DummyTableStore::CreateInstance() {
+  return absl::WrapUnique(new DummyTableStore());
+}
+
+::util::Status DummyTableStore::VerifyP4Info(
+    const ::p4::config::v1::P4Info& p4_info) const {
+  P4InfoManager p4_info_manager(p4_info);
+  return p4_info_manager.InitializeAndVerify();
+}
+
+::util::Status DummyTableStore::PushP4Info(
+    const ::p4::config::v1::P4Info& p4_info) {
+  RETURN_IF_ERROR(VerifyP4Info(p4_info));
+  Clear();
+  // Cache what the validation of the entities needs, so that writes do not
+  // have to look up (and copy) the P4Info protos.
+  for (const auto& p4_table : p4_info.tables()) {
+    Table& table = tables_[p4_table.preamble().id()];
+    table.id = p4_table.preamble().id();
+    table.name = p4_table.preamble().name();
+    table.num_exact_fields = 0;
+    table.needs_priority = false;
+    for (const auto& match_field : p4_table.match_fields()) {
+      table.match_fields[match_field.id()] = {match_field.match_type(),
+                                              match_field.bitwidth()};
+      switch (match_field.match_type()) {
+        case MatchField::EXACT:
+          ++table.num_exact_fields;
+          break;
+        case MatchField::TERNARY:
+        case MatchField::RANGE:
+          table.needs_priority = true;
+          break;
+        default:
+          break;
+      }
+    }
+    for (const auto& action_ref : p4_table.action_refs()) {
+      table.action_ids.insert(action_ref.id());
+    }
+    table.action_profile_id = p4_table.implementation_id();
+    table.const_default_action_id = p4_table.const_default_action_id();
+    table.is_const = p4_table.is_const_table();
+  }
+  for (const auto& p4_action : p4_info.actions()) {
+    Action& action = actions_[p4_action.preamble().id()];
+    for (const auto& param : p4_action.params()) {
+      action.param_bitwidths[param.id()] = param.bitwidth();
+    }
+  }
+  for (const auto& p4_action_profile : p4_info.action_profiles()) {
+    ActionProfile& action_profile =
+        action_profiles_[p4_action_profile.preamble().id()];
+    action_profile.table_ids.insert(p4_action_profile.table_ids().begin(),
+                                    p4_action_profile.table_ids().end());
+    action_profile.with_selector = p4_action_profile.with_selector();
+    action_profile.max_group_size = p4_action_profile.max_group_size();
+  }
+  pipeline_pushed_ = true;
+
+  return ::util::OkStatus();
+}
+
+::util::Status DummyTableStore::Write(const ::p4::v1::WriteRequest& req,
+                                      std::vector<::util::Status>* results) {
+  CHECK_RETURN_IF_FALSE(results) << "Results pointer must be non-null.";
+  if (!pipeline_pushed_) {
+    return MAKE_ERROR(ERR_NOT_INITIALIZED)
+           << "No forwarding pipeline config pushed.";
+  }
+  bool success = true;
+  for (const auto& update : req.updates()) {
+    ::util::Status status = ::util::OkStatus();
+    if (update.type() == ::p4::v1::Update::UNSPECIFIED) {
+      status = MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Unspecified update type: " << update.ShortDebugString()
+               << ".";
+    } else {
+      const auto& entity = update.entity();
+      switch (entity.entity_case()) {
+        case ::p4::v1::Entity::kTableEntry:
+          status = WriteTableEntry(entity.table_entry(), update.type());
+          break;
+        case ::p4::v1::Entity::kActionProfileMember:
+          status = WriteActionProfileMember(entity.action_profile_member(),
+                                            update.type());
+          break;
+        case ::p4::v1::Entity::kActionProfileGroup:
+          status = WriteActionProfileGroup(entity.action_profile_group(),
+                                           update.type());
+          break;
+        case ::p4::v1::Entity::kPacketReplicationEngineEntry:
+          status = WritePacketReplicationEngineEntry(
+              entity.packet_replication_engine_entry(), update.type());
+          break;
+        case ::p4::v1::Entity::ENTITY_NOT_SET:
+          status = MAKE_ERROR(ERR_INVALID_PARAM)
+                   << "Empty entity: " << entity.ShortDebugString() << ".";
+          break;
+        default:
+          status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
+                   << "Unsupported entity type " << entity.entity_case()
+                   << ": " << entity.ShortDebugString() << ".";
+          break;
+      }
+    }
+    success &= status.ok();
+    results->push_back(status);
+  }
+
+  if (!success) {
+    return MAKE_ERROR(ERR_AT_LEAST_ONE_OPER_FAILED)
+           << "One or more write operations failed.";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status DummyTableStore::Read(
+    const ::p4::v1::ReadRequest& req,
+    WriterInterface<::p4::v1::ReadResponse>* writer,
+    std::vector<::util::Status>* details) const {
+  CHECK_RETURN_IF_FALSE(writer) << "Channel writer must be non-null.";
+  CHECK_RETURN_IF_FALSE(details) << "Details pointer must be non-null.";
+  if (!pipeline_pushed_) {
+    return MAKE_ERROR(ERR_NOT_INITIALIZED)
+           << "No forwarding pipeline config pushed.";
+  }
+  ::p4::v1::ReadResponse resp;
+  for (const auto& entity : req.entities()) {
+    ::util::Status status = ::util::OkStatus();
+    switch (entity.entity_case()) {
+      case ::p4::v1::Entity::kTableEntry:
+        status = ReadTableEntries(entity.table_entry(), &resp, writer);
+        break;
+      case ::p4::v1::Entity::kActionProfileMember:
+        status = ReadActionProfileMembers(entity.action_profile_member(),
+                                          &resp, writer);
+        break;
+      case ::p4::v1::Entity::kActionProfileGroup:
+        status = ReadActionProfileGroups(entity.action_profile_group(), &resp,
+                                         writer);
+        break;
+      case ::p4::v1::Entity::kPacketReplicationEngineEntry:
+        status = ReadPacketReplicationEngineEntries(
+            entity.packet_replication_engine_entry(), &resp, writer);
+        break;
+      case ::p4::v1::Entity::ENTITY_NOT_SET:
+        status = MAKE_ERROR(ERR_INVALID_PARAM)
+                 << "Empty entity: " << entity.ShortDebugString() << ".";
+        break;
+      default:
+        status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
+                 << "Unsupported entity type " << entity.entity_case() << ": "
+                 << entity.ShortDebugString() << ".";
+        break;
+    }
+    // A failed stream write ends the read, unlike an invalid entity.
+    if (status.error_code() == ERR_INTERNAL) return status;
+    details->push_back(status);
+  }
+  if (resp.entities_size() > 0 && !writer->Write(resp)) {
+    return MAKE_ERROR(ERR_INTERNAL) << "Write to stream failed.";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::StatusOr<::p4::v1::TableEntry> DummyTableStore::LookupTableEntry(
+    const ::p4::v1::TableEntry& entry) const {
+  const Table* table = gtl::FindOrNull(tables_, entry.table_id());
+  if (table == nullptr) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Unknown table ID " << entry.table_id() << ".";
+  }
+  std::string key;
+  RETURN_IF_ERROR(BuildTableEntryKey(*table, entry, &key));
+  auto it = table->entries.find(key);
+  if (it == table->entries.end()) {
+    return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+           << "Table entry not found: " << entry.ShortDebugString() << ".";
+  }
+  ::p4::v1::TableEntry stored;
+  CHECK_RETURN_IF_FALSE(stored.ParseFromString(it->second));
+  return stored;
+}
+
+void DummyTableStore::Clear() {
+  tables_.clear();
+  actions_.clear();
+  action_profiles_.clear();
+  multicast_groups_.clear();
+  clone_sessions_.clear();
+  pipeline_pushed_ = false;
+  num_table_entries_ = 0;
+}
+
+::util::Status DummyTableStore::WriteTableEntry(
+    const ::p4::v1::TableEntry& entry, ::p4::v1::Update::Type type) {
+  ASSIGN_OR_RETURN(Table* table, GetTable(entry.table_id()));
+  if (table->is_const) {
+    return MAKE_ERROR(ERR_PERMISSION_DENIED)
+           << "Table " << table->name << " is const.";
+  }
+  if (entry.is_default_action()) {
+    return WriteDefaultEntry(table, entry, type);
+  }
+  std::string key;
+  RETURN_IF_ERROR(BuildTableEntryKey(*table, entry, &key));
+
+  switch (type) {
+    case ::p4::v1::Update::INSERT: {
+      RETURN_IF_ERROR(VerifyTableAction(*table, entry.action()));
+      std::string& value = table->entries[key];
+      if (!value.empty()) {
+        return MAKE_ERROR(ERR_ENTRY_EXISTS)
+               << "Table entry already exists: " << entry.ShortDebugString()
+               << ".";
+      }
+      entry.SerializeToString(&value);
+      UpdateRefCount(*table, entry.action(), 1);
+      ++num_table_entries_;
+      break;
+    }
+    case ::p4::v1::Update::MODIFY: {
+      auto it = table->entries.find(key);
+      if (it == table->entries.end()) {
+        return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+               << "Table entry not found: " << entry.ShortDebugString() << ".";
+      }
+      RETURN_IF_ERROR(VerifyTableAction(*table, entry.action()));
+      if (table->action_profile_id != 0) {
+        ::p4::v1::TableEntry old_entry;
+        CHECK_RETURN_IF_FALSE(old_entry.ParseFromString(it->second));
+        UpdateRefCount(*table, old_entry.action(), -1);
+      }
+      entry.SerializeToString(&it->second);
+      UpdateRefCount(*table, entry.action(), 1);
+      break;
+    }
+    case ::p4::v1::Update::DELETE: {
+      auto it = table->entries.find(key);
+      if (it == table->entries.end()) {
+        return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+               << "Table entry not found: " << entry.ShortDebugString() << ".";
+      }
+      if (table->action_profile_id != 0) {
+        ::p4::v1::TableEntry old_entry;
+        CHECK_RETURN_IF_FALSE(old_entry.ParseFromString(it->second));
+        UpdateRefCount(*table, old_entry.action(), -1);
+      }
+      table->entries.erase(it);
+      --num_table_entries_;
+      break;
+    }
+    default:
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Invalid update type " << type << ".";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status DummyTableStore::WriteDefaultEntry(
+    Table* table, const ::p4::v1::TableEntry& entry,
+    ::p4::v1::Update::Type type) {
+  if (type != ::p4::v1::Update::MODIFY) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "The default entry of table " << table->name
+           << " can only be modified.";
+  }
+  if (entry.match_size() > 0 || entry.priority() != 0) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "The default entry of table " << table->name
+           << " cannot have match fields or a priority.";
+  }
+  if (table->const_default_action_id != 0) {
+    return MAKE_ERROR(ERR_PERMISSION_DENIED)
+           << "The default action of table " << table->name << " is const.";
+  }
+  // An entry without action resets the default action of the table.
+  if (!entry.has_action()) {
+    table->default_entry.clear();
+    return ::util::OkStatus();
+  }
+  if (entry.action().type_case() != ::p4::v1::TableAction::kAction) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "The default action of table " << table->name
+           << " must be a direct action.";
+  }
+  if (!table->action_ids.count(entry.action().action().action_id())) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Action " << entry.action().action().action_id()
+           << " is not an action of table " << table->name << ".";
+  }
+  RETURN_IF_ERROR(VerifyAction(entry.action().action()));
+  entry.SerializeToString(&table->default_entry);
+
+  return ::util::OkStatus();
+}
+
+::util::Status DummyTableStore::WriteActionProfileMember(
+    const ::p4::v1::ActionProfileMember& member, ::p4::v1::Update::Type type) {
+  ASSIGN_OR_RETURN(ActionProfile* action_profile,
+                   GetActionProfile(member.action_profile_id()));
+  if (type != ::p4::v1::Update::DELETE) {
+    RETURN_IF_ERROR(VerifyAction(member.action()));
+    for (uint32 table_id : action_profile->table_ids) {
+      const Table* table = gtl::FindOrNull(tables_, table_id);
+      if (table != nullptr &&
+          !table->action_ids.count(member.action().action_id())) {
+        return MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Action " << member.action().action_id()
+               << " is not an action of table " << table->name << ".";
+      }
+    }
+  }
+  auto it = action_profile->members.find(member.member_id());
+  switch (type) {
+    case ::p4::v1::Update::INSERT:
+      if (it != action_profile->members.end()) {
+        return MAKE_ERROR(ERR_ENTRY_EXISTS)
+               << "Member " << member.member_id() << " already exists.";
+      }
+      action_profile->members[member.member_id()] = {member, 0};
+      break;
+    case ::p4::v1::Update::MODIFY:
+      if (it == action_profile->members.end()) {
+        return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+               << "Member " << member.member_id() << " not found.";
+      }
+      it->second.member = member;
+      break;
+    case ::p4::v1::Update::DELETE:
+      if (it == action_profile->members.end()) {
+        return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+               << "Member " << member.member_id() << " not found.";
+      }
+      if (it->second.ref_count > 0) {
+        return MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Member " << member.member_id() << " is still used by "
+               << it->second.ref_count << " groups or table entries.";
+      }
+      action_profile->members.erase(it);
+      break;
+    default:
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Invalid update type " << type << ".";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status DummyTableStore::WriteActionProfileGroup(
+    const ::p4::v1::ActionProfileGroup& group, ::p4::v1::Update::Type type) {
+  ASSIGN_OR_RETURN(ActionProfile* action_profile,
+                   GetActionProfile(group.action_profile_id()));
+  if (!action_profile->with_selector) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Action profile " << group.action_profile_id()
+           << " has no selector, it cannot have groups.";
+  }
+  if (type != ::p4::v1::Update::DELETE) {
+    if (action_profile->max_group_size > 0 &&
+        group.members_size() > action_profile->max_group_size) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Group " << group.group_id() << " has more than "
+             << action_profile->max_group_size << " members.";
+    }
+    if (group.max_size() > 0 && group.members_size() > group.max_size()) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Group " << group.group_id() << " has more than its max_size "
+             << group.max_size() << " members.";
+    }
+    absl::flat_hash_set<uint32> member_ids;
+    for (const auto& member : group.members()) {
+      if (!action_profile->members.count(member.member_id())) {
+        return MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Member " << member.member_id() << " of group "
+               << group.group_id() << " not found.";
+      }
+      if (!member_ids.insert(member.member_id()).second) {
+        return MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Duplicate member " << member.member_id() << " in group "
+               << group.group_id() << ".";
+      }
+    }
+  }
+  auto it = action_profile->groups.find(group.group_id());
+  switch (type) {
+    case ::p4::v1::Update::INSERT:
+      if (it != action_profile->groups.end()) {
+        return MAKE_ERROR(ERR_ENTRY_EXISTS)
+               << "Group " << group.group_id() << " already exists.";
+      }
+      for (const auto& member : group.members()) {
+        ++action_profile->members[member.member_id()].ref_count;
+      }
+      action_profile->groups[group.group_id()] = {group, 0};
+      break;
+    case ::p4::v1::Update::MODIFY:
+      if (it == action_profile->groups.end()) {
+        return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+               << "Group " << group.group_id() << " not found.";
+      }
+      for (const auto& member : it->second.group.members()) {
+        --action_profile->members[member.member_id()].ref_count;
+      }
+      for (const auto& member : group.members()) {
+        ++action_profile->members[member.member_id()].ref_count;
+      }
+      it->second.group = group;
+      break;
+    case ::p4::v1::Update::DELETE:
+      if (it == action_profile->groups.end()) {
+        return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+               << "Group " << group.group_id() << " not found.";
+      }
+      if (it->second.ref_count > 0) {
+        return MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Group " << group.group_id() << " is still used by "
+               << it->second.ref_count << " table entries.";
+      }
+      for (const auto& member : it->second.group.members()) {
+        --action_profile->members[member.member_id()].ref_count;
+      }
+      action_profile->groups.erase(it);
+      break;
+    default:
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Invalid update type " << type << ".";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status DummyTableStore::WritePacketReplicationEngineEntry(
+    const ::p4::v1::PacketReplicationEngineEntry& entry,
+    ::p4::v1::Update::Type type) {
+  // Both entry types are a map from a non-zero ID to a list of replicas, with
+  // unique (egress_port, instance) pairs.
+  auto write = [type](uint32 id, const auto& new_entry,
+                      auto* entries) -> ::util::Status {
+    if (id == 0) {
+      return MAKE_ERROR(ERR_INVALID_PARAM) << "Zero multicast or clone ID.";
+    }
+    absl::flat_hash_set<std::pair<uint32, uint32>> replicas;
+    for (const auto& replica : new_entry.replicas()) {
+      if (!replicas.emplace(replica.egress_port(), replica.instance())
+               .second) {
+        return MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Duplicate replica " << replica.ShortDebugString() << ".";
+      }
+    }
+    auto it = entries->find(id);
+    switch (type) {
+      case ::p4::v1::Update::INSERT:
+        if (it != entries->end()) {
+          return MAKE_ERROR(ERR_ENTRY_EXISTS)
+                 << "Entry " << id << " already exists.";
+        }
+        entries->emplace(id, new_entry);
+        break;
+      case ::p4::v1::Update::MODIFY:
+        if (it == entries->end()) {
+          return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+                 << "Entry " << id << " not found.";
+        }
+        it->second = new_entry;
+        break;
+      case ::p4::v1::Update::DELETE:
+        if (it == entries->end()) {
+          return MAKE_ERROR(ERR_ENTRY_NOT_FOUND)
+                 << "Entry " << id << " not found.";
+        }
+        entries->erase(it);
+        break;
+      default:
+        return MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Invalid update type " << type << ".";
+    }
+    return ::util::OkStatus();
+  };
+  switch (entry.type_case()) {
+    case ::p4::v1::PacketReplicationEngineEntry::kMulticastGroupEntry:
+      return write(entry.multicast_group_entry().multicast_group_id(),
+                   entry.multicast_group_entry(), &multicast_groups_);
+    case ::p4::v1::PacketReplicationEngineEntry::kCloneSessionEntry:
+      return write(entry.clone_session_entry().session_id(),
+                   entry.clone_session_entry(), &clone_sessions_);
+    default:
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Empty packet replication engine entry.";
+  }
+}
+
+::util::Status DummyTableStore::ReadTableEntries(
+    const ::p4::v1::TableEntry& filter, ::p4::v1::ReadResponse* resp,
+    WriterInterface<::p4::v1::ReadResponse>* writer) const {
+  // A single entry, looked up by key.
+  if (filter.table_id() != 0 && filter.match_size() > 0) {
+    ::util::StatusOr<::p4::v1::TableEntry> entry = LookupTableEntry(filter);
+    if (entry.status().error_code() == ERR_ENTRY_NOT_FOUND) {
+      return ::util::OkStatus();
+    }
+    RETURN_IF_ERROR(entry.status());
+    return AddEntity(resp, writer, [&entry](::p4::v1::Entity* entity) {
+      *entity->mutable_table_entry() = entry.ValueOrDie();
+    });
+  }
+  auto read_table = [&filter, resp,
+                     writer](const Table& table) -> ::util::Status {
+    if (filter.is_default_action()) {
+      if (table.default_entry.empty()) return ::util::OkStatus();
+      return AddEntity(resp, writer, [&table](::p4::v1::Entity* entity) {
+        entity->mutable_table_entry()->ParseFromString(table.default_entry);
+      });
+    }
+    for (const auto& e : table.entries) {
+      RETURN_IF_ERROR(AddEntity(resp, writer, [&e](::p4::v1::Entity* entity) {
+        entity->mutable_table_entry()->ParseFromString(e.second);
+      }));
+    }
+    return ::util::OkStatus();
+  };
+  if (filter.table_id() == 0) {
+    for (const auto& e : tables_) RETURN_IF_ERROR(read_table(e.second));
+    return ::util::OkStatus();
+  }
+  const Table* table = gtl::FindOrNull(tables_, filter.table_id());
+  if (table == nullptr) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Unknown table ID " << filter.table_id() << ".";
+  }
+
+  return read_table(*table);
+}
+
+::util::Status DummyTableStore::ReadActionProfileMembers(
+    const ::p4::v1::ActionProfileMember& filter, ::p4::v1::ReadResponse* resp,
+    WriterInterface<::p4::v1::ReadResponse>* writer) const {
+  for (const auto& action_profile : action_profiles_) {
+    if (filter.action_profile_id() != 0 &&
+        filter.action_profile_id() != action_profile.first) {
+      continue;
+    }
+    for (const auto& e : action_profile.second.members) {
+      if (filter.member_id() != 0 && filter.member_id() != e.first) continue;
+      RETURN_IF_ERROR(AddEntity(resp, writer, [&e](::p4::v1::Entity* entity) {
+        *entity->mutable_action_profile_member() = e.second.member;
+      }));
+    }
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status DummyTableStore::ReadActionProfileGroups(
+    const ::p4::v1::ActionProfileGroup& filter, ::p4::v1::ReadResponse* resp,
+    WriterInterface<::p4::v1::ReadResponse>* writer) const {
+  for (const auto& action_profile : action_profiles_) {
+    if (filter.action_profile_id() != 0 &&
+        filter.action_profile_id() != action_profile.first) {
+      continue;
+    }
+    for (const auto& e : action_profile.second.groups) {
+      if (filter.group_id() != 0 && filter.group_id() != e.first) continue;
+      RETURN_IF_ERROR(AddEntity(resp, writer, [&e](::p4::v1::Entity* entity) {
+        *entity->mutable_action_profile_group() = e.second.group;
+      }));
+    }
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status DummyTableStore::ReadPacketReplicationEngineEntries(
+    const ::p4::v1::PacketReplicationEngineEntry& filter,
+    ::p4::v1::ReadResponse* resp,
+    WriterInterface<::p4::v1::ReadResponse>* writer) const {
+  if (filter.has_multicast_group_entry()) {
+    uint32 id = filter.multicast_group_entry().multicast_group_id();
+    for (const auto& e : multicast_groups_) {
+      if (id != 0 && id != e.first) continue;
+      RETURN_IF_ERROR(AddEntity(resp, writer, [&e](::p4::v1::Entity* entity) {
+        *entity->mutable_packet_replication_engine_entry()
+             ->mutable_multicast_group_entry() = e.second;
+      }));
+    }
+  }
+  if (filter.has_clone_session_entry()) {
+    uint32 id = filter.clone_session_entry().session_id();
+    for (const auto& e : clone_sessions_) {
+      if (id != 0 && id != e.first) continue;
+      RETURN_IF_ERROR(AddEntity(resp, writer, [&e](::p4::v1::Entity* entity) {
+        *entity->mutable_packet_replication_engine_entry()
+             ->mutable_clone_session_entry() = e.second;
+      }));
+    }
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status DummyTableStore::BuildTableEntryKey(
+    const Table& table, const ::p4::v1::TableEntry& entry,
+    std::string* key) const {
+  if (table.needs_priority && entry.priority() <= 0) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Entries of table " << table.name << " need a priority.";
+  }
+  if (!table.needs_priority && entry.priority() != 0) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Entries of table " << table.name << " cannot have a priority.";
+  }
+  // Sort the fields by ID, for the key not to depend on their order.
+  absl::InlinedVector<const ::p4::v1::FieldMatch*, 8> fields;
+  for (const auto& field : entry.match()) fields.push_back(&field);
+  std::sort(fields.begin(), fields.end(),
+            [](const ::p4::v1::FieldMatch* a, const ::p4::v1::FieldMatch* b) {
+              return a->field_id() < b->field_id();
+            });
+
+  key->clear();
+  AppendUint32(entry.priority(), key);
+  int num_exact_fields = 0;
+  for (size_t i = 0; i < fields.size(); ++i) {
+    const ::p4::v1::FieldMatch& field = *fields[i];
+    if (i > 0 && field.field_id() == fields[i - 1]->field_id()) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Duplicate match field " << field.field_id() << ".";
+    }
+    const MatchFieldInfo* info =
+        gtl::FindOrNull(table.match_fields, field.field_id());
+    if (info == nullptr) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Unknown match field " << field.field_id() << " in table "
+             << table.name << ".";
+    }
+    const uint32 id = field.field_id();
+    const int width = NumBytes(info->bitwidth);
+    AppendUint32(id, key);
+    switch (field.field_match_type_case()) {
+      case ::p4::v1::FieldMatch::kExact: {
+        CHECK_RETURN_IF_FALSE(info->match_type == MatchField::EXACT)
+            << "Invalid match type for match field " << id << ".";
+        ASSIGN_OR_RETURN(absl::string_view value,
+                         VerifyValue(field.exact().value(), info->bitwidth,
+                                     "match field", id));
+        AppendPadded(value, width, key);
+        ++num_exact_fields;
+        break;
+      }
+      case ::p4::v1::FieldMatch::kLpm: {
+        CHECK_RETURN_IF_FALSE(info->match_type == MatchField::LPM)
+            << "Invalid match type for match field " << id << ".";
+        int prefix_len = field.lpm().prefix_len();
+        CHECK_RETURN_IF_FALSE(prefix_len > 0 && prefix_len <= info->bitwidth)
+            << "Invalid prefix length " << prefix_len << " for match field "
+            << id << ", a zero prefix length must be omitted.";
+        ASSIGN_OR_RETURN(absl::string_view value,
+                         VerifyValue(field.lpm().value(), info->bitwidth,
+                                     "match field", id));
+        size_t offset = key->size();
+        AppendPadded(value, width, key);
+        CHECK_RETURN_IF_FALSE(IsZeroAfterPrefix(
+            absl::string_view(*key).substr(offset), info->bitwidth,
+            prefix_len))
+            << "Bits after the prefix of match field " << id
+            << " must be zero.";
+        AppendUint32(prefix_len, key);
+        break;
+      }
+      case ::p4::v1::FieldMatch::kTernary: {
+        CHECK_RETURN_IF_FALSE(info->match_type == MatchField::TERNARY)
+            << "Invalid match type for match field " << id << ".";
+        ASSIGN_OR_RETURN(absl::string_view value,
+                         VerifyValue(field.ternary().value(), info->bitwidth,
+                                     "match field", id));
+        ASSIGN_OR_RETURN(absl::string_view mask,
+                         VerifyValue(field.ternary().mask(), info->bitwidth,
+                                     "match field", id));
+        CHECK_RETURN_IF_FALSE(!mask.empty())
+            << "Zero mask for match field " << id << ", it must be omitted.";
+        size_t offset = key->size();
+        AppendPadded(value, width, key);
+        AppendPadded(mask, width, key);
+        for (int j = 0; j < width; ++j) {
+          uint8 value_byte = (*key)[offset + j];
+          uint8 mask_byte = (*key)[offset + width + j];
+          CHECK_RETURN_IF_FALSE((value_byte & ~mask_byte) == 0)
+              << "Masked off bits of match field " << id << " must be zero.";
+        }
+        break;
+      }
+      case ::p4::v1::FieldMatch::kRange: {
+        CHECK_RETURN_IF_FALSE(info->match_type == MatchField::RANGE)
+            << "Invalid match type for match field " << id << ".";
+        ASSIGN_OR_RETURN(absl::string_view low,
+                         VerifyValue(field.range().low(), info->bitwidth,
+                                     "match field", id));
+        ASSIGN_OR_RETURN(absl::string_view high,
+                         VerifyValue(field.range().high(), info->bitwidth,
+                                     "match field", id));
+        size_t offset = key->size();
+        AppendPadded(low, width, key);
+        AppendPadded(high, width, key);
+        CHECK_RETURN_IF_FALSE(absl::string_view(*key).substr(offset, width) <=
+                              absl::string_view(*key).substr(offset + width))
+            << "Empty range for match field " << id << ".";
+        break;
+      }
+      default:
+        return MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Unsupported match type for match field " << id << ".";
+    }
+  }
+  if (num_exact_fields != table.num_exact_fields) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Entries of table " << table.name << " need all their "
+           << table.num_exact_fields << " exact match fields.";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status DummyTableStore::VerifyTableAction(
+    const Table& table, const ::p4::v1::TableAction& action) const {
+  if (table.action_profile_id == 0) {
+    if (action.type_case() != ::p4::v1::TableAction::kAction) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Table " << table.name << " needs a direct action.";
+    }
+    if (!table.action_ids.count(action.action().action_id())) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Action " << action.action().action_id()
+             << " is not an action of table " << table.name << ".";
+    }
+    return VerifyAction(action.action());
+  }
+  const ActionProfile* action_profile =
+      gtl::FindOrNull(action_profiles_, table.action_profile_id);
+  CHECK_RETURN_IF_FALSE(action_profile != nullptr)
+      << "Unknown implementation " << table.action_profile_id << " of table "
+      << table.name << ".";
+  switch (action.type_case()) {
+    case ::p4::v1::TableAction::kActionProfileMemberId:
+      if (!action_profile->members.count(action.action_profile_member_id())) {
+        return MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Member " << action.action_profile_member_id()
+               << " not found.";
+      }
+      break;
+    case ::p4::v1::TableAction::kActionProfileGroupId:
+      if (!action_profile->groups.count(action.action_profile_group_id())) {
+        return MAKE_ERROR(ERR_INVALID_PARAM)
+               << "Group " << action.action_profile_group_id()
+               << " not found.";
+      }
+      break;
+    case ::p4::v1::TableAction::kActionProfileActionSet:
+      return MAKE_ERROR(ERR_UNIMPLEMENTED)
+             << "One-shot action selector programming is not supported.";
+    default:
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Table " << table.name
+             << " needs an action profile member or group.";
+  }
+
+  return ::util::OkStatus();
+}
+
+::util::Status DummyTableStore::VerifyAction(
+    const ::p4::v1::Action& action) const {
+  const Action* info = gtl::FindOrNull(actions_, action.action_id());
+  if (info == nullptr) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Unknown action " << action.action_id() << ".";
+  }
+  if (action.params_size() != static_cast<int>(info->param_bitwidths.size())) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Action " << action.action_id() << " needs "
+           << info->param_bitwidths.size() << " params.";
+  }
+  for (const auto& param : action.params()) {
+    const int* bitwidth =
+        gtl::FindOrNull(info->param_bitwidths, param.param_id());
+    if (bitwidth == nullptr) {
+      return MAKE_ERROR(ERR_INVALID_PARAM)
+             << "Unknown param " << param.param_id() << " of action "
+             << action.action_id() << ".";
+    }
+    RETURN_IF_ERROR(
+        VerifyValue(param.value(), *bitwidth, "param", param.param_id())
+            .status());
+  }
+
+  return ::util::OkStatus();
+}
+
+void DummyTableStore::UpdateRefCount(const Table& table,
+                                     const ::p4::v1::TableAction& action,
+                                     int delta) {
+  if (!IsIndirectAction(action)) return;
+  ActionProfile* action_profile =
+      gtl::FindOrNull(action_profiles_, table.action_profile_id);
+  if (action_profile == nullptr) return;
+  if (action.type_case() == ::p4::v1::TableAction::kActionProfileMemberId) {
+    Member* member = gtl::FindOrNull(action_profile->members,
+                                     action.action_profile_member_id());
+    if (member != nullptr) member->ref_count += delta;
+  } else {
+    Group* group = gtl::FindOrNull(action_profile->groups,
+                                   action.action_profile_group_id());
+    if (group != nullptr) group->ref_count += delta;
+  }
+}
+
+::util::StatusOr<DummyTableStore::Table*> DummyTableStore::GetTable(
+    uint32 table_id) {
+  Table* table = gtl::FindOrNull(tables_, table_id);
+  if (table == nullptr) {
+    return MAKE_ERROR(ERR_INVALID_PARAM) << "Unknown table ID " << table_id
+                                         << ".";
+  }
+  return table;
+}
+
+::util::StatusOr<DummyTableStore::ActionProfile*>
+DummyTableStore::GetActionProfile(uint32 action_profile_id) {
+  ActionProfile* action_profile =
+      gtl::FindOrNull(action_profiles_, action_profile_id);
+  if (action_profile == nullptr) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Unknown action profile ID " << action_profile_id << ".";
+  }
+  return action_profile;
+}
+
+}  // namespace dummy_switch
+}  // namespace hal
+}  // namespace stratum
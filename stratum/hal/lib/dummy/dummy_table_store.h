@@ -0,0 +1,231 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STRATUM_HAL_LIB_DUMMY_DUMMY_TABLE_STORE_H_
+#define STRATUM_HAL_LIB_DUMMY_DUMMY_TABLE_STORE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "p4/config/v1/p4info.pb.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
+#include "stratum/hal/lib/common/writer_interface.h"
+
+namespace stratum {
+namespace hal {
+namespace dummy_switch {
+
+// The DummyTableStore class keeps the P4Runtime forwarding state of a
+// DummyNode in memory: the table entries, the action profile members and
+// groups, and the multicast groups and clone sessions. It validates the
+// written entities against the P4Info the way a real target would (unknown
+// IDs, match types, bit widths, masked bits, priorities, action params,
+// references to members and groups, etc.), so it can be used to test
+// controllers without hardware.
+//
+// The table entries are indexed in a hash map per table, by a canonical key
+// formed from their priority and match fields, so the writes and the lookups
+// of a single entry cost O(1) regardless of the number of entries. The entries
+// are kept serialized, which takes several times less memory than the protos
+// and lets a laptop hold millions of them. Table sizes from the P4Info are not
+// enforced, so controllers can be load tested beyond them.
+//
+// DummyTableStore is not thread-safe, the caller is expected to lock.
+class DummyTableStore {
+ public:
+  // Maximum number of entities in each ReadResponse written by Read(), so that
+  // reading millions of entries does not exceed the gRPC message size limit.
+  static constexpr int kMaxEntitiesPerReadResponse = 1000;
+
+  virtual ~DummyTableStore() {}
+
+  // Verifies the given P4Info, without changing the current pipeline.
+  ::util::Status VerifyP4Info(const ::p4::config::v1::P4Info& p4_info) const;
+
+  // Verifies the given P4Info and makes it the current pipeline. All the
+  // forwarding state of the previous pipeline is discarded.
+  ::util::Status PushP4Info(const ::p4::config::v1::P4Info& p4_info);
+
+  // Applies the updates of the given request in order, adding one status per
+  // update to results. Returns ERR_AT_LEAST_ONE_OPER_FAILED if any update
+  // failed.
+  ::util::Status Write(const ::p4::v1::WriteRequest& req,
+                       std::vector<::util::Status>* results);
+
+  // Writes the entities matching the entities of the given request to the
+  // writer. Zero IDs are wildcards, e.g. a TableEntry with a zero table_id
+  // reads all the table entries, and a TableEntry with match fields only reads
+  // the entry with this exact key. Adds one status per requested entity to
+  // details.
+  ::util::Status Read(const ::p4::v1::ReadRequest& req,
+                      WriterInterface<::p4::v1::ReadResponse>* writer,
+                      std::vector<::util::Status>* details) const;
+
+  // Returns the stored table entry with the same key (table_id, priority and
+  // match fields) as the given one.
+  ::util::StatusOr<::p4::v1::TableEntry> LookupTableEntry(
+      const ::p4::v1::TableEntry& entry) const;
+
+  // Removes all the forwarding state and the pipeline.
+  void Clear();
+
+  // Returns the number of table entries, in all the tables.
+  size_t NumTableEntries() const { return num_table_entries_; }
+
+  // Factory function for creating the instance of the class.
+  static std::unique_ptr<DummyTableStore> CreateInstance();
+
+  // DummyTableStore is neither copyable nor movable.
+  DummyTableStore(const DummyTableStore&) = delete;
+  DummyTableStore& operator=(const DummyTableStore&) = delete;
+
+ private:
+  // The P4Info of a match field, as needed to validate FieldMatches.
+  struct MatchFieldInfo {
+    ::p4::config::v1::MatchField::MatchType match_type;
+    int bitwidth;
+  };
+
+  // The P4Info of a table, and its entries.
+  struct Table {
+    uint32 id;
+    std::string name;
+    absl::flat_hash_map<uint32, MatchFieldInfo> match_fields;
+    // Number of exact match fields, which every entry must have.
+    int num_exact_fields;
+    // True if the table has ternary or range match fields, i.e. if its
+    // entries need a priority.
+    bool needs_priority;
+    absl::flat_hash_set<uint32> action_ids;
+    // ID of the action profile of the table, or 0 if the table has none.
+    uint32 action_profile_id;
+    uint32 const_default_action_id;
+    bool is_const;
+    // Map from the canonical key of each entry to the serialized entry.
+    absl::flat_hash_map<std::string, std::string> entries;
+    // The serialized default entry, if the default action was modified.
+    std::string default_entry;
+  };
+
+  // The P4Info of an action, as needed to validate action params.
+  struct Action {
+    // Map from param ID to bitwidth.
+    absl::flat_hash_map<uint32, int> param_bitwidths;
+  };
+
+  // An action profile member, and the number of groups and table entries
+  // referring to it.
+  struct Member {
+    ::p4::v1::ActionProfileMember member;
+    int ref_count;
+  };
+
+  // An action profile group, and the number of table entries referring to it.
+  struct Group {
+    ::p4::v1::ActionProfileGroup group;
+    int ref_count;
+  };
+
+  // The P4Info of an action profile, and its members and groups.
+  struct ActionProfile {
+    absl::flat_hash_set<uint32> table_ids;
+    bool with_selector;
+    int max_group_size;
+    absl::flat_hash_map<uint32, Member> members;
+    absl::flat_hash_map<uint32, Group> groups;
+  };
+
+  // Private constructor. Use CreateInstance() to create an instance of this
+  // class.
+  DummyTableStore();
+
+  // Applies one update of a given entity type.
+  ::util::Status WriteTableEntry(const ::p4::v1::TableEntry& entry,
+                                 ::p4::v1::Update::Type type);
+  ::util::Status WriteDefaultEntry(Table* table,
+                                   const ::p4::v1::TableEntry& entry,
+                                   ::p4::v1::Update::Type type);
+  ::util::Status WriteActionProfileMember(
+      const ::p4::v1::ActionProfileMember& member, ::p4::v1::Update::Type type);
+  ::util::Status WriteActionProfileGroup(
+      const ::p4::v1::ActionProfileGroup& group, ::p4::v1::Update::Type type);
+  ::util::Status WritePacketReplicationEngineEntry(
+      const ::p4::v1::PacketReplicationEngineEntry& entry,
+      ::p4::v1::Update::Type type);
+
+  // Adds the entities matching the given (possibly wildcard) entity of a given
+  // type to the response, flushing it to the writer when it is full.
+  ::util::Status ReadTableEntries(
+      const ::p4::v1::TableEntry& filter, ::p4::v1::ReadResponse* resp,
+      WriterInterface<::p4::v1::ReadResponse>* writer) const;
+  ::util::Status ReadActionProfileMembers(
+      const ::p4::v1::ActionProfileMember& filter, ::p4::v1::ReadResponse* resp,
+      WriterInterface<::p4::v1::ReadResponse>* writer) const;
+  ::util::Status ReadActionProfileGroups(
+      const ::p4::v1::ActionProfileGroup& filter, ::p4::v1::ReadResponse* resp,
+      WriterInterface<::p4::v1::ReadResponse>* writer) const;
+  ::util::Status ReadPacketReplicationEngineEntries(
+      const ::p4::v1::PacketReplicationEngineEntry& filter,
+      ::p4::v1::ReadResponse* resp,
+      WriterInterface<::p4::v1::ReadResponse>* writer) const;
+
+  // Validates the match fields and priority of the entry and forms its
+  // canonical key in the table.
+  ::util::Status BuildTableEntryKey(const Table& table,
+                                    const ::p4::v1::TableEntry& entry,
+                                    std::string* key) const;
+
+  // Validates the action of a table entry, i.e. a direct action of the table,
+  // or a member or group of the action profile of the table.
+  ::util::Status VerifyTableAction(const Table& table,
+                                   const ::p4::v1::TableAction& action) const;
+
+  // Validates an action and its params.
+  ::util::Status VerifyAction(const ::p4::v1::Action& action) const;
+
+  // Adds delta to the ref count of the member or group a table entry action
+  // points to, if any.
+  void UpdateRefCount(const Table& table, const ::p4::v1::TableAction& action,
+                      int delta);
+
+  // Returns the table or action profile with the given ID.
+  ::util::StatusOr<Table*> GetTable(uint32 table_id);
+  ::util::StatusOr<ActionProfile*> GetActionProfile(uint32 action_profile_id);
+
+  // The P4Info of the current pipeline, and the forwarding state. Ordered maps
+  // would make reads deterministic, but every write would pay for it.
+  absl::flat_hash_map<uint32, Table> tables_;
+  absl::flat_hash_map<uint32, Action> actions_;
+  absl::flat_hash_map<uint32, ActionProfile> action_profiles_;
+  absl::flat_hash_map<uint32, ::p4::v1::MulticastGroupEntry> multicast_groups_;
+  absl::flat_hash_map<uint32, ::p4::v1::CloneSessionEntry> clone_sessions_;
+
+  // True once a P4Info has been pushed.
+  bool pipeline_pushed_;
+
+  // Total number of table entries.
+  size_t num_table_entries_;
+};
+
+}  // namespace dummy_switch
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_DUMMY_DUMMY_TABLE_STORE_H_
@@ -0,0 +1,503 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/dummy/dummy_table_store.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "p4/config/v1/p4info.pb.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+namespace dummy_switch {
+namespace {
+
+// Table 1 is a route table, table 2 an ACL and table 3 uses action profile
+// 100, with a selector.
+constexpr char kP4Info[] = R"PROTO(
+  tables {
+    preamble { id: 1 name: "routes" }
+    match_fields { id: 1 name: "vrf" bitwidth: 12 match_type: EXACT }
+    match_fields { id: 2 name: "ipv4_dst" bitwidth: 32 match_type: LPM }
+    action_refs { id: 10 }
+    action_refs { id: 11 }
+  }
+  tables {
+    preamble { id: 2 name: "acl" }
+    match_fields { id: 1 name: "eth_type" bitwidth: 16 match_type: TERNARY }
+    match_fields { id: 2 name: "l4_port" bitwidth: 16 match_type: RANGE }
+    action_refs { id: 10 }
+    action_refs { id: 11 }
+  }
+  tables {
+    preamble { id: 3 name: "ecmp" }
+    match_fields { id: 1 name: "hash" bitwidth: 8 match_type: EXACT }
+    action_refs { id: 10 }
+    implementation_id: 100
+  }
+  actions {
+    preamble { id: 10 name: "set_port" }
+    params { id: 1 name: "port" bitwidth: 9 }
+  }
+  actions { preamble { id: 11 name: "drop" } }
+  action_profiles {
+    preamble { id: 100 name: "ecmp_selector" }
+    table_ids: 3
+    with_selector: true
+    max_group_size: 2
+  }
+)PROTO";
+
+// A writer keeping all the responses it gets.
+class ReadResponseCollector : public WriterInterface<::p4::v1::ReadResponse> {
+ public:
+  bool Write(const ::p4::v1::ReadResponse& msg) override {
+    responses.push_back(msg);
+    return true;
+  }
+
+  // Returns all the entities of all the responses.
+  std::vector<::p4::v1::Entity> Entities() const {
+    std::vector<::p4::v1::Entity> entities;
+    for (const auto& resp : responses) {
+      entities.insert(entities.end(), resp.entities().begin(),
+                      resp.entities().end());
+    }
+    return entities;
+  }
+
+  std::vector<::p4::v1::ReadResponse> responses;
+};
+
+class DummyTableStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    table_store_ = DummyTableStore::CreateInstance();
+    ::p4::config::v1::P4Info p4_info;
+    ASSERT_OK(ParseProtoFromString(kP4Info, &p4_info));
+    ASSERT_OK(table_store_->PushP4Info(p4_info));
+  }
+
+  // Writes a single update, and returns its status.
+  ::util::Status WriteEntity(::p4::v1::Update::Type type,
+                             const std::string& entity_text) {
+    ::p4::v1::WriteRequest req;
+    auto* update = req.add_updates();
+    update->set_type(type);
+    CHECK_OK(ParseProtoFromString(entity_text, update->mutable_entity()));
+    std::vector<::util::Status> results;
+    ::util::Status status = table_store_->Write(req, &results);
+    CHECK_EQ(1, results.size());
+    CHECK_EQ(status.ok(), results[0].ok());
+    return results[0];
+  }
+
+  // Reads the given entity, and returns the read entities.
+  std::vector<::p4::v1::Entity> ReadEntity(const std::string& entity_text) {
+    ::p4::v1::ReadRequest req;
+    CHECK_OK(ParseProtoFromString(entity_text, req.add_entities()));
+    ReadResponseCollector writer;
+    std::vector<::util::Status> details;
+    CHECK_OK(table_store_->Read(req, &writer, &details));
+    CHECK_EQ(1, details.size());
+    CHECK_OK(details[0]);
+    return writer.Entities();
+  }
+
+  std::unique_ptr<DummyTableStore> table_store_;
+};
+
+constexpr char kRouteEntry[] = R"PROTO(
+  table_entry {
+    table_id: 1
+    match { field_id: 1 exact { value: "\x01" } }
+    match { field_id: 2 lpm { value: "\x0a\x01\x00\x00" prefix_len: 16 } }
+    action { action { action_id: 10 params { param_id: 1 value: "\x01" } } }
+  }
+)PROTO";
+
+TEST_F(DummyTableStoreTest, WriteBeforePushP4InfoFails) {
+  table_store_ = DummyTableStore::CreateInstance();
+  ::p4::v1::WriteRequest req;
+  std::vector<::util::Status> results;
+  EXPECT_EQ(ERR_NOT_INITIALIZED,
+            table_store_->Write(req, &results).error_code());
+}
+
+TEST_F(DummyTableStoreTest, InsertModifyDeleteTableEntry) {
+  EXPECT_OK(WriteEntity(::p4::v1::Update::INSERT, kRouteEntry));
+  EXPECT_EQ(ERR_ENTRY_EXISTS,
+            WriteEntity(::p4::v1::Update::INSERT, kRouteEntry).error_code());
+  EXPECT_EQ(1, table_store_->NumTableEntries());
+
+  // The same key, with padded values and the match fields in another order.
+  ::p4::v1::TableEntry key;
+  ASSERT_OK(ParseProtoFromString(R"PROTO(
+    table_id: 1
+    match { field_id: 2 lpm { value: "\x00\x0a\x01\x00\x00" prefix_len: 16 } }
+    match { field_id: 1 exact { value: "\x00\x01" } }
+  )PROTO", &key));
+  auto lookup = table_store_->LookupTableEntry(key);
+  ASSERT_OK(lookup.status());
+  EXPECT_EQ(10, lookup.ValueOrDie().action().action().action_id());
+
+  EXPECT_OK(WriteEntity(::p4::v1::Update::MODIFY, R"PROTO(
+    table_entry {
+      table_id: 1
+      match { field_id: 1 exact { value: "\x01" } }
+      match { field_id: 2 lpm { value: "\x0a\x01\x00\x00" prefix_len: 16 } }
+      action { action { action_id: 11 } }
+    }
+  )PROTO"));
+  lookup = table_store_->LookupTableEntry(key);
+  ASSERT_OK(lookup.status());
+  EXPECT_EQ(11, lookup.ValueOrDie().action().action().action_id());
+
+  EXPECT_OK(WriteEntity(::p4::v1::Update::DELETE, kRouteEntry));
+  EXPECT_EQ(ERR_ENTRY_NOT_FOUND,
+            WriteEntity(::p4::v1::Update::DELETE, kRouteEntry).error_code());
+  EXPECT_EQ(ERR_ENTRY_NOT_FOUND,
+            table_store_->LookupTableEntry(key).status().error_code());
+  EXPECT_EQ(0, table_store_->NumTableEntries());
+}
+
+TEST_F(DummyTableStoreTest, InvalidTableEntries) {
+  const std::vector<std::string> invalid_entries = {
+      // Unknown table.
+      R"(table_entry { table_id: 9 })",
+      // Missing exact field.
+      R"(table_entry { table_id: 1
+         action { action { action_id: 11 } } })",
+      // Exact value wider than 12 bits.
+      R"(table_entry { table_id: 1
+         match { field_id: 1 exact { value: "\x10\x00" } }
+         action { action { action_id: 11 } } })",
+      // Bits set after the prefix.
+      R"(table_entry { table_id: 1
+         match { field_id: 1 exact { value: "\x01" } }
+         match { field_id: 2 lpm { value: "\x0a\x01\x00\x01" prefix_len: 16 } }
+         action { action { action_id: 11 } } })",
+      // Zero prefix length.
+      R"(table_entry { table_id: 1
+         match { field_id: 1 exact { value: "\x01" } }
+         match { field_id: 2 lpm { value: "\x00" prefix_len: 0 } }
+         action { action { action_id: 11 } } })",
+      // Wrong match type.
+      R"(table_entry { table_id: 1
+         match { field_id: 1 ternary { value: "\x01" mask: "\x01" } }
+         action { action { action_id: 11 } } })",
+      // Duplicate match field.
+      R"(table_entry { table_id: 1
+         match { field_id: 1 exact { value: "\x01" } }
+         match { field_id: 1 exact { value: "\x02" } }
+         action { action { action_id: 11 } } })",
+      // Priority in a table without ternary or range fields.
+      R"(table_entry { table_id: 1 priority: 10
+         match { field_id: 1 exact { value: "\x01" } }
+         action { action { action_id: 11 } } })",
+      // Missing priority.
+      R"(table_entry { table_id: 2
+         match { field_id: 1 ternary { value: "\x08\x00" mask: "\xff\xff" } }
+         action { action { action_id: 11 } } })",
+      // Zero mask.
+      R"(table_entry { table_id: 2 priority: 10
+         match { field_id: 1 ternary { value: "\x00" mask: "\x00" } }
+         action { action { action_id: 11 } } })",
+      // Bits set outside the mask.
+      R"(table_entry { table_id: 2 priority: 10
+         match { field_id: 1 ternary { value: "\x08\x01" mask: "\xff\x00" } }
+         action { action { action_id: 11 } } })",
+      // Empty range.
+      R"(table_entry { table_id: 2 priority: 10
+         match { field_id: 2 range { low: "\x02" high: "\x01" } }
+         action { action { action_id: 11 } } })",
+      // Unknown action.
+      R"(table_entry { table_id: 1
+         match { field_id: 1 exact { value: "\x01" } }
+         action { action { action_id: 12 } } })",
+      // Missing action param.
+      R"(table_entry { table_id: 1
+         match { field_id: 1 exact { value: "\x01" } }
+         action { action { action_id: 10 } } })",
+      // Action param wider than 9 bits.
+      R"(table_entry { table_id: 1
+         match { field_id: 1 exact { value: "\x01" } }
+         action { action { action_id: 10
+                           params { param_id: 1 value: "\x02\x00" } } } })",
+      // Direct action in a table with an action profile.
+      R"(table_entry { table_id: 3
+         match { field_id: 1 exact { value: "\x01" } }
+         action { action { action_id: 11 } } })",
+      // Unknown member.
+      R"(table_entry { table_id: 3
+         match { field_id: 1 exact { value: "\x01" } }
+         action { action_profile_member_id: 1 } })",
+  };
+  for (const auto& entry : invalid_entries) {
+    EXPECT_EQ(ERR_INVALID_PARAM,
+              WriteEntity(::p4::v1::Update::INSERT, entry).error_code())
+        << entry;
+  }
+  EXPECT_EQ(0, table_store_->NumTableEntries());
+}
+
+TEST_F(DummyTableStoreTest, PriorityIsPartOfTheKey) {
+  const char kAclMatch[] = R"PROTO(
+    match { field_id: 1 ternary { value: "\x08\x00" mask: "\xff\xff" } }
+    match { field_id: 2 range { low: "\x00\x50" high: "\x00\x51" } }
+    action { action { action_id: 11 } }
+  )PROTO";
+  for (int priority : {10, 20}) {
+    EXPECT_OK(WriteEntity(
+        ::p4::v1::Update::INSERT,
+        absl::StrCat("table_entry { table_id: 2 priority: ", priority,
+                     kAclMatch, "}")));
+  }
+  EXPECT_EQ(2, table_store_->NumTableEntries());
+  EXPECT_EQ(2, ReadEntity("table_entry { table_id: 2 }").size());
+
+  auto entities = ReadEntity(R"PROTO(
+    table_entry {
+      table_id: 2
+      priority: 20
+      match { field_id: 2 range { low: "\x50" high: "\x51" } }
+      match { field_id: 1 ternary { value: "\x08\x00" mask: "\xff\xff" } }
+    }
+  )PROTO");
+  ASSERT_EQ(1, entities.size());
+  EXPECT_EQ(20, entities[0].table_entry().priority());
+}
+
+TEST_F(DummyTableStoreTest, DefaultEntry) {
+  const char kDefaultEntry[] = R"PROTO(
+    table_entry {
+      table_id: 1
+      is_default_action: true
+      action { action { action_id: 11 } }
+    }
+  )PROTO";
+  EXPECT_EQ(ERR_INVALID_PARAM,
+            WriteEntity(::p4::v1::Update::INSERT, kDefaultEntry).error_code());
+  EXPECT_TRUE(
+      ReadEntity("table_entry { table_id: 1 is_default_action: true }")
+          .empty());
+  EXPECT_OK(WriteEntity(::p4::v1::Update::MODIFY, kDefaultEntry));
+  auto entities =
+      ReadEntity("table_entry { table_id: 1 is_default_action: true }");
+  ASSERT_EQ(1, entities.size());
+  EXPECT_EQ(11, entities[0].table_entry().action().action().action_id());
+  // The default entry is not one of the table entries.
+  EXPECT_EQ(0, table_store_->NumTableEntries());
+  EXPECT_TRUE(ReadEntity("table_entry { table_id: 1 }").empty());
+
+  EXPECT_OK(WriteEntity(::p4::v1::Update::MODIFY, R"PROTO(
+    table_entry { table_id: 1 is_default_action: true }
+  )PROTO"));
+  EXPECT_TRUE(
+      ReadEntity("table_entry { table_id: 1 is_default_action: true }")
+          .empty());
+}
+
+TEST_F(DummyTableStoreTest, ActionProfileReferences) {
+  for (const char* member : {"1", "2", "3"}) {
+    EXPECT_OK(WriteEntity(
+        ::p4::v1::Update::INSERT,
+        absl::StrCat("action_profile_member { action_profile_id: 100 ",
+                     "member_id: ", member, " action { action_id: 10 ",
+                     "params { param_id: 1 value: \"\\x01\" } } }")));
+  }
+  // Too many members.
+  EXPECT_EQ(ERR_INVALID_PARAM,
+            WriteEntity(::p4::v1::Update::INSERT, R"PROTO(
+              action_profile_group {
+                action_profile_id: 100 group_id: 1
+                members { member_id: 1 } members { member_id: 2 }
+                members { member_id: 3 }
+              }
+            )PROTO").error_code());
+  // Unknown member.
+  EXPECT_EQ(ERR_INVALID_PARAM,
+            WriteEntity(::p4::v1::Update::INSERT, R"PROTO(
+              action_profile_group {
+                action_profile_id: 100 group_id: 1 members { member_id: 4 }
+              }
+            )PROTO").error_code());
+  EXPECT_OK(WriteEntity(::p4::v1::Update::INSERT, R"PROTO(
+    action_profile_group {
+      action_profile_id: 100 group_id: 1
+      members { member_id: 1 } members { member_id: 2 }
+    }
+  )PROTO"));
+  EXPECT_OK(WriteEntity(::p4::v1::Update::INSERT, R"PROTO(
+    table_entry {
+      table_id: 3
+      match { field_id: 1 exact { value: "\x01" } }
+      action { action_profile_group_id: 1 }
+    }
+  )PROTO"));
+  EXPECT_OK(WriteEntity(::p4::v1::Update::INSERT, R"PROTO(
+    table_entry {
+      table_id: 3
+      match { field_id: 1 exact { value: "\x02" } }
+      action { action_profile_member_id: 3 }
+    }
+  )PROTO"));
+
+  // Members and groups in use cannot be deleted.
+  EXPECT_EQ(ERR_INVALID_PARAM,
+            WriteEntity(::p4::v1::Update::DELETE, R"PROTO(
+              action_profile_member { action_profile_id: 100 member_id: 1 }
+            )PROTO").error_code());
+  EXPECT_EQ(ERR_INVALID_PARAM,
+            WriteEntity(::p4::v1::Update::DELETE, R"PROTO(
+              action_profile_member { action_profile_id: 100 member_id: 3 }
+            )PROTO").error_code());
+  EXPECT_EQ(ERR_INVALID_PARAM,
+            WriteEntity(::p4::v1::Update::DELETE, R"PROTO(
+              action_profile_group { action_profile_id: 100 group_id: 1 }
+            )PROTO").error_code());
+
+  EXPECT_EQ(3, ReadEntity(R"PROTO(
+              action_profile_member { action_profile_id: 100 }
+            )PROTO").size());
+  EXPECT_EQ(1, ReadEntity(R"PROTO(
+              action_profile_member { member_id: 2 }
+            )PROTO").size());
+  EXPECT_EQ(1, ReadEntity("action_profile_group {}").size());
+
+  // Once the references are gone, they can.
+  EXPECT_OK(WriteEntity(::p4::v1::Update::MODIFY, R"PROTO(
+    table_entry {
+      table_id: 3
+      match { field_id: 1 exact { value: "\x01" } }
+      action { action_profile_member_id: 3 }
+    }
+  )PROTO"));
+  EXPECT_OK(WriteEntity(::p4::v1::Update::DELETE, R"PROTO(
+    action_profile_group { action_profile_id: 100 group_id: 1 }
+  )PROTO"));
+  EXPECT_OK(WriteEntity(::p4::v1::Update::DELETE, R"PROTO(
+    action_profile_member { action_profile_id: 100 member_id: 1 }
+  )PROTO"));
+  for (const char* hash : {"\\x01", "\\x02"}) {
+    EXPECT_OK(WriteEntity(
+        ::p4::v1::Update::DELETE,
+        absl::StrCat("table_entry { table_id: 3 match { field_id: 1 ",
+                     "exact { value: \"", hash, "\" } } }")));
+  }
+  EXPECT_OK(WriteEntity(::p4::v1::Update::DELETE, R"PROTO(
+    action_profile_member { action_profile_id: 100 member_id: 3 }
+  )PROTO"));
+}
+
+TEST_F(DummyTableStoreTest, PacketReplicationEngineEntries) {
+  EXPECT_OK(WriteEntity(::p4::v1::Update::INSERT, R"PROTO(
+    packet_replication_engine_entry {
+      multicast_group_entry {
+        multicast_group_id: 1
+        replicas { egress_port: 1 instance: 1 }
+        replicas { egress_port: 2 instance: 1 }
+      }
+    }
+  )PROTO"));
+  EXPECT_EQ(ERR_INVALID_PARAM,
+            WriteEntity(::p4::v1::Update::INSERT, R"PROTO(
+              packet_replication_engine_entry {
+                multicast_group_entry {
+                  multicast_group_id: 2
+                  replicas { egress_port: 1 instance: 1 }
+                  replicas { egress_port: 1 instance: 1 }
+                }
+              }
+            )PROTO").error_code());
+  EXPECT_OK(WriteEntity(::p4::v1::Update::INSERT, R"PROTO(
+    packet_replication_engine_entry {
+      clone_session_entry {
+        session_id: 1
+        replicas { egress_port: 255 instance: 0 }
+      }
+    }
+  )PROTO"));
+
+  auto entities = ReadEntity(R"PROTO(
+    packet_replication_engine_entry { multicast_group_entry {} }
+  )PROTO");
+  ASSERT_EQ(1, entities.size());
+  EXPECT_EQ(2, entities[0]
+                   .packet_replication_engine_entry()
+                   .multicast_group_entry()
+                   .replicas_size());
+  EXPECT_EQ(1, ReadEntity(R"PROTO(
+              packet_replication_engine_entry {
+                clone_session_entry { session_id: 1 }
+              }
+            )PROTO").size());
+  EXPECT_EQ(ERR_ENTRY_NOT_FOUND,
+            WriteEntity(::p4::v1::Update::DELETE, R"PROTO(
+              packet_replication_engine_entry {
+                clone_session_entry { session_id: 2 }
+              }
+            )PROTO").error_code());
+}
+
+TEST_F(DummyTableStoreTest, ReadIsSplitInResponses) {
+  const int kNumEntries = 2 * DummyTableStore::kMaxEntitiesPerReadResponse + 1;
+  ::p4::v1::WriteRequest req;
+  for (int i = 0; i < kNumEntries; ++i) {
+    auto* update = req.add_updates();
+    update->set_type(::p4::v1::Update::INSERT);
+    auto* entry = update->mutable_entity()->mutable_table_entry();
+    entry->set_table_id(1);
+    auto* match = entry->add_match();
+    match->set_field_id(1);
+    match->mutable_exact()->set_value(std::string(1, '\x01'));
+    match = entry->add_match();
+    match->set_field_id(2);
+    match->mutable_lpm()->set_value(
+        {'\x0a', static_cast<char>(i >> 8), static_cast<char>(i), '\x00'});
+    match->mutable_lpm()->set_prefix_len(24);
+    entry->mutable_action()->mutable_action()->set_action_id(11);
+  }
+  std::vector<::util::Status> results;
+  ASSERT_OK(table_store_->Write(req, &results));
+  EXPECT_EQ(kNumEntries, table_store_->NumTableEntries());
+
+  ::p4::v1::ReadRequest read_req;
+  read_req.add_entities()->mutable_table_entry();
+  ReadResponseCollector writer;
+  std::vector<::util::Status> details;
+  ASSERT_OK(table_store_->Read(read_req, &writer, &details));
+  EXPECT_EQ(3, writer.responses.size());
+  EXPECT_EQ(kNumEntries, writer.Entities().size());
+
+  // Pushing a P4Info again discards all the entries.
+  ::p4::config::v1::P4Info p4_info;
+  ASSERT_OK(ParseProtoFromString(kP4Info, &p4_info));
+  ASSERT_OK(table_store_->PushP4Info(p4_info));
+  EXPECT_EQ(0, table_store_->NumTableEntries());
+  EXPECT_TRUE(ReadEntity("table_entry {}").empty());
+}
+
+}  // namespace
+}  // namespace dummy_switch
+}  // namespace hal
+}  // namespace stratum
@@ -66,6 +66,34 @@ std::unique_ptr<P4MatchKey> P4MatchKey::CreateInstance(
   return nullptr;
 }
 
+::util::Status P4MatchKey::ConvertFieldMatch(
+    const ::p4::v1::FieldMatch& p4_field_match,
+    const P4FieldDescriptor::P4FieldConversionEntry& conversion_entry,
+    int bit_width, MappedField* mapped_field) {
+  switch (p4_field_match.field_match_type_case()) {
+    case ::p4::v1::FieldMatch::kExact:
+      return P4MatchKeyExact(p4_field_match)
+          .Convert(conversion_entry, bit_width, mapped_field);
+    case ::p4::v1::FieldMatch::kTernary:
+      return P4MatchKeyTernary(p4_field_match)
+          .Convert(conversion_entry, bit_width, mapped_field);
+    case ::p4::v1::FieldMatch::kLpm:
+      return P4MatchKeyLPM(p4_field_match)
+          .Convert(conversion_entry, bit_width, mapped_field);
+    case ::p4::v1::FieldMatch::kRange:
+      return P4MatchKeyRange(p4_field_match)
+          .Convert(conversion_entry, bit_width, mapped_field);
+    case ::p4::v1::FieldMatch::FIELD_MATCH_TYPE_NOT_SET:
+      return P4MatchKeyUnspecified(p4_field_match)
+          .Convert(conversion_entry, bit_width, mapped_field);
+    default:
+      break;
+  }
+  return MAKE_ERROR(ERR_INVALID_PARAM)
+         << "Unsupported P4 TableEntry match field type: "
+         << p4_field_match.ShortDebugString();
+}
+
 P4MatchKey::P4MatchKey(
     const ::p4::v1::FieldMatch& p4_field_match,
     ::p4::config::v1::MatchField::MatchType allowed_match_type)
@@ -47,10 +47,19 @@ class P4MatchKey {
  public:
   // The CreateInstance factory method creates a P4MatchKey given a FieldMatch
   // from a P4 runtime request.  CreateInstance determines the appropriate
-  // P4MatchKey subclass from the FieldMatch content.
+  // P4MatchKey subclass from the FieldMatch content.  The P4MatchKey refers to
+  // p4_field_match, which must outlive it.
   static std::unique_ptr<P4MatchKey> CreateInstance(
       const ::p4::v1::FieldMatch& p4_field_match);
 
+  // Does the same as CreateInstance(p4_field_match)->Convert(...), with a
+  // temporary P4MatchKey on the stack instead of the heap.  P4TableMapper
+  // uses it to map the match fields of each flow entry.
+  static ::util::Status ConvertFieldMatch(
+      const ::p4::v1::FieldMatch& p4_field_match,
+      const P4FieldDescriptor::P4FieldConversionEntry& conversion_entry,
+      int bit_width, MappedField* mapped_field);
+
   virtual ~P4MatchKey() {}
 
   // Converts this P4MatchKey into MappedField output within a CommonFlowEntry
@@ -145,8 +154,8 @@ class P4MatchKey {
   // complies with section "8.3 Bytestrings" in the "P4Runtime Specification".
   ::util::Status CheckBitWidth(const std::string& bytes_value, int bit_width);
 
-  // This member stores the P4 FieldMatch given to CreateInstance.
-  const ::p4::v1::FieldMatch p4_field_match_;
+  // This member refers to the P4 FieldMatch given to CreateInstance.
+  const ::p4::v1::FieldMatch& p4_field_match_;
 
   // This member stores the subclass-dependent match type, i.e.
   // EXACT/LPM/TERNARY/RANGE.
@@ -162,6 +171,8 @@ class P4MatchKeyExact : public P4MatchKey {
   ~P4MatchKeyExact() override {}
 
  protected:
+  friend class P4MatchKey;  // For ConvertFieldMatch.
+
   explicit P4MatchKeyExact(const ::p4::v1::FieldMatch& p4_field_match)
       : P4MatchKey(p4_field_match, ::p4::config::v1::MatchField::EXACT) {}
 
@@ -179,6 +190,8 @@ class P4MatchKeyTernary : public P4MatchKey {
   ~P4MatchKeyTernary() override {}
 
  protected:
+  friend class P4MatchKey;  // For ConvertFieldMatch.
+
   explicit P4MatchKeyTernary(const ::p4::v1::FieldMatch& p4_field_match)
       : P4MatchKey(p4_field_match, ::p4::config::v1::MatchField::TERNARY) {}
 
@@ -196,6 +209,8 @@ class P4MatchKeyLPM : public P4MatchKey {
   ~P4MatchKeyLPM() override {}
 
  protected:
+  friend class P4MatchKey;  // For ConvertFieldMatch.
+
   explicit P4MatchKeyLPM(const ::p4::v1::FieldMatch& p4_field_match)
       : P4MatchKey(p4_field_match, ::p4::config::v1::MatchField::LPM) {}
 
@@ -213,6 +228,8 @@ class P4MatchKeyRange : public P4MatchKey {
   ~P4MatchKeyRange() override {}
 
  protected:
+  friend class P4MatchKey;  // For ConvertFieldMatch.
+
   explicit P4MatchKeyRange(const ::p4::v1::FieldMatch& p4_field_match)
       : P4MatchKey(p4_field_match, ::p4::config::v1::MatchField::RANGE) {}
 
@@ -236,6 +253,8 @@ class P4MatchKeyUnspecified : public P4MatchKey {
       int bit_width, MappedField* mapped_field) override;
 
  protected:
+  friend class P4MatchKey;  // For ConvertFieldMatch.
+
   explicit P4MatchKeyUnspecified(const ::p4::v1::FieldMatch& p4_field_match)
       : P4MatchKey(p4_field_match, ::p4::config::v1::MatchField::UNSPECIFIED) {}
 };
@@ -16,7 +16,6 @@
 
 #include "stratum/hal/lib/p4/p4_table_mapper.h"
 
-#include <set>
 
 #include "gflags/gflags.h"
 #include "stratum/glue/logging.h"
@@ -26,6 +25,7 @@
 #include "stratum/hal/lib/p4/p4_match_key.h"
 #include "stratum/hal/lib/p4/utils.h"
 #include "stratum/lib/macros.h"
+#include "stratum/lib/metrics.h"
 #include "stratum/lib/utils.h"
 #include "stratum/glue/integral_types.h"
 #include "absl/memory/memory.h"
@@ -190,8 +190,12 @@ P4TableMapper::~P4TableMapper() { Shutdown().IgnoreError(); }
     }
   }
 
+  BuildTablePlans(p4_info);
+
   // Parse controller metadata and populate the internal tables. We try our
   // best to parse metadata and skip invalid/unknown data.
+  std::vector<PacketMetadataCodec::Field> packetin_metadata_fields;
+  std::vector<PacketMetadataCodec::Field> packetout_metadata_fields;
   for (const auto& controller_packet_metadata :
        p4_info.controller_packet_metadata()) {
     // Unfortunately other than parsing the names, there is no better way to
@@ -225,6 +229,7 @@ P4TableMapper::~P4TableMapper() { Shutdown().IgnoreError(); }
       uint32 id = metadata.id();
       int bitwidth = metadata.bitwidth();
       if (name == kIngressMetadataPreambleName) {
+        packetin_metadata_fields.push_back({id, type, bitwidth});
         if (!gtl::InsertIfNotPresent(
                 &packetin_metadata_id_to_type_bitwidth_pair_, id,
                 std::make_pair(type, bitwidth))) {
@@ -238,6 +243,7 @@ P4TableMapper::~P4TableMapper() { Shutdown().IgnoreError(); }
                        << "packetin_metadata_type_to_id_bitwidth_pair_.";
         }
       } else {
+        packetout_metadata_fields.push_back({id, type, bitwidth});
         if (!gtl::InsertIfNotPresent(
                 &packetout_metadata_id_to_type_bitwidth_pair_, id,
                 std::make_pair(type, bitwidth))) {
@@ -253,6 +259,10 @@ P4TableMapper::~P4TableMapper() { Shutdown().IgnoreError(); }
       }
     }
   }
+  packetin_metadata_codec_ =
+      absl::make_unique<PacketMetadataCodec>(packetin_metadata_fields);
+  packetout_metadata_codec_ =
+      absl::make_unique<PacketMetadataCodec>(packetout_metadata_fields);
 
   return ::util::OkStatus();
 }
@@ -314,6 +324,7 @@ P4TableMapper::~P4TableMapper() { Shutdown().IgnoreError(); }
 ::util::Status P4TableMapper::MapFlowEntry(
     const ::p4::v1::TableEntry& table_entry, ::p4::v1::Update::Type update_type,
     CommonFlowEntry* flow_entry) const {
+  METRICS_LATENCY_SCOPE("p4_table_mapper/map_flow_entry");
   if (flow_entry == nullptr) {
     return MAKE_ERROR(ERR_INTERNAL) << "Null flow_entry!";
   }
@@ -329,11 +340,19 @@ P4TableMapper::~P4TableMapper() { Shutdown().IgnoreError(); }
   // The table should be recognized in the P4Info, and it must contain a
   // valid set of match fields and one action.
   int p4_table_id = table_entry.table_id();
-  ASSIGN_OR_RETURN(::p4::config::v1::Table table_p4_info,
-                   p4_info_manager_->FindTableByID(p4_table_id));
-  std::vector<::p4::v1::FieldMatch> all_match_fields;
+  const P4TableMapPlan* table_plan = gtl::FindOrNull(table_plans_, p4_table_id);
+  if (table_plan == nullptr) {
+    // Every P4Info table has a plan, so P4InfoManager reports why this one
+    // is unknown.
+    RETURN_IF_ERROR(p4_info_manager_->FindTableByID(p4_table_id).status());
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "P4 table ID " << PrintP4ObjectID(p4_table_id)
+           << " has no mapping plan";
+  }
+  const ::p4::config::v1::Table& table_p4_info = table_plan->table_p4_info;
+  P4MatchFieldFlags requested_fields(table_plan->match_fields.size(), false);
   RETURN_IF_ERROR(
-      PrepareMatchFields(table_p4_info, table_entry, &all_match_fields));
+      ValidateMatchFields(*table_plan, table_entry, &requested_fields));
   if (update_type == ::p4::v1::Update::INSERT && !table_entry.has_action()) {
     return MAKE_ERROR(ERR_INVALID_PARAM)
            << "P4 TableEntry update has no action";
@@ -342,9 +361,26 @@ P4TableMapper::~P4TableMapper() { Shutdown().IgnoreError(); }
   APPEND_STATUS_IF_ERROR(
       status, ProcessTableID(table_p4_info, p4_table_id, flow_entry));
 
-  for (const auto& match_field : all_match_fields) {
+  for (const auto& match_field : table_entry.match()) {
     APPEND_STATUS_IF_ERROR(
-        status, ProcessMatchField(table_p4_info, match_field, flow_entry));
+        status, ProcessMatchField(
+                    table_p4_info,
+                    FindMatchFieldPlan(*table_plan, match_field.field_id()),
+                    match_field, flow_entry));
+  }
+
+  // Any missing fields in the request are added with don't care values, except
+  // when the request has no match fields at all, i.e. it changes the default
+  // action.  The P4MatchKey conversion in ProcessMatchField ultimately
+  // determines whether don't-care/default usage is permissible for each field.
+  if (table_entry.match_size() != 0) {
+    for (size_t i = 0; i < table_plan->match_fields.size(); ++i) {
+      if (requested_fields[i]) continue;
+      const P4MatchFieldPlan& field_plan = table_plan->match_fields[i];
+      APPEND_STATUS_IF_ERROR(
+          status, ProcessMatchField(table_p4_info, &field_plan,
+                                    field_plan.dont_care_match, flow_entry));
+    }
   }
 
   if (table_entry.has_action()) {
@@ -545,6 +581,14 @@ std::string Uint32ToByteStream(uint32 val) {
                              p4_packet_metadata, mapped_packet_metadata);
 }
 
+const PacketMetadataCodec* P4TableMapper::GetPacketInMetadataCodec() const {
+  return packetin_metadata_codec_.get();
+}
+
+const PacketMetadataCodec* P4TableMapper::GetPacketOutMetadataCodec() const {
+  return packetout_metadata_codec_.get();
+}
+
 ::util::Status P4TableMapper::MapMatchField(int table_id, uint32 field_id,
                                             MappedField* mapped_field) const {
   P4FieldConvertKey key = MakeP4FieldConvertKey(table_id, field_id);
@@ -638,10 +682,34 @@ std::string P4TableMapper::GetMapperNameKey(
   return preamble.name();
 }
 
-::util::Status P4TableMapper::PrepareMatchFields(
-    const ::p4::config::v1::Table& table_p4_info,
-    const ::p4::v1::TableEntry& table_entry,
-    std::vector<::p4::v1::FieldMatch>* all_match_fields) const {
+void P4TableMapper::BuildTablePlans(const ::p4::config::v1::P4Info& p4_info) {
+  for (const auto& table : p4_info.tables()) {
+    P4TableMapPlan& table_plan = table_plans_[table.preamble().id()];
+    table_plan.table_p4_info = table;
+    for (const auto& match_field : table.match_fields()) {
+      P4MatchFieldPlan field_plan;
+      field_plan.field_id = match_field.id();
+      field_plan.conversion = gtl::FindOrNull(
+          field_convert_by_table_, MakeP4FieldConvertKey(table, match_field));
+      field_plan.dont_care_match.set_field_id(match_field.id());
+      table_plan.match_fields.push_back(std::move(field_plan));
+    }
+  }
+}
+
+const P4TableMapper::P4MatchFieldPlan* P4TableMapper::FindMatchFieldPlan(
+    const P4TableMapPlan& table_plan, uint32 field_id) {
+  for (const auto& field_plan : table_plan.match_fields) {
+    if (field_plan.field_id == field_id) return &field_plan;
+  }
+  return nullptr;
+}
+
+::util::Status P4TableMapper::ValidateMatchFields(
+    const P4TableMapPlan& table_plan, const ::p4::v1::TableEntry& table_entry,
+    P4MatchFieldFlags* requested_fields) const {
+  const ::p4::config::v1::Table& table_p4_info = table_plan.table_p4_info;
+
   // An empty set of match fields changes the default action for tables
   // that were not defined with a const default action in the P4 program.
   if (table_entry.match_size() == 0) {
@@ -657,33 +725,35 @@ std::string P4TableMapper::GetMapperNameKey(
   // Per field validations:
   //  - Every field_id must be non-zero.
   //  - A field_id can appear in a match field at most once.
-  std::set<uint32> requested_field_ids;
-  for (const auto& match_field : table_entry.match()) {
-    if (match_field.field_id() == 0) {
+  for (int i = 0; i < table_entry.match_size(); ++i) {
+    const uint32 field_id = table_entry.match(i).field_id();
+    if (field_id == 0) {
       return MAKE_ERROR(ERR_INVALID_PARAM)
              << "P4 TableEntry match field has no field_id. "
              << table_entry.ShortDebugString();
     }
-    if (!requested_field_ids.insert(match_field.field_id()).second) {
+    bool duplicate = false;
+    const P4MatchFieldPlan* field_plan =
+        FindMatchFieldPlan(table_plan, field_id);
+    if (field_plan != nullptr) {
+      bool& requested = (*requested_fields)[field_plan -
+                                            table_plan.match_fields.data()];
+      duplicate = requested;
+      requested = true;
+    } else {
+      // Fields that are not in the table fail later in ProcessMatchField.
+      // Duplicates are still reported first, as for the table's own fields.
+      for (int j = 0; j < i && !duplicate; ++j) {
+        duplicate = table_entry.match(j).field_id() == field_id;
+      }
+    }
+    if (duplicate) {
       return MAKE_ERROR(ERR_INVALID_PARAM)
              << "P4 TableEntry update of table "
              << table_p4_info.preamble().name() << " has multiple match field "
-             << "entries for field_id " << match_field.field_id() << ". "
+             << "entries for field_id " << field_id << ". "
              << table_entry.ShortDebugString();
     }
-    all_match_fields->push_back(match_field);
-  }
-
-  // Any missing fields in the request are added with don't care values below.
-  // The P4MatchKey instance in ProcessMatchField ultimately determines whether
-  // don't-care/default usage is permissible for each field.
-  for (const auto& p4info_match_field : table_p4_info.match_fields()) {
-    if (requested_field_ids.find(p4info_match_field.id()) ==
-        requested_field_ids.end()) {
-      ::p4::v1::FieldMatch dont_care_match;
-      dont_care_match.set_field_id(p4info_match_field.id());
-      all_match_fields->push_back(dont_care_match);
-    }
   }
 
   return ::util::OkStatus();
@@ -721,16 +791,14 @@ std::string P4TableMapper::GetMapperNameKey(
 // copy of an unknown field.
 ::util::Status P4TableMapper::ProcessMatchField(
     const ::p4::config::v1::Table& table_p4_info,
-    const ::p4::v1::FieldMatch& match_field,
+    const P4MatchFieldPlan* field_plan, const ::p4::v1::FieldMatch& match_field,
     CommonFlowEntry* flow_entry) const {
   ::util::Status status = ::util::OkStatus();
 
-  // This lookup in field_convert_by_table_ accomplishes two things:
+  // The conversion in the field_plan accomplishes two things:
   //  1) It confirms that the field is allowed in the table.
   //  2) It indicates how to map the field into the flow_entry output.
-  P4FieldConvertKey key = MakeP4FieldConvertKey(table_p4_info, match_field);
-  auto convert_iter = field_convert_by_table_.find(key);
-  if (convert_iter == field_convert_by_table_.end()) {
+  if (field_plan == nullptr || field_plan->conversion == nullptr) {
     ::util::Status field_error = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
                                  << "P4 TableEntry match field ID "
                                  << PrintP4ObjectID(match_field.field_id())
@@ -740,15 +808,13 @@ std::string P4TableMapper::GetMapperNameKey(
     return status;  // No way to decode fields that don't go with the table.
   }
 
-  const auto& conversion_value = convert_iter->second;
-  const auto& conversion_entry = conversion_value.conversion_entry;
-  const auto& conversion_field = conversion_value.mapped_field;
+  const auto& conversion_entry = field_plan->conversion->conversion_entry;
+  const auto& conversion_field = field_plan->conversion->mapped_field;
 
-  std::unique_ptr<P4MatchKey> match_key =
-      P4MatchKey::CreateInstance(match_field);
   auto mapped_field = flow_entry->add_fields();
-  status = match_key->Convert(conversion_entry, conversion_field.bit_width(),
-                              mapped_field);
+  status = P4MatchKey::ConvertFieldMatch(match_field, conversion_entry,
+                                         conversion_field.bit_width(),
+                                         mapped_field);
   if (status.ok()) {
     mapped_field->set_type(conversion_field.type());
     mapped_field->set_bit_width(conversion_field.bit_width());
@@ -861,13 +927,10 @@ std::string P4TableMapper::GetMapperNameKey(
     return status;
   }
 
-  // This loop uses param_mapper_ to figure out which header fields are
-  // modified by the action's parameters.
-  for (const auto& param : action.params()) {
-    APPEND_STATUS_IF_ERROR(
-        status, param_mapper_->MapActionParam(action.action_id(), param,
-                                              mapped_action));
-  }
+  // The param_mapper_ figures out which header fields are modified by the
+  // action's parameters.
+  APPEND_STATUS_IF_ERROR(status,
+                         param_mapper_->MapActionParams(action, mapped_action));
 
   // Some actions assign constants or use them to call other actions.
   APPEND_STATUS_IF_ERROR(status, param_mapper_->MapActionConstants(
@@ -940,10 +1003,13 @@ std::string P4TableMapper::GetMapperNameKey(
 void P4TableMapper::ClearMaps() {
   global_id_table_map_.clear();
   field_convert_by_table_.clear();
+  table_plans_.clear();
   packetin_metadata_type_to_id_bitwidth_pair_.clear();
   packetin_metadata_id_to_type_bitwidth_pair_.clear();
   packetout_metadata_type_to_id_bitwidth_pair_.clear();
   packetout_metadata_id_to_type_bitwidth_pair_.clear();
+  packetin_metadata_codec_.reset(nullptr);
+  packetout_metadata_codec_.reset(nullptr);
   param_mapper_.reset(nullptr);
 }
 
@@ -970,6 +1036,11 @@ P4TableMapper::P4ActionParamMapper::P4ActionParamMapper(
   const auto& action_descriptor = iter->second->action_descriptor();
   valid_table_actions_.insert(std::make_pair(table_id, action_id));
 
+  // Actions shared by several tables are only planned once.
+  auto plan_result = action_plans_.emplace(action_id, P4ActionPlan());
+  if (!plan_result.second) return ::util::OkStatus();
+  P4ActionPlan& action_plan = plan_result.first->second;
+
   // Each parameter needs to have mapping data setup for processing the
   // parameter when it is referenced by a table or action profile update.
   // The data comes from the action parameter's P4Info and the field descriptor
@@ -984,13 +1055,11 @@ P4TableMapper::P4ActionParamMapper::P4ActionParamMapper(
     param_entry.param_descriptor = param_descriptor;
     AddAssignedFields(&param_entry)
         .IgnoreError();  // TODO(unknown): Check status.
-    const auto param_key = std::make_pair(action_id, param_info.id());
-    action_param_map_[param_key] = param_entry;
+    action_plan.params.emplace_back(param_info.id(), param_entry);
   }
 
   // A few actions do constant-value assignments instead of parameter-based
   // assignments.  This loop sets up mapping data for these cases.
-  P4ActionConstants constant_descriptors;
   for (const auto& param_descriptor : action_descriptor.assignments()) {
     if (param_descriptor.assigned_value().source_value_case() ==
         P4AssignSourceValue::kConstantParam) {
@@ -1004,40 +1073,46 @@ P4TableMapper::P4ActionParamMapper::P4ActionParamMapper(
       }
       entry.param_descriptor = &param_descriptor;
       AddAssignedFields(&entry).IgnoreError();  // TODO(unknown): Check status.
-      constant_descriptors.push_back(entry);
+      action_plan.constants.push_back(entry);
     }
   }
-  if (!constant_descriptors.empty()) {
-    action_constant_map_.insert(
-        std::make_pair(action_id, constant_descriptors));
-  }
 
   return ::util::OkStatus();
 }
 
-::util::Status P4TableMapper::P4ActionParamMapper::MapActionParam(
-    int action_id, const ::p4::v1::Action::Param& param,
-    MappedAction* mapped_action) const {
+::util::Status P4TableMapper::P4ActionParamMapper::MapActionParams(
+    const ::p4::v1::Action& action, MappedAction* mapped_action) const {
   ::util::Status status = ::util::OkStatus();
+  if (action.params_size() == 0) return status;
+  const P4ActionPlan* action_plan =
+      gtl::FindOrNull(action_plans_, action.action_id());
 
-  // The entry from the action_param_map_ has information to map the parameter
+  // The entry from the action_plan has information to map each parameter
   // to mapped_action output.  The output consists of a list of modified
   // header fields and/or a sequence of action primitives to execute.
-  const auto param_key = std::make_pair(action_id, param.param_id());
-  auto iter = action_param_map_.find(param_key);
-  if (iter != action_param_map_.end()) {
-    const auto& param_map_entry = iter->second;
-    P4ActionFunction::P4ActionFields param_value;
-    ConvertParamValue(param, param_map_entry.bit_width, &param_value);
-    MapActionAssignment(param_map_entry, param_value, mapped_action);
-  } else {
-    ::util::Status param_status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
-                                  << "P4 action parameter "
-                                  << param.ShortDebugString()
-                                  << " has no mapping descriptor or is not"
-                                  << " a recognized parameter for action ID "
-                                  << PrintP4ObjectID(action_id);
-    APPEND_STATUS_IF_ERROR(status, param_status);
+  for (const auto& param : action.params()) {
+    const P4ActionParamEntry* param_map_entry = nullptr;
+    if (action_plan != nullptr) {
+      for (const auto& param_plan : action_plan->params) {
+        if (param_plan.first == param.param_id()) {
+          param_map_entry = &param_plan.second;
+          break;
+        }
+      }
+    }
+    if (param_map_entry != nullptr) {
+      P4ActionFunction::P4ActionFields param_value;
+      ConvertParamValue(param, param_map_entry->bit_width, &param_value);
+      MapActionAssignment(*param_map_entry, param_value, mapped_action);
+    } else {
+      ::util::Status param_status = MAKE_ERROR(ERR_OPER_NOT_SUPPORTED)
+                                    << "P4 action parameter "
+                                    << param.ShortDebugString()
+                                    << " has no mapping descriptor or is not"
+                                    << " a recognized parameter for action ID "
+                                    << PrintP4ObjectID(action.action_id());
+      APPEND_STATUS_IF_ERROR(status, param_status);
+    }
   }
 
   return status;
@@ -1047,9 +1122,9 @@ P4TableMapper::P4ActionParamMapper::P4ActionParamMapper(
     int action_id, MappedAction* mapped_action) const {
   // A failure to find the action_id means the action does no constant
   // assignments.
-  auto iter = action_constant_map_.find(action_id);
-  if (iter != action_constant_map_.end()) {
-    const auto& param_map_list = iter->second;
+  auto iter = action_plans_.find(action_id);
+  if (iter != action_plans_.end()) {
+    const auto& param_map_list = iter->second.constants;
     for (const auto& param_map_entry : param_map_list) {
       P4ActionFunction::P4ActionFields constant_value;
       const uint64 constant_param =
@@ -22,12 +22,13 @@
 #include <functional>
 #include <map>
 #include <memory>
-#include <set>
 #include <string>
 #include <vector>
 #include <utility>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
 #include "stratum/glue/status/status.h"
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/p4/common_flow_entry.pb.h"
@@ -35,6 +36,7 @@
 #include "stratum/hal/lib/p4/p4_pipeline_config.pb.h"
 #include "stratum/hal/lib/p4/p4_static_entry_mapper.h"
 #include "stratum/hal/lib/p4/p4_table_map.pb.h"
+#include "stratum/hal/lib/p4/packet_metadata_codec.h"
 #include "stratum/lib/utils.h"
 #include "stratum/public/proto/p4_table_defs.pb.h"
 #include "p4/config/v1/p4info.pb.h"
@@ -165,6 +167,15 @@ class P4TableMapper {
       const ::p4::v1::PacketMetadata& p4_packet_metadata,
       MappedPacketMetadata* mapped_packet_metadata) const;
 
+  // Return the codecs compiled from the packet in (out) metadata of the
+  // current pipeline, for the packet I/O fast path at the server/switch side.
+  // The codecs give the same results as the methods above, without any map
+  // lookup or intermediate MappedPacketMetadata. The returned pointers stay
+  // valid until the next pipeline push. Return nullptr if no pipeline has been
+  // pushed yet.
+  virtual const PacketMetadataCodec* GetPacketInMetadataCodec() const;
+  virtual const PacketMetadataCodec* GetPacketOutMetadataCodec() const;
+
   // Fills in the MappedField for the associated table_id & field_id. Returns
   // ERR_ENTRY_NOT_FOUND if the lookup fails.
   virtual ::util::Status MapMatchField(int table_id, uint32 field_id,
@@ -304,6 +315,30 @@ class P4TableMapper {
     return MakeP4FieldConvertKey(table.preamble().id(), match_field.id());
   }
 
+  // A P4TableMapPlan is compiled for each P4Info table when the pipeline is
+  // pushed.  It holds what MapFlowEntry needs to translate the table's entries,
+  // so mapping an entry neither copies the table's P4Info nor looks up each
+  // match field in field_convert_by_table_:
+  //  table_p4_info - the table's P4Info.
+  //  match_fields - one P4MatchFieldPlan per P4Info match field, in P4Info
+  //      order.  Tables have few match fields, so they are found by a linear
+  //      scan.  The conversion points into field_convert_by_table_, or is
+  //      nullptr if the field has no known mapping conversion.  The
+  //      dont_care_match is used for fields omitted from an entry.
+  struct P4MatchFieldPlan {
+    uint32 field_id;
+    const P4FieldConvertValue* conversion;
+    ::p4::v1::FieldMatch dont_care_match;
+  };
+  struct P4TableMapPlan {
+    ::p4::config::v1::Table table_p4_info;
+    std::vector<P4MatchFieldPlan> match_fields;
+  };
+
+  // Tracks which P4Info match fields of a table are present in an entry. The
+  // inline size covers all the tables of the Stratum P4 programs.
+  typedef absl::InlinedVector<bool, 16> P4MatchFieldFlags;
+
   // This private class helps P4TableMapper with the details of action
   // parameter mapping.  A P4ActionParamMapper instance typically lives for
   // the duration of one set of P4Info.  Thus, there is an AddAction method
@@ -326,11 +361,10 @@ class P4TableMapper {
     // entries for each of action_id's parameters.
     ::util::Status AddAction(int table_id, int action_id);
 
-    // Maps the PI action parameter in param to new modify_fields and/or
+    // Maps the PI action parameters in action to new modify_fields and/or
     // primitives in mapped_action.
-    ::util::Status MapActionParam(int action_id,
-                                  const ::p4::v1::Action::Param& param,
-                                  MappedAction* mapped_action) const;
+    ::util::Status MapActionParams(const ::p4::v1::Action& action,
+                                   MappedAction* mapped_action) const;
 
     // Maps the action's constant assignments to header fields or parameters
     // for other actions.
@@ -366,18 +400,20 @@ class P4TableMapper {
       const P4ActionDescriptor::P4ActionInstructions* param_descriptor;
     };
 
-    // The P4ActionParamMap provides a P4ActionParamEntry value that
-    // P4ActionParamMapper can look up for each action parameter.  The key
-    // is a combination of the action ID and the action parameter ID.  The
-    // action ID is globally unique, but the parameter ID is unique only
-    // within the scope of its action.
-    typedef std::map<std::pair<int, int>, P4ActionParamEntry> P4ActionParamMap;
-
-    // The P4ActionConstantMap supports actions that use constants to assign
-    // fields or pass to other actions.  The action ID is the key, and the
-    // value is a container of entries that define the constant assignments.
+    // The P4ActionPlan holds everything needed to map one action, keyed by
+    // the globally unique action ID in P4ActionPlanMap:
+    //  params - a P4ActionParamEntry for each action parameter, with its
+    //      parameter ID.  The parameter ID is unique only within the scope of
+    //      its action.  Actions have few parameters, so they are found by a
+    //      linear scan.
+    //  constants - entries for the constants the action uses to assign
+    //      fields or pass to other actions.
     typedef std::vector<P4ActionParamEntry> P4ActionConstants;
-    typedef absl::flat_hash_map<int, P4ActionConstants> P4ActionConstantMap;
+    struct P4ActionPlan {
+      std::vector<std::pair<uint32, P4ActionParamEntry>> params;
+      P4ActionConstants constants;
+    };
+    typedef absl::flat_hash_map<int, P4ActionPlan> P4ActionPlanMap;
 
     // Updates param_entry with target header field assignments from
     // param_entry's param_descriptor.  In most cases, the param_descriptor
@@ -410,18 +446,15 @@ class P4TableMapper {
     const P4GlobalIDTableMap& p4_global_table_map_;
     const P4PipelineConfig& p4_pipeline_config_;
 
-    // This member contains details for mapping each action parameter by ID.
-    P4ActionParamMap action_param_map_;
-
-    // This member contains details for mapping an action's constant value
-    // assignments.
-    P4ActionConstantMap action_constant_map_;
+    // This member contains details for mapping each action's parameters and
+    // constant value assignments.
+    P4ActionPlanMap action_plans_;
 
     // The valid_table_actions_ set contains all valid table ID and action ID
     // pairs, i.e. the action ID is defined in P4Info as one of the table's
     // possible actions.  The first pair member is the table ID, and the second
     // member is the action ID.
-    std::set<std::pair<int, int>> valid_table_actions_;
+    absl::flat_hash_set<std::pair<int, int>> valid_table_actions_;
   };
 
   // Creates the global_id_table_map_ entry for the object represented by the
@@ -434,18 +467,24 @@ class P4TableMapper {
   // return string is empty.
   std::string GetMapperNameKey(const ::p4::config::v1::Preamble& preamble);
 
+  // Compiles a P4TableMapPlan for each table in p4_info into table_plans_.
+  // Must run after field_convert_by_table_ is populated.
+  void BuildTablePlans(const ::p4::config::v1::P4Info& p4_info);
+
+  // Returns the plan for the given match field ID in table_plan, or nullptr if
+  // the field is not one of the table's match fields.
+  static const P4MatchFieldPlan* FindMatchFieldPlan(
+      const P4TableMapPlan& table_plan, uint32 field_id);
+
   // Validates all of the match fields in the table_entry from a P4Runtime
-  // WriteRequest message.  The input table_p4_info provides information
-  // about the expected match fields for the applicable table.  If the
-  // P4Runtime request omits some match fields as "don't care" values,
-  // PrepareMatchFields appends them to the all_match_fields output vector.
-  // Upon successful return, all_match_fields combines the match fields
-  // in the original WriteRequest with any additional don't care fields,
-  // yielding the full set of match fields as specified by table_p4_info.
-  ::util::Status PrepareMatchFields(
-      const ::p4::config::v1::Table& table_p4_info,
-      const ::p4::v1::TableEntry& table_entry,
-      std::vector<::p4::v1::FieldMatch>* all_match_fields) const;
+  // WriteRequest message.  The input table_plan provides information
+  // about the expected match fields for the applicable table.  Upon successful
+  // return, requested_fields flags the table_plan match fields present in
+  // table_entry.  The P4Runtime request may omit the other fields as "don't
+  // care" values.
+  ::util::Status ValidateMatchFields(const P4TableMapPlan& table_plan,
+                                     const ::p4::v1::TableEntry& table_entry,
+                                     P4MatchFieldFlags* requested_fields) const;
 
   // Processes the identified table and updates table-level flow_entry output.
   // Output always includes table_info with id, name, and type.  If the table's
@@ -456,9 +495,11 @@ class P4TableMapper {
                                 int table_id,
                                 CommonFlowEntry* flow_entry) const;
 
-  // Processes one match_field from a table entry.  If successful, a new
-  // MappedField will be added to flow_entry.
+  // Processes one match_field from a table entry, according to its
+  // field_plan, which is nullptr for fields that are not in the table.  If
+  // successful, a new MappedField will be added to flow_entry.
   ::util::Status ProcessMatchField(const ::p4::config::v1::Table& table_p4_info,
+                                   const P4MatchFieldPlan* field_plan,
                                    const ::p4::v1::FieldMatch& match_field,
                                    CommonFlowEntry* flow_entry) const;
 
@@ -507,6 +548,9 @@ class P4TableMapper {
   // This map facilitates table-dependent match field conversions.
   P4FieldConvertByTable field_convert_by_table_;
 
+  // The mapping plan of each P4Info table, keyed by table ID.
+  absl::flat_hash_map<int, P4TableMapPlan> table_plans_;
+
   // Map from packet in (out) metadata ID to the corresponding (type, bitwidth)
   // pair used for parsing the packet in (out) metadata. The ID and bitwidth of
   // metadata are available from P4Info and the type (P4FieldType) is found from
@@ -521,6 +565,10 @@ class P4TableMapper {
   MetadataTypeToIdBitwidthMap packetin_metadata_type_to_id_bitwidth_pair_;
   MetadataTypeToIdBitwidthMap packetout_metadata_type_to_id_bitwidth_pair_;
 
+  // The same packet in (out) metadata, compiled into codecs.
+  std::unique_ptr<PacketMetadataCodec> packetin_metadata_codec_;
+  std::unique_ptr<PacketMetadataCodec> packetout_metadata_codec_;
+
   // The P4InfoManager provides access to the currently configured P4Info.
   std::unique_ptr<P4InfoManager> p4_info_manager_;
 
@@ -0,0 +1,158 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks measuring P4TableMapper::MapFlowEntry throughput for exact, LPM
+// and ternary (ACL like) tables of the unit test P4Info.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/p4/p4_pipeline_config.pb.h"
+#include "stratum/hal/lib/p4/p4_table_mapper.h"
+#include "stratum/lib/utils.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+constexpr char kTestP4InfoFile[] =
+    "stratum/hal/lib/p4/testdata/test_p4_info.pb.txt";
+constexpr char kTestP4PipelineConfigFile[] =
+    "stratum/hal/lib/p4/testdata/test_p4_pipeline_config.pb.txt";
+
+// Table and action IDs from the test P4Info.
+constexpr int kLpmTableId = 0x00002;         // "lpm-match-32-table"
+constexpr int kExactTableId = 0x00006;       // "action-test-table"
+constexpr int kMultiMatchTableId = 0x0000a;  // "test-multi-match-table"
+constexpr int kNopActionId = 0xa0001;
+constexpr int kMultiParamsActionId = 0xa0005;
+
+// Number of distinct entries each benchmark cycles through.
+constexpr int kNumEntries = 1024;
+
+// Returns a big-endian encoding of 'value' in 'width' bytes.
+std::string Bytes(uint64 value, int width) {
+  std::string bytes(width, '\0');
+  for (int i = width - 1; i >= 0 && value != 0; --i, value >>= 8) {
+    bytes[i] = static_cast<char>(value & 0xff);
+  }
+  return bytes;
+}
+
+// Returns a P4TableMapper with the test pipeline config pushed.
+const P4TableMapper& GetMapper() {
+  static P4TableMapper* mapper = [] {
+    ::p4::v1::ForwardingPipelineConfig config;
+    CHECK_OK(ReadProtoFromTextFile(kTestP4InfoFile, config.mutable_p4info()));
+    P4PipelineConfig p4_pipeline_config;
+    CHECK_OK(
+        ReadProtoFromTextFile(kTestP4PipelineConfigFile, &p4_pipeline_config));
+    CHECK(p4_pipeline_config.SerializeToString(
+        config.mutable_p4_device_config()));
+    P4TableMapper* mapper = P4TableMapper::CreateInstance().release();
+    CHECK_OK(mapper->PushForwardingPipelineConfig(config));
+    return mapper;
+  }();
+  return *mapper;
+}
+
+// Maps the given entries in a loop.
+void MapEntries(benchmark::State& state,
+                const std::vector<::p4::v1::TableEntry>& entries) {
+  const P4TableMapper& mapper = GetMapper();
+  CommonFlowEntry flow_entry;
+  CHECK_OK(mapper.MapFlowEntry(entries[0], ::p4::v1::Update::INSERT,
+                               &flow_entry));
+  size_t i = 0;
+  for (auto _ : state) {
+    ::util::Status status = mapper.MapFlowEntry(
+        entries[i], ::p4::v1::Update::INSERT, &flow_entry);
+    benchmark::DoNotOptimize(status);
+    if (++i == entries.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// A 128-bit exact match with a three parameter action.
+void BM_MapFlowEntryExact(benchmark::State& state) {
+  std::vector<::p4::v1::TableEntry> entries(kNumEntries);
+  for (int i = 0; i < kNumEntries; ++i) {
+    auto& entry = entries[i];
+    entry.set_table_id(kExactTableId);
+    auto* match = entry.add_match();
+    match->set_field_id(1);
+    match->mutable_exact()->set_value(Bytes(0x0a000000 + i, 16));
+    auto* action = entry.mutable_action()->mutable_action();
+    action->set_action_id(kMultiParamsActionId);
+    auto* param = action->add_params();
+    param->set_param_id(0xd0501);
+    param->set_value(Bytes(i, 2));
+    param = action->add_params();
+    param->set_param_id(0xd0502);
+    param->set_value(Bytes(0x0000aabbccdd0000 + i, 6));
+    param = action->add_params();
+    param->set_param_id(0xd0503);
+    param->set_value(Bytes(i, 12));
+  }
+  MapEntries(state, entries);
+}
+BENCHMARK(BM_MapFlowEntryExact);
+
+// An IPv4 route like 32-bit LPM match.
+void BM_MapFlowEntryLpm(benchmark::State& state) {
+  std::vector<::p4::v1::TableEntry> entries(kNumEntries);
+  for (int i = 0; i < kNumEntries; ++i) {
+    auto& entry = entries[i];
+    entry.set_table_id(kLpmTableId);
+    auto* match = entry.add_match();
+    match->set_field_id(1);
+    match->mutable_lpm()->set_value(Bytes(0x0a000000 + (i << 8), 4));
+    match->mutable_lpm()->set_prefix_len(24);
+    entry.mutable_action()->mutable_action()->set_action_id(kNopActionId);
+  }
+  MapEntries(state, entries);
+}
+BENCHMARK(BM_MapFlowEntryLpm);
+
+// An ACL like entry, with a ternary and an exact match field. The table's LPM
+// field is omitted, i.e. it is a don't care.
+void BM_MapFlowEntryTernary(benchmark::State& state) {
+  std::vector<::p4::v1::TableEntry> entries(kNumEntries);
+  for (int i = 0; i < kNumEntries; ++i) {
+    auto& entry = entries[i];
+    entry.set_table_id(kMultiMatchTableId);
+    entry.set_priority(10);
+    auto* match = entry.add_match();
+    match->set_field_id(3);
+    match->mutable_ternary()->set_value(Bytes(i, 16));
+    match->mutable_ternary()->set_mask(Bytes(0xfff, 16));
+    match = entry.add_match();
+    match->set_field_id(2);
+    match->mutable_exact()->set_value(Bytes(0x1122334455660000 + i, 8));
+    entry.mutable_action()->mutable_action()->set_action_id(kNopActionId);
+  }
+  MapEntries(state, entries);
+}
+BENCHMARK(BM_MapFlowEntryTernary);
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
+
+BENCHMARK_MAIN();
@@ -66,6 +66,8 @@ class P4TableMapperMock : public P4TableMapper {
       ParsePacketInMetadata,
       ::util::Status(const ::p4::v1::PacketMetadata& p4_packet_metadata,
                      MappedPacketMetadata* mapped_packet_metadata));
+  MOCK_CONST_METHOD0(GetPacketInMetadataCodec, const PacketMetadataCodec*());
+  MOCK_CONST_METHOD0(GetPacketOutMetadataCodec, const PacketMetadataCodec*());
   MOCK_CONST_METHOD3(MapMatchField,
                      ::util::Status(int table_id, uint32 field_id,
                                     MappedField* mapped_field));
@@ -13,20 +13,48 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-// This file contains the P4WriteRequestDiffer and P4WriteRequestReporter
-// implementations.
+// This file contains the P4WriteRequestDiffer implementation.
 
 #include "stratum/hal/lib/p4/p4_write_request_differ.h"
 
+#include <algorithm>
+#include <string>
+
 #include "stratum/glue/logging.h"
-#include "google/protobuf/generated_message_reflection.h"
-#include "stratum/glue/status/status_macros.h"
-#include "stratum/lib/macros.h"
-#include "stratum/public/lib/error.h"
+#include "stratum/lib/utils.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "absl/strings/str_cat.h"
 
 namespace stratum {
 namespace hal {
 
+namespace {
+
+// Forms the key identifying the table entry of the update from its table_id,
+// priority and match fields.  The match fields are sorted by their
+// serialization, as their order is not significant.  Returns false if the
+// update has no table entry.
+bool EntryKey(const ::p4::v1::Update& update, std::string* key) {
+  if (!update.entity().has_table_entry()) return false;
+  const auto& table_entry = update.entity().table_entry();
+  std::vector<std::string> matches;
+  matches.reserve(table_entry.match_size());
+  for (const auto& match : table_entry.match()) {
+    matches.push_back(match.SerializeAsString());
+  }
+  std::sort(matches.begin(), matches.end());
+  key->clear();
+  absl::StrAppend(key, table_entry.table_id(), ":", table_entry.priority());
+  for (const auto& match : matches) {
+    // Length prefixed, so the boundaries between match fields are preserved.
+    absl::StrAppend(key, ":", match.size(), ":", match);
+  }
+  return true;
+}
+
+}  // namespace
+
 P4WriteRequestDiffer::P4WriteRequestDiffer(
     const ::p4::v1::WriteRequest& old_request,
     const ::p4::v1::WriteRequest& new_request)
@@ -44,158 +72,103 @@ P4WriteRequestDiffer::P4WriteRequestDiffer(
     ::p4::v1::WriteRequest* delete_request, ::p4::v1::WriteRequest* add_request,
     ::p4::v1::WriteRequest* modify_request,
     ::p4::v1::WriteRequest* unchanged_request) {
-  ::google::protobuf::util::MessageDifferencer msg_differencer;
-  P4WriteRequestReporter reporter;
-  msg_differencer.ReportDifferencesTo(&reporter);
-  if (unchanged_request) {
-    msg_differencer.set_report_matches(true);
+  // Index the old updates by key.  Only the hash of the serialized entity of
+  // the update is kept, the update type is ignored.
+  struct OldUpdate {
+    int index;
+    size_t entity_hash;
+  };
+  absl::Hash<std::string> hasher;
+  absl::flat_hash_map<std::string, OldUpdate> old_updates;
+  old_updates.reserve(old_request_.updates_size());
+  std::string key;
+  for (int i = 0; i < old_request_.updates_size(); ++i) {
+    const auto& update = old_request_.updates(i);
+    if (!EntryKey(update, &key)) continue;
+    // A duplicate key can only match once, so the later updates with the same
+    // key are deleted.
+    old_updates.emplace(
+        key, OldUpdate{i, hasher(update.entity().SerializeAsString())});
   }
 
-  // The custom comparator treats table_id and all match fields as the
-  // key value for comparing updates.
-  auto write_desc = ::p4::v1::WriteRequest::default_instance().GetDescriptor();
-  P4WriteRequestComparator comparator;
-  msg_differencer.TreatAsMapUsingKeyComparator(
-      write_desc->FindFieldByName("updates"), &comparator);
-  msg_differencer.set_repeated_field_comparison(
-      ::google::protobuf::util::MessageDifferencer::AS_SET);
-  auto update_desc = ::p4::v1::Update::default_instance().GetDescriptor();
-  msg_differencer.IgnoreField(update_desc->FindFieldByName("type"));
-
-  if (!msg_differencer.Compare(old_request_, new_request_)) {
-    // When differences occur, the output messages are formed from the
-    // updates field indices accumulated by the P4WriteRequestReporter.
-    if (delete_request) {
-      FillOutputFromReporterIndexes(old_request_, reporter.deleted_indexes(),
-                                    ::p4::v1::Update::DELETE, delete_request);
+  // Match the new updates against the old ones.  Every old update found is
+  // removed from the index, so it matches at most one new update.
+  std::vector<bool> old_matched(old_request_.updates_size(), false);
+  std::vector<bool> old_unchanged(old_request_.updates_size(), false);
+  std::vector<int> added_indexes;
+  std::vector<int> modified_indexes;
+  for (int i = 0; i < new_request_.updates_size(); ++i) {
+    const auto& update = new_request_.updates(i);
+    auto it = EntryKey(update, &key) ? old_updates.find(key)
+                                     : old_updates.end();
+    if (it == old_updates.end()) {
+      VLOG(1) << "Added update at index " << i;
+      added_indexes.push_back(i);
+      continue;
     }
-    if (add_request) {
-      FillOutputFromReporterIndexes(new_request_, reporter.added_indexes(),
-                                    ::p4::v1::Update::INSERT, add_request);
+    const OldUpdate old_update = it->second;
+    old_updates.erase(it);
+    old_matched[old_update.index] = true;
+    // Matching hashes are confirmed by comparing the serializations. When
+    // they differ, the entities may still only differ in the order of some
+    // repeated fields (e.g. match fields or action params), which is checked
+    // by the slower field by field comparison.
+    const auto& old_entity = old_request_.updates(old_update.index).entity();
+    std::string entity = update.entity().SerializeAsString();
+    bool unchanged = hasher(entity) == old_update.entity_hash &&
+                     entity == old_entity.SerializeAsString();
+    if (unchanged || ProtoEqual(old_entity, update.entity())) {
+      old_unchanged[old_update.index] = true;
+    } else {
+      VLOG(1) << "Modified update at index " << i;
+      modified_indexes.push_back(i);
     }
-    if (modify_request) {
-      FillOutputFromReporterIndexes(new_request_, reporter.modified_indexes(),
-                                    ::p4::v1::Update::MODIFY, modify_request);
+  }
+
+  std::vector<int> deleted_indexes;
+  std::vector<int> unchanged_indexes;
+  for (int i = 0; i < old_request_.updates_size(); ++i) {
+    if (!old_matched[i]) {
+      VLOG(1) << "Deleted update at index " << i;
+      deleted_indexes.push_back(i);
+    } else if (old_unchanged[i]) {
+      unchanged_indexes.push_back(i);
     }
   }
 
+  if (delete_request) {
+    FillOutputFromIndexes(old_request_, deleted_indexes,
+                          ::p4::v1::Update::DELETE, delete_request);
+  }
+  if (add_request) {
+    FillOutputFromIndexes(new_request_, added_indexes,
+                          ::p4::v1::Update::INSERT, add_request);
+  }
+  if (modify_request) {
+    FillOutputFromIndexes(new_request_, modified_indexes,
+                          ::p4::v1::Update::MODIFY, modify_request);
+  }
   if (unchanged_request) {
     unchanged_request->Clear();
-    const std::set<int>& unchanged_indexes = reporter.unchanged_indexes();
-    for (int u = 0; u < old_request_.updates_size(); ++u) {
-      if (unchanged_indexes.find(u) != unchanged_indexes.end())
-        *(unchanged_request->add_updates()) = old_request_.updates(u);
+    for (int i : unchanged_indexes) {
+      *unchanged_request->add_updates() = old_request_.updates(i);
     }
   }
 
-  return reporter.status();
+  return ::util::OkStatus();
 }
 
-void P4WriteRequestDiffer::FillOutputFromReporterIndexes(
+void P4WriteRequestDiffer::FillOutputFromIndexes(
     const ::p4::v1::WriteRequest& source_request,
-    const std::vector<int>& reporter_indexes, ::p4::v1::Update::Type type,
+    const std::vector<int>& indexes, ::p4::v1::Update::Type type,
     ::p4::v1::WriteRequest* output_request) {
   output_request->Clear();
-  for (int i : reporter_indexes) {
+  for (int i : indexes) {
     ::p4::v1::Update* update = output_request->add_updates();
     *update = source_request.updates(i);
     update->set_type(type);
   }
 }
 
-P4WriteRequestReporter::P4WriteRequestReporter()
-    : status_(::util::OkStatus()) {}
-
-// ReportAdded and ReportDeleted are interested only in changes that roll up
-// to the first-level repeated Update message nested inside the compared
-// P4 WriteRequests.   Details at lower levels of the field_path are not
-// processed.
-void P4WriteRequestReporter::ReportAdded(
-    const ::google::protobuf::Message& message1,
-    const ::google::protobuf::Message& message2,
-    const FieldVector& field_path) {
-  if (field_path.size() != 1) return;
-  VLOG(1) << "ReportAdded " << field_path[0].field->full_name() << " index "
-          << field_path[0].index;
-  added_indexes_.push_back(field_path[0].index);
-}
-
-void P4WriteRequestReporter::ReportDeleted(
-    const ::google::protobuf::Message& message1,
-    const ::google::protobuf::Message& message2,
-    const FieldVector& field_path) {
-  if (field_path.size() != 1) return;
-  VLOG(1) << "ReportAdded " << field_path[0].field->full_name() << " index "
-          << field_path[0].index;
-  deleted_indexes_.push_back(field_path[0].index);
-}
-
-void P4WriteRequestReporter::ReportModified(
-    const ::google::protobuf::Message& message1,
-    const ::google::protobuf::Message& message2,
-    const FieldVector& field_path) {
-  if (field_path.size() != 2) return;
-  VLOG(1) << "ReportModified " << field_path[0].field->full_name() << " index "
-          << field_path[0].new_index;
-  modified_indexes_.push_back(field_path[0].new_index);
-}
-
-void P4WriteRequestReporter::ReportMoved(
-    const ::google::protobuf::Message& message1,
-    const ::google::protobuf::Message& message2,
-    const FieldVector& field_path) {
-  if (field_path.size() != 1) return;
-  VLOG(1) << "ReportMoved " << field_path[0].field->full_name() << " index "
-          << field_path[0].index;
-  unchanged_indexes_.insert(field_path[0].index);
-}
-
-void P4WriteRequestReporter::ReportMatched(
-    const ::google::protobuf::Message& message1,
-    const ::google::protobuf::Message& message2,
-    const FieldVector& field_path) {
-  if (field_path.size() != 1) return;
-  VLOG(1) << "ReportMatched " << field_path[0].field->full_name() << " index "
-          << field_path[0].index;
-  unchanged_indexes_.insert(field_path[0].index);
-}
-
-// To match, both messages must:
-//  - Have a table_entry.
-//  - Table IDs must be equal.
-//  - Both entries must have the same match fields.
-bool P4WriteRequestComparator::IsMatch(
-    const google::protobuf::Message& message1,
-    const google::protobuf::Message& message2,  // NOLINTNEXTLINE
-    const std::vector<google::protobuf::util::MessageDifferencer::SpecificField>&
-    parent_fields) const {
-  const ::p4::v1::Update& update1 =
-      *google::protobuf::DynamicCastToGenerated<const ::p4::v1::Update>(
-          &message1);
-  const ::p4::v1::Update& update2 =
-      *google::protobuf::DynamicCastToGenerated<const ::p4::v1::Update>(
-          &message2);
-  if (!update1.entity().has_table_entry()) return false;
-  if (!update2.entity().has_table_entry()) return false;
-  const auto& table_entry1 = update1.entity().table_entry();
-  const auto& table_entry2 = update2.entity().table_entry();
-  if (table_entry1.table_id() != table_entry2.table_id()) return false;
-  if (table_entry1.match_size() != table_entry2.match_size()) return false;
-
-  // Another MessageDifferencer compares the match fields.  The match fields
-  // can be in any order, so the comparison treats them as a map with field_id
-  // as the key.
-  ::google::protobuf::util::MessageDifferencer msg_differencer;
-  auto entry_desc = ::p4::v1::TableEntry::default_instance().GetDescriptor();
-  auto match_desc = ::p4::v1::FieldMatch::default_instance().GetDescriptor();
-  auto match_field_desc = entry_desc->FindFieldByName("match");
-  msg_differencer.TreatAsMap(match_field_desc,
-                             match_desc->FindFieldByName("field_id"));
-  std::vector<const ::google::protobuf::FieldDescriptor*> compare_fields = {
-      match_field_desc};
-  return msg_differencer.CompareWithFields(table_entry1, table_entry2,
-                                           compare_fields, compare_fields);
-}
-
 }  // namespace hal
 }  // namespace stratum
@@ -23,11 +23,9 @@
 #ifndef STRATUM_HAL_LIB_P4_P4_WRITE_REQUEST_DIFFER_H_
 #define STRATUM_HAL_LIB_P4_P4_WRITE_REQUEST_DIFFER_H_
 
-#include <set>
 #include <vector>
 
 #include "google/protobuf/message.h"
-#include "google/protobuf/util/message_differencer.h"
 #include "p4/v1/p4runtime.pb.h"
 #include "stratum/glue/status/status.h"
 
@@ -41,6 +39,11 @@ namespace hal {
 // latest P4PipelineConfig push.  The GenerateAddAndDeleteRequests method
 // compares the injected WriteRequests and outputs WriteRequests that contain
 // only the differences.
+//
+// The comparison runs in linear time in the number of updates, so it can
+// also be used to reconcile full table snapshots.  Updates are indexed in a
+// hash map by a canonical key formed from their table_id, priority and match
+// fields, and the remaining content of matching updates is compared by hash.
 class P4WriteRequestDiffer {
  public:
   // The constructor takes the pair of P4 runtime WriteRequests to compare.
@@ -66,13 +69,17 @@ class P4WriteRequestDiffer {
   //      and new_request, but have different field values.  To evaluate
   //      whether updates in old_request and new_request refer to the same
   //      static entry, P4WriteRequestDiffer forms a key from the entry's
-  //      table_id plus the set of all the entry's match fields.  Updates in
-  //      this output have type MODIFY.
+  //      table_id and priority plus the set of all the entry's match fields.
+  //      Updates in this output have type MODIFY.
   //  unchanged_request - contains static entries that do not vary between
   //      old_request and new_request.  This output includes all updates
   //      that are in a different order in the old and new requests, but have
   //      no other field changes.Updates in this output have the same type
   //      as the input request.
+  // The order of repeated fields within the updates, such as the match fields
+  // or the action parameters, is not significant.  Updates without a table
+  // entry never match, so they are always deleted and added.  Outputs from
+  // old_request keep its order, and outputs from new_request keep its order.
   // The caller can selectively choose to disable any output by passing nullptr.
   ::util::Status Compare(::p4::v1::WriteRequest* delete_request,
                          ::p4::v1::WriteRequest* add_request,
@@ -90,115 +97,18 @@ class P4WriteRequestDiffer {
                            ::p4::v1::WriteRequest* modify_request,
                            ::p4::v1::WriteRequest* unchanged_request);
 
-  // Populates output_request with data accumulated by a P4WriteRequestReporter
-  // during comparison of the old_request_/new_request_ pair.
-  void FillOutputFromReporterIndexes(
-      const ::p4::v1::WriteRequest& source_request,
-      const std::vector<int>& reporter_indexes, ::p4::v1::Update::Type type,
-      ::p4::v1::WriteRequest* output_request);
+  // Populates output_request with the updates at the given indexes of
+  // source_request, converted to the given type.
+  void FillOutputFromIndexes(const ::p4::v1::WriteRequest& source_request,
+                             const std::vector<int>& indexes,
+                             ::p4::v1::Update::Type type,
+                             ::p4::v1::WriteRequest* output_request);
 
   // These members refer to the two WriteRequests for comparison.
   const ::p4::v1::WriteRequest& old_request_;
   const ::p4::v1::WriteRequest& new_request_;
 };
 
-// P4WriteRequestDiffer attaches this Reporter subclass to a MessageDifferencer
-// in order to identify P4 WriteRequest entries that have changed.  The
-// P4WriteRequestReporter expects its enclosing MessageDifferencer to be
-// using the "AS_SET" mode of repeated field comparison.
-class P4WriteRequestReporter
-    : public ::google::protobuf::util::MessageDifferencer::Reporter {
- public:
-  // This type simplifies the declaration of the member overrides below.
-  typedef std::vector<
-      ::google::protobuf::util::MessageDifferencer::SpecificField>
-      FieldVector;
-
-  P4WriteRequestReporter();
-  ~P4WriteRequestReporter() override {}
-
-  // Reports that a field has been added into message2.
-  void ReportAdded(const ::google::protobuf::Message& message1,
-                   const ::google::protobuf::Message& message2,
-                   const FieldVector& field_path) override;
-
-  // Reports that a field has been deleted from message1.
-  void ReportDeleted(const ::google::protobuf::Message& message1,
-                     const ::google::protobuf::Message& message2,
-                     const FieldVector& field_path) override;
-
-  // Reports that a field in message1 has been modified by message2.
-  void ReportModified(const ::google::protobuf::Message& message1,
-                      const ::google::protobuf::Message& message2,
-                      const FieldVector& field_path) override;
-
-  // Reports that a field in message1 has been moved in message2, but no
-  // other changes exist.
-  void ReportMoved(const ::google::protobuf::Message& message1,
-                   const ::google::protobuf::Message& message2,
-                   const FieldVector& field_path) override;
-
-  // Reports that message1 and message2 match.
-  void ReportMatched(const ::google::protobuf::Message& message1,
-                     const ::google::protobuf::Message& message2,
-                     const FieldVector& field_path) override;
-
-  // Accessors to containers with indices of added/deleted/modified/unchanged
-  // fields.
-  const std::vector<int>& deleted_indexes() const { return deleted_indexes_; }
-  const std::vector<int>& added_indexes() const { return added_indexes_; }
-  const std::vector<int>& modified_indexes() const { return modified_indexes_; }
-  const std::set<int>& unchanged_indexes() const { return unchanged_indexes_; }
-
-  // Accesses the status outcome following all reported additions, deletions,
-  // and modifications in the message comparison.
-  const ::util::Status& status() { return status_; }
-
-  // P4WriteRequestReporter is neither copyable nor movable.
-  P4WriteRequestReporter(const P4WriteRequestReporter&) = delete;
-  P4WriteRequestReporter& operator=(const P4WriteRequestReporter&) = delete;
-
- private:
-  // Maintains overall P4WriteRequestReporter status as this instance processes
-  // reports of additions, deletions, and modifications.
-  ::util::Status status_;
-
-  // As the field comparison reports differences, P4WriteRequestReporter
-  // accumulates field changes, or lack thereof, in these containers.  An index
-  // in deleted_indexes_ is relative to message1 in ReportDeleted, an index
-  // in added_indexes_ is relative to message2 in ReportAdded, and an index
-  // in modified__indexes_ is relative to message2 in ReportModified.
-  std::vector<int> deleted_indexes_;
-  std::vector<int> added_indexes_;
-  std::vector<int> modified_indexes_;
-  std::set<int> unchanged_indexes_;
-};
-
-// P4WriteRequestDiffer attaches this MapKeyComparator subclass to a
-// MessageDifferencer to compare two updates within a P4 WriteRequest.  The
-// IsMatch override treats the update table_id and match fields as the
-// comparison key, i.e. a P4 Update message pair with the same table_id and
-// match field set is considered to be a match.  If a P4 Update message pair
-// has the same key value according to IsMatch, but the message pair differs
-// in other fields, then P4WriteRequestDiffer considers the change to be a
-// modification of the same update.
-class P4WriteRequestComparator
-    : public ::google::protobuf::util::MessageDifferencer::MapKeyComparator {
- public:
-  P4WriteRequestComparator() {}
-  ~P4WriteRequestComparator() override{};
-
-  bool IsMatch(const ::google::protobuf::Message& message1,
-               const ::google::protobuf::Message& message2,
-               const std::vector<
-                   ::google::protobuf::util::MessageDifferencer::SpecificField>&
-                   parent_fields) const override;
-
-  // P4WriteRequestComparator is neither copyable nor movable.
-  P4WriteRequestComparator(const P4WriteRequestComparator&) = delete;
-  P4WriteRequestComparator& operator=(const P4WriteRequestComparator&) = delete;
-};
-
 }  // namespace hal
 }  // namespace stratum
 
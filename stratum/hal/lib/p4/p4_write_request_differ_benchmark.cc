@@ -0,0 +1,114 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks measuring P4WriteRequestDiffer on table snapshots of increasing
+// size.
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "p4/v1/p4runtime.pb.h"
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/logging.h"
+#include "stratum/hal/lib/p4/p4_write_request_differ.h"
+
+namespace stratum {
+namespace hal {
+namespace {
+
+// Returns a big-endian encoding of 'value' in 'width' bytes.
+std::string Bytes(uint64 value, int width) {
+  std::string bytes(width, '\0');
+  for (int i = width - 1; i >= 0; --i, value >>= 8) {
+    bytes[i] = static_cast<char>(value & 0xff);
+  }
+  return bytes;
+}
+
+// Adds an IPv4 route like table entry, with an LPM and a ternary match field
+// and a two parameter action.
+void AddEntry(int i, ::p4::v1::WriteRequest* request) {
+  auto* update = request->add_updates();
+  update->set_type(::p4::v1::Update::INSERT);
+  auto* table_entry = update->mutable_entity()->mutable_table_entry();
+  table_entry->set_table_id(33554433);
+  table_entry->set_priority(10);
+  auto* match = table_entry->add_match();
+  match->set_field_id(1);
+  match->mutable_lpm()->set_value(Bytes(i << 8, 4));
+  match->mutable_lpm()->set_prefix_len(24);
+  match = table_entry->add_match();
+  match->set_field_id(2);
+  match->mutable_ternary()->set_value(Bytes(i % 4096, 2));
+  match->mutable_ternary()->set_mask(Bytes(0xfff, 2));
+  auto* action = table_entry->mutable_action()->mutable_action();
+  action->set_action_id(16777217);
+  auto* param = action->add_params();
+  param->set_param_id(1);
+  param->set_value(Bytes(i % 64, 2));
+  param = action->add_params();
+  param->set_param_id(2);
+  param->set_value(Bytes(0x0000aabbccdd0000 + i, 6));
+}
+
+// Compares a snapshot of 'num_entries' entries with a shuffled copy in which
+// 1% of the entries are deleted, 1% are modified and 1% are added.
+void BM_Compare(benchmark::State& state) {
+  const int num_entries = state.range(0);
+  const int num_changes = num_entries / 100;
+  ::p4::v1::WriteRequest old_request;
+  for (int i = 0; i < num_entries; ++i) AddEntry(i, &old_request);
+  ::p4::v1::WriteRequest new_request;
+  for (int i = num_changes; i < num_entries + num_changes; ++i) {
+    AddEntry(i, &new_request);
+  }
+  for (int i = 0; i < num_changes; ++i) {
+    new_request.mutable_updates(i)
+        ->mutable_entity()
+        ->mutable_table_entry()
+        ->mutable_action()
+        ->mutable_action()
+        ->set_action_id(16777218);
+  }
+  std::shuffle(new_request.mutable_updates()->pointer_begin(),
+               new_request.mutable_updates()->pointer_end(),
+               std::mt19937(1));
+
+  ::p4::v1::WriteRequest delete_request;
+  ::p4::v1::WriteRequest add_request;
+  ::p4::v1::WriteRequest modify_request;
+  ::p4::v1::WriteRequest unchanged_request;
+  for (auto _ : state) {
+    P4WriteRequestDiffer differ(old_request, new_request);
+    CHECK_OK(differ.Compare(&delete_request, &add_request, &modify_request,
+                            &unchanged_request));
+  }
+  CHECK_EQ(num_changes, delete_request.updates_size());
+  CHECK_EQ(num_changes, add_request.updates_size());
+  CHECK_EQ(num_changes, modify_request.updates_size());
+  state.SetItemsProcessed(state.iterations() * num_entries);
+}
+BENCHMARK(BM_Compare)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace hal
+}  // namespace stratum
+
+BENCHMARK_MAIN();
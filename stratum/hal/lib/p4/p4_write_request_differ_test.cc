@@ -461,14 +461,15 @@ TEST_F(P4WriteRequestDifferTest, TestNullDeletions) {
   SetUpTestRequest(three_text_updates_, &old_request_);
   ASSERT_EQ(3, old_request_.updates_size());
 
-  // One table_id is modified and one priority is adjusted so all output
+  // One table_id is modified and one action_id is adjusted so all output
   // requests have entries.
   new_request_ = old_request_;
   auto modify_entity = new_request_.mutable_updates(2)->mutable_entity();
   modify_entity->mutable_table_entry()->set_table_id(
       modify_entity->table_entry().table_id() + 1);
   modify_entity = new_request_.mutable_updates(1)->mutable_entity();
-  modify_entity->mutable_table_entry()->set_priority(0xabc);
+  modify_entity->mutable_table_entry()->mutable_action()->mutable_action()
+      ->set_action_id(0xabc);
 
   P4WriteRequestDiffer test_differ(old_request_, new_request_);
   EXPECT_OK(test_differ.Compare(nullptr, &additions_, &modified_, &unchanged_));
@@ -482,14 +483,15 @@ TEST_F(P4WriteRequestDifferTest, TestNullAdditions) {
   SetUpTestRequest(three_text_updates_, &old_request_);
   ASSERT_EQ(3, old_request_.updates_size());
 
-  // One table_id is modified and one priority is adjusted so all output
+  // One table_id is modified and one action_id is adjusted so all output
   // requests have entries.
   new_request_ = old_request_;
   auto modify_entity = new_request_.mutable_updates(2)->mutable_entity();
   modify_entity->mutable_table_entry()->set_table_id(
       modify_entity->table_entry().table_id() + 1);
   modify_entity = new_request_.mutable_updates(1)->mutable_entity();
-  modify_entity->mutable_table_entry()->set_priority(0xabc);
+  modify_entity->mutable_table_entry()->mutable_action()->mutable_action()
+      ->set_action_id(0xabc);
 
   P4WriteRequestDiffer test_differ(old_request_, new_request_);
   EXPECT_OK(test_differ.Compare(&deletions_, nullptr, &modified_, &unchanged_));
@@ -503,14 +505,15 @@ TEST_F(P4WriteRequestDifferTest, TestNullModified) {
   SetUpTestRequest(three_text_updates_, &old_request_);
   ASSERT_EQ(3, old_request_.updates_size());
 
-  // One table_id is modified and one priority is adjusted so all output
+  // One table_id is modified and one action_id is adjusted so all output
   // requests have entries.
   new_request_ = old_request_;
   auto modify_entity = new_request_.mutable_updates(2)->mutable_entity();
   modify_entity->mutable_table_entry()->set_table_id(
       modify_entity->table_entry().table_id() + 1);
   modify_entity = new_request_.mutable_updates(1)->mutable_entity();
-  modify_entity->mutable_table_entry()->set_priority(0xabc);
+  modify_entity->mutable_table_entry()->mutable_action()->mutable_action()
+      ->set_action_id(0xabc);
 
   P4WriteRequestDiffer test_differ(old_request_, new_request_);
   EXPECT_OK(
@@ -525,14 +528,15 @@ TEST_F(P4WriteRequestDifferTest, TestNullUnchanged) {
   SetUpTestRequest(three_text_updates_, &old_request_);
   ASSERT_EQ(3, old_request_.updates_size());
 
-  // One table_id is modified and one priority is adjusted so all output
+  // One table_id is modified and one action_id is adjusted so all output
   // requests have entries.
   new_request_ = old_request_;
   auto modify_entity = new_request_.mutable_updates(2)->mutable_entity();
   modify_entity->mutable_table_entry()->set_table_id(
       modify_entity->table_entry().table_id() + 1);
   modify_entity = new_request_.mutable_updates(1)->mutable_entity();
-  modify_entity->mutable_table_entry()->set_priority(0xabc);
+  modify_entity->mutable_table_entry()->mutable_action()->mutable_action()
+      ->set_action_id(0xabc);
 
   P4WriteRequestDiffer test_differ(old_request_, new_request_);
   EXPECT_OK(test_differ.Compare(&deletions_, &additions_, &modified_, nullptr));
@@ -590,5 +594,76 @@ TEST_F(P4WriteRequestDifferTest, TestIgnoreUpdateType) {
   EXPECT_EQ(3, unchanged_.updates_size());
 }
 
+// Tests changing the priority of an entry, which makes it a different entry.
+TEST_F(P4WriteRequestDifferTest, TestModifyPriority) {
+  SetUpTestRequest(three_text_updates_, &old_request_);
+  ASSERT_EQ(3, old_request_.updates_size());
+  new_request_ = old_request_;
+  new_request_.mutable_updates(1)
+      ->mutable_entity()
+      ->mutable_table_entry()
+      ->set_priority(0xabc);
+
+  P4WriteRequestDiffer test_differ(old_request_, new_request_);
+  EXPECT_OK(
+      test_differ.Compare(&deletions_, &additions_, &modified_, &unchanged_));
+  ASSERT_EQ(1, deletions_.updates_size());
+  ::p4::v1::Update expected_update = old_request_.updates(1);
+  expected_update.set_type(::p4::v1::Update::DELETE);
+  EXPECT_TRUE(msg_differencer_.Compare(expected_update, deletions_.updates(0)));
+  ASSERT_EQ(1, additions_.updates_size());
+  expected_update = new_request_.updates(1);
+  expected_update.set_type(::p4::v1::Update::INSERT);
+  EXPECT_TRUE(msg_differencer_.Compare(expected_update, additions_.updates(0)));
+  EXPECT_EQ(0, modified_.updates_size());
+  EXPECT_EQ(2, unchanged_.updates_size());
+}
+
+// Tests reordering the action parameters of an entry, which is not a change.
+TEST_F(P4WriteRequestDifferTest, TestReorderActionParams) {
+  SetUpTestRequest(three_text_updates_, &old_request_);
+  ASSERT_EQ(3, old_request_.updates_size());
+  auto* action = old_request_.mutable_updates(0)
+                     ->mutable_entity()
+                     ->mutable_table_entry()
+                     ->mutable_action()
+                     ->mutable_action();
+  auto* param = action->add_params();
+  param->set_param_id(1);
+  param->set_value("\001");
+  param = action->add_params();
+  param->set_param_id(2);
+  param->set_value("\002");
+  new_request_ = old_request_;
+  new_request_.mutable_updates(0)
+      ->mutable_entity()
+      ->mutable_table_entry()
+      ->mutable_action()
+      ->mutable_action()
+      ->mutable_params()
+      ->SwapElements(0, 1);
+
+  P4WriteRequestDiffer test_differ(old_request_, new_request_);
+  EXPECT_OK(
+      test_differ.Compare(&deletions_, &additions_, &modified_, &unchanged_));
+  EXPECT_EQ(0, deletions_.updates_size());
+  EXPECT_EQ(0, additions_.updates_size());
+  EXPECT_EQ(0, modified_.updates_size());
+  EXPECT_EQ(3, unchanged_.updates_size());
+
+  // Changing a value is a modification.
+  new_request_.mutable_updates(0)
+      ->mutable_entity()
+      ->mutable_table_entry()
+      ->mutable_action()
+      ->mutable_action()
+      ->mutable_params(0)
+      ->set_value("\003");
+  EXPECT_OK(
+      test_differ.Compare(&deletions_, &additions_, &modified_, &unchanged_));
+  EXPECT_EQ(1, modified_.updates_size());
+  EXPECT_EQ(2, unchanged_.updates_size());
+}
+
 }  // namespace hal
 }  // namespace stratum
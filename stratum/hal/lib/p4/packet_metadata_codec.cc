@@ -0,0 +1,126 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/p4/packet_metadata_codec.h"
+
+#include <algorithm>
+
+#include "stratum/glue/logging.h"
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/macros.h"
+#include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+
+namespace {
+
+// Metadata IDs up to this value are indexed directly.
+constexpr uint32 kMaxIndexedId = 255;
+
+// Max number of fields which can be indexed by the uint8 indexes.
+constexpr size_t kMaxFields = 255;
+
+}  // namespace
+
+PacketMetadataCodec::PacketMetadataCodec(const std::vector<Field>& fields)
+    : fields_(),
+      field_by_type_(P4FieldType_ARRAYSIZE, 0),
+      field_by_id_() {
+  for (const auto& field : fields) {
+    if (fields_.size() == kMaxFields) {
+      LOG(WARNING) << "Too many packet metadata fields. Skipped metadata with "
+                   << "ID " << field.id << ".";
+      continue;
+    }
+    bool new_type = FindByType(field.type) == nullptr;
+    bool new_id = FindById(field.id) == nullptr;
+    if (!new_type && !new_id) continue;
+    fields_.push_back(field);
+    const uint8 index = fields_.size();
+    if (new_type && P4FieldType_IsValid(field.type)) {
+      field_by_type_[field.type] = index;
+    }
+    if (new_id && field.id <= kMaxIndexedId) {
+      if (field.id >= field_by_id_.size()) field_by_id_.resize(field.id + 1, 0);
+      field_by_id_[field.id] = index;
+    }
+  }
+}
+
+::util::Status PacketMetadataCodec::Encode(
+    P4FieldType type, uint32 value, ::p4::v1::PacketMetadata* metadata) const {
+  const Field* field = FindByType(type);
+  if (field == nullptr) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Don't know how to deparse metadata of type "
+           << P4FieldType_Name(type) << ".";
+  }
+  if (field->bitwidth > 32) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Incorrect bitwidth for a u32: " << field->bitwidth
+           << ". Metadata type: " << P4FieldType_Name(type) << ".";
+  }
+  metadata->set_metadata_id(field->id);
+  // Big-endian without the leading zeroes, but at least one byte. The value
+  // fits in the inline buffer of the string, so no allocation is needed.
+  char bytes[sizeof(value)];
+  int start = sizeof(value) - 1;
+  for (int i = sizeof(value) - 1; i >= 0; --i, value >>= 8) {
+    bytes[i] = static_cast<char>(value & 0xff);
+    if (bytes[i] != 0) start = i;
+  }
+  metadata->set_value(bytes + start, sizeof(bytes) - start);
+
+  return ::util::OkStatus();
+}
+
+::util::Status PacketMetadataCodec::Decode(
+    const ::p4::v1::PacketMetadata& metadata, P4FieldType* type,
+    uint32* value) const {
+  const Field* field = FindById(metadata.metadata_id());
+  if (field == nullptr) {
+    return MAKE_ERROR(ERR_INVALID_PARAM)
+           << "Don't know how to parse P4 metadata with ID "
+           << metadata.metadata_id() << ".";
+  }
+  *type = field->type;
+  *value =
+      field->bitwidth <= 32 ? ByteStreamToUint<uint32>(metadata.value()) : 0;
+
+  return ::util::OkStatus();
+}
+
+const PacketMetadataCodec::Field* PacketMetadataCodec::FindByType(
+    P4FieldType type) const {
+  if (!P4FieldType_IsValid(type)) return nullptr;
+  uint8 index = field_by_type_[type];
+  return index > 0 ? &fields_[index - 1] : nullptr;
+}
+
+const PacketMetadataCodec::Field* PacketMetadataCodec::FindById(
+    uint32 id) const {
+  if (id <= kMaxIndexedId) {
+    if (id >= field_by_id_.size()) return nullptr;
+    uint8 index = field_by_id_[id];
+    return index > 0 ? &fields_[index - 1] : nullptr;
+  }
+  auto it = std::find_if(fields_.begin(), fields_.end(),
+                         [id](const Field& field) { return field.id == id; });
+  return it != fields_.end() ? &*it : nullptr;
+}
+
+}  // namespace hal
+}  // namespace stratum
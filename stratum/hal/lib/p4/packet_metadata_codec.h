@@ -0,0 +1,91 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_HAL_LIB_P4_PACKET_METADATA_CODEC_H_
+#define STRATUM_HAL_LIB_P4_PACKET_METADATA_CODEC_H_
+
+#include <vector>
+
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/public/proto/p4_table_defs.pb.h"
+#include "p4/v1/p4runtime.pb.h"
+
+namespace stratum {
+namespace hal {
+
+// PacketMetadataCodec translates between the P4 PacketMetadata of the packets
+// exchanged with the controller and the (type, value) pairs the switch
+// understands, e.g. the ingress port of a packet punted to the CPU. It is
+// compiled once per pipeline push from the packet in (or out) controller
+// metadata of the P4Info, so the per-packet work is limited to array lookups
+// and byte shuffling: no hash map lookups, no intermediate protos and no
+// string allocation for values of up to 32 bits.
+//
+// The codec gives the same results as the MappedPacketMetadata based methods
+// of P4TableMapper for values of up to 32 bits, which covers all the port,
+// trunk and CoS metadata. The class is immutable, hence thread-safe.
+class PacketMetadataCodec {
+ public:
+  // A controller metadata field, as found in P4Info and the P4PipelineConfig.
+  struct Field {
+    uint32 id;
+    P4FieldType type;
+    int bitwidth;
+  };
+
+  // Compiles the codec for the given fields. Like in P4TableMapper, the first
+  // field given for an ID or a type wins.
+  explicit PacketMetadataCodec(const std::vector<Field>& fields);
+
+  // Sets 'metadata' to the P4 PacketMetadata of the given type, with the given
+  // value. Returns ERR_INVALID_PARAM if the metadata of the given type is not
+  // known or is wider than 32 bits.
+  ::util::Status Encode(P4FieldType type, uint32 value,
+                        ::p4::v1::PacketMetadata* metadata) const;
+
+  // Finds the type of the given P4 PacketMetadata and decodes its value.
+  // Values of metadata wider than 32 bits are decoded as 0. Returns
+  // ERR_INVALID_PARAM if the metadata ID is not known.
+  ::util::Status Decode(const ::p4::v1::PacketMetadata& metadata,
+                        P4FieldType* type, uint32* value) const;
+
+  // PacketMetadataCodec is neither copyable nor movable.
+  PacketMetadataCodec(const PacketMetadataCodec&) = delete;
+  PacketMetadataCodec& operator=(const PacketMetadataCodec&) = delete;
+
+ private:
+  // Returns the field with the given type or ID, or nullptr if none.
+  const Field* FindByType(P4FieldType type) const;
+  const Field* FindById(uint32 id) const;
+
+  // The compiled fields.
+  std::vector<Field> fields_;
+
+  // Index of the field of each type in fields_ + 1, or 0 for unknown types.
+  // Indexed by P4FieldType.
+  std::vector<uint8> field_by_type_;
+
+  // Same for the metadata IDs. P4Info metadata IDs are small integers, local
+  // to their controller_packet_metadata. Larger IDs are found by scanning
+  // fields_.
+  std::vector<uint8> field_by_id_;
+};
+
+}  // namespace hal
+}  // namespace stratum
+
+#endif  // STRATUM_HAL_LIB_P4_PACKET_METADATA_CODEC_H_
@@ -0,0 +1,111 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/hal/lib/p4/packet_metadata_codec.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "stratum/public/lib/error.h"
+
+namespace stratum {
+namespace hal {
+
+class PacketMetadataCodecTest : public ::testing::Test {
+ protected:
+  PacketMetadataCodecTest()
+      : codec_({{1, P4_FIELD_TYPE_INGRESS_PORT, 9},
+                {2, P4_FIELD_TYPE_EGRESS_PORT, 32},
+                {1000, P4_FIELD_TYPE_COS, 3},
+                {4, P4_FIELD_TYPE_INGRESS_TRUNK, 48},
+                // Duplicate ID and type. Ignored.
+                {2, P4_FIELD_TYPE_INGRESS_PORT, 16}}) {}
+
+  PacketMetadataCodec codec_;
+};
+
+TEST_F(PacketMetadataCodecTest, Encode) {
+  ::p4::v1::PacketMetadata metadata;
+  ASSERT_OK(codec_.Encode(P4_FIELD_TYPE_INGRESS_PORT, 0x102, &metadata));
+  EXPECT_EQ(1, metadata.metadata_id());
+  EXPECT_EQ(std::string("\x01\x02", 2), metadata.value());
+
+  ASSERT_OK(codec_.Encode(P4_FIELD_TYPE_EGRESS_PORT, 0x80000001, &metadata));
+  EXPECT_EQ(2, metadata.metadata_id());
+  EXPECT_EQ(std::string("\x80\x00\x00\x01", 4), metadata.value());
+
+  ASSERT_OK(codec_.Encode(P4_FIELD_TYPE_COS, 0, &metadata));
+  EXPECT_EQ(1000, metadata.metadata_id());
+  EXPECT_EQ(std::string(1, '\0'), metadata.value());
+}
+
+TEST_F(PacketMetadataCodecTest, EncodeUnknownOrTooWideType) {
+  ::p4::v1::PacketMetadata metadata;
+  EXPECT_EQ(ERR_INVALID_PARAM,
+            codec_.Encode(P4_FIELD_TYPE_EGRESS_TRUNK, 1, &metadata)
+                .error_code());
+  EXPECT_EQ(ERR_INVALID_PARAM,
+            codec_.Encode(P4_FIELD_TYPE_INGRESS_TRUNK, 1, &metadata)
+                .error_code());
+}
+
+TEST_F(PacketMetadataCodecTest, Decode) {
+  ::p4::v1::PacketMetadata metadata;
+  P4FieldType type = P4_FIELD_TYPE_UNKNOWN;
+  uint32 value = 0;
+  metadata.set_metadata_id(1);
+  metadata.set_value(std::string("\x00\x01\x02", 3));
+  ASSERT_OK(codec_.Decode(metadata, &type, &value));
+  EXPECT_EQ(P4_FIELD_TYPE_INGRESS_PORT, type);
+  EXPECT_EQ(0x102, value);
+
+  metadata.set_metadata_id(1000);
+  metadata.set_value("\x05");
+  ASSERT_OK(codec_.Decode(metadata, &type, &value));
+  EXPECT_EQ(P4_FIELD_TYPE_COS, type);
+  EXPECT_EQ(5, value);
+
+  // Too wide for a u32.
+  metadata.set_metadata_id(4);
+  ASSERT_OK(codec_.Decode(metadata, &type, &value));
+  EXPECT_EQ(P4_FIELD_TYPE_INGRESS_TRUNK, type);
+  EXPECT_EQ(0, value);
+}
+
+TEST_F(PacketMetadataCodecTest, DecodeUnknownId) {
+  ::p4::v1::PacketMetadata metadata;
+  P4FieldType type;
+  uint32 value;
+  for (uint32 id : {0, 3, 999, 100000}) {
+    metadata.set_metadata_id(id);
+    EXPECT_EQ(ERR_INVALID_PARAM,
+              codec_.Decode(metadata, &type, &value).error_code());
+  }
+}
+
+TEST_F(PacketMetadataCodecTest, RoundTrip) {
+  ::p4::v1::PacketMetadata metadata;
+  P4FieldType type;
+  uint32 value;
+  for (uint32 v : {0u, 1u, 0xffu, 0x100u, 0xffffffffu}) {
+    ASSERT_OK(codec_.Encode(P4_FIELD_TYPE_EGRESS_PORT, v, &metadata));
+    ASSERT_OK(codec_.Decode(metadata, &type, &value));
+    EXPECT_EQ(P4_FIELD_TYPE_EGRESS_PORT, type);
+    EXPECT_EQ(v, value);
+  }
+}
+
+}  // namespace hal
+}  // namespace stratum
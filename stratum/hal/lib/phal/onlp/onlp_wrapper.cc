@@ -15,6 +15,8 @@
 
 #include "stratum/hal/lib/phal/onlp/onlp_wrapper.h"
 
+#include <cstring>
+
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/lib/macros.h"
 #include "absl/memory/memory.h"
@@ -29,6 +31,20 @@ namespace onlp {
 constexpr int kOnlpBitmapBitsPerWord = 32;
 constexpr int kOnlpBitmapWordCount = 8;
 
+// I2C device addresses of the A0h and A2h EEPROM pages of a module.
+constexpr int kSfpA0DevAddr = 0x50;
+constexpr int kSfpA2DevAddr = 0x51;
+// Size of an EEPROM page as read by ONLP.
+constexpr int kSfpPageSize = 256;
+// Range of the real time diagnostic values in the DOM page: A2h bytes 96-105
+// for SFPs (SFF-8472), A0h bytes 22-57 for QSFPs (SFF-8636). Everything else
+// in the page (thresholds, calibration constants, ...) does not change while
+// the module is plugged in.
+constexpr int kSfpDomOffset = 96;
+constexpr int kSfpDomSize = 10;
+constexpr int kQsfpDomOffset = 22;
+constexpr int kQsfpDomSize = 36;
+
 OidInfo::OidInfo(const onlp_oid_type_t type, OnlpPortNumber port,
                  HwState state) {
   oid_info_.id = ONLP_OID_TYPE_CREATE(type, port);
@@ -90,6 +106,28 @@ OnlpWrapper::~OnlpWrapper() {
   return SfpInfo(sfp_info);
 }
 
+::util::StatusOr<SffDomInfo> OnlpWrapper::GetSfpDomInfo(
+    OnlpOid oid, const SfpInfo& sfp_info) const {
+  CHECK_RETURN_IF_FALSE(ONLP_OID_IS_SFP(oid))
+      << "Cannot get SFP DOM info: OID " << oid << " is not an SFP.";
+  ASSIGN_OR_RETURN(const SffInfo* sff_info, sfp_info.GetSffInfo());
+  bool is_sfp = sff_info->sfp_type == SFF_SFP_TYPE_SFP;
+  int offset = is_sfp ? kSfpDomOffset : kQsfpDomOffset;
+  // Start from the page read along with the rest of the SFP info and only
+  // re-read the real time values.
+  uint8_t page[kSfpPageSize];
+  memcpy(page, sfp_info.GetDomPage(), sizeof(page));
+  CHECK_RETURN_IF_FALSE(ONLP_SUCCESS(onlp_sfp_dev_read(
+      oid, is_sfp ? kSfpA2DevAddr : kSfpA0DevAddr, offset, page + offset,
+      sfp_info.GetDomSize())))
+      << "Failed to read DOM values for OID " << oid << ".";
+  SffInfo sff = *sff_info;
+  SffDomInfo dom_info = {};
+  CHECK_RETURN_IF_FALSE(ONLP_SUCCESS(sff_dom_info_get(&dom_info, &sff, page)))
+      << "Failed to parse DOM values for OID " << oid << ".";
+  return dom_info;
+}
+
 ::util::StatusOr<FanInfo> OnlpWrapper::GetFanInfo(OnlpOid oid) const {
   CHECK_RETURN_IF_FALSE(ONLP_OID_IS_FAN(oid))
       << "Cannot get FAN info: OID " << oid << " is not an FAN.";
@@ -317,6 +355,22 @@ void SfpInfo::GetModuleCaps(SfpModuleCaps* caps) const {
   return &sfp_info_.sff;
 }
 
+const uint8_t* SfpInfo::GetDomPage() const {
+  return sfp_info_.sff.sfp_type == SFF_SFP_TYPE_SFP ? sfp_info_.bytes.a2
+                                                    : sfp_info_.bytes.a0;
+}
+
+int SfpInfo::GetEepromSize() const {
+  // ONLP reads the A0h page of all modules, and the A2h page of SFPs.
+  return sfp_info_.sff.sfp_type == SFF_SFP_TYPE_SFP ? 2 * kSfpPageSize
+                                                    : kSfpPageSize;
+}
+
+int SfpInfo::GetDomSize() const {
+  return sfp_info_.sff.sfp_type == SFF_SFP_TYPE_SFP ? kSfpDomSize
+                                                    : kQsfpDomSize;
+}
+
 FanDir FanInfo::GetFanDir() const {
   switch (fan_info_.dir) {
   case ONLP_FAN_DIR_B2F:
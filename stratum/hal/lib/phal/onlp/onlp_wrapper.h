@@ -90,6 +90,15 @@ class SfpInfo : public OidInfo {
   const SffDomInfo* GetSffDomInfo() const { return &sfp_info_.dom; }
   ::util::StatusOr<const SffInfo*> GetSffInfo() const;
 
+  // Returns the raw EEPROM page holding the DOM values of the module: A2h for
+  // SFPs, A0h for QSFPs.
+  const uint8_t* GetDomPage() const;
+
+  // Number of EEPROM bytes read over I2C to get the full info of this module
+  // (GetSfpInfo) and to refresh only its DOM values (GetSfpDomInfo).
+  int GetEepromSize() const;
+  int GetDomSize() const;
+
  private:
   onlp_sfp_info_t sfp_info_;
 };
@@ -157,6 +166,13 @@ class OnlpInterface {
   // Given a OID object id, returns SFP info or failure.
   virtual ::util::StatusOr<SfpInfo> GetSfpInfo(OnlpOid oid) const = 0;
 
+  // Given a OID object id and the SFP info previously read for the module
+  // plugged in it, reads only the DOM (diagnostic monitoring) values of the
+  // module, i.e. temperature, voltage and per-channel power and bias, which is
+  // a fraction of the EEPROM read by GetSfpInfo().
+  virtual ::util::StatusOr<SffDomInfo> GetSfpDomInfo(
+      OnlpOid oid, const SfpInfo& sfp_info) const = 0;
+
   // Given a OID object id, returns FAN info or failure.
   virtual ::util::StatusOr<FanInfo> GetFanInfo(OnlpOid oid) const = 0;
 
@@ -224,6 +240,8 @@ class OnlpWrapper : public OnlpInterface {
   ::util::StatusOr<OidInfo> GetOidInfo(OnlpOid oid) const override;
   ::util::StatusOr<PsuInfo> GetPsuInfo(OnlpOid oid) const override;
   ::util::StatusOr<SfpInfo> GetSfpInfo(OnlpOid oid) const override;
+  ::util::StatusOr<SffDomInfo> GetSfpDomInfo(
+      OnlpOid oid, const SfpInfo& sfp_info) const override;
   ::util::StatusOr<FanInfo> GetFanInfo(OnlpOid oid) const override;
   ::util::Status SetFanPercent(OnlpOid oid, int value) const override;
   ::util::Status SetFanRpm(OnlpOid oid, int val) const override;
@@ -42,6 +42,8 @@ class MockOnlpWrapper : public OnlpInterface {
 
   MOCK_CONST_METHOD1(GetOidInfo, ::util::StatusOr<OidInfo>(OnlpOid oid));
   MOCK_CONST_METHOD1(GetSfpInfo, ::util::StatusOr<SfpInfo>(OnlpOid oid));
+  MOCK_CONST_METHOD2(GetSfpDomInfo,
+    ::util::StatusOr<SffDomInfo>(OnlpOid oid, const SfpInfo& sfp_info));
   MOCK_CONST_METHOD1(GetFanInfo, ::util::StatusOr<FanInfo>(OnlpOid oid));
   MOCK_CONST_METHOD2(SetLedMode, ::util::Status(OnlpOid oid, LedMode mode));
   MOCK_CONST_METHOD2(SetLedCharacter, ::util::Status(OnlpOid oid, char val));
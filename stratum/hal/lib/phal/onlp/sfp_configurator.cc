@@ -60,11 +60,15 @@ OnlpSfpConfigurator::Make(int id,
     switch (state) {
       // Add SFP attributes
       case HW_STATE_PRESENT:
+        // A new transceiver may have been plugged in. Read its EEPROM once,
+        // the periodic updates only refresh its DOM values.
+        RETURN_IF_ERROR(datasource_->RefreshStaticInfo());
         RETURN_IF_ERROR(AddSfp());
         break;
 
       // Remove SFP attributes
       case HW_STATE_NOT_PRESENT:
+        datasource_->InvalidateStaticInfo();
         RETURN_IF_ERROR(RemoveSfp());
         break;
 
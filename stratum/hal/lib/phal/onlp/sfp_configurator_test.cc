@@ -124,7 +124,7 @@ class OnlpSfpConfiguratorTest : public ::testing::Test {
   }
 
   ::util::Status SetupSfpConfigurator() {
-    SetupAddSfp(1, 2);
+    SetupAddSfp(1, 1, 1);
 
     // Create Datasourcec cache policy
     ASSIGN_OR_RETURN(auto cache, CachePolicyFactory::CreateInstance(
@@ -149,7 +149,8 @@ class OnlpSfpConfiguratorTest : public ::testing::Test {
     return ::util::OkStatus();
   }
 
-  ::util::Status SetupAddSfp(int num_get_oid = 1, int num_get_sfp = 1) {
+  ::util::Status SetupAddSfp(int num_get_oid = 1, int num_get_sfp = 1,
+                             int num_get_sfp_dom = 0) {
     if (num_get_oid > 0) {
       // Oid info
       onlp_oid_hdr_t mock_oid_info;
@@ -161,9 +162,10 @@ class OnlpSfpConfiguratorTest : public ::testing::Test {
 
     if (num_get_sfp > 0) {
       // Sfp Info
-      onlp_sfp_info_t mock_sfp_info;
+      onlp_sfp_info_t mock_sfp_info = {};
       mock_sfp_info.hdr.status = ONLP_OID_STATUS_FLAG_PRESENT;
       mock_sfp_info.type = ONLP_SFP_TYPE_SFP;
+      mock_sfp_info.sff.sfp_type = SFF_SFP_TYPE_SFP;
 
       // SFF Diag info
       mock_sfp_info.dom.voltage = 12;
@@ -182,6 +184,14 @@ class OnlpSfpConfiguratorTest : public ::testing::Test {
       EXPECT_CALL(*onlp_interface_, GetSfpInfo(ONLP_SFP_ID_CREATE(id_)))
           .Times(num_get_sfp)
           .WillRepeatedly(Return(SfpInfo(mock_sfp_info)));
+
+      // tuneable number of DOM only reads
+      if (num_get_sfp_dom > 0) {
+        EXPECT_CALL(*onlp_interface_,
+                    GetSfpDomInfo(ONLP_SFP_ID_CREATE(id_), _))
+            .Times(num_get_sfp_dom)
+            .WillRepeatedly(Return(mock_sfp_info.dom));
+      }
     }
 
     return ::util::OkStatus();
@@ -239,6 +249,9 @@ TEST_F(OnlpSfpConfiguratorTest, RemoveSfpError) {
 }
 
 TEST_F(OnlpSfpConfiguratorTest, HandlEventPresent) {
+  // The full SFP info is read again for the newly inserted transceiver.
+  SetupAddSfp(0, 1);
+
   // Handle Event
   EXPECT_OK(configurator_->HandleEvent(HW_STATE_PRESENT));
 }
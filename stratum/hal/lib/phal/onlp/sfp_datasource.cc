@@ -15,6 +15,7 @@
 
 #include "stratum/hal/lib/phal/onlp/sfp_datasource.h"
 
+#include <algorithm>
 #include <cmath>
 #include "stratum/hal/lib/common/common.pb.h"
 #include "stratum/hal/lib/phal/datasource.h"
@@ -48,9 +49,9 @@ double ConvertMicrowattsTodBm(double microwatts) {
   std::shared_ptr<OnlpSfpDataSource> sfp_data_source(
       new OnlpSfpDataSource(sfp_id, onlp_interface, cache_policy, sfp_info));
 
-  // Retrieve attributes' initial values.
+  // Retrieve the DOM attributes' initial values. The static ones were
+  // assigned from 'sfp_info'.
   // TODO(unknown): Move the logic to Configurator later?
-  // sfp_data_source->updateValues();
   sfp_data_source->UpdateValuesUnsafelyWithoutCacheOrLock();
   return sfp_data_source;
 }
@@ -59,25 +60,21 @@ OnlpSfpDataSource::OnlpSfpDataSource(int sfp_id,
                                      OnlpInterface* onlp_interface,
                                      CachePolicy* cache_policy,
                                      const SfpInfo& sfp_info)
-    : DataSource(cache_policy), onlp_stub_(onlp_interface) {
+    : DataSource(cache_policy),
+      onlp_stub_(onlp_interface),
+      static_info_valid_(false),
+      i2c_bytes_read_last_update_(0),
+      i2c_bytes_read_total_(0) {
 
   sfp_oid_ = ONLP_SFP_ID_CREATE(sfp_id);
 
-  // NOTE: Following attributes aren't going to change through the lifetime
-  // of this datasource, therefore no reason to put them in the UpdateValues
-  // function call.
-
   // Once the sfp present, the oid won't change. Do not add setter for id.
   sfp_id_.AssignValue(sfp_id);
 
-  // Set Sfp Module Caps
-  SfpModuleCaps caps;
-  sfp_info.GetModuleCaps(&caps);
-  sfp_module_cap_f_100_.AssignValue(caps.f_100());
-  sfp_module_cap_f_1g_.AssignValue(caps.f_1g());
-  sfp_module_cap_f_10g_.AssignValue(caps.f_10g());
-  sfp_module_cap_f_40g_.AssignValue(caps.f_40g());
-  sfp_module_cap_f_100g_.AssignValue(caps.f_100g());
+  // The info was read by Make(). The following updates only read the DOM
+  // values, until the transceiver is replaced.
+  if (sfp_info.Present()) i2c_bytes_read_total_ = sfp_info.GetEepromSize();
+  UpdateStaticValues(sfp_info);
 
   if (!sfp_info.GetSffInfo().ok()) {
     LOG(ERROR) << "Cannot get SFF info for the SFP with ID " << sfp_id << ".";
@@ -93,18 +90,84 @@ OnlpSfpDataSource::OnlpSfpDataSource(int sfp_id,
 }
 
 ::util::Status OnlpSfpDataSource::UpdateValues() {
+  i2c_bytes_read_last_update_ = 0;
+  if (static_info_valid_) {
+    ::util::StatusOr<SffDomInfo> result =
+        onlp_stub_->GetSfpDomInfo(sfp_oid_, static_info_);
+    if (result.ok()) {
+      i2c_bytes_read_last_update_ = static_info_.GetDomSize();
+      i2c_bytes_read_total_ += i2c_bytes_read_last_update_;
+      UpdateDomValues(result.ValueOrDie());
+      return ::util::OkStatus();
+    }
+    // The transceiver may have been replaced without the presence change
+    // being seen. Start over from the full EEPROM.
+    LOG(WARNING) << "Failed to read DOM values of SFP " << sfp_oid_ << ": "
+                 << result.status() << ". Reading the full SFP info.";
+    static_info_valid_ = false;
+  }
+  return ReadAllValues();
+}
+
+::util::Status OnlpSfpDataSource::RefreshStaticInfo() {
+  absl::MutexLock lock(&data_lock_);
+  i2c_bytes_read_last_update_ = 0;
+  return ReadAllValues();
+}
+
+void OnlpSfpDataSource::InvalidateStaticInfo() {
+  absl::MutexLock lock(&data_lock_);
+  static_info_valid_ = false;
+  sfp_hw_state_ = HW_STATE_NOT_PRESENT;
+}
+
+uint64 OnlpSfpDataSource::GetI2cBytesReadLastUpdate() {
+  absl::MutexLock lock(&data_lock_);
+  return i2c_bytes_read_last_update_;
+}
+
+uint64 OnlpSfpDataSource::GetI2cBytesReadTotal() {
+  absl::MutexLock lock(&data_lock_);
+  return i2c_bytes_read_total_;
+}
+
+::util::Status OnlpSfpDataSource::ReadAllValues() {
   ASSIGN_OR_RETURN(SfpInfo sfp_info, onlp_stub_->GetSfpInfo(sfp_oid_));
+  if (sfp_info.Present()) {
+    i2c_bytes_read_last_update_ += sfp_info.GetEepromSize();
+    i2c_bytes_read_total_ += sfp_info.GetEepromSize();
+  }
+  UpdateStaticValues(sfp_info);
+  // Other attributes are only valid if SFP is present.
+  if (!sfp_info.Present()) return ::util::OkStatus();
+  RETURN_IF_ERROR(sfp_info.GetSffInfo().status());
+  UpdateDomValues(*sfp_info.GetSffDomInfo());
+  return ::util::OkStatus();
+}
+
+void OnlpSfpDataSource::UpdateStaticValues(const SfpInfo& sfp_info) {
+  static_info_ = sfp_info;
+  static_info_valid_ = false;
   // Onlp hw_state always populated.
   sfp_hw_state_ = sfp_info.GetHardwareState();
-  // Other attributes are only valid if SFP is present. Return if sfp not
-  // present.
-  if (!sfp_info.Present()) return ::util::OkStatus();
+  if (!sfp_info.Present()) return;
 
   // Grab the OID header for the description
   auto oid_info = sfp_info.GetHeader();
   sfp_desc_.AssignValue(std::string(oid_info->description));
 
-  ASSIGN_OR_RETURN(const SffInfo* sff_info, sfp_info.GetSffInfo());
+  // Set Sfp Module Caps
+  SfpModuleCaps caps;
+  sfp_info.GetModuleCaps(&caps);
+  sfp_module_cap_f_100_.AssignValue(caps.f_100());
+  sfp_module_cap_f_1g_.AssignValue(caps.f_1g());
+  sfp_module_cap_f_10g_.AssignValue(caps.f_10g());
+  sfp_module_cap_f_40g_.AssignValue(caps.f_40g());
+  sfp_module_cap_f_100g_.AssignValue(caps.f_100g());
+
+  ::util::StatusOr<const SffInfo*> result = sfp_info.GetSffInfo();
+  if (!result.ok()) return;
+  const SffInfo* sff_info = result.ValueOrDie();
   sfp_vendor_.AssignValue(std::string(sff_info->vendor));
   sfp_serial_number_.AssignValue(std::string(sff_info->serial));
   sfp_model_name_.AssignValue(std::string(sff_info->model));
@@ -114,25 +177,30 @@ OnlpSfpDataSource::OnlpSfpDataSource(int sfp_id,
 
   cable_length_.AssignValue(sff_info->length);
   cable_length_desc_.AssignValue(std::string(sff_info->length_desc));
+  static_info_valid_ = true;
+}
 
-  const SffDomInfo* sff_dom_info = sfp_info.GetSffDomInfo();
+void OnlpSfpDataSource::UpdateDomValues(const SffDomInfo& sff_dom_info) {
   // Convert from 1/256 Celsius(ONLP unit) to Celsius(Google unit).
-  temperature_.AssignValue(static_cast<double>(sff_dom_info->temp) / 256.0);
+  temperature_.AssignValue(static_cast<double>(sff_dom_info.temp) / 256.0);
   // Convert from 0.1mv(ONLP unit) to V(Google unit).
-  vcc_.AssignValue(static_cast<double>(sff_dom_info->voltage) / 10000.0);
-  channel_count_.AssignValue(sff_dom_info->nchannels);
-  for (int i = 0; i < sff_dom_info->nchannels; ++i) {
+  vcc_.AssignValue(static_cast<double>(sff_dom_info.voltage) / 10000.0);
+  channel_count_.AssignValue(sff_dom_info.nchannels);
+  // The channel attributes are created along with the datasource. Skip the
+  // channels a replacement module may have in addition.
+  int num_channels = std::min(sff_dom_info.nchannels,
+                              static_cast<int>(tx_power_.size()));
+  for (int i = 0; i < num_channels; ++i) {
     // Convert from 0.1uW(ONLP unit) to dBm(Google unit).
     tx_power_[i].AssignValue(ConvertMicrowattsTodBm(
-        static_cast<double>(sff_dom_info->channels[i].tx_power) / 10.0));
+        static_cast<double>(sff_dom_info.channels[i].tx_power) / 10.0));
     // Convert from 0.1uW(ONLP unit) to dBm(Google unit).
     rx_power_[i].AssignValue(ConvertMicrowattsTodBm(
-        static_cast<double>(sff_dom_info->channels[i].rx_power) / 10.0));
+        static_cast<double>(sff_dom_info.channels[i].rx_power) / 10.0));
     // Convert from 2uA(ONLP unit) to mA(Google unit).
     tx_bias_[i].AssignValue(
-        static_cast<double>(sff_dom_info->channels[i].bias_cur) * 2.0 / 1000.0);
+        static_cast<double>(sff_dom_info.channels[i].bias_cur) * 2.0 / 1000.0);
   }
-  return ::util::OkStatus();
 }
 
 }  // namespace onlp
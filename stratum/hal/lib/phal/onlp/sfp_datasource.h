@@ -79,6 +79,19 @@ class OnlpSfpDataSource : public DataSource {
     return &tx_bias_[channel_index];
   }
 
+  // Re-reads the static info of the transceiver (vendor, serial number, module
+  // type, ...) from its EEPROM. To be called when a transceiver is plugged in.
+  // The regular updates only read the DOM values of the transceiver.
+  ::util::Status RefreshStaticInfo() LOCKS_EXCLUDED(data_lock_);
+
+  // Drops the static info of the transceiver. To be called when the
+  // transceiver is unplugged. The next update re-reads the full EEPROM.
+  void InvalidateStaticInfo() LOCKS_EXCLUDED(data_lock_);
+
+  // Number of EEPROM bytes read over I2C by the last update and in total.
+  uint64 GetI2cBytesReadLastUpdate() LOCKS_EXCLUDED(data_lock_);
+  uint64 GetI2cBytesReadTotal() LOCKS_EXCLUDED(data_lock_);
+
  private:
   OnlpSfpDataSource(int id, OnlpInterface* onlp_interface,
                     CachePolicy* cache_policy, const SfpInfo& sfp_info);
@@ -90,12 +103,32 @@ class OnlpSfpDataSource : public DataSource {
 
   ::util::Status UpdateValues() override;
 
+  // Assigns the attributes which do not change while the transceiver is
+  // plugged in, and keeps 'sfp_info' around for the DOM updates.
+  void UpdateStaticValues(const SfpInfo& sfp_info);
+
+  // Assigns the DOM attributes.
+  void UpdateDomValues(const SffDomInfo& sff_dom_info);
+
+  // Reads the full SFP info and updates all the attributes.
+  ::util::Status ReadAllValues();
+
   // We do not own ONLP stub object. ONLP stub is created on PHAL creation and
   // destroyed when PHAL deconstruct. Do not delete onlp_stub_.
   OnlpInterface* onlp_stub_;
 
   OnlpOid sfp_oid_;
 
+  // The SFP info read when the transceiver was plugged in, and whether it is
+  // still valid. While it is, only the DOM values are read on updates.
+  // Protected by data_lock_, like the attributes.
+  SfpInfo static_info_;
+  bool static_info_valid_;
+
+  // I2C read counters. Protected by data_lock_.
+  uint64 i2c_bytes_read_last_update_;
+  uint64 i2c_bytes_read_total_;
+
   // A list of managed attributes.
   // Hardware Info.
   TypedAttribute<int> sfp_id_{this};
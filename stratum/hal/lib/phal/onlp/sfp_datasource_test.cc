@@ -61,8 +61,9 @@ TEST_F(SfpDatasourceTest, InitializeSFPWithEmptyInfo) {
   mock_sfp_info.dom.nchannels = 0;
   mock_sfp_info.sff.sfp_type = SFF_SFP_TYPE_SFP;
   EXPECT_CALL(mock_onlp_interface_, GetSfpInfo(oid_))
-      .Times(2)
-      .WillRepeatedly(Return(SfpInfo(mock_sfp_info)));
+      .WillOnce(Return(SfpInfo(mock_sfp_info)));
+  EXPECT_CALL(mock_onlp_interface_, GetSfpDomInfo(oid_, _))
+      .WillOnce(Return(mock_sfp_info.dom));
 
   ::util::StatusOr<std::shared_ptr<OnlpSfpDataSource>> result =
       OnlpSfpDataSource::Make(id_, &mock_onlp_interface_, nullptr);
@@ -119,6 +120,8 @@ TEST_F(SfpDatasourceTest, GetSfpData) {
   mock_sfp_dom_info->channels[1].bias_cur = 6666;
   EXPECT_CALL(mock_onlp_interface_, GetSfpInfo(oid_))
       .WillRepeatedly(Return(SfpInfo(mock_sfp_info)));
+  EXPECT_CALL(mock_onlp_interface_, GetSfpDomInfo(oid_, _))
+      .WillRepeatedly(Return(mock_sfp_info.dom));
 
   ::util::StatusOr<std::shared_ptr<OnlpSfpDataSource>> result =
       OnlpSfpDataSource::Make(id_, &mock_onlp_interface_, nullptr);
@@ -179,6 +182,59 @@ TEST_F(SfpDatasourceTest, GetSfpData) {
               ContainsValue<std::string>("test_cable_len"));
 }
 
+TEST_F(SfpDatasourceTest, ReadStaticInfoOncePerInsertion) {
+  mock_oid_info_.status = ONLP_OID_STATUS_FLAG_PRESENT;
+  EXPECT_CALL(mock_onlp_interface_, GetOidInfo(oid_))
+      .WillOnce(Return(OidInfo(mock_oid_info_)));
+
+  onlp_sfp_info_t mock_sfp_info = {};
+  mock_sfp_info.hdr.status = ONLP_OID_STATUS_FLAG_PRESENT;
+  mock_sfp_info.type = ONLP_SFP_TYPE_SFP;
+  mock_sfp_info.sff.sfp_type = SFF_SFP_TYPE_SFP;
+  strncpy(mock_sfp_info.sff.vendor, "test_sfp_vendor",
+          sizeof(mock_sfp_info.sff.vendor));
+  mock_sfp_info.dom.nchannels = 1;
+  mock_sfp_info.dom.temp = 256;
+
+  // The full EEPROM is read on creation and once more for the insertion of
+  // a new transceiver. Everything else only reads the DOM values.
+  EXPECT_CALL(mock_onlp_interface_, GetSfpInfo(oid_))
+      .Times(2)
+      .WillRepeatedly(Return(SfpInfo(mock_sfp_info)));
+  SffDomInfo mock_dom_info = mock_sfp_info.dom;
+  mock_dom_info.temp = 512;
+  EXPECT_CALL(mock_onlp_interface_, GetSfpDomInfo(oid_, _))
+      .Times(3)
+      .WillRepeatedly(Return(mock_dom_info));
+
+  ::util::StatusOr<std::shared_ptr<OnlpSfpDataSource>> result =
+      OnlpSfpDataSource::Make(id_, &mock_onlp_interface_, nullptr);
+  ASSERT_OK(result);
+  std::shared_ptr<OnlpSfpDataSource> sfp_datasource =
+      result.ConsumeValueOrDie();
+  // Full SFP EEPROM (A0h and A2h pages) + SFF-8472 diagnostics.
+  EXPECT_EQ(10, sfp_datasource->GetI2cBytesReadLastUpdate());
+  EXPECT_EQ(512 + 10, sfp_datasource->GetI2cBytesReadTotal());
+
+  EXPECT_OK(sfp_datasource->UpdateValuesUnsafelyWithoutCacheOrLock());
+  EXPECT_THAT(sfp_datasource->GetSfpTemperature(), ContainsValue<double>(2.0));
+  EXPECT_THAT(sfp_datasource->GetSfpVendor(),
+              ContainsValue<std::string>("test_sfp_vendor"));
+  EXPECT_EQ(512 + 2 * 10, sfp_datasource->GetI2cBytesReadTotal());
+
+  // The transceiver is replaced.
+  sfp_datasource->InvalidateStaticInfo();
+  EXPECT_THAT(sfp_datasource->GetSfpHardwareState(),
+              ContainsValue(HwState_descriptor()->FindValueByName(
+                  "HW_STATE_NOT_PRESENT")));
+  EXPECT_OK(sfp_datasource->RefreshStaticInfo());
+  EXPECT_THAT(sfp_datasource->GetSfpTemperature(), ContainsValue<double>(1.0));
+  EXPECT_EQ(512, sfp_datasource->GetI2cBytesReadLastUpdate());
+  EXPECT_OK(sfp_datasource->UpdateValuesUnsafelyWithoutCacheOrLock());
+  EXPECT_EQ(10, sfp_datasource->GetI2cBytesReadLastUpdate());
+  EXPECT_EQ(2 * 512 + 3 * 10, sfp_datasource->GetI2cBytesReadTotal());
+}
+
 }  // namespace onlp
 }  // namespace phal
 }  // namespace hal
@@ -156,9 +156,10 @@ TEST_F(OnlpSwitchConfiguratorTest, CanConfigurePhalDB) {
     mock_oid_info.status = ONLP_OID_STATUS_FLAG_PRESENT;
 
     // Add Mock Sfp Port GetOidInfo calls
-    onlp_sfp_info_t mock_sfp_info;
+    onlp_sfp_info_t mock_sfp_info = {};
     mock_sfp_info.hdr.status = ONLP_OID_STATUS_FLAG_PRESENT;
     mock_sfp_info.type = ONLP_SFP_TYPE_SFP;
+    mock_sfp_info.sff.sfp_type = SFF_SFP_TYPE_SFP;
 
     // SFF Diag info
     mock_sfp_info.dom.voltage = 12;
@@ -185,8 +186,10 @@ TEST_F(OnlpSwitchConfiguratorTest, CanConfigurePhalDB) {
                     .WillRepeatedly(Return(OidInfo(mock_oid_info)));
                 EXPECT_CALL(*onlp_interface_,
                             GetSfpInfo(ONLP_SFP_ID_CREATE(i+1)))
-                    .Times(2)
-                    .WillRepeatedly(Return(SfpInfo(mock_sfp_info)));
+                    .WillOnce(Return(SfpInfo(mock_sfp_info)));
+                EXPECT_CALL(*onlp_interface_,
+                            GetSfpDomInfo(ONLP_SFP_ID_CREATE(i+1), _))
+                    .WillOnce(Return(mock_sfp_info.dom));
                 break;
 
             // don't worry about other port types
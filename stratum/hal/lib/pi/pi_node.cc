@@ -67,17 +67,47 @@ namespace {
   return ::util::Status(::util::Status::canonical_space(), from.code(), "");
 }
 
+// Returns a copy of the write request where the DigestEntry configs are
+// changed to make the DeviceMgr deliver each digest data right away (no
+// timeout and one digest data per list), or nullptr if the request does not
+// configure any digest.
+std::unique_ptr<::p4::v1::WriteRequest> WithImmediateDigests(
+    const ::p4::v1::WriteRequest& req) {
+  std::unique_ptr<::p4::v1::WriteRequest> immediate_req;
+  for (int i = 0; i < req.updates_size(); ++i) {
+    const auto& entity = req.updates(i).entity();
+    if (!entity.has_digest_entry() || !entity.digest_entry().has_config()) {
+      continue;
+    }
+    if (immediate_req == nullptr) {
+      immediate_req = absl::make_unique<::p4::v1::WriteRequest>(req);
+    }
+    auto* config = immediate_req->mutable_updates(i)
+                       ->mutable_entity()
+                       ->mutable_digest_entry()
+                       ->mutable_config();
+    config->set_max_timeout_ns(0);
+    config->set_max_list_size(1);
+  }
+  return immediate_req;
+}
+
 }  // namespace
 
 void StreamMessageCb(
     uint64_t node_id, ::p4::v1::StreamMessageResponse *msg, void* cookie) {
   auto* pi_node = static_cast<PINode*>(cookie);
-  if (!msg->has_packet()) {
+  if (msg->has_packet()) {
+    pi_node->SendPacketIn(msg->packet());
+  } else if (msg->has_digest()) {
+    pi_node->SendDigestList(msg->digest());
+  } else if (msg->has_idle_timeout_notification()) {
+    pi_node->SendIdleTimeoutNotification(msg->idle_timeout_notification());
+  } else {
     VLOG(1) << "Dropping P4Runtime stream message in node " << node_id
-            << " as it is not a PacketIn message.";
-    return;
+            << " as it is neither a PacketIn, a DigestList nor an "
+            << "IdleTimeoutNotification message.";
   }
-  pi_node->SendPacketIn(msg->packet());
 }
 
 PINode::PINode(::pi::fe::proto::DeviceMgr* device_mgr, int unit)
@@ -167,8 +197,15 @@ PINode::~PINode() = default;
   CHECK_RETURN_IF_FALSE(results != nullptr)
       << "Need to provide non-null results pointer for non-empty updates.";
 
-  auto status = device_mgr_->write(req);
-  return toUtilStatus(status, results, req.updates_size());
+  // The digest writer (see DigestManager) batches the digest data with the
+  // config given by the controller. The DeviceMgr, which would batch them
+  // again with the same config, is made to hand over each digest data right
+  // away, so that the batching delay is not doubled.
+  auto immediate_req = WithImmediateDigests(req);
+  auto status = device_mgr_->write(immediate_req ? *immediate_req : req);
+  auto ret = toUtilStatus(status, results, req.updates_size());
+  UpdateDigestConfigs(req, ret, *results);
+  return ret;
 }
 
 ::util::Status PINode::ReadForwardingEntries(
@@ -185,6 +222,7 @@ PINode::~PINode() = default;
   ::p4::v1::ReadResponse response;
   auto status = device_mgr_->read(req, &response);
   RETURN_IF_ERROR(toUtilStatus(status, details));
+  RestoreDigestConfigs(&response);
   if (!writer->Write(response))
     return MAKE_ERROR(ERR_INTERNAL) << "Write to stream channel failed.";
   return ::util::OkStatus();
@@ -219,6 +257,33 @@ PINode::~PINode() = default;
   return status;
 }
 
+::util::Status PINode::RegisterDigestReceiveWriter(
+    const std::shared_ptr<WriterInterface<::p4::v1::DigestList>>& writer) {
+  absl::MutexLock l(&digest_writer_lock_);
+  digest_writer_ = writer;
+  return ::util::OkStatus();
+}
+
+::util::Status PINode::UnregisterDigestReceiveWriter() {
+  absl::MutexLock l(&digest_writer_lock_);
+  digest_writer_ = nullptr;
+  return ::util::OkStatus();
+}
+
+::util::Status PINode::RegisterIdleTimeoutNotificationWriter(
+    const std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>&
+        writer) {
+  absl::MutexLock l(&idle_timeout_writer_lock_);
+  idle_timeout_writer_ = writer;
+  return ::util::OkStatus();
+}
+
+::util::Status PINode::UnregisterIdleTimeoutNotificationWriter() {
+  absl::MutexLock l(&idle_timeout_writer_lock_);
+  idle_timeout_writer_ = nullptr;
+  return ::util::OkStatus();
+}
+
 std::unique_ptr<PINode> PINode::CreateInstance(
     ::pi::fe::proto::DeviceMgr* device_mgr, int unit) {
   return absl::WrapUnique(new PINode(device_mgr, unit));
@@ -232,6 +297,64 @@ void PINode::SendPacketIn(const ::p4::v1::PacketIn& packet) {
   rx_writer_->Write(packet);
 }
 
+void PINode::SendDigestList(const ::p4::v1::DigestList& list) {
+  {
+    absl::MutexLock l(&digest_writer_lock_);
+    if (digest_writer_ == nullptr) return;
+    digest_writer_->Write(list);
+  }
+  // The digest writer does its own batching, deduplication and flow control
+  // with the controller, so the list is acked right away. This lets the
+  // DeviceMgr report the same digest data again when it is seen, which the
+  // writer drops as long as the controller has not acked it.
+  ::p4::v1::StreamMessageRequest msg;
+  auto* ack = msg.mutable_digest_ack();
+  ack->set_digest_id(list.digest_id());
+  ack->set_list_id(list.list_id());
+  auto status = toUtilStatus(device_mgr_->stream_message_request_handle(msg));
+  if (!status.ok()) {
+    VLOG(1) << "Failed to ack digest list " << list.list_id() << " of digest "
+            << list.digest_id() << ": " << status.error_message();
+  }
+}
+
+void PINode::UpdateDigestConfigs(const ::p4::v1::WriteRequest& req,
+                                 const ::util::Status& status,
+                                 const std::vector<::util::Status>& results) {
+  absl::MutexLock l(&digest_config_lock_);
+  for (int i = 0; i < req.updates_size(); ++i) {
+    const auto& update = req.updates(i);
+    if (!update.entity().has_digest_entry()) continue;
+    if (static_cast<size_t>(i) < results.size() ? !results[i].ok()
+                                                : !status.ok()) {
+      continue;
+    }
+    const auto& entry = update.entity().digest_entry();
+    if (update.type() == ::p4::v1::Update::DELETE) {
+      digest_configs_.erase(entry.digest_id());
+    } else if (entry.has_config()) {
+      digest_configs_[entry.digest_id()] = entry.config();
+    }
+  }
+}
+
+void PINode::RestoreDigestConfigs(::p4::v1::ReadResponse* response) const {
+  absl::MutexLock l(&digest_config_lock_);
+  for (auto& entity : *response->mutable_entities()) {
+    if (!entity.has_digest_entry()) continue;
+    auto* entry = entity.mutable_digest_entry();
+    auto it = digest_configs_.find(entry->digest_id());
+    if (it != digest_configs_.end()) *entry->mutable_config() = it->second;
+  }
+}
+
+void PINode::SendIdleTimeoutNotification(
+    const ::p4::v1::IdleTimeoutNotification& notification) {
+  absl::MutexLock l(&idle_timeout_writer_lock_);
+  if (idle_timeout_writer_ == nullptr) return;
+  idle_timeout_writer_->Write(notification);
+}
+
 }  // namespace pi
 }  // namespace hal
 }  // namespace stratum
@@ -24,6 +24,7 @@
 #include "stratum/glue/status/status.h"
 #include "stratum/hal/lib/common/writer_interface.h"
 #include "stratum/hal/lib/common/common.pb.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
 
 namespace stratum {
@@ -65,6 +66,17 @@ class PINode final {
       LOCKS_EXCLUDED(rx_writer_lock_);
   ::util::Status UnregisterPacketReceiveWriter();
       LOCKS_EXCLUDED(rx_writer_lock_);
+  ::util::Status RegisterDigestReceiveWriter(
+      const std::shared_ptr<WriterInterface<::p4::v1::DigestList>>& writer)
+      LOCKS_EXCLUDED(digest_writer_lock_);
+  ::util::Status UnregisterDigestReceiveWriter()
+      LOCKS_EXCLUDED(digest_writer_lock_);
+  ::util::Status RegisterIdleTimeoutNotificationWriter(
+      const std::shared_ptr<
+          WriterInterface<::p4::v1::IdleTimeoutNotification>>& writer)
+      LOCKS_EXCLUDED(idle_timeout_writer_lock_);
+  ::util::Status UnregisterIdleTimeoutNotificationWriter()
+      LOCKS_EXCLUDED(idle_timeout_writer_lock_);
   ::util::Status TransmitPacket(const ::p4::v1::PacketOut& packet);
 
   // Factory function for creating the instance of the class.
@@ -91,6 +103,28 @@ class PINode final {
   void SendPacketIn(const ::p4::v1::PacketIn& packet);
       LOCKS_EXCLUDED(rx_writer_lock_);
 
+  // Write a digest list on the registered digest writer, and ack it with the
+  // DeviceMgr.
+  void SendDigestList(const ::p4::v1::DigestList& list)
+      LOCKS_EXCLUDED(digest_writer_lock_);
+
+  // Write an idle timeout notification on the registered idle timeout writer.
+  void SendIdleTimeoutNotification(
+      const ::p4::v1::IdleTimeoutNotification& notification)
+      LOCKS_EXCLUDED(idle_timeout_writer_lock_);
+
+  // Records the DigestEntry configs of the successful updates of a write
+  // request.
+  void UpdateDigestConfigs(const ::p4::v1::WriteRequest& req,
+                           const ::util::Status& status,
+                           const std::vector<::util::Status>& results)
+      LOCKS_EXCLUDED(digest_config_lock_);
+
+  // Reports the recorded DigestEntry configs in a read response, in place of
+  // the ones kept by the DeviceMgr.
+  void RestoreDigestConfigs(::p4::v1::ReadResponse* response) const
+      LOCKS_EXCLUDED(digest_config_lock_);
+
   // Reader-writer lock used to protect access to node-specific state.
   mutable absl::Mutex lock_;
 
@@ -104,6 +138,29 @@ class PINode final {
   std::shared_ptr<WriterInterface<::p4::v1::PacketIn>> rx_writer_{nullptr};
       GUARDED_BY(rx_writer_lock_);
 
+  // Mutex used for exclusive access to digest_writer_.
+  mutable absl::Mutex digest_writer_lock_;
+
+  // Digest list handler.
+  std::shared_ptr<WriterInterface<::p4::v1::DigestList>> digest_writer_
+      GUARDED_BY(digest_writer_lock_);
+
+  // Mutex used for exclusive access to idle_timeout_writer_.
+  mutable absl::Mutex idle_timeout_writer_lock_;
+
+  // Idle timeout notification handler.
+  std::shared_ptr<WriterInterface<::p4::v1::IdleTimeoutNotification>>
+      idle_timeout_writer_ GUARDED_BY(idle_timeout_writer_lock_);
+
+  // Mutex used for exclusive access to digest_configs_.
+  mutable absl::Mutex digest_config_lock_;
+
+  // The DigestEntry configs written by the controller, by digest ID. The
+  // digest writer batches the digest data based on them, while the DeviceMgr
+  // is given a config delivering each digest data right away.
+  absl::flat_hash_map<uint32, ::p4::v1::DigestEntry::Config> digest_configs_
+      GUARDED_BY(digest_config_lock_);
+
   const int unit_;
 
   bool pipeline_initialized_ GUARDED_BY(lock_);
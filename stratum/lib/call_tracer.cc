@@ -0,0 +1,276 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/lib/call_tracer.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "stratum/lib/utils.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+
+namespace stratum {
+
+namespace {
+
+// Source of the unique tracer and thread IDs.
+std::atomic<uint64> next_tracer_id(1);
+std::atomic<int> next_thread_id(1);
+
+// Registry of the live tracers by ID, so that a thread exiting after a tracer
+// was destroyed does not touch it. Never destroyed, as threads can exit after
+// the static destructors ran.
+absl::Mutex* TracersLock() {
+  static absl::Mutex* lock = new absl::Mutex();
+  return lock;
+}
+absl::flat_hash_map<uint64, CallTracer*>* Tracers() {
+  static auto* tracers = new absl::flat_hash_map<uint64, CallTracer*>();
+  return tracers;
+}
+
+// The trace context ID of the calling thread, set by ScopedTraceContext.
+thread_local uint64 current_context_id = 0;
+
+// Small sequential ID of the calling thread, nicer to read in the trace viewer
+// than the pthread ID.
+int ThisThreadId() {
+  static thread_local int thread_id =
+      next_thread_id.fetch_add(1, std::memory_order_relaxed);
+  return thread_id;
+}
+
+// Adds an event to a ring buffer of the given size, overwriting the oldest event
+// if the buffer is full. '*next' is the index of the oldest event.
+void AddToRingBuffer(TraceEvent event, size_t size,
+                     std::vector<TraceEvent>* events, size_t* next) {
+  if (events->size() < size) {
+    events->push_back(std::move(event));
+  } else {
+    (*events)[*next] = std::move(event);
+    *next = (*next + 1) % size;
+  }
+}
+
+// Appends 's' to 'out' as a JSON string literal.
+void AppendJsonString(const std::string& s, std::string* out) {
+  out->push_back('"');
+  for (char c : s) {
+    switch (c) {
+      case '"':
+        out->append("\\\"");
+        break;
+      case '\\':
+        out->append("\\\\");
+        break;
+      case '\n':
+        out->append("\\n");
+        break;
+      case '\t':
+        out->append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppend(out, absl::StrFormat("\\u%04x", c));
+        } else {
+          out->push_back(c);
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+}  // namespace
+
+constexpr int CallTracer::kDefaultRingBufferSize;
+
+CallTracer::CallTracer(int ring_buffer_size)
+    : tracer_id_(next_tracer_id.fetch_add(1, std::memory_order_relaxed)),
+      ring_buffer_size_(std::max(ring_buffer_size, 1)),
+      enabled_(false),
+      next_context_id_(1),
+      buffers_(),
+      retired_events_(),
+      retired_next_(0) {
+  absl::MutexLock l(TracersLock());
+  (*Tracers())[tracer_id_] = this;
+}
+
+CallTracer::~CallTracer() {
+  absl::MutexLock l(TracersLock());
+  Tracers()->erase(tracer_id_);
+}
+
+struct CallTracer::ThreadBufferCache {
+  absl::flat_hash_map<uint64, ThreadBuffer*> buffers;
+  ~ThreadBufferCache() {
+    for (const auto& e : buffers) RetireThreadBuffer(e.first, e.second);
+  }
+};
+
+CallTracer* CallTracer::Global() {
+  // Never destroyed, so that calls can be traced from detached threads.
+  static CallTracer* tracer = new CallTracer();
+  return tracer;
+}
+
+void CallTracer::Record(TraceEvent event) {
+  ThreadBuffer* buffer = GetThreadBuffer();
+  event.thread_id = buffer->thread_id;
+  absl::MutexLock l(&buffer->lock);
+  AddToRingBuffer(std::move(event), ring_buffer_size_, &buffer->events,
+                  &buffer->next);
+}
+
+CallTracer::ThreadBuffer* CallTracer::GetThreadBuffer() {
+  // Each thread caches the buffers it uses, per tracer. Tracer IDs are never
+  // reused, so a stale entry of a destroyed tracer is never looked up again.
+  static thread_local ThreadBufferCache cache;
+  ThreadBuffer*& buffer = cache.buffers[tracer_id_];
+  if (buffer == nullptr) {
+    auto new_buffer = absl::make_unique<ThreadBuffer>();
+    new_buffer->thread_id = ThisThreadId();
+    buffer = new_buffer.get();
+    absl::MutexLock l(&lock_);
+    buffers_.push_back(std::move(new_buffer));
+  }
+  return buffer;
+}
+
+void CallTracer::RetireThreadBuffer(uint64 tracer_id, ThreadBuffer* buffer) {
+  // The registry lock is held until the buffer is retired, so that the tracer
+  // cannot be destroyed in the meantime.
+  absl::MutexLock l(TracersLock());
+  auto it = Tracers()->find(tracer_id);
+  if (it == Tracers()->end()) return;
+  it->second->RetireThreadBuffer(buffer);
+}
+
+void CallTracer::RetireThreadBuffer(ThreadBuffer* buffer) {
+  absl::MutexLock l(&lock_);
+  auto it = std::find_if(
+      buffers_.begin(), buffers_.end(),
+      [buffer](const std::unique_ptr<ThreadBuffer>& b) {
+        return b.get() == buffer;
+      });
+  if (it == buffers_.end()) return;
+  {
+    // Move the calls from the oldest to the newest one.
+    absl::MutexLock bl(&buffer->lock);
+    const size_t count = buffer->events.size();
+    for (size_t i = 0; i < count; ++i) {
+      AddToRingBuffer(std::move(buffer->events[(buffer->next + i) % count]),
+                      ring_buffer_size_, &retired_events_, &retired_next_);
+    }
+  }
+  buffers_.erase(it);
+}
+
+std::vector<TraceEvent> CallTracer::GetEvents() const {
+  std::vector<TraceEvent> events;
+  {
+    absl::MutexLock l(&lock_);
+    events = retired_events_;
+    for (const auto& buffer : buffers_) {
+      absl::MutexLock bl(&buffer->lock);
+      events.insert(events.end(), buffer->events.begin(),
+                    buffer->events.end());
+    }
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const TraceEvent& a, const TraceEvent& b) {
+                     return a.start_nanos < b.start_nanos;
+                   });
+  return events;
+}
+
+std::string CallTracer::ToChromeTraceJson() const {
+  std::string json = "{\"traceEvents\":[";
+  const int pid = getpid();
+  bool first = true;
+  for (const auto& event : GetEvents()) {
+    if (!first) json.append(",");
+    first = false;
+    json.append("\n{\"name\":");
+    AppendJsonString(event.name, &json);
+    json.append(",\"cat\":");
+    AppendJsonString(event.category, &json);
+    // Timestamps and durations are in microseconds, with ns precision.
+    absl::StrAppend(
+        &json, ",\"ph\":\"X\",\"ts\":",
+        absl::StrFormat("%d.%03d", event.start_nanos / 1000,
+                        event.start_nanos % 1000),
+        ",\"dur\":",
+        absl::StrFormat("%d.%03d", event.duration_nanos / 1000,
+                        event.duration_nanos % 1000),
+        ",\"pid\":", pid, ",\"tid\":", event.thread_id, ",\"args\":{\"unit\":",
+        event.unit, ",\"context_id\":", event.context_id, ",\"args\":");
+    AppendJsonString(event.args, &json);
+    json.append("}}");
+  }
+  json.append("\n],\"displayTimeUnit\":\"ns\"}\n");
+
+  return json;
+}
+
+::util::Status CallTracer::DumpChromeTrace(const std::string& path) const {
+  return WriteStringToFile(ToChromeTraceJson(), path);
+}
+
+void CallTracer::Clear() {
+  absl::MutexLock l(&lock_);
+  for (const auto& buffer : buffers_) {
+    absl::MutexLock bl(&buffer->lock);
+    buffer->events.clear();
+    buffer->next = 0;
+  }
+  retired_events_.clear();
+  retired_next_ = 0;
+}
+
+uint64 CallTracer::CurrentContextId() { return current_context_id; }
+
+ScopedTraceContext::ScopedTraceContext()
+    : context_id_(CallTracer::Global()->NewContextId()),
+      previous_context_id_(current_context_id) {
+  current_context_id = context_id_;
+}
+
+ScopedTraceContext::~ScopedTraceContext() {
+  current_context_id = previous_context_id_;
+}
+
+ScopedTraceEvent::ScopedTraceEvent(const char* category, const char* name,
+                                   int unit)
+    : active_(CallTracer::Global()->enabled()), event_() {
+  if (!active_) return;
+  event_.category = category;
+  event_.name = name;
+  event_.unit = unit;
+  event_.context_id = current_context_id;
+  event_.start_nanos = absl::GetCurrentTimeNanos();
+}
+
+ScopedTraceEvent::~ScopedTraceEvent() {
+  if (!active_) return;
+  event_.duration_nanos = absl::GetCurrentTimeNanos() - event_.start_nanos;
+  CallTracer::Global()->Record(std::move(event_));
+}
+
+}  // namespace stratum
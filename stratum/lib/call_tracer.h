@@ -0,0 +1,211 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_LIB_CALL_TRACER_H_
+#define STRATUM_LIB_CALL_TRACER_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace stratum {
+
+// A single traced call.
+struct TraceEvent {
+  // Category and name of the call, e.g. "bcm_sdk" and "AddL3RouteIpv4". Both
+  // must point to strings with static storage duration.
+  const char* category;
+  const char* name;
+  // The unit (chip) the call was made for, or -1 if not applicable.
+  int unit;
+  // Free form summary of the call arguments.
+  std::string args;
+  // ID of the trace context (e.g. the P4Runtime Write) the call was made in,
+  // or 0 if the call was not made in any context.
+  uint64 context_id;
+  // Start time (since epoch) and duration of the call, in nanoseconds.
+  int64 start_nanos;
+  int64 duration_nanos;
+  // Small integer identifying the thread which made the call.
+  int thread_id;
+  TraceEvent()
+      : category(""),
+        name(""),
+        unit(-1),
+        args(),
+        context_id(0),
+        start_nanos(0),
+        duration_nanos(0),
+        thread_id(0) {}
+};
+
+// CallTracer records traced calls into per-thread ring buffers, which keep the
+// last ring_buffer_size calls made by each thread. When a thread exits, its
+// calls are moved to a single ring buffer of the same size shared by all the
+// exited threads and its own buffer is freed, so the memory used does not grow
+// with thread churn. Tracing is disabled by default, in which case recording a
+// call costs a single relaxed atomic load.
+// The recorded calls can be exported in the Chrome trace-event JSON format,
+// to be visualized with chrome://tracing or Perfetto.
+//
+// The class is thread-safe. A thread only ever takes the lock of its own ring
+// buffer when recording a call, so threads do not contend with each other.
+class CallTracer {
+ public:
+  // Default max number of calls kept per thread.
+  static constexpr int kDefaultRingBufferSize = 8192;
+
+  explicit CallTracer(int ring_buffer_size = kDefaultRingBufferSize);
+  ~CallTracer();
+
+  // Returns the process wide tracer.
+  static CallTracer* Global();
+
+  // Enables or disables recording calls. Calls already recorded are kept.
+  void Enable(bool enable) {
+    enabled_.store(enable, std::memory_order_relaxed);
+  }
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Adds a call to the ring buffer of the calling thread, overwriting the
+  // oldest call if the buffer is full. 'event.thread_id' is filled in here.
+  void Record(TraceEvent event);
+
+  // Returns a copy of all the recorded calls of all the threads, sorted by
+  // start time.
+  std::vector<TraceEvent> GetEvents() const LOCKS_EXCLUDED(lock_);
+
+  // Returns all the recorded calls in the Chrome trace-event JSON format. Each
+  // call is a complete ("X") event, with the unit, the argument summary and
+  // the context ID as event args.
+  std::string ToChromeTraceJson() const;
+
+  // Writes the output of ToChromeTraceJson() to the given file.
+  ::util::Status DumpChromeTrace(const std::string& path) const;
+
+  // Drops all the recorded calls.
+  void Clear() LOCKS_EXCLUDED(lock_);
+
+  // Returns a new unique non-zero trace context ID.
+  uint64 NewContextId() {
+    return next_context_id_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Returns the trace context ID set on the calling thread by
+  // ScopedTraceContext, or 0 if there is none.
+  static uint64 CurrentContextId();
+
+  // CallTracer is neither copyable nor movable.
+  CallTracer(const CallTracer&) = delete;
+  CallTracer& operator=(const CallTracer&) = delete;
+
+ private:
+  // The ring buffer of a thread.
+  struct ThreadBuffer {
+    absl::Mutex lock;
+    std::vector<TraceEvent> events GUARDED_BY(lock);
+    // Index in 'events' where the next event is written once the buffer is
+    // full.
+    size_t next GUARDED_BY(lock);
+    int thread_id;
+    ThreadBuffer() : events(), next(0), thread_id(0) {}
+  };
+
+  // The ring buffers used by a thread, keyed by tracer ID. Defined in the .cc
+  // file. Its destructor, run when the thread exits, retires the buffers.
+  struct ThreadBufferCache;
+
+  // Returns the ring buffer of the calling thread, creating it if needed.
+  ThreadBuffer* GetThreadBuffer() LOCKS_EXCLUDED(lock_);
+
+  // Moves the calls in the ring buffer of an exited thread to
+  // retired_events_ and frees the buffer. Does nothing if the tracer with the
+  // given ID was destroyed, as its buffers were freed with it.
+  static void RetireThreadBuffer(uint64 tracer_id, ThreadBuffer* buffer);
+  void RetireThreadBuffer(ThreadBuffer* buffer) LOCKS_EXCLUDED(lock_);
+
+  // Unique ID of this tracer, used to find the per-thread buffers.
+  const uint64 tracer_id_;
+  const size_t ring_buffer_size_;
+  std::atomic<bool> enabled_;
+  std::atomic<uint64> next_context_id_;
+  // Protects the list of buffers and the retired calls, not the contents of
+  // the buffers.
+  mutable absl::Mutex lock_;
+  // The buffers of all the live threads which recorded any call.
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_ GUARDED_BY(lock_);
+  // The last ring_buffer_size calls made by the threads which exited, used as
+  // a ring buffer. retired_next_ is the index where the next call is written
+  // once it is full.
+  std::vector<TraceEvent> retired_events_ GUARDED_BY(lock_);
+  size_t retired_next_ GUARDED_BY(lock_);
+};
+
+// Sets a new trace context ID on the calling thread for its lifetime. All the
+// calls recorded by this thread in the meantime are tagged with the ID, which
+// correlates them with the operation (e.g. a P4Runtime Write) which caused
+// them. Contexts can be nested, the innermost one wins.
+class ScopedTraceContext {
+ public:
+  ScopedTraceContext();
+  ~ScopedTraceContext();
+
+  uint64 context_id() const { return context_id_; }
+
+  // ScopedTraceContext is neither copyable nor movable.
+  ScopedTraceContext(const ScopedTraceContext&) = delete;
+  ScopedTraceContext& operator=(const ScopedTraceContext&) = delete;
+
+ private:
+  const uint64 context_id_;
+  const uint64 previous_context_id_;
+};
+
+// Records a call into the global CallTracer, from its construction until it
+// goes out of scope. Does nothing if tracing is disabled when it is
+// constructed. Typical usage:
+//
+//   ScopedTraceEvent trace_event("bcm_sdk", __func__, unit);
+//   if (trace_event.active()) trace_event.set_args(...);
+class ScopedTraceEvent {
+ public:
+  ScopedTraceEvent(const char* category, const char* name, int unit);
+  ~ScopedTraceEvent();
+
+  // Returns true if the call is being recorded. Callers check this before
+  // building an argument summary, so that they pay for it only when tracing.
+  bool active() const { return active_; }
+  void set_args(std::string args) { event_.args = std::move(args); }
+
+  // ScopedTraceEvent is neither copyable nor movable.
+  ScopedTraceEvent(const ScopedTraceEvent&) = delete;
+  ScopedTraceEvent& operator=(const ScopedTraceEvent&) = delete;
+
+ private:
+  const bool active_;
+  TraceEvent event_;
+};
+
+}  // namespace stratum
+
+#endif  // STRATUM_LIB_CALL_TRACER_H_
@@ -0,0 +1,183 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/lib/call_tracer.h"
+
+#include <set>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/notification.h"
+
+namespace stratum {
+
+using ::testing::HasSubstr;
+
+class CallTracerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    CallTracer::Global()->Clear();
+    CallTracer::Global()->Enable(true);
+  }
+  void TearDown() override {
+    CallTracer::Global()->Enable(false);
+    CallTracer::Global()->Clear();
+  }
+};
+
+TEST_F(CallTracerTest, DisabledTracerRecordsNothing) {
+  CallTracer::Global()->Enable(false);
+  {
+    ScopedTraceEvent trace_event("test", "Foo", 0);
+    EXPECT_FALSE(trace_event.active());
+  }
+  EXPECT_TRUE(CallTracer::Global()->GetEvents().empty());
+}
+
+TEST_F(CallTracerTest, RecordEventsWithContext) {
+  {
+    ScopedTraceEvent trace_event("test", "NoContext", -1);
+  }
+  uint64 context_id = 0;
+  {
+    ScopedTraceContext trace_context;
+    context_id = trace_context.context_id();
+    EXPECT_EQ(context_id, CallTracer::CurrentContextId());
+    ScopedTraceEvent trace_event("test", "InContext", 1);
+    ASSERT_TRUE(trace_event.active());
+    trace_event.set_args("vrf=10");
+  }
+  EXPECT_EQ(0U, CallTracer::CurrentContextId());
+  EXPECT_NE(0U, context_id);
+
+  std::vector<TraceEvent> events = CallTracer::Global()->GetEvents();
+  ASSERT_EQ(2U, events.size());
+  EXPECT_STREQ("NoContext", events[0].name);
+  EXPECT_EQ(0U, events[0].context_id);
+  EXPECT_STREQ("test", events[1].category);
+  EXPECT_STREQ("InContext", events[1].name);
+  EXPECT_EQ(1, events[1].unit);
+  EXPECT_EQ("vrf=10", events[1].args);
+  EXPECT_EQ(context_id, events[1].context_id);
+  EXPECT_LE(events[0].start_nanos, events[1].start_nanos);
+  EXPECT_GE(events[1].duration_nanos, 0);
+}
+
+TEST_F(CallTracerTest, NestedContexts) {
+  ScopedTraceContext outer;
+  {
+    ScopedTraceContext inner;
+    EXPECT_NE(outer.context_id(), inner.context_id());
+    EXPECT_EQ(inner.context_id(), CallTracer::CurrentContextId());
+  }
+  EXPECT_EQ(outer.context_id(), CallTracer::CurrentContextId());
+}
+
+TEST(CallTracerRingBufferTest, KeepsLastEventsPerThread) {
+  CallTracer tracer(3);
+  for (int i = 0; i < 5; ++i) {
+    TraceEvent event;
+    event.name = "Foo";
+    event.start_nanos = i;
+    tracer.Record(event);
+  }
+  std::thread t([&tracer] {
+    TraceEvent event;
+    event.name = "Bar";
+    event.start_nanos = 10;
+    tracer.Record(event);
+  });
+  t.join();
+  std::vector<TraceEvent> events = tracer.GetEvents();
+  ASSERT_EQ(4U, events.size());
+  EXPECT_EQ(2, events[0].start_nanos);
+  EXPECT_EQ(3, events[1].start_nanos);
+  EXPECT_EQ(4, events[2].start_nanos);
+  EXPECT_STREQ("Bar", events[3].name);
+  // The two threads have distinct IDs.
+  EXPECT_NE(events[0].thread_id, events[3].thread_id);
+  tracer.Clear();
+  EXPECT_TRUE(tracer.GetEvents().empty());
+}
+
+TEST(CallTracerRingBufferTest, ConcurrentRecords) {
+  CallTracer tracer(1000);
+  // The threads are kept alive until the events are read, so that each one
+  // still has its own ring buffer.
+  absl::BlockingCounter recorded(8);
+  absl::Notification done;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&tracer, &recorded, &done] {
+      for (int i = 0; i < 1000; ++i) tracer.Record(TraceEvent());
+      recorded.DecrementCount();
+      done.WaitForNotification();
+    });
+  }
+  recorded.Wait();
+  std::vector<TraceEvent> events = tracer.GetEvents();
+  done.Notify();
+  for (auto& t : threads) t.join();
+  EXPECT_EQ(8000U, events.size());
+  std::set<int> thread_ids;
+  for (const auto& event : events) thread_ids.insert(event.thread_id);
+  EXPECT_EQ(8U, thread_ids.size());
+}
+
+TEST(CallTracerRingBufferTest, ExitedThreadsShareOneRingBuffer) {
+  CallTracer tracer(3);
+  for (int t = 0; t < 4; ++t) {
+    std::thread thread([&tracer, t] {
+      for (int i = 0; i < 2; ++i) {
+        TraceEvent event;
+        event.start_nanos = 10 * t + i;
+        tracer.Record(event);
+      }
+    });
+    thread.join();
+  }
+  // Only the last 3 calls made by the exited threads are kept.
+  std::vector<TraceEvent> events = tracer.GetEvents();
+  ASSERT_EQ(3U, events.size());
+  EXPECT_EQ(21, events[0].start_nanos);
+  EXPECT_EQ(30, events[1].start_nanos);
+  EXPECT_EQ(31, events[2].start_nanos);
+  tracer.Clear();
+  EXPECT_TRUE(tracer.GetEvents().empty());
+}
+
+TEST(CallTracerJsonTest, ChromeTraceFormat) {
+  CallTracer tracer;
+  TraceEvent event;
+  event.category = "bcm_sdk";
+  event.name = "AddL3RouteIpv4";
+  event.unit = 0;
+  event.args = "name=\"x\\y\"\n";
+  event.context_id = 7;
+  event.start_nanos = 1234567;
+  event.duration_nanos = 2005;
+  tracer.Record(event);
+  std::string json = tracer.ToChromeTraceJson();
+  EXPECT_THAT(json, HasSubstr("{\"traceEvents\":["));
+  EXPECT_THAT(json, HasSubstr("{\"name\":\"AddL3RouteIpv4\","
+                              "\"cat\":\"bcm_sdk\",\"ph\":\"X\","
+                              "\"ts\":1234.567,\"dur\":2.005,"));
+  EXPECT_THAT(json, HasSubstr("\"args\":{\"unit\":0,\"context_id\":7,"
+                              "\"args\":\"name=\\\"x\\\\y\\\"\\n\"}}"));
+}
+
+}  // namespace stratum
@@ -0,0 +1,221 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/lib/cpu_profiler.h"
+
+#include <errno.h>
+#include <execinfo.h>
+#include <sched.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "stratum/glue/status/status_macros.h"
+#include "stratum/lib/macros.h"
+#include "stratum/lib/utils.h"
+#include "stratum/public/lib/error.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace stratum {
+
+constexpr int CpuProfiler::kMaxFrequencyHz;
+constexpr int CpuProfiler::kMaxStackDepth;
+
+namespace {
+
+// The frames of the signal handler and of the signal trampoline, at the top of
+// the stacks returned by backtrace() in the handler.
+constexpr int kSkippedFrames = 2;
+
+// The state shared with the SIGPROF handler. The handler only touches the
+// buffers while 'active' is set, and Stop() waits for the handlers still
+// running after clearing it before reading them.
+struct SamplerState {
+  std::atomic<bool> active{false};
+  std::atomic<int> handlers_running{0};
+  std::atomic<uint64> next_sample{0};
+  std::atomic<uint64> dropped_samples{0};
+  // The frames of sample i are frames[i * kMaxStackDepth, + depths[i]).
+  void** frames = nullptr;
+  int* depths = nullptr;
+  size_t max_samples = 0;
+};
+
+SamplerState sampler;
+
+// Serializes Start() and Stop(), and guards the buffers of the sampler.
+ABSL_CONST_INIT absl::Mutex profiler_lock(absl::kConstInit);
+bool running GUARDED_BY(profiler_lock) = false;
+int64 sampling_period_us GUARDED_BY(profiler_lock) = 0;
+std::vector<void*>* frames_buffer GUARDED_BY(profiler_lock) = nullptr;
+std::vector<int>* depths_buffer GUARDED_BY(profiler_lock) = nullptr;
+// Set once the SIGPROF handler is installed. It is never uninstalled, as the
+// default action of a SIGPROF still pending after Stop() terminates the
+// process.
+bool handler_installed GUARDED_BY(profiler_lock) = false;
+
+// Only uses async-signal-safe functions, as backtrace() is once libgcc is
+// loaded, which Start() makes sure of. Does nothing while no profile is being
+// taken.
+void ProfileSignalHandler(int sig, siginfo_t* info, void* context) {
+  int saved_errno = errno;
+  sampler.handlers_running.fetch_add(1);
+  if (sampler.active.load()) {
+    uint64 i = sampler.next_sample.fetch_add(1);
+    if (i < sampler.max_samples) {
+      void* stack[CpuProfiler::kMaxStackDepth + kSkippedFrames];
+      int depth =
+          backtrace(stack, CpuProfiler::kMaxStackDepth + kSkippedFrames);
+      depth = std::max(depth - kSkippedFrames, 0);
+      memcpy(sampler.frames + i * CpuProfiler::kMaxStackDepth,
+             stack + kSkippedFrames, depth * sizeof(void*));
+      sampler.depths[i] = depth;
+    } else {
+      sampler.dropped_samples.fetch_add(1);
+    }
+  }
+  sampler.handlers_running.fetch_sub(1);
+  errno = saved_errno;
+}
+
+// Appends a word of the legacy pprof CPU profile format, which is made of
+// native machine words.
+void AppendWord(uintptr_t word, std::string* profile) {
+  profile->append(reinterpret_cast<const char*>(&word), sizeof(word));
+}
+
+}  // namespace
+
+::util::Status CpuProfiler::Start(const Options& options) {
+  CHECK_RETURN_IF_FALSE(options.frequency_hz > 0 &&
+                        options.frequency_hz <= kMaxFrequencyHz)
+      << "Invalid frequency " << options.frequency_hz << " Hz, must be in [1, "
+      << kMaxFrequencyHz << "].";
+  CHECK_RETURN_IF_FALSE(options.max_samples > 0) << "max_samples is 0.";
+  absl::MutexLock l(&profiler_lock);
+  if (running) {
+    return MAKE_ERROR(ERR_NO_RESOURCE)
+           << "A CPU profile is already being taken.";
+  }
+
+  // The first call to backtrace() loads libgcc, which allocates memory and
+  // cannot be done in the signal handler.
+  void* stack[1];
+  backtrace(stack, 1);
+
+  frames_buffer = new std::vector<void*>(options.max_samples * kMaxStackDepth);
+  depths_buffer = new std::vector<int>(options.max_samples);
+  sampler.frames = frames_buffer->data();
+  sampler.depths = depths_buffer->data();
+  sampler.max_samples = options.max_samples;
+  sampler.next_sample = 0;
+  sampler.dropped_samples = 0;
+  sampler.active = true;
+  sampling_period_us = 1000000 / options.frequency_hz;
+
+  if (!handler_installed) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = ProfileSignalHandler;
+    action.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    handler_installed = sigaction(SIGPROF, &action, nullptr) == 0;
+  }
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = sampling_period_us;
+  timer.it_value = timer.it_interval;
+  if (!handler_installed || setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+    int err = errno;
+    sampler.active = false;
+    delete frames_buffer;
+    delete depths_buffer;
+    frames_buffer = nullptr;
+    depths_buffer = nullptr;
+    return MAKE_ERROR(ERR_INTERNAL)
+           << "Failed to start the profiling timer: " << strerror(err) << ".";
+  }
+  running = true;
+
+  return ::util::OkStatus();
+}
+
+::util::StatusOr<std::string> CpuProfiler::Stop(Stats* stats) {
+  absl::MutexLock l(&profiler_lock);
+  if (!running) {
+    return MAKE_ERROR(ERR_NOT_INITIALIZED) << "No CPU profile is being taken.";
+  }
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  sampler.active = false;
+  // A SIGPROF raised before the timer was stopped may still be handled on
+  // another thread. The ones delivered from now on are ignored by the handler,
+  // which stays installed.
+  while (sampler.handlers_running.load() > 0) sched_yield();
+  running = false;
+
+  // Samples with the same stack are merged.
+  size_t num_samples =
+      std::min<uint64>(sampler.next_sample.load(), sampler.max_samples);
+  absl::flat_hash_map<std::vector<uintptr_t>, uint64> counts;
+  for (size_t i = 0; i < num_samples; ++i) {
+    const void* const* frames = sampler.frames + i * kMaxStackDepth;
+    std::vector<uintptr_t> stack;
+    for (int j = 0; j < sampler.depths[i]; ++j) {
+      stack.push_back(reinterpret_cast<uintptr_t>(frames[j]));
+    }
+    ++counts[stack];
+  }
+  if (stats != nullptr) {
+    stats->samples = num_samples;
+    stats->dropped_samples = sampler.dropped_samples.load();
+  }
+  sampler.frames = nullptr;
+  sampler.depths = nullptr;
+  sampler.max_samples = 0;
+  delete frames_buffer;
+  delete depths_buffer;
+  frames_buffer = nullptr;
+  depths_buffer = nullptr;
+
+  // The header, with the sampling period, the records of the samples, the
+  // trailer, and the memory map pprof needs to symbolize the addresses.
+  std::string profile;
+  for (uintptr_t word : {0, 3, 0, static_cast<int>(sampling_period_us), 0}) {
+    AppendWord(word, &profile);
+  }
+  for (const auto& e : counts) {
+    AppendWord(e.second, &profile);
+    AppendWord(e.first.size(), &profile);
+    for (uintptr_t pc : e.first) AppendWord(pc, &profile);
+  }
+  for (uintptr_t word : {0, 1, 0}) AppendWord(word, &profile);
+  RETURN_IF_ERROR(ReadFileToString("/proc/self/maps", &profile));
+
+  return profile;
+}
+
+bool CpuProfiler::IsRunning() {
+  absl::MutexLock l(&profiler_lock);
+  return running;
+}
+
+}  // namespace stratum
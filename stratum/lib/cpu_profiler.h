@@ -0,0 +1,77 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_LIB_CPU_PROFILER_H_
+#define STRATUM_LIB_CPU_PROFILER_H_
+
+#include <string>
+
+#include "stratum/glue/integral_types.h"
+#include "stratum/glue/status/status.h"
+#include "stratum/glue/status/statusor.h"
+
+namespace stratum {
+
+// CpuProfiler samples the call stacks of the threads of the process while they
+// use CPU. An ITIMER_PROF timer raises SIGPROF every 1/frequency_hz second of
+// CPU time consumed by the process, and the signal handler records the stack
+// of the interrupted thread into a buffer allocated when profiling starts. The
+// overhead is bounded by the frequency, and the memory by max_samples: the
+// samples taken once the buffer is full are only counted.
+// Stop() returns the profile in the legacy pprof CPU profile format, which
+// `pprof <binary> <profile>` reads. Only one profile can be taken at a time in
+// the process. The profiler owns the SIGPROF handler from the first Start()
+// on: the handler stays installed after Stop() and ignores the signals raised
+// while no profile is taken, as a SIGPROF may still be pending on a thread
+// when the profile stops.
+class CpuProfiler {
+ public:
+  struct Options {
+    Options() : frequency_hz(100), max_samples(10000) {}
+    // Number of samples per second of CPU time, in [1, kMaxFrequencyHz].
+    int frequency_hz;
+    // Max number of samples kept in the profile.
+    size_t max_samples;
+  };
+
+  // Counters of the profile returned by Stop().
+  struct Stats {
+    uint64 samples = 0;          // samples kept in the profile
+    uint64 dropped_samples = 0;  // samples taken once the buffer was full
+  };
+
+  static constexpr int kMaxFrequencyHz = 1000;
+  // Max number of frames recorded per sample.
+  static constexpr int kMaxStackDepth = 64;
+
+  // Starts profiling the process. Returns an error if a profile is already
+  // being taken, or if the SIGPROF handler or the timer cannot be set.
+  static ::util::Status Start(const Options& options);
+
+  // Stops profiling and returns the profile, with its counters in 'stats' if
+  // not null. Returns an error if no profile is being taken.
+  static ::util::StatusOr<std::string> Stop(Stats* stats);
+
+  // Returns true if a profile is being taken.
+  static bool IsRunning();
+
+  // CpuProfiler only has static members.
+  CpuProfiler() = delete;
+};
+
+}  // namespace stratum
+
+#endif  // STRATUM_LIB_CPU_PROFILER_H_
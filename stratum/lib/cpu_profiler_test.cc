@@ -0,0 +1,145 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/lib/cpu_profiler.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "stratum/glue/status/status_test_util.h"
+#include "absl/time/clock.h"
+
+namespace stratum {
+namespace {
+
+using ::testing::HasSubstr;
+
+// Keeps the CPU busy for 'duration', so that the profiler takes samples.
+uint64 BurnCpu(absl::Duration duration) {
+  volatile uint64 sum = 0;
+  absl::Time end = absl::Now() + duration;
+  while (absl::Now() < end) {
+    for (int i = 0; i < 10000; ++i) sum = sum + i;
+  }
+  return sum;
+}
+
+uintptr_t Word(const std::string& profile, int index) {
+  uintptr_t word;
+  memcpy(&word, profile.data() + index * sizeof(word), sizeof(word));
+  return word;
+}
+
+TEST(CpuProfilerTest, ProfileHasLegacyPprofFormat) {
+  CpuProfiler::Options options;
+  options.frequency_hz = 1000;
+  ASSERT_OK(CpuProfiler::Start(options));
+  EXPECT_TRUE(CpuProfiler::IsRunning());
+  BurnCpu(absl::Milliseconds(200));
+  CpuProfiler::Stats stats;
+  auto ret = CpuProfiler::Stop(&stats);
+  ASSERT_OK(ret.status());
+  EXPECT_FALSE(CpuProfiler::IsRunning());
+  EXPECT_GT(stats.samples, 0);
+  EXPECT_EQ(0, stats.dropped_samples);
+
+  // Header words: 0, header size, version, sampling period and padding.
+  const std::string& profile = ret.ValueOrDie();
+  ASSERT_GT(profile.size(), 5 * sizeof(uintptr_t));
+  EXPECT_EQ(0, Word(profile, 0));
+  EXPECT_EQ(3, Word(profile, 1));
+  EXPECT_EQ(0, Word(profile, 2));
+  EXPECT_EQ(1000, Word(profile, 3));
+  EXPECT_EQ(0, Word(profile, 4));
+  // The counts of the records add up to the samples, and are followed by the
+  // trailer and the memory map.
+  uint64 total = 0;
+  int index = 5;
+  while (Word(profile, index) != 0) {
+    total += Word(profile, index);
+    uintptr_t depth = Word(profile, index + 1);
+    EXPECT_LE(depth, CpuProfiler::kMaxStackDepth);
+    index += 2 + depth;
+  }
+  EXPECT_EQ(stats.samples, total);
+  EXPECT_EQ(1, Word(profile, index + 1));
+  EXPECT_EQ(0, Word(profile, index + 2));
+  EXPECT_THAT(profile.substr((index + 3) * sizeof(uintptr_t)),
+              HasSubstr("[stack]"));
+}
+
+TEST(CpuProfilerTest, SamplesBeyondMaxSamplesAreDropped) {
+  CpuProfiler::Options options;
+  options.frequency_hz = 1000;
+  options.max_samples = 2;
+  ASSERT_OK(CpuProfiler::Start(options));
+  BurnCpu(absl::Milliseconds(100));
+  CpuProfiler::Stats stats;
+  ASSERT_OK(CpuProfiler::Stop(&stats).status());
+  EXPECT_EQ(2, stats.samples);
+  EXPECT_GT(stats.dropped_samples, 0);
+}
+
+TEST(CpuProfilerTest, OneProfileAtATime) {
+  EXPECT_FALSE(CpuProfiler::Stop(nullptr).ok());
+  ASSERT_OK(CpuProfiler::Start(CpuProfiler::Options()));
+  EXPECT_FALSE(CpuProfiler::Start(CpuProfiler::Options()).ok());
+  ASSERT_OK(CpuProfiler::Stop(nullptr).status());
+  EXPECT_FALSE(CpuProfiler::Stop(nullptr).ok());
+}
+
+TEST(CpuProfilerTest, StopUnderLoadOnSeveralThreads) {
+  // The SIGPROFs still pending on the busy threads when a profile stops must
+  // not terminate the process.
+  std::atomic<bool> done(false);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&done]() {
+      while (!done) BurnCpu(absl::Milliseconds(1));
+    });
+  }
+  CpuProfiler::Options options;
+  options.frequency_hz = CpuProfiler::kMaxFrequencyHz;
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_OK(CpuProfiler::Start(options));
+    BurnCpu(absl::Milliseconds(2));
+    EXPECT_OK(CpuProfiler::Stop(nullptr).status());
+  }
+  // Give the signals still pending the time to be delivered.
+  BurnCpu(absl::Milliseconds(100));
+  done = true;
+  for (auto& thread : threads) thread.join();
+  EXPECT_FALSE(CpuProfiler::IsRunning());
+}
+
+TEST(CpuProfilerTest, InvalidOptions) {
+  CpuProfiler::Options options;
+  options.frequency_hz = CpuProfiler::kMaxFrequencyHz + 1;
+  EXPECT_FALSE(CpuProfiler::Start(options).ok());
+  options.frequency_hz = 0;
+  EXPECT_FALSE(CpuProfiler::Start(options).ok());
+  options.frequency_hz = 100;
+  options.max_samples = 0;
+  EXPECT_FALSE(CpuProfiler::Start(options).ok());
+  EXPECT_FALSE(CpuProfiler::IsRunning());
+}
+
+}  // namespace
+}  // namespace stratum
@@ -0,0 +1,132 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/lib/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "absl/strings/str_cat.h"
+
+namespace stratum {
+
+namespace {
+
+constexpr uint64 kNoMin = std::numeric_limits<uint64>::max();
+
+// Returns the position of the most significant bit set in a non-zero value.
+int MostSignificantBit(uint64 value) { return 63 - __builtin_clzll(value); }
+
+}  // namespace
+
+constexpr int LatencyHistogram::kSubBucketBits;
+constexpr int LatencyHistogram::kSubBuckets;
+constexpr int LatencyHistogram::kNumBuckets;
+
+LatencyHistogram::LatencyHistogram() { Reset(); }
+
+void LatencyHistogram::Record(uint64 value) {
+  buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+  uint64 min = min_.load(std::memory_order_relaxed);
+  while (value < min && !min_.compare_exchange_weak(
+                            min, value, std::memory_order_relaxed)) {
+  }
+  uint64 max = max_.load(std::memory_order_relaxed);
+  while (value > max && !max_.compare_exchange_weak(
+                            max, value, std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  if (other.Count() == 0) return;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    uint64 n = other.buckets_[i].load(std::memory_order_relaxed);
+    if (n > 0) buckets_[i].fetch_add(n, std::memory_order_relaxed);
+  }
+  count_.fetch_add(other.Count(), std::memory_order_relaxed);
+  sum_.fetch_add(other.Sum(), std::memory_order_relaxed);
+  uint64 other_min = other.min_.load(std::memory_order_relaxed);
+  uint64 min = min_.load(std::memory_order_relaxed);
+  while (other_min < min && !min_.compare_exchange_weak(
+                                min, other_min, std::memory_order_relaxed)) {
+  }
+  uint64 other_max = other.Max();
+  uint64 max = max_.load(std::memory_order_relaxed);
+  while (other_max > max && !max_.compare_exchange_weak(
+                                max, other_max, std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::Reset() {
+  for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  min_.store(kNoMin, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+uint64 LatencyHistogram::Min() const {
+  uint64 min = min_.load(std::memory_order_relaxed);
+  return min == kNoMin ? 0 : min;
+}
+
+uint64 LatencyHistogram::Percentile(double percentile) const {
+  uint64 count = Count();
+  if (count == 0) return 0;
+  percentile = std::min(std::max(percentile, 0.0), 100.0);
+  // Rank (1-based) of the sample we are looking for.
+  uint64 rank = std::max<uint64>(
+      1, static_cast<uint64>(std::ceil(percentile / 100.0 * count)));
+  uint64 seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      // The real sample cannot be larger than the largest one recorded.
+      return std::min(BucketUpperBound(i), Max());
+    }
+  }
+  // Only reachable if samples are being recorded concurrently.
+  return Max();
+}
+
+std::string LatencyHistogram::ToString() const {
+  return absl::StrCat("count=", Count(), " min=", Min(),
+                      " p50=", Percentile(50), " p90=", Percentile(90),
+                      " p99=", Percentile(99), " max=", Max());
+}
+
+int LatencyHistogram::BucketIndex(uint64 value) {
+  // Values smaller than kSubBuckets get a bucket of their own.
+  if (value < kSubBuckets) return static_cast<int>(value);
+  // For larger values, the bits below the kSubBucketBits + 1 most significant
+  // ones are dropped: 'shift' selects the power-of-two range and the remaining
+  // bits (without the leading one) select the sub-bucket in that range.
+  int shift = MostSignificantBit(value) - kSubBucketBits;
+  int sub_bucket = static_cast<int>(value >> shift) - kSubBuckets;
+  return kSubBuckets + shift * kSubBuckets + sub_bucket;
+}
+
+uint64 LatencyHistogram::BucketUpperBound(int index) {
+  if (index < kSubBuckets) return static_cast<uint64>(index);
+  int shift = (index - kSubBuckets) / kSubBuckets;
+  uint64 sub_bucket = kSubBuckets + (index - kSubBuckets) % kSubBuckets;
+  // Computed as lower bound + (width - 1) to avoid overflowing for the last
+  // bucket.
+  return (sub_bucket << shift) + ((1ULL << shift) - 1);
+}
+
+}  // namespace stratum
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_LIB_LATENCY_HISTOGRAM_H_
+#define STRATUM_LIB_LATENCY_HISTOGRAM_H_
+
+#include <atomic>
+#include <string>
+
+#include "stratum/glue/integral_types.h"
+
+namespace stratum {
+
+// LatencyHistogram records non-negative integer samples (typically durations
+// in microseconds) into HDR-style log-linear buckets: every power-of-two range
+// is split into kSubBuckets linear sub-buckets, so any reported percentile is
+// within 1/kSubBuckets of the real value no matter how wide the range of the
+// recorded samples is. Recording is lock-free and can be done concurrently
+// from any number of threads.
+class LatencyHistogram {
+ public:
+  // Number of linear sub-buckets each power-of-two range is split into.
+  static constexpr int kSubBucketBits = 4;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  // Total number of buckets needed to cover the whole uint64 range.
+  static constexpr int kNumBuckets = kSubBuckets * (65 - kSubBucketBits);
+
+  LatencyHistogram();
+  ~LatencyHistogram() {}
+
+  // Records a single sample.
+  void Record(uint64 value);
+
+  // Adds all the samples recorded in 'other' to this histogram.
+  void Merge(const LatencyHistogram& other);
+
+  // Drops all recorded samples.
+  void Reset();
+
+  // Accessors for the summary of the recorded samples. Min() and Max() return
+  // 0 if no sample has been recorded.
+  uint64 Count() const { return count_.load(std::memory_order_relaxed); }
+  uint64 Sum() const { return sum_.load(std::memory_order_relaxed); }
+  uint64 Min() const;
+  uint64 Max() const { return max_.load(std::memory_order_relaxed); }
+
+  // Returns the (upper bound of the bucket holding the) sample at the given
+  // percentile, e.g. Percentile(99) for p99. 'percentile' is clamped to
+  // [0, 100]. Returns 0 if no sample has been recorded.
+  uint64 Percentile(double percentile) const;
+
+  // Returns a one-line summary of the histogram, e.g.
+  // "count=10 min=3 p50=7 p90=12 p99=15 max=15".
+  std::string ToString() const;
+
+  // Helpers mapping a value to the index of its bucket and a bucket to the
+  // largest value it holds. Public for testing.
+  static int BucketIndex(uint64 value);
+  static uint64 BucketUpperBound(int index);
+
+  // LatencyHistogram is neither copyable nor movable.
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+ private:
+  std::atomic<uint64> buckets_[kNumBuckets];
+  std::atomic<uint64> count_;
+  std::atomic<uint64> sum_;
+  std::atomic<uint64> min_;
+  std::atomic<uint64> max_;
+};
+
+}  // namespace stratum
+
+#endif  // STRATUM_LIB_LATENCY_HISTOGRAM_H_
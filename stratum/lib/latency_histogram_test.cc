@@ -0,0 +1,103 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/lib/latency_histogram.h"
+
+#include <limits>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace stratum {
+
+TEST(LatencyHistogramTest, EmptyHistogram) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0, histogram.Count());
+  EXPECT_EQ(0, histogram.Sum());
+  EXPECT_EQ(0, histogram.Min());
+  EXPECT_EQ(0, histogram.Max());
+  EXPECT_EQ(0, histogram.Percentile(99));
+  EXPECT_EQ("count=0 min=0 p50=0 p90=0 p99=0 max=0", histogram.ToString());
+}
+
+TEST(LatencyHistogramTest, BucketBoundaries) {
+  // Every value must fall into a bucket whose upper bound is not smaller than
+  // the value and whose relative width is bounded.
+  for (uint64 value : std::vector<uint64>{
+           0, 1, 15, 16, 17, 31, 32, 33, 1000, 123456789,
+           std::numeric_limits<uint64>::max()}) {
+    int index = LatencyHistogram::BucketIndex(value);
+    ASSERT_GE(index, 0);
+    ASSERT_LT(index, LatencyHistogram::kNumBuckets);
+    uint64 upper = LatencyHistogram::BucketUpperBound(index);
+    EXPECT_GE(upper, value);
+    EXPECT_LE(upper - value, value / LatencyHistogram::kSubBuckets);
+    if (index > 0) {
+      EXPECT_LT(LatencyHistogram::BucketUpperBound(index - 1), value);
+    }
+  }
+  EXPECT_EQ(LatencyHistogram::kNumBuckets - 1,
+            LatencyHistogram::BucketIndex(std::numeric_limits<uint64>::max()));
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram histogram;
+  for (uint64 i = 1; i <= 100; ++i) histogram.Record(i);
+  EXPECT_EQ(100, histogram.Count());
+  EXPECT_EQ(5050, histogram.Sum());
+  EXPECT_EQ(1, histogram.Min());
+  EXPECT_EQ(100, histogram.Max());
+  EXPECT_EQ(1, histogram.Percentile(0));
+  EXPECT_EQ(100, histogram.Percentile(100));
+  // Percentiles are reported with a bounded relative error.
+  EXPECT_GE(histogram.Percentile(50), 50);
+  EXPECT_LE(histogram.Percentile(50), 50 + 50 / LatencyHistogram::kSubBuckets);
+  EXPECT_GE(histogram.Percentile(99), 99);
+  EXPECT_LE(histogram.Percentile(99), 100);
+}
+
+TEST(LatencyHistogramTest, MergeAndReset) {
+  LatencyHistogram histogram1, histogram2;
+  histogram1.Record(10);
+  histogram2.Record(5);
+  histogram2.Record(1000);
+  histogram1.Merge(histogram2);
+  EXPECT_EQ(3, histogram1.Count());
+  EXPECT_EQ(1015, histogram1.Sum());
+  EXPECT_EQ(5, histogram1.Min());
+  EXPECT_EQ(1000, histogram1.Max());
+  histogram1.Reset();
+  EXPECT_EQ(0, histogram1.Count());
+  EXPECT_EQ(0, histogram1.Min());
+  EXPECT_EQ(0, histogram1.Max());
+}
+
+TEST(LatencyHistogramTest, ConcurrentRecord) {
+  constexpr int kThreads = 4;
+  constexpr int kSamplesPerThread = 10000;
+  LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&histogram]() {
+      for (int i = 1; i <= kSamplesPerThread; ++i) histogram.Record(i);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(kThreads * kSamplesPerThread, histogram.Count());
+  EXPECT_EQ(1, histogram.Min());
+  EXPECT_EQ(kSamplesPerThread, histogram.Max());
+}
+
+}  // namespace stratum
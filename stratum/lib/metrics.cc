@@ -0,0 +1,87 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/lib/metrics.h"
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+
+namespace stratum {
+
+constexpr int MetricsCounter::kNumShards;
+
+uint64 MetricsCounter::Value() const {
+  uint64 sum = 0;
+  for (const auto& shard : shards_) {
+    sum += shard.value.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+void MetricsCounter::Reset() {
+  for (auto& shard : shards_) shard.value.store(0, std::memory_order_relaxed);
+}
+
+int MetricsCounter::ShardIndex() {
+  // Threads get consecutive shards in the order they first update any
+  // counter, which spreads the first kNumShards threads over distinct cache
+  // lines.
+  static std::atomic<int> next_index(0);
+  static thread_local int index =
+      next_index.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return index;
+}
+
+MetricsRegistry* MetricsRegistry::Global() {
+  // Never destroyed, so that the metrics can be used from static destructors
+  // and detached threads.
+  static MetricsRegistry* registry = new MetricsRegistry();
+  return registry;
+}
+
+MetricsCounter* MetricsRegistry::GetCounter(const std::string& name) {
+  absl::MutexLock l(&lock_);
+  auto& counter = counters_[name];
+  if (counter == nullptr) counter = absl::make_unique<MetricsCounter>();
+  return counter.get();
+}
+
+LatencyHistogram* MetricsRegistry::GetHistogram(const std::string& name) {
+  absl::MutexLock l(&lock_);
+  auto& histogram = histograms_[name];
+  if (histogram == nullptr) histogram = absl::make_unique<LatencyHistogram>();
+  return histogram.get();
+}
+
+std::string MetricsRegistry::DumpMetrics() const {
+  std::string msg = "";
+  absl::MutexLock l(&lock_);
+  for (const auto& e : counters_) {
+    absl::StrAppend(&msg, "counter ", e.first, " ", e.second->Value(), "\n");
+  }
+  for (const auto& e : histograms_) {
+    absl::StrAppend(&msg, "histogram ", e.first, " ", e.second->ToString(),
+                    "\n");
+  }
+
+  return msg;
+}
+
+void MetricsRegistry::Reset() {
+  absl::MutexLock l(&lock_);
+  for (const auto& e : counters_) e.second->Reset();
+  for (const auto& e : histograms_) e.second->Reset();
+}
+
+}  // namespace stratum
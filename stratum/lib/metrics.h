@@ -0,0 +1,170 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_LIB_METRICS_H_
+#define STRATUM_LIB_METRICS_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "stratum/glue/integral_types.h"
+#include "stratum/lib/latency_histogram.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+
+namespace stratum {
+
+// MetricsCounter is a monotonically increasing counter which can be updated
+// concurrently from any number of threads without contention. The count is
+// split over kNumShards cache line sized cells, and each thread always updates
+// the same cell. Value() sums up all the cells.
+class MetricsCounter {
+ public:
+  static constexpr int kNumShards = 16;
+
+  MetricsCounter() { Reset(); }
+  ~MetricsCounter() {}
+
+  void Add(uint64 n) {
+    shards_[ShardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+  void Increment() { Add(1); }
+
+  // Returns the sum of all the updates so far.
+  uint64 Value() const;
+
+  // Sets the counter back to 0.
+  void Reset();
+
+  // MetricsCounter is neither copyable nor movable.
+  MetricsCounter(const MetricsCounter&) = delete;
+  MetricsCounter& operator=(const MetricsCounter&) = delete;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64> value;
+  };
+
+  // Returns the index of the shard updated by the calling thread.
+  static int ShardIndex();
+
+  Shard shards_[kNumShards];
+};
+
+// MetricsRegistry owns all the named counters and latency histograms of the
+// process. Looking up a metric takes a lock, so callers on hot paths look up
+// their metrics once and keep the returned pointer, which stays valid for the
+// lifetime of the process. The METRICS_* macros below do exactly that.
+class MetricsRegistry {
+ public:
+  MetricsRegistry() {}
+  ~MetricsRegistry() {}
+
+  // Returns the process wide registry.
+  static MetricsRegistry* Global();
+
+  // Returns the counter/histogram with the given name, creating it if needed.
+  // Names are free form, by convention "<component>/<operation>", e.g.
+  // "p4_service/write".
+  MetricsCounter* GetCounter(const std::string& name) LOCKS_EXCLUDED(lock_);
+  LatencyHistogram* GetHistogram(const std::string& name)
+      LOCKS_EXCLUDED(lock_);
+
+  // Returns all the metrics as string, one per line, sorted by name, e.g.:
+  //   counter p4_service/write_updates 1234
+  //   histogram p4_service/write count=10 min=3 p50=7 p90=12 p99=15 max=15
+  std::string DumpMetrics() const LOCKS_EXCLUDED(lock_);
+
+  // Resets the values of all the metrics. The metrics themselves are kept, as
+  // the pointers returned by GetCounter()/GetHistogram() must stay valid.
+  void Reset() LOCKS_EXCLUDED(lock_);
+
+  // MetricsRegistry is neither copyable nor movable.
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+ private:
+  mutable absl::Mutex lock_;
+  std::map<std::string, std::unique_ptr<MetricsCounter>> counters_
+      GUARDED_BY(lock_);
+  std::map<std::string, std::unique_ptr<LatencyHistogram>> histograms_
+      GUARDED_BY(lock_);
+};
+
+// Records the time spent from its construction until it goes out of scope, in
+// microseconds, into a histogram.
+class ScopedLatencyRecorder {
+ public:
+  explicit ScopedLatencyRecorder(LatencyHistogram* histogram)
+      : histogram_(histogram), start_nanos_(absl::GetCurrentTimeNanos()) {}
+  ~ScopedLatencyRecorder() {
+    int64 usecs = (absl::GetCurrentTimeNanos() - start_nanos_) / 1000;
+    histogram_->Record(usecs > 0 ? usecs : 0);
+  }
+
+  // ScopedLatencyRecorder is neither copyable nor movable.
+  ScopedLatencyRecorder(const ScopedLatencyRecorder&) = delete;
+  ScopedLatencyRecorder& operator=(const ScopedLatencyRecorder&) = delete;
+
+ private:
+  LatencyHistogram* const histogram_;
+  const int64 start_nanos_;
+};
+
+}  // namespace stratum
+
+#define METRICS_CONCAT_INNER(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_INNER(a, b)
+
+// Records the time spent from this statement until the end of the enclosing
+// scope into the global histogram 'name'. The histogram is looked up only the
+// first time the statement is executed, so 'name' must be the same every time,
+// typically a string literal. Example:
+//
+//   ::util::Status Foo::Write(...) {
+//     METRICS_LATENCY_SCOPE("foo/write");
+//     ...
+//   }
+#define METRICS_LATENCY_SCOPE(name)                                          \
+  static ::stratum::LatencyHistogram* const METRICS_CONCAT(                  \
+      metrics_latency_histogram_, __LINE__) =                                \
+      ::stratum::MetricsRegistry::Global()->GetHistogram(name);              \
+  ::stratum::ScopedLatencyRecorder METRICS_CONCAT(metrics_latency_recorder_, \
+                                                  __LINE__)(                 \
+      METRICS_CONCAT(metrics_latency_histogram_, __LINE__))
+
+// Adds 'n' to the global counter 'name'. As for METRICS_LATENCY_SCOPE, the
+// counter is looked up only once.
+#define METRICS_COUNTER_ADD(name, n)                                  \
+  do {                                                                \
+    static ::stratum::MetricsCounter* const metrics_counter =         \
+        ::stratum::MetricsRegistry::Global()->GetCounter(name);       \
+    metrics_counter->Add(n);                                          \
+  } while (0)
+
+// Records 'value' into the global histogram 'name'. As for
+// METRICS_LATENCY_SCOPE, the histogram is looked up only once.
+#define METRICS_HISTOGRAM_RECORD(name, value)                         \
+  do {                                                                \
+    static ::stratum::LatencyHistogram* const metrics_histogram =     \
+        ::stratum::MetricsRegistry::Global()->GetHistogram(name);     \
+    metrics_histogram->Record(value);                                 \
+  } while (0)
+
+#endif  // STRATUM_LIB_METRICS_H_
@@ -0,0 +1,78 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/lib/metrics.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/strings/match.h"
+
+namespace stratum {
+
+TEST(MetricsCounterTest, ConcurrentAdds) {
+  MetricsCounter counter;
+  EXPECT_EQ(0U, counter.Value());
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 2 * MetricsCounter::kNumShards; ++t) {
+    threads.emplace_back([&counter] {
+      for (int i = 0; i < 1000; ++i) counter.Add(2);
+    });
+  }
+  for (auto& t : threads) t.join();
+  EXPECT_EQ(2U * MetricsCounter::kNumShards * 2000, counter.Value());
+  counter.Reset();
+  EXPECT_EQ(0U, counter.Value());
+}
+
+TEST(MetricsRegistryTest, MetricsAreCreatedOnce) {
+  MetricsRegistry registry;
+  MetricsCounter* counter = registry.GetCounter("test/counter");
+  EXPECT_EQ(counter, registry.GetCounter("test/counter"));
+  EXPECT_NE(counter, registry.GetCounter("test/other_counter"));
+  LatencyHistogram* histogram = registry.GetHistogram("test/histogram");
+  EXPECT_EQ(histogram, registry.GetHistogram("test/histogram"));
+}
+
+TEST(MetricsRegistryTest, DumpAndReset) {
+  MetricsRegistry registry;
+  registry.GetCounter("b/counter")->Add(5);
+  registry.GetCounter("a/counter")->Increment();
+  registry.GetHistogram("c/histogram")->Record(10);
+  EXPECT_EQ(
+      "counter a/counter 1\n"
+      "counter b/counter 5\n"
+      "histogram c/histogram count=1 min=10 p50=10 p90=10 p99=10 max=10\n",
+      registry.DumpMetrics());
+  registry.Reset();
+  EXPECT_EQ(0U, registry.GetCounter("b/counter")->Value());
+  EXPECT_EQ(0, registry.GetHistogram("c/histogram")->Count());
+}
+
+TEST(MetricsMacrosTest, UseGlobalRegistry) {
+  for (int i = 0; i < 3; ++i) {
+    METRICS_LATENCY_SCOPE("metrics_test/scope");
+    METRICS_COUNTER_ADD("metrics_test/counter", 2);
+    METRICS_HISTOGRAM_RECORD("metrics_test/histogram", i);
+  }
+  MetricsRegistry* registry = MetricsRegistry::Global();
+  EXPECT_EQ(3, registry->GetHistogram("metrics_test/scope")->Count());
+  EXPECT_EQ(6U, registry->GetCounter("metrics_test/counter")->Value());
+  EXPECT_EQ(2, registry->GetHistogram("metrics_test/histogram")->Max());
+  EXPECT_TRUE(absl::StrContains(registry->DumpMetrics(),
+                                "histogram metrics_test/scope count=3"));
+}
+
+}  // namespace stratum
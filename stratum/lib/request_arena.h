@@ -0,0 +1,82 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_LIB_REQUEST_ARENA_H_
+#define STRATUM_LIB_REQUEST_ARENA_H_
+
+#include <stddef.h>
+
+#include "google/protobuf/arena.h"
+
+namespace stratum {
+
+// RequestArena is a protobuf arena meant to hold the short-lived protos built
+// while serving a single request (e.g. the intermediate protos created while
+// translating a P4 TableEntry to a platform specific flow). The first block of
+// the arena is part of the object itself, so as long as the protos fit in it,
+// creating them requires no heap allocation at all. Everything allocated on
+// the arena is freed in one step when the RequestArena goes out of scope.
+// Typical usage:
+//
+//   RequestArena arena;
+//   auto* bcm_flow_entry = arena.Create<BcmFlowEntry>();
+//
+// Only protos defined in files with "option cc_enable_arenas = true;" can be
+// created on the arena.
+class RequestArena {
+ public:
+  // Size of the block embedded in the object.
+  static constexpr size_t kInitialBlockSize = 2048;
+
+  RequestArena() : arena_(Options(initial_block_)) {}
+  ~RequestArena() {}
+
+  // Creates a proto of type T on the arena.
+  template <typename T>
+  T* Create() {
+    return ::google::protobuf::Arena::CreateMessage<T>(&arena_);
+  }
+
+  // Returns the underlying arena.
+  ::google::protobuf::Arena* get() { return &arena_; }
+
+  // Returns the number of bytes allocated from the heap by the arena so far.
+  // Only the blocks allocated after the embedded one are counted.
+  size_t HeapBytes() {
+    size_t space = arena_.SpaceAllocated();
+    return space > kInitialBlockSize ? space - kInitialBlockSize : 0;
+  }
+
+  // RequestArena is neither copyable nor movable.
+  RequestArena(const RequestArena&) = delete;
+  RequestArena& operator=(const RequestArena&) = delete;
+
+ private:
+  static ::google::protobuf::ArenaOptions Options(char* initial_block) {
+    ::google::protobuf::ArenaOptions options;
+    options.initial_block = initial_block;
+    options.initial_block_size = kInitialBlockSize;
+    return options;
+  }
+
+  // Must be declared before arena_, which uses it.
+  alignas(8) char initial_block_[kInitialBlockSize];
+  ::google::protobuf::Arena arena_;
+};
+
+}  // namespace stratum
+
+#endif  // STRATUM_LIB_REQUEST_ARENA_H_
@@ -0,0 +1,53 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/lib/request_arena.h"
+
+#include <string>
+
+#include "google/protobuf/struct.pb.h"
+#include "gtest/gtest.h"
+
+namespace stratum {
+
+namespace {
+
+// Fills 's' with a few fields, which requires allocating sub-messages.
+void FillStruct(int num_fields, ::google::protobuf::Struct* s) {
+  for (int i = 0; i < num_fields; ++i) {
+    (*s->mutable_fields())[std::to_string(i)].set_number_value(i);
+  }
+}
+
+}  // namespace
+
+TEST(RequestArenaTest, SmallProtosFitInInitialBlock) {
+  RequestArena arena;
+  auto* s = arena.Create<::google::protobuf::Struct>();
+  ASSERT_NE(nullptr, s);
+  EXPECT_EQ(arena.get(), s->GetArena());
+  FillStruct(4, s);
+  EXPECT_EQ(4, s->fields_size());
+  EXPECT_EQ(0, arena.HeapBytes());
+}
+
+TEST(RequestArenaTest, LargeProtosSpillToHeap) {
+  RequestArena arena;
+  auto* s = arena.Create<::google::protobuf::Struct>();
+  FillStruct(1000, s);
+  EXPECT_EQ(1000, s->fields_size());
+  EXPECT_GT(arena.HeapBytes(), 0);
+}
+
+}  // namespace stratum
@@ -0,0 +1,85 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/lib/slab_arena.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace stratum {
+
+constexpr size_t SlabArena::kAlignment;
+constexpr size_t SlabArena::kDefaultSlabSize;
+
+SlabArena::SlabArena(size_t slab_size)
+    : slab_size_(std::max(BlockSize(slab_size), kAlignment)),
+      slabs_(),
+      next_(nullptr),
+      remaining_(0),
+      free_lists_(),
+      bytes_reserved_(0),
+      bytes_in_use_(0) {}
+
+char* SlabArena::Allocate(size_t size) {
+  size = BlockSize(size);
+  bytes_in_use_ += size;
+  // Reuse a free block of the same size if there is one.
+  auto it = free_lists_.find(size);
+  if (it != free_lists_.end()) {
+    char* block = it->second;
+    char* next;
+    memcpy(&next, block, sizeof(next));
+    if (next == nullptr) {
+      free_lists_.erase(it);
+    } else {
+      it->second = next;
+    }
+    return block;
+  }
+  // Blocks larger than a quarter of a slab get a slab of their own, to not
+  // waste the free space at the end of the current slab.
+  if (size > slab_size_ / 4) {
+    slabs_.emplace_back(new char[size]);
+    bytes_reserved_ += size;
+    return slabs_.back().get();
+  }
+  if (size > remaining_) {
+    slabs_.emplace_back(new char[slab_size_]);
+    bytes_reserved_ += slab_size_;
+    next_ = slabs_.back().get();
+    remaining_ = slab_size_;
+  }
+  char* block = next_;
+  next_ += size;
+  remaining_ -= size;
+  return block;
+}
+
+void SlabArena::Free(char* block, size_t size) {
+  if (block == nullptr) return;
+  size = BlockSize(size);
+  bytes_in_use_ -= size;
+  char*& head = free_lists_[size];
+  memcpy(block, &head, sizeof(head));
+  head = block;
+}
+
+size_t SlabArena::BlockSize(size_t size) {
+  // Every block must be large enough to hold the free list pointer.
+  size = std::max(size, sizeof(char*));
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+}  // namespace stratum
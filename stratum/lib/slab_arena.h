@@ -0,0 +1,80 @@
+/*
+ * Copyright 2019-present Open Networking Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STRATUM_LIB_SLAB_ARENA_H_
+#define STRATUM_LIB_SLAB_ARENA_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+namespace stratum {
+
+// SlabArena hands out variable size blocks of memory carved out of large
+// slabs, so that storing millions of small objects (e.g. serialized protos)
+// does not pay the per-allocation overhead of the heap. Freed blocks are kept
+// in per-size free lists and reused by later allocations of the same (rounded)
+// size. The memory of the slabs is only returned to the heap when the arena is
+// destroyed. This class is not thread-safe.
+class SlabArena {
+ public:
+  // All the blocks are aligned to and their sizes rounded up to kAlignment.
+  static constexpr size_t kAlignment = 8;
+  static constexpr size_t kDefaultSlabSize = 64 * 1024;
+
+  explicit SlabArena(size_t slab_size = kDefaultSlabSize);
+  ~SlabArena() {}
+
+  // Returns a block of at least 'size' bytes.
+  char* Allocate(size_t size);
+
+  // Returns a block previously returned by Allocate(size) to the arena.
+  void Free(char* block, size_t size);
+
+  // Total number of bytes reserved from the heap for the slabs.
+  size_t BytesReserved() const { return bytes_reserved_; }
+
+  // Total number of bytes in the blocks currently allocated.
+  size_t BytesInUse() const { return bytes_in_use_; }
+
+  // SlabArena is neither copyable nor movable.
+  SlabArena(const SlabArena&) = delete;
+  SlabArena& operator=(const SlabArena&) = delete;
+
+ private:
+  // Size of the block used for a request of 'size' bytes.
+  static size_t BlockSize(size_t size);
+
+  // Size of the slabs, except for the ones allocated for large blocks.
+  const size_t slab_size_;
+  // All the slabs allocated so far.
+  std::vector<std::unique_ptr<char[]>> slabs_;
+  // Free space at the end of the last slab.
+  char* next_;
+  size_t remaining_;
+  // Map from block size to the head of the list of free blocks of that size.
+  // The pointer to the next free block is stored in the block itself.
+  absl::flat_hash_map<size_t, char*> free_lists_;
+  size_t bytes_reserved_;
+  size_t bytes_in_use_;
+};
+
+}  // namespace stratum
+
+#endif  // STRATUM_LIB_SLAB_ARENA_H_
@@ -0,0 +1,78 @@
+// Copyright 2019-present Open Networking Foundation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stratum/lib/slab_arena.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace stratum {
+
+TEST(SlabArenaTest, AllocateFromSameSlab) {
+  SlabArena arena(1024);
+  char* block1 = arena.Allocate(10);
+  char* block2 = arena.Allocate(20);
+  ASSERT_NE(nullptr, block1);
+  ASSERT_NE(nullptr, block2);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(block1) % SlabArena::kAlignment);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(block2) % SlabArena::kAlignment);
+  // Sizes are rounded up to the alignment.
+  EXPECT_EQ(block1 + 16, block2);
+  EXPECT_EQ(16 + 24, arena.BytesInUse());
+  EXPECT_EQ(1024, arena.BytesReserved());
+  memset(block1, 'a', 10);
+  memset(block2, 'b', 20);
+  EXPECT_EQ('a', block1[9]);
+  EXPECT_EQ('b', block2[0]);
+}
+
+TEST(SlabArenaTest, ReuseFreedBlocks) {
+  SlabArena arena(1024);
+  char* block1 = arena.Allocate(32);
+  char* block2 = arena.Allocate(32);
+  arena.Free(block1, 32);
+  arena.Free(block2, 32);
+  EXPECT_EQ(0, arena.BytesInUse());
+  // Freed blocks are reused in LIFO order, only for the same rounded size.
+  char* block3 = arena.Allocate(30);
+  EXPECT_EQ(block2, block3);
+  EXPECT_EQ(block1, arena.Allocate(32));
+  char* block4 = arena.Allocate(48);
+  EXPECT_NE(block1, block4);
+  EXPECT_NE(block2, block4);
+  EXPECT_EQ(1024, arena.BytesReserved());
+}
+
+TEST(SlabArenaTest, NewSlabsAndLargeBlocks) {
+  SlabArena arena(256);
+  std::vector<char*> blocks;
+  for (int i = 0; i < 10; ++i) blocks.push_back(arena.Allocate(64));
+  EXPECT_EQ(10 * 64, arena.BytesInUse());
+  EXPECT_EQ(3 * 256, arena.BytesReserved());
+  // A block larger than a quarter of a slab gets a slab of its own and does
+  // not consume the free space of the current slab.
+  char* large = arena.Allocate(1000);
+  EXPECT_EQ(3 * 256 + 1000, arena.BytesReserved());
+  memset(large, 'x', 1000);
+  char* small = arena.Allocate(64);
+  EXPECT_EQ(blocks.back() + 64, small);
+  arena.Free(large, 1000);
+  EXPECT_EQ(large, arena.Allocate(1000));
+}
+
+}  // namespace stratum
@@ -143,7 +143,8 @@ void BcmSimTestFixture::SetUp() {
       OPERATION_MODE_SIM, bcm_chassis_manager_.get(), p4_table_mapper_.get(),
       bcm_sdk_sim_.get(), kUnit);
   bcm_node_ = BcmNode::CreateInstance(
-      bcm_acl_manager_.get(), bcm_l2_manager_.get(), bcm_l3_manager_.get(),
+      bcm_acl_manager_.get(), /*bcm_idle_timeout_manager=*/nullptr,
+      bcm_l2_manager_.get(), bcm_l3_manager_.get(),
       bcm_packetio_manager_.get(), bcm_table_manager_.get(),
       bcm_tunnel_manager_.get(), p4_table_mapper_.get(), kUnit);
   std::map<int, BcmNode *> unit_to_bcm_node;